@@ -258,9 +258,12 @@ typedef struct {
  * \brief Handle for an FFT object
  *
  * This FFT object is used by the functions mha_fft_wave2spec and
- * mha_fft_spec2wave. The FFT back-end is the FFTW library. The
- * back-end is completely hidden, including external header files or
- * linking external libraries is not required.
+ * mha_fft_spec2wave. The FFT back-end is FFTW3 (if libopenmha was
+ * configured with FFTW3 support), FFTW2, or a built-in portable FFT,
+ * selected with the environment variable MHA_FFT_BACKEND (see
+ * MHASignal::fft_backend_id_t). The back-end is completely hidden,
+ * including external header files or linking external libraries is
+ * not required.
  */
 typedef void* mha_fft_t;
 
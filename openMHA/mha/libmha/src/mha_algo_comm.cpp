@@ -75,12 +75,31 @@ void MHA_AC::comm_var_map_t::insert(const std::string & name,
                         "variable name \"%s\", cannot insert into AC space",
                         name.c_str());
 
-    // Create or replace.
-    map[name] = var;
+    if (!creating_new_entry) { // Replace.
+        table[map.find(name)->second].var = var;
+        return;
+    }
 
-    // Update the list of entries if we have just extended it.
-    if (creating_new_entry)
-        update_entries();
+    // Create, reuse the first free slot of the table if there is one.
+    size_t index = 0U;
+    while (index < table.size() && table[index].name.size())
+        ++index;
+    if (index == table.size())
+        table.emplace_back();
+    table[index].name = name;
+    table[index].var = var;
+    map[name] = index;
+
+    // Update the list of entries because we have just extended it.
+    update_entries();
+}
+
+void MHA_AC::comm_var_map_t::erase_slot(size_t index)
+{
+    map.erase(table[index].name);
+    table[index].name.clear();
+    table[index].var = {};
+    ++table[index].generation;
 }
 
 void MHA_AC::comm_var_map_t::erase_by_name(const std::string & name)
@@ -93,14 +112,14 @@ void MHA_AC::comm_var_map_t::erase_by_name(const std::string & name)
                         "tried to do this is misbehaving and should be fixed.",
                         name.c_str());
     // When not perpared, it is permitted, do it.
-    map.erase(name);
+    auto it = map.find(name);
+    if (it != map.end())
+        erase_slot(it->second);
     update_entries();
 }
 
 void MHA_AC::comm_var_map_t::erase_by_pointer(void * ptr)
 {
-    std::map<std::string,comm_var_t>::iterator current_iterator, next_iterator;
-
     // The same pointer may be used by multiple AC variables.  Collect
     // the names of all AC variables here in case we have to throw an exception
     // so that we can give the user some information from which they may be
@@ -116,22 +135,17 @@ void MHA_AC::comm_var_map_t::erase_by_pointer(void * ptr)
     // as ptr.  When variable removal is not permitted, then it collects the
     // names of the AC variables that would be erased, otherwise it performs
     // the erasure but does not collect the names.
-    for(current_iterator = map.begin();
-        current_iterator != map.end();
-        current_iterator = next_iterator) 
-    {
-        // We may invalidate the current iterator later, better get next now
-        next_iterator = current_iterator;
-        ++next_iterator;
-
-        if( current_iterator->second.data == ptr ) { // Found a match
+    // The loop visits the AC variables in order of their names.
+    for(const auto & pair : map)
+        if( table[pair.second].var.data == ptr ) { // Found a match
             ++num_erased_variables;   // Increase counter.
             if (is_prepared)  // operation forbidden, add info to error message
-                erased_variables += current_iterator->first + ", ";
-            else              // operation allowed, delete AC variable entry
-                map.erase(current_iterator);
+                erased_variables += pair.first + ", ";
         }
-    }
+    if (!is_prepared) // operation allowed, delete AC variable entries
+        for(size_t index = 0U; index < table.size(); ++index)
+            if (table[index].name.size() && table[index].var.data == ptr)
+                erase_slot(index);
     if (is_prepared) { // Operation forbidden while MHA prepared, raise error.
         if (erased_variables.size()) // remove ", " after last entry
             erased_variables.resize(erased_variables.size() - 2U);
@@ -162,14 +176,44 @@ void MHA_AC::comm_var_map_t::erase_by_pointer(void * ptr)
 const MHA_AC::comm_var_t &
 MHA_AC::comm_var_map_t::retrieve(const std::string & name) const
 {
-    if (has_key(name)) 
-        return map.at(name);
+    auto it = map.find(name);
+    if (it != map.end())
+        return table[it->second].var;
     else
         throw MHA_Error(__FILE__,__LINE__,
                         "No algorithm communication variable \"%s\".",
                         name.c_str());
 }
 
+MHA_AC::var_handle_t
+MHA_AC::comm_var_map_t::get_handle(const std::string & name) const
+{
+    auto it = map.find(name);
+    if (it == map.end())
+        throw MHA_Error(__FILE__,__LINE__,
+                        "No algorithm communication variable \"%s\".",
+                        name.c_str());
+    var_handle_t handle;
+    handle.name = name;
+    handle.index = it->second;
+    handle.generation = table[it->second].generation;
+    return handle;
+}
+
+void MHA_AC::comm_var_map_t::
+throw_invalid_handle(const var_handle_t & handle) const
+{
+    if (!handle.is_resolved())
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Attempt to access algorithm communication variable "
+                        "\"%s\" through an unresolved handle.",
+                        handle.name.c_str());
+    throw MHA_Error(__FILE__,__LINE__,
+                    "The algorithm communication variable \"%s\" has been "
+                    "removed since its handle was resolved.",
+                    handle.name.c_str());
+}
+
 const std::vector<std::string> & MHA_AC::comm_var_map_t::get_entries() const
 {
     return entries;
@@ -243,6 +287,18 @@ get_var(const std::string & name) const
     return vars.retrieve(name);
 }
 
+MHA_AC::var_handle_t MHA_AC::algo_comm_class_t::
+get_handle(const std::string & name) const
+{
+    return vars.get_handle(name);
+}
+
+MHA_AC::comm_var_t MHA_AC::algo_comm_class_t::
+get_var(const var_handle_t & handle) const
+{
+    return vars.retrieve(handle);
+}
+
 bool MHA_AC::algo_comm_class_t::is_var(const std::string & name) const
 {
     return vars.has_key(name);
@@ -259,51 +315,132 @@ size_t MHA_AC::algo_comm_class_t::size() const
     return vars.size();
 }
 
+namespace {
+    /** Check type and size of a scalar AC variable and return its value.
+     * @param var         Metadata of the AC variable.
+     * @param name        Name of the AC variable, for error messages.
+     * @param data_type   Expected data type.
+     * @param method      Name of the calling method, for error messages.
+     * @param type_name   Name of the expected data type, for error messages.
+     * @throw MHA_Error if data type or size do not match. */
+    template <class T>
+    T scalar_value(const MHA_AC::comm_var_t & var, const std::string & name,
+                   unsigned int data_type,
+                   const char * method, const char * type_name)
+    {
+        if( var.data_type != data_type )
+            throw MHA_Error(__FILE__, __LINE__, "algo_comm_class_t::%s: "
+                            "AC variable \"%s\" has unexpected data type %u, "
+                            "expected %s (%u).", method, name.c_str(),
+                            var.data_type, type_name, data_type);
+        if( var.num_entries != 1 )
+            throw MHA_Error(__FILE__, __LINE__, "algo_comm_class_t::%s: "
+                            "AC variable \"%s\" has unexpected size %u, "
+                            "expected 1.", method, name.c_str(),
+                            var.num_entries);
+        return *static_cast<T*>(var.data);
+    }
+
+    int int_value(const MHA_AC::comm_var_t & var, const std::string & name)
+    {
+        return scalar_value<int>(var, name, MHA_AC_INT,
+                                 "get_var_int", "MHA_AC_INT");
+    }
+
+    float float_value(const MHA_AC::comm_var_t & var, const std::string & name)
+    {
+        return scalar_value<float>(var, name, MHA_AC_FLOAT,
+                                   "get_var_float", "MHA_AC_FLOAT");
+    }
+
+    /** Copy an AC variable into a vector of floats, see MHA_AC::get_var_vfloat */
+    std::vector<float> vfloat_value(const MHA_AC::comm_var_t & cv,
+                                    const std::string & name)
+    {
+        unsigned types[2] = {MHA_AC_FLOAT, MHA_AC_FLOAT};
+        if (std::is_same<float,mha_real_t>::value)
+            types[0] = MHA_AC_MHAREAL;
+        if (cv.data_type != types[0] && cv.data_type != types[1]) {
+            throw MHA_Error(__FILE__,__LINE__,
+                            "Algorithm communication variable %s has unexpected"
+                            " data type %u", name.c_str(), cv.data_type);
+        }
+        std::vector<float> vfloat;
+        vfloat.resize(cv.num_entries);
+        std::copy(static_cast<float*>(cv.data),
+                  static_cast<float*>(cv.data) + cv.num_entries,
+                  vfloat.begin());
+        return vfloat;
+    }
+
+    /** Interpret an AC variable as a spectrum, see MHA_AC::get_var_spectrum */
+    mha_spec_t spectrum_value(const MHA_AC::comm_var_t & var,
+                              const std::string & n)
+    {
+        if( (var.stride == 0) || (var.num_entries!=0 && var.stride > var.num_entries) )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "The variable \"%s\" has invalid stride settings (%u).",
+                            n.c_str(),var.stride);
+        if( var.num_entries == 0 )
+            throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" contains no data.",n.c_str());
+        mha_spec_t s;
+        memset(&s,0,sizeof(s));
+        s.num_frames = var.stride;
+        s.num_channels = var.num_entries / var.stride;
+        if( s.num_channels * s.num_frames != var.num_entries )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "The variable \"%s\" has invalid stride settings (%u): Not an integer fraction of entries.",
+                            n.c_str(),var.stride);
+        if( var.data_type != MHA_AC_MHACOMPLEX )
+            throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" has invalid data type.",n.c_str());
+        s.buf = (mha_complex_t*)var.data;
+        return s;
+    }
+
+    /** Interpret an AC variable as a waveform, see MHA_AC::get_var_waveform */
+    mha_wave_t waveform_value(const MHA_AC::comm_var_t & var,
+                              const std::string & n)
+    {
+        if( (var.stride == 0) || (var.num_entries!=0 && var.stride > var.num_entries) )
+            throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" has invalid stride settings (%u).",n.c_str(),var.stride);
+        mha_wave_t s;
+        memset(&s,0,sizeof(s));
+        s.num_channels = var.stride;
+        s.num_frames = var.num_entries / var.stride;
+        if( s.num_channels * s.num_frames != var.num_entries )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "The variable \"%s\" has invalid stride settings (%u): Not an integer fraction of entries.",
+                            n.c_str(),var.stride);
+        if( var.data_type == MHA_AC_MHAREAL ){
+            s.buf = (mha_real_t*)var.data;
+            return s;
+        }
+        if( sizeof(mha_real_t) == sizeof(float) ){
+            if( var.data_type == MHA_AC_FLOAT ){
+                s.buf = (float*)var.data;
+                return s;
+            }
+        }
+        throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" has invalid data type.",n.c_str());
+    }
+}
+
 int MHA_AC::algo_comm_class_t::get_var_int(const std::string & name) const
 {
-    comm_var_t var = get_var(name);
-    if( var.data_type != MHA_AC_INT )
-        throw MHA_Error(__FILE__, __LINE__, "algo_comm_class_t::get_var_int: "
-                        "AC variable \"%s\" has unexpected data type %u, "
-                        "expected MHA_AC_INT (%u).", name.c_str(),
-                        var.data_type, MHA_AC_INT);
-    if( var.num_entries != 1 )
-        throw MHA_Error(__FILE__, __LINE__, "algo_comm_class_t::get_var_int: "
-                        "AC variable \"%s\" has unexpected size %u, "
-                        "expected 1.", name.c_str(), var.num_entries);
-    return *static_cast<int*>(var.data);
+    return int_value(get_var(name), name);
 }
 
 float MHA_AC::algo_comm_class_t::
 get_var_float(const std::string & name) const
 {
-    comm_var_t var = get_var(name);
-    if( var.data_type != MHA_AC_FLOAT )
-        throw MHA_Error(__FILE__, __LINE__,"algo_comm_class_t::get_var_float: "
-                        "AC variable \"%s\" has unexpected data type %u, "
-                        "expected MHA_AC_FLOAT (%u).", name.c_str(),
-                        var.data_type, MHA_AC_FLOAT);
-    if( var.num_entries != 1 )
-        throw MHA_Error(__FILE__, __LINE__,"algo_comm_class_t::get_var_float: "
-                        "AC variable \"%s\" has unexpected size %u, "
-                        "expected 1.", name.c_str(), var.num_entries);
-    return *static_cast<float*>(var.data);
+    return float_value(get_var(name), name);
 }
 
 double MHA_AC::algo_comm_class_t::
 get_var_double(const std::string & name) const
 {
-    comm_var_t var = get_var(name);
-    if( var.data_type != MHA_AC_DOUBLE )
-        throw MHA_Error(__FILE__,__LINE__,"algo_comm_class_t::get_var_double: "
-                        "AC variable \"%s\" has unexpected data type %u, "
-                        "expected MHA_AC_DOUBLE (%u).", name.c_str(),
-                        var.data_type, MHA_AC_DOUBLE);
-    if( var.num_entries != 1 )
-        throw MHA_Error(__FILE__,__LINE__,"algo_comm_class_t::get_var_double: "
-                        "AC variable \"%s\" has unexpected size %u, "
-                        "expected 1.", name.c_str(), var.num_entries);
-    return *static_cast<double*>(var.data);
+    return scalar_value<double>(get_var(name), name, MHA_AC_DOUBLE,
+                                "get_var_double", "MHA_AC_DOUBLE");
 }
 
 void MHA_AC::algo_comm_class_t::set_prepared(bool prepared)
@@ -313,51 +450,22 @@ void MHA_AC::algo_comm_class_t::set_prepared(bool prepared)
 
 mha_spec_t MHA_AC::get_var_spectrum(algo_comm_t & ac,const std::string& n)
 {
-    comm_var_t var = ac.get_var(n);
-    if( (var.stride == 0) || (var.num_entries!=0 && var.stride > var.num_entries) )
-        throw MHA_Error(__FILE__,__LINE__,
-                        "The variable \"%s\" has invalid stride settings (%u).",
-                        n.c_str(),var.stride);
-    if( var.num_entries == 0 )
-        throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" contains no data.",n.c_str());
-    mha_spec_t s;
-    memset(&s,0,sizeof(s));
-    s.num_frames = var.stride;
-    s.num_channels = var.num_entries / var.stride;
-    if( s.num_channels * s.num_frames != var.num_entries )
-        throw MHA_Error(__FILE__,__LINE__,
-                        "The variable \"%s\" has invalid stride settings (%u): Not an integer fraction of entries.",
-                        n.c_str(),var.stride);
-    if( var.data_type != MHA_AC_MHACOMPLEX )
-        throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" has invalid data type.",n.c_str());
-    s.buf = (mha_complex_t*)var.data;
-    return s;
+    return spectrum_value(ac.get_var(n), n);
+}
+
+mha_spec_t MHA_AC::get_var_spectrum(algo_comm_t & ac,const var_handle_t& var)
+{
+    return spectrum_value(ac.get_var(var), var.name);
 }
 
 mha_wave_t MHA_AC::get_var_waveform(algo_comm_t & ac,const std::string& n)
 {
-    comm_var_t var = ac.get_var(n);
-    if( (var.stride == 0) || (var.num_entries!=0 && var.stride > var.num_entries) )
-        throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" has invalid stride settings (%u).",n.c_str(),var.stride);
-    mha_wave_t s;
-    memset(&s,0,sizeof(s));
-    s.num_channels = var.stride;
-    s.num_frames = var.num_entries / var.stride;
-    if( s.num_channels * s.num_frames != var.num_entries )
-        throw MHA_Error(__FILE__,__LINE__,
-                        "The variable \"%s\" has invalid stride settings (%u): Not an integer fraction of entries.",
-                        n.c_str(),var.stride);
-    if( var.data_type == MHA_AC_MHAREAL ){
-        s.buf = (mha_real_t*)var.data;
-        return s;
-    }
-    if( sizeof(mha_real_t) == sizeof(float) ){
-        if( var.data_type == MHA_AC_FLOAT ){
-            s.buf = (float*)var.data;
-            return s;
-        }
-    }
-    throw MHA_Error(__FILE__,__LINE__,"The variable \"%s\" has invalid data type.",n.c_str());
+    return waveform_value(ac.get_var(n), n);
+}
+
+mha_wave_t MHA_AC::get_var_waveform(algo_comm_t & ac,const var_handle_t& var)
+{
+    return waveform_value(ac.get_var(var), var.name);
 }
 
 int MHA_AC::get_var_int(algo_comm_t & ac,const std::string& n)
@@ -365,23 +473,19 @@ int MHA_AC::get_var_int(algo_comm_t & ac,const std::string& n)
     return ac.get_var_int(n);
 }
 
+int MHA_AC::get_var_int(algo_comm_t & ac,const var_handle_t& var)
+{
+    return int_value(ac.get_var(var), var.name);
+}
+
 std::vector<float> MHA_AC::get_var_vfloat(algo_comm_t & ac,const std::string& name)
 {
-    comm_var_t cv = ac.get_var(name);
-    unsigned types[2] = {MHA_AC_FLOAT, MHA_AC_FLOAT};
-    if (std::is_same<float,mha_real_t>::value)
-        types[0] = MHA_AC_MHAREAL;
-    if (cv.data_type != types[0] && cv.data_type != types[1]) {
-        throw MHA_Error(__FILE__,__LINE__,
-                        "Algorithm communication variable %s has unexpected"
-                        " data type %u", name.c_str(), cv.data_type);
-    }
-    std::vector<float> vfloat;
-    vfloat.resize(cv.num_entries);
-    std::copy(static_cast<float*>(cv.data), 
-              static_cast<float*>(cv.data) + cv.num_entries,
-              vfloat.begin());
-    return vfloat;
+    return vfloat_value(ac.get_var(name), name);
+}
+
+std::vector<float> MHA_AC::get_var_vfloat(algo_comm_t & ac,const var_handle_t& var)
+{
+    return vfloat_value(ac.get_var(var), var.name);
 }
 
 float MHA_AC::get_var_float(algo_comm_t & ac,const std::string& n)
@@ -389,6 +493,11 @@ float MHA_AC::get_var_float(algo_comm_t & ac,const std::string& n)
     return ac.get_var_float(n);
 }
 
+float MHA_AC::get_var_float(algo_comm_t & ac,const var_handle_t& var)
+{
+    return float_value(ac.get_var(var), var.name);
+}
+
 MHA_AC::spectrum_t::spectrum_t(algo_comm_t & iac,
                                const std::string & iname,
                                unsigned int bins,
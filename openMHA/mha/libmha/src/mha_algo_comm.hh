@@ -36,6 +36,37 @@
 #include <map>
 
 namespace MHA_AC {
+    /**
+       \ingroup algocomm
+
+       \brief Handle of an AC variable for name-free access.
+
+       Handles are obtained from the variable name with
+       algo_comm_t::get_handle(), preferably in the plugin's prepare()
+       method after all upstream plugins have published their AC
+       variables.  Retrieving an AC variable through its handle is a
+       constant-time table access without string comparisons or memory
+       allocations and is therefore suitable for the process() method.
+
+       A handle refers to its AC variable for as long as this variable
+       exists in the AC space that issued the handle.  Because AC
+       variables cannot be removed while the AC space is prepared, a
+       handle resolved during prepare() stays valid until the next
+       release().  Using a handle after its variable has been removed
+       raises an error, even if a new variable has been created in its
+       place.
+    */
+    struct var_handle_t {
+        /** Name of the AC variable, used for error messages. */
+        std::string name;
+        /** Index into the table of the AC space. */
+        size_t index = ~size_t(0);
+        /** Generation of the table entry when the handle was resolved. */
+        unsigned int generation = 0U;
+        /** @return true if this handle has been resolved by get_handle(). */
+        bool is_resolved() const {return index != ~size_t(0);}
+    };
+
     /** 
         \ingroup algocomm
 
@@ -56,6 +87,18 @@ namespace MHA_AC {
     */
     mha_spec_t get_var_spectrum(algo_comm_t & ac,const std::string& name);
 
+    /**
+       \ingroup algocomm
+
+       \brief Convert an AC variable into a spectrum, see
+       get_var_spectrum(algo_comm_t&,const std::string&).
+       Does not search the AC space by name.
+       \param ac AC handle
+       \param var Handle of the variable, resolved in \c ac
+       \return Spectrum structure
+    */
+    mha_spec_t get_var_spectrum(algo_comm_t & ac,const var_handle_t& var);
+
     /** 
         \ingroup algocomm
 
@@ -76,6 +119,18 @@ namespace MHA_AC {
     */
     mha_wave_t get_var_waveform(algo_comm_t & ac,const std::string& name);
 
+    /**
+       \ingroup algocomm
+
+       \brief Convert an AC variable into a waveform, see
+       get_var_waveform(algo_comm_t&,const std::string&).
+       Does not search the AC space by name.
+       \param ac AC handle
+       \param var Handle of the variable, resolved in \c ac
+       \return waveform structure
+    */
+    mha_wave_t get_var_waveform(algo_comm_t & ac,const var_handle_t& var);
+
     /**
        \ingroup algocomm
        
@@ -87,6 +142,18 @@ namespace MHA_AC {
      */
     int get_var_int(algo_comm_t & ac,const std::string& name);
 
+    /**
+       \ingroup algocomm
+       
+       \brief Return value of an integer scalar AC variable without
+       searching the AC space by name
+       
+       \param ac AC handle
+       \param var Handle of the variable, resolved in \c ac
+       \return Variable value
+     */
+    int get_var_int(algo_comm_t & ac,const var_handle_t& var);
+
     /**
        \ingroup algocomm
 
@@ -97,6 +164,18 @@ namespace MHA_AC {
        \return Variable value
      */
     float get_var_float(algo_comm_t & ac,const std::string& name);
+
+    /**
+       \ingroup algocomm
+
+       \brief Return value of an floating point scalar AC variable
+       without searching the AC space by name
+
+       \param ac AC handle
+       \param var Handle of the variable, resolved in \c ac
+       \return Variable value
+     */
+    float get_var_float(algo_comm_t & ac,const var_handle_t& var);
     
     /**
        \ingroup algocomm
@@ -111,6 +190,20 @@ namespace MHA_AC {
        \return Variable value
      */
     std::vector<float> get_var_vfloat(algo_comm_t & ac,const std::string& name);
+
+    /**
+       \ingroup algocomm
+
+       \brief Return value of an floating point vector AC variable as
+       standard vector of floats without searching the AC space by name
+
+        Like get_var_vfloat(algo_comm_t&,const std::string&), this
+        function allocates memory for the return value.
+       \param ac AC handle
+       \param var Handle of the variable, resolved in \c ac
+       \return Variable value
+     */
+    std::vector<float> get_var_vfloat(algo_comm_t & ac,const var_handle_t& var);
     
     /**
        \ingroup algocomm
@@ -357,26 +450,48 @@ namespace MHA_AC {
         unsigned int frameno;
     };
 
-    /** Storage class for the AC variable space.  Uses an std::map for
-     * associating AC variable names with AC variable metadata (\c comm_var_t).
-     * Acts as a delegator for the std::map storage.  Allows operations that
-     * may require memory allocations/deallocations only when
-     * is_prepared == false. */
+    /** Storage class for the AC variable space.  AC variable metadata
+     * (\c comm_var_t) is stored in a flat table, an std::map associates
+     * AC variable names with indices into this table.  Table indices of
+     * existing AC variables never change, therefore variables can be
+     * accessed by index through a \c var_handle_t without searching.
+     * Allows operations that may require memory allocations/deallocations
+     * only when is_prepared == false. */
     class comm_var_map_t {
-        /** The std::map used for organizing the AC space */
-        std::map<std::string, comm_var_t> map;
+        /** One entry of the AC variable table. */
+        struct slot_t {
+            /** Name of the AC variable, empty if the slot is unused. */
+            std::string name;
+            /** Metadata of the AC variable. */
+            comm_var_t var = {};
+            /** Incremented each time the slot is freed, so that handles
+             * of removed variables can be detected. */
+            unsigned int generation = 0U;
+        };
+
+        /** The table of AC variables.  Slots of removed variables are
+         * reused for new variables. */
+        std::vector<slot_t> table;
+
+        /** The std::map used for finding AC variables by name, maps
+         * names to indices into \ref table. */
+        std::map<std::string, size_t> map;
 
         /// A list containing the names of all AC variables.
         std::vector<std::string> entries;
 
         /* In order to avoid complicated size types, assert that the map's
          * size_type is the same as size_t. */
-        static_assert(std::is_same<std::map<std::string,comm_var_t>::size_type,
+        static_assert(std::is_same<std::map<std::string,size_t>::size_type,
                                    size_t>::value);
 
         /** Update the member variable \ref entries because an AC variable has
          * been inserted or removed. Only permitted if is_prepared == false. */
         void update_entries();
+
+        /** Free the table slot with the given index and remove its name
+         * from the map.  Only permitted if is_prepared == false. */
+        void erase_slot(size_t index);
     public:
         /** is_prepared stores whether the provider of the AC space has entered
          * MHA state "prepared" or not.  Operations on \c map that require
@@ -419,11 +534,33 @@ namespace MHA_AC {
          * @throw MHA_Error if no such variable exists in the AC space. */
         const comm_var_t & retrieve(const std::string & name) const;
 
+        /** Get the comm_var_t of an existing variable by handle.  Does not
+         * search and does not allocate memory.
+         * @param handle Handle of the AC variable, issued by this object.
+         * @throw MHA_Error if the handle is unresolved or if its variable
+         *                  has been removed. */
+        const comm_var_t & retrieve(const var_handle_t & handle) const
+        {
+            if (handle.index < table.size() &&
+                table[handle.index].generation == handle.generation &&
+                table[handle.index].name.size())
+                return table[handle.index].var;
+            throw_invalid_handle(handle);
+        }
+
+        /** Resolve the name of an existing variable to a handle.
+         * @param name The name of the AC variable.
+         * @throw MHA_Error if no such variable exists in the AC space. */
+        var_handle_t get_handle(const std::string & name) const;
+
         /** @return A list of names of all AC variables in this AC space. */
         const std::vector<std::string> & get_entries() const;
 
         /** @return number of stored AC variables */
         size_t size() const {return map.size();}
+    private:
+        /** Raise the error for retrieve() with an invalid handle. */
+        [[noreturn]] void throw_invalid_handle(const var_handle_t & handle) const;
     };
 
     /** Algorithm communication variable space interface. */
@@ -560,6 +697,29 @@ namespace MHA_AC {
         virtual
         bool is_var(const std::string & name) const = 0;
 
+        /** Interacts with AC space storage to resolve the name of an
+         * existing AC variable to a handle.  Handles allow to retrieve AC
+         * variables during signal processing without searching by name,
+         * see \ref var_handle_t.  Should be called from prepare() or from
+         * the constructor of a runtime configuration, not from process().
+         * @param name Name of the AC variable.
+         * @return a handle for retrieving the AC variable with get_var().
+         * @throw MHA_Error if no AC variable with the given name exists. */
+        virtual
+        var_handle_t get_handle(const std::string & name) const = 0;
+
+        /** Interacts with AC space storage to retrieve the metadata for an
+         * AC variable through its handle.  Constant time, does not
+         * allocate memory.
+         * @param handle Handle of the AC variable, obtained from
+         *               get_handle() of this AC space.
+         * @return a struct describing the AC variable's data type, memory
+         *         location and size.
+         * @throw MHA_Error if the variable referred to by the handle has
+         *                  been removed from the AC space. */
+        virtual
+        comm_var_t get_var(const var_handle_t & handle) const = 0;
+
         /** Interacts with AC space storage to retrieve the metadata for an
          * AC variable with the given name.
          * @param name Name of the AC variable to retrieve. 
@@ -619,6 +779,8 @@ namespace MHA_AC {
         void remove_ref(void* addr)                                   override;
         bool is_var(const std::string & name) const                   override;
         comm_var_t get_var(const std::string & name) const            override;
+        var_handle_t get_handle(const std::string & name) const       override;
+        comm_var_t get_var(const var_handle_t & handle) const         override;
         int get_var_int(const std::string & name) const               override;
         float get_var_float(const std::string & name) const           override;
         double get_var_double(const std::string & name) const         override;
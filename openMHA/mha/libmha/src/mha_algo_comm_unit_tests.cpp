@@ -118,6 +118,102 @@ TEST(comm_var_map_t, retrieve_get_entries_size)
 }
 
 
+TEST(comm_var_map_t, handles_survive_other_inserts_and_erases)
+{
+  MHA_AC::comm_var_map_t s;
+  int i1 = 1, i2 = 2, i3 = 3;
+  MHA_AC::comm_var_t v1 = {MHA_AC_INT, 1, 1, &i1}, v2 = {MHA_AC_INT, 1, 1, &i2};
+  EXPECT_THROW(s.get_handle("key1"s), MHA_Error);
+  s.insert("key1"s,v1);
+  s.insert("key2"s,v2);
+  const MHA_AC::var_handle_t h1 = s.get_handle("key1"s);
+  const MHA_AC::var_handle_t h2 = s.get_handle("key2"s);
+  EXPECT_TRUE(h1.is_resolved());
+  EXPECT_EQ("key1"s, h1.name);
+  EXPECT_EQ(&i1, s.retrieve(h1).data);
+  EXPECT_EQ(&i2, s.retrieve(h2).data);
+
+  // Replacing a variable is visible through its handle
+  v2.data = &i3;
+  s.insert("key2"s,v2);
+  EXPECT_EQ(&i3, s.retrieve(h2).data);
+
+  // Inserting many variables grows the table, handles stay valid
+  for (unsigned k = 0; k < 100; ++k)
+    s.insert("many"s + std::to_string(k), v1);
+  EXPECT_EQ(&i1, s.retrieve(h1).data);
+  EXPECT_EQ(&i3, s.retrieve(h2).data);
+
+  // Erasing other variables does not affect the handles
+  s.erase_by_name("many50"s);
+  EXPECT_EQ(&i3, s.retrieve(h2).data);
+
+  // A handle of an erased variable is detected, even if its slot is reused
+  s.erase_by_name("key1"s);
+  EXPECT_THROW(s.retrieve(h1), MHA_Error);
+  s.insert("key3"s,v1);
+  EXPECT_THROW(s.retrieve(h1), MHA_Error);
+  s.insert("key1"s,v1);
+  EXPECT_THROW(s.retrieve(h1), MHA_Error);
+  EXPECT_EQ(&i1, s.retrieve(s.get_handle("key1"s)).data);
+
+  // Unresolved handles are rejected
+  EXPECT_THROW(s.retrieve(MHA_AC::var_handle_t()), MHA_Error);
+}
+
+TEST(algo_comm_class_t, get_var_by_handle)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  MHA_AC::algo_comm_t & ac = acspace;
+  int i = 42;
+  float f = 0.5f;
+  mha_complex_t c[6] = {{1,2},{3,4},{5,6},{7,8},{9,10},{11,12}};
+  mha_real_t w[6] = {1,2,3,4,5,6};
+  acspace.insert_var_int("int", &i);
+  acspace.insert_var_float("float", &f);
+  acspace.insert_var("spec", {MHA_AC_MHACOMPLEX, 6, 3, c});
+  acspace.insert_var("wave", {MHA_AC_MHAREAL, 6, 2, w});
+  const MHA_AC::var_handle_t hi = ac.get_handle("int");
+  const MHA_AC::var_handle_t hf = ac.get_handle("float");
+  const MHA_AC::var_handle_t hs = ac.get_handle("spec");
+  const MHA_AC::var_handle_t hw = ac.get_handle("wave");
+  EXPECT_THROW(ac.get_handle("missing"), MHA_Error);
+  acspace.set_prepared(true);
+
+  EXPECT_EQ(42, MHA_AC::get_var_int(ac, hi));
+  EXPECT_EQ(0.5f, MHA_AC::get_var_float(ac, hf));
+  EXPECT_THROW(MHA_AC::get_var_int(ac, hf), MHA_Error);
+  EXPECT_THROW(MHA_AC::get_var_float(ac, hi), MHA_Error);
+  EXPECT_EQ(&i, ac.get_var(hi).data);
+
+  mha_spec_t spec = MHA_AC::get_var_spectrum(ac, hs);
+  EXPECT_EQ(3U, spec.num_frames);
+  EXPECT_EQ(2U, spec.num_channels);
+  EXPECT_EQ(c, spec.buf);
+  EXPECT_THROW(MHA_AC::get_var_spectrum(ac, hw), MHA_Error);
+
+  mha_wave_t wave = MHA_AC::get_var_waveform(ac, hw);
+  EXPECT_EQ(3U, wave.num_frames);
+  EXPECT_EQ(2U, wave.num_channels);
+  EXPECT_EQ(w, wave.buf);
+  EXPECT_THROW(MHA_AC::get_var_waveform(ac, hs), MHA_Error);
+
+  EXPECT_EQ(std::vector<float>({1,2,3,4,5,6}), MHA_AC::get_var_vfloat(ac, hw));
+  EXPECT_EQ(std::vector<float>({0.5f}), MHA_AC::get_var_vfloat(ac, hf));
+  EXPECT_THROW(MHA_AC::get_var_vfloat(ac, hs), MHA_Error);
+
+  // Name-based and handle-based access see the same replacement
+  i = 7;
+  int j = 8;
+  acspace.insert_var_int("int", &j);
+  EXPECT_EQ(8, MHA_AC::get_var_int(ac, hi));
+  EXPECT_EQ(8, MHA_AC::get_var_int(ac, "int"));
+
+  acspace.set_prepared(false);
+  acspace.remove_var("int");
+  EXPECT_THROW(MHA_AC::get_var_int(ac, hi), MHA_Error);
+}
+
 TEST(algo_comm_class_t, insert_var_remove_var)
 {
   MHA_AC::algo_comm_class_t acspace;
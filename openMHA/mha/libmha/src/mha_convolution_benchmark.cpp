@@ -0,0 +1,201 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file mha_convolution_benchmark.cpp
+ * Compares uniform (MHAFilter::partitioned_convolution_t) and
+ * non-uniform (MHAFilter::nonuniform_partitioned_convolution_t)
+ * partitioned convolution of two channels with impulse responses of
+ * 0.5 s, 2 s, and 5 s at 48 kHz.  The audio blocks are processed in
+ * real time, i.e. the benchmark sleeps until the next block is due,
+ * so that the worker threads of the non-uniform convolution have the
+ * same time budget as in a real audio system.  Reported are the
+ * processing time of the signal processing thread per block, the
+ * total processor time of the process relative to the signal
+ * duration, and how often the signal processing thread had to wait
+ * for a worker thread.  In a second measurement, the two processing
+ * schemes of partitioned_convolution_t are compared for full 8x8
+ * transfer matrices without real-time pacing.  The FFT backend can be
+ * selected with the environment variable MHA_FFT_BACKEND, and the
+ * instruction set with MHA_SIMD.
+ *
+ * Usage: mha_convolution_benchmark [fragsize [seconds_per_measurement]]
+ */
+
+#include "mha_filter.hh"
+#include "mha_latency_histogram.hh"
+#include "mha_simd.hh"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+
+namespace {
+    constexpr double srate = 48000.0;
+
+    /** Diagonal 2x2 transfer matrix with exponentially decaying noise */
+    MHAFilter::transfer_matrix_t room(unsigned ir_length)
+    {
+        MHAFilter::transfer_matrix_t transfer;
+        unsigned seed = 1U;
+        for (unsigned ch = 0; ch < 2U; ++ch) {
+            std::vector<float> ir(ir_length);
+            for (unsigned k = 0; k < ir_length; ++k) {
+                seed = seed * 1103515245U + 12345U;
+                ir[k] = ((seed >> 16) % 2001U - 1000.0f) * 1e-3f
+                    * std::exp(-3.0f * k / ir_length);
+            }
+            transfer.push_back(MHAFilter::transfer_function_t(ch, ch, ir));
+        }
+        return transfer;
+    }
+
+    /** Full transfer matrix of channels x channels decaying noise
+     * impulse responses */
+    MHAFilter::transfer_matrix_t mimo(unsigned channels, unsigned ir_length)
+    {
+        MHAFilter::transfer_matrix_t transfer;
+        unsigned seed = 1U;
+        for (unsigned src = 0; src < channels; ++src)
+            for (unsigned tgt = 0; tgt < channels; ++tgt) {
+                std::vector<float> ir(ir_length);
+                for (unsigned k = 0; k < ir_length; ++k) {
+                    seed = seed * 1103515245U + 12345U;
+                    ir[k] = ((seed >> 16) % 2001U - 1000.0f) * 1e-3f
+                        * std::exp(-3.0f * k / ir_length);
+                }
+                transfer.push_back(MHAFilter::transfer_function_t(src, tgt,
+                                                                  ir));
+            }
+        return transfer;
+    }
+
+    /** Mean processing time per block in ns without pacing */
+    double time_per_block(MHAFilter::partitioned_convolution_t & conv,
+                          unsigned channels, double seconds)
+    {
+        MHASignal::waveform_t in(conv.fragsize, channels);
+        for (unsigned k = 0; k < in.num_frames * in.num_channels; ++k)
+            in.buf[k] = std::sin(0.1 * k);
+        for (unsigned k = 0; k < 100; ++k)
+            conv.process(&in);
+        unsigned long blocks = 0;
+        const uint64_t start = MHAProfiling::now_ns();
+        uint64_t elapsed = 0;
+        do {
+            for (unsigned k = 0; k < 16; ++k)
+                conv.process(&in);
+            blocks += 16;
+            elapsed = MHAProfiling::now_ns() - start;
+        } while (elapsed < seconds * 1e9);
+        return double(elapsed) / blocks;
+    }
+
+    /** Process real-time paced blocks and print the statistics.
+     * \param process Processes one block, returns the number of waits
+     *   for worker threads so far. */
+    template <class F>
+    void measure(const char * name, unsigned ir_length, unsigned fragsize,
+                 double seconds, F process)
+    {
+        MHASignal::waveform_t in(fragsize, 2U);
+        for (unsigned k = 0; k < in.num_frames * in.num_channels; ++k)
+            in.buf[k] = std::sin(0.1 * k);
+        const unsigned blocks = seconds * srate / fragsize;
+        const auto period = std::chrono::nanoseconds
+            (uint64_t(1e9 * fragsize / srate));
+        MHAProfiling::latency_histogram_t hist;
+        hist.set_deadline(period.count());
+        const std::clock_t cpu_start = std::clock();
+        auto next = std::chrono::steady_clock::now();
+        unsigned long long waits = 0U;
+        for (unsigned block = 0; block < blocks; ++block) {
+            std::this_thread::sleep_until(next);
+            next += period;
+            const uint64_t t = MHAProfiling::now_ns();
+            waits = process(in);
+            hist.add(MHAProfiling::now_ns() - t);
+        }
+        const double cpu = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        printf("%6.1f s %-11s %8.1f %8.1f %8.1f %7.1f%% %8llu %8llu\n",
+               ir_length / srate, name,
+               hist.get_percentile(50) * 1e-3,
+               hist.get_percentile(99) * 1e-3,
+               hist.get_max() * 1e-3,
+               100.0 * cpu / (blocks * fragsize / srate),
+               (unsigned long long)hist.get_overruns(), waits);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const unsigned fragsize = argc > 1 ? atoi(argv[1]) : 64U;
+    const double seconds = argc > 2 ? atof(argv[2]) : 5.0;
+    printf("partitioned convolution, 2 channels, fragsize %u, 48 kHz,"
+           " processing time per block in us\n", fragsize);
+    printf("%8s %-11s %8s %8s %8s %8s %8s %8s\n", "IR", "engine",
+           "median", "p99", "max", "CPU", "overruns", "waits");
+    for (double ir_seconds : {0.5, 2.0, 5.0}) {
+        const unsigned ir_length = ir_seconds * srate;
+        const auto transfer = room(ir_length);
+        {
+            MHAFilter::partitioned_convolution_t uniform(fragsize, 2, 2,
+                                                         transfer);
+            measure("uniform", ir_length, fragsize, seconds,
+                    [&](const mha_wave_t & in) {
+                        uniform.process(&in);
+                        return 0ULL;
+                    });
+        }
+        {
+            MHAFilter::nonuniform_partitioned_convolution_t
+                nonuniform(fragsize, 2, 2, transfer, 16384);
+            measure("non-uniform", ir_length, fragsize, seconds,
+                    [&](const mha_wave_t & in) {
+                        nonuniform.process(&in);
+                        return nonuniform.get_num_waits();
+                    });
+        }
+    }
+    printf("\npartitioned_convolution_t, 8x8 transfer matrix, fragsize %u,"
+           " %s, us per block\n", fragsize,
+           MHASignal::simd_level_name(MHASignal::simd_level()).c_str());
+    printf("%8s %14s %14s %8s\n", "IR", "output delay", "freq. delay",
+           "speedup");
+    for (unsigned ir_length : {1024U, 4096U, 16384U}) {
+        const auto transfer = mimo(8U, ir_length);
+        double t[2];
+        unsigned i = 0;
+        for (auto engine : {MHAFilter::partitioned_convolution_engine_t::
+                            OUTPUT_DELAY_LINE,
+                            MHAFilter::partitioned_convolution_engine_t::
+                            FREQUENCY_DOMAIN_DELAY_LINE}) {
+            MHAFilter::partitioned_convolution_t conv(fragsize, 8, 8,
+                                                      transfer, engine);
+            t[i++] = time_per_block(conv, 8U, seconds / 5);
+        }
+        printf("%8u %14.1f %14.1f %7.2fx\n", ir_length, t[0] * 1e-3,
+               t[1] * 1e-3, t[0] / t[1]);
+    }
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,508 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_fft_backend.hh"
+#include "mha_signal.hh"
+#include "mha_error.hh"
+#include "mha_os.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <vector>
+
+#include "sfftw.h"
+#include "srfftw.h"
+
+void MHASignal::fft_backend_t::real2complex_multi(const mha_real_t* in,
+                                                  mha_complex_t* out,
+                                                  unsigned channels,
+                                                  unsigned out_dist)
+{
+    for (unsigned ch = 0; ch < channels; ++ch) {
+        for (unsigned k = 0; k < nfft; ++k)
+            multi_in[k] = in[k * channels + ch];
+        real2complex(multi_in.data(), out + ch * out_dist);
+    }
+}
+
+void MHASignal::fft_backend_t::complex2real_multi(const mha_complex_t* in,
+                                                  unsigned in_dist,
+                                                  mha_real_t* out,
+                                                  unsigned channels)
+{
+    for (unsigned ch = 0; ch < channels; ++ch) {
+        complex2real(in + ch * in_dist, multi_out.data());
+        for (unsigned k = 0; k < nfft; ++k)
+            out[k * channels + ch] = multi_out[k];
+    }
+}
+
+namespace {
+
+    /** FFTW2 implementation.  This is the FFT which has been used by
+        the \mha since the beginning. */
+    class fft_fftw2_t : public MHASignal::fft_backend_t {
+    public:
+        explicit fft_fftw2_t(unsigned nfft);
+        ~fft_fftw2_t();
+        void real2complex(const mha_real_t* in, mha_complex_t* out) override;
+        void complex2real(const mha_complex_t* in, mha_real_t* out) override;
+        void complex2complex(const mha_complex_t* in, mha_complex_t* out,
+                             bool forward) override;
+        void prepare_multi(unsigned channels) override;
+        void real2complex_multi(const mha_real_t* in, mha_complex_t* out,
+                                unsigned channels, unsigned out_dist) override;
+        void complex2real_multi(const mha_complex_t* in, unsigned in_dist,
+                                mha_real_t* out, unsigned channels) override;
+        MHASignal::fft_backend_id_t get_id() const override
+        {return MHASignal::fft_backend_id_t::FFTW2;}
+    private:
+        /** Convert one half-complex FFTW2 spectrum to nfft/2+1 bins. */
+        void halfcomplex2spec(const fftw_real* hc, mha_complex_t* out) const;
+        /** Convert nfft/2+1 bins to one half-complex FFTW2 spectrum. */
+        void spec2halfcomplex(const mha_complex_t* in, fftw_real* hc) const;
+        rfftw_plan plan_real2complex;
+        rfftw_plan plan_complex2real;
+        fftw_plan plan_forward;
+        fftw_plan plan_backward;
+        /// Half-complex buffers [r0 r1 r2 ... rn/2 in/2-1 ... i1]
+        std::vector<fftw_real> buf_in, buf_out;
+        /// Copy of the input for in-place complex transforms
+        std::vector<fftw_complex> buf_complex;
+        /// Half-complex spectra of all channels of batched transforms
+        std::vector<fftw_real> buf_multi;
+        /// Number of channels prepared for batched transforms
+        unsigned multi_channels = 0U;
+    };
+
+    fft_fftw2_t::fft_fftw2_t(unsigned nfft)
+        : MHASignal::fft_backend_t(nfft),
+          buf_in(nfft), buf_out(nfft), buf_complex(nfft)
+    {
+        static_assert(sizeof(mha_real_t) == sizeof(fftw_real),
+                      "MHA and FFTW use different precision");
+        static_assert(sizeof(mha_complex_t) == sizeof(fftw_complex),
+                      "MHA and FFTW use different complex layout");
+        plan_real2complex =
+            rfftw_create_plan(nfft, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE);
+        plan_complex2real =
+            rfftw_create_plan(nfft, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE);
+        plan_forward = fftw_create_plan(nfft, FFTW_FORWARD, FFTW_ESTIMATE);
+        plan_backward = fftw_create_plan(nfft, FFTW_BACKWARD, FFTW_ESTIMATE);
+    }
+
+    fft_fftw2_t::~fft_fftw2_t()
+    {
+        rfftw_destroy_plan(plan_real2complex);
+        rfftw_destroy_plan(plan_complex2real);
+        fftw_destroy_plan(plan_forward);
+        fftw_destroy_plan(plan_backward);
+    }
+
+    void fft_fftw2_t::halfcomplex2spec(const fftw_real* hc,
+                                       mha_complex_t* out) const
+    {
+        const unsigned n_re = nfft / 2U + 1U;
+        for (unsigned k = 0; k < n_re; ++k)
+            out[k].re = hc[k];
+        out[0].im = 0;
+        for (unsigned k = 1; k < (nfft + 1U) / 2U; ++k)
+            out[k].im = hc[nfft - k];
+        if ((nfft & 1U) == 0U)
+            out[nfft / 2U].im = 0;
+    }
+
+    void fft_fftw2_t::spec2halfcomplex(const mha_complex_t* in,
+                                       fftw_real* hc) const
+    {
+        const unsigned n_re = nfft / 2U + 1U;
+        for (unsigned k = 0; k < n_re; ++k)
+            hc[k] = in[k].re;
+        for (unsigned k = 1; k < (nfft + 1U) / 2U; ++k)
+            hc[nfft - k] = in[k].im;
+    }
+
+    void fft_fftw2_t::real2complex(const mha_real_t* in, mha_complex_t* out)
+    {
+        std::copy(in, in + nfft, buf_in.begin());
+        rfftw_one(plan_real2complex, buf_in.data(), buf_out.data());
+        halfcomplex2spec(buf_out.data(), out);
+    }
+
+    void fft_fftw2_t::complex2real(const mha_complex_t* in, mha_real_t* out)
+    {
+        spec2halfcomplex(in, buf_in.data());
+        rfftw_one(plan_complex2real, buf_in.data(), out);
+    }
+
+    void fft_fftw2_t::prepare_multi(unsigned channels)
+    {
+        buf_multi.resize(std::max<size_t>(buf_multi.size(),
+                                          size_t(nfft) * channels));
+        multi_channels = std::max(multi_channels, channels);
+    }
+
+    void fft_fftw2_t::real2complex_multi(const mha_real_t* in,
+                                         mha_complex_t* out,
+                                         unsigned channels, unsigned out_dist)
+    {
+        if (channels > multi_channels) {
+            fft_backend_t::real2complex_multi(in, out, channels, out_dist);
+            return;
+        }
+        // One call for all channels: FFTW2 reads the interleaved input
+        // with stride, real-to-complex transforms preserve their input.
+        rfftw(plan_real2complex, channels,
+              const_cast<fftw_real*>(in), channels, 1,
+              buf_multi.data(), 1, nfft);
+        for (unsigned ch = 0; ch < channels; ++ch)
+            halfcomplex2spec(buf_multi.data() + ch * nfft, out + ch * out_dist);
+    }
+
+    void fft_fftw2_t::complex2real_multi(const mha_complex_t* in,
+                                         unsigned in_dist,
+                                         mha_real_t* out, unsigned channels)
+    {
+        if (channels > multi_channels) {
+            fft_backend_t::complex2real_multi(in, in_dist, out, channels);
+            return;
+        }
+        for (unsigned ch = 0; ch < channels; ++ch)
+            spec2halfcomplex(in + ch * in_dist, buf_multi.data() + ch * nfft);
+        // FFTW2 writes the interleaved output with stride
+        rfftw(plan_complex2real, channels,
+              buf_multi.data(), 1, nfft,
+              out, channels, 1);
+    }
+
+    void fft_fftw2_t::complex2complex(const mha_complex_t* in,
+                                      mha_complex_t* out, bool forward)
+    {
+        fftw_complex * src = buf_complex.data();
+        if (in != out)
+            src = reinterpret_cast<fftw_complex*>(const_cast<mha_complex_t*>(in));
+        else
+            memcpy(src, in, nfft * sizeof(fftw_complex));
+        fftw_one(forward ? plan_forward : plan_backward,
+                 src, reinterpret_cast<fftw_complex*>(out));
+    }
+
+    /** Unscaled complex FFT of arbitrary length without external
+        dependencies.  Lengths that are powers of two are transformed
+        with an iterative radix-2 algorithm, all other lengths with
+        Bluestein's chirp-z algorithm on top of a radix-2 FFT of at
+        least twice the length. */
+    class builtin_cfft_t {
+    public:
+        explicit builtin_cfft_t(unsigned n);
+        /** Transform n complex values, in may be equal to out. */
+        void transform(const mha_complex_t* in, mha_complex_t* out,
+                       bool forward);
+    private:
+        /** In-place radix-2 transform of m values. */
+        void radix2(mha_complex_t* x, bool forward) const;
+        /** Transform length */
+        unsigned n;
+        /** Length of the radix-2 transform, n if n is a power of two. */
+        unsigned m;
+        /** Bit-reversed index permutation of the radix-2 transform. */
+        std::vector<unsigned> bitrev;
+        /** exp(-2*pi*j*k/m) for k < m/2 */
+        std::vector<mha_complex_t> twiddle;
+        /** Bluestein chirp exp(-pi*j*k^2/n) for k < n, empty if m==n */
+        std::vector<mha_complex_t> chirp;
+        /** Spectrum of the conjugate chirp filter, scaled with 1/m */
+        std::vector<mha_complex_t> chirp_filter;
+        /** Bluestein work buffer of m values */
+        std::vector<mha_complex_t> work;
+    };
+
+    builtin_cfft_t::builtin_cfft_t(unsigned n_)
+        : n(n_), m(1)
+    {
+        while (m < n)
+            m <<= 1U;
+        if (m != n) {
+            // Bluestein: linear convolution of length 2n-1 must fit
+            while (m < 2U * n - 1U)
+                m <<= 1U;
+        }
+        unsigned log2m = 0;
+        while ((1U << log2m) < m)
+            ++log2m;
+        bitrev.resize(m);
+        for (unsigned k = 0; k < m; ++k) {
+            unsigned r = 0;
+            for (unsigned b = 0; b < log2m; ++b)
+                if (k & (1U << b))
+                    r |= 1U << (log2m - 1U - b);
+            bitrev[k] = r;
+        }
+        twiddle.resize(m / 2U);
+        for (unsigned k = 0; k < m / 2U; ++k) {
+            const double phase = -2.0 * M_PI * k / m;
+            twiddle[k].re = cos(phase);
+            twiddle[k].im = sin(phase);
+        }
+        if (m != n) {
+            chirp.resize(n);
+            for (unsigned k = 0; k < n; ++k) {
+                // k^2 mod 2n keeps the phase argument small and exact
+                const unsigned long long k2 =
+                    (unsigned long long)k * k % (2ULL * n);
+                const double phase = -M_PI * k2 / n;
+                chirp[k].re = cos(phase);
+                chirp[k].im = sin(phase);
+            }
+            chirp_filter.assign(m, mha_complex_t{0, 0});
+            chirp_filter[0] = _conjugate(chirp[0]);
+            for (unsigned k = 1; k < n; ++k)
+                chirp_filter[k] = chirp_filter[m - k] = _conjugate(chirp[k]);
+            radix2(chirp_filter.data(), true);
+            for (mha_complex_t & c : chirp_filter)
+                c *= 1.0f / m;
+            work.resize(m);
+        }
+    }
+
+    void builtin_cfft_t::radix2(mha_complex_t* x, bool forward) const
+    {
+        for (unsigned k = 0; k < m; ++k)
+            if (k < bitrev[k])
+                std::swap(x[k], x[bitrev[k]]);
+        // first stage needs no multiplications
+        for (unsigned k = 0; k + 1U < m; k += 2U) {
+            const mha_complex_t u = x[k];
+            x[k] += x[k+1];
+            x[k+1] = u - x[k+1];
+        }
+        for (unsigned len = 4; len <= m; len <<= 1U) {
+            const unsigned half = len / 2U;
+            const unsigned step = m / len;
+            for (unsigned i = 0; i < m; i += len) {
+                mha_complex_t * a = x + i;
+                mha_complex_t * b = a + half;
+                for (unsigned j = 0; j < half; ++j) {
+                    const mha_complex_t & w = twiddle[j * step];
+                    const mha_real_t wim = forward ? w.im : -w.im;
+                    const mha_real_t vre = b[j].re * w.re - b[j].im * wim;
+                    const mha_real_t vim = b[j].re * wim + b[j].im * w.re;
+                    b[j].re = a[j].re - vre;
+                    b[j].im = a[j].im - vim;
+                    a[j].re += vre;
+                    a[j].im += vim;
+                }
+            }
+        }
+    }
+
+    void builtin_cfft_t::transform(const mha_complex_t* in, mha_complex_t* out,
+                                   bool forward)
+    {
+        if (m == n) {
+            if (in != out)
+                std::copy(in, in + n, out);
+            radix2(out, forward);
+            return;
+        }
+        // Bluestein. The backward transform uses
+        // ifft(x) = conj(fft(conj(x))).
+        for (unsigned k = 0; k < n; ++k)
+            work[k] = (forward ? in[k] : _conjugate(in[k])) * chirp[k];
+        std::fill(work.begin() + n, work.end(), mha_complex_t{0, 0});
+        radix2(work.data(), true);
+        for (unsigned k = 0; k < m; ++k)
+            work[k] *= chirp_filter[k];
+        radix2(work.data(), false);
+        for (unsigned k = 0; k < n; ++k) {
+            out[k] = work[k] * chirp[k];
+            if (!forward)
+                conjugate(out[k]);
+        }
+    }
+
+    /** Built-in implementation of all transforms.  Real transforms of
+        even length are computed as complex transforms of half length. */
+    class fft_builtin_t : public MHASignal::fft_backend_t {
+    public:
+        explicit fft_builtin_t(unsigned nfft);
+        void real2complex(const mha_real_t* in, mha_complex_t* out) override;
+        void complex2real(const mha_complex_t* in, mha_real_t* out) override;
+        void complex2complex(const mha_complex_t* in, mha_complex_t* out,
+                             bool forward) override
+        {full.transform(in, out, forward);}
+        MHASignal::fft_backend_id_t get_id() const override
+        {return MHASignal::fft_backend_id_t::BUILTIN;}
+    private:
+        /** True if real transforms use the half-length complex FFT. */
+        const bool even;
+        /** Complex FFT of length nfft. */
+        builtin_cfft_t full;
+        /** Complex FFT of length nfft/2 for real transforms of even length. */
+        builtin_cfft_t half;
+        /** exp(-2*pi*j*k/nfft) for k <= nfft/2 */
+        std::vector<mha_complex_t> split_twiddle;
+        std::vector<mha_complex_t> buf_a, buf_b;
+    };
+
+    fft_builtin_t::fft_builtin_t(unsigned nfft)
+        : MHASignal::fft_backend_t(nfft),
+          even((nfft & 1U) == 0U),
+          full(nfft),
+          half(even ? nfft / 2U : 1U),
+          split_twiddle(nfft / 2U + 1U),
+          buf_a(nfft), buf_b(nfft)
+    {
+        for (unsigned k = 0; k < split_twiddle.size(); ++k) {
+            const double phase = -2.0 * M_PI * k / nfft;
+            split_twiddle[k].re = cos(phase);
+            split_twiddle[k].im = sin(phase);
+        }
+    }
+
+    void fft_builtin_t::real2complex(const mha_real_t* in, mha_complex_t* out)
+    {
+        if (!even) {
+            for (unsigned k = 0; k < nfft; ++k)
+                buf_a[k] = mha_complex_t{in[k], 0};
+            full.transform(buf_a.data(), buf_b.data(), true);
+            std::copy(buf_b.begin(), buf_b.begin() + nfft / 2U + 1U, out);
+            out[0].im = 0;
+            return;
+        }
+        // Even and odd samples are real and imaginary parts of a
+        // complex signal of half length.  Separate their spectra E and O
+        // and combine X[k] = E[k] + exp(-2*pi*j*k/nfft) * O[k].
+        const unsigned h = nfft / 2U;
+        memcpy(buf_a.data(), in, nfft * sizeof(mha_real_t));
+        half.transform(buf_a.data(), buf_b.data(), true);
+        for (unsigned k = 0; k <= h; ++k) {
+            const mha_complex_t & z = buf_b[k % h];
+            const mha_complex_t zc = _conjugate(buf_b[(h - k) % h]);
+            const mha_complex_t e = {0.5f * (z.re + zc.re), 0.5f * (z.im + zc.im)};
+            // o = (z - zc) / 2j
+            const mha_complex_t o = {0.5f * (z.im - zc.im), -0.5f * (z.re - zc.re)};
+            out[k] = e + split_twiddle[k] * o;
+        }
+        out[0].im = 0;
+        out[h].im = 0;
+    }
+
+    void fft_builtin_t::complex2real(const mha_complex_t* in, mha_real_t* out)
+    {
+        if (!even) {
+            buf_a[0] = mha_complex_t{in[0].re, 0};
+            for (unsigned k = 1; k <= nfft / 2U; ++k) {
+                buf_a[k] = in[k];
+                buf_a[nfft - k] = _conjugate(in[k]);
+            }
+            full.transform(buf_a.data(), buf_b.data(), false);
+            for (unsigned k = 0; k < nfft; ++k)
+                out[k] = buf_b[k].re;
+            return;
+        }
+        // Inverse of the split in real2complex: Z[k] = 2E[k] + 2j*O[k]
+        const unsigned h = nfft / 2U;
+        for (unsigned k = 0; k < h; ++k) {
+            mha_complex_t a = in[k];
+            mha_complex_t b = _conjugate(in[h - k]);
+            if (k == 0U) {
+                a.im = 0;
+                b.im = 0;
+            }
+            const mha_complex_t e = a + b;
+            const mha_complex_t o = (a - b) * _conjugate(split_twiddle[k]);
+            buf_a[k] = mha_complex_t{e.re - o.im, e.im + o.re};
+        }
+        half.transform(buf_a.data(), buf_b.data(), false);
+        memcpy(out, buf_b.data(), nfft * sizeof(mha_real_t));
+    }
+}
+
+std::unique_ptr<MHASignal::fft_backend_t>
+MHASignal::fft_backend_new(fft_backend_id_t id, unsigned nfft)
+{
+    if (nfft < 2U)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "fft length is too small (%u < 2)", nfft);
+    switch (id) {
+    case fft_backend_id_t::FFTW2:
+        return std::make_unique<fft_fftw2_t>(nfft);
+    case fft_backend_id_t::FFTW3:
+#ifdef MHA_WITH_FFTW3
+        return fft_fftw3_new(nfft);
+#else
+        throw MHA_ErrorMsg("FFT backend \"fftw3\" is not available:"
+                           " libopenmha was compiled without FFTW3 support");
+#endif
+    case fft_backend_id_t::BUILTIN:
+        return std::make_unique<fft_builtin_t>(nfft);
+    }
+    throw MHA_Error(__FILE__,__LINE__,"Unknown FFT backend %d", int(id));
+}
+
+bool MHASignal::fft_backend_available(fft_backend_id_t id)
+{
+#ifndef MHA_WITH_FFTW3
+    if (id == fft_backend_id_t::FFTW3)
+        return false;
+#endif
+    return id == fft_backend_id_t::FFTW2 ||
+        id == fft_backend_id_t::FFTW3 ||
+        id == fft_backend_id_t::BUILTIN;
+}
+
+std::string MHASignal::fft_backend_name(fft_backend_id_t id)
+{
+    switch (id) {
+    case fft_backend_id_t::FFTW2: return "fftw2";
+    case fft_backend_id_t::FFTW3: return "fftw3";
+    case fft_backend_id_t::BUILTIN: return "builtin";
+    }
+    return "unknown";
+}
+
+MHASignal::fft_backend_id_t
+MHASignal::fft_backend_from_name(const std::string & name)
+{
+    for (fft_backend_id_t id : {fft_backend_id_t::FFTW2,
+                                fft_backend_id_t::FFTW3,
+                                fft_backend_id_t::BUILTIN})
+        if (name == fft_backend_name(id))
+            return id;
+    throw MHA_Error(__FILE__,__LINE__,
+                    "Unknown FFT backend \"%s\" (valid: fftw2, fftw3, builtin)",
+                    name.c_str());
+}
+
+MHASignal::fft_backend_id_t MHASignal::fft_backend_default()
+{
+    static const fft_backend_id_t id = []() {
+        const std::string name = mha_getenv("MHA_FFT_BACKEND");
+        if (name.size())
+            return fft_backend_from_name(name);
+        if (fft_backend_available(fft_backend_id_t::FFTW3))
+            return fft_backend_id_t::FFTW3;
+        return fft_backend_id_t::FFTW2;
+    }();
+    return id;
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,168 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_FFT_BACKEND_HH
+#define MHA_FFT_BACKEND_HH
+
+#include "mha.hh"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MHASignal {
+
+    /**
+       \ingroup mhafft
+       \brief Identifiers of the FFT implementations that can be used
+       behind the mha_fft_t API.
+
+       The backend used by mha_fft_new() is selected with the
+       environment variable MHA_FFT_BACKEND, which may be set to
+       "fftw2", "fftw3" or "builtin".  If the variable is not set, then
+       FFTW3 is used when libopenmha was compiled with FFTW3 support
+       (configure option --with-fftw3), and FFTW2 otherwise.
+    */
+    enum class fft_backend_id_t {
+        /** FFTW 2.1.5, statically linked into libopenmha. */
+        FFTW2,
+        /** FFTW 3 (single precision), uses the SIMD codelets of the
+            installed library and can persist wisdom across runs. */
+        FFTW3,
+        /** Portable FFT without external dependencies: Radix-2 for
+            powers of two, Bluestein's algorithm for other lengths. */
+        BUILTIN
+    };
+
+    /**
+       \ingroup mhafft
+       \brief Interface of a single FFT implementation of fixed length.
+
+       All transforms are unscaled: A forward transform followed by a
+       backward transform multiplies the signal with the FFT length.
+       Complex spectra of real signals are exchanged as nfft/2+1
+       mha_complex_t values (DC to Nyquist), which is the memory layout
+       of one channel of an mha_spec_t.  The imaginary parts of the DC
+       bin and, for even FFT lengths, of the Nyquist bin are ignored by
+       complex2real and set to zero by real2complex.
+
+       Instances are not thread safe: Each thread needs its own object.
+    */
+    class fft_backend_t {
+    public:
+        virtual ~fft_backend_t() = default;
+        /** Real-to-complex forward transform.
+            \param in  nfft real input samples.
+            \param out nfft/2+1 complex output bins. */
+        virtual void real2complex(const mha_real_t* in, mha_complex_t* out) = 0;
+        /** Complex-to-real backward transform.
+            \param in  nfft/2+1 complex input bins of a hermitian spectrum.
+            \param out nfft real output samples. */
+        virtual void complex2real(const mha_complex_t* in, mha_real_t* out) = 0;
+        /** Complex-to-complex transform.
+            \param in      nfft complex input values.
+            \param out     nfft complex output values, may be equal to in.
+            \param forward Transform direction: true for exp(-j...)
+                           (forward), false for exp(+j...) (backward). */
+        virtual void complex2complex(const mha_complex_t* in, mha_complex_t* out,
+                                     bool forward) = 0;
+        /** Prepare batched transforms of the given number of channels.
+            May allocate memory and create plans, therefore this has to
+            be called outside of the signal processing.  The batched
+            transforms also work for other channel counts, but then
+            they may fall back to transforming one channel at a time.
+            \param channels Number of channels of the batched transforms. */
+        virtual void prepare_multi(unsigned channels) {(void)channels;}
+        /** Batched real-to-complex forward transform of all channels
+            of a waveform block.
+            \param in       nfft frames of interleaved real input samples
+                            (mha_wave_t layout).
+            \param out      Output spectra, nfft/2+1 bins per channel, the
+                            spectrum of channel ch starts at out+ch*out_dist
+                            (mha_spec_t layout).
+            \param channels Number of channels.
+            \param out_dist Distance between channels in out, at least
+                            nfft/2+1. */
+        virtual void real2complex_multi(const mha_real_t* in,
+                                        mha_complex_t* out,
+                                        unsigned channels, unsigned out_dist);
+        /** Batched complex-to-real backward transform of all channels
+            of a spectrum.
+            \param in       Input spectra, channel ch starts at in+ch*in_dist.
+            \param in_dist  Distance between channels in in, at least
+                            nfft/2+1.
+            \param out      nfft frames of interleaved real output samples.
+            \param channels Number of channels. */
+        virtual void complex2real_multi(const mha_complex_t* in,
+                                        unsigned in_dist,
+                                        mha_real_t* out, unsigned channels);
+        /** FFT length of this instance. */
+        unsigned get_nfft() const {return nfft;}
+        /** Identifier of the implementation. */
+        virtual fft_backend_id_t get_id() const = 0;
+    protected:
+        explicit fft_backend_t(unsigned nfft_)
+            : nfft(nfft_), multi_in(nfft_), multi_out(nfft_) {}
+        /** FFT length */
+        const unsigned nfft;
+    private:
+        /** Scratch buffers of the default batched transforms, which
+            gather and scatter one channel at a time. */
+        std::vector<mha_real_t> multi_in, multi_out;
+    };
+
+    /** \ingroup mhafft
+        \brief Create a new FFT backend instance.
+        \param id   Which implementation to use.
+        \param nfft FFT length, at least 2.
+        \throw MHA_Error if the implementation is not available in this
+               build or if nfft is too small. */
+    std::unique_ptr<fft_backend_t> fft_backend_new(fft_backend_id_t id,
+                                                   unsigned nfft);
+
+    /** Factory of the FFTW3 backend.  Implemented in mha_fft_fftw3.cpp,
+        which is only compiled with FFTW3 support, because the FFTW2 and
+        FFTW3 headers cannot be included into the same translation unit.
+        Use fft_backend_new instead of calling this function directly. */
+    std::unique_ptr<fft_backend_t> fft_fftw3_new(unsigned nfft);
+
+    /** \ingroup mhafft
+        \brief Backend used for new mha_fft_t objects.  Determined once
+        from the environment variable MHA_FFT_BACKEND. */
+    fft_backend_id_t fft_backend_default();
+
+    /** \ingroup mhafft
+        \brief Checks if the given backend has been compiled into
+        this libopenmha. */
+    bool fft_backend_available(fft_backend_id_t id);
+
+    /** \ingroup mhafft
+        \brief Name of a backend as used in MHA_FFT_BACKEND. */
+    std::string fft_backend_name(fft_backend_id_t id);
+
+    /** \ingroup mhafft
+        \brief Convert a backend name ("fftw2", "fftw3", "builtin") to
+        the backend identifier.
+        \throw MHA_Error for unknown names. */
+    fft_backend_id_t fft_backend_from_name(const std::string & name);
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
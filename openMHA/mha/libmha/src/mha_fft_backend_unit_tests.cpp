@@ -0,0 +1,306 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "mha_fft_backend.hh"
+#include "mha_signal_fft.h"
+#include "mha_signal.hh"
+#include "mha_error.hh"
+#include <cmath>
+#include <vector>
+
+namespace {
+  using MHASignal::fft_backend_id_t;
+
+  /// All backends compiled into this libopenmha
+  std::vector<fft_backend_id_t> available_backends()
+  {
+    std::vector<fft_backend_id_t> backends;
+    for (auto id : {fft_backend_id_t::FFTW2, fft_backend_id_t::FFTW3,
+                    fft_backend_id_t::BUILTIN})
+      if (MHASignal::fft_backend_available(id))
+        backends.push_back(id);
+    return backends;
+  }
+
+  /// Deterministic, non-trivial test signal
+  std::vector<mha_real_t> test_signal(unsigned n)
+  {
+    std::vector<mha_real_t> x(n);
+    for (unsigned k = 0; k < n; ++k)
+      x[k] = sin(0.37 * k * k + 1.0) + 0.25 * cos(2.9 * k);
+    return x;
+  }
+
+  /// Reference DFT computed in double precision
+  std::vector<mha_complex_t> naive_dft(const std::vector<mha_real_t> & x)
+  {
+    const unsigned n = x.size();
+    std::vector<mha_complex_t> X(n / 2 + 1);
+    for (unsigned k = 0; k < X.size(); ++k) {
+      double re = 0, im = 0;
+      for (unsigned t = 0; t < n; ++t) {
+        const double phase = -2.0 * M_PI * ((unsigned long long)k * t % n) / n;
+        re += x[t] * cos(phase);
+        im += x[t] * sin(phase);
+      }
+      X[k].re = re;
+      X[k].im = im;
+    }
+    return X;
+  }
+
+  /// FFT lengths: powers of two, other even lengths, odd lengths
+  const unsigned test_lengths[] = {2, 3, 5, 8, 12, 64, 100, 160, 243, 512, 600};
+}
+
+TEST(fft_backend_t, names_round_trip)
+{
+  for (auto id : {fft_backend_id_t::FFTW2, fft_backend_id_t::FFTW3,
+                  fft_backend_id_t::BUILTIN})
+    EXPECT_EQ(id, MHASignal::fft_backend_from_name
+              (MHASignal::fft_backend_name(id)));
+  EXPECT_THROW(MHASignal::fft_backend_from_name("fftw4"), MHA_Error);
+}
+
+TEST(fft_backend_t, rejects_too_short_fft)
+{
+  for (auto id : available_backends())
+    EXPECT_THROW(MHASignal::fft_backend_new(id, 1U), MHA_Error);
+}
+
+TEST(fft_backend_t, real2complex_matches_dft)
+{
+  for (auto id : available_backends()) {
+    for (unsigned n : test_lengths) {
+      auto fft = MHASignal::fft_backend_new(id, n);
+      const std::vector<mha_real_t> x = test_signal(n);
+      const std::vector<mha_complex_t> expected = naive_dft(x);
+      std::vector<mha_complex_t> actual(n / 2 + 1);
+      fft->real2complex(x.data(), actual.data());
+      const double tolerance = 2e-5 * n;
+      for (unsigned k = 0; k < expected.size(); ++k) {
+        EXPECT_NEAR(expected[k].re, actual[k].re, tolerance)
+          << MHASignal::fft_backend_name(id) << " n=" << n << " k=" << k;
+        EXPECT_NEAR(expected[k].im, actual[k].im, tolerance)
+          << MHASignal::fft_backend_name(id) << " n=" << n << " k=" << k;
+      }
+      // imaginary parts of DC and Nyquist bins are exactly zero
+      EXPECT_EQ(0.0f, actual[0].im);
+      if (n % 2 == 0) {
+        EXPECT_EQ(0.0f, actual[n / 2].im);
+      }
+    }
+  }
+}
+
+TEST(fft_backend_t, complex2real_inverts_real2complex)
+{
+  for (auto id : available_backends()) {
+    for (unsigned n : test_lengths) {
+      auto fft = MHASignal::fft_backend_new(id, n);
+      const std::vector<mha_real_t> x = test_signal(n);
+      std::vector<mha_complex_t> X(n / 2 + 1);
+      std::vector<mha_real_t> y(n);
+      fft->real2complex(x.data(), X.data());
+      // complex2real has to ignore imaginary parts of DC and Nyquist
+      X[0].im = 42;
+      if (n % 2 == 0)
+        X[n / 2].im = -42;
+      fft->complex2real(X.data(), y.data());
+      for (unsigned k = 0; k < n; ++k)
+        EXPECT_NEAR(x[k], y[k] / n, 1e-5)
+          << MHASignal::fft_backend_name(id) << " n=" << n << " k=" << k;
+    }
+  }
+}
+
+TEST(fft_backend_t, complex2complex_in_place_and_out_of_place)
+{
+  for (auto id : available_backends()) {
+    for (unsigned n : test_lengths) {
+      auto fft = MHASignal::fft_backend_new(id, n);
+      const std::vector<mha_real_t> x = test_signal(n);
+      const std::vector<mha_complex_t> expected = naive_dft(x);
+      std::vector<mha_complex_t> in(n), out(n);
+      for (unsigned k = 0; k < n; ++k)
+        in[k] = mha_complex_t{x[k], 0};
+      fft->complex2complex(in.data(), out.data(), true);
+      const double tolerance = 2e-5 * n;
+      for (unsigned k = 0; k < expected.size(); ++k) {
+        EXPECT_NEAR(expected[k].re, out[k].re, tolerance);
+        EXPECT_NEAR(expected[k].im, out[k].im, tolerance);
+        // hermitian symmetry of the spectrum of a real signal
+        EXPECT_NEAR(expected[k].re, out[(n - k) % n].re, tolerance);
+        EXPECT_NEAR(-expected[k].im, out[(n - k) % n].im, tolerance);
+      }
+      // in-place backward transform restores the scaled signal
+      fft->complex2complex(out.data(), out.data(), false);
+      for (unsigned k = 0; k < n; ++k) {
+        EXPECT_NEAR(x[k], out[k].re / n, 1e-5);
+        EXPECT_NEAR(0.0f, out[k].im / n, 1e-5);
+      }
+    }
+  }
+}
+
+TEST(fft_t, all_backends_produce_same_spectrum)
+{
+  const unsigned n = 160, channels = 3;
+  MHASignal::waveform_t wave(n, channels);
+  const std::vector<mha_real_t> x = test_signal(n * channels);
+  std::copy(x.begin(), x.end(), wave.buf);
+  MHASignal::spectrum_t reference(n / 2 + 1, channels);
+  MHASignal::fft_t(n, fft_backend_id_t::FFTW2).wave2spec(&wave, &reference, true);
+  for (auto id : available_backends()) {
+    MHASignal::fft_t fft(n, id);
+    EXPECT_EQ(id, fft.get_backend_id());
+    // Extra bins beyond nfft/2+1 are cleared
+    MHASignal::spectrum_t spec(n / 2 + 3, channels);
+    for (unsigned k = 0; k < spec.num_frames * channels; ++k)
+      spec.buf[k] = mha_complex_t{1, 1};
+    fft.wave2spec(&wave, &spec, true);
+    for (unsigned ch = 0; ch < channels; ++ch) {
+      for (unsigned k = 0; k < reference.num_frames; ++k) {
+        EXPECT_NEAR(reference.value(k, ch).re, spec.value(k, ch).re, 1e-5);
+        EXPECT_NEAR(reference.value(k, ch).im, spec.value(k, ch).im, 1e-5);
+      }
+      for (unsigned k = reference.num_frames; k < spec.num_frames; ++k)
+        EXPECT_EQ(mha_complex_t({0, 0}), spec.value(k, ch));
+    }
+    MHASignal::waveform_t resynthesized(n, channels);
+    fft.spec2wave(&spec, &resynthesized);
+    for (unsigned k = 0; k < n * channels; ++k)
+      EXPECT_NEAR(wave.buf[(k + n / 2 * channels) % (n * channels)],
+                  resynthesized.buf[k], 1e-5);
+  }
+}
+
+TEST(fft_backend_t, batched_transforms_match_single_channel_transforms)
+{
+  const unsigned channels = 4;
+  for (auto id : available_backends()) {
+    for (unsigned n : test_lengths) {
+      auto fft = MHASignal::fft_backend_new(id, n);
+      fft->prepare_multi(channels);
+      const unsigned n_re = n / 2 + 1, dist = n_re + 2;
+      const std::vector<mha_real_t> x = test_signal(n * channels);
+      std::vector<mha_complex_t> batched(dist * channels, {7, 7});
+      fft->real2complex_multi(x.data(), batched.data(), channels, dist);
+      std::vector<mha_real_t> single(n);
+      std::vector<mha_complex_t> expected(n_re);
+      for (unsigned ch = 0; ch < channels; ++ch) {
+        for (unsigned k = 0; k < n; ++k)
+          single[k] = x[k * channels + ch];
+        fft->real2complex(single.data(), expected.data());
+        for (unsigned k = 0; k < n_re; ++k) {
+          EXPECT_NEAR(expected[k].re, batched[ch * dist + k].re, 1e-5 * n)
+            << MHASignal::fft_backend_name(id) << " n=" << n << " ch=" << ch;
+          EXPECT_NEAR(expected[k].im, batched[ch * dist + k].im, 1e-5 * n)
+            << MHASignal::fft_backend_name(id) << " n=" << n << " ch=" << ch;
+        }
+        // padding between the channels is not touched
+        EXPECT_EQ(mha_complex_t({7, 7}), batched[ch * dist + n_re]);
+      }
+      std::vector<mha_real_t> y(n * channels);
+      fft->complex2real_multi(batched.data(), dist, y.data(), channels);
+      for (unsigned k = 0; k < n * channels; ++k)
+        EXPECT_NEAR(x[k], y[k] / n, 1e-5)
+          << MHASignal::fft_backend_name(id) << " n=" << n << " k=" << k;
+      // other channel counts than prepared still work
+      fft->real2complex_multi(x.data(), batched.data(), 1U, dist);
+      std::vector<mha_real_t> first_channel(n);
+      for (unsigned k = 0; k < n; ++k)
+        first_channel[k] = x[k];
+      fft->real2complex(first_channel.data(), expected.data());
+      for (unsigned k = 0; k < n_re; ++k)
+        EXPECT_NEAR(expected[k].re, batched[k].re, 1e-5 * n);
+    }
+  }
+}
+
+TEST(fft_t, batched_transforms_match_per_channel_transforms)
+{
+  const unsigned channels = 4;
+  for (auto id : available_backends()) {
+    for (unsigned n : {160U, 243U, 512U}) {
+      MHASignal::fft_t batched(n, channels, id);
+      MHASignal::fft_t per_channel(n, id);
+      EXPECT_EQ(channels, batched.get_batch_channels());
+      EXPECT_EQ(0U, per_channel.get_batch_channels());
+      MHASignal::waveform_t wave(n, channels);
+      const std::vector<mha_real_t> x = test_signal(n * channels);
+      std::copy(x.begin(), x.end(), wave.buf);
+      for (bool swap : {false, true}) {
+        MHASignal::spectrum_t expected(n / 2 + 2, channels);
+        MHASignal::spectrum_t actual(n / 2 + 2, channels);
+        for (unsigned k = 0; k < actual.num_frames * channels; ++k)
+          actual.buf[k] = mha_complex_t{1, 1};
+        per_channel.wave2spec(&wave, &expected, swap);
+        batched.wave2spec(&wave, &actual, swap);
+        for (unsigned k = 0; k < expected.num_frames * channels; ++k) {
+          EXPECT_NEAR(expected.buf[k].re, actual.buf[k].re, 1e-6)
+            << MHASignal::fft_backend_name(id) << " n=" << n << " k=" << k;
+          EXPECT_NEAR(expected.buf[k].im, actual.buf[k].im, 1e-6)
+            << MHASignal::fft_backend_name(id) << " n=" << n << " k=" << k;
+        }
+        per_channel.wave2spec_scale(&wave, &expected, swap);
+        batched.wave2spec_scale(&wave, &actual, swap);
+        for (unsigned k = 0; k < expected.num_frames * channels; ++k) {
+          EXPECT_NEAR(expected.buf[k].re, actual.buf[k].re, 1e-5 * n);
+          EXPECT_NEAR(expected.buf[k].im, actual.buf[k].im, 1e-5 * n);
+        }
+      }
+      MHASignal::spectrum_t spec(n / 2 + 1, channels);
+      batched.wave2spec(&wave, &spec, false);
+      MHASignal::waveform_t expected(n, channels), actual(n, channels);
+      per_channel.spec2wave(&spec, &expected);
+      batched.spec2wave(&spec, &actual);
+      for (unsigned k = 0; k < n * channels; ++k) {
+        EXPECT_NEAR(expected.buf[k], actual.buf[k], 1e-5);
+        EXPECT_NEAR(x[k], actual.buf[k], 1e-5);
+      }
+      per_channel.spec2wave_scale(&spec, &expected);
+      batched.spec2wave_scale(&spec, &actual);
+      for (unsigned k = 0; k < n * channels; ++k)
+        EXPECT_NEAR(expected.buf[k], actual.buf[k], 1e-6);
+      // partial resynthesis starting at an offset
+      const unsigned offset = n / 4, len = n / 2;
+      MHASignal::waveform_t part_expected(len, channels), part_actual(len, channels);
+      per_channel.spec2wave(&spec, &part_expected, offset);
+      batched.spec2wave(&spec, &part_actual, offset);
+      for (unsigned k = 0; k < len * channels; ++k) {
+        EXPECT_NEAR(part_expected.buf[k], part_actual.buf[k], 1e-5);
+        EXPECT_NEAR(x[k + offset * channels], part_actual.buf[k], 1e-5);
+      }
+      // a waveform with a different channel count uses the single
+      // channel transforms
+      MHASignal::waveform_t mono(n, 1);
+      MHASignal::spectrum_t mono_spec(n / 2 + 1, 1);
+      std::copy(x.begin(), x.begin() + n, mono.buf);
+      batched.wave2spec(&mono, &mono_spec, false);
+      batched.spec2wave(&mono_spec, &mono);
+      for (unsigned k = 0; k < n; ++k)
+        EXPECT_NEAR(x[k], mono.buf[k], 1e-5);
+    }
+  }
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
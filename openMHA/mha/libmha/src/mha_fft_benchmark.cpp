@@ -0,0 +1,112 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file mha_fft_benchmark.cpp
+ * Compares the per-frame cost of mha_fft_t analysis and resynthesis
+ * (wave2spec followed by spec2wave) for all FFT backends compiled into
+ * libopenmha, each with per-channel and with batched multichannel
+ * transforms.  The per-channel FFTW2 transform is the reference, as it
+ * was the only implementation before backends became selectable.
+ *
+ * Usage: mha_fft_benchmark [channels [seconds_per_measurement]]
+ */
+
+#include "mha_signal.hh"
+#include "mha_signal_fft.h"
+#include "mha_fft_backend.hh"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+    using MHASignal::fft_backend_id_t;
+
+    /** Measure the mean time for one wave2spec + spec2wave call pair.
+     * \param batched Transform all channels in one backend call.
+     * \return nanoseconds per frame */
+    double time_per_frame(fft_backend_id_t id, bool batched, unsigned fftlen,
+                          unsigned channels, double seconds)
+    {
+        std::unique_ptr<MHASignal::fft_t> fft_ptr
+            (batched ? new MHASignal::fft_t(fftlen, channels, id)
+             : new MHASignal::fft_t(fftlen, id));
+        MHASignal::fft_t & fft = *fft_ptr;
+        MHASignal::waveform_t wave(fftlen, channels);
+        MHASignal::spectrum_t spec(fftlen / 2 + 1, channels);
+        for (unsigned k = 0; k < wave.num_frames * channels; ++k)
+            wave.buf[k] = sin(0.1 * k);
+        using clock = std::chrono::steady_clock;
+        // warm up caches and let the CPU clock settle
+        for (unsigned k = 0; k < 100; ++k) {
+            fft.wave2spec(&wave, &spec, false);
+            fft.spec2wave(&spec, &wave);
+        }
+        unsigned long frames = 0;
+        const auto start = clock::now();
+        std::chrono::duration<double> elapsed(0);
+        do {
+            for (unsigned k = 0; k < 64; ++k) {
+                fft.wave2spec(&wave, &spec, false);
+                fft.spec2wave(&spec, &wave);
+            }
+            frames += 64;
+            elapsed = clock::now() - start;
+        } while (elapsed.count() < seconds);
+        return elapsed.count() * 1e9 / frames;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const unsigned channels = argc > 1 ? atoi(argv[1]) : 2U;
+    const double seconds = argc > 2 ? atof(argv[2]) : 0.5;
+    printf("mha_fft_t wave2spec+spec2wave, %u channels, ns per frame"
+           " (speedup relative to fftw2)\n", channels);
+    printf("%8s", "fftlen");
+    for (auto id : {fft_backend_id_t::FFTW2, fft_backend_id_t::FFTW3,
+                    fft_backend_id_t::BUILTIN})
+        if (MHASignal::fft_backend_available(id))
+            for (bool batched : {false, true})
+                printf(" %22s", (MHASignal::fft_backend_name(id) +
+                                 (batched ? " batched" : "")).c_str());
+    printf("\n");
+    for (unsigned fftlen = 64; fftlen <= 2048; fftlen *= 2) {
+        printf("%8u", fftlen);
+        const double reference = time_per_frame(fft_backend_id_t::FFTW2, false,
+                                                fftlen, channels, seconds);
+        for (auto id : {fft_backend_id_t::FFTW2, fft_backend_id_t::FFTW3,
+                        fft_backend_id_t::BUILTIN}) {
+            if (!MHASignal::fft_backend_available(id))
+                continue;
+            for (bool batched : {false, true}) {
+                const double t =
+                    (id == fft_backend_id_t::FFTW2 && !batched) ? reference
+                    : time_per_frame(id, batched, fftlen, channels, seconds);
+                printf(" %12.0f (%5.2fx)", t, reference / t);
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
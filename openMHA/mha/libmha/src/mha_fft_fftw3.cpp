@@ -0,0 +1,311 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_fft_backend.hh"
+#include "mha_error.hh"
+#include "mha_os.h"
+#include <fftw3.h>
+#include <mutex>
+#include <string.h>
+
+namespace {
+
+    /** The FFTW3 planner is not thread safe. */
+    std::mutex fftw3_planner_mutex;
+
+    /** Name of the FFTW3 wisdom file, taken from the environment
+        variable MHA_FFTW_WISDOM.  Empty if wisdom is not persisted. */
+    const std::string & fftw3_wisdom_file()
+    {
+        static const std::string filename = mha_getenv("MHA_FFTW_WISDOM");
+        return filename;
+    }
+
+    /** FFTW3 implementation.  Plans are created for 16-byte aligned
+        internal buffers, therefore FFTW3 can use its SIMD codelets.
+        Caller-provided arrays with the same alignment are transformed
+        directly, other arrays are copied through the internal buffers.
+
+        If the environment variable MHA_FFTW_WISDOM names a file, then
+        the wisdom stored in this file is imported before the first
+        plan is created, plans are measured instead of estimated, and
+        the accumulated wisdom is written back to the file after
+        planning.  Planning therefore is slow only the first time a
+        new FFT length is used on a machine. */
+    class fft_fftw3_t : public MHASignal::fft_backend_t {
+    public:
+        explicit fft_fftw3_t(unsigned nfft);
+        ~fft_fftw3_t();
+        void real2complex(const mha_real_t* in, mha_complex_t* out) override;
+        void complex2real(const mha_complex_t* in, mha_real_t* out) override;
+        void complex2complex(const mha_complex_t* in, mha_complex_t* out,
+                             bool forward) override;
+        void prepare_multi(unsigned channels) override;
+        void real2complex_multi(const mha_real_t* in, mha_complex_t* out,
+                                unsigned channels, unsigned out_dist) override;
+        void complex2real_multi(const mha_complex_t* in, unsigned in_dist,
+                                mha_real_t* out, unsigned channels) override;
+        MHASignal::fft_backend_id_t get_id() const override
+        {return MHASignal::fft_backend_id_t::FFTW3;}
+    private:
+        /** True if FFTW3 may execute a plan on ptr directly. */
+        bool aligned_like_plan(const void * ptr) const
+        {return fftwf_alignment_of((float*)ptr) == 0;}
+        /** Destroy plans and buffers. Caller must hold the planner mutex. */
+        void release();
+        /** Destroy plans and buffers of the batched transforms.  Caller
+            must hold the planner mutex. */
+        void release_multi();
+        /** Planner flags: measure if wisdom is persisted, else estimate. */
+        unsigned planner_flags() const
+        {return fftw3_wisdom_file().size() ? FFTW_MEASURE : FFTW_ESTIMATE;}
+        float * buf_real;
+        fftwf_complex * buf_a;
+        fftwf_complex * buf_b;
+        fftwf_plan plan_real2complex;
+        fftwf_plan plan_complex2real;
+        fftwf_plan plan_forward;
+        fftwf_plan plan_backward;
+        /** Number of channels of the batched plans, 0 if not prepared. */
+        unsigned multi_channels = 0U;
+        /** Interleaved waveform of nfft frames x multi_channels */
+        float * multi_real = nullptr;
+        /** Spectra of all channels, nfft/2+1 bins per channel */
+        fftwf_complex * multi_spec = nullptr;
+        fftwf_plan plan_multi_real2complex = nullptr;
+        fftwf_plan plan_multi_complex2real = nullptr;
+    };
+
+    fft_fftw3_t::fft_fftw3_t(unsigned nfft)
+        : MHASignal::fft_backend_t(nfft),
+          buf_real(fftwf_alloc_real(nfft)),
+          buf_a(fftwf_alloc_complex(nfft)),
+          buf_b(fftwf_alloc_complex(nfft)),
+          plan_real2complex(nullptr), plan_complex2real(nullptr),
+          plan_forward(nullptr), plan_backward(nullptr)
+    {
+        static_assert(sizeof(mha_real_t) == sizeof(float),
+                      "libopenmha links against single precision FFTW3");
+        static_assert(sizeof(mha_complex_t) == sizeof(fftwf_complex),
+                      "MHA and FFTW3 use different complex layout");
+        std::lock_guard<std::mutex> lock(fftw3_planner_mutex);
+        static bool wisdom_imported = false;
+        const std::string & wisdom = fftw3_wisdom_file();
+        if (!wisdom_imported && wisdom.size())
+            fftwf_import_wisdom_from_filename(wisdom.c_str());
+        wisdom_imported = true;
+        const unsigned flags = planner_flags();
+        const int n = nfft;
+        plan_real2complex =
+            fftwf_plan_dft_r2c_1d(n, buf_real, buf_a, flags);
+        plan_complex2real =
+            fftwf_plan_dft_c2r_1d(n, buf_a, buf_real, flags);
+        plan_forward =
+            fftwf_plan_dft_1d(n, buf_a, buf_b, FFTW_FORWARD, flags);
+        plan_backward =
+            fftwf_plan_dft_1d(n, buf_a, buf_b, FFTW_BACKWARD, flags);
+        if (!(buf_real && buf_a && buf_b && plan_real2complex &&
+              plan_complex2real && plan_forward && plan_backward)) {
+            release();
+            throw MHA_Error(__FILE__,__LINE__,
+                            "FFTW3: Unable to create plans for fft length %u",
+                            nfft);
+        }
+        if (wisdom.size())
+            fftwf_export_wisdom_to_filename(wisdom.c_str());
+    }
+
+    fft_fftw3_t::~fft_fftw3_t()
+    {
+        std::lock_guard<std::mutex> lock(fftw3_planner_mutex);
+        release();
+    }
+
+    void fft_fftw3_t::release()
+    {
+        release_multi();
+        for (fftwf_plan * plan : {&plan_real2complex, &plan_complex2real,
+                                  &plan_forward, &plan_backward})
+            if (*plan) {
+                fftwf_destroy_plan(*plan);
+                *plan = nullptr;
+            }
+        fftwf_free(buf_real); buf_real = nullptr;
+        fftwf_free(buf_a); buf_a = nullptr;
+        fftwf_free(buf_b); buf_b = nullptr;
+    }
+
+    void fft_fftw3_t::release_multi()
+    {
+        for (fftwf_plan * plan : {&plan_multi_real2complex,
+                                  &plan_multi_complex2real})
+            if (*plan) {
+                fftwf_destroy_plan(*plan);
+                *plan = nullptr;
+            }
+        fftwf_free(multi_real); multi_real = nullptr;
+        fftwf_free(multi_spec); multi_spec = nullptr;
+        multi_channels = 0U;
+    }
+
+    void fft_fftw3_t::prepare_multi(unsigned channels)
+    {
+        std::lock_guard<std::mutex> lock(fftw3_planner_mutex);
+        if (channels == multi_channels || channels == 0U)
+            return;
+        release_multi();
+        const int n = nfft;
+        const int n_re = nfft / 2U + 1U;
+        const int howmany = channels;
+        multi_real = fftwf_alloc_real(size_t(nfft) * channels);
+        multi_spec = fftwf_alloc_complex(size_t(n_re) * channels);
+        if (multi_real && multi_spec) {
+            // Waveform: channels are interleaved, stride = channels,
+            // distance = 1.  Spectrum: channels are consecutive blocks
+            // of n_re bins like in mha_spec_t.
+            plan_multi_real2complex =
+                fftwf_plan_many_dft_r2c(1, &n, howmany,
+                                        multi_real, nullptr, howmany, 1,
+                                        multi_spec, nullptr, 1, n_re,
+                                        planner_flags());
+            plan_multi_complex2real =
+                fftwf_plan_many_dft_c2r(1, &n, howmany,
+                                        multi_spec, nullptr, 1, n_re,
+                                        multi_real, nullptr, howmany, 1,
+                                        planner_flags());
+        }
+        if (!(plan_multi_real2complex && plan_multi_complex2real)) {
+            release_multi();
+            throw MHA_Error(__FILE__,__LINE__,
+                            "FFTW3: Unable to create plans for %u channels"
+                            " of fft length %u", channels, nfft);
+        }
+        multi_channels = channels;
+        const std::string & wisdom = fftw3_wisdom_file();
+        if (wisdom.size())
+            fftwf_export_wisdom_to_filename(wisdom.c_str());
+    }
+
+    void fft_fftw3_t::real2complex_multi(const mha_real_t* in,
+                                         mha_complex_t* out,
+                                         unsigned channels, unsigned out_dist)
+    {
+        if (channels != multi_channels) {
+            fft_backend_t::real2complex_multi(in, out, channels, out_dist);
+            return;
+        }
+        const unsigned n_re = nfft / 2U + 1U;
+        if (out_dist == n_re && aligned_like_plan(in) && aligned_like_plan(out)) {
+            fftwf_execute_dft_r2c(plan_multi_real2complex,
+                                  const_cast<float*>(in),
+                                  reinterpret_cast<fftwf_complex*>(out));
+        } else {
+            memcpy(multi_real, in, size_t(nfft) * channels * sizeof(float));
+            fftwf_execute(plan_multi_real2complex);
+            for (unsigned ch = 0; ch < channels; ++ch)
+                memcpy(out + ch * out_dist, multi_spec + ch * n_re,
+                       n_re * sizeof(fftwf_complex));
+        }
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            out[ch * out_dist].im = 0;
+            if ((nfft & 1U) == 0U)
+                out[ch * out_dist + nfft / 2U].im = 0;
+        }
+    }
+
+    void fft_fftw3_t::complex2real_multi(const mha_complex_t* in,
+                                         unsigned in_dist,
+                                         mha_real_t* out, unsigned channels)
+    {
+        if (channels != multi_channels) {
+            fft_backend_t::complex2real_multi(in, in_dist, out, channels);
+            return;
+        }
+        // c2r transforms destroy their input, always work on a copy
+        const unsigned n_re = nfft / 2U + 1U;
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            fftwf_complex * spec = multi_spec + ch * n_re;
+            memcpy(spec, in + ch * in_dist, n_re * sizeof(fftwf_complex));
+            spec[0][1] = 0;
+            if ((nfft & 1U) == 0U)
+                spec[nfft / 2U][1] = 0;
+        }
+        if (aligned_like_plan(out)) {
+            fftwf_execute_dft_c2r(plan_multi_complex2real, multi_spec, out);
+        } else {
+            fftwf_execute(plan_multi_complex2real);
+            memcpy(out, multi_real, size_t(nfft) * channels * sizeof(float));
+        }
+    }
+
+    void fft_fftw3_t::real2complex(const mha_real_t* in, mha_complex_t* out)
+    {
+        if (aligned_like_plan(in) && aligned_like_plan(out)) {
+            fftwf_execute_dft_r2c(plan_real2complex, const_cast<float*>(in),
+                                  reinterpret_cast<fftwf_complex*>(out));
+        } else {
+            memcpy(buf_real, in, nfft * sizeof(float));
+            fftwf_execute(plan_real2complex);
+            memcpy(out, buf_a, (nfft / 2U + 1U) * sizeof(fftwf_complex));
+        }
+        out[0].im = 0;
+        if ((nfft & 1U) == 0U)
+            out[nfft / 2U].im = 0;
+    }
+
+    void fft_fftw3_t::complex2real(const mha_complex_t* in, mha_real_t* out)
+    {
+        // c2r transforms destroy their input, always work on a copy
+        const unsigned n_re = nfft / 2U + 1U;
+        memcpy(buf_a, in, n_re * sizeof(fftwf_complex));
+        buf_a[0][1] = 0;
+        if ((nfft & 1U) == 0U)
+            buf_a[nfft / 2U][1] = 0;
+        if (aligned_like_plan(out)) {
+            fftwf_execute_dft_c2r(plan_complex2real, buf_a, out);
+        } else {
+            fftwf_execute(plan_complex2real);
+            memcpy(out, buf_real, nfft * sizeof(float));
+        }
+    }
+
+    void fft_fftw3_t::complex2complex(const mha_complex_t* in,
+                                      mha_complex_t* out, bool forward)
+    {
+        fftwf_plan plan = forward ? plan_forward : plan_backward;
+        if (in != out && aligned_like_plan(in) && aligned_like_plan(out)) {
+            fftwf_execute_dft(plan,
+                              reinterpret_cast<fftwf_complex*>(const_cast<mha_complex_t*>(in)),
+                              reinterpret_cast<fftwf_complex*>(out));
+        } else {
+            memcpy(buf_a, in, nfft * sizeof(fftwf_complex));
+            fftwf_execute(plan);
+            memcpy(out, buf_b, nfft * sizeof(fftwf_complex));
+        }
+    }
+}
+
+std::unique_ptr<MHASignal::fft_backend_t>
+MHASignal::fft_fftw3_new(unsigned nfft)
+{
+    return std::make_unique<fft_fftw3_t>(nfft);
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
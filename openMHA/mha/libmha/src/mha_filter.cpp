@@ -16,12 +16,17 @@
 
 #include "mha_defs.h"
 #include "mha_filter.hh"
+#include "mha_simd.hh"
 #include <cmath>
 #include <math.h>
 #include <limits>
 #include <valarray>
 #include <algorithm>
 #include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 using namespace MHAFilter;
 
 MHAFilter::filter_t::filter_t(unsigned int ch,
@@ -124,6 +129,98 @@ mha_real_t MHAFilter::filter_t::filter(mha_real_t x, unsigned int ch)
     return y;
 }
 
+namespace {
+    /** make_friendly_number without branches, so that loops over
+        channels can be vectorized.  Same result as make_friendly_number,
+        including the sign of zero. */
+    template <typename T>
+    inline T friendly(T x)
+    {
+        const T ax = std::abs(x);
+        return ((ax >= std::numeric_limits<T>::min() || x == 0) &&
+                ax <= std::numeric_limits<T>::max()) ? x : T(0);
+    }
+
+    /** Direct form II filter with N recursive and N non-recursive
+        coefficients for W adjacent channels, with the same floating
+        point operations as the generic filter_t::filter.  The filter
+        state of the W channels is kept in local arrays while all
+        frames are processed, the loops over the channels are
+        innermost.
+        \param state Filter state of channel ch0, state[channels*n+w] is
+               the n-th delay of channel ch0+w.
+        \param channels Number of channels of the filter state.
+        \param A Recursive coefficients.
+        \param B Non-recursive coefficients.
+        \param dest Output of channel ch0.
+        \param src Input of channel ch0.
+        \param dframes Number of frames.
+        \param frame_dist Index distance between frames.
+        \param channel_dist Index distance between channels. */
+    template <unsigned N, unsigned W>
+    void filter_fixed(double* state, unsigned channels,
+                      const double* A, const double* B,
+                      mha_real_t* dest, const mha_real_t* src,
+                      unsigned dframes, unsigned frame_dist,
+                      unsigned channel_dist)
+    {
+        double a[N], b[N], z[N][W];
+        for(unsigned n=0; n<N; n++){
+            a[n] = A[n];
+            b[n] = B[n];
+            for(unsigned w=0; w<W; w++)
+                z[n][w] = state[channels*n+w];
+        }
+        const bool normalize = (a[0] != 1.0);
+        for(unsigned fr=0; fr<dframes; fr++){
+            const mha_real_t* x = src + frame_dist * fr;
+            mha_real_t* y = dest + frame_dist * fr;
+            for(unsigned w=0; w<W; w++){
+                for(unsigned n=N-1; n>0; n--)
+                    z[n][w] = z[n-1][w];
+                double s = x[channel_dist * w];
+                for(unsigned n=1; n<N; n++)
+                    s -= z[n][w] * a[n];
+                z[0][w] = friendly(s);
+                mha_real_t out = 0;
+                for(unsigned n=0; n<N; n++)
+                    out += z[n][w] * b[n];
+                // Division by 1 does not change the result
+                if( normalize )
+                    out /= a[0];
+                y[channel_dist * w] = friendly(out);
+            }
+        }
+        for(unsigned n=0; n<N; n++)
+            for(unsigned w=0; w<W; w++)
+                state[channels*n+w] = z[n][w];
+    }
+
+    /** filter_fixed for channels channel_begin to channel_end-1, in
+        blocks of 4 channels. */
+    template <unsigned N>
+    void filter_fixed(double* state, unsigned channels,
+                      const double* A, const double* B,
+                      mha_real_t* dest, const mha_real_t* src,
+                      unsigned dframes, unsigned frame_dist,
+                      unsigned channel_dist, unsigned channel_begin,
+                      unsigned channel_end)
+    {
+        constexpr unsigned W = 4U;
+        unsigned ch = channel_begin;
+        for(; ch+W <= channel_end; ch += W){
+            const unsigned offset = channel_dist * (ch - channel_begin);
+            filter_fixed<N,W>(state+ch, channels, A, B, dest+offset,
+                              src+offset, dframes, frame_dist, channel_dist);
+        }
+        for(; ch < channel_end; ch++){
+            const unsigned offset = channel_dist * (ch - channel_begin);
+            filter_fixed<N,1>(state+ch, channels, A, B, dest+offset,
+                              src+offset, dframes, frame_dist, channel_dist);
+        }
+    }
+}
+
 void MHAFilter::filter_t::filter(mha_real_t* dest,
                                  const mha_real_t* src,
                                  unsigned int dframes,
@@ -131,6 +228,39 @@ void MHAFilter::filter_t::filter(mha_real_t* dest,
                                  unsigned int channel_dist,
                                  unsigned int channel_begin,
                                  unsigned int channel_end)
+{
+    // validate channel count:
+    if( channel_end > channels )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "channels out of range (dest:%u-%u filter:%u)",
+                        channel_begin,channel_end,channels);
+    if( len_A == len_B ){
+        switch( len ){
+        case 2:
+            filter_fixed<2>(state,channels,A,B,dest,src,dframes,frame_dist,
+                            channel_dist,channel_begin,channel_end);
+            return;
+        case 3:
+            filter_fixed<3>(state,channels,A,B,dest,src,dframes,frame_dist,
+                            channel_dist,channel_begin,channel_end);
+            return;
+        case 5:
+            filter_fixed<5>(state,channels,A,B,dest,src,dframes,frame_dist,
+                            channel_dist,channel_begin,channel_end);
+            return;
+        }
+    }
+    filter_generic(dest,src,dframes,frame_dist,channel_dist,channel_begin,
+                   channel_end);
+}
+
+void MHAFilter::filter_t::filter_generic(mha_real_t* dest,
+                                         const mha_real_t* src,
+                                         unsigned int dframes,
+                                         unsigned int frame_dist,
+                                         unsigned int channel_dist,
+                                         unsigned int channel_begin,
+                                         unsigned int channel_end)
 {
     // validate channel count:
     if( channel_end > channels )
@@ -182,6 +312,59 @@ std::vector<mha_real_t> diff_coeffs()
     return r;
 }
 
+MHAFilter::biquad_cascade_t::biquad_cascade_t(unsigned int ch,
+                                              const std::vector<std::vector<mha_real_t> >& sections)
+    : channels(ch),
+      num_sections(sections.size()),
+      coeffs(6*num_sections),
+      state(3*num_sections*channels,0.0)
+{
+    if( !channels )
+        throw MHA_Error(__FILE__,__LINE__,"biquad cascade needs at least one channel");
+    if( !num_sections )
+        throw MHA_Error(__FILE__,__LINE__,"biquad cascade needs at least one section");
+    for(unsigned int k=0;k<num_sections;k++){
+        if( sections[k].size() != 6 )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "section %u has %zu coefficients, expected 6"
+                            " (b0 b1 b2 a0 a1 a2)",k,sections[k].size());
+        if( sections[k][3] == 0 )
+            throw MHA_Error(__FILE__,__LINE__,"a0 of section %u is zero",k);
+        // Normalize by a0 like iir_filter_state_t
+        const mha_real_t a0 = sections[k][3];
+        for(unsigned int n=0;n<6;n++)
+            coeffs[6*k+n] = sections[k][n] / a0;
+        coeffs[6*k+3] = 1;
+    }
+}
+
+void MHAFilter::biquad_cascade_t::filter(mha_wave_t* out, const mha_wave_t* in)
+{
+    if( (out->num_channels != channels) || (in->num_channels != channels) )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "mismatching number of channels (out:%u in:%u filter:%u)",
+                        out->num_channels,in->num_channels,channels);
+    if( out->num_frames != in->num_frames )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "mismatching number of frames (out:%u in:%u)",
+                        out->num_frames,in->num_frames);
+    // One pass over the block per section, each pass keeps the state
+    // of its section in registers
+    const mha_real_t* src = in->buf;
+    for(unsigned int k=0;k<num_sections;k++){
+        const double* B = coeffs.data() + 6*k;
+        filter_fixed<3>(state.data() + 3*k*channels, channels, B+3, B,
+                        out->buf, src, out->num_frames, channels, 1,
+                        0, channels);
+        src = out->buf;
+    }
+}
+
+void MHAFilter::biquad_cascade_t::reset()
+{
+    std::fill(state.begin(),state.end(),0.0);
+}
+
 MHAFilter::diff_t::diff_t(unsigned int ch)
     : MHAFilter::filter_t(ch,std::vector<mha_real_t>(1,1.0f),diff_coeffs())
 {
@@ -837,7 +1020,8 @@ MHAFilter::partitioned_convolution_t::
 partitioned_convolution_t(unsigned int fragsize_,
                           unsigned int nchannels_in_,
                           unsigned int nchannels_out_,
-                          const transfer_matrix_t & transfer)
+                          const transfer_matrix_t & transfer,
+                          partitioned_convolution_engine_t engine_)
     : fragsize(fragsize_),
       nchannels_in(nchannels_in_),
       nchannels_out(nchannels_out_),
@@ -848,11 +1032,14 @@ partitioned_convolution_t(unsigned int fragsize_,
       input_signal_spec(fragsize+1, nchannels_in),
       frequency_response(fragsize+1, filter_partitions),
       bookkeeping(filter_partitions),
-      output_signal_spec(output_partitions, 
+      output_signal_spec(engine_ == partitioned_convolution_engine_t::
+                         FREQUENCY_DOMAIN_DELAY_LINE ? 1U : output_partitions,
                          MHASignal::spectrum_t(fragsize+1, nchannels_out)),
       current_output_partition_index(0U),
       output_signal_wave(fragsize, nchannels_out),
-      fft(mha_fft_new(2*fragsize))
+      fft(mha_fft_new(2*fragsize)),
+      engine(engine_),
+      fdl_slot(0U)
 {
     /* break up impulse responses into partitions */
     
@@ -924,6 +1111,35 @@ partitioned_convolution_t(unsigned int fragsize_,
     // fftlength. Normalize by multiplying the frequency response with
     // fftlength.
     frequency_response *= mha_real_t(2*fragsize);
+
+    if (engine == partitioned_convolution_engine_t::
+        FREQUENCY_DOMAIN_DELAY_LINE) {
+        const unsigned bins = fragsize + 1;
+        fdl_re.assign(nchannels_in * output_partitions * bins, 0.0f);
+        fdl_im.assign(fdl_re.size(), 0.0f);
+        fdl_response_re.resize(filter_partitions * bins);
+        fdl_response_im.resize(filter_partitions * bins);
+        for (unsigned p = 0; p < filter_partitions; ++p)
+            for (unsigned k = 0; k < bins; ++k) {
+                fdl_response_re[p * bins + k] = frequency_response.value(k,p).re;
+                fdl_response_im[p * bins + k] = frequency_response.value(k,p).im;
+            }
+        fdl_order.resize(filter_partitions);
+        for (unsigned p = 0; p < filter_partitions; ++p)
+            fdl_order[p] = p;
+        std::stable_sort(fdl_order.begin(), fdl_order.end(),
+                         [this](unsigned a, unsigned b) {
+                             const index_t & ia = bookkeeping[a];
+                             const index_t & ib = bookkeeping[b];
+                             if (ia.target_channel_index
+                                 != ib.target_channel_index)
+                                 return ia.target_channel_index
+                                     < ib.target_channel_index;
+                             return ia.delay > ib.delay;
+                         });
+        fdl_acc_re.resize(bins);
+        fdl_acc_im.resize(bins);
+    }
 }
 
 MHAFilter::partitioned_convolution_t::~partitioned_convolution_t()
@@ -958,6 +1174,15 @@ MHAFilter::partitioned_convolution_t::process(const mha_wave_t * s_in)
     mha_fft_wave2spec(fft, &input_signal_wave, &input_signal_spec,
                       bool(current_input_signal_buffer_half_index));
 
+    if (engine == partitioned_convolution_engine_t::
+        FREQUENCY_DOMAIN_DELAY_LINE) {
+        process_fdl();
+        mha_fft_spec2wave(fft, &output_signal_spec[0], &output_signal_wave, 0);
+        current_input_signal_buffer_half_index = 
+            1U - current_input_signal_buffer_half_index;
+        return &output_signal_wave;
+    }
+
     // filter
     mha_complex_t temp;
     for (unsigned p = 0; // filter partition index
@@ -995,6 +1220,320 @@ MHAFilter::partitioned_convolution_t::process(const mha_wave_t * s_in)
     return &output_signal_wave;
 }
 
+void MHAFilter::partitioned_convolution_t::process_fdl()
+{
+    const unsigned bins = fragsize + 1;
+    // The newest input spectrum replaces the oldest one
+    fdl_slot = (fdl_slot + 1U) % output_partitions;
+    for (unsigned ch = 0; ch < nchannels_in; ++ch) {
+        const unsigned offset = (ch * output_partitions + fdl_slot) * bins;
+        for (unsigned k = 0; k < bins; ++k) {
+            fdl_re[offset + k] = input_signal_spec.value(k, ch).re;
+            fdl_im[offset + k] = input_signal_spec.value(k, ch).im;
+        }
+    }
+    unsigned i = 0; // index into fdl_order
+    for (unsigned tgt = 0; tgt < nchannels_out; ++tgt) {
+        std::fill(fdl_acc_re.begin(), fdl_acc_re.end(), 0.0f);
+        std::fill(fdl_acc_im.begin(), fdl_acc_im.end(), 0.0f);
+        for (; i < filter_partitions
+                 && bookkeeping[fdl_order[i]].target_channel_index == tgt;
+             ++i) {
+            const unsigned p = fdl_order[i];
+            const unsigned slot =
+                (fdl_slot + output_partitions - bookkeeping[p].delay)
+                % output_partitions;
+            const unsigned offset =
+                (bookkeeping[p].source_channel_index * output_partitions
+                 + slot) * bins;
+            MHASignal::mac_split(fdl_acc_re.data(), fdl_acc_im.data(),
+                                 &fdl_response_re[p * bins],
+                                 &fdl_response_im[p * bins],
+                                 &fdl_re[offset], &fdl_im[offset], bins);
+        }
+        for (unsigned k = 0; k < bins; ++k)
+            output_signal_spec[0].value(k, tgt) =
+                mha_complex(fdl_acc_re[k], fdl_acc_im[k]);
+    }
+}
+
+namespace {
+    /** Partition sizes of the tail levels of a non-uniform partitioned
+     * convolution.  Sizes grow by a factor of 4 starting at 4*fragsize.
+     * Only levels that start before the end of the longest impulse
+     * response are returned. */
+    std::vector<unsigned int> tail_partition_sizes(unsigned int fragsize,
+                                                   unsigned int ir_length,
+                                                   unsigned int max_size)
+    {
+        std::vector<unsigned int> sizes;
+        for (unsigned long long size = 4ULL * fragsize;
+             size <= max_size && 2ULL * size < ir_length;
+             size *= 4U)
+            sizes.push_back(size);
+        return sizes;
+    }
+
+    unsigned int max_ir_length(const MHAFilter::transfer_matrix_t & transfer)
+    {
+        size_t result = 0U;
+        for (const auto & tf : transfer)
+            result = std::max(result, tf.impulse_response.size());
+        return result;
+    }
+
+    /** Index of the first impulse response sample not convolved by the
+     * head of a non-uniform partitioned convolution. */
+    unsigned int head_length(unsigned int fragsize,
+                             const MHAFilter::transfer_matrix_t & transfer,
+                             unsigned int max_size)
+    {
+        const unsigned int ir_length = max_ir_length(transfer);
+        const auto sizes = tail_partition_sizes(fragsize, ir_length, max_size);
+        return sizes.empty() ? ir_length : 2U * sizes.front();
+    }
+}
+
+/** One tail level of a non-uniform partitioned convolution and its
+ * worker thread.  The signal processing thread collects input blocks
+ * of partition_size samples and passes them to the worker thread
+ * through a pair of buffers.  Results are returned through another
+ * pair of buffers.  At most one block is processed at a time. */
+class MHAFilter::nonuniform_partitioned_convolution_t::level_t {
+public:
+    /** Start the worker thread.
+     * @param partition_size Partition size of this level, a multiple
+     *   of the audio fragment size.
+     * @param nchannels_in Number of input audio channels.
+     * @param nchannels_out Number of output audio channels.
+     * @param transfer The impulse response segments of this level,
+     *   starting at impulse response sample 2*partition_size.
+     * @param engine Processing scheme of the convolution. */
+    level_t(unsigned int partition_size,
+            unsigned int nchannels_in, unsigned int nchannels_out,
+            const transfer_matrix_t & transfer,
+            partitioned_convolution_engine_t engine)
+        : partition_size(partition_size),
+          conv(partition_size, nchannels_in, nchannels_out, transfer, engine),
+          input{{partition_size, nchannels_in},
+                {partition_size, nchannels_in}},
+          output{{partition_size, nchannels_out},
+                 {partition_size, nchannels_out}},
+          position(0U), input_index(0U), output_index(0U),
+          job_input_index(0U), job_output_index(0U),
+          job_in_flight(false), waits(0U),
+          submitted(0U), completed(0U),
+          sleeping(false), waiting(false), termination_request(false)
+    {
+        thread = std::thread(&level_t::worker_main, this);
+    }
+
+    /** Terminate the worker thread. */
+    ~level_t()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            termination_request.store(true);
+        }
+        wakeup.notify_one();
+        thread.join();
+    }
+
+    /** Pass one fragment of input to this level and add the output of
+     * this level to the fragment of output.  Signal processing thread
+     * only. */
+    void process(const mha_wave_t & s_in, mha_wave_t & s_out)
+    {
+        const unsigned int frames = s_in.num_frames;
+        for (unsigned ch = 0; ch < s_out.num_channels; ++ch)
+            for (unsigned k = 0; k < frames; ++k)
+                value(s_out, k, ch) +=
+                    output[output_index].value(position + k, ch);
+        input[input_index].copy_from_at(position, frames, s_in, 0);
+        position += frames;
+        if (position < partition_size)
+            return;
+        position = 0U;
+        // The result of the previous block is needed from the next
+        // fragment on, and the worker can only hold one block.
+        if (job_in_flight) {
+            wait_for_worker();
+            output_index = 1U - output_index;
+        }
+        job_input_index = input_index;
+        job_output_index = 1U - output_index;
+        input_index = 1U - input_index;
+        job_in_flight = true;
+        submitted.fetch_add(1U);
+        // The worker sets sleeping before it checks submitted, therefore
+        // either it sees the new block or we see the sleeping worker.
+        if (sleeping.load()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeup.notify_one();
+        }
+    }
+
+    unsigned int get_partition_size() const {return partition_size;}
+    unsigned long long get_num_waits() const {return waits;}
+private:
+    /** Block until the worker has completed the submitted block.
+     * The worker is late, the signal processing thread has nothing
+     * else to do than to give the processor to the worker. */
+    void wait_for_worker()
+    {
+        if (completed.load() == submitted.load())
+            return;
+        ++waits;
+        std::unique_lock<std::mutex> lock(mutex);
+        waiting.store(true);
+        finished.wait(lock, [this]{
+            return completed.load() == submitted.load();});
+        waiting.store(false);
+    }
+
+    void worker_main()
+    {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                sleeping.store(true);
+                wakeup.wait(lock, [this]{
+                    return termination_request.load() ||
+                        completed.load() != submitted.load();});
+                sleeping.store(false);
+            }
+            if (termination_request.load())
+                return;
+            mha_wave_t * result = conv.process(&input[job_input_index]);
+            output[job_output_index].copy(*result);
+            completed.fetch_add(1U);
+            // Same protocol as for waking the worker
+            if (waiting.load()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_one();
+            }
+        }
+    }
+
+    const unsigned int partition_size;
+    /** Convolution with block size partition_size */
+    partitioned_convolution_t conv;
+    /** Input blocks, one is filled by the signal processing thread
+     * while the other is processed by the worker */
+    MHASignal::waveform_t input[2];
+    /** Output blocks, one is read by the signal processing thread
+     * while the other is written by the worker */
+    MHASignal::waveform_t output[2];
+    /** Position of the current fragment within the current block */
+    unsigned int position;
+    /** Input block filled by the signal processing thread */
+    unsigned int input_index;
+    /** Output block read by the signal processing thread */
+    unsigned int output_index;
+    /** Input block for the worker, published through submitted */
+    unsigned int job_input_index;
+    /** Output block for the worker, published through submitted */
+    unsigned int job_output_index;
+    /** A block has been submitted and its result not yet used */
+    bool job_in_flight;
+    /** Number of times the signal processing thread had to wait */
+    unsigned long long waits;
+    /** Number of blocks submitted by the signal processing thread */
+    std::atomic<unsigned> submitted;
+    /** Number of blocks completed by the worker */
+    std::atomic<unsigned> completed;
+    /** Set while the worker is about to sleep or sleeping */
+    std::atomic<bool> sleeping;
+    /** Set while the signal processing thread waits for the worker */
+    std::atomic<bool> waiting;
+    std::atomic<bool> termination_request;
+    /** Protects sleeping of the worker and waiting for the worker */
+    std::mutex mutex;
+    /** Wakes the worker */
+    std::condition_variable wakeup;
+    /** Wakes the waiting signal processing thread */
+    std::condition_variable finished;
+    std::thread thread;
+};
+
+MHAFilter::transfer_matrix_t
+MHAFilter::nonuniform_partitioned_convolution_t::
+segment(const transfer_matrix_t & transfer, unsigned int begin,
+        unsigned int end)
+{
+    transfer_matrix_t result;
+    for (const auto & tf : transfer) {
+        const auto & ir = tf.impulse_response;
+        const size_t b = std::min<size_t>(begin, ir.size());
+        const size_t e = std::min<size_t>(std::max(begin, end), ir.size());
+        result.push_back(transfer_function_t(tf.source_channel_index,
+                                             tf.target_channel_index,
+                                             std::vector<float>
+                                             (ir.begin() + b,
+                                              ir.begin() + e)));
+    }
+    return result;
+}
+
+MHAFilter::nonuniform_partitioned_convolution_t::
+nonuniform_partitioned_convolution_t(unsigned int fragsize,
+                                     unsigned int nchannels_in,
+                                     unsigned int nchannels_out,
+                                     const transfer_matrix_t & transfer,
+                                     unsigned int max_partition_size,
+                                     partitioned_convolution_engine_t engine)
+    : head(fragsize, nchannels_in, nchannels_out,
+           segment(transfer, 0U,
+                   head_length(fragsize, transfer, max_partition_size)),
+           engine),
+      output_signal_wave(fragsize, nchannels_out)
+{
+    const auto sizes = tail_partition_sizes(fragsize, max_ir_length(transfer),
+                                            max_partition_size);
+    for (unsigned i = 0; i < sizes.size(); ++i) {
+        const unsigned int end = (i + 1U < sizes.size())
+            ? 2U * sizes[i + 1U] : max_ir_length(transfer);
+        const transfer_matrix_t tail =
+            segment(transfer, 2U * sizes[i], end);
+        // Levels containing only zeros need no worker
+        if (tail.non_empty_partitions(sizes[i]).sum() == 0U)
+            continue;
+        levels.emplace_back(new level_t(sizes[i], nchannels_in,
+                                        nchannels_out, tail, engine));
+    }
+}
+
+MHAFilter::nonuniform_partitioned_convolution_t::
+~nonuniform_partitioned_convolution_t() = default;
+
+std::vector<unsigned int>
+MHAFilter::nonuniform_partitioned_convolution_t::get_partition_sizes() const
+{
+    std::vector<unsigned int> sizes;
+    for (const auto & level : levels)
+        sizes.push_back(level->get_partition_size());
+    return sizes;
+}
+
+unsigned long long
+MHAFilter::nonuniform_partitioned_convolution_t::get_num_waits() const
+{
+    unsigned long long waits = 0U;
+    for (const auto & level : levels)
+        waits += level->get_num_waits();
+    return waits;
+}
+
+mha_wave_t *
+MHAFilter::nonuniform_partitioned_convolution_t::process(const mha_wave_t * s_in)
+{
+    // The head checks the signal dimensions
+    output_signal_wave.copy(*head.process(s_in));
+    for (auto & level : levels)
+        level->process(*s_in, output_signal_wave);
+    return &output_signal_wave;
+}
+
 MHAFilter::resampling_filter_t::resampling_filter_t(unsigned int fftlen, unsigned int irslen, unsigned int channels, unsigned int Nup, unsigned int Ndown, double fCutOff)
     : MHAFilter::fftfilter_t(fragsize_validator(fftlen,irslen),channels,fftlen),
       fragsize(fragsize_validator(fftlen,irslen))
@@ -23,6 +23,8 @@
 #include "mha_windowparser.h"
 #include <valarray>
 #include <type_traits>
+#include <memory>
+#include <vector>
 /**
     \ingroup mhatoolbox
     \file mha_filter.hh
@@ -66,6 +68,13 @@ namespace MHAFilter {
         on mha_wave_t structs. The filter coefficients can be directly
         accessed.
 
+        Filters of order 1, 2 and 4 (equal number of recursive and
+        non-recursive coefficients 2, 3 or 5) are processed by kernels
+        specialized at compile time, which keep the filter state of
+        several channels in registers and iterate over channels in the
+        innermost loop.  They produce the same results as the generic
+        implementation.
+
         \todo Implement a more robust filter form.
     */
     class filter_t {
@@ -122,6 +131,18 @@ namespace MHAFilter {
            \param ch Channel number to use in filter state
         */
         mha_real_t filter(mha_real_t x,unsigned int ch);
+        /** \brief Filter parts of a waveform structure with the generic
+            implementation for any filter order.  Same parameters as
+            filter(mha_real_t*,const mha_real_t*,unsigned int,unsigned int,
+            unsigned int,unsigned int,unsigned int), for testing and
+            benchmarking the specialized kernels. */
+        void filter_generic(mha_real_t* dest,
+                            const mha_real_t* src,
+                            unsigned int dframes,
+                            unsigned int frame_dist,
+                            unsigned int channel_dist,
+                            unsigned int channel_begin,
+                            unsigned int channel_end);
         /** \brief Return length of recursive coefficients */
         unsigned int get_len_A() const {return len_A;};
         /** \brief Return length of non-recursive coefficients */
@@ -138,6 +159,47 @@ namespace MHAFilter {
         double* state;
     };
 
+    /**
+       \brief Cascade of second order sections (biquads)
+
+       Each section is a direct form II filter with the same arithmetic
+       as an iir_filter_state_t with 3 recursive and 3 non-recursive
+       coefficients, and the output of each section is the input of the
+       next one.  The result equals that of a chain of
+       iir_filter_state_t objects, but all sections share one state
+       buffer and use the specialized second order kernel.
+    */
+    class biquad_cascade_t {
+    public:
+        /**
+           \brief Constructor
+           \param channels Number of channels
+           \param sections Coefficients of each section in the order
+                  [b0 b1 b2 a0 a1 a2], as in second order section
+                  matrices of Matlab and Octave.
+           \throw MHA_Error if channels or the number of sections is 0, or
+                  if a section does not have 6 coefficients or a0 is 0.
+        */
+        biquad_cascade_t(unsigned int channels,
+                         const std::vector<std::vector<mha_real_t> >& sections);
+        /** \brief Filter all channels of a waveform.  In-place
+            processing is possible.
+            \param out Output signal
+            \param in Input signal */
+        void filter(mha_wave_t* out, const mha_wave_t* in);
+        /** \brief Set the filter states to zero. */
+        void reset();
+        /** \brief Number of second order sections */
+        unsigned int get_num_sections() const {return num_sections;}
+    private:
+        unsigned int channels;
+        unsigned int num_sections;
+        /** Coefficients, 6 per section: b0 b1 b2 a0 a1 a2 */
+        std::vector<double> coeffs;
+        /** Filter states, section-major, then delay, then channel */
+        std::vector<double> state;
+    };
+
     /**
        \brief Differentiator class (non-normalized)
      */
@@ -220,9 +282,20 @@ namespace MHAFilter {
             MHA_assert_equal(in.num_channels,num_channels);
             MHA_assert_equal(in.num_channels,out.num_channels);
             MHA_assert_equal(in.num_frames,out.num_frames);
-            for(unsigned int k=0;k<in.num_frames;k++)
-                for(unsigned int ch=0;ch<in.num_channels;ch++)
-                    ::value(out,k,ch) = operator()(ch,::value(in,k,ch));
+            // Same computation as operator()(ch,x), without the channel
+            // range check for every sample.  in and out may be the same.
+            for(unsigned int k=0;k<in.num_frames;k++){
+                const mha_real_t * x = in.buf + k*num_channels;
+                mha_real_t * y = out.buf + k*num_channels;
+                for(unsigned int ch=0;ch<num_channels;ch++){
+                    if( x[ch] >= buf[ch] )
+                        buf[ch] = c1_a.buf[ch] * buf[ch] + c2_a.buf[ch] * x[ch];
+                    else
+                        buf[ch] = c1_r.buf[ch] * buf[ch] + c2_r.buf[ch] * x[ch];
+                    MHAFilter::make_friendly_number( buf[ch] );
+                    y[ch] = buf[ch];
+                }
+            }
         };
     protected:
         MHASignal::waveform_t c1_a;
@@ -645,12 +718,28 @@ namespace MHAFilter {
             }
     };
 
+    /** Processing schemes of partitioned_convolution_t */
+    enum class partitioned_convolution_engine_t {
+        /** The products of each input spectrum with all impulse
+         * response partitions are added to a delay line of output
+         * spectra. */
+        OUTPUT_DELAY_LINE,
+        /** The input spectra of the past blocks are kept in a
+         * frequency-domain delay line, and each output spectrum is
+         * accumulated in one pass from contiguous arrays of real and
+         * imaginary parts with MHASignal::mac_split. */
+        FREQUENCY_DOMAIN_DELAY_LINE
+    };
+
     /**
      * A filter class for partitioned convolution.
      * Impulse responses are partitioned into sections of fragment size.
      * Audio signal is convolved with every partition and delayed as needed.
      * Convolution is done according to overlap-save.
      * FFT length used is 2 times fragment size.
+     * Two processing schemes with equal results are available, see
+     * partitioned_convolution_engine_t.  The frequency-domain delay
+     * line is faster for large transfer matrices.
      */
     class partitioned_convolution_t {
     public:
@@ -664,11 +753,16 @@ namespace MHAFilter {
          *    Number of output audio channels.
          * @param transfer
          *    A sparse matrix of impulse responses.
+         * @param engine
+         *    Processing scheme.
          */ 
         partitioned_convolution_t(unsigned int fragsize,
                                   unsigned int nchannels_in,
                                   unsigned int nchannels_out,
-                                  const transfer_matrix_t & transfer);
+                                  const transfer_matrix_t & transfer,
+                                  partitioned_convolution_engine_t engine =
+                                  partitioned_convolution_engine_t::
+                                  OUTPUT_DELAY_LINE);
 
         /** Free fftw resource allocated in constructor */
         ~partitioned_convolution_t();
@@ -753,7 +847,8 @@ namespace MHAFilter {
         /** Buffers for FFT transformed output signal.  For each array
          * member, Number of channels is equal to nchannels_out,
          * number of frames (fft bins) is equal to fragsize+1.
-         * Array size is equal to output_partitions. */
+         * Array size is equal to output_partitions, or 1 for the
+         * frequency-domain delay line. */
         std::vector<MHASignal::spectrum_t> output_signal_spec;
         
         /** A counter modulo output_partitions, indexing the "current"
@@ -768,10 +863,141 @@ namespace MHAFilter {
         /** The FFT transformer */
         mha_fft_t fft;
 
+        /** The processing scheme */
+        partitioned_convolution_engine_t engine;
+
+        /** Frequency-domain delay line, real parts.  Holds the input
+         * spectra of the last output_partitions blocks.  Index is
+         * ((channel * output_partitions) + slot) * (fragsize+1) + bin.
+         * Empty unless engine is FREQUENCY_DOMAIN_DELAY_LINE. */
+        std::vector<mha_real_t> fdl_re;
+
+        /** Frequency-domain delay line, imaginary parts. */
+        std::vector<mha_real_t> fdl_im;
+
+        /** Slot of the newest input spectrum in the delay line. */
+        unsigned int fdl_slot;
+
+        /** Real parts of frequency_response, index
+         * partition * (fragsize+1) + bin. */
+        std::vector<mha_real_t> fdl_response_re;
+
+        /** Imaginary parts of frequency_response. */
+        std::vector<mha_real_t> fdl_response_im;
+
+        /** Filter partition indices sorted by target channel and by
+         * decreasing delay, which adds the products in the same order
+         * as the output delay line. */
+        std::vector<unsigned int> fdl_order;
+
+        /** Accumulator of one output spectrum, real parts. */
+        std::vector<mha_real_t> fdl_acc_re;
+
+        /** Accumulator of one output spectrum, imaginary parts. */
+        std::vector<mha_real_t> fdl_acc_im;
+
         /** processing */
         mha_wave_t * process(const mha_wave_t * s_in);
+    private:
+        /** Filtering with the frequency-domain delay line, fills
+         * output_signal_spec[0] from input_signal_spec. */
+        void process_fdl();
     };
-    
+
+    /**
+     * A filter class for partitioned convolution with non-uniform
+     * partition sizes, for long impulse responses.
+     *
+     * The head of the impulse responses, up to 8 times the fragment
+     * size, is convolved in the signal processing thread by a
+     * partitioned_convolution_t with partitions of fragment size, so
+     * that no latency is added.  The tail is divided into levels.
+     * Level i uses partitions of size L_i = 4^i * fragsize, for i = 1,
+     * 2, ..., up to max_partition_size, and covers the impulse
+     * response samples from 2*L_i to 2*L_(i+1).  The last level covers
+     * the remaining impulse response.
+     *
+     * Each level is convolved by a partitioned_convolution_t with
+     * block size L_i, executed by a worker thread of this level.  The
+     * signal processing thread passes each completed input block of
+     * L_i samples to the worker thread, which then has the duration of
+     * L_i samples to compute the convolution, because the result is
+     * first needed 2*L_i samples after the start of the block.  The
+     * signal processing thread waits for the worker only if it has not
+     * finished when its deadline is reached; these waits are counted.
+     * The worker threads use the default scheduling policy of the
+     * process and therefore run with lower priority than a real-time
+     * signal processing thread.
+     *
+     * The output is identical to partitioned_convolution_t within
+     * numerical precision.
+     */
+    class nonuniform_partitioned_convolution_t {
+    public:
+        /**
+         * Create a new non-uniform partitioned convolver and start the
+         * worker threads.
+         * @param fragsize
+         *    Audio fragment size, equal to the partition size of the head.
+         * @param nchannels_in
+         *    Number of input audio channels.
+         * @param nchannels_out
+         *    Number of output audio channels.
+         * @param transfer
+         *    A sparse matrix of impulse responses.
+         * @param max_partition_size
+         *    Upper limit for the partition size of the tail levels in
+         *    samples.  If less than 4*fragsize, no tail levels are
+         *    created and the whole impulse responses are convolved in
+         *    the signal processing thread.
+         * @param engine
+         *    Processing scheme of the head and of all levels.
+         */
+        nonuniform_partitioned_convolution_t(unsigned int fragsize,
+                                             unsigned int nchannels_in,
+                                             unsigned int nchannels_out,
+                                             const transfer_matrix_t & transfer,
+                                             unsigned int max_partition_size,
+                                             partitioned_convolution_engine_t
+                                             engine =
+                                             partitioned_convolution_engine_t::
+                                             OUTPUT_DELAY_LINE);
+
+        /** Terminate the worker threads. */
+        ~nonuniform_partitioned_convolution_t();
+
+        /** processing */
+        mha_wave_t * process(const mha_wave_t * s_in);
+
+        /** Number of tail levels with worker threads. */
+        unsigned int get_num_levels() const {return levels.size();}
+
+        /** Partition sizes of the tail levels in samples. */
+        std::vector<unsigned int> get_partition_sizes() const;
+
+        /** Number of times the signal processing thread had to wait
+         * for a worker thread.  Signal processing thread only. */
+        unsigned long long get_num_waits() const;
+
+        /** Extract the samples [begin, end) of all impulse responses.
+         * @param transfer A sparse matrix of impulse responses.
+         * @param begin Index of the first impulse response sample.
+         * @param end Index after the last impulse response sample.
+         * @return A transfer matrix with the same channel indices and
+         *   shortened impulse responses, which may be empty. */
+        static transfer_matrix_t segment(const transfer_matrix_t & transfer,
+                                         unsigned int begin,
+                                         unsigned int end);
+    private:
+        class level_t;
+        /** Convolves the head of the impulse responses */
+        partitioned_convolution_t head;
+        /** Tail levels in order of increasing partition size */
+        std::vector<std::unique_ptr<level_t> > levels;
+        /** Sum of head and tail outputs */
+        MHASignal::waveform_t output_signal_wave;
+    };
+
     /**
        \brief Smooth spectral gains, create a windowed impulse response.
 
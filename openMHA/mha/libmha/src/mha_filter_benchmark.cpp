@@ -0,0 +1,130 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file mha_filter_benchmark.cpp
+ * Compares the order specialized kernels of MHAFilter::filter_t with
+ * the generic implementation for filters of order 1, 2, and 4 and
+ * different numbers of channels, and a cascade of second order
+ * sections (MHAFilter::biquad_cascade_t) with a chain of second order
+ * filter_t objects processed by the generic implementation.  Reported
+ * is the processing time per block in ns.
+ *
+ * Usage: mha_filter_benchmark [fragsize [seconds_per_measurement]]
+ */
+
+#include "mha_filter.hh"
+#include "mha_latency_histogram.hh"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+    /** Mean time per call of process in ns */
+    template <class F>
+    double time_per_block(double seconds, F process)
+    {
+        for (unsigned k = 0; k < 100; ++k)
+            process();
+        unsigned long blocks = 0;
+        const uint64_t start = MHAProfiling::now_ns();
+        uint64_t elapsed = 0;
+        do {
+            for (unsigned k = 0; k < 64; ++k)
+                process();
+            blocks += 64;
+            elapsed = MHAProfiling::now_ns() - start;
+        } while (elapsed < seconds * 1e9);
+        return double(elapsed) / blocks;
+    }
+
+    /** Coefficients of a stable filter: all poles at 0.5 */
+    void coefficients(unsigned order, std::vector<mha_real_t> & A,
+                      std::vector<mha_real_t> & B)
+    {
+        A.assign(1, 1.0f);
+        for (unsigned k = 0; k < order; ++k) {
+            A.push_back(0.0f);
+            for (unsigned n = A.size() - 1U; n > 0U; --n)
+                A[n] -= 0.5f * A[n - 1U];
+        }
+        B.assign(order + 1U, 1.0f / (order + 1U));
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const unsigned fragsize = argc > 1 ? atoi(argv[1]) : 64U;
+    const double seconds = argc > 2 ? atof(argv[2]) : 0.5;
+    printf("filter_t, fragsize %u, ns per block\n", fragsize);
+    printf("%6s %9s %10s %12s %8s\n", "order", "channels", "generic",
+           "specialized", "speedup");
+    for (unsigned order : {1U, 2U, 4U})
+        for (unsigned channels : {1U, 2U, 4U, 8U}) {
+            std::vector<mha_real_t> A, B;
+            coefficients(order, A, B);
+            MHAFilter::filter_t filter(channels, A, B);
+            MHASignal::waveform_t in(fragsize, channels), out(in);
+            for (unsigned k = 0; k < fragsize * channels; ++k)
+                in.buf[k] = std::sin(0.1 * k);
+            const double generic = time_per_block(seconds, [&]() {
+                filter.filter_generic(out.buf, in.buf, fragsize, channels, 1,
+                                      0, channels);
+            });
+            const double specialized = time_per_block(seconds, [&]() {
+                filter.filter(&out, &in);
+            });
+            printf("%6u %9u %10.0f %12.0f %7.2fx\n", order, channels,
+                   generic, specialized, generic / specialized);
+        }
+
+    printf("\n4 second order sections, fragsize %u, ns per block\n",
+           fragsize);
+    printf("%9s %10s %12s %8s\n", "channels", "chain", "cascade", "speedup");
+    for (unsigned channels : {1U, 2U, 4U, 8U}) {
+        std::vector<mha_real_t> A, B;
+        coefficients(2U, A, B);
+        std::vector<MHAFilter::filter_t> chain;
+        std::vector<std::vector<mha_real_t> > sos;
+        for (unsigned k = 0; k < 4U; ++k) {
+            chain.emplace_back(channels, A, B);
+            sos.push_back({B[0], B[1], B[2], A[0], A[1], A[2]});
+        }
+        MHAFilter::biquad_cascade_t cascade(channels, sos);
+        MHASignal::waveform_t in(fragsize, channels), out(in);
+        for (unsigned k = 0; k < fragsize * channels; ++k)
+            in.buf[k] = std::sin(0.1 * k);
+        const double generic = time_per_block(seconds, [&]() {
+            chain[0].filter_generic(out.buf, in.buf, fragsize, channels, 1,
+                                    0, channels);
+            for (unsigned k = 1; k < chain.size(); ++k)
+                chain[k].filter_generic(out.buf, out.buf, fragsize, channels,
+                                        1, 0, channels);
+        });
+        const double specialized = time_per_block(seconds, [&]() {
+            cascade.filter(&out, &in);
+        });
+        printf("%9u %10.0f %12.0f %7.2fx\n", channels, generic, specialized,
+               generic / specialized);
+    }
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
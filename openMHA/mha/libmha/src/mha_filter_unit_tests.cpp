@@ -154,3 +154,254 @@ TEST(o1flt_maxtrack_t, decay_many_samples) {
     maxtrack(0,0);
   ASSERT_NEAR(1/expf(1), maxtrack(0,0), 0.001);
 }
+
+namespace {
+  /// Two inputs, two outputs, full matrix of pseudo-random impulse
+  /// responses of ir_length samples
+  MHAFilter::transfer_matrix_t random_transfer(unsigned ir_length)
+  {
+    MHAFilter::transfer_matrix_t transfer;
+    unsigned seed = 1U;
+    for (unsigned src = 0; src < 2U; ++src)
+      for (unsigned tgt = 0; tgt < 2U; ++tgt) {
+        std::vector<float> ir(ir_length);
+        for (auto & coeff : ir) {
+          seed = seed * 1103515245U + 12345U;
+          coeff = ((seed >> 16) % 2001U - 1000.0f) * 1e-5f;
+        }
+        transfer.push_back(MHAFilter::transfer_function_t(src, tgt, ir));
+      }
+    return transfer;
+  }
+
+  /// Filter pseudo-random noise with both convolvers and compare
+  template <class convolver_t>
+  void expect_same_output(MHAFilter::partitioned_convolution_t & uniform,
+                          convolver_t & nonuniform,
+                          unsigned fragsize, unsigned blocks, float tolerance)
+  {
+    MHASignal::waveform_t in(fragsize, 2U);
+    unsigned seed = 7U;
+    for (unsigned block = 0; block < blocks; ++block) {
+      for (unsigned k = 0; k < in.num_frames * in.num_channels; ++k) {
+        seed = seed * 1103515245U + 12345U;
+        in.buf[k] = ((seed >> 16) % 2001U - 1000.0f) * 1e-3f;
+      }
+      const mha_wave_t * expected = uniform.process(&in);
+      const mha_wave_t * actual = nonuniform.process(&in);
+      ASSERT_EQ(expected->num_frames, actual->num_frames);
+      ASSERT_EQ(expected->num_channels, actual->num_channels);
+      for (unsigned k = 0; k < fragsize * 2U; ++k)
+        ASSERT_NEAR(expected->buf[k], actual->buf[k], tolerance)
+          << "block " << block << " index " << k;
+    }
+  }
+}
+
+TEST(nonuniform_partitioned_convolution_t, without_tail_equals_uniform)
+{
+  const auto transfer = random_transfer(300);
+  MHAFilter::partitioned_convolution_t uniform(16, 2, 2, transfer);
+  MHAFilter::nonuniform_partitioned_convolution_t nonuniform(16, 2, 2,
+                                                             transfer, 32);
+  EXPECT_EQ(0U, nonuniform.get_num_levels());
+  expect_same_output(uniform, nonuniform, 16, 50, 0.0f);
+}
+
+TEST(nonuniform_partitioned_convolution_t, tail_levels_equal_uniform)
+{
+  const auto transfer = random_transfer(3000);
+  MHAFilter::partitioned_convolution_t uniform(16, 2, 2, transfer);
+  MHAFilter::nonuniform_partitioned_convolution_t nonuniform(16, 2, 2,
+                                                             transfer, 1024);
+  // Levels start at 128, 512, and 2048 samples
+  EXPECT_EQ(std::vector<unsigned>({64U, 256U, 1024U}),
+            nonuniform.get_partition_sizes());
+  expect_same_output(uniform, nonuniform, 16, 600, 1e-4f);
+}
+
+TEST(nonuniform_partitioned_convolution_t, levels_end_with_impulse_response)
+{
+  const auto transfer = random_transfer(600);
+  MHAFilter::nonuniform_partitioned_convolution_t nonuniform(16, 2, 2,
+                                                             transfer, 4096);
+  // A level of 1024 samples would start after the impulse response
+  EXPECT_EQ(std::vector<unsigned>({64U, 256U}),
+            nonuniform.get_partition_sizes());
+}
+
+TEST(nonuniform_partitioned_convolution_t, skips_levels_containing_zeros)
+{
+  auto transfer = random_transfer(3000);
+  for (auto & tf : transfer)
+    for (unsigned k = 128; k < 512; ++k)
+      tf.impulse_response[k] = 0.0f;
+  MHAFilter::partitioned_convolution_t uniform(16, 2, 2, transfer);
+  MHAFilter::nonuniform_partitioned_convolution_t nonuniform(16, 2, 2,
+                                                             transfer, 1024);
+  EXPECT_EQ(std::vector<unsigned>({256U, 1024U}),
+            nonuniform.get_partition_sizes());
+  expect_same_output(uniform, nonuniform, 16, 300, 1e-4f);
+}
+
+TEST(nonuniform_partitioned_convolution_t, segment_shortens_impulse_responses)
+{
+  MHAFilter::transfer_matrix_t transfer;
+  transfer.push_back(MHAFilter::transfer_function_t(1, 0, {1,2,3,4,5}));
+  transfer.push_back(MHAFilter::transfer_function_t(0, 1, {1,2}));
+  auto seg =
+    MHAFilter::nonuniform_partitioned_convolution_t::segment(transfer, 1, 4);
+  ASSERT_EQ(2U, seg.size());
+  EXPECT_EQ(1U, seg[0].source_channel_index);
+  EXPECT_EQ(0U, seg[0].target_channel_index);
+  EXPECT_EQ(std::vector<float>({2,3,4}), seg[0].impulse_response);
+  EXPECT_EQ(std::vector<float>({2}), seg[1].impulse_response);
+  seg = MHAFilter::nonuniform_partitioned_convolution_t::segment(transfer, 3, 9);
+  EXPECT_EQ(std::vector<float>({4,5}), seg[0].impulse_response);
+  EXPECT_TRUE(seg[1].impulse_response.empty());
+}
+
+TEST(partitioned_convolution_t, frequency_domain_delay_line_equals_output_delay_line)
+{
+  auto transfer = random_transfer(200);
+  // Sparse matrix: an empty partition, a second filter for the same
+  // channel pair, and an output channel without filters
+  for (unsigned k = 32; k < 64; ++k)
+    transfer[1].impulse_response[k] = 0.0f;
+  transfer.push_back(transfer[2]);
+  transfer.back().impulse_response.resize(40);
+  MHAFilter::partitioned_convolution_t odl(16, 2, 3, transfer);
+  MHAFilter::partitioned_convolution_t
+    fdl(16, 2, 3, transfer,
+        MHAFilter::partitioned_convolution_engine_t::FREQUENCY_DOMAIN_DELAY_LINE);
+  EXPECT_EQ(odl.filter_partitions, fdl.filter_partitions);
+  MHASignal::waveform_t in(16, 2);
+  unsigned seed = 3U;
+  for (unsigned block = 0; block < 40; ++block) {
+    for (unsigned k = 0; k < in.num_frames * in.num_channels; ++k) {
+      seed = seed * 1103515245U + 12345U;
+      in.buf[k] = ((seed >> 16) % 2001U - 1000.0f) * 1e-3f;
+    }
+    const mha_wave_t * expected = odl.process(&in);
+    const mha_wave_t * actual = fdl.process(&in);
+    ASSERT_EQ(3U, actual->num_channels);
+    for (unsigned k = 0; k < 16U * 3U; ++k)
+      ASSERT_NEAR(expected->buf[k], actual->buf[k], 1e-5f)
+        << "block " << block << " index " << k;
+  }
+}
+
+TEST(nonuniform_partitioned_convolution_t, frequency_domain_delay_line_in_all_levels)
+{
+  const auto transfer = random_transfer(1500);
+  MHAFilter::partitioned_convolution_t uniform(16, 2, 2, transfer);
+  MHAFilter::nonuniform_partitioned_convolution_t
+    nonuniform(16, 2, 2, transfer, 256,
+               MHAFilter::partitioned_convolution_engine_t::
+               FREQUENCY_DOMAIN_DELAY_LINE);
+  EXPECT_EQ(std::vector<unsigned>({64U, 256U}),
+            nonuniform.get_partition_sizes());
+  expect_same_output(uniform, nonuniform, 16, 200, 1e-4f);
+}
+
+namespace {
+  /** Random coefficients of a stable filter with the given order:
+   * product of first order sections with poles inside the unit circle */
+  void stable_coefficients(unsigned order, unsigned seed,
+                           std::vector<mha_real_t> & A,
+                           std::vector<mha_real_t> & B)
+  {
+    std::vector<double> a(1, 1.0);
+    for (unsigned k = 0; k < order; ++k) {
+      seed = seed * 1103515245U + 12345U;
+      const double pole = ((seed >> 16) % 1801U) * 1e-3 - 0.9;
+      a.push_back(0.0);
+      for (unsigned n = a.size() - 1U; n > 0U; --n)
+        a[n] -= pole * a[n - 1U];
+    }
+    A.assign(a.begin(), a.end());
+    B.clear();
+    for (unsigned k = 0; k <= order; ++k) {
+      seed = seed * 1103515245U + 12345U;
+      B.push_back(((seed >> 16) % 2001U) * 1e-3f - 1.0f);
+    }
+  }
+
+  MHASignal::waveform_t noise(unsigned frames, unsigned channels,
+                              unsigned seed)
+  {
+    MHASignal::waveform_t s(frames, channels);
+    for (unsigned k = 0; k < frames * channels; ++k) {
+      seed = seed * 1103515245U + 12345U;
+      s.buf[k] = ((seed >> 16) % 2001U) * 1e-3f - 1.0f;
+    }
+    return s;
+  }
+}
+
+TEST(filter_t, specialized_orders_equal_generic_implementation)
+{
+  for (unsigned order : {1U, 2U, 3U, 4U})
+    for (unsigned channels : {1U, 2U, 3U, 4U, 5U, 8U, 9U}) {
+      std::vector<mha_real_t> A, B;
+      stable_coefficients(order, order * 10U + channels, A, B);
+      A[0] = order == 2U ? 2.0f : 1.0f; // also test normalization
+      MHAFilter::filter_t specialized(channels, A, B);
+      MHAFilter::filter_t generic(channels, A, B);
+      MHASignal::waveform_t out(64, channels), expected(64, channels);
+      for (unsigned block = 0; block < 4; ++block) {
+        auto in = noise(64, channels, block);
+        in.buf[3] = std::numeric_limits<mha_real_t>::infinity();
+        in.buf[5] = std::numeric_limits<mha_real_t>::denorm_min();
+        specialized.filter(&out, &in);
+        generic.filter_generic(expected.buf, in.buf, 64, channels, 1,
+                               0, channels);
+        for (unsigned k = 0; k < 64 * channels; ++k)
+          ASSERT_EQ(expected.buf[k], out.buf[k])
+            << "order " << order << ", " << channels << " channels, block "
+            << block << ", index " << k;
+      }
+      // single samples use the same state as whole blocks
+      EXPECT_EQ(generic.filter(0.5f, channels - 1U),
+                specialized.filter(0.5f, channels - 1U));
+    }
+}
+
+TEST(biquad_cascade_t, equals_chain_of_second_order_filters)
+{
+  const unsigned channels = 6, sections = 3;
+  std::vector<std::vector<mha_real_t> > sos;
+  std::vector<MHAFilter::iir_filter_state_t> chain;
+  for (unsigned k = 0; k < sections; ++k) {
+    std::vector<mha_real_t> A, B;
+    stable_coefficients(2, k + 1U, A, B);
+    for (auto & a : A)
+      a *= 0.5f; // a0 = 0.5 is normalized
+    chain.emplace_back(channels, A, B);
+    sos.push_back({B[0], B[1], B[2], A[0], A[1], A[2]});
+  }
+  MHAFilter::biquad_cascade_t cascade(channels, sos);
+  EXPECT_EQ(sections, cascade.get_num_sections());
+  for (unsigned block = 0; block < 3; ++block) {
+    auto in = noise(48, channels, block + 7U);
+    MHASignal::waveform_t expected(in);
+    for (auto & section : chain)
+      section.filter(&expected, &expected);
+    cascade.filter(&in, &in); // in place
+    for (unsigned k = 0; k < 48 * channels; ++k)
+      ASSERT_EQ(expected.buf[k], in.buf[k]) << "block " << block
+                                            << ", index " << k;
+  }
+  cascade.reset();
+  auto impulse = noise(1, channels, 1);
+  MHASignal::waveform_t fresh(impulse);
+  MHAFilter::biquad_cascade_t(channels, sos).filter(&fresh, &fresh);
+  cascade.filter(&impulse, &impulse);
+  for (unsigned ch = 0; ch < channels; ++ch)
+    EXPECT_EQ(fresh.buf[ch], impulse.buf[ch]);
+  EXPECT_THROW(MHAFilter::biquad_cascade_t(channels, {{1, 0, 0, 1, 0}}),
+               MHA_Error);
+  EXPECT_THROW(MHAFilter::biquad_cascade_t(channels, {{1, 0, 0, 0, 0, 0}}),
+               MHA_Error);
+  EXPECT_THROW(MHAFilter::biquad_cascade_t(0, sos), MHA_Error);
+}
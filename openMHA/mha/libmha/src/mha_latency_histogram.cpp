@@ -0,0 +1,79 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_latency_histogram.hh"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace MHAProfiling {
+
+    latency_histogram_t::latency_histogram_t()
+        : deadline(0U)
+    {
+        reset();
+    }
+
+    void latency_histogram_t::reset()
+    {
+        for (auto & bin : bins)
+            bin.store(0U);
+        count.store(0U);
+        overruns.store(0U);
+        min.store(std::numeric_limits<uint64_t>::max());
+        max.store(0U);
+    }
+
+    uint64_t latency_histogram_t::get_min() const
+    {
+        const uint64_t m = min.load();
+        return m == std::numeric_limits<uint64_t>::max() ? 0U : m;
+    }
+
+    uint64_t latency_histogram_t::get_percentile(double p) const
+    {
+        // Sum the bins instead of using count, so that the result is
+        // consistent with the bins read while the writer is active.
+        uint64_t total = 0U;
+        for (const auto & bin : bins)
+            total += bin.load(std::memory_order_relaxed);
+        if (total == 0U)
+            return 0U;
+        p = std::min(std::max(p, 0.0), 100.0);
+        const uint64_t rank =
+            std::max<uint64_t>(1U, std::ceil(p / 100.0 * total));
+        // The extreme ranks are known exactly
+        if (rank == 1U)
+            return get_min();
+        if (rank >= total)
+            return get_max();
+        uint64_t cumulative = 0U;
+        unsigned k = 0U;
+        for (; k < num_bins - 1U; ++k) {
+            cumulative += bins[k].load(std::memory_order_relaxed);
+            if (cumulative >= rank)
+                break;
+        }
+        const uint64_t center = bin_lower_edge(k) + bin_width(k) / 2U;
+        return std::min(std::max(center, get_min()), get_max());
+    }
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
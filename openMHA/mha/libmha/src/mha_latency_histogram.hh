@@ -0,0 +1,157 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_LATENCY_HISTOGRAM_HH
+#define MHA_LATENCY_HISTOGRAM_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/** \defgroup mhaprofiling Profiling of the signal processing
+
+    Tools for measuring the processing time of the signal processing
+    callbacks with low overhead, so that profiling can stay enabled
+    during normal operation.
+*/
+
+namespace MHAProfiling {
+
+    /** \ingroup mhaprofiling
+        \brief Monotonic time stamp in nanoseconds.
+
+        Uses std::chrono::steady_clock, which is served by
+        clock_gettime(CLOCK_MONOTONIC) through the vDSO on Linux and does
+        not enter the kernel.  Real-time safe. */
+    inline uint64_t now_ns() noexcept
+    {
+        return static_cast<uint64_t>
+            (std::chrono::duration_cast<std::chrono::nanoseconds>
+             (std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /** \ingroup mhaprofiling
+        \brief Histogram of durations with logarithmically spaced bins.
+
+        Each octave of durations is divided into sub_bins bins of equal
+        width, durations below sub_bins nanoseconds have their own bins.
+        The width of a bin is therefore at most 1/sub_bins of its lower
+        edge, and percentiles are reported with a relative error below
+        1/(2*sub_bins).  Durations up to 2^64 ns fit into the histogram.
+
+        add() is called by a single writer, usually the signal
+        processing thread.  It does not lock, allocate or use atomic
+        read-modify-write instructions.  The getters can be called
+        concurrently from any other thread, e.g. the configuration
+        thread.  They see a consistent state when the writer is idle
+        and a state that is at most a few samples off otherwise. */
+    class latency_histogram_t {
+    public:
+        /** Number of bins per octave, a power of two. */
+        static constexpr unsigned sub_bins_log2 = 4U;
+        static constexpr unsigned sub_bins = 1U << sub_bins_log2;
+        /** Total number of bins. */
+        static constexpr unsigned num_bins =
+            (64U - sub_bins_log2 + 1U) * sub_bins;
+
+        latency_histogram_t();
+        latency_histogram_t(const latency_histogram_t &) = delete;
+        latency_histogram_t & operator=(const latency_histogram_t &) = delete;
+
+        /** Clear all counters.  Must not be called while add() may
+            execute concurrently. */
+        void reset();
+
+        /** Set the deadline for counting overruns.
+            \param ns Deadline in nanoseconds, 0 disables overrun
+                      counting. */
+        void set_deadline(uint64_t ns) {deadline.store(ns);}
+
+        /** Record one duration.  Single writer only.  Real-time safe.
+            \param ns Duration in nanoseconds. */
+        void add(uint64_t ns) noexcept {
+            increment(bins[bin_index(ns)]);
+            increment(count);
+            if (ns < min.load(std::memory_order_relaxed))
+                min.store(ns, std::memory_order_relaxed);
+            if (ns > max.load(std::memory_order_relaxed))
+                max.store(ns, std::memory_order_relaxed);
+            const uint64_t d = deadline.load(std::memory_order_relaxed);
+            if (d && ns > d)
+                increment(overruns);
+        }
+
+        /** Number of recorded durations. */
+        uint64_t get_count() const {return count.load();}
+        /** Number of recorded durations longer than the deadline. */
+        uint64_t get_overruns() const {return overruns.load();}
+        /** Shortest recorded duration in ns, 0 if nothing was recorded. */
+        uint64_t get_min() const;
+        /** Longest recorded duration in ns, 0 if nothing was recorded. */
+        uint64_t get_max() const {return max.load();}
+
+        /** Estimate a percentile of the recorded durations.
+            \param p Percentile in percent, 0 to 100.
+            \return Center of the bin containing the percentile,
+                    limited to the range [get_min(), get_max()],
+                    in ns.  0 if nothing was recorded. */
+        uint64_t get_percentile(double p) const;
+
+        /** Index of the bin for a duration. */
+        static unsigned bin_index(uint64_t ns) noexcept {
+            if (ns < sub_bins)
+                return static_cast<unsigned>(ns);
+            const unsigned octave = 63U - __builtin_clzll(ns);
+            const unsigned shift = octave - sub_bins_log2;
+            return (shift + 1U) * sub_bins
+                + static_cast<unsigned>((ns >> shift) & (sub_bins - 1U));
+        }
+
+        /** Smallest duration in ns that falls into bin k. */
+        static uint64_t bin_lower_edge(unsigned k) {
+            if (k < sub_bins)
+                return k;
+            const unsigned shift = k / sub_bins - 1U;
+            return uint64_t(sub_bins + k % sub_bins) << shift;
+        }
+
+        /** Width of bin k in ns. */
+        static uint64_t bin_width(unsigned k) {
+            return k < sub_bins ? 1U : uint64_t(1U) << (k / sub_bins - 1U);
+        }
+    private:
+        /** Increment without a locked instruction, the writer is the
+            only thread modifying the counters. */
+        static void increment(std::atomic<uint64_t> & c) noexcept {
+            c.store(c.load(std::memory_order_relaxed) + 1U,
+                    std::memory_order_relaxed);
+        }
+        std::atomic<uint64_t> bins[num_bins];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> overruns;
+        std::atomic<uint64_t> min;
+        std::atomic<uint64_t> max;
+        std::atomic<uint64_t> deadline;
+    };
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,118 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_latency_histogram.hh"
+#include <gtest/gtest.h>
+#include <memory>
+
+using MHAProfiling::latency_histogram_t;
+
+TEST(latency_histogram_t, bins_cover_all_durations_without_gaps)
+{
+  EXPECT_EQ(0U, latency_histogram_t::bin_index(0U));
+  EXPECT_EQ(15U, latency_histogram_t::bin_index(15U));
+  EXPECT_EQ(16U, latency_histogram_t::bin_index(16U));
+  EXPECT_EQ(latency_histogram_t::num_bins - 1U,
+            latency_histogram_t::bin_index(~uint64_t(0U)));
+  for (unsigned k = 0U; k + 1U < latency_histogram_t::num_bins; ++k) {
+    const uint64_t edge = latency_histogram_t::bin_lower_edge(k);
+    const uint64_t width = latency_histogram_t::bin_width(k);
+    ASSERT_EQ(k, latency_histogram_t::bin_index(edge));
+    ASSERT_EQ(k, latency_histogram_t::bin_index(edge + width - 1U));
+    ASSERT_EQ(edge + width, latency_histogram_t::bin_lower_edge(k + 1U));
+    // Relative bin width is bounded by 1/sub_bins
+    ASSERT_LE(width * latency_histogram_t::sub_bins,
+              std::max<uint64_t>(edge, 16U));
+  }
+}
+
+TEST(latency_histogram_t, empty_histogram_reports_zero)
+{
+  auto h = std::make_unique<latency_histogram_t>();
+  EXPECT_EQ(0U, h->get_count());
+  EXPECT_EQ(0U, h->get_min());
+  EXPECT_EQ(0U, h->get_max());
+  EXPECT_EQ(0U, h->get_percentile(50));
+  EXPECT_EQ(0U, h->get_overruns());
+}
+
+TEST(latency_histogram_t, percentiles_are_accurate_within_bin_width)
+{
+  auto h = std::make_unique<latency_histogram_t>();
+  // 1000 durations of 1 µs ... 1 ms
+  for (uint64_t k = 1U; k <= 1000U; ++k)
+    h->add(k * 1000U);
+  EXPECT_EQ(1000U, h->get_count());
+  EXPECT_EQ(1000U, h->get_min());
+  EXPECT_EQ(1000000U, h->get_max());
+  EXPECT_NEAR(500000.0, h->get_percentile(50), 500000.0 / 32);
+  EXPECT_NEAR(990000.0, h->get_percentile(99), 990000.0 / 32);
+  EXPECT_NEAR(999000.0, h->get_percentile(99.9), 999000.0 / 32);
+  EXPECT_EQ(1000U, h->get_percentile(0));
+  EXPECT_EQ(1000000U, h->get_percentile(100));
+}
+
+TEST(latency_histogram_t, single_outlier_shows_only_in_tail)
+{
+  auto h = std::make_unique<latency_histogram_t>();
+  for (unsigned k = 0U; k < 9995U; ++k)
+    h->add(2000U);
+  for (unsigned k = 0U; k < 5U; ++k)
+    h->add(5000000U);
+  EXPECT_NEAR(2000.0, h->get_percentile(50), 2000.0 / 32);
+  EXPECT_NEAR(2000.0, h->get_percentile(99.9), 2000.0 / 32);
+  EXPECT_EQ(5000000U, h->get_percentile(99.99));
+  EXPECT_EQ(5000000U, h->get_max());
+}
+
+TEST(latency_histogram_t, counts_deadline_overruns_and_resets)
+{
+  auto h = std::make_unique<latency_histogram_t>();
+  h->add(3000U);
+  EXPECT_EQ(0U, h->get_overruns()); // no deadline set
+  h->set_deadline(1000U);
+  h->add(999U);
+  h->add(1000U);
+  h->add(1001U);
+  h->add(5000U);
+  EXPECT_EQ(2U, h->get_overruns());
+  EXPECT_EQ(5U, h->get_count());
+  h->reset();
+  EXPECT_EQ(0U, h->get_count());
+  EXPECT_EQ(0U, h->get_overruns());
+  EXPECT_EQ(0U, h->get_max());
+  h->add(1500U); // deadline survives reset
+  EXPECT_EQ(1U, h->get_overruns());
+  EXPECT_EQ(1500U, h->get_min());
+}
+
+TEST(latency_histogram_t, now_ns_is_monotonic)
+{
+  uint64_t previous = MHAProfiling::now_ns();
+  for (unsigned k = 0U; k < 1000U; ++k) {
+    const uint64_t t = MHAProfiling::now_ns();
+    ASSERT_LE(previous, t);
+    previous = t;
+  }
+}
+
+/*
+ * Local Variables:
+ * compile-command: "make -C .. unit-tests"
+ * coding: utf-8-unix
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
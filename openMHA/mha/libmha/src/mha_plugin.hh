@@ -26,6 +26,7 @@
 #include "mha_events.h"
 #include "mha_git_commit_hash.hh"
 #include <atomic>
+#include <vector>
 
 #if _WIN32
 #include <winsock2.h>
@@ -148,6 +149,16 @@ namespace MHAPlugin {
        conference talks by Sutter:
        - Atomic Weapons, 2012
        - Lock-Free Programming, 2014
+
+       Plugins that create new runtime configurations frequently, e.g.
+       for each change of a steering angle, can avoid the memory
+       allocation and deallocation of the runtime configuration objects
+       and their buffers: After set_cfg_pool_size(), runtime
+       configurations that are no longer used by the signal processing
+       thread are not deleted but kept in a pool.  The configuration
+       thread can take one of them with recycle_config(), update it in
+       place, and pass it to push_config() again.  The list nodes are
+       always reused.
     */
     template < class runtime_cfg_t > class config_t {
       friend class ::Test_mha_plugin_rtcfg_t;
@@ -170,7 +181,22 @@ namespace MHAPlugin {
         /// configuration list nodes and objects regardless of their
         /// in_use flag.
         void remove_all_cfg();
+        /// Keep up to pool_size runtime configuration objects that are no
+        /// longer used for reuse with recycle_config() instead of deleting
+        /// them.  The default is 0, i.e. they are deleted.
+        void set_cfg_pool_size( unsigned int pool_size );
+        /// Take a runtime configuration object that is no longer used by
+        /// the signal processing thread out of the pool.  To be called by
+        /// the configuration thread.  The caller takes ownership of the
+        /// object and either passes it to push_config() after updating it
+        /// or deletes it.
+        /// @return The most recently retired runtime configuration, or
+        ///         nullptr if the pool is empty.
+        runtime_cfg_t* recycle_config();
     private:
+        /// Delete or keep the runtime configuration of a list node that is
+        /// no longer used and keep the node for reuse.
+        void retire_node( MHAPlugin::cfg_node_t<runtime_cfg_t> * node );
         /// Start of a singly linked list of runtime configuration objects.
         /// cfg_root points to the oldest still existing node of that list.
         /// After object creation this pointer is updated by the
@@ -187,6 +213,14 @@ namespace MHAPlugin {
         /// Does not need to be atomic because
         /// it is only used within the signal processing thread.
         MHAPlugin::cfg_node_t<runtime_cfg_t> *cfg_node_current;
+        /// Retired runtime configurations kept for reuse.  Only accessed by
+        /// the configuration thread.
+        std::vector<runtime_cfg_t*> cfg_pool;
+        /// Maximum number of runtime configurations in cfg_pool.
+        unsigned int cfg_pool_size;
+        /// Singly linked list of list nodes for reuse, linked through their
+        /// next pointers.  Only accessed by the configuration thread.
+        MHAPlugin::cfg_node_t<runtime_cfg_t> *free_nodes;
     };
 
 
@@ -285,7 +319,9 @@ template < class runtime_cfg_t > MHAPlugin::config_t < runtime_cfg_t >::config_t
     // The following performs object initialization of the atomic object but
     // is itself not an atomic operation
     cfg_root(nullptr),
-    cfg_node_current(nullptr)
+    cfg_node_current(nullptr),
+    cfg_pool_size(0U),
+    free_nodes(nullptr)
 {
     // The following line contains a memory release operation of the
     // configuration thread.  It initializes the cfg_root atomic pointer
@@ -412,9 +448,19 @@ template < class runtime_cfg_t > void MHAPlugin::config_t < runtime_cfg_t >::pus
     MHAPlugin::cfg_node_t < runtime_cfg_t > *lcfg_root = cfg_root.load();
     while( lcfg_root->next.load() )
         lcfg_root = lcfg_root->next.load();
+    MHAPlugin::cfg_node_t < runtime_cfg_t > *node = free_nodes;
+    if( node ) {
+        // Reinitialize a node that is no longer reachable by the signal
+        // processing thread like the constructor does.
+        free_nodes = node->next.load();
+        node->data = ncfg;
+        node->not_in_use.store(false);
+        node->next.store(nullptr);
+    } else
+        node = new MHAPlugin::cfg_node_t < runtime_cfg_t > ( ncfg );
     // This is a store-release operation. Corresponding loads are scattered over
     // most member functions
-    lcfg_root->next.store(new MHAPlugin::cfg_node_t < runtime_cfg_t > ( ncfg ));
+    lcfg_root->next.store(node);
     cleanup_unused_cfg(  );
 }
 
@@ -428,10 +474,43 @@ template < class runtime_cfg_t > void MHAPlugin::config_t < runtime_cfg_t >::cle
     while( (lcfg = cfg_root.load()) && lcfg->next.load() && lcfg->not_in_use.load() ) {
         // Operations on next line have no cross-thread memory ordering function
         cfg_root.store(lcfg->next.load());
-        delete lcfg;
+        retire_node(lcfg);
     }
 }
 
+template < class runtime_cfg_t > void MHAPlugin::config_t < runtime_cfg_t >::retire_node( MHAPlugin::cfg_node_t<runtime_cfg_t> * node )
+{
+    if( node->data && cfg_pool.size() < cfg_pool_size ) {
+        cfg_pool.push_back(node->data);
+        node->data = nullptr;
+    }
+    delete node->data;
+    node->data = nullptr;
+    // The signal processing thread has already moved past this node and
+    // will never access it again.
+    node->next.store(free_nodes);
+    free_nodes = node;
+}
+
+template < class runtime_cfg_t > void MHAPlugin::config_t < runtime_cfg_t >::set_cfg_pool_size( unsigned int pool_size )
+{
+    cfg_pool_size = pool_size;
+    while( cfg_pool.size() > cfg_pool_size ) {
+        delete cfg_pool.back();
+        cfg_pool.pop_back();
+    }
+    cfg_pool.reserve(cfg_pool_size);
+}
+
+template < class runtime_cfg_t > runtime_cfg_t* MHAPlugin::config_t < runtime_cfg_t >::recycle_config(  )
+{
+    if( cfg_pool.empty() )
+        return nullptr;
+    runtime_cfg_t * recycled = cfg_pool.back();
+    cfg_pool.pop_back();
+    return recycled;
+}
+
 template < class runtime_cfg_t > void MHAPlugin::config_t < runtime_cfg_t >::remove_all_cfg(  )
 {
     if( !cfg_root.load() )
@@ -443,6 +522,13 @@ template < class runtime_cfg_t > void MHAPlugin::config_t < runtime_cfg_t >::rem
     }
     delete cfg_root.load();
     cfg_root.store(nullptr);
+    while( auto node = free_nodes ) {
+        free_nodes = node->next.load();
+        delete node;
+    }
+    for( auto recycled : cfg_pool )
+        delete recycled;
+    cfg_pool.clear();
 }
 
 
@@ -26,6 +26,7 @@ public:
     void test_peek_config(void);
     void test_cleanup_unused_cfg(void);
     void test_remove_all_cfg(void);
+    void test_cfg_pool(void);
 };
 
 void Test_mha_plugin_rtcfg_t::test_initial_state()
@@ -115,6 +116,51 @@ void Test_mha_plugin_rtcfg_t::test_remove_all_cfg(void)
     ASSERT_EQ(nullptr, t.cfg_root);
 }
 TEST_F(Test_mha_plugin_rtcfg_t,test_remove_all_cfg) {test_remove_all_cfg();}
+void Test_mha_plugin_rtcfg_t::test_cfg_pool(void)
+{
+    ASSERT_EQ(nullptr, t.recycle_config());
+    t.set_cfg_pool_size(1);
+    t.push_config(new test_cfg_t(0));
+    t.push_config(new test_cfg_t(1));
+    t.push_config(new test_cfg_t(2));
+    t.poll_config();
+    auto oldest_node = t.cfg_root.load()->next.load();
+    t.cleanup_unused_cfg();
+    // configuration 0 is kept in the pool, 1 exceeds the pool size
+    ASSERT_EQ(2, test_cfg_t::instances);
+    ASSERT_EQ(2, t.cfg->i);
+
+    test_cfg_t * recycled = t.recycle_config();
+    ASSERT_NE(nullptr, recycled);
+    ASSERT_EQ(0, recycled->i);
+    ASSERT_EQ(nullptr, t.recycle_config());
+
+    // the list nodes are reused
+    recycled->i = 3;
+    t.push_config(recycled);
+    auto node = t.cfg_root.load()->next.load();
+    ASSERT_EQ(recycled, node->data);
+    ASSERT_TRUE(node == oldest_node || t.free_nodes == oldest_node);
+    ASSERT_EQ(false, node->not_in_use);
+    ASSERT_EQ(nullptr, node->next);
+    ASSERT_EQ(3, t.poll_config()->i);
+    ASSERT_EQ(2, test_cfg_t::instances);
+
+    // configuration 2 is retired into the pool by the next push
+    t.push_config(new test_cfg_t(4));
+    ASSERT_EQ(3, test_cfg_t::instances);
+    t.set_cfg_pool_size(0);
+    ASSERT_EQ(2, test_cfg_t::instances);
+    ASSERT_EQ(nullptr, t.recycle_config());
+
+    t.set_cfg_pool_size(4);
+    t.poll_config();
+    t.cleanup_unused_cfg();
+    t.remove_all_cfg();
+    ASSERT_EQ(0, test_cfg_t::instances);
+    ASSERT_EQ(nullptr, t.free_nodes);
+}
+TEST_F(Test_mha_plugin_rtcfg_t,test_cfg_pool) {test_cfg_pool();}
 
 // Local Variables:
 // compile-command: "make -C .. unit-tests"
@@ -0,0 +1,113 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_recorder.hh"
+#include <algorithm>
+#include <chrono>
+
+namespace MHARecorder {
+
+    recording_service_t & recording_service_t::instance()
+    {
+        static recording_service_t service;
+        return service;
+    }
+
+    void recording_service_t::add_sink(sink_t * sink)
+    {
+        std::lock_guard<std::mutex> control_lock(control);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (std::find(sinks.begin(), sinks.end(), sink) != sinks.end())
+            return;
+        sinks.push_back(sink);
+        if (!thread.joinable()) {
+            stop = false;
+            thread = std::thread(&recording_service_t::writer_thread, this);
+        }
+    }
+
+    void recording_service_t::remove_sink(sink_t * sink)
+    {
+        std::lock_guard<std::mutex> control_lock(control);
+        bool last_sink = false;
+        {
+            // The writer thread owns the mutex while it writes, therefore
+            // it has finished with this sink when we get the lock.
+            std::lock_guard<std::mutex> lock(mutex);
+            sinks.erase(std::remove(sinks.begin(), sinks.end(), sink),
+                        sinks.end());
+            last_sink = sinks.empty();
+        }
+        if (last_sink)
+            stop_thread();
+    }
+
+    void recording_service_t::stop_thread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!thread.joinable())
+                return;
+            stop = true;
+        }
+        wakeup.notify_one();
+        thread.join();
+    }
+
+    void recording_service_t::notify() noexcept
+    {
+        pending.store(true);
+        wakeup.notify_one();
+    }
+
+    unsigned recording_service_t::get_num_sinks()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return sinks.size();
+    }
+
+    recording_service_t::~recording_service_t()
+    {
+        std::lock_guard<std::mutex> control_lock(control);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sinks.clear();
+        }
+        stop_thread();
+    }
+
+    void recording_service_t::writer_thread()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stop) {
+            if (!pending.exchange(false)) {
+                wakeup.wait_for(lock,
+                                std::chrono::milliseconds(poll_interval_ms));
+                pending.store(false);
+            }
+            if (stop)
+                break;
+            for (sink_t * sink : sinks)
+                sink->write_pending(false);
+        }
+    }
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
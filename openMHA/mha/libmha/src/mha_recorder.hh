@@ -0,0 +1,272 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_RECORDER_HH
+#define MHA_RECORDER_HH
+
+#include "mha_fifo.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** \defgroup mharecorder Asynchronous recording to disk
+
+    Recorder plugins must not write to disk from the signal processing
+    thread.  They place their data into lock-free fifos, and a single
+    writer thread shared by all recorders transfers the data from the
+    fifos to disk.  The signal processing thread wakes the writer
+    thread without blocking when enough data for a large write has
+    accumulated in a fifo.
+*/
+
+namespace MHARecorder {
+
+    /** \ingroup mharecorder
+        \brief Interface of the data sinks serviced by the writer thread
+        of recording_service_t. */
+    class sink_t {
+    public:
+        virtual ~sink_t() = default;
+        /** Called by the writer thread after the signal processing
+            thread has signalled new data.
+            \param flush When false, write only if enough data for a
+                         large write is waiting.  When true, write all
+                         waiting data. */
+        virtual void write_pending(bool flush) = 0;
+    };
+
+    /** \ingroup mharecorder
+        \brief The single writer thread shared by all recorders.
+
+        The writer thread exists while at least one sink is registered.
+        It sleeps until notify() is called, then calls write_pending of
+        all registered sinks.  notify() does not lock a mutex and
+        does not allocate memory, it can be called from the signal
+        processing thread.  Because notify() does not lock the mutex,
+        a notification can coincide with the writer thread going to
+        sleep.  The writer thread therefore also wakes up every
+        poll_interval_ms milliseconds. */
+    class recording_service_t {
+    public:
+        /** The instance shared by all recorders. */
+        static recording_service_t & instance();
+
+        /** Upper limit for the delay of a notification in milliseconds. */
+        static constexpr unsigned poll_interval_ms = 50U;
+
+        /** Register a sink.  Starts the writer thread if it is not
+            running.  Must not be called by the writer thread. */
+        void add_sink(sink_t * sink);
+
+        /** Unregister a sink.  When this method returns, the writer
+            thread does not access the sink any more.  Stops the
+            writer thread when no sink is left.  Unknown sinks are
+            ignored.  Must not be called by the writer thread. */
+        void remove_sink(sink_t * sink);
+
+        /** Wake up the writer thread.  Real-time safe. */
+        void notify() noexcept;
+
+        /** Number of registered sinks. */
+        unsigned get_num_sinks();
+
+        /** Stops the writer thread if it is still running. */
+        ~recording_service_t();
+    private:
+        recording_service_t() = default;
+        recording_service_t(const recording_service_t &) = delete;
+        recording_service_t & operator=(const recording_service_t &) = delete;
+        /** Main loop of the writer thread. */
+        void writer_thread();
+        /** Stop and join the writer thread.  Caller must own control
+            and must not own mutex. */
+        void stop_thread();
+        /** Serializes add_sink and remove_sink, so that starting and
+            stopping the writer thread do not interleave. */
+        std::mutex control;
+        /** Protects sinks and stop.  Owned by the writer thread
+            while it writes. */
+        std::mutex mutex;
+        /** Signals new data or termination to the writer thread. */
+        std::condition_variable wakeup;
+        /** Set by notify(), cleared by the writer thread. */
+        std::atomic<bool> pending = {false};
+        /** Termination request for the writer thread. */
+        bool stop = false;
+        /** The registered sinks. */
+        std::vector<sink_t *> sinks;
+        /** The writer thread. */
+        std::thread thread;
+    };
+
+    /** \ingroup mharecorder
+        \brief A sink that buffers data in a lock-free fifo.
+
+        The signal processing thread pushes data with push() or with
+        get_available_space(), write() and commit().  Data is pushed
+        and written in frames of frame_size elements, e.g. one sample of
+        all audio channels.  Data that does not fit into the fifo is
+        discarded and counted.  Derived classes implement
+        write_frames() to write the data to disk.
+
+        Lifetime: start() registers the sink with the writer thread,
+        stop() unregisters the sink and writes the remaining data.
+        stop() must be called before the derived object is destroyed.
+        \tparam T The data type of the elements. */
+    template <class T>
+    class fifo_sink_t : public sink_t {
+    public:
+        /** Allocate fifo and disk buffer.
+            \param fifosize Capacity of the fifo in elements.
+            \param minwrite The writer thread writes when more than
+                            minwrite elements are waiting in the fifo.
+            \param frame_size Number of elements per frame, can be
+                              changed with set_frame_size before data
+                              is pushed.
+            \throw MHA_Error if minwrite is not less than fifosize. */
+        fifo_sink_t(unsigned fifosize, unsigned minwrite,
+                    unsigned frame_size = 1U)
+            : fifo(fifosize),
+              diskbuffer(new T[fifosize]),
+              minwrite(minwrite),
+              frame_size(std::max(frame_size, 1U))
+        {
+            if (minwrite >= fifosize)
+                throw MHA_Error(__FILE__,__LINE__,
+                                "minwrite must be less than fifosize "
+                                "(minwrite: %u, fifosize: %u)",
+                                minwrite, fifosize);
+        }
+
+        /** Does not call stop(), because write_frames() of the derived
+            class is not available any more. */
+        virtual ~fifo_sink_t() = default;
+
+        /** Register with the writer thread. */
+        void start() {
+            if (!started) {
+                started = true;
+                recording_service_t::instance().add_sink(this);
+            }
+        }
+
+        /** Unregister from the writer thread and write the remaining
+            data to disk in the calling thread.  Idempotent. */
+        void stop() {
+            if (started && !stopped) {
+                stopped = true;
+                recording_service_t::instance().remove_sink(this);
+                write_pending(true);
+            }
+        }
+
+        /** Set the number of elements per frame.  Must only be called
+            before the first element is pushed. */
+        void set_frame_size(unsigned n) {frame_size.store(std::max(n, 1U));}
+
+        /** Number of elements per frame. */
+        unsigned get_frame_size() const {return frame_size.load();}
+
+        /** Number of elements that can be written to the fifo now,
+            rounded down to whole frames.  Signal processing thread only. */
+        unsigned get_available_space() const {
+            const unsigned n = get_frame_size();
+            return fifo.get_available_space() / n * n;
+        }
+
+        /** Write elements to the fifo.  Signal processing thread only.
+            \param data  Source data.
+            \param count Number of elements, must not exceed
+                         get_available_space(). */
+        void write(const T * data, unsigned count) {fifo.write(data, count);}
+
+        /** Account for discarded elements and wake the writer thread
+            if enough data has accumulated.  Signal processing thread
+            only, after a sequence of write() calls.
+            \param num_dropped Number of elements that did not fit. */
+        void commit(unsigned num_dropped) {
+            dropped += num_dropped;
+            if (fifo.get_fill_count() > minwrite &&
+                !notified.exchange(true))
+                recording_service_t::instance().notify();
+        }
+
+        /** Write as many whole frames as fit into the fifo, discard the
+            rest, and wake the writer thread if necessary.  Signal
+            processing thread only.
+            \param data  Source data.
+            \param count Number of elements.
+            \return Number of elements written to the fifo. */
+        unsigned push(const T * data, unsigned count) {
+            const unsigned n = std::min(get_available_space(), count);
+            write(data, n);
+            commit(count - n);
+            return n;
+        }
+
+        /** Total number of discarded elements.  Signal processing
+            thread only. */
+        unsigned long long get_num_dropped() const {return dropped;}
+
+        virtual void write_pending(bool flush) override {
+            notified.store(false);
+            if (!flush && fifo.get_fill_count() <= minwrite)
+                return;
+            const unsigned n = get_frame_size();
+            const unsigned frames = fifo.get_fill_count() / n;
+            if (frames) {
+                fifo.read(diskbuffer.get(), frames * n);
+                write_frames(diskbuffer.get(), frames);
+            }
+        }
+    protected:
+        /** Write data to disk.  Called by the writer thread, or by the
+            thread calling stop().
+            \param data   frames * get_frame_size() elements.
+            \param frames Number of frames. */
+        virtual void write_frames(const T * data, unsigned frames) = 0;
+    private:
+        /** Transports data to the writer thread. */
+        mha_fifo_lf_t<T> fifo;
+        /** Receives data from the fifo for writing to disk. */
+        std::unique_ptr<T[]> diskbuffer;
+        /** Minimum fill count that triggers a write. */
+        const unsigned minwrite;
+        /** Number of elements per frame. */
+        std::atomic<unsigned> frame_size;
+        /** Set when the writer thread has been notified and has not
+            yet emptied the fifo, avoids repeated notifications. */
+        std::atomic<bool> notified = {false};
+        /** Number of discarded elements. */
+        unsigned long long dropped = 0U;
+        /** Set by start(). */
+        bool started = false;
+        /** Set by stop(). */
+        bool stopped = false;
+    };
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
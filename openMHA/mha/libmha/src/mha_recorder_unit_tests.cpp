@@ -0,0 +1,164 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_recorder.hh"
+#include "mha_error.hh"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+  /// Records the written frames in memory.
+  class memory_sink_t : public MHARecorder::fifo_sink_t<float> {
+  public:
+    memory_sink_t(unsigned fifosize, unsigned minwrite, unsigned frame_size)
+      : MHARecorder::fifo_sink_t<float>(fifosize, minwrite, frame_size)
+    {}
+    std::vector<float> get_written() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return written;
+    }
+    std::vector<unsigned> get_writes() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return writes;
+    }
+    /// Poll until at least n elements have been written or 5 s passed.
+    bool wait_for_written(unsigned n) {
+      for (unsigned i = 0; i < 500U; ++i) {
+        if (get_written().size() >= n)
+          return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      return false;
+    }
+  protected:
+    void write_frames(const float * data, unsigned frames) override {
+      std::lock_guard<std::mutex> lock(mutex);
+      written.insert(written.end(), data, data + frames * get_frame_size());
+      writes.push_back(frames);
+    }
+  private:
+    std::mutex mutex;
+    std::vector<float> written;
+    std::vector<unsigned> writes;
+  };
+
+  std::vector<float> ramp(unsigned n, float start = 0.0f)
+  {
+    std::vector<float> v(n);
+    for (unsigned k = 0; k < n; ++k)
+      v[k] = start + k;
+    return v;
+  }
+}
+
+TEST(recording_service_t, writer_thread_exists_while_sinks_are_registered)
+{
+  auto & service = MHARecorder::recording_service_t::instance();
+  ASSERT_EQ(0U, service.get_num_sinks());
+  memory_sink_t a(100, 10, 1), b(100, 10, 1);
+  a.start();
+  b.start();
+  b.start(); // registering twice has no effect
+  EXPECT_EQ(2U, service.get_num_sinks());
+  a.stop();
+  a.stop(); // idempotent
+  EXPECT_EQ(1U, service.get_num_sinks());
+  b.stop();
+  EXPECT_EQ(0U, service.get_num_sinks());
+  // The writer thread is restarted for the next sink
+  memory_sink_t c(100, 10, 1);
+  c.start();
+  EXPECT_EQ(1U, service.get_num_sinks());
+  auto data = ramp(20);
+  c.push(data.data(), data.size());
+  EXPECT_TRUE(c.wait_for_written(20));
+  c.stop();
+  EXPECT_EQ(0U, service.get_num_sinks());
+}
+
+TEST(fifo_sink_t, minwrite_must_be_less_than_fifosize)
+{
+  EXPECT_THROW(memory_sink_t(10, 10, 1), MHA_Error);
+  EXPECT_NO_THROW(memory_sink_t(10, 9, 1));
+}
+
+TEST(fifo_sink_t, writes_in_batches_without_explicit_flush)
+{
+  memory_sink_t sink(1000, 100, 2);
+  sink.start();
+  auto data = ramp(1000);
+  // 60 elements stay below minwrite, nothing is written
+  sink.push(data.data(), 60);
+  std::this_thread::sleep_for(std::chrono::milliseconds(
+      3 * MHARecorder::recording_service_t::poll_interval_ms));
+  EXPECT_TRUE(sink.get_written().empty());
+  // Exceeding minwrite wakes the writer thread
+  sink.push(data.data() + 60, 60);
+  ASSERT_TRUE(sink.wait_for_written(120));
+  EXPECT_EQ(std::vector<unsigned>({60U}), sink.get_writes());
+  // stop() writes the remaining data
+  sink.push(data.data() + 120, 10);
+  sink.stop();
+  EXPECT_EQ(std::vector<float>(data.begin(), data.begin() + 130),
+            sink.get_written());
+  EXPECT_EQ(0U, sink.get_num_dropped());
+}
+
+TEST(fifo_sink_t, counts_dropped_elements_and_keeps_whole_frames)
+{
+  memory_sink_t sink(10, 9, 3);
+  auto data = ramp(12);
+  // Not started: the fifo is not emptied. Only 3 frames fit.
+  EXPECT_EQ(9U, sink.get_available_space());
+  EXPECT_EQ(9U, sink.push(data.data(), 12));
+  EXPECT_EQ(3U, sink.get_num_dropped());
+  EXPECT_EQ(0U, sink.push(data.data(), 6));
+  EXPECT_EQ(9U, sink.get_num_dropped());
+  sink.start();
+  sink.stop();
+  EXPECT_EQ(std::vector<float>(data.begin(), data.begin() + 9),
+            sink.get_written());
+}
+
+TEST(fifo_sink_t, one_writer_thread_serves_several_sinks)
+{
+  memory_sink_t a(1000, 50, 1), b(1000, 50, 2);
+  a.start();
+  b.start();
+  auto data = ramp(400);
+  for (unsigned block = 0; block < 4; ++block) {
+    a.push(data.data() + block * 100, 100);
+    b.push(data.data() + block * 100, 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(a.wait_for_written(351));
+  EXPECT_TRUE(b.wait_for_written(351));
+  a.stop();
+  b.stop();
+  EXPECT_EQ(data, a.get_written());
+  EXPECT_EQ(data, b.get_written());
+}
+
+/*
+ * Local Variables:
+ * compile-command: "make -C .. unit-tests"
+ * coding: utf-8-unix
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <float.h>
 #include "mha_signal_fft.h"
+#include "mha_fft_backend.hh"
 
 /**
    \defgroup mhatoolbox The \mha Toolbox library
@@ -1063,73 +1064,37 @@ ringbuffer_t::ringbuffer_t(unsigned frames,
 /********************************************************************/
 /********************************************************************/
 
-MHASignal::fft_t::fft_t( const unsigned int &n )
+MHASignal::fft_t::fft_t( const unsigned int &n, fft_backend_id_t backend_id )
+    : fft_t( n, 0U, backend_id )
+{
+}
+
+MHASignal::fft_t::fft_t( const unsigned int &n, unsigned int channels,
+                         fft_backend_id_t backend_id )
     : nfft( n ), 
       n_re( 1 + n / 2 ), 
       n_im( ( 1 + n ) / 2 - 1 ), 
       scale( 1.0 / (mha_real_t)n ), 
-      buf_in( NULL ), 
-      buf_out( NULL )
+      batch_channels( channels ),
+      backend( fft_backend_new( backend_id, n ) ),
+      buf_in( n ),
+      buf_out( n ),
+      buf_wave( n * channels )
 {
-    if( n < 2 )
-        throw MHA_Error( __FILE__, __LINE__, "fft length is too small (%u < 2)", n );
-    fftw_plan_wave2spec = rfftw_create_plan( nfft, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE );
-    fftw_plan_spec2wave = rfftw_create_plan( nfft, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE );
-    fftw_plan_fft = fftw_create_plan( nfft, FFTW_FORWARD, FFTW_ESTIMATE );
-    fftw_plan_ifft = fftw_create_plan( nfft, FFTW_BACKWARD, FFTW_ESTIMATE );
-    // this is 2 times as much as needed:
-    buf_in = new mha_real_t[2 * nfft];
-    buf_out = new mha_real_t[2 * nfft];
+    if( batch_channels )
+        backend->prepare_multi( batch_channels );
 }
 
 MHASignal::fft_t::~fft_t(  )
 {
-    rfftw_destroy_plan( fftw_plan_wave2spec );
-    rfftw_destroy_plan( fftw_plan_spec2wave );
-    fftw_destroy_plan( fftw_plan_fft );
-    fftw_destroy_plan( fftw_plan_ifft );
-    if( buf_in )
-        delete [] buf_in;
-    if( buf_out )
-        delete [] buf_out;
 }
 
-/** Arrange the order of an fftw spectrum to the internal order 
- *
- * The fftw spectrum is arranged [r0 r1 r2 ... rn-1 in in-1 ... i1],
- * while the interal order is [r0 -- r1 i1 r2 i2 ... rn-1 in-1 rn --].
+/** Check that the spectrum can hold the nfft/2+1 bins produced by
+ * the backend.  Additional bins are allowed and are set to zero by
+ * the transforms.
  */
-void MHASignal::fft_t::sort_fftw2spec( fftw_real * s_fftw, mha_spec_t * s_spec, unsigned int ch )
+void MHASignal::fft_t::check_spec_frames( const mha_spec_t * s_spec ) const
 {
-    if( sizeof ( mha_real_t ) != sizeof ( fftw_real ) )
-        throw MHA_ErrorMsg( "MHA and FFTW use different precision" );
-    if( s_spec->num_frames < n_re ){
-        throw MHA_Error( __FILE__, __LINE__,
-                         "Input spectrum contains only %u bins, but %u real parts are available.",
-                         s_spec->num_frames, n_re );
-    }
-    if( s_spec->num_frames < n_im + 1 ){
-        throw MHA_Error( __FILE__, __LINE__,
-                         "Input spectrum contains only %u bins, but %u imaginary parts are available.",
-                         s_spec->num_frames, n_im );
-    }
-    unsigned int k;
-    for( k = 0; k < n_re; k++ )
-        value( s_spec, k, ch ).re = s_fftw[k];
-    for( k = n_re; k < s_spec->num_frames; k++ )
-        value( s_spec, k, ch ).re = 0;
-    for( k = 1; k < n_im + 1; k++ )
-        value( s_spec, k, ch ).im = s_fftw[nfft - k];
-    for( k = n_im + 1; k < s_spec->num_frames; k++ )
-        value( s_spec, k, ch ).im = 0;
-    value( s_spec, 0, ch ).im = 0;
-}
-
-/** Arrange the order of an internal spectrum to the fftw order */
-void MHASignal::fft_t::sort_spec2fftw( fftw_real * s_fftw, const mha_spec_t * s_spec, unsigned int ch )
-{
-    if( sizeof ( mha_real_t ) != sizeof ( fftw_real ) )
-        throw MHA_ErrorMsg( "MHA and FFTW use different precision" );
     if( s_spec->num_frames < n_re )
         throw MHA_Error( __FILE__, __LINE__,
                          "Input spectrum contains only %u bins, but %u real parts are available.",
@@ -1138,14 +1103,10 @@ void MHASignal::fft_t::sort_spec2fftw( fftw_real * s_fftw, const mha_spec_t * s_
         throw MHA_Error( __FILE__, __LINE__,
                          "Input spectrum contains only %u bins, but %u imaginary parts are available.",
                          s_spec->num_frames, n_im );
-    unsigned int k;
-    for( k = 0; k < n_re; k++ )
-        s_fftw[k] = value( s_spec, k, ch ).re;
-    for( k = 1; k < n_im + 1; k++ )
-        s_fftw[nfft - k] = value( s_spec, k, ch ).im;
 }
 
-void MHASignal::fft_t::forward( mha_spec_t* sIn, mha_spec_t* sOut )
+void MHASignal::fft_t::check_complex_dims( const mha_spec_t * sIn,
+                                           const mha_spec_t * sOut ) const
 {
     CHECK_VAR( sIn );
     CHECK_VAR( sOut );
@@ -1161,35 +1122,33 @@ void MHASignal::fft_t::forward( mha_spec_t* sIn, mha_spec_t* sOut )
         throw MHA_Error( __FILE__, __LINE__, 
                          "fft: Mismatching number of channels in input and output (input: %u, output: %u).",
                          sIn->num_channels, sOut->num_channels );
-    fftw(fftw_plan_fft,sIn->num_channels,
-         (fftw_complex*)(sIn->buf),1,sIn->num_frames,
-         (fftw_complex*)(sOut->buf),1,sOut->num_frames);
+}
+
+void MHASignal::fft_t::complex2complex( const mha_spec_t * sIn,
+                                        mha_spec_t * sOut, bool forward )
+{
+    check_complex_dims( sIn, sOut );
+    for( unsigned int ch = 0; ch < sIn->num_channels; ch++ )
+        backend->complex2complex( sIn->buf + ch * nfft,
+                                  sOut->buf + ch * nfft, forward );
+}
+
+void MHASignal::fft_t::forward( mha_spec_t* sIn, mha_spec_t* sOut )
+{
+    complex2complex( sIn, sOut, true );
     *sOut *= 1.0/nfft;
 }
 
 void MHASignal::fft_t::backward( mha_spec_t* sIn, mha_spec_t* sOut )
 {
-    CHECK_VAR( sIn );
-    CHECK_VAR( sOut );
-    if( sIn->num_frames != nfft )
-        throw MHA_Error( __FILE__,__LINE__,
-                         "fft: The input spectrum does not contain fftlen bins (sIn: %u, nFFT: %u).",
-                         sIn->num_frames, nfft );
-    if( sOut->num_frames != nfft )
-        throw MHA_Error( __FILE__,__LINE__,
-                         "fft: The output spectrum does not contain fftlen bins (sOut: %u, nFFT: %u).",
-                         sOut->num_frames, nfft );
-    if( sIn->num_channels != sOut->num_channels )
-        throw MHA_Error( __FILE__, __LINE__, 
-                         "fft: Mismatching number of channels in input and output (input: %u, output: %u).",
-                         sIn->num_channels, sOut->num_channels );
-    fftw(fftw_plan_ifft,sIn->num_channels,
-         (fftw_complex*)(sIn->buf),1,sIn->num_frames,
-         (fftw_complex*)(sOut->buf),1,sOut->num_frames);
+    complex2complex( sIn, sOut, false );
 }
 
-void MHASignal::fft_t::wave2spec( const mha_wave_t * wave, mha_spec_t * spec,
-                                  bool swap)
+/** Common implementation of wave2spec and wave2spec_scale.
+ * \param factor Scale factor applied to the spectrum. */
+void MHASignal::fft_t::wave2spec_multiply( const mha_wave_t * wave,
+                                           mha_spec_t * spec,
+                                           bool swap, mha_real_t factor )
 {
     CHECK_VAR( wave );
     CHECK_VAR( spec );
@@ -1197,19 +1156,77 @@ void MHASignal::fft_t::wave2spec( const mha_wave_t * wave, mha_spec_t * spec,
         throw MHA_Error(__FILE__,__LINE__,
                         "fft: Mismatching channel number: waveform has %u, spectrum has %u.",
                         wave->num_channels, spec->num_channels );
-
+    check_spec_frames( spec );
     unsigned int k, ch, max_frames(std::min(nfft,wave->num_frames));
+    if( batch_channels && wave->num_channels == batch_channels &&
+        wave->num_frames == nfft && ( !swap || ( nfft & 1U ) == 0U ) ) {
+        backend->real2complex_multi( wave->buf, spec->buf, batch_channels,
+                                     spec->num_frames );
+        // Exchanging the buffer halves is a circular shift by nfft/2,
+        // which changes the sign of all odd bins.
+        const mha_real_t odd_factor( swap ? -factor : factor );
+        for( ch = 0; ch < spec->num_channels; ch++ ) {
+            mha_complex_t * bins = spec->buf + ch * spec->num_frames;
+            if( factor != 1.0f || swap ) {
+                for( k = 0; k < n_re; k++ )
+                    bins[k] *= ( k & 1U ) ? odd_factor : factor;
+            }
+            for( k = n_re; k < spec->num_frames; k++ )
+                bins[k] = mha_complex_t{0, 0};
+        }
+        return;
+    }
     for( ch = 0; ch < wave->num_channels; ch++ ) {
         for( k = 0; k < max_frames; ++k )
             buf_in[swap ? ((k + wave->num_frames / 2) % wave->num_frames) : k] =
-                scale * wave->buf[k * wave->num_channels + ch];
+                factor * wave->buf[k * wave->num_channels + ch];
         for( k = max_frames; k < nfft; ++k )
             buf_in[swap ? ((k + wave->num_frames / 2) % wave->num_frames) : k] = 0;
-        rfftw_one( fftw_plan_wave2spec, buf_in, buf_out );
-        sort_fftw2spec( buf_out, spec, ch );
+        mha_complex_t * bins = spec->buf + ch * spec->num_frames;
+        backend->real2complex( buf_in.data(), bins );
+        for( k = n_re; k < spec->num_frames; k++ )
+            bins[k] = mha_complex_t{0, 0};
     }
 }
 
+/** Common implementation of the spec2wave variants.  Dimensions
+ * have been checked by the caller.
+ * \param offset Index of the first iFFT output frame copied to wave.
+ * \param factor Scale factor applied to the waveform. */
+void MHASignal::fft_t::spec2wave_multiply( const mha_spec_t * spec,
+                                           mha_wave_t * wave,
+                                           unsigned int offset,
+                                           mha_real_t factor )
+{
+    unsigned int ch, k;
+    if( batch_channels && wave->num_channels == batch_channels ) {
+        if( offset == 0 && wave->num_frames == nfft ) {
+            backend->complex2real_multi( spec->buf, spec->num_frames,
+                                         wave->buf, batch_channels );
+        } else {
+            backend->complex2real_multi( spec->buf, spec->num_frames,
+                                         buf_wave.data(), batch_channels );
+            std::copy( buf_wave.begin() + offset * batch_channels,
+                       buf_wave.begin() + ( offset + wave->num_frames ) * batch_channels,
+                       wave->buf );
+        }
+        if( factor != 1.0f )
+            *wave *= factor;
+        return;
+    }
+    for( ch = 0; ch < wave->num_channels; ch++ ) {
+        backend->complex2real( spec->buf + ch * spec->num_frames, buf_out.data() );
+        for( k = 0; k < wave->num_frames; k++ )
+            wave->buf[wave->num_channels * k + ch] = factor * buf_out[k+offset];
+    }
+}
+
+void MHASignal::fft_t::wave2spec( const mha_wave_t * wave, mha_spec_t * spec,
+                                  bool swap)
+{
+    wave2spec_multiply( wave, spec, swap, scale );
+}
+
 void MHASignal::fft_t::spec2wave( const mha_spec_t * spec, mha_wave_t * wave )
 {
     CHECK_VAR( wave );
@@ -1221,13 +1238,8 @@ void MHASignal::fft_t::spec2wave( const mha_spec_t * spec, mha_wave_t * wave )
                          spec->num_channels, wave->num_channels);
     if( wave->num_frames != nfft )
         throw MHA_Error( __FILE__, __LINE__, "waveform has invalid length (%u, nfft:%u)", wave->num_frames, nfft );
-    unsigned int ch, k;
-    for( ch = 0; ch < wave->num_channels; ch++ ) {
-        sort_spec2fftw( buf_in, spec, ch );
-        rfftw_one( fftw_plan_spec2wave, buf_in, buf_out );
-        for( k = 0; k < wave->num_frames; k++ )
-            wave->buf[wave->num_channels * k + ch] = buf_out[k];
-    }
+    check_spec_frames( spec );
+    spec2wave_multiply( spec, wave, 0, 1.0f );
 }
 
 /** 
@@ -1250,34 +1262,15 @@ void MHASignal::fft_t::spec2wave( const mha_spec_t * spec, mha_wave_t * wave,
     if( wave->num_frames > nfft - offset )
         throw MHA_Error( __FILE__, __LINE__, "waveform has invalid length (%u, nfft:%u, offset:%u)",
                          wave->num_frames, nfft, offset );
-    unsigned int ch, k;
-    for( ch = 0; ch < wave->num_channels; ch++ ) {
-        sort_spec2fftw( buf_in, spec, ch );
-        rfftw_one( fftw_plan_spec2wave, buf_in, buf_out );
-        for( k = 0; k < wave->num_frames; k++ )
-            wave->buf[wave->num_channels * k + ch] = buf_out[k+offset];
-    }
+    check_spec_frames( spec );
+    spec2wave_multiply( spec, wave, offset, 1.0f );
 }
 
 /* gkc: scale correct versions */
 void MHASignal::fft_t::wave2spec_scale( const mha_wave_t * wave, mha_spec_t * spec,
                                   bool swap)
 {
-    CHECK_VAR( wave );
-    CHECK_VAR( spec );
-    if( wave->num_channels != spec->num_channels )
-        throw MHA_Error(__FILE__,__LINE__,
-            "fft: Mismatching channel number: waveform has %u, spectrum has %u.",wave->num_channels, spec->num_channels );
-    unsigned int k, ch, max_frames(std::min(nfft,wave->num_frames));
-    for( ch = 0; ch < wave->num_channels; ch++ ) {
-        for( k = 0; k < max_frames; ++k )
-            buf_in[swap ? ((k + wave->num_frames / 2) % wave->num_frames) : k] =
-                wave->buf[k * wave->num_channels + ch]; //removed scale ehre
-        for( k = max_frames; k < nfft; ++k )
-            buf_in[swap ? ((k + wave->num_frames / 2) % wave->num_frames) : k] = 0;
-        rfftw_one( fftw_plan_wave2spec, buf_in, buf_out );
-        sort_fftw2spec( buf_out, spec, ch );
-    }
+    wave2spec_multiply( wave, spec, swap, 1.0f );
 }
 
 void MHASignal::fft_t::spec2wave_scale( const mha_spec_t * spec, mha_wave_t * wave )
@@ -1291,56 +1284,18 @@ void MHASignal::fft_t::spec2wave_scale( const mha_spec_t * spec, mha_wave_t * wa
                          spec->num_channels, wave->num_channels);
     if( wave->num_frames != nfft )
         throw MHA_Error( __FILE__, __LINE__, "waveform has invalid length (%u, nfft:%u)", wave->num_frames, nfft );
-    unsigned int ch, k;
-    for( ch = 0; ch < wave->num_channels; ch++ ) {
-        sort_spec2fftw( buf_in, spec, ch );
-        rfftw_one( fftw_plan_spec2wave, buf_in, buf_out );
-        for( k = 0; k < wave->num_frames; k++ )
-            wave->buf[wave->num_channels * k + ch] = scale * buf_out[k]; //added scale
-    }
+    check_spec_frames( spec );
+    spec2wave_multiply( spec, wave, 0, scale );
 }
 
 void MHASignal::fft_t::forward_scale( mha_spec_t* sIn, mha_spec_t* sOut )
 {
-    CHECK_VAR( sIn );
-    CHECK_VAR( sOut );
-    if( sIn->num_frames != nfft )
-        throw MHA_Error( __FILE__,__LINE__,
-                         "fft: The input spectrum does not contain fftlen bins (sIn: %u, nFFT: %u).",
-                         sIn->num_frames, nfft );
-    if( sOut->num_frames != nfft )
-        throw MHA_Error( __FILE__,__LINE__,
-                         "fft: The output spectrum does not contain fftlen bins (sOut: %u, nFFT: %u).",
-                         sOut->num_frames, nfft );
-    if( sIn->num_channels != sOut->num_channels )
-        throw MHA_Error( __FILE__, __LINE__,
-                         "fft: Mismatching number of channels in input and output (input: %u, output: %u).",
-                         sIn->num_channels, sOut->num_channels );
-    fftw(fftw_plan_fft,sIn->num_channels,
-         (fftw_complex*)(sIn->buf),1,sIn->num_frames,
-         (fftw_complex*)(sOut->buf),1,sOut->num_frames);
-    *sOut *= 1.0; // removed scaling
+    complex2complex( sIn, sOut, true );
 }
 
 void MHASignal::fft_t::backward_scale( mha_spec_t* sIn, mha_spec_t* sOut )
 {
-    CHECK_VAR( sIn );
-    CHECK_VAR( sOut );
-    if( sIn->num_frames != nfft )
-        throw MHA_Error( __FILE__,__LINE__,
-                         "fft: The input spectrum does not contain fftlen bins (sIn: %u, nFFT: %u).",
-                         sIn->num_frames, nfft );
-    if( sOut->num_frames != nfft )
-        throw MHA_Error( __FILE__,__LINE__,
-                         "fft: The output spectrum does not contain fftlen bins (sOut: %u, nFFT: %u).",
-                         sOut->num_frames, nfft );
-    if( sIn->num_channels != sOut->num_channels )
-        throw MHA_Error( __FILE__, __LINE__,
-                         "fft: Mismatching number of channels in input and output (input: %u, output: %u).",
-                         sIn->num_channels, sOut->num_channels );
-    fftw(fftw_plan_ifft,sIn->num_channels,
-         (fftw_complex*)(sIn->buf),1,sIn->num_frames,
-         (fftw_complex*)(sOut->buf),1,sOut->num_frames);
+    complex2complex( sIn, sOut, false );
     *sOut *= 1.0/nfft;
 }
 
@@ -1355,6 +1310,18 @@ mha_fft_t mha_fft_new(unsigned int n)
     return new MHASignal::fft_t(n);
 }
 
+/** \brief Create a new instance of an FFT object with batched
+    multichannel transforms
+
+\param n FFT length
+\param channels Number of channels transformed in one backend call
+\retval FFT object
+*/
+mha_fft_t mha_fft_new(unsigned int n, unsigned int channels)
+{
+    return new MHASignal::fft_t(n, channels);
+}
+
 /** \brief Remove an FFT object
  
 \param h FFT object to be removed
@@ -1447,49 +1414,34 @@ void mha_fft_spec2wave_scale(mha_fft_t h,const mha_spec_t* in, mha_wave_t* out)
  */
 
 namespace MHASignal {
-    class hilbert_fftw_t {
+    class hilbert_fft_t {
     public:
-        /** C'tor of hilbert_fftw_t
+        /** C'tor of hilbert_fft_t
          * @param len fft length
          **/
-        hilbert_fftw_t(unsigned int len);
-        /** D'tor of hilbert_fftw_t
-         **/
-        ~hilbert_fftw_t();
+        hilbert_fft_t(unsigned int len);
         void hilbert(const mha_wave_t*,mha_wave_t*);
     private:
         unsigned int n;
-        rfftw_plan p1;
-        fftw_plan p2;
-        fftw_real* buf_r_in;
-        fftw_real* buf_r_out;
-        fftw_complex* buf_c_in;
-        fftw_complex* buf_c_out;
+        std::unique_ptr<fft_backend_t> fft;
+        std::vector<mha_real_t> buf_r_in;
+        std::vector<mha_complex_t> buf_c_in;
+        std::vector<mha_complex_t> buf_c_out;
         mha_real_t sc;
     };
 }
 
-MHASignal::hilbert_fftw_t::hilbert_fftw_t(unsigned int len)
+MHASignal::hilbert_fft_t::hilbert_fft_t(unsigned int len)
     : n(len),
-      buf_r_in(new fftw_real[n]),
-      buf_r_out(new fftw_real[n]),
-      buf_c_in(new fftw_complex[n]),
-      buf_c_out(new fftw_complex[n])
+      fft(fft_backend_new(fft_backend_default(), len)),
+      buf_r_in(n),
+      buf_c_in(n),
+      buf_c_out(n),
+      sc(2.0/(mha_real_t)n)
 {
-    p1 = rfftw_create_plan( n, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE );
-    p2 = fftw_create_plan( n, FFTW_BACKWARD, FFTW_ESTIMATE );
-    sc = 2.0/(mha_real_t)n;
 }
 
-MHASignal::hilbert_fftw_t::~hilbert_fftw_t()
-{
-    delete [] buf_r_in;
-    delete [] buf_r_out;
-    delete [] buf_c_in;
-    delete [] buf_c_out;
-}
-
-void MHASignal::hilbert_fftw_t::hilbert(const mha_wave_t* s_in,mha_wave_t* s_out)
+void MHASignal::hilbert_fft_t::hilbert(const mha_wave_t* s_in,mha_wave_t* s_out)
 {
     if( !s_in )
         throw MHA_ErrorMsg("hilbert: Invalid input signal pointer (NULL).");
@@ -1511,13 +1463,11 @@ void MHASignal::hilbert_fftw_t::hilbert(const mha_wave_t* s_in,mha_wave_t* s_out
     for( ch=0;ch<s_in->num_channels;ch++){
         for(k=0;k<n;k++)
             buf_r_in[k] = value(s_in,k,ch);
-        rfftw_one(p1,buf_r_in,buf_r_out);
-        memset(buf_c_in,0,n*sizeof(buf_c_in[0]));
-        for(k=0;k<n/2+1;k++)
-            buf_c_in[k].re = buf_r_out[k];
+        // positive frequencies only, negative frequencies stay zero
+        fft->real2complex(buf_r_in.data(),buf_c_in.data());
         for(k=n/2+1;k<n;k++)
-            buf_c_in[n-k].im = buf_r_out[k];
-        fftw_one(p2,buf_c_in,buf_c_out);
+            buf_c_in[k] = mha_complex_t{0, 0};
+        fft->complex2complex(buf_c_in.data(),buf_c_out.data(),false);
         for(k=0;k<n;k++)
             value(s_out,k,ch) = sc * buf_c_out[k].im;
     }
@@ -1525,18 +1475,164 @@ void MHASignal::hilbert_fftw_t::hilbert(const mha_wave_t* s_in,mha_wave_t* s_out
     
 
 MHASignal::hilbert_t::hilbert_t(unsigned int len)
-    : h(new hilbert_fftw_t(len))
+    : h(new hilbert_fft_t(len))
 {
 }
 
 MHASignal::hilbert_t::~hilbert_t()
 {
-    delete (hilbert_fftw_t*)h;
+    delete (hilbert_fft_t*)h;
 }
 
 void MHASignal::hilbert_t::operator()(const mha_wave_t* s_in,mha_wave_t* s_out)
 {
-    ((hilbert_fftw_t*)h)->hilbert(s_in,s_out);
+    ((hilbert_fft_t*)h)->hilbert(s_in,s_out);
+}
+
+/*
+ * DCT
+ */
+
+MHASignal::dct_t::dct_t(unsigned int n_, type_t type_)
+    : n(n_),
+      type(type_),
+      // DCT-I of n = M+1 points: split into halves for even M, else
+      // real FFT of the even extension of length 2M
+      nfft(type == DCT_II || n < 2U ? n
+           : (n % 2U && n >= dct1_min_split ? 0U : 2U * (n - 1U))),
+      buf_x(n),
+      buf_y(n),
+      buf_fft(std::max(n, nfft)),
+      buf_spec(nfft / 2U + 1U)
+{
+    if( n < 2U )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "dct: At least 2 points required (got %u).", n);
+    if( type == DCT_I && !nfft ) {
+        even_part.reset(new dct_t((n - 1U) / 2U + 1U, DCT_I));
+        odd_part.reset(new dct_t((n - 1U) / 2U, DCT_II));
+        return;
+    }
+    fft = fft_backend_new(fft_backend_default(), nfft);
+    if( type == DCT_II )
+        for(unsigned int k = 0; k < n; ++k) {
+            tw_cos.push_back(cos(M_PI * k / (2.0 * n)));
+            tw_sin.push_back(sin(M_PI * k / (2.0 * n)));
+        }
+}
+
+MHASignal::dct_t::~dct_t()
+{
+}
+
+void MHASignal::dct_t::check_dims(const mha_wave_t & in,
+                                  const mha_wave_t & out) const
+{
+    if( in.num_frames != n || out.num_frames != n )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "dct: Invalid signal dimension (in: %u, out: %u,"
+                        " n: %u).", in.num_frames, out.num_frames, n);
+    if( in.num_channels != out.num_channels )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "dct: Input and output signal need same number of"
+                        " channels (in: %u, out: %u).",
+                        in.num_channels, out.num_channels);
+}
+
+/** DCT-I.  For even M = n-1, the even outputs are the DCT-I of
+    the M/2+1 points x_j + x_{M-j} and the odd outputs are the DCT-III
+    of the M/2 points x_j - x_{M-j}, i.e. M times the inverse DCT-II.
+    Else it is the real FFT of the even extension of x. */
+void MHASignal::dct_t::dct1(const mha_real_t * x, mha_real_t * y)
+{
+    const unsigned int M = n - 1U;
+    if( even_part ) {
+        const unsigned int L = M / 2U;
+        mha_real_t * a = buf_fft.data();
+        mha_real_t * b = a + L + 1U;
+        for(unsigned int j = 0; j < L; ++j) {
+            a[j] = x[j] + x[M - j];
+            b[j] = x[j] - x[M - j];
+        }
+        a[L] = 2.0f * x[L];
+        even_part->dct1(a, even_part->buf_y.data());
+        odd_part->idct2(b, odd_part->buf_y.data());
+        for(unsigned int k = 0; k <= L; ++k)
+            y[2U * k] = even_part->buf_y[k];
+        for(unsigned int k = 0; k < L; ++k)
+            y[2U * k + 1U] = M * odd_part->buf_y[k];
+    } else {
+        for(unsigned int j = 0; j <= M; ++j)
+            buf_fft[j] = x[j];
+        for(unsigned int j = 1; j < M; ++j)
+            buf_fft[nfft - j] = x[j];
+        fft->real2complex(buf_fft.data(), buf_spec.data());
+        for(unsigned int k = 0; k <= M; ++k)
+            y[k] = buf_spec[k].re;
+    }
+}
+
+/** DCT-II with the real FFT of the even samples followed by the odd
+    samples in reverse order (Makhoul) */
+void MHASignal::dct_t::dct2(const mha_real_t * x, mha_real_t * y)
+{
+    for(unsigned int j = 0; j < n; ++j)
+        buf_fft[j % 2U ? n - 1U - j / 2U : j / 2U] = x[j];
+    fft->real2complex(buf_fft.data(), buf_spec.data());
+    for(unsigned int k = 0; k < n; ++k) {
+        const mha_complex_t V =
+            k <= n / 2U ? buf_spec[k] : _conjugate(buf_spec[n - k]);
+        y[k] = 2.0f * (tw_cos[k] * V.re + tw_sin[k] * V.im);
+    }
+}
+
+/** Inverse of dct2 */
+void MHASignal::dct_t::idct2(const mha_real_t * x, mha_real_t * y)
+{
+    for(unsigned int k = 0; k <= n / 2U; ++k) {
+        const mha_real_t re = 0.5f * x[k];
+        const mha_real_t im = k ? -0.5f * x[n - k] : 0.0f;
+        buf_spec[k].re = tw_cos[k] * re - tw_sin[k] * im;
+        buf_spec[k].im = tw_sin[k] * re + tw_cos[k] * im;
+    }
+    fft->complex2real(buf_spec.data(), buf_fft.data());
+    const mha_real_t scale = 1.0f / n;
+    for(unsigned int j = 0; j < n; ++j)
+        y[j] = scale * buf_fft[j % 2U ? n - 1U - j / 2U : j / 2U];
+}
+
+void MHASignal::dct_t::forward(const mha_wave_t & in, mha_wave_t & out)
+{
+    check_dims(in, out);
+    for(unsigned int ch = 0; ch < in.num_channels; ++ch) {
+        for(unsigned int k = 0; k < n; ++k)
+            buf_x[k] = value(in, k, ch);
+        if( type == DCT_I )
+            dct1(buf_x.data(), buf_y.data());
+        else
+            dct2(buf_x.data(), buf_y.data());
+        for(unsigned int k = 0; k < n; ++k)
+            value(out, k, ch) = buf_y[k];
+    }
+}
+
+void MHASignal::dct_t::inverse(const mha_wave_t & in, mha_wave_t & out)
+{
+    check_dims(in, out);
+    for(unsigned int ch = 0; ch < in.num_channels; ++ch) {
+        for(unsigned int k = 0; k < n; ++k)
+            buf_x[k] = value(in, k, ch);
+        if( type == DCT_I ) {
+            // DCT-I is its own inverse up to the factor 1/(2M)
+            dct1(buf_x.data(), buf_y.data());
+            const mha_real_t scale = 0.5f / (n - 1U);
+            for(unsigned int k = 0; k < n; ++k)
+                buf_y[k] *= scale;
+        } else
+            idct2(buf_x.data(), buf_y.data());
+        for(unsigned int k = 0; k < n; ++k)
+            value(out, k, ch) = buf_y[k];
+    }
 }
 
 MHASignal::minphase_t::minphase_t(unsigned int nfft,unsigned int ch)
@@ -33,6 +33,7 @@
 #include <numeric>
 #include <algorithm>
 #include <type_traits>
+#include <memory>
 #include "mha_parser.hh"
 
 // some platforms do not define M_PI in <cmath>
@@ -1641,6 +1642,18 @@ std::istream & operator>>(std::istream & i, mha_complex_t & c) {
    \param n FFT length.
 */
 mha_fft_t mha_fft_new(unsigned int n);
+/**
+   \ingroup mhafft
+   \brief Create a new FFT handle with batched multichannel transforms.
+
+   mha_fft_wave2spec and mha_fft_spec2wave transform all channels of
+   signals with the given number of channels in one backend call,
+   which avoids the per-channel plan dispatch and copies.  Signals
+   with other channel counts are still transformed correctly.
+   \param n FFT length.
+   \param channels Number of audio channels.
+*/
+mha_fft_t mha_fft_new(unsigned int n, unsigned int channels);
 /**
    \ingroup mhafft
    \brief Destroy an FFT handle.
@@ -1817,6 +1830,79 @@ namespace MHASignal {
         void* h;
     };
 
+    class fft_backend_t;
+
+    /**
+       \ingroup mhafft
+       \brief Real discrete cosine transforms of type I and II.
+
+       The DCT_II is computed with a real FFT of the transform length
+       instead of a complex FFT of the symmetrically extended signal
+       of four times the length.  The DCT_I of an odd number of
+       points is split recursively into a DCT_I of the even and a
+       DCT_II of the odd outputs, each of half length, else it is the
+       real FFT of the even extension of twice the length.  Each
+       channel of a waveform is transformed along its frames.  Input
+       and output may be the same signal.
+
+       The forward transforms are unscaled:
+       - DCT_I of n = M+1 points:
+         \f$ X_k = x_0 + (-1)^k x_M + 2\sum_{j=1}^{M-1} x_j \cos(\pi j k/M) \f$,
+         which is the DFT of length 2M of the even extension of x.
+         Cepstra of real spectra can be computed with it: The
+         spectrum bins 0 to fftlen/2 are the n = fftlen/2+1 points.
+       - DCT_II of n points:
+         \f$ X_k = 2\sum_{j=0}^{n-1} x_j \cos(\pi k (2j+1)/(2n)) \f$.
+
+       The inverse transforms are scaled such that they invert the
+       forward transforms.  The conventions are those of the FFTW
+       transforms REDFT00 and REDFT10.
+
+       Instances are not thread safe: Each thread needs its own object.
+    */
+    class dct_t {
+    public:
+        /** Transform types */
+        enum type_t {DCT_I, DCT_II};
+        /** \param n Number of points, at least 2
+            \param type Transform type */
+        dct_t(unsigned int n, type_t type);
+        ~dct_t();
+        dct_t(const dct_t &) = delete;
+        dct_t & operator=(const dct_t &) = delete;
+        /** \brief Forward transform of all channels.
+            \param in Input signal, n frames
+            \param out Output signal, n frames, same number of channels as in */
+        void forward(const mha_wave_t & in, mha_wave_t & out);
+        /** \brief Inverse transform of all channels.
+            \param in Input signal, n frames
+            \param out Output signal, n frames, same number of channels as in */
+        void inverse(const mha_wave_t & in, mha_wave_t & out);
+        /** Number of points */
+        unsigned int get_length() const {return n;}
+    private:
+        /** Smallest odd DCT-I length that is split into halves */
+        static constexpr unsigned int dct1_min_split = 17U;
+        void check_dims(const mha_wave_t & in, const mha_wave_t & out) const;
+        void dct1(const mha_real_t * x, mha_real_t * y);
+        void dct2(const mha_real_t * x, mha_real_t * y);
+        void idct2(const mha_real_t * x, mha_real_t * y);
+        const unsigned int n;
+        const type_t type;
+        /** Length of the real FFT, 0 if the DCT-I is split into halves */
+        const unsigned int nfft;
+        std::unique_ptr<fft_backend_t> fft;
+        /** DCT-II twiddle factors */
+        std::vector<mha_real_t> tw_cos, tw_sin;
+        /** DCT-I of the even and DCT-II of the odd outputs of a split
+            DCT-I */
+        std::unique_ptr<dct_t> even_part, odd_part;
+        /** One channel of the input and the output signal */
+        std::vector<mha_real_t> buf_x, buf_y;
+        std::vector<mha_real_t> buf_fft;
+        std::vector<mha_complex_t> buf_spec;
+    };
+
     /**
        \ingroup mhasignal
        \brief Minimal phase function
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2008 2013 2016 2017 2018 2021 HörTech gGmbH
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -17,15 +18,28 @@
 #define __MHA_SIGNAL_FFT_H__
 
 #include "mha.hh"
-
-#include "sfftw.h"
-#include "srfftw.h"
+#include "mha_fft_backend.hh"
+#include <vector>
 
 namespace MHASignal {
 
     class fft_t {
     public:
-        fft_t( const unsigned int & );
+        /** \param n FFT length
+            \param backend FFT implementation to use */
+        explicit fft_t( const unsigned int & n,
+                        fft_backend_id_t backend = fft_backend_default() );
+        /** FFT object with batched multichannel transforms: Waveforms
+            of n frames and spectra with the given number of channels
+            are transformed in one backend call for all channels,
+            directly between the interleaved mha_wave_t and the
+            non-interleaved mha_spec_t memory.  Signals with other
+            dimensions are transformed channel by channel.
+            \param n FFT length
+            \param channels Number of channels of the batched transforms
+            \param backend FFT implementation to use */
+        fft_t( const unsigned int & n, unsigned int channels,
+               fft_backend_id_t backend = fft_backend_default() );
         ~fft_t(  );
         /// fast fourier transform. if swap is set, the buffer halfes
         /// of the wave signal are exchanged before computing the fft.
@@ -40,19 +54,30 @@ namespace MHASignal {
         void spec2wave_scale( const mha_spec_t *, mha_wave_t * );
         void forward_scale( mha_spec_t* sIn, mha_spec_t* sOut );
         void backward_scale( mha_spec_t* sIn, mha_spec_t* sOut );
+        /// Identifier of the FFT implementation used by this object
+        fft_backend_id_t get_backend_id() const {return backend->get_id();}
+        /// Number of channels of batched transforms, 0 if not batched
+        unsigned int get_batch_channels() const {return batch_channels;}
     private:
         unsigned int nfft;
         unsigned int n_re;
         unsigned int n_im;
         mha_real_t scale;
-        void sort_fftw2spec( fftw_real * s_fftw, mha_spec_t * s_spec, unsigned int ch );
-        void sort_spec2fftw( fftw_real * s_fftw, const mha_spec_t * s_spec, unsigned int ch );
-        mha_real_t *buf_in;
-        mha_real_t *buf_out;
-        rfftw_plan fftw_plan_wave2spec;
-        rfftw_plan fftw_plan_spec2wave;
-        fftw_plan fftw_plan_fft;
-        fftw_plan fftw_plan_ifft;
+        void check_spec_frames( const mha_spec_t * s_spec ) const;
+        void check_complex_dims( const mha_spec_t * sIn,
+                                 const mha_spec_t * sOut ) const;
+        void complex2complex( const mha_spec_t * sIn, mha_spec_t * sOut,
+                              bool forward );
+        void wave2spec_multiply( const mha_wave_t * wave, mha_spec_t * spec,
+                                 bool swap, mha_real_t factor );
+        void spec2wave_multiply( const mha_spec_t * spec, mha_wave_t * wave,
+                                 unsigned int offset, mha_real_t factor );
+        unsigned int batch_channels;
+        std::unique_ptr<fft_backend_t> backend;
+        std::vector<mha_real_t> buf_in;
+        std::vector<mha_real_t> buf_out;
+        /// Complete interleaved iFFT output for spec2wave with offset
+        std::vector<mha_real_t> buf_wave;
     };
 
 }
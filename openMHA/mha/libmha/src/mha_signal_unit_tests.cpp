@@ -734,6 +734,94 @@ TEST(mha_signal_helper_functions, bin2freq) {
   EXPECT_THROW(MHASignal::bin2freq(-0.000001f, 256, 44100), MHA_Error);
 }
 
+namespace {
+  /// Direct evaluation of the unscaled DCT-I and DCT-II sums
+  double direct_dct(MHASignal::dct_t::type_t type,
+                    const MHASignal::waveform_t & x, unsigned k, unsigned ch)
+  {
+    const unsigned n = x.num_frames;
+    double y = 0;
+    if (type == MHASignal::dct_t::DCT_I) {
+      const unsigned M = n - 1;
+      y = x.value(0, ch) + ((k % 2) ? -1.0 : 1.0) * x.value(M, ch);
+      for (unsigned j = 1; j < M; ++j)
+        y += 2.0 * x.value(j, ch) * cos(M_PI * j * k / M);
+    } else {
+      for (unsigned j = 0; j < n; ++j)
+        y += 2.0 * x.value(j, ch) * cos(M_PI * k * (2 * j + 1) / (2.0 * n));
+    }
+    return y;
+  }
+
+  void test_dct(MHASignal::dct_t::type_t type, unsigned n)
+  {
+    SCOPED_TRACE("n=" + std::to_string(n));
+    const unsigned channels = 2;
+    MHASignal::waveform_t x(n, channels), y(n, channels), z(n, channels);
+    for (unsigned k = 0; k < n; ++k)
+      for (unsigned ch = 0; ch < channels; ++ch)
+        x.value(k, ch) = sin(0.37 * k * k + ch) + 0.1 * ch;
+    MHASignal::dct_t dct(n, type);
+    EXPECT_EQ(n, dct.get_length());
+    dct.forward(x, y);
+    for (unsigned k = 0; k < n; ++k)
+      for (unsigned ch = 0; ch < channels; ++ch)
+        EXPECT_NEAR(direct_dct(type, x, k, ch), y.value(k, ch), 2e-5 * n)
+          << "k=" << k << " ch=" << ch;
+    dct.inverse(y, z);
+    for (unsigned k = 0; k < n * channels; ++k)
+      EXPECT_NEAR(x.buf[k], z.buf[k], 1e-5);
+    // in place
+    dct.forward(z, z);
+    dct.inverse(z, z);
+    for (unsigned k = 0; k < n * channels; ++k)
+      EXPECT_NEAR(x.buf[k], z.buf[k], 1e-5);
+  }
+}
+
+TEST(dct_t, dct1_matches_direct_sum_for_even_and_odd_lengths)
+{
+  for (unsigned n : {2U, 3U, 4U, 5U, 8U, 9U, 17U, 65U, 129U, 257U})
+    test_dct(MHASignal::dct_t::DCT_I, n);
+}
+
+TEST(dct_t, dct2_matches_direct_sum_for_even_and_odd_lengths)
+{
+  for (unsigned n : {2U, 3U, 4U, 5U, 8U, 9U, 16U, 63U, 128U, 256U})
+    test_dct(MHASignal::dct_t::DCT_II, n);
+}
+
+TEST(dct_t, dct1_of_log_spectrum_is_real_cepstrum)
+{
+  // The DCT-I of the fftlen/2+1 bins of a real, even spectrum is the
+  // DFT of the full spectrum
+  const unsigned fftlen = 16;
+  std::vector<double> spec(fftlen);
+  MHASignal::waveform_t half(fftlen / 2 + 1, 1), ceps(fftlen / 2 + 1, 1);
+  for (unsigned k = 0; k <= fftlen / 2; ++k) {
+    half.value(k, 0) = log(1.5 + cos(0.3 * k));
+    spec[k] = spec[(fftlen - k) % fftlen] = half.value(k, 0);
+  }
+  MHASignal::dct_t dct(fftlen / 2 + 1, MHASignal::dct_t::DCT_I);
+  dct.inverse(half, ceps);
+  for (unsigned q = 0; q <= fftlen / 2; ++q) {
+    double c = 0;
+    for (unsigned k = 0; k < fftlen; ++k)
+      c += spec[k] * cos(2 * M_PI * q * k / fftlen);
+    EXPECT_NEAR(c / fftlen, ceps.value(q, 0), 1e-6);
+  }
+}
+
+TEST(dct_t, rejects_wrong_dimensions)
+{
+  EXPECT_THROW(MHASignal::dct_t(1, MHASignal::dct_t::DCT_I), MHA_Error);
+  EXPECT_THROW(MHASignal::dct_t(0, MHASignal::dct_t::DCT_II), MHA_Error);
+  MHASignal::dct_t dct(8, MHASignal::dct_t::DCT_II);
+  MHASignal::waveform_t a(8, 2), b(9, 2), c(8, 1);
+  EXPECT_THROW(dct.forward(a, b), MHA_Error);
+  EXPECT_THROW(dct.inverse(a, c), MHA_Error);
+}
+
 // Local Variables:
 // compile-command: "make -C .. unit-tests"
 // coding: utf-8-unix
@@ -0,0 +1,1069 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_simd.hh"
+#include "mha_signal.hh"
+#include "mha_error.hh"
+#include "mha_os.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Bit-identical results of all implementations require that the
+// compiler neither reorders the floating point operations (which
+// -ffast-math allows) nor contracts multiplications and additions into
+// fused multiply-add instructions.  The Makefile compiles this file
+// with -fno-associative-math -ffp-contract=off.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define MHA_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define MHA_SIMD_X86 0
+#endif
+
+static_assert(sizeof(mha_complex_t) == 2 * sizeof(float),
+              "The vectorized kernels expect mha_complex_t to consist of"
+              " two single precision floats");
+
+namespace {
+    using MHASignal::simd_level_t;
+
+    /** Scalar implementation of conj_mac.  The vectorized versions
+        compute exactly the same expressions. */
+    void conj_mac_scalar(mha_complex_t * acc, const mha_complex_t * w,
+                         const mha_complex_t * x, unsigned n)
+    {
+        for (unsigned k = 0; k < n; ++k) {
+            acc[k].re += w[k].re * x[k].re + w[k].im * x[k].im;
+            acc[k].im += w[k].re * x[k].im - w[k].im * x[k].re;
+        }
+    }
+
+    /** Scalar implementation of conj_mac_mix. */
+    void conj_mac_mix_scalar(mha_complex_t * acc,
+                             const mha_complex_t * const * w,
+                             const mha_real_t * g, unsigned nw,
+                             const mha_complex_t * x, unsigned n)
+    {
+        for (unsigned k = 0; k < n; ++k) {
+            mha_real_t wr = g[0] * w[0][k].re;
+            mha_real_t wi = g[0] * w[0][k].im;
+            for (unsigned i = 1; i < nw; ++i) {
+                wr = wr + g[i] * w[i][k].re;
+                wi = wi + g[i] * w[i][k].im;
+            }
+            acc[k].re += wr * x[k].re + wi * x[k].im;
+            acc[k].im += wr * x[k].im - wi * x[k].re;
+        }
+    }
+
+    /** Scalar implementation of mac_split. */
+    void mac_split_scalar(mha_real_t * acc_re, mha_real_t * acc_im,
+                          const mha_real_t * w_re, const mha_real_t * w_im,
+                          const mha_real_t * x_re, const mha_real_t * x_im,
+                          unsigned n)
+    {
+        for (unsigned k = 0; k < n; ++k) {
+            acc_re[k] += w_re[k] * x_re[k] - w_im[k] * x_im[k];
+            acc_im[k] += w_re[k] * x_im[k] + w_im[k] * x_re[k];
+        }
+    }
+
+    /** Scalar implementation of mac_columns. */
+    void mac_columns_scalar(mha_real_t * y, const mha_real_t * a,
+                            unsigned stride, const mha_real_t * x,
+                            unsigned m, unsigned n)
+    {
+        for (unsigned j = 0; j < m; ++j) {
+            const mha_real_t * col = a + size_t(j) * stride;
+            for (unsigned k = 0; k < n; ++k)
+                y[k] += col[k] * x[j];
+        }
+    }
+
+    /* Constants of the level conversions.  pa22dbspl_fast computes
+       10*log10(25e8*x) as (e*ln(2) + ln(m)) * 10/ln(10) with y = 25e8*x =
+       m * 2^e, sqrt(1/2) <= m < sqrt(2), and ln(m) = 2 atanh(t) with
+       t = (m-1)/(m+1), |t| < 0.172, from the first 4 terms of the
+       series of atanh.  db2lin_fast computes 10^(x/20) = 2^y as
+       2^n * exp(f*ln(2)) with n = round(y), |f| <= 0.5, and a Taylor
+       polynomial of degree 6 of exp. */
+    const mha_real_t dbspl_scale = 25e+8f;
+    const mha_real_t ln2 = 0.693147180560f;
+    const mha_real_t sqrt2 = 1.41421356237f;
+    const mha_real_t ten_over_ln10 = 4.34294481903f;
+    const mha_real_t log2_10_over_20 = 0.166096404744f;
+    const mha_real_t exp2_min = -126.0f;
+    const mha_real_t exp2_max = 127.0f;
+
+    inline int32_t float_bits(float x)
+    {
+        int32_t i;
+        memcpy(&i, &x, sizeof(i));
+        return i;
+    }
+
+    inline float bits_float(int32_t i)
+    {
+        float x;
+        memcpy(&x, &i, sizeof(x));
+        return x;
+    }
+
+    /** Scalar implementation of pa22dbspl_fast.  The vectorized
+        versions compute exactly the same expressions. */
+    void pa22dbspl_fast_scalar(const mha_real_t * in, mha_real_t * out,
+                               unsigned n)
+    {
+        for (unsigned k = 0; k < n; ++k) {
+            const mha_real_t y = dbspl_scale * in[k];
+            const int32_t bits = float_bits(y);
+            int32_t e = ((bits >> 23) & 0xff) - 127;
+            mha_real_t m = bits_float((bits & 0x007fffff) | 0x3f800000);
+            if (m > sqrt2) {
+                m = m * 0.5f;
+                e = e + 1;
+            }
+            const mha_real_t t = (m - 1.0f) / (m + 1.0f);
+            const mha_real_t t2 = t * t;
+            mha_real_t p = (1.0f / 7.0f) * t2 + (1.0f / 5.0f);
+            p = p * t2 + (1.0f / 3.0f);
+            p = p * t2 + 1.0f;
+            const mha_real_t lnm = (t + t) * p;
+            mha_real_t db = (static_cast<mha_real_t>(e) * ln2 + lnm)
+                * ten_over_ln10;
+            if (!(y > 0.0f))
+                db = (y == 0.0f) ? -std::numeric_limits<mha_real_t>::infinity()
+                    : std::numeric_limits<mha_real_t>::quiet_NaN();
+            if (y == std::numeric_limits<mha_real_t>::infinity())
+                db = y;
+            out[k] = db;
+        }
+    }
+
+    /** Scalar implementation of db2lin_fast. */
+    void db2lin_fast_scalar(const mha_real_t * in, mha_real_t * out,
+                            unsigned n)
+    {
+        for (unsigned k = 0; k < n; ++k) {
+            const mha_real_t y0 = in[k] * log2_10_over_20;
+            // same operand order and NaN behaviour as maxps and minps
+            mha_real_t y = (y0 > exp2_min) ? y0 : exp2_min;
+            y = (y < exp2_max) ? y : exp2_max;
+            const int32_t i = static_cast<int32_t>(std::lrint(y));
+            const mha_real_t z = (y - static_cast<mha_real_t>(i)) * ln2;
+            mha_real_t p = z * (1.0f / 720.0f) + (1.0f / 120.0f);
+            p = p * z + (1.0f / 24.0f);
+            p = p * z + (1.0f / 6.0f);
+            p = p * z + 0.5f;
+            p = p * z + 1.0f;
+            p = p * z + 1.0f;
+            mha_real_t lin = p * bits_float((i + 127) << 23);
+            if (y0 < exp2_min)
+                lin = 0.0f;
+            out[k] = lin;
+        }
+    }
+
+    /** Scalar implementation of table_interp.  The index is clamped to
+        the range of valid interval starts before it is truncated, so
+        that interpolation and extrapolation use the same operations
+        in all implementations. */
+    void table_interp_scalar(const mha_real_t * table, unsigned len,
+                             mha_real_t xmin, mha_real_t scalefac,
+                             const mha_real_t * x, mha_real_t * y,
+                             unsigned n, unsigned stride)
+    {
+        const mha_real_t last = static_cast<mha_real_t>(len - 2U);
+        for (unsigned k = 0; k < n; ++k) {
+            const mha_real_t ind = (x[k * stride] - xmin) * scalefac;
+            // same operand order and NaN behaviour as maxps and minps
+            mha_real_t fi = (ind > 0.0f) ? ind : 0.0f;
+            fi = (fi < last) ? fi : last;
+            const int32_t i = static_cast<int32_t>(fi);
+            const mha_real_t frac = ind - static_cast<mha_real_t>(i);
+            y[k * stride] = table[i] + frac * (table[i + 1] - table[i]);
+        }
+    }
+
+#if MHA_SIMD_X86
+    /* Two complex values per 128 bit register, w = [wr0 wi0 wr1 wi1],
+       x = [xr0 xi0 xr1 xi1]:
+       a = w * x          = [wr0*xr0 wi0*xi0 wr1*xr1 wi1*xi1]
+       b = w * swap(x)    = [wr0*xi0 wi0*xr0 wr1*xi1 wi1*xr1]
+       even(a,b)          = [wr0*xr0 wr1*xr1 wr0*xi0 wr1*xi1]
+       odd(a,b) * [1 1 -1 -1] = [wi0*xi0 wi1*xi1 -wi0*xr0 -wi1*xr1]
+       The sum of both is [re0 re1 im0 im1], which is reordered to the
+       interleaved layout conj(w)*x = [re0 im0 re1 im1]. */
+    inline __m128 conj_mul_sse2(__m128 vw, __m128 vx)
+    {
+        const __m128 sign = _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f);
+        const __m128 a = _mm_mul_ps(vw, vx);
+        const __m128 b =
+            _mm_mul_ps(vw, _mm_shuffle_ps(vx, vx, _MM_SHUFFLE(2,3,0,1)));
+        const __m128 even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+        const __m128 odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+        const __m128 res = _mm_add_ps(even, _mm_xor_ps(odd, sign));
+        return _mm_shuffle_ps(res, res, _MM_SHUFFLE(3,1,2,0));
+    }
+
+    void conj_mac_sse2(mha_complex_t * acc, const mha_complex_t * w,
+                       const mha_complex_t * x, unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 2 <= n; k += 2) {
+            const __m128 prod = conj_mul_sse2(_mm_loadu_ps(&w[k].re),
+                                              _mm_loadu_ps(&x[k].re));
+            _mm_storeu_ps(&acc[k].re,
+                          _mm_add_ps(_mm_loadu_ps(&acc[k].re), prod));
+        }
+        conj_mac_scalar(acc + k, w + k, x + k, n - k);
+    }
+
+    void conj_mac_mix_sse2(mha_complex_t * acc,
+                           const mha_complex_t * const * w,
+                           const mha_real_t * g, unsigned nw,
+                           const mha_complex_t * x, unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 2 <= n; k += 2) {
+            __m128 vw = _mm_mul_ps(_mm_set1_ps(g[0]), _mm_loadu_ps(&w[0][k].re));
+            for (unsigned i = 1; i < nw; ++i)
+                vw = _mm_add_ps(vw, _mm_mul_ps(_mm_set1_ps(g[i]),
+                                               _mm_loadu_ps(&w[i][k].re)));
+            const __m128 prod = conj_mul_sse2(vw, _mm_loadu_ps(&x[k].re));
+            _mm_storeu_ps(&acc[k].re,
+                          _mm_add_ps(_mm_loadu_ps(&acc[k].re), prod));
+        }
+        const mha_complex_t * wk[MHASignal::conj_mac_mix_max_terms];
+        for (unsigned i = 0; i < nw; ++i)
+            wk[i] = w[i] + k;
+        conj_mac_mix_scalar(acc + k, wk, g, nw, x + k, n - k);
+    }
+
+    void mac_split_sse2(mha_real_t * acc_re, mha_real_t * acc_im,
+                        const mha_real_t * w_re, const mha_real_t * w_im,
+                        const mha_real_t * x_re, const mha_real_t * x_im,
+                        unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 4 <= n; k += 4) {
+            const __m128 wr = _mm_loadu_ps(w_re + k);
+            const __m128 wi = _mm_loadu_ps(w_im + k);
+            const __m128 xr = _mm_loadu_ps(x_re + k);
+            const __m128 xi = _mm_loadu_ps(x_im + k);
+            const __m128 re = _mm_sub_ps(_mm_mul_ps(wr, xr), _mm_mul_ps(wi, xi));
+            const __m128 im = _mm_add_ps(_mm_mul_ps(wr, xi), _mm_mul_ps(wi, xr));
+            _mm_storeu_ps(acc_re + k, _mm_add_ps(_mm_loadu_ps(acc_re + k), re));
+            _mm_storeu_ps(acc_im + k, _mm_add_ps(_mm_loadu_ps(acc_im + k), im));
+        }
+        mac_split_scalar(acc_re + k, acc_im + k, w_re + k, w_im + k,
+                         x_re + k, x_im + k, n - k);
+    }
+
+    /* The accumulators of four register widths of rows stay in
+       registers while the columns are traversed. */
+    void mac_columns_sse2(mha_real_t * y, const mha_real_t * a,
+                          unsigned stride, const mha_real_t * x,
+                          unsigned m, unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 16 <= n; k += 16) {
+            __m128 y0 = _mm_loadu_ps(y + k), y1 = _mm_loadu_ps(y + k + 4);
+            __m128 y2 = _mm_loadu_ps(y + k + 8), y3 = _mm_loadu_ps(y + k + 12);
+            const mha_real_t * col = a + k;
+            for (unsigned j = 0; j < m; ++j, col += stride) {
+                const __m128 xj = _mm_set1_ps(x[j]);
+                y0 = _mm_add_ps(y0, _mm_mul_ps(_mm_loadu_ps(col), xj));
+                y1 = _mm_add_ps(y1, _mm_mul_ps(_mm_loadu_ps(col + 4), xj));
+                y2 = _mm_add_ps(y2, _mm_mul_ps(_mm_loadu_ps(col + 8), xj));
+                y3 = _mm_add_ps(y3, _mm_mul_ps(_mm_loadu_ps(col + 12), xj));
+            }
+            _mm_storeu_ps(y + k, y0);
+            _mm_storeu_ps(y + k + 4, y1);
+            _mm_storeu_ps(y + k + 8, y2);
+            _mm_storeu_ps(y + k + 12, y3);
+        }
+        for (; k + 4 <= n; k += 4) {
+            __m128 y0 = _mm_loadu_ps(y + k);
+            const mha_real_t * col = a + k;
+            for (unsigned j = 0; j < m; ++j, col += stride)
+                y0 = _mm_add_ps(y0, _mm_mul_ps(_mm_loadu_ps(col),
+                                               _mm_set1_ps(x[j])));
+            _mm_storeu_ps(y + k, y0);
+        }
+        mac_columns_scalar(y + k, a + k, stride, x, m, n - k);
+    }
+
+    /* Same algorithm as conj_mul_sse2, applied to both 128 bit lanes
+       of a 256 bit register. */
+    __attribute__((target("avx2")))
+    inline __m256 conj_mul_avx2(__m256 vw, __m256 vx)
+    {
+        const __m256 sign = _mm256_set_ps(-0.0f, -0.0f, 0.0f, 0.0f,
+                                          -0.0f, -0.0f, 0.0f, 0.0f);
+        const __m256 a = _mm256_mul_ps(vw, vx);
+        const __m256 b =
+            _mm256_mul_ps(vw, _mm256_permute_ps(vx, _MM_SHUFFLE(2,3,0,1)));
+        const __m256 even = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+        const __m256 odd = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+        const __m256 res = _mm256_add_ps(even, _mm256_xor_ps(odd, sign));
+        return _mm256_permute_ps(res, _MM_SHUFFLE(3,1,2,0));
+    }
+
+    __attribute__((target("avx2")))
+    void conj_mac_avx2(mha_complex_t * acc, const mha_complex_t * w,
+                       const mha_complex_t * x, unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 4 <= n; k += 4) {
+            const __m256 prod = conj_mul_avx2(_mm256_loadu_ps(&w[k].re),
+                                              _mm256_loadu_ps(&x[k].re));
+            _mm256_storeu_ps(&acc[k].re,
+                             _mm256_add_ps(_mm256_loadu_ps(&acc[k].re), prod));
+        }
+        // Compilers do not reliably clear the upper register halves
+        // before calling non-VEX code, which then pays a state
+        // transition penalty on every call.
+        _mm256_zeroupper();
+        conj_mac_sse2(acc + k, w + k, x + k, n - k);
+    }
+
+    __attribute__((target("avx2")))
+    void conj_mac_mix_avx2(mha_complex_t * acc,
+                           const mha_complex_t * const * w,
+                           const mha_real_t * g, unsigned nw,
+                           const mha_complex_t * x, unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 4 <= n; k += 4) {
+            __m256 vw = _mm256_mul_ps(_mm256_set1_ps(g[0]),
+                                      _mm256_loadu_ps(&w[0][k].re));
+            for (unsigned i = 1; i < nw; ++i)
+                vw = _mm256_add_ps(vw,
+                                   _mm256_mul_ps(_mm256_set1_ps(g[i]),
+                                                 _mm256_loadu_ps(&w[i][k].re)));
+            const __m256 prod = conj_mul_avx2(vw, _mm256_loadu_ps(&x[k].re));
+            _mm256_storeu_ps(&acc[k].re,
+                             _mm256_add_ps(_mm256_loadu_ps(&acc[k].re), prod));
+        }
+        const mha_complex_t * wk[MHASignal::conj_mac_mix_max_terms];
+        for (unsigned i = 0; i < nw; ++i)
+            wk[i] = w[i] + k;
+        _mm256_zeroupper();
+        conj_mac_mix_sse2(acc + k, wk, g, nw, x + k, n - k);
+    }
+
+    __attribute__((target("avx2")))
+    void mac_split_avx2(mha_real_t * acc_re, mha_real_t * acc_im,
+                        const mha_real_t * w_re, const mha_real_t * w_im,
+                        const mha_real_t * x_re, const mha_real_t * x_im,
+                        unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 8 <= n; k += 8) {
+            const __m256 wr = _mm256_loadu_ps(w_re + k);
+            const __m256 wi = _mm256_loadu_ps(w_im + k);
+            const __m256 xr = _mm256_loadu_ps(x_re + k);
+            const __m256 xi = _mm256_loadu_ps(x_im + k);
+            const __m256 re = _mm256_sub_ps(_mm256_mul_ps(wr, xr),
+                                            _mm256_mul_ps(wi, xi));
+            const __m256 im = _mm256_add_ps(_mm256_mul_ps(wr, xi),
+                                            _mm256_mul_ps(wi, xr));
+            _mm256_storeu_ps(acc_re + k,
+                             _mm256_add_ps(_mm256_loadu_ps(acc_re + k), re));
+            _mm256_storeu_ps(acc_im + k,
+                             _mm256_add_ps(_mm256_loadu_ps(acc_im + k), im));
+        }
+        _mm256_zeroupper();
+        mac_split_sse2(acc_re + k, acc_im + k, w_re + k, w_im + k,
+                       x_re + k, x_im + k, n - k);
+    }
+
+    __attribute__((target("avx2")))
+    void mac_columns_avx2(mha_real_t * y, const mha_real_t * a,
+                          unsigned stride, const mha_real_t * x,
+                          unsigned m, unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 32 <= n; k += 32) {
+            __m256 y0 = _mm256_loadu_ps(y + k);
+            __m256 y1 = _mm256_loadu_ps(y + k + 8);
+            __m256 y2 = _mm256_loadu_ps(y + k + 16);
+            __m256 y3 = _mm256_loadu_ps(y + k + 24);
+            const mha_real_t * col = a + k;
+            for (unsigned j = 0; j < m; ++j, col += stride) {
+                const __m256 xj = _mm256_set1_ps(x[j]);
+                y0 = _mm256_add_ps(y0, _mm256_mul_ps(_mm256_loadu_ps(col), xj));
+                y1 = _mm256_add_ps(y1, _mm256_mul_ps(_mm256_loadu_ps(col + 8),
+                                                     xj));
+                y2 = _mm256_add_ps(y2, _mm256_mul_ps(_mm256_loadu_ps(col + 16),
+                                                     xj));
+                y3 = _mm256_add_ps(y3, _mm256_mul_ps(_mm256_loadu_ps(col + 24),
+                                                     xj));
+            }
+            _mm256_storeu_ps(y + k, y0);
+            _mm256_storeu_ps(y + k + 8, y1);
+            _mm256_storeu_ps(y + k + 16, y2);
+            _mm256_storeu_ps(y + k + 24, y3);
+        }
+        for (; k + 8 <= n; k += 8) {
+            __m256 y0 = _mm256_loadu_ps(y + k);
+            const mha_real_t * col = a + k;
+            for (unsigned j = 0; j < m; ++j, col += stride)
+                y0 = _mm256_add_ps(y0, _mm256_mul_ps(_mm256_loadu_ps(col),
+                                                     _mm256_set1_ps(x[j])));
+            _mm256_storeu_ps(y + k, y0);
+        }
+        _mm256_zeroupper();
+        mac_columns_sse2(y + k, a + k, stride, x, m, n - k);
+    }
+
+    void pa22dbspl_fast_sse2(const mha_real_t * in, mha_real_t * out,
+                             unsigned n)
+    {
+        const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+        const __m128 nan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        unsigned k = 0;
+        for (; k + 4 <= n; k += 4) {
+            const __m128 y = _mm_mul_ps(_mm_set1_ps(dbspl_scale),
+                                        _mm_loadu_ps(in + k));
+            const __m128i bits = _mm_castps_si128(y);
+            __m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23),
+                                                    _mm_set1_epi32(0xff)),
+                                      _mm_set1_epi32(127));
+            __m128 m = _mm_castsi128_ps(
+                _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                             _mm_set1_epi32(0x3f800000)));
+            const __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(sqrt2));
+            m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))),
+                          _mm_andnot_ps(big, m));
+            e = _mm_sub_epi32(e, _mm_castps_si128(big));
+            const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+            const __m128 t2 = _mm_mul_ps(t, t);
+            __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.0f / 7.0f), t2),
+                                  _mm_set1_ps(1.0f / 5.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 3.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, t2), one);
+            const __m128 lnm = _mm_mul_ps(_mm_add_ps(t, t), p);
+            __m128 db = _mm_mul_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(ln2)),
+                           lnm),
+                _mm_set1_ps(ten_over_ln10));
+            const __m128 positive = _mm_cmpgt_ps(y, zero);
+            const __m128 special =
+                _mm_or_ps(_mm_and_ps(_mm_cmpeq_ps(y, zero), _mm_sub_ps(zero, inf)),
+                          _mm_andnot_ps(_mm_cmpeq_ps(y, zero), nan));
+            db = _mm_or_ps(_mm_and_ps(positive, db),
+                           _mm_andnot_ps(positive, special));
+            const __m128 infinite = _mm_cmpeq_ps(y, inf);
+            db = _mm_or_ps(_mm_and_ps(infinite, inf),
+                           _mm_andnot_ps(infinite, db));
+            _mm_storeu_ps(out + k, db);
+        }
+        pa22dbspl_fast_scalar(in + k, out + k, n - k);
+    }
+
+    void db2lin_fast_sse2(const mha_real_t * in, mha_real_t * out,
+                          unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 4 <= n; k += 4) {
+            const __m128 y0 = _mm_mul_ps(_mm_loadu_ps(in + k),
+                                         _mm_set1_ps(log2_10_over_20));
+            __m128 y = _mm_max_ps(y0, _mm_set1_ps(exp2_min));
+            y = _mm_min_ps(y, _mm_set1_ps(exp2_max));
+            const __m128i i = _mm_cvtps_epi32(y);
+            const __m128 z = _mm_mul_ps(_mm_sub_ps(y, _mm_cvtepi32_ps(i)),
+                                        _mm_set1_ps(ln2));
+            __m128 p = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(1.0f / 720.0f)),
+                                  _mm_set1_ps(1.0f / 120.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.0f / 24.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.0f / 6.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(0.5f));
+            p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.0f));
+            const __m128 scale = _mm_castsi128_ps(
+                _mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23));
+            const __m128 lin = _mm_andnot_ps(
+                _mm_cmplt_ps(y0, _mm_set1_ps(exp2_min)), _mm_mul_ps(p, scale));
+            _mm_storeu_ps(out + k, lin);
+        }
+        db2lin_fast_scalar(in + k, out + k, n - k);
+    }
+
+    void table_interp_sse2(const mha_real_t * table, unsigned len,
+                           mha_real_t xmin, mha_real_t scalefac,
+                           const mha_real_t * x, mha_real_t * y,
+                           unsigned n, unsigned stride)
+    {
+        const __m128 last = _mm_set1_ps(static_cast<mha_real_t>(len - 2U));
+        alignas(16) int32_t i[4];
+        alignas(16) mha_real_t v[4];
+        unsigned k = 0;
+        for (; k + 4 <= n; k += 4) {
+            const mha_real_t * xk = x + k * stride;
+            const __m128 xv = (stride == 1U) ? _mm_loadu_ps(xk)
+                : _mm_setr_ps(xk[0], xk[stride], xk[2 * stride],
+                              xk[3 * stride]);
+            const __m128 ind = _mm_mul_ps(_mm_sub_ps(xv, _mm_set1_ps(xmin)),
+                                          _mm_set1_ps(scalefac));
+            __m128 fi = _mm_max_ps(ind, _mm_setzero_ps());
+            fi = _mm_min_ps(fi, last);
+            const __m128i iv = _mm_cvttps_epi32(fi);
+            _mm_store_si128(reinterpret_cast<__m128i *>(i), iv);
+            const __m128 frac = _mm_sub_ps(ind, _mm_cvtepi32_ps(iv));
+            const __m128 a = _mm_setr_ps(table[i[0]], table[i[1]],
+                                         table[i[2]], table[i[3]]);
+            const __m128 b = _mm_setr_ps(table[i[0] + 1], table[i[1] + 1],
+                                         table[i[2] + 1], table[i[3] + 1]);
+            const __m128 out = _mm_add_ps(a, _mm_mul_ps(frac, _mm_sub_ps(b, a)));
+            if (stride == 1U) {
+                _mm_storeu_ps(y + k, out);
+            } else {
+                _mm_store_ps(v, out);
+                for (unsigned j = 0; j < 4; ++j)
+                    y[(k + j) * stride] = v[j];
+            }
+        }
+        table_interp_scalar(table, len, xmin, scalefac, x + k * stride,
+                            y + k * stride, n - k, stride);
+    }
+
+    __attribute__((target("avx2")))
+    void pa22dbspl_fast_avx2(const mha_real_t * in, mha_real_t * out,
+                             unsigned n)
+    {
+        const __m256 inf =
+            _mm256_set1_ps(std::numeric_limits<float>::infinity());
+        const __m256 nan =
+            _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        unsigned k = 0;
+        for (; k + 8 <= n; k += 8) {
+            const __m256 y = _mm256_mul_ps(_mm256_set1_ps(dbspl_scale),
+                                           _mm256_loadu_ps(in + k));
+            const __m256i bits = _mm256_castps_si256(y);
+            __m256i e = _mm256_sub_epi32(
+                _mm256_and_si256(_mm256_srli_epi32(bits, 23),
+                                 _mm256_set1_epi32(0xff)),
+                _mm256_set1_epi32(127));
+            __m256 m = _mm256_castsi256_ps(
+                _mm256_or_si256(_mm256_and_si256(bits,
+                                                 _mm256_set1_epi32(0x007fffff)),
+                                _mm256_set1_epi32(0x3f800000)));
+            const __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(sqrt2),
+                                             _CMP_GT_OQ);
+            m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)),
+                                 big);
+            e = _mm256_sub_epi32(e, _mm256_castps_si256(big));
+            const __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one),
+                                           _mm256_add_ps(m, one));
+            const __m256 t2 = _mm256_mul_ps(t, t);
+            __m256 p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(1.0f / 7.0f),
+                                                   t2),
+                                     _mm256_set1_ps(1.0f / 5.0f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(1.0f / 3.0f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, t2), one);
+            const __m256 lnm = _mm256_mul_ps(_mm256_add_ps(t, t), p);
+            __m256 db = _mm256_mul_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(e),
+                                            _mm256_set1_ps(ln2)),
+                              lnm),
+                _mm256_set1_ps(ten_over_ln10));
+            const __m256 is_zero = _mm256_cmp_ps(y, zero, _CMP_EQ_OQ);
+            const __m256 special =
+                _mm256_blendv_ps(nan, _mm256_sub_ps(zero, inf), is_zero);
+            db = _mm256_blendv_ps(special, db,
+                                  _mm256_cmp_ps(y, zero, _CMP_GT_OQ));
+            db = _mm256_blendv_ps(db, inf, _mm256_cmp_ps(y, inf, _CMP_EQ_OQ));
+            _mm256_storeu_ps(out + k, db);
+        }
+        _mm256_zeroupper();
+        pa22dbspl_fast_sse2(in + k, out + k, n - k);
+    }
+
+    __attribute__((target("avx2")))
+    void db2lin_fast_avx2(const mha_real_t * in, mha_real_t * out,
+                          unsigned n)
+    {
+        unsigned k = 0;
+        for (; k + 8 <= n; k += 8) {
+            const __m256 y0 = _mm256_mul_ps(_mm256_loadu_ps(in + k),
+                                            _mm256_set1_ps(log2_10_over_20));
+            __m256 y = _mm256_max_ps(y0, _mm256_set1_ps(exp2_min));
+            y = _mm256_min_ps(y, _mm256_set1_ps(exp2_max));
+            const __m256i i = _mm256_cvtps_epi32(y);
+            const __m256 z = _mm256_mul_ps(_mm256_sub_ps(y, _mm256_cvtepi32_ps(i)),
+                                           _mm256_set1_ps(ln2));
+            __m256 p = _mm256_add_ps(_mm256_mul_ps(z,
+                                                   _mm256_set1_ps(1.0f / 720.0f)),
+                                     _mm256_set1_ps(1.0f / 120.0f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(1.0f / 24.0f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(1.0f / 6.0f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(0.5f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(1.0f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(1.0f));
+            const __m256 scale = _mm256_castsi256_ps(
+                _mm256_slli_epi32(_mm256_add_epi32(i, _mm256_set1_epi32(127)),
+                                  23));
+            const __m256 lin = _mm256_andnot_ps(
+                _mm256_cmp_ps(y0, _mm256_set1_ps(exp2_min), _CMP_LT_OQ),
+                _mm256_mul_ps(p, scale));
+            _mm256_storeu_ps(out + k, lin);
+        }
+        _mm256_zeroupper();
+        db2lin_fast_sse2(in + k, out + k, n - k);
+    }
+
+    __attribute__((target("avx2")))
+    void table_interp_avx2(const mha_real_t * table, unsigned len,
+                           mha_real_t xmin, mha_real_t scalefac,
+                           const mha_real_t * x, mha_real_t * y,
+                           unsigned n, unsigned stride)
+    {
+        const __m256 last = _mm256_set1_ps(static_cast<mha_real_t>(len - 2U));
+        const __m256i offsets =
+            _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                               _mm256_set1_epi32(static_cast<int32_t>(stride)));
+        alignas(32) mha_real_t v[8];
+        unsigned k = 0;
+        for (; k + 8 <= n; k += 8) {
+            const mha_real_t * xk = x + k * stride;
+            const __m256 xv = (stride == 1U) ? _mm256_loadu_ps(xk)
+                : _mm256_i32gather_ps(xk, offsets, 4);
+            const __m256 ind = _mm256_mul_ps(_mm256_sub_ps(xv,
+                                                           _mm256_set1_ps(xmin)),
+                                             _mm256_set1_ps(scalefac));
+            __m256 fi = _mm256_max_ps(ind, _mm256_setzero_ps());
+            fi = _mm256_min_ps(fi, last);
+            const __m256i iv = _mm256_cvttps_epi32(fi);
+            const __m256 frac = _mm256_sub_ps(ind, _mm256_cvtepi32_ps(iv));
+            const __m256 a = _mm256_i32gather_ps(table, iv, 4);
+            const __m256 b = _mm256_i32gather_ps(table + 1, iv, 4);
+            const __m256 out = _mm256_add_ps(a, _mm256_mul_ps(frac,
+                                                              _mm256_sub_ps(b, a)));
+            if (stride == 1U) {
+                _mm256_storeu_ps(y + k, out);
+            } else {
+                _mm256_store_ps(v, out);
+                for (unsigned j = 0; j < 8; ++j)
+                    y[(k + j) * stride] = v[j];
+            }
+        }
+        _mm256_zeroupper();
+        table_interp_sse2(table, len, xmin, scalefac, x + k * stride,
+                          y + k * stride, n - k, stride);
+    }
+#endif
+
+    typedef void (*conj_mac_fn_t)(mha_complex_t *, const mha_complex_t *,
+                                  const mha_complex_t *, unsigned);
+
+    typedef void (*conj_mac_mix_fn_t)(mha_complex_t *,
+                                      const mha_complex_t * const *,
+                                      const mha_real_t *, unsigned,
+                                      const mha_complex_t *, unsigned);
+
+    typedef void (*real_fn_t)(const mha_real_t *, mha_real_t *, unsigned);
+
+    typedef void (*mac_split_fn_t)(mha_real_t *, mha_real_t *,
+                                   const mha_real_t *, const mha_real_t *,
+                                   const mha_real_t *, const mha_real_t *,
+                                   unsigned);
+
+    typedef void (*mac_columns_fn_t)(mha_real_t *, const mha_real_t *,
+                                     unsigned, const mha_real_t *,
+                                     unsigned, unsigned);
+
+    mac_columns_fn_t mac_columns_impl(simd_level_t level)
+    {
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return mac_columns_avx2;
+        case simd_level_t::SSE2:
+            return mac_columns_sse2;
+#endif
+        default:
+            return mac_columns_scalar;
+        }
+    }
+
+    mac_split_fn_t mac_split_impl(simd_level_t level)
+    {
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return mac_split_avx2;
+        case simd_level_t::SSE2:
+            return mac_split_sse2;
+#endif
+        default:
+            return mac_split_scalar;
+        }
+    }
+
+    real_fn_t pa22dbspl_fast_impl(simd_level_t level)
+    {
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return pa22dbspl_fast_avx2;
+        case simd_level_t::SSE2:
+            return pa22dbspl_fast_sse2;
+#endif
+        default:
+            return pa22dbspl_fast_scalar;
+        }
+    }
+
+    real_fn_t db2lin_fast_impl(simd_level_t level)
+    {
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return db2lin_fast_avx2;
+        case simd_level_t::SSE2:
+            return db2lin_fast_sse2;
+#endif
+        default:
+            return db2lin_fast_scalar;
+        }
+    }
+
+    typedef void (*table_interp_fn_t)(const mha_real_t *, unsigned,
+                                      mha_real_t, mha_real_t,
+                                      const mha_real_t *, mha_real_t *,
+                                      unsigned, unsigned);
+
+    table_interp_fn_t table_interp_impl(simd_level_t level)
+    {
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return table_interp_avx2;
+        case simd_level_t::SSE2:
+            return table_interp_sse2;
+#endif
+        default:
+            return table_interp_scalar;
+        }
+    }
+
+    conj_mac_fn_t conj_mac_impl(simd_level_t level)
+    {
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return conj_mac_avx2;
+        case simd_level_t::SSE2:
+            return conj_mac_sse2;
+#endif
+        default:
+            return conj_mac_scalar;
+        }
+    }
+
+    conj_mac_mix_fn_t conj_mac_mix_impl(simd_level_t level)
+    {
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return conj_mac_mix_avx2;
+        case simd_level_t::SSE2:
+            return conj_mac_mix_sse2;
+#endif
+        default:
+            return conj_mac_mix_scalar;
+        }
+    }
+
+    void check_available(simd_level_t level)
+    {
+        if (!MHASignal::simd_level_available(level))
+            throw MHA_Error(__FILE__,__LINE__,
+                            "SIMD level \"%s\" is not available on this system",
+                            MHASignal::simd_level_name(level).c_str());
+    }
+
+    void check_mix_terms(unsigned nw)
+    {
+        if (nw == 0 || nw > MHASignal::conj_mac_mix_max_terms)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "conj_mac_mix: Number of weight vectors (%u) has"
+                            " to be between 1 and %u", nw,
+                            MHASignal::conj_mac_mix_max_terms);
+    }
+
+    void check_table(unsigned len, unsigned stride)
+    {
+        if (len < 2U)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "table_interp: The table needs at least two"
+                            " entries (got %u)", len);
+        if (stride == 0U)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "table_interp: The stride must not be zero");
+    }
+
+    /** Dimension checks of conj_mac_channels and conj_mac_channels_mix. */
+    void check_channels(const mha_spec_t & out, unsigned out_channel,
+                        const mha_spec_t & w, unsigned w_first_channel,
+                        const mha_spec_t & x)
+    {
+        if (out.num_frames != x.num_frames || w.num_frames < x.num_frames)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "conj_mac_channels: Mismatching number of bins"
+                            " (out: %u, w: %u, x: %u)",
+                            out.num_frames, w.num_frames, x.num_frames);
+        if (out_channel >= out.num_channels)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "conj_mac_channels: Output channel %u out of range"
+                            " (%u channels)", out_channel, out.num_channels);
+        if (w_first_channel + x.num_channels > w.num_channels)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "conj_mac_channels: Weight channels %u to %u out"
+                            " of range (%u channels)", w_first_channel,
+                            w_first_channel + x.num_channels - 1U,
+                            w.num_channels);
+    }
+
+    simd_level_t simd_level_from_name(const std::string & name)
+    {
+        for (simd_level_t level : {simd_level_t::SCALAR,
+                                   simd_level_t::SSE2,
+                                   simd_level_t::AVX2})
+            if (name == MHASignal::simd_level_name(level))
+                return level;
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Unknown SIMD level \"%s\" in MHA_SIMD"
+                        " (valid: scalar, sse2, avx2)", name.c_str());
+    }
+}
+
+bool MHASignal::simd_level_available(simd_level_t level)
+{
+    switch (level) {
+    case simd_level_t::SCALAR:
+        return true;
+#if MHA_SIMD_X86
+    case simd_level_t::SSE2:
+        return true;
+    case simd_level_t::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+std::string MHASignal::simd_level_name(simd_level_t level)
+{
+    switch (level) {
+    case simd_level_t::SCALAR:
+        return "scalar";
+    case simd_level_t::SSE2:
+        return "sse2";
+    case simd_level_t::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+MHASignal::simd_level_t MHASignal::simd_level()
+{
+    static const simd_level_t level = []() {
+        simd_level_t best = simd_level_t::SCALAR;
+        for (simd_level_t l : {simd_level_t::SSE2, simd_level_t::AVX2})
+            if (simd_level_available(l))
+                best = l;
+        const std::string name = mha_getenv("MHA_SIMD");
+        if (name.size()) {
+            const simd_level_t requested = simd_level_from_name(name);
+            if (requested < best)
+                best = requested;
+        }
+        return best;
+    }();
+    return level;
+}
+
+void MHASignal::conj_mac(mha_complex_t * acc, const mha_complex_t * w,
+                         const mha_complex_t * x, unsigned n)
+{
+    static const conj_mac_fn_t impl = conj_mac_impl(simd_level());
+    impl(acc, w, x, n);
+}
+
+void MHASignal::conj_mac(mha_complex_t * acc, const mha_complex_t * w,
+                         const mha_complex_t * x, unsigned n,
+                         simd_level_t level)
+{
+    check_available(level);
+    conj_mac_impl(level)(acc, w, x, n);
+}
+
+void MHASignal::conj_mac_mix(mha_complex_t * acc,
+                             const mha_complex_t * const * w,
+                             const mha_real_t * g, unsigned nw,
+                             const mha_complex_t * x, unsigned n)
+{
+    static const conj_mac_mix_fn_t impl = conj_mac_mix_impl(simd_level());
+    check_mix_terms(nw);
+    impl(acc, w, g, nw, x, n);
+}
+
+void MHASignal::conj_mac_mix(mha_complex_t * acc,
+                             const mha_complex_t * const * w,
+                             const mha_real_t * g, unsigned nw,
+                             const mha_complex_t * x, unsigned n,
+                             simd_level_t level)
+{
+    check_available(level);
+    check_mix_terms(nw);
+    conj_mac_mix_impl(level)(acc, w, g, nw, x, n);
+}
+
+void MHASignal::mac_split(mha_real_t * acc_re, mha_real_t * acc_im,
+                          const mha_real_t * w_re, const mha_real_t * w_im,
+                          const mha_real_t * x_re, const mha_real_t * x_im,
+                          unsigned n)
+{
+    static const mac_split_fn_t impl = mac_split_impl(simd_level());
+    impl(acc_re, acc_im, w_re, w_im, x_re, x_im, n);
+}
+
+void MHASignal::mac_split(mha_real_t * acc_re, mha_real_t * acc_im,
+                          const mha_real_t * w_re, const mha_real_t * w_im,
+                          const mha_real_t * x_re, const mha_real_t * x_im,
+                          unsigned n, simd_level_t level)
+{
+    check_available(level);
+    mac_split_impl(level)(acc_re, acc_im, w_re, w_im, x_re, x_im, n);
+}
+
+void MHASignal::mac_columns(mha_real_t * y, const mha_real_t * a,
+                            unsigned stride, const mha_real_t * x,
+                            unsigned m, unsigned n)
+{
+    static const mac_columns_fn_t impl = mac_columns_impl(simd_level());
+    impl(y, a, stride, x, m, n);
+}
+
+void MHASignal::mac_columns(mha_real_t * y, const mha_real_t * a,
+                            unsigned stride, const mha_real_t * x,
+                            unsigned m, unsigned n, simd_level_t level)
+{
+    check_available(level);
+    mac_columns_impl(level)(y, a, stride, x, m, n);
+}
+
+void MHASignal::pa22dbspl_fast(const mha_real_t * in, mha_real_t * out,
+                               unsigned n)
+{
+    static const real_fn_t impl = pa22dbspl_fast_impl(simd_level());
+    impl(in, out, n);
+}
+
+void MHASignal::pa22dbspl_fast(const mha_real_t * in, mha_real_t * out,
+                               unsigned n, simd_level_t level)
+{
+    check_available(level);
+    pa22dbspl_fast_impl(level)(in, out, n);
+}
+
+void MHASignal::db2lin_fast(const mha_real_t * in, mha_real_t * out,
+                            unsigned n)
+{
+    static const real_fn_t impl = db2lin_fast_impl(simd_level());
+    impl(in, out, n);
+}
+
+void MHASignal::db2lin_fast(const mha_real_t * in, mha_real_t * out,
+                            unsigned n, simd_level_t level)
+{
+    check_available(level);
+    db2lin_fast_impl(level)(in, out, n);
+}
+
+void MHASignal::table_interp(const mha_real_t * table, unsigned len,
+                             mha_real_t xmin, mha_real_t scalefac,
+                             const mha_real_t * x, mha_real_t * y,
+                             unsigned n, unsigned stride)
+{
+    check_table(len, stride);
+    static const table_interp_fn_t impl = table_interp_impl(simd_level());
+    impl(table, len, xmin, scalefac, x, y, n, stride);
+}
+
+void MHASignal::table_interp(const mha_real_t * table, unsigned len,
+                             mha_real_t xmin, mha_real_t scalefac,
+                             const mha_real_t * x, mha_real_t * y,
+                             unsigned n, unsigned stride,
+                             simd_level_t level)
+{
+    check_available(level);
+    check_table(len, stride);
+    table_interp_impl(level)(table, len, xmin, scalefac, x, y, n, stride);
+}
+
+void MHASignal::conj_mac_channels(mha_spec_t & out, unsigned out_channel,
+                                  const mha_spec_t & w,
+                                  unsigned w_first_channel,
+                                  const mha_spec_t & x)
+{
+    check_channels(out, out_channel, w, w_first_channel, x);
+    const unsigned bins = x.num_frames;
+    mha_complex_t * acc = out.buf + out_channel * bins;
+    for (unsigned k = 0; k < bins; ++k)
+        acc[k] = mha_complex(0, 0);
+    for (unsigned m = 0; m < x.num_channels; ++m)
+        conj_mac(acc, w.buf + (w_first_channel + m) * w.num_frames,
+                 x.buf + m * bins, bins);
+}
+
+void MHASignal::conj_mac_channels_mix(mha_spec_t & out, unsigned out_channel,
+                                      const mha_spec_t & w,
+                                      const unsigned * w_first_channels,
+                                      const mha_real_t * g, unsigned nw,
+                                      const mha_spec_t & x)
+{
+    check_mix_terms(nw);
+    for (unsigned i = 0; i < nw; ++i)
+        check_channels(out, out_channel, w, w_first_channels[i], x);
+    const unsigned bins = x.num_frames;
+    mha_complex_t * acc = out.buf + out_channel * bins;
+    for (unsigned k = 0; k < bins; ++k)
+        acc[k] = mha_complex(0, 0);
+    const mha_complex_t * wm[conj_mac_mix_max_terms];
+    for (unsigned m = 0; m < x.num_channels; ++m) {
+        for (unsigned i = 0; i < nw; ++i)
+            wm[i] = w.buf + (w_first_channels[i] + m) * w.num_frames;
+        conj_mac_mix(acc, wm, g, nw, x.buf + m * bins, bins);
+    }
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
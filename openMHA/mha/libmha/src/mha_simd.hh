@@ -0,0 +1,305 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_SIMD_HH
+#define MHA_SIMD_HH
+
+#include "mha.hh"
+#include <string>
+
+/** \defgroup mhasimd Vectorized signal processing kernels
+
+    Inner loops of signal processing algorithms that benefit from SIMD
+    instructions.  Each kernel has a portable scalar implementation and,
+    on x86 processors, SSE2 and AVX2 implementations.  The fastest
+    implementation supported by the CPU is selected at run time.  The
+    environment variable MHA_SIMD can be set to "scalar", "sse2" or
+    "avx2" to limit the instruction set, e.g. for comparing results.
+
+    The vectorized implementations perform exactly the same floating
+    point operations in the same order as the scalar implementation,
+    therefore all implementations produce bit-identical results.
+*/
+
+namespace MHASignal {
+
+    /** \ingroup mhasimd
+        \brief Instruction sets of the vectorized kernels */
+    enum class simd_level_t {
+        /** Portable C++ implementation */
+        SCALAR,
+        /** 128 bit SSE2 registers, 2 complex values per instruction */
+        SSE2,
+        /** 256 bit AVX2 registers, 4 complex values per instruction */
+        AVX2
+    };
+
+    /** \ingroup mhasimd
+        \brief The instruction set used by the kernels on this CPU.
+        Determined once from the CPU features and the environment
+        variable MHA_SIMD. */
+    simd_level_t simd_level();
+
+    /** \ingroup mhasimd
+        \brief Checks if the CPU and this build of libopenmha support
+        the given instruction set. */
+    bool simd_level_available(simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Name of an instruction set as used in MHA_SIMD. */
+    std::string simd_level_name(simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Complex multiply-accumulate with conjugated weights:
+        acc[k] += conj(w[k]) * x[k] for 0 <= k < n.
+        \param acc Accumulator, n complex values.
+        \param w   Weights, n complex values, conjugated before multiplication.
+        \param x   Input, n complex values.
+        \param n   Number of complex values. */
+    void conj_mac(mha_complex_t * acc, const mha_complex_t * w,
+                  const mha_complex_t * x, unsigned n);
+
+    /** \ingroup mhasimd
+        \brief conj_mac with an explicitly chosen instruction set, for
+        testing and benchmarking.
+        \throw MHA_Error if the instruction set is not available. */
+    void conj_mac(mha_complex_t * acc, const mha_complex_t * w,
+                  const mha_complex_t * x, unsigned n, simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Maximum number of weight vectors combined by conj_mac_mix. */
+    constexpr unsigned conj_mac_mix_max_terms = 4U;
+
+    /** \ingroup mhasimd
+        \brief Complex multiply-accumulate with a conjugated linear
+        combination of weight vectors:
+        acc[k] += conj(g[0]*w[0][k] + ... + g[nw-1]*w[nw-1][k]) * x[k]
+        for 0 <= k < n.
+
+        The weights are combined in registers, therefore the cost is
+        only slightly higher than that of conj_mac, and much lower than
+        that of nw separate calls to conj_mac.  Used for crossfading
+        and interpolating between filters.
+        \param acc Accumulator, n complex values.
+        \param w   Array of nw pointers to n complex weights each.
+        \param g   Array of nw real gains applied to the weight vectors.
+        \param nw  Number of weight vectors, 1 to conj_mac_mix_max_terms.
+        \param x   Input, n complex values.
+        \param n   Number of complex values.
+        \throw MHA_Error if nw is out of range. */
+    void conj_mac_mix(mha_complex_t * acc, const mha_complex_t * const * w,
+                      const mha_real_t * g, unsigned nw,
+                      const mha_complex_t * x, unsigned n);
+
+    /** \ingroup mhasimd
+        \brief conj_mac_mix with an explicitly chosen instruction set,
+        for testing and benchmarking.
+        \throw MHA_Error if the instruction set is not available or if
+        nw is out of range. */
+    void conj_mac_mix(mha_complex_t * acc, const mha_complex_t * const * w,
+                      const mha_real_t * g, unsigned nw,
+                      const mha_complex_t * x, unsigned n,
+                      simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Complex multiply-accumulate on split real and imaginary
+        arrays (structure of arrays):
+        acc[k] += w[k] * x[k] for 0 <= k < n.
+
+        Each instruction processes twice as many complex values as
+        conj_mac, because no shuffling between real and imaginary
+        parts is needed.  Used by the frequency-domain delay line of
+        MHAFilter::partitioned_convolution_t.
+        \param acc_re Real parts of the accumulator, n values.
+        \param acc_im Imaginary parts of the accumulator, n values.
+        \param w_re   Real parts of the weights.
+        \param w_im   Imaginary parts of the weights.
+        \param x_re   Real parts of the input.
+        \param x_im   Imaginary parts of the input.
+        \param n      Number of complex values. */
+    void mac_split(mha_real_t * acc_re, mha_real_t * acc_im,
+                   const mha_real_t * w_re, const mha_real_t * w_im,
+                   const mha_real_t * x_re, const mha_real_t * x_im,
+                   unsigned n);
+
+    /** \ingroup mhasimd
+        \brief mac_split with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void mac_split(mha_real_t * acc_re, mha_real_t * acc_im,
+                   const mha_real_t * w_re, const mha_real_t * w_im,
+                   const mha_real_t * x_re, const mha_real_t * x_im,
+                   unsigned n, simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Real matrix-vector multiply-accumulate with a column-major
+        matrix: y[k] += a[0*stride+k]*x[0] + ... + a[(m-1)*stride+k]*x[m-1]
+        for 0 <= k < n.
+
+        The products are added to each y[k] in column order, i.e.
+        in the same order as a scalar dot product of row k with x.
+        Used for scoring many linear classifiers with the same feature
+        vector, with one classifier per row.
+        \param y      Accumulator, n values.
+        \param a      Matrix, m columns of stride values, of which the
+                      first n are used.
+        \param stride Distance between the starts of two columns, >= n.
+        \param x      Vector, m values.
+        \param m      Number of columns.
+        \param n      Number of rows. */
+    void mac_columns(mha_real_t * y, const mha_real_t * a, unsigned stride,
+                     const mha_real_t * x, unsigned m, unsigned n);
+
+    /** \ingroup mhasimd
+        \brief mac_columns with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void mac_columns(mha_real_t * y, const mha_real_t * a, unsigned stride,
+                     const mha_real_t * x, unsigned m, unsigned n,
+                     simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Fast conversion of squared Pascal values to dB SPL,
+        approximating MHASignal::pa22dbspl(x) for whole arrays.
+
+        The logarithm is computed from the exponent and a polynomial
+        approximation of the mantissa instead of calling log10f.  For
+        positive finite input values, the absolute deviation from
+        pa22dbspl is below 5e-5 dB for levels between -100 and 200 dB
+        SPL, i.e. a few units in the last place of the float result.  Zero input returns -Inf, negative
+        or NaN input returns NaN, +Inf returns +Inf.  Denormal input
+        (below 5e-48 Pa²) is not supported.
+        \param in  n squared Pascal values.
+        \param out n levels in dB SPL, may be equal to in.
+        \param n   Number of values. */
+    void pa22dbspl_fast(const mha_real_t * in, mha_real_t * out, unsigned n);
+
+    /** \ingroup mhasimd
+        \brief pa22dbspl_fast with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void pa22dbspl_fast(const mha_real_t * in, mha_real_t * out, unsigned n,
+                        simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Fast conversion of dB to linear factors, approximating
+        MHASignal::db2lin(x) for whole arrays.
+
+        The power is computed by scaling a polynomial approximation with
+        a power of two constructed in the float exponent bits.  The
+        relative deviation from db2lin is below 4e-6 for input values
+        between -200 dB and +200 dB, and below 2e-5 between -700 dB and
+        +700 dB, where it is dominated by the rounding of the scaled
+        input.  Inputs below -758 dB, including -Inf, return 0, inputs
+        above 764 dB saturate at 2^127.  NaN input is not propagated.
+        \param in  n values in dB.
+        \param out n linear factors, may be equal to in.
+        \param n   Number of values. */
+    void db2lin_fast(const mha_real_t * in, mha_real_t * out, unsigned n);
+
+    /** \ingroup mhasimd
+        \brief db2lin_fast with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void db2lin_fast(const mha_real_t * in, mha_real_t * out, unsigned n,
+                     simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Linear interpolation in a table with equidistant mesh
+        points for a whole array of values.
+
+        Computes y[k*stride] for 0 <= k < n from x[k*stride] like
+        MHATableLookup::linear_table_t::interp: The table holds the
+        values at the mesh points xmin + j/scalefac, 0 <= j < len.
+        Between mesh points, the two neighbouring values are
+        interpolated linearly, outside of the mesh the value is
+        extrapolated from the two outermost values.  The extrapolation
+        above the last mesh point may differ from linear_table_t::interp
+        by the rounding of the single precision index.  NaN input
+        results in NaN output.  The stride allows to process one channel
+        of interleaved multichannel data.
+        \param table    len table values.
+        \param len      Number of table values, at least 2.
+        \param xmin     Input value of the first mesh point.
+        \param scalefac Inverse distance between mesh points.
+        \param x        Input values, n values stride apart.
+        \param y        Output values, n values stride apart, may be equal to x.
+        \param n        Number of values.
+        \param stride   Distance between consecutive values in x and y.
+        \throw MHA_Error if len < 2 or stride == 0. */
+    void table_interp(const mha_real_t * table, unsigned len,
+                      mha_real_t xmin, mha_real_t scalefac,
+                      const mha_real_t * x, mha_real_t * y,
+                      unsigned n, unsigned stride);
+
+    /** \ingroup mhasimd
+        \brief table_interp with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available, if
+        len < 2 or stride == 0. */
+    void table_interp(const mha_real_t * table, unsigned len,
+                      mha_real_t xmin, mha_real_t scalefac,
+                      const mha_real_t * x, mha_real_t * y,
+                      unsigned n, unsigned stride, simd_level_t level);
+
+    /** \ingroup mhasimd
+        \brief Filter and sum of all channels of a spectrum, as used
+        by beamformers:
+
+        out(f,out_channel) = sum over m of conj(w(f,w_first_channel+m)) * x(f,m)
+
+        where m iterates over all channels of x.  The sum is accumulated
+        in channel order, identical to a scalar loop over channels.
+        \param out Output spectrum, only channel out_channel is written.
+        \param out_channel Index of the output channel.
+        \param w Filter weights, at least as many bins as x and at least
+                 w_first_channel + x.num_channels channels.  Bins beyond
+                 the number of bins of x are ignored.
+        \param w_first_channel Index of the weight channel applied to
+                 the first channel of x.
+        \param x Input spectrum.
+        \throw MHA_Error if the dimensions do not match. */
+    void conj_mac_channels(mha_spec_t & out, unsigned out_channel,
+                           const mha_spec_t & w, unsigned w_first_channel,
+                           const mha_spec_t & x);
+
+    /** \ingroup mhasimd
+        \brief Filter and sum with a linear combination of up to
+        conj_mac_mix_max_terms filters stored in the same weight
+        spectrum:
+
+        out(f,out_channel) = sum over m of
+        conj(sum over i of g[i] * w(f,w_first_channels[i]+m)) * x(f,m)
+
+        \param out Output spectrum, only channel out_channel is written.
+        \param out_channel Index of the output channel.
+        \param w Filter weights, see conj_mac_channels.
+        \param w_first_channels Array of nw indices of the weight
+                 channels applied to the first channel of x.
+        \param g Array of nw real gains of the filters.
+        \param nw Number of filters, 1 to conj_mac_mix_max_terms.
+        \param x Input spectrum.
+        \throw MHA_Error if the dimensions do not match or if nw is out
+        of range. */
+    void conj_mac_channels_mix(mha_spec_t & out, unsigned out_channel,
+                               const mha_spec_t & w,
+                               const unsigned * w_first_channels,
+                               const mha_real_t * g, unsigned nw,
+                               const mha_spec_t & x);
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,496 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_simd.hh"
+#include "mha_signal.hh"
+#include "mha_error.hh"
+#include "mha_tablelookup.hh"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using MHASignal::simd_level_t;
+
+namespace {
+  std::vector<mha_complex_t> random_complex(unsigned n, unsigned seed)
+  {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<mha_real_t> dist(-10.0f, 10.0f);
+    std::vector<mha_complex_t> v(n);
+    for (auto & c : v)
+      c = mha_complex(dist(gen), dist(gen));
+    return v;
+  }
+
+  const simd_level_t all_levels[] = {simd_level_t::SCALAR,
+                                     simd_level_t::SSE2,
+                                     simd_level_t::AVX2};
+}
+
+TEST(simd, scalar_is_always_available_and_selected_level_is_available)
+{
+  EXPECT_TRUE(MHASignal::simd_level_available(simd_level_t::SCALAR));
+  EXPECT_TRUE(MHASignal::simd_level_available(MHASignal::simd_level()));
+  EXPECT_EQ("scalar", MHASignal::simd_level_name(simd_level_t::SCALAR));
+  EXPECT_EQ("sse2", MHASignal::simd_level_name(simd_level_t::SSE2));
+  EXPECT_EQ("avx2", MHASignal::simd_level_name(simd_level_t::AVX2));
+}
+
+TEST(simd, conj_mac_scalar_matches_complex_arithmetic)
+{
+  const unsigned n = 67;
+  auto w = random_complex(n, 1), x = random_complex(n, 2);
+  auto acc = random_complex(n, 3);
+  auto expected = acc;
+  for (unsigned k = 0; k < n; ++k)
+    expected[k] += _conjugate(w[k]) * x[k];
+  MHASignal::conj_mac(acc.data(), w.data(), x.data(), n,
+                      simd_level_t::SCALAR);
+  // This file is compiled with -ffast-math, which allows the compiler
+  // to reorder the additions of the reference computation
+  for (unsigned k = 0; k < n; ++k) {
+    EXPECT_NEAR(expected[k].re, acc[k].re, 1e-4f) << "k=" << k;
+    EXPECT_NEAR(expected[k].im, acc[k].im, 1e-4f) << "k=" << k;
+  }
+}
+
+TEST(simd, conj_mac_vectorized_matches_scalar_bit_for_bit)
+{
+  // Lengths cover the vectorized loops and all lengths of the scalar tails
+  for (unsigned n : {0U, 1U, 2U, 3U, 4U, 5U, 6U, 7U, 8U, 9U, 65U, 257U, 513U})
+    for (simd_level_t level : all_levels) {
+      if (!MHASignal::simd_level_available(level))
+        continue;
+      auto w = random_complex(n, 4), x = random_complex(n, 5);
+      auto expected = random_complex(n, 6);
+      auto acc = expected;
+      for (unsigned repetition = 0; repetition < 3; ++repetition) {
+        MHASignal::conj_mac(expected.data(), w.data(), x.data(), n,
+                            simd_level_t::SCALAR);
+        MHASignal::conj_mac(acc.data(), w.data(), x.data(), n, level);
+      }
+      for (unsigned k = 0; k < n; ++k) {
+        EXPECT_EQ(expected[k].re, acc[k].re)
+          << MHASignal::simd_level_name(level) << " n=" << n << " k=" << k;
+        EXPECT_EQ(expected[k].im, acc[k].im)
+          << MHASignal::simd_level_name(level) << " n=" << n << " k=" << k;
+      }
+    }
+}
+
+TEST(simd, conj_mac_throws_for_unavailable_level)
+{
+  mha_complex_t acc = mha_complex(0, 0), w = mha_complex(1, 1);
+  for (simd_level_t level : all_levels) {
+    if (!MHASignal::simd_level_available(level)) {
+      EXPECT_THROW(MHASignal::conj_mac(&acc, &w, &w, 1U, level), MHA_Error);
+    }
+  }
+}
+
+namespace {
+  std::vector<mha_real_t> random_real(unsigned n, unsigned seed)
+  {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<mha_real_t> dist(-10.0f, 10.0f);
+    std::vector<mha_real_t> v(n);
+    for (auto & x : v)
+      x = dist(gen);
+    return v;
+  }
+}
+
+TEST(simd, mac_split_scalar_matches_complex_arithmetic)
+{
+  const unsigned n = 67;
+  auto w = random_complex(n, 1), x = random_complex(n, 2);
+  auto acc = random_complex(n, 3);
+  std::vector<mha_real_t> w_re(n), w_im(n), x_re(n), x_im(n),
+    acc_re(n), acc_im(n);
+  for (unsigned k = 0; k < n; ++k) {
+    w_re[k] = w[k].re; w_im[k] = w[k].im;
+    x_re[k] = x[k].re; x_im[k] = x[k].im;
+    acc_re[k] = acc[k].re; acc_im[k] = acc[k].im;
+    acc[k] += w[k] * x[k];
+  }
+  MHASignal::mac_split(acc_re.data(), acc_im.data(), w_re.data(), w_im.data(),
+                       x_re.data(), x_im.data(), n, simd_level_t::SCALAR);
+  for (unsigned k = 0; k < n; ++k) {
+    EXPECT_NEAR(acc[k].re, acc_re[k], 1e-4f) << "k=" << k;
+    EXPECT_NEAR(acc[k].im, acc_im[k], 1e-4f) << "k=" << k;
+  }
+}
+
+TEST(simd, mac_split_vectorized_matches_scalar_bit_for_bit)
+{
+  for (unsigned n : {0U, 1U, 3U, 4U, 5U, 7U, 8U, 9U, 12U, 15U, 16U, 65U, 513U})
+    for (simd_level_t level : all_levels) {
+      if (!MHASignal::simd_level_available(level))
+        continue;
+      auto w_re = random_real(n, 4), w_im = random_real(n, 5);
+      auto x_re = random_real(n, 6), x_im = random_real(n, 7);
+      auto expected_re = random_real(n, 8), expected_im = random_real(n, 9);
+      auto acc_re = expected_re, acc_im = expected_im;
+      for (unsigned repetition = 0; repetition < 3; ++repetition) {
+        MHASignal::mac_split(expected_re.data(), expected_im.data(),
+                             w_re.data(), w_im.data(), x_re.data(),
+                             x_im.data(), n, simd_level_t::SCALAR);
+        MHASignal::mac_split(acc_re.data(), acc_im.data(),
+                             w_re.data(), w_im.data(), x_re.data(),
+                             x_im.data(), n, level);
+      }
+      EXPECT_EQ(expected_re, acc_re)
+        << MHASignal::simd_level_name(level) << " n=" << n;
+      EXPECT_EQ(expected_im, acc_im)
+        << MHASignal::simd_level_name(level) << " n=" << n;
+    }
+}
+
+TEST(simd, mac_columns_scalar_matches_dot_products_of_rows)
+{
+  const unsigned rows = 37, stride = 40, columns = 23;
+  auto a = random_real(stride * columns, 10), x = random_real(columns, 11);
+  auto y = random_real(rows, 12);
+  std::vector<mha_real_t> expected(y.begin(), y.end());
+  for (unsigned k = 0; k < rows; ++k)
+    for (unsigned j = 0; j < columns; ++j)
+      expected[k] += a[j * stride + k] * x[j];
+  MHASignal::mac_columns(y.data(), a.data(), stride, x.data(), columns, rows,
+                         simd_level_t::SCALAR);
+  EXPECT_EQ(expected, y);
+}
+
+TEST(simd, mac_columns_vectorized_matches_scalar_bit_for_bit)
+{
+  const unsigned columns = 161;
+  for (unsigned n : {0U, 1U, 3U, 4U, 7U, 8U, 15U, 16U, 31U, 32U, 37U, 73U})
+    for (simd_level_t level : all_levels) {
+      if (!MHASignal::simd_level_available(level))
+        continue;
+      const unsigned stride = n + 3U;
+      auto a = random_real(stride * columns, 13);
+      auto x = random_real(columns, 14);
+      auto expected = random_real(n, 15);
+      auto y = expected;
+      MHASignal::mac_columns(expected.data(), a.data(), stride, x.data(),
+                             columns, n, simd_level_t::SCALAR);
+      MHASignal::mac_columns(y.data(), a.data(), stride, x.data(),
+                             columns, n, level);
+      EXPECT_EQ(expected, y) << MHASignal::simd_level_name(level)
+                             << " n=" << n;
+    }
+}
+
+TEST(simd, conj_mac_channels_matches_scalar_beamformer_bit_for_bit)
+{
+  const unsigned bins = 129, channels = 4, angles = 3;
+  MHASignal::spectrum_t x(bins, channels), w(bins, channels * angles);
+  MHASignal::spectrum_t out(bins, 2), expected(bins, 2);
+  auto rx = random_complex(bins * channels, 7);
+  auto rw = random_complex(bins * channels * angles, 8);
+  std::copy(rx.begin(), rx.end(), x.buf);
+  std::copy(rw.begin(), rw.end(), w.buf);
+  for (unsigned angle = 0; angle < angles; ++angle) {
+    const unsigned block = angle * channels;
+    for (unsigned f = 0; f < bins; ++f)
+      expected(f,1) = mha_complex(0, 0);
+    for (unsigned m = 0; m < channels; ++m)
+      MHASignal::conj_mac(&expected(0,1), &w(0,m+block), &x(0,m), bins,
+                          simd_level_t::SCALAR);
+    out(0,1) = mha_complex(1, 1);
+    MHASignal::conj_mac_channels(out, 1, w, block, x);
+    for (unsigned f = 0; f < bins; ++f) {
+      EXPECT_EQ(expected(f,1).re, out(f,1).re) << "angle=" << angle;
+      EXPECT_EQ(expected(f,1).im, out(f,1).im) << "angle=" << angle;
+      // Other channels are not touched
+      EXPECT_EQ(0.0f, out(f,0).re);
+      EXPECT_EQ(0.0f, out(f,0).im);
+    }
+  }
+}
+
+TEST(simd, conj_mac_mix_vectorized_matches_scalar_bit_for_bit)
+{
+  const mha_real_t gains[] = {0.25f, -0.5f, 0.125f, 1.75f};
+  for (unsigned nw = 1; nw <= MHASignal::conj_mac_mix_max_terms; ++nw)
+    for (unsigned n : {1U, 3U, 4U, 7U, 129U, 514U})
+      for (simd_level_t level : all_levels) {
+        if (!MHASignal::simd_level_available(level))
+          continue;
+        std::vector<std::vector<mha_complex_t>> w;
+        const mha_complex_t * wp[MHASignal::conj_mac_mix_max_terms];
+        for (unsigned i = 0; i < nw; ++i) {
+          w.push_back(random_complex(n, 10 + i));
+          wp[i] = w.back().data();
+        }
+        auto x = random_complex(n, 9);
+        auto expected = random_complex(n, 20);
+        auto acc = expected;
+        MHASignal::conj_mac_mix(expected.data(), wp, gains, nw, x.data(), n,
+                                simd_level_t::SCALAR);
+        MHASignal::conj_mac_mix(acc.data(), wp, gains, nw, x.data(), n,
+                                level);
+        for (unsigned k = 0; k < n; ++k) {
+          EXPECT_EQ(expected[k].re, acc[k].re)
+            << MHASignal::simd_level_name(level) << " nw=" << nw
+            << " n=" << n << " k=" << k;
+          EXPECT_EQ(expected[k].im, acc[k].im)
+            << MHASignal::simd_level_name(level) << " nw=" << nw
+            << " n=" << n << " k=" << k;
+        }
+      }
+}
+
+TEST(simd, conj_mac_mix_is_weighted_sum_of_conj_mac)
+{
+  const unsigned n = 33;
+  const mha_real_t gains[] = {0.75f, 0.25f};
+  auto w0 = random_complex(n, 30), w1 = random_complex(n, 31);
+  auto x = random_complex(n, 32);
+  const mha_complex_t * wp[] = {w0.data(), w1.data()};
+  std::vector<mha_complex_t> single(n, mha_complex(0, 0)), mixed = single;
+  std::vector<mha_complex_t> separate0 = single, separate1 = single;
+  // One weight vector with gain 1 is identical to conj_mac
+  const mha_real_t one = 1.0f;
+  MHASignal::conj_mac_mix(mixed.data(), wp, &one, 1U, x.data(), n);
+  MHASignal::conj_mac(single.data(), w0.data(), x.data(), n);
+  for (unsigned k = 0; k < n; ++k) {
+    EXPECT_EQ(single[k].re, mixed[k].re);
+    EXPECT_EQ(single[k].im, mixed[k].im);
+  }
+  std::fill(mixed.begin(), mixed.end(), mha_complex(0, 0));
+  MHASignal::conj_mac_mix(mixed.data(), wp, gains, 2U, x.data(), n);
+  MHASignal::conj_mac(separate0.data(), w0.data(), x.data(), n);
+  MHASignal::conj_mac(separate1.data(), w1.data(), x.data(), n);
+  for (unsigned k = 0; k < n; ++k) {
+    const mha_complex_t expected =
+      separate0[k] * gains[0] + separate1[k] * gains[1];
+    EXPECT_NEAR(expected.re, mixed[k].re, 1e-4f) << "k=" << k;
+    EXPECT_NEAR(expected.im, mixed[k].im, 1e-4f) << "k=" << k;
+  }
+  EXPECT_THROW(MHASignal::conj_mac_mix(mixed.data(), wp, gains, 0U,
+                                       x.data(), n), MHA_Error);
+  EXPECT_THROW(MHASignal::conj_mac_mix(mixed.data(), wp, gains,
+                                       MHASignal::conj_mac_mix_max_terms + 1,
+                                       x.data(), n), MHA_Error);
+}
+
+TEST(simd, conj_mac_channels_mix_matches_conj_mac_mix)
+{
+  const unsigned bins = 65, channels = 3, angles = 4;
+  MHASignal::spectrum_t x(bins, channels), w(bins, channels * angles);
+  MHASignal::spectrum_t out(bins, 1), expected(bins, 1);
+  auto rx = random_complex(bins * channels, 40);
+  auto rw = random_complex(bins * channels * angles, 41);
+  std::copy(rx.begin(), rx.end(), x.buf);
+  std::copy(rw.begin(), rw.end(), w.buf);
+  const unsigned first[] = {3, 6, 9};
+  const mha_real_t gains[] = {0.5f, 0.375f, 0.125f};
+  for (unsigned m = 0; m < channels; ++m) {
+    const mha_complex_t * wp[] = {&w(0,first[0]+m), &w(0,first[1]+m),
+                                  &w(0,first[2]+m)};
+    MHASignal::conj_mac_mix(&expected(0,0), wp, gains, 3U, &x(0,m), bins);
+  }
+  MHASignal::conj_mac_channels_mix(out, 0, w, first, gains, 3U, x);
+  for (unsigned f = 0; f < bins; ++f) {
+    EXPECT_EQ(expected(f,0).re, out(f,0).re);
+    EXPECT_EQ(expected(f,0).im, out(f,0).im);
+  }
+  const unsigned out_of_range[] = {3, 10};
+  EXPECT_THROW(MHASignal::conj_mac_channels_mix(out, 0, w, out_of_range,
+                                                gains, 2U, x), MHA_Error);
+}
+
+TEST(simd, conj_mac_channels_checks_dimensions)
+{
+  MHASignal::spectrum_t x(65, 2), w(65, 4), out(65, 1), short_out(33, 1);
+  MHASignal::spectrum_t short_w(33, 4);
+  EXPECT_NO_THROW(MHASignal::conj_mac_channels(out, 0, w, 2, x));
+  EXPECT_THROW(MHASignal::conj_mac_channels(out, 0, short_w, 0, x),
+               MHA_Error);
+  EXPECT_THROW(MHASignal::conj_mac_channels(out, 0, w, 3, x), MHA_Error);
+  EXPECT_THROW(MHASignal::conj_mac_channels(out, 1, w, 0, x), MHA_Error);
+  EXPECT_THROW(MHASignal::conj_mac_channels(short_out, 0, w, 0, x),
+               MHA_Error);
+}
+
+namespace {
+  /// Squared Pascal values covering -100 to 200 dB SPL, and special values
+  std::vector<mha_real_t> level_test_values()
+  {
+    std::vector<mha_real_t> v;
+    for (mha_real_t db = -100.0f; db <= 200.0f; db += 0.0137f)
+      v.push_back(MHASignal::dbspl2pa2(db));
+    v.push_back(0.0f);
+    v.push_back(-1.0f);
+    v.push_back(std::numeric_limits<mha_real_t>::infinity());
+    v.push_back(std::numeric_limits<mha_real_t>::quiet_NaN());
+    return v;
+  }
+}
+
+TEST(simd, pa22dbspl_fast_vectorized_matches_scalar_bit_for_bit)
+{
+  const auto in = level_test_values();
+  for (simd_level_t level : all_levels) {
+    if (!MHASignal::simd_level_available(level))
+      continue;
+    // Odd length exercises the scalar tail of the vectorized versions
+    for (unsigned n : {unsigned(in.size()), 13U}) {
+      std::vector<mha_real_t> expected(n), out(n);
+      MHASignal::pa22dbspl_fast(in.data(), expected.data(), n,
+                                simd_level_t::SCALAR);
+      MHASignal::pa22dbspl_fast(in.data(), out.data(), n, level);
+      EXPECT_EQ(0, memcmp(expected.data(), out.data(),
+                          n * sizeof(mha_real_t)))
+        << MHASignal::simd_level_name(level) << " n=" << n;
+    }
+  }
+}
+
+TEST(simd, pa22dbspl_fast_error_is_bounded)
+{
+  auto in = level_test_values();
+  std::vector<mha_real_t> out(in.size());
+  MHASignal::pa22dbspl_fast(in.data(), out.data(), in.size());
+  const unsigned n = in.size() - 4U;
+  for (unsigned k = 0; k < n; ++k)
+    ASSERT_NEAR(MHASignal::pa22dbspl(in[k]), out[k], 5e-5f) << in[k];
+  EXPECT_EQ(-std::numeric_limits<mha_real_t>::infinity(), out[n]);
+  EXPECT_TRUE(std::isnan(out[n+1]));
+  EXPECT_EQ(std::numeric_limits<mha_real_t>::infinity(), out[n+2]);
+  EXPECT_TRUE(std::isnan(out[n+3]));
+  // in place
+  MHASignal::pa22dbspl_fast(in.data(), in.data(), n);
+  EXPECT_EQ(0, memcmp(in.data(), out.data(), n * sizeof(mha_real_t)));
+}
+
+TEST(simd, db2lin_fast_vectorized_matches_scalar_bit_for_bit)
+{
+  std::vector<mha_real_t> in;
+  for (mha_real_t db = -800.0f; db <= 800.0f; db += 0.0731f)
+    in.push_back(db);
+  in.push_back(-std::numeric_limits<mha_real_t>::infinity());
+  in.push_back(std::numeric_limits<mha_real_t>::infinity());
+  for (simd_level_t level : all_levels) {
+    if (!MHASignal::simd_level_available(level))
+      continue;
+    for (unsigned n : {unsigned(in.size()), 11U}) {
+      std::vector<mha_real_t> expected(n), out(n);
+      MHASignal::db2lin_fast(in.data(), expected.data(), n,
+                             simd_level_t::SCALAR);
+      MHASignal::db2lin_fast(in.data(), out.data(), n, level);
+      EXPECT_EQ(0, memcmp(expected.data(), out.data(),
+                          n * sizeof(mha_real_t)))
+        << MHASignal::simd_level_name(level) << " n=" << n;
+    }
+  }
+}
+
+TEST(simd, db2lin_fast_error_is_bounded)
+{
+  std::vector<mha_real_t> in;
+  for (mha_real_t db = -700.0f; db <= 700.0f; db += 0.0093f)
+    in.push_back(db);
+  std::vector<mha_real_t> out(in.size());
+  MHASignal::db2lin_fast(in.data(), out.data(), in.size());
+  for (unsigned k = 0; k < in.size(); ++k) {
+    const double rel = out[k] / MHASignal::db2lin(in[k]);
+    ASSERT_NEAR(1.0, rel, std::fabs(in[k]) <= 200.0f ? 4e-6 : 2e-5) << in[k];
+  }
+  const mha_real_t special[] = {-800.0f,
+                                -std::numeric_limits<mha_real_t>::infinity(),
+                                0.0f, 20.0f};
+  mha_real_t lin[4];
+  MHASignal::db2lin_fast(special, lin, 4U);
+  EXPECT_EQ(0.0f, lin[0]);
+  EXPECT_EQ(0.0f, lin[1]);
+  EXPECT_EQ(1.0f, lin[2]);
+  EXPECT_NEAR(10.0f, lin[3], 1e-5f);
+}
+
+TEST(simd, table_interp_vectorized_matches_scalar_bit_for_bit)
+{
+  std::vector<mha_real_t> table;
+  for (unsigned j = 0; j < 21; ++j)
+    table.push_back(0.1f * j * j - 3.0f * j);
+  std::vector<mha_real_t> in;
+  for (mha_real_t x = -40.0f; x <= 160.0f; x += 0.173f)
+    in.push_back(x);
+  in.push_back(std::numeric_limits<mha_real_t>::quiet_NaN());
+  for (simd_level_t level : all_levels) {
+    if (!MHASignal::simd_level_available(level))
+      continue;
+    for (unsigned stride : {1U, 3U})
+      for (unsigned n : {unsigned(in.size()) / stride, 11U}) {
+        std::vector<mha_real_t> expected(in.size()), out(in.size());
+        MHASignal::table_interp(table.data(), table.size(), -10.0f, 0.2f,
+                                in.data(), expected.data(), n, stride,
+                                simd_level_t::SCALAR);
+        MHASignal::table_interp(table.data(), table.size(), -10.0f, 0.2f,
+                                in.data(), out.data(), n, stride, level);
+        EXPECT_EQ(0, memcmp(expected.data(), out.data(),
+                            in.size() * sizeof(mha_real_t)))
+          << MHASignal::simd_level_name(level)
+          << " n=" << n << " stride=" << stride;
+      }
+  }
+}
+
+TEST(simd, table_interp_matches_linear_table_interp)
+{
+  MHATableLookup::linear_table_t table;
+  table.set_xmin(-10.0f);
+  for (unsigned j = 0; j < 21; ++j)
+    table.add_entry(0.1f * j * j - 3.0f * j);
+  table.set_xmax(95.0f);
+  table.prepare();
+  // Interleaved data of 2 channels, only channel 1 is interpolated
+  std::vector<mha_real_t> in;
+  for (mha_real_t x = -40.0f; x <= 160.0f; x += 0.173f) {
+    in.push_back(0.0f);
+    in.push_back(x);
+  }
+  std::vector<mha_real_t> out(in);
+  const unsigned n = in.size() / 2;
+  table.interp(out.data() + 1, out.data() + 1, n, 2U);
+  for (unsigned k = 0; k < n; ++k) {
+    EXPECT_EQ(0.0f, out[2 * k]);
+    const mha_real_t expected = table.interp(in[2 * k + 1]);
+    ASSERT_NEAR(expected, out[2 * k + 1], 2e-6f * (1.0f + std::fabs(expected)))
+      << in[2 * k + 1];
+  }
+  mha_real_t nan = std::numeric_limits<mha_real_t>::quiet_NaN();
+  table.interp(&nan, &nan, 1U);
+  EXPECT_TRUE(std::isnan(nan));
+  EXPECT_THROW(MHASignal::table_interp(in.data(), 1U, 0.0f, 1.0f,
+                                       in.data(), out.data(), 1U, 1U),
+               MHA_Error);
+  EXPECT_THROW(MHASignal::table_interp(in.data(), 2U, 0.0f, 1.0f,
+                                       in.data(), out.data(), 1U, 0U),
+               MHA_Error);
+}
+
+/*
+ * Local Variables:
+ * compile-command: "make -C .. unit-tests"
+ * coding: utf-8-unix
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
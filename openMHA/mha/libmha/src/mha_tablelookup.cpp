@@ -15,6 +15,7 @@
 
 #include "mha_tablelookup.hh"
 #include "mha_error.hh"
+#include "mha_simd.hh"
 #include <math.h>
 
 using namespace MHATableLookup;
@@ -206,6 +207,15 @@ mha_real_t linear_table_t::interp(mha_real_t x) const
     return ret;
 }
 
+void linear_table_t::interp(const mha_real_t * x, mha_real_t * y,
+                            unsigned n, unsigned stride) const
+{
+    if( len < 2 ){
+        throw MHA_Error(__FILE__,__LINE__,"Invalid table length.");
+    }
+    MHASignal::table_interp(vy, len, xmin, scalefac, x, y, n, stride);
+}
+
 void linear_table_t::set_xmin(mha_real_t x)
 {
     xmin = x;
@@ -85,6 +85,18 @@ namespace MHATableLookup {
          * @pre prepare must have been called before interp may be called. */
         mha_real_t interp(mha_real_t x) const;
 
+        /** interpolate y values for n x values at once, stride
+         * apart, e.g. the values of one channel in an interleaved
+         * multichannel buffer.  Computes the same values as the
+         * interp method for single values, except for the rounding of
+         * values extrapolated above the last mesh point, but uses
+         * vectorized instructions where available.  x and y may point
+         * to the same memory.
+         *
+         * @pre prepare must have been called before interp may be called. */
+        void interp(const mha_real_t * x, mha_real_t * y,
+                    unsigned n, unsigned stride = 1U) const;
+
         /** destructor */
         ~linear_table_t(void);
 
@@ -0,0 +1,776 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_vecmath.hh"
+#include "mha_error.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Like mha_simd.cpp, this file is compiled with -fno-associative-math
+// -ffp-contract=off, so that the vectorized implementations give
+// bit-identical results to the scalar implementations.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define MHA_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define MHA_SIMD_X86 0
+#endif
+
+namespace {
+    using MHASignal::simd_level_t;
+    using MHASignal::vecmath_accuracy_t;
+
+    /* All functions are computed from
+       exp2: 2^(x*k) = 2^i * 2^f with i = round(x*k), |f| <= 0.5, and a
+             polynomial approximation of 2^f.
+       log2: c*log2(x) = c*e + c*2/ln(2)*atanh(t) with x = m * 2^e,
+             sqrt(1/2) <= m < sqrt(2), t = (m-1)/(m+1), |t| < 0.172,
+             and a polynomial approximation of atanh(t)/t in t^2.
+       The polynomials are Chebyshev interpolants on these intervals.
+       The accurate tier evaluates x*k and c*e with a split of x and
+       of the constants into high parts with 12 (16) significant bits,
+       whose products are exact, and low parts. */
+
+    /** Constants of one function: exp2 uses full, hi, lo as the factor
+        k, log2 uses full, hi, lo as the factor c of e and m as the
+        factor of atanh(t). */
+    struct coef_t {
+        mha_real_t full, hi, lo, m;
+    };
+
+    const double ln2 = 0.693147180559945309;
+
+    // polynomial of degree 6 (4) for 2^f, maximum relative error
+    // 1.9e-8 (3.5e-6)
+    const mha_real_t exp2_acc[7] = {1.0f, 0.693147182f, 0.240226507f,
+                                    0.0555032715f, 0.00961805694f,
+                                    0.0013400428f, 0.000154614449f};
+    const mha_real_t exp2_fast[5] = {1.0f, 0.693121016f, 0.240223497f,
+                                     0.0559219755f, 0.00966636837f};
+    // polynomial of degree 3 (2) in t^2 for atanh(t)/t, maximum
+    // relative error 1.7e-9 (1.2e-7)
+    const mha_real_t atanh_acc[4] = {1.0f, 0.333334088f, 0.199874252f,
+                                     0.149621949f};
+    const mha_real_t atanh_fast[3] = {1.00000012f, 0.333261341f,
+                                      0.206474543f};
+
+    // exp2 results below 2^-126 are flushed to zero, from 2^128 on they
+    // are infinite.  The rounded exponent is clamped to a range that
+    // covers both cases.
+    const mha_real_t exp2_min = -126.0f;
+    const mha_real_t exp2_max = 128.0f;
+    const mha_real_t exp2_clamp_lo = -127.0f;
+    const mha_real_t exp2_clamp_hi = 129.0f;
+    const mha_real_t sqrt2 = 1.41421356237f;
+    const mha_real_t min_normal = std::numeric_limits<mha_real_t>::min();
+    const mha_real_t two23 = 8388608.0f;
+    const mha_real_t inf = std::numeric_limits<mha_real_t>::infinity();
+    const mha_real_t qnan = std::numeric_limits<mha_real_t>::quiet_NaN();
+    // keeps the sign, the exponent and 12 significant bits
+    const int32_t split_mask = int32_t(0xfffff000);
+
+    inline int32_t float_bits(float x)
+    {
+        int32_t i;
+        memcpy(&i, &x, sizeof(i));
+        return i;
+    }
+
+    inline float bits_float(int32_t i)
+    {
+        float x;
+        memcpy(&x, &i, sizeof(x));
+        return x;
+    }
+
+    /** Constants for 2^(x*k) */
+    coef_t exp2_coef(double k)
+    {
+        coef_t c;
+        c.full = static_cast<mha_real_t>(k);
+        c.hi = bits_float(float_bits(c.full) & split_mask);
+        c.lo = static_cast<mha_real_t>(k - c.hi);
+        c.m = 0.0f;
+        return c;
+    }
+
+    /** Constants for c*log2(x) */
+    coef_t log2_coef(double c)
+    {
+        coef_t r;
+        r.full = static_cast<mha_real_t>(c);
+        // the exponent has at most 8 significant bits
+        r.hi = bits_float(float_bits(r.full) & int32_t(0xffffff00));
+        r.lo = static_cast<mha_real_t>(c - r.hi);
+        r.m = static_cast<mha_real_t>(2.0 * c / ln2);
+        return r;
+    }
+
+    const coef_t coef_exp = exp2_coef(1.0 / ln2);
+    const coef_t coef_sigmoid = exp2_coef(-1.0 / ln2);
+    const coef_t coef_db2lin = exp2_coef(std::log2(10.0) / 20.0);
+    const coef_t coef_log = log2_coef(ln2);
+    const coef_t coef_log10 = log2_coef(std::log10(2.0));
+    const coef_t coef_lin2db = log2_coef(20.0 * std::log10(2.0));
+    const coef_t coef_abs2db = log2_coef(10.0 * std::log10(2.0));
+    const coef_t coef_log2 = log2_coef(1.0);
+
+    /** Scalar implementation of 2^(x*k).  The vectorized versions
+        compute exactly the same expressions. */
+    template <bool accurate>
+    inline mha_real_t exp2_scalar(mha_real_t x, const coef_t & k)
+    {
+        mha_real_t y, yl = 0.0f;
+        if (accurate) {
+            const mha_real_t xh = bits_float(float_bits(x) & split_mask);
+            yl = xh * k.lo + (x - xh) * k.full;
+            y = xh * k.hi;
+        } else
+            y = x * k.full;
+        // same operand order and NaN behaviour as maxps and minps
+        mha_real_t yc = (y > exp2_clamp_lo) ? y : exp2_clamp_lo;
+        yc = (yc < exp2_clamp_hi) ? yc : exp2_clamp_hi;
+        const int32_t i = static_cast<int32_t>(std::lrint(yc));
+        mha_real_t f = yc - static_cast<mha_real_t>(i);
+        mha_real_t p;
+        if (accurate) {
+            f = f + yl;
+            p = exp2_acc[6] * f + exp2_acc[5];
+            p = p * f + exp2_acc[4];
+            p = p * f + exp2_acc[3];
+            p = p * f + exp2_acc[2];
+        } else {
+            p = exp2_fast[4] * f + exp2_fast[3];
+            p = p * f + exp2_fast[2];
+        }
+        p = p * f + (accurate ? exp2_acc[1] : exp2_fast[1]);
+        p = p * f + 1.0f;
+        // 2^i as the product of two powers of two for i up to 129
+        const int32_t i1 = i >> 1;
+        mha_real_t r = (p * bits_float((i1 + 127) << 23))
+            * bits_float((i - i1 + 127) << 23);
+        if (y < exp2_min)
+            r = 0.0f;
+        if (y >= exp2_max)
+            r = inf;
+        if (x != x)
+            r = x;
+        return r;
+    }
+
+    /** Scalar implementation of c*log2(x). */
+    template <bool accurate>
+    inline mha_real_t log2_scalar(mha_real_t x, const coef_t & c)
+    {
+        // denormals are scaled into the normal range
+        const bool tiny = x < min_normal;
+        const mha_real_t xs = tiny ? x * two23 : x;
+        const int32_t bits = float_bits(xs);
+        int32_t e = ((bits >> 23) & 0xff) - (tiny ? 150 : 127);
+        mha_real_t m = bits_float((bits & 0x007fffff) | 0x3f800000);
+        if (m > sqrt2) {
+            m = m * 0.5f;
+            e = e + 1;
+        }
+        const mha_real_t t = (m - 1.0f) / (m + 1.0f);
+        const mha_real_t s = t * t;
+        mha_real_t q;
+        if (accurate) {
+            q = atanh_acc[3] * s + atanh_acc[2];
+            q = q * s + atanh_acc[1];
+            q = q * s + atanh_acc[0];
+        } else {
+            q = atanh_fast[2] * s + atanh_fast[1];
+            q = q * s + atanh_fast[0];
+        }
+        const mha_real_t a = t * q;
+        const mha_real_t ef = static_cast<mha_real_t>(e);
+        mha_real_t r;
+        if (accurate)
+            r = ef * c.hi + (a * c.m + ef * c.lo);
+        else
+            r = ef * c.full + a * c.m;
+        if (!(x > 0.0f))
+            r = (x == 0.0f) ? -inf : qnan;
+        if (x == inf)
+            r = inf;
+        return r;
+    }
+
+    template <bool accurate>
+    void exp2_map_scalar(const mha_real_t * in, mha_real_t * out,
+                         unsigned n, const coef_t & k)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            out[i] = exp2_scalar<accurate>(in[i], k);
+    }
+
+    template <bool accurate>
+    void log2_map_scalar(const mha_real_t * in, mha_real_t * out,
+                         unsigned n, const coef_t & c)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            out[i] = log2_scalar<accurate>(in[i], c);
+    }
+
+    template <bool accurate>
+    void pow_map_scalar(const mha_real_t * in, mha_real_t * out,
+                        unsigned n, const coef_t & k)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            out[i] = exp2_scalar<accurate>(
+                log2_scalar<accurate>(in[i], coef_log2), k);
+    }
+
+    template <bool accurate>
+    void sigmoid_map_scalar(const mha_real_t * in, mha_real_t * out,
+                            unsigned n, const coef_t & k)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            out[i] = 1.0f / (1.0f + exp2_scalar<accurate>(in[i], k));
+    }
+
+#if MHA_SIMD_X86
+    /** mask ? a : b */
+    inline __m128 select_sse2(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    template <bool accurate>
+    inline __m128 exp2_sse2(__m128 x, const coef_t & k)
+    {
+        __m128 y, yl = _mm_setzero_ps();
+        if (accurate) {
+            const __m128 xh =
+                _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(split_mask)));
+            yl = _mm_add_ps(_mm_mul_ps(xh, _mm_set1_ps(k.lo)),
+                            _mm_mul_ps(_mm_sub_ps(x, xh),
+                                       _mm_set1_ps(k.full)));
+            y = _mm_mul_ps(xh, _mm_set1_ps(k.hi));
+        } else
+            y = _mm_mul_ps(x, _mm_set1_ps(k.full));
+        __m128 yc = _mm_max_ps(y, _mm_set1_ps(exp2_clamp_lo));
+        yc = _mm_min_ps(yc, _mm_set1_ps(exp2_clamp_hi));
+        const __m128i i = _mm_cvtps_epi32(yc);
+        __m128 f = _mm_sub_ps(yc, _mm_cvtepi32_ps(i));
+        __m128 p;
+        if (accurate) {
+            f = _mm_add_ps(f, yl);
+            p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(exp2_acc[6]), f),
+                           _mm_set1_ps(exp2_acc[5]));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(exp2_acc[4]));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(exp2_acc[3]));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(exp2_acc[2]));
+        } else {
+            p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(exp2_fast[4]), f),
+                           _mm_set1_ps(exp2_fast[3]));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(exp2_fast[2]));
+        }
+        p = _mm_add_ps(_mm_mul_ps(p, f),
+                       _mm_set1_ps(accurate ? exp2_acc[1] : exp2_fast[1]));
+        p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+        const __m128i i1 = _mm_srai_epi32(i, 1);
+        const __m128i bias = _mm_set1_epi32(127);
+        const __m128 s1 =
+            _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i1, bias), 23));
+        const __m128 s2 = _mm_castsi128_ps(
+            _mm_slli_epi32(_mm_add_epi32(_mm_sub_epi32(i, i1), bias), 23));
+        __m128 r = _mm_mul_ps(_mm_mul_ps(p, s1), s2);
+        r = _mm_andnot_ps(_mm_cmplt_ps(y, _mm_set1_ps(exp2_min)), r);
+        r = select_sse2(_mm_cmpge_ps(y, _mm_set1_ps(exp2_max)),
+                        _mm_set1_ps(inf), r);
+        return select_sse2(_mm_cmpunord_ps(x, x), x, r);
+    }
+
+    template <bool accurate>
+    inline __m128 log2_sse2(__m128 x, const coef_t & c)
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 tiny = _mm_cmplt_ps(x, _mm_set1_ps(min_normal));
+        const __m128 xs = select_sse2(tiny, _mm_mul_ps(x, _mm_set1_ps(two23)),
+                                      x);
+        const __m128i bits = _mm_castps_si128(xs);
+        const __m128i bias = _mm_castps_si128(
+            select_sse2(tiny, _mm_castsi128_ps(_mm_set1_epi32(150)),
+                        _mm_castsi128_ps(_mm_set1_epi32(127))));
+        __m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23),
+                                                _mm_set1_epi32(0xff)),
+                                  bias);
+        __m128 m = _mm_castsi128_ps(
+            _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                         _mm_set1_epi32(0x3f800000)));
+        const __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(sqrt2));
+        m = select_sse2(big, _mm_mul_ps(m, _mm_set1_ps(0.5f)), m);
+        e = _mm_sub_epi32(e, _mm_castps_si128(big));
+        const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+        const __m128 s = _mm_mul_ps(t, t);
+        __m128 q;
+        if (accurate) {
+            q = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(atanh_acc[3]), s),
+                           _mm_set1_ps(atanh_acc[2]));
+            q = _mm_add_ps(_mm_mul_ps(q, s), _mm_set1_ps(atanh_acc[1]));
+            q = _mm_add_ps(_mm_mul_ps(q, s), _mm_set1_ps(atanh_acc[0]));
+        } else {
+            q = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(atanh_fast[2]), s),
+                           _mm_set1_ps(atanh_fast[1]));
+            q = _mm_add_ps(_mm_mul_ps(q, s), _mm_set1_ps(atanh_fast[0]));
+        }
+        const __m128 a = _mm_mul_ps(t, q);
+        const __m128 ef = _mm_cvtepi32_ps(e);
+        __m128 r;
+        if (accurate)
+            r = _mm_add_ps(_mm_mul_ps(ef, _mm_set1_ps(c.hi)),
+                           _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(c.m)),
+                                      _mm_mul_ps(ef, _mm_set1_ps(c.lo))));
+        else
+            r = _mm_add_ps(_mm_mul_ps(ef, _mm_set1_ps(c.full)),
+                           _mm_mul_ps(a, _mm_set1_ps(c.m)));
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 special = select_sse2(_mm_cmpeq_ps(x, zero),
+                                           _mm_set1_ps(-inf),
+                                           _mm_set1_ps(qnan));
+        r = select_sse2(_mm_cmpgt_ps(x, zero), r, special);
+        return select_sse2(_mm_cmpeq_ps(x, _mm_set1_ps(inf)),
+                           _mm_set1_ps(inf), r);
+    }
+
+    template <bool accurate>
+    void exp2_map_sse2(const mha_real_t * in, mha_real_t * out,
+                       unsigned n, const coef_t & k)
+    {
+        unsigned i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, exp2_sse2<accurate>(_mm_loadu_ps(in + i),
+                                                       k));
+        exp2_map_scalar<accurate>(in + i, out + i, n - i, k);
+    }
+
+    template <bool accurate>
+    void log2_map_sse2(const mha_real_t * in, mha_real_t * out,
+                       unsigned n, const coef_t & c)
+    {
+        unsigned i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, log2_sse2<accurate>(_mm_loadu_ps(in + i),
+                                                       c));
+        log2_map_scalar<accurate>(in + i, out + i, n - i, c);
+    }
+
+    template <bool accurate>
+    void pow_map_sse2(const mha_real_t * in, mha_real_t * out,
+                      unsigned n, const coef_t & k)
+    {
+        unsigned i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, exp2_sse2<accurate>(
+                              log2_sse2<accurate>(_mm_loadu_ps(in + i),
+                                                  coef_log2), k));
+        pow_map_scalar<accurate>(in + i, out + i, n - i, k);
+    }
+
+    template <bool accurate>
+    void sigmoid_map_sse2(const mha_real_t * in, mha_real_t * out,
+                          unsigned n, const coef_t & k)
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+        unsigned i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, _mm_div_ps(
+                              one, _mm_add_ps(one, exp2_sse2<accurate>(
+                                                  _mm_loadu_ps(in + i), k))));
+        sigmoid_map_scalar<accurate>(in + i, out + i, n - i, k);
+    }
+
+    /** mask ? a : b */
+    __attribute__((target("avx2")))
+    inline __m256 select_avx2(__m256 mask, __m256 a, __m256 b)
+    {
+        return _mm256_blendv_ps(b, a, mask);
+    }
+
+    template <bool accurate>
+    __attribute__((target("avx2")))
+    inline __m256 exp2_avx2(__m256 x, const coef_t & k)
+    {
+        __m256 y, yl = _mm256_setzero_ps();
+        if (accurate) {
+            const __m256 xh = _mm256_and_ps(
+                x, _mm256_castsi256_ps(_mm256_set1_epi32(split_mask)));
+            yl = _mm256_add_ps(_mm256_mul_ps(xh, _mm256_set1_ps(k.lo)),
+                               _mm256_mul_ps(_mm256_sub_ps(x, xh),
+                                             _mm256_set1_ps(k.full)));
+            y = _mm256_mul_ps(xh, _mm256_set1_ps(k.hi));
+        } else
+            y = _mm256_mul_ps(x, _mm256_set1_ps(k.full));
+        __m256 yc = _mm256_max_ps(y, _mm256_set1_ps(exp2_clamp_lo));
+        yc = _mm256_min_ps(yc, _mm256_set1_ps(exp2_clamp_hi));
+        const __m256i i = _mm256_cvtps_epi32(yc);
+        __m256 f = _mm256_sub_ps(yc, _mm256_cvtepi32_ps(i));
+        __m256 p;
+        if (accurate) {
+            f = _mm256_add_ps(f, yl);
+            p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(exp2_acc[6]), f),
+                              _mm256_set1_ps(exp2_acc[5]));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f),
+                              _mm256_set1_ps(exp2_acc[4]));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f),
+                              _mm256_set1_ps(exp2_acc[3]));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f),
+                              _mm256_set1_ps(exp2_acc[2]));
+        } else {
+            p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(exp2_fast[4]), f),
+                              _mm256_set1_ps(exp2_fast[3]));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f),
+                              _mm256_set1_ps(exp2_fast[2]));
+        }
+        p = _mm256_add_ps(_mm256_mul_ps(p, f),
+                          _mm256_set1_ps(accurate ? exp2_acc[1]
+                                         : exp2_fast[1]));
+        p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+        const __m256i i1 = _mm256_srai_epi32(i, 1);
+        const __m256i bias = _mm256_set1_epi32(127);
+        const __m256 s1 = _mm256_castsi256_ps(
+            _mm256_slli_epi32(_mm256_add_epi32(i1, bias), 23));
+        const __m256 s2 = _mm256_castsi256_ps(
+            _mm256_slli_epi32(_mm256_add_epi32(_mm256_sub_epi32(i, i1), bias),
+                              23));
+        __m256 r = _mm256_mul_ps(_mm256_mul_ps(p, s1), s2);
+        r = _mm256_andnot_ps(
+            _mm256_cmp_ps(y, _mm256_set1_ps(exp2_min), _CMP_LT_OQ), r);
+        r = select_avx2(_mm256_cmp_ps(y, _mm256_set1_ps(exp2_max), _CMP_GE_OQ),
+                        _mm256_set1_ps(inf), r);
+        return select_avx2(_mm256_cmp_ps(x, x, _CMP_UNORD_Q), x, r);
+    }
+
+    template <bool accurate>
+    __attribute__((target("avx2")))
+    inline __m256 log2_avx2(__m256 x, const coef_t & c)
+    {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 tiny =
+            _mm256_cmp_ps(x, _mm256_set1_ps(min_normal), _CMP_LT_OQ);
+        const __m256 xs =
+            select_avx2(tiny, _mm256_mul_ps(x, _mm256_set1_ps(two23)), x);
+        const __m256i bits = _mm256_castps_si256(xs);
+        const __m256i bias = _mm256_castps_si256(
+            select_avx2(tiny, _mm256_castsi256_ps(_mm256_set1_epi32(150)),
+                        _mm256_castsi256_ps(_mm256_set1_epi32(127))));
+        __m256i e = _mm256_sub_epi32(
+            _mm256_and_si256(_mm256_srli_epi32(bits, 23),
+                             _mm256_set1_epi32(0xff)),
+            bias);
+        __m256 m = _mm256_castsi256_ps(
+            _mm256_or_si256(_mm256_and_si256(bits,
+                                             _mm256_set1_epi32(0x007fffff)),
+                            _mm256_set1_epi32(0x3f800000)));
+        const __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(sqrt2), _CMP_GT_OQ);
+        m = select_avx2(big, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), m);
+        e = _mm256_sub_epi32(e, _mm256_castps_si256(big));
+        const __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one),
+                                       _mm256_add_ps(m, one));
+        const __m256 s = _mm256_mul_ps(t, t);
+        __m256 q;
+        if (accurate) {
+            q = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(atanh_acc[3]), s),
+                              _mm256_set1_ps(atanh_acc[2]));
+            q = _mm256_add_ps(_mm256_mul_ps(q, s),
+                              _mm256_set1_ps(atanh_acc[1]));
+            q = _mm256_add_ps(_mm256_mul_ps(q, s),
+                              _mm256_set1_ps(atanh_acc[0]));
+        } else {
+            q = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(atanh_fast[2]), s),
+                              _mm256_set1_ps(atanh_fast[1]));
+            q = _mm256_add_ps(_mm256_mul_ps(q, s),
+                              _mm256_set1_ps(atanh_fast[0]));
+        }
+        const __m256 a = _mm256_mul_ps(t, q);
+        const __m256 ef = _mm256_cvtepi32_ps(e);
+        __m256 r;
+        if (accurate)
+            r = _mm256_add_ps(
+                _mm256_mul_ps(ef, _mm256_set1_ps(c.hi)),
+                _mm256_add_ps(_mm256_mul_ps(a, _mm256_set1_ps(c.m)),
+                              _mm256_mul_ps(ef, _mm256_set1_ps(c.lo))));
+        else
+            r = _mm256_add_ps(_mm256_mul_ps(ef, _mm256_set1_ps(c.full)),
+                              _mm256_mul_ps(a, _mm256_set1_ps(c.m)));
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 special =
+            select_avx2(_mm256_cmp_ps(x, zero, _CMP_EQ_OQ),
+                        _mm256_set1_ps(-inf), _mm256_set1_ps(qnan));
+        r = select_avx2(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), r, special);
+        return select_avx2(_mm256_cmp_ps(x, _mm256_set1_ps(inf), _CMP_EQ_OQ),
+                           _mm256_set1_ps(inf), r);
+    }
+
+    template <bool accurate>
+    __attribute__((target("avx2")))
+    void exp2_map_avx2(const mha_real_t * in, mha_real_t * out,
+                       unsigned n, const coef_t & k)
+    {
+        unsigned i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i,
+                             exp2_avx2<accurate>(_mm256_loadu_ps(in + i), k));
+        _mm256_zeroupper();
+        exp2_map_sse2<accurate>(in + i, out + i, n - i, k);
+    }
+
+    template <bool accurate>
+    __attribute__((target("avx2")))
+    void log2_map_avx2(const mha_real_t * in, mha_real_t * out,
+                       unsigned n, const coef_t & c)
+    {
+        unsigned i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i,
+                             log2_avx2<accurate>(_mm256_loadu_ps(in + i), c));
+        _mm256_zeroupper();
+        log2_map_sse2<accurate>(in + i, out + i, n - i, c);
+    }
+
+    template <bool accurate>
+    __attribute__((target("avx2")))
+    void pow_map_avx2(const mha_real_t * in, mha_real_t * out,
+                      unsigned n, const coef_t & k)
+    {
+        unsigned i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, exp2_avx2<accurate>(
+                                 log2_avx2<accurate>(_mm256_loadu_ps(in + i),
+                                                     coef_log2), k));
+        _mm256_zeroupper();
+        pow_map_sse2<accurate>(in + i, out + i, n - i, k);
+    }
+
+    template <bool accurate>
+    __attribute__((target("avx2")))
+    void sigmoid_map_avx2(const mha_real_t * in, mha_real_t * out,
+                          unsigned n, const coef_t & k)
+    {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        unsigned i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_div_ps(
+                                 one, _mm256_add_ps(one, exp2_avx2<accurate>(
+                                                        _mm256_loadu_ps(in + i),
+                                                        k))));
+        _mm256_zeroupper();
+        sigmoid_map_sse2<accurate>(in + i, out + i, n - i, k);
+    }
+#endif
+
+    typedef void (*map_fn_t)(const mha_real_t *, mha_real_t *, unsigned,
+                             const coef_t &);
+
+    /** The element-wise operations, index into the tables below */
+    enum map_t {EXP2, LOG2, POW, SIGMOID};
+
+    // [operation][accurate]
+    const map_fn_t maps_scalar[4][2] = {
+        {exp2_map_scalar<false>, exp2_map_scalar<true>},
+        {log2_map_scalar<false>, log2_map_scalar<true>},
+        {pow_map_scalar<false>, pow_map_scalar<true>},
+        {sigmoid_map_scalar<false>, sigmoid_map_scalar<true>}
+    };
+#if MHA_SIMD_X86
+    const map_fn_t maps_sse2[4][2] = {
+        {exp2_map_sse2<false>, exp2_map_sse2<true>},
+        {log2_map_sse2<false>, log2_map_sse2<true>},
+        {pow_map_sse2<false>, pow_map_sse2<true>},
+        {sigmoid_map_sse2<false>, sigmoid_map_sse2<true>}
+    };
+    const map_fn_t maps_avx2[4][2] = {
+        {exp2_map_avx2<false>, exp2_map_avx2<true>},
+        {log2_map_avx2<false>, log2_map_avx2<true>},
+        {pow_map_avx2<false>, pow_map_avx2<true>},
+        {sigmoid_map_avx2<false>, sigmoid_map_avx2<true>}
+    };
+#endif
+
+    map_fn_t map_impl(map_t map, vecmath_accuracy_t accuracy,
+                      simd_level_t level)
+    {
+        const bool accurate = accuracy == vecmath_accuracy_t::ACCURATE;
+        switch (level) {
+#if MHA_SIMD_X86
+        case simd_level_t::AVX2:
+            return maps_avx2[map][accurate];
+        case simd_level_t::SSE2:
+            return maps_sse2[map][accurate];
+#endif
+        default:
+            return maps_scalar[map][accurate];
+        }
+    }
+
+    void check_available(simd_level_t level)
+    {
+        if (!MHASignal::simd_level_available(level))
+            throw MHA_Error(__FILE__,__LINE__,
+                            "SIMD level \"%s\" is not available on this system",
+                            MHASignal::simd_level_name(level).c_str());
+    }
+
+    void check_channel(const mha_spec_t & s, unsigned channel)
+    {
+        if (channel >= s.num_channels)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "Channel index %u out of range, the spectrum"
+                            " has %u channels", channel, s.num_channels);
+    }
+}
+
+void MHASignal::vec_exp(const mha_real_t * in, mha_real_t * out, unsigned n,
+                        vecmath_accuracy_t accuracy)
+{
+    map_impl(EXP2, accuracy, simd_level())(in, out, n, coef_exp);
+}
+
+void MHASignal::vec_exp(const mha_real_t * in, mha_real_t * out, unsigned n,
+                        vecmath_accuracy_t accuracy, simd_level_t level)
+{
+    check_available(level);
+    map_impl(EXP2, accuracy, level)(in, out, n, coef_exp);
+}
+
+void MHASignal::vec_log(const mha_real_t * in, mha_real_t * out, unsigned n,
+                        vecmath_accuracy_t accuracy)
+{
+    map_impl(LOG2, accuracy, simd_level())(in, out, n, coef_log);
+}
+
+void MHASignal::vec_log(const mha_real_t * in, mha_real_t * out, unsigned n,
+                        vecmath_accuracy_t accuracy, simd_level_t level)
+{
+    check_available(level);
+    map_impl(LOG2, accuracy, level)(in, out, n, coef_log);
+}
+
+void MHASignal::vec_log10(const mha_real_t * in, mha_real_t * out, unsigned n,
+                          vecmath_accuracy_t accuracy)
+{
+    map_impl(LOG2, accuracy, simd_level())(in, out, n, coef_log10);
+}
+
+void MHASignal::vec_log10(const mha_real_t * in, mha_real_t * out, unsigned n,
+                          vecmath_accuracy_t accuracy, simd_level_t level)
+{
+    check_available(level);
+    map_impl(LOG2, accuracy, level)(in, out, n, coef_log10);
+}
+
+void MHASignal::vec_pow(const mha_real_t * in, mha_real_t exponent,
+                        mha_real_t * out, unsigned n,
+                        vecmath_accuracy_t accuracy)
+{
+    vec_pow(in, exponent, out, n, accuracy, simd_level());
+}
+
+void MHASignal::vec_pow(const mha_real_t * in, mha_real_t exponent,
+                        mha_real_t * out, unsigned n,
+                        vecmath_accuracy_t accuracy, simd_level_t level)
+{
+    check_available(level);
+    if (exponent == 0.0f)
+        std::fill(out, out + n, 1.0f);
+    else
+        map_impl(POW, accuracy, level)(in, out, n, exp2_coef(exponent));
+}
+
+void MHASignal::vec_db2lin(const mha_real_t * in, mha_real_t * out,
+                           unsigned n, vecmath_accuracy_t accuracy)
+{
+    map_impl(EXP2, accuracy, simd_level())(in, out, n, coef_db2lin);
+}
+
+void MHASignal::vec_db2lin(const mha_real_t * in, mha_real_t * out,
+                           unsigned n, vecmath_accuracy_t accuracy,
+                           simd_level_t level)
+{
+    check_available(level);
+    map_impl(EXP2, accuracy, level)(in, out, n, coef_db2lin);
+}
+
+void MHASignal::vec_lin2db(const mha_real_t * in, mha_real_t * out,
+                           unsigned n, vecmath_accuracy_t accuracy)
+{
+    map_impl(LOG2, accuracy, simd_level())(in, out, n, coef_lin2db);
+}
+
+void MHASignal::vec_lin2db(const mha_real_t * in, mha_real_t * out,
+                           unsigned n, vecmath_accuracy_t accuracy,
+                           simd_level_t level)
+{
+    check_available(level);
+    map_impl(LOG2, accuracy, level)(in, out, n, coef_lin2db);
+}
+
+void MHASignal::vec_sigmoid(const mha_real_t * in, mha_real_t * out,
+                            unsigned n, vecmath_accuracy_t accuracy)
+{
+    map_impl(SIGMOID, accuracy, simd_level())(in, out, n, coef_sigmoid);
+}
+
+void MHASignal::vec_sigmoid(const mha_real_t * in, mha_real_t * out,
+                            unsigned n, vecmath_accuracy_t accuracy,
+                            simd_level_t level)
+{
+    check_available(level);
+    map_impl(SIGMOID, accuracy, level)(in, out, n, coef_sigmoid);
+}
+
+void MHASignal::vec_abs2db(const mha_spec_t & in, unsigned channel,
+                           mha_real_t * out, vecmath_accuracy_t accuracy)
+{
+    check_channel(in, channel);
+    const mha_complex_t * x = in.buf + channel * in.num_frames;
+    for (unsigned k = 0; k < in.num_frames; ++k)
+        out[k] = x[k].re * x[k].re + x[k].im * x[k].im;
+    map_impl(LOG2, accuracy, simd_level())(out, out, in.num_frames,
+                                           coef_abs2db);
+}
+
+void MHASignal::vec_scale_db(mha_spec_t & s, unsigned channel,
+                             const mha_real_t * gain_db,
+                             vecmath_accuracy_t accuracy)
+{
+    check_channel(s, channel);
+    const map_fn_t db2lin = map_impl(EXP2, accuracy, simd_level());
+    mha_complex_t * x = s.buf + channel * s.num_frames;
+    // convert the gains in blocks that fit on the stack
+    const unsigned block = 256U;
+    mha_real_t gain[block];
+    for (unsigned k0 = 0; k0 < s.num_frames; k0 += block) {
+        const unsigned n = std::min(block, s.num_frames - k0);
+        db2lin(gain_db + k0, gain, n, coef_db2lin);
+        for (unsigned k = 0; k < n; ++k) {
+            x[k0 + k].re *= gain[k];
+            x[k0 + k].im *= gain[k];
+        }
+    }
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
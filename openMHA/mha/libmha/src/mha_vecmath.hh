@@ -0,0 +1,232 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_VECMATH_HH
+#define MHA_VECMATH_HH
+
+#include "mha.hh"
+#include "mha_simd.hh"
+
+/** \defgroup mhavecmath Vectorized transcendental functions
+
+    Exponential, logarithmic and derived functions applied to whole
+    arrays, e.g. to all frequency bins of a spectrum, instead of
+    calling expf, logf or powf for each value.  Like the kernels in
+    \ref mhasimd, each function has a portable scalar and, on x86
+    processors, SSE2 and AVX2 implementations with bit-identical
+    results, selected at run time (see MHASignal::simd_level).
+
+    All functions compute the power of two and the logarithm to base
+    two with polynomial approximations of the mantissa.  Two accuracy
+    tiers are available:
+
+    - vecmath_accuracy_t::ACCURATE extends the precision of the
+      argument reduction, so that the errors are at most a few units
+      in the last place (ULP) of the single precision result.
+    - vecmath_accuracy_t::FAST uses lower polynomial degrees and a
+      single precision argument reduction, which saves up to a
+      quarter of the computation time.  Its relative error is below
+      1e-5, except for vec_pow.
+
+    The maximum errors, measured against double precision reference
+    functions over the whole range of single precision arguments,
+    are documented with each function.  "ULP" is the spacing of
+    single precision numbers at the exact result.
+
+    Special values: Powers below the smallest normalized single
+    precision number (1.2e-38) are flushed to zero, results above the
+    largest single precision number are +Inf.  NaN input returns NaN.
+    Logarithms of zero are -Inf, of negative values NaN.  Denormal
+    input values of the logarithms are supported, unless the processor
+    is configured to treat denormals as zero.
+*/
+
+namespace MHASignal {
+
+    /** \ingroup mhavecmath
+        \brief Accuracy tiers of the vectorized transcendental functions */
+    enum class vecmath_accuracy_t {
+        /** Relative error below 1e-5, except for vec_pow */
+        FAST,
+        /** Error of a few ULP, see the individual functions */
+        ACCURATE
+    };
+
+    /** \ingroup mhavecmath
+        \brief out[k] = exp(in[k]) for 0 <= k < n.
+
+        Maximum error: ACCURATE 2 ULP, FAST 120 ULP.
+        \param in  n input values.
+        \param out n output values, may be equal to in.
+        \param n   Number of values.
+        \param accuracy Accuracy tier. */
+    void vec_exp(const mha_real_t * in, mha_real_t * out, unsigned n,
+                 vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief out[k] = log(in[k]), natural logarithm, for 0 <= k < n.
+
+        Maximum error: ACCURATE 3 ULP, FAST 5 ULP.
+        \param in  n input values.
+        \param out n output values, may be equal to in.
+        \param n   Number of values.
+        \param accuracy Accuracy tier. */
+    void vec_log(const mha_real_t * in, mha_real_t * out, unsigned n,
+                 vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief out[k] = log10(in[k]) for 0 <= k < n.
+
+        Maximum error: ACCURATE 5 ULP, FAST 6 ULP.
+        \param in  n input values.
+        \param out n output values, may be equal to in.
+        \param n   Number of values.
+        \param accuracy Accuracy tier. */
+    void vec_log10(const mha_real_t * in, mha_real_t * out, unsigned n,
+                   vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief out[k] = pow(in[k], exponent) for 0 <= k < n.
+
+        The power is computed as 2^(exponent*log2(in[k])), the error
+        of the single precision logarithm is amplified by the
+        exponent: Maximum error ACCURATE 3 + 0.7*|exponent*log2(in[k])|
+        ULP, FAST 120 + 1.5*|exponent*log2(in[k])| ULP.  Negative bases
+        return NaN, an exponent of 0 returns 1.
+        \param in  n bases.
+        \param exponent The exponent applied to all bases.
+        \param out n output values, may be equal to in.
+        \param n   Number of values.
+        \param accuracy Accuracy tier. */
+    void vec_pow(const mha_real_t * in, mha_real_t exponent,
+                 mha_real_t * out, unsigned n,
+                 vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief out[k] = MHASignal::db2lin(in[k]) = 10^(in[k]/20) for
+        0 <= k < n.
+
+        Maximum error: ACCURATE 2 ULP, FAST 120 ULP.
+        \param in  n values in dB.
+        \param out n linear factors, may be equal to in.
+        \param n   Number of values.
+        \param accuracy Accuracy tier. */
+    void vec_db2lin(const mha_real_t * in, mha_real_t * out, unsigned n,
+                    vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief out[k] = MHASignal::lin2db(in[k]) = 20*log10(in[k]) for
+        0 <= k < n.
+
+        Maximum error: ACCURATE 4 ULP, FAST 5 ULP.
+        \param in  n linear values.
+        \param out n values in dB, may be equal to in.
+        \param n   Number of values.
+        \param accuracy Accuracy tier. */
+    void vec_lin2db(const mha_real_t * in, mha_real_t * out, unsigned n,
+                    vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief Logistic function out[k] = 1/(1+exp(-in[k])) for
+        0 <= k < n.
+
+        Maximum error: ACCURATE 3 ULP, FAST 120 ULP, for results
+        above 1.2e-38.  The result is 0 for in[k] < -88.7.
+        \param in  n input values.
+        \param out n output values, may be equal to in.
+        \param n   Number of values.
+        \param accuracy Accuracy tier. */
+    void vec_sigmoid(const mha_real_t * in, mha_real_t * out, unsigned n,
+                     vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief Level of all bins of one channel of a spectrum,
+        out[k] = 10*log10(|in(k,channel)|^2).
+
+        Maximum error of the logarithm as for vec_lin2db.
+        \param in  Input spectrum.
+        \param channel Channel index.
+        \param out in.num_frames levels in dB.
+        \param accuracy Accuracy tier.
+        \throw MHA_Error if channel is out of range. */
+    void vec_abs2db(const mha_spec_t & in, unsigned channel, mha_real_t * out,
+                    vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief Apply gains in dB to all bins of one channel of a
+        spectrum, s(k,channel) *= 10^(gain_db[k]/20).
+
+        Maximum error of the linear gains as for vec_db2lin.
+        \param s Spectrum, modified in place.
+        \param channel Channel index.
+        \param gain_db s.num_frames gains in dB.
+        \param accuracy Accuracy tier.
+        \throw MHA_Error if channel is out of range. */
+    void vec_scale_db(mha_spec_t & s, unsigned channel,
+                      const mha_real_t * gain_db,
+                      vecmath_accuracy_t accuracy = vecmath_accuracy_t::ACCURATE);
+
+    /** \ingroup mhavecmath
+        \brief vec_exp with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void vec_exp(const mha_real_t * in, mha_real_t * out, unsigned n,
+                 vecmath_accuracy_t accuracy, simd_level_t level);
+
+    /** \ingroup mhavecmath
+        \brief vec_log with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void vec_log(const mha_real_t * in, mha_real_t * out, unsigned n,
+                 vecmath_accuracy_t accuracy, simd_level_t level);
+
+    /** \ingroup mhavecmath
+        \brief vec_log10 with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void vec_log10(const mha_real_t * in, mha_real_t * out, unsigned n,
+                   vecmath_accuracy_t accuracy, simd_level_t level);
+
+    /** \ingroup mhavecmath
+        \brief vec_pow with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void vec_pow(const mha_real_t * in, mha_real_t exponent,
+                 mha_real_t * out, unsigned n,
+                 vecmath_accuracy_t accuracy, simd_level_t level);
+
+    /** \ingroup mhavecmath
+        \brief vec_db2lin with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void vec_db2lin(const mha_real_t * in, mha_real_t * out, unsigned n,
+                    vecmath_accuracy_t accuracy, simd_level_t level);
+
+    /** \ingroup mhavecmath
+        \brief vec_lin2db with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void vec_lin2db(const mha_real_t * in, mha_real_t * out, unsigned n,
+                    vecmath_accuracy_t accuracy, simd_level_t level);
+
+    /** \ingroup mhavecmath
+        \brief vec_sigmoid with an explicitly chosen instruction set.
+        \throw MHA_Error if the instruction set is not available. */
+    void vec_sigmoid(const mha_real_t * in, mha_real_t * out, unsigned n,
+                     vecmath_accuracy_t accuracy, simd_level_t level);
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
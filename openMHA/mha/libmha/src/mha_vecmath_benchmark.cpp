@@ -0,0 +1,153 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file mha_vecmath_benchmark.cpp
+ * Compares the vectorized transcendental functions of mha_vecmath.hh
+ * in both accuracy tiers and for all available instruction sets with
+ * loops calling the corresponding functions of the C library.
+ * Reported is the processing time per value in ns.
+ *
+ * Usage: mha_vecmath_benchmark [values [seconds_per_measurement]]
+ */
+
+#include "mha_vecmath.hh"
+#include "mha_signal.hh"
+#include "mha_latency_histogram.hh"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace {
+    using MHASignal::simd_level_t;
+    using MHASignal::vecmath_accuracy_t;
+
+    /** Mean time per call of process in ns */
+    template <class F>
+    double time_per_call(double seconds, F process)
+    {
+        for (unsigned k = 0; k < 100; ++k)
+            process();
+        unsigned long calls = 0;
+        const uint64_t start = MHAProfiling::now_ns();
+        uint64_t elapsed = 0;
+        do {
+            for (unsigned k = 0; k < 64; ++k)
+                process();
+            calls += 64;
+            elapsed = MHAProfiling::now_ns() - start;
+        } while (elapsed < seconds * 1e9);
+        return double(elapsed) / calls;
+    }
+
+    typedef std::function<void(const mha_real_t *, mha_real_t *, unsigned,
+                               vecmath_accuracy_t, simd_level_t)> vec_fn_t;
+
+    struct function_t {
+        const char * name;
+        /** Range of the input values */
+        mha_real_t lo, hi;
+        mha_real_t (*libm)(mha_real_t);
+        vec_fn_t vec;
+    };
+
+    const simd_level_t all_levels[] = {simd_level_t::SCALAR,
+                                       simd_level_t::SSE2,
+                                       simd_level_t::AVX2};
+}
+
+int main(int argc, char ** argv)
+{
+    const unsigned n = argc > 1 ? atoi(argv[1]) : 1024U;
+    const double seconds = argc > 2 ? atof(argv[2]) : 0.5;
+    const std::vector<function_t> functions = {
+        {"exp", -20.0f, 20.0f,
+         [](mha_real_t x) {return expf(x);},
+         [](const mha_real_t * in, mha_real_t * out, unsigned n,
+            vecmath_accuracy_t a, simd_level_t l)
+         {MHASignal::vec_exp(in, out, n, a, l);}},
+        {"log", 1e-10f, 1e10f,
+         [](mha_real_t x) {return logf(x);},
+         [](const mha_real_t * in, mha_real_t * out, unsigned n,
+            vecmath_accuracy_t a, simd_level_t l)
+         {MHASignal::vec_log(in, out, n, a, l);}},
+        {"log10", 1e-10f, 1e10f,
+         [](mha_real_t x) {return log10f(x);},
+         [](const mha_real_t * in, mha_real_t * out, unsigned n,
+            vecmath_accuracy_t a, simd_level_t l)
+         {MHASignal::vec_log10(in, out, n, a, l);}},
+        {"pow(x,0.3)", 1e-10f, 1e10f,
+         [](mha_real_t x) {return powf(x, 0.3f);},
+         [](const mha_real_t * in, mha_real_t * out, unsigned n,
+            vecmath_accuracy_t a, simd_level_t l)
+         {MHASignal::vec_pow(in, 0.3f, out, n, a, l);}},
+        {"db2lin", -100.0f, 100.0f,
+         [](mha_real_t x) {return MHASignal::db2lin(x);},
+         [](const mha_real_t * in, mha_real_t * out, unsigned n,
+            vecmath_accuracy_t a, simd_level_t l)
+         {MHASignal::vec_db2lin(in, out, n, a, l);}},
+        {"lin2db", 1e-10f, 1e10f,
+         [](mha_real_t x) {return MHASignal::lin2db(x);},
+         [](const mha_real_t * in, mha_real_t * out, unsigned n,
+            vecmath_accuracy_t a, simd_level_t l)
+         {MHASignal::vec_lin2db(in, out, n, a, l);}},
+        {"sigmoid", -20.0f, 20.0f,
+         [](mha_real_t x) {return 1.0f / (1.0f + expf(-x));},
+         [](const mha_real_t * in, mha_real_t * out, unsigned n,
+            vecmath_accuracy_t a, simd_level_t l)
+         {MHASignal::vec_sigmoid(in, out, n, a, l);}},
+    };
+    printf("%u values, ns per value\n", n);
+    printf("%-11s %7s %7s %9s %8s %9s\n", "function", "level", "libm",
+           "accurate", "fast", "speedup");
+    for (const function_t & f : functions) {
+        std::vector<mha_real_t> in(n), out(n);
+        // logarithmically spaced for the logarithms, linear otherwise
+        for (unsigned k = 0; k < n; ++k) {
+            const double t = (k + 0.5) / n;
+            in[k] = f.lo > 0.0f
+                ? std::exp(std::log(f.lo) + t * std::log(f.hi / f.lo))
+                : f.lo + t * (f.hi - f.lo);
+        }
+        const double libm = time_per_call(seconds, [&]() {
+            for (unsigned k = 0; k < n; ++k)
+                out[k] = f.libm(in[k]);
+        }) / n;
+        for (simd_level_t level : all_levels) {
+            if (!MHASignal::simd_level_available(level))
+                continue;
+            const double accurate = time_per_call(seconds, [&]() {
+                f.vec(in.data(), out.data(), n,
+                      vecmath_accuracy_t::ACCURATE, level);
+            }) / n;
+            const double fast = time_per_call(seconds, [&]() {
+                f.vec(in.data(), out.data(), n,
+                      vecmath_accuracy_t::FAST, level);
+            }) / n;
+            printf("%-11s %7s %7.2f %9.2f %8.2f %8.1fx\n", f.name,
+                   MHASignal::simd_level_name(level).c_str(), libm, accurate,
+                   fast, libm / accurate);
+        }
+    }
+    return 0;
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
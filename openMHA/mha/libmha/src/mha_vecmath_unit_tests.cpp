@@ -0,0 +1,306 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_vecmath.hh"
+#include "mha_signal.hh"
+#include "mha_error.hh"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <vector>
+
+using MHASignal::simd_level_t;
+using MHASignal::vecmath_accuracy_t;
+
+namespace {
+  const simd_level_t all_levels[] = {simd_level_t::SCALAR,
+                                     simd_level_t::SSE2,
+                                     simd_level_t::AVX2};
+
+  const mha_real_t inf = std::numeric_limits<mha_real_t>::infinity();
+  const mha_real_t qnan = std::numeric_limits<mha_real_t>::quiet_NaN();
+
+  typedef std::function<void(const mha_real_t *, mha_real_t *, unsigned,
+                             vecmath_accuracy_t, simd_level_t)> vec_fn_t;
+
+  /** A function under test with its double precision reference, the
+      documented maximum errors in ULP and the range of arguments for
+      which the result is a normalized number. */
+  struct function_t {
+    const char * name;
+    vec_fn_t vec;
+    std::function<double(double)> reference;
+    double ulp_accurate, ulp_fast;
+    double lo, hi;
+    bool logarithmic;
+  };
+
+  const std::vector<function_t> functions = {
+    {"exp",
+     [](const mha_real_t * in, mha_real_t * out, unsigned n,
+        vecmath_accuracy_t a, simd_level_t l)
+     {MHASignal::vec_exp(in, out, n, a, l);},
+     [](double x) {return std::exp(x);}, 2, 120, -87, 88, false},
+    {"log",
+     [](const mha_real_t * in, mha_real_t * out, unsigned n,
+        vecmath_accuracy_t a, simd_level_t l)
+     {MHASignal::vec_log(in, out, n, a, l);},
+     [](double x) {return std::log(x);}, 3, 5, 1.2e-38, 3e38, true},
+    {"log10",
+     [](const mha_real_t * in, mha_real_t * out, unsigned n,
+        vecmath_accuracy_t a, simd_level_t l)
+     {MHASignal::vec_log10(in, out, n, a, l);},
+     [](double x) {return std::log10(x);}, 5, 6, 1.2e-38, 3e38, true},
+    {"db2lin",
+     [](const mha_real_t * in, mha_real_t * out, unsigned n,
+        vecmath_accuracy_t a, simd_level_t l)
+     {MHASignal::vec_db2lin(in, out, n, a, l);},
+     [](double x) {return std::pow(10.0, x / 20.0);}, 2, 120, -750, 770,
+     false},
+    {"lin2db",
+     [](const mha_real_t * in, mha_real_t * out, unsigned n,
+        vecmath_accuracy_t a, simd_level_t l)
+     {MHASignal::vec_lin2db(in, out, n, a, l);},
+     [](double x) {return 20.0 * std::log10(x);}, 4, 5, 1.2e-38, 3e38, true},
+    {"sigmoid",
+     [](const mha_real_t * in, mha_real_t * out, unsigned n,
+        vecmath_accuracy_t a, simd_level_t l)
+     {MHASignal::vec_sigmoid(in, out, n, a, l);},
+     [](double x) {return 1.0 / (1.0 + std::exp(-x));}, 3, 120, -87, 100,
+     false},
+  };
+
+  /** n arguments spread over the range of the function */
+  std::vector<mha_real_t> arguments(const function_t & f, unsigned n)
+  {
+    std::vector<mha_real_t> v(n);
+    for (unsigned k = 0; k < n; ++k) {
+      const double t = (k + 0.5) / n;
+      v[k] = f.logarithmic
+        ? std::exp(std::log(f.lo) + t * (std::log(f.hi) - std::log(f.lo)))
+        : f.lo + t * (f.hi - f.lo);
+    }
+    return v;
+  }
+
+  /** Spacing of single precision numbers at y */
+  double ulp(double y)
+  {
+    int e;
+    std::frexp(std::fabs(y), &e);
+    return std::ldexp(1.0, std::max(e - 24, -149));
+  }
+
+  /** Arguments including special values and values outside the range */
+  std::vector<mha_real_t> special_arguments()
+  {
+    std::vector<mha_real_t> v = {0.0f, -0.0f, 1.0f, -1.0f, 1e-40f, -1e-40f,
+                                 100.0f, -100.0f, 1000.0f, -1000.0f,
+                                 inf, -inf, qnan, 3e38f, -3e38f};
+    for (mha_real_t x = -30.0f; x < 30.0f; x += 0.37f)
+      v.push_back(x);
+    return v;
+  }
+}
+
+TEST(vecmath, vectorized_matches_scalar_bit_for_bit)
+{
+  const auto in = special_arguments();
+  for (const function_t & f : functions)
+    for (auto accuracy : {vecmath_accuracy_t::FAST,
+                          vecmath_accuracy_t::ACCURATE})
+      for (simd_level_t level : all_levels) {
+        if (!MHASignal::simd_level_available(level))
+          continue;
+        // Lengths cover the vectorized loops and the scalar tails
+        for (unsigned n : {unsigned(in.size()), 1U, 3U, 7U, 13U}) {
+          std::vector<mha_real_t> expected(n), out(n);
+          f.vec(in.data(), expected.data(), n, accuracy,
+                simd_level_t::SCALAR);
+          f.vec(in.data(), out.data(), n, accuracy, level);
+          EXPECT_EQ(0, memcmp(expected.data(), out.data(),
+                              n * sizeof(mha_real_t)))
+            << f.name << " " << MHASignal::simd_level_name(level)
+            << " n=" << n;
+        }
+      }
+}
+
+TEST(vecmath, error_is_within_documented_ulp)
+{
+  const unsigned n = 100003U;
+  for (const function_t & f : functions) {
+    const auto in = arguments(f, n);
+    std::vector<mha_real_t> accurate(n), fast(n);
+    f.vec(in.data(), accurate.data(), n, vecmath_accuracy_t::ACCURATE,
+          MHASignal::simd_level());
+    f.vec(in.data(), fast.data(), n, vecmath_accuracy_t::FAST,
+          MHASignal::simd_level());
+    for (unsigned k = 0; k < n; ++k) {
+      const double y = f.reference(in[k]);
+      if (std::fabs(y) < std::numeric_limits<mha_real_t>::min())
+        continue;
+      ASSERT_LE(std::fabs(accurate[k] - y) / ulp(y), f.ulp_accurate)
+        << f.name << "(" << in[k] << ")";
+      ASSERT_LE(std::fabs(fast[k] - y) / ulp(y), f.ulp_fast)
+        << f.name << "(" << in[k] << ")";
+      ASSERT_LE(std::fabs(fast[k] - y), 1e-5 * std::fabs(y))
+        << f.name << "(" << in[k] << ")";
+    }
+  }
+}
+
+TEST(vecmath, special_values)
+{
+  const mha_real_t in[] = {0.0f, -1.0f, inf, qnan, -inf, 1e-40f};
+  mha_real_t out[6];
+  for (auto accuracy : {vecmath_accuracy_t::FAST,
+                        vecmath_accuracy_t::ACCURATE}) {
+    MHASignal::vec_log(in, out, 6U, accuracy);
+    EXPECT_EQ(-inf, out[0]);
+    EXPECT_TRUE(std::isnan(out[1]));
+    EXPECT_EQ(inf, out[2]);
+    EXPECT_TRUE(std::isnan(out[3]));
+    EXPECT_TRUE(std::isnan(out[4]));
+    // unless the processor treats denormals as zero (-ffast-math)
+    volatile mha_real_t denormal = in[5];
+    if (denormal * 2.0f != 0.0f) {
+      EXPECT_NEAR(std::log(1e-40), out[5], 1e-5);
+    }
+    MHASignal::vec_exp(in, out, 6U, accuracy);
+    EXPECT_EQ(1.0f, out[0]);
+    EXPECT_EQ(inf, out[2]);
+    EXPECT_TRUE(std::isnan(out[3]));
+    EXPECT_EQ(0.0f, out[4]);
+    EXPECT_EQ(1.0f, out[5]);
+    const mha_real_t big[] = {88.8f, -89.0f, 1e30f, -1e30f};
+    MHASignal::vec_exp(big, out, 4U, accuracy);
+    EXPECT_EQ(inf, out[0]);
+    EXPECT_EQ(0.0f, out[1]);
+    EXPECT_EQ(inf, out[2]);
+    EXPECT_EQ(0.0f, out[3]);
+    MHASignal::vec_sigmoid(big, out, 4U, accuracy);
+    EXPECT_EQ(1.0f, out[0]);
+    EXPECT_EQ(0.0f, out[1]);
+    EXPECT_EQ(1.0f, out[2]);
+    EXPECT_EQ(0.0f, out[3]);
+  }
+  // decibel values of powers of ten
+  const mha_real_t db[] = {0.0f, 20.0f, 40.0f, -20.0f};
+  MHASignal::vec_db2lin(db, out, 4U);
+  EXPECT_NEAR(1.0f, out[0], 1e-7f);
+  EXPECT_NEAR(10.0f, out[1], 2e-6f);
+  EXPECT_NEAR(100.0f, out[2], 2e-5f);
+  EXPECT_NEAR(0.1f, out[3], 2e-8f);
+}
+
+TEST(vecmath, pow_error_grows_with_exponent_times_log2)
+{
+  const unsigned n = 20001U;
+  for (mha_real_t p : {0.3f, 2.0f, -1.5f}) {
+    std::vector<mha_real_t> in(n), accurate(n), fast(n);
+    for (unsigned k = 0; k < n; ++k)
+      in[k] = std::exp2(-40.0 + 80.0 * (k + 0.5) / n);
+    MHASignal::vec_pow(in.data(), p, accurate.data(), n);
+    MHASignal::vec_pow(in.data(), p, fast.data(), n,
+                       vecmath_accuracy_t::FAST);
+    for (unsigned k = 0; k < n; ++k) {
+      const double y = std::pow(double(in[k]), double(p));
+      const double ylog2 = std::fabs(p * std::log2(double(in[k])));
+      ASSERT_LE(std::fabs(accurate[k] - y) / ulp(y), 3.0 + 0.7 * ylog2)
+        << "pow(" << in[k] << "," << p << ")";
+      ASSERT_LE(std::fabs(fast[k] - y) / ulp(y), 120.0 + 1.5 * ylog2)
+        << "pow(" << in[k] << "," << p << ")";
+    }
+  }
+  // the exponent 0 gives 1 for all bases, negative bases give NaN
+  const mha_real_t in[] = {0.0f, 2.0f, -2.0f, inf};
+  mha_real_t out[4];
+  MHASignal::vec_pow(in, 0.0f, out, 4U);
+  for (unsigned k = 0; k < 4U; ++k)
+    EXPECT_EQ(1.0f, out[k]);
+  MHASignal::vec_pow(in, 2.0f, out, 4U);
+  EXPECT_EQ(0.0f, out[0]);
+  EXPECT_NEAR(4.0f, out[1], 1e-6f);
+  EXPECT_TRUE(std::isnan(out[2]));
+  EXPECT_EQ(inf, out[3]);
+}
+
+TEST(vecmath, in_place_gives_same_result)
+{
+  for (const function_t & f : functions) {
+    auto in = arguments(f, 37U);
+    std::vector<mha_real_t> out(in.size());
+    f.vec(in.data(), out.data(), in.size(), vecmath_accuracy_t::ACCURATE,
+          MHASignal::simd_level());
+    f.vec(in.data(), in.data(), in.size(), vecmath_accuracy_t::ACCURATE,
+          MHASignal::simd_level());
+    EXPECT_EQ(0, memcmp(in.data(), out.data(), in.size() * sizeof(mha_real_t)))
+      << f.name;
+  }
+}
+
+TEST(vecmath, throws_for_unavailable_level)
+{
+  mha_real_t x = 1.0f;
+  for (simd_level_t level : all_levels) {
+    if (!MHASignal::simd_level_available(level)) {
+      EXPECT_THROW(MHASignal::vec_exp(&x, &x, 1U,
+                                      vecmath_accuracy_t::ACCURATE, level),
+                   MHA_Error);
+    }
+  }
+}
+
+TEST(vecmath, abs2db_and_scale_db_process_one_channel)
+{
+  MHASignal::spectrum_t s(129U, 2U);
+  for (unsigned k = 0; k < s.num_frames; ++k)
+    for (unsigned ch = 0; ch < 2U; ++ch)
+      s.value(k, ch) = mha_complex(std::cos(0.3f * k + ch) * (k + 1),
+                                   std::sin(0.2f * k) * (ch + 1));
+  MHASignal::spectrum_t original(s);
+  std::vector<mha_real_t> level(s.num_frames), gain(s.num_frames);
+  MHASignal::vec_abs2db(s, 1U, level.data());
+  for (unsigned k = 0; k < s.num_frames; ++k)
+    EXPECT_NEAR(10.0 * std::log10(abs2(s.value(k, 1U))), level[k], 1e-4)
+      << k;
+  for (unsigned k = 0; k < s.num_frames; ++k)
+    gain[k] = -0.1f * k;
+  MHASignal::vec_scale_db(s, 1U, gain.data());
+  for (unsigned k = 0; k < s.num_frames; ++k) {
+    const mha_real_t g = MHASignal::db2lin(gain[k]);
+    EXPECT_NEAR(original.value(k, 1U).re * g, s.value(k, 1U).re,
+                1e-6f * std::fabs(original.value(k, 1U).re) + 1e-30f);
+    EXPECT_NEAR(original.value(k, 1U).im * g, s.value(k, 1U).im,
+                1e-6f * std::fabs(original.value(k, 1U).im) + 1e-30f);
+    // channel 0 is untouched
+    EXPECT_EQ(original.value(k, 0U).re, s.value(k, 0U).re);
+    EXPECT_EQ(original.value(k, 0U).im, s.value(k, 0U).im);
+  }
+  EXPECT_THROW(MHASignal::vec_abs2db(s, 2U, level.data()), MHA_Error);
+  EXPECT_THROW(MHASignal::vec_scale_db(s, 2U, gain.data()), MHA_Error);
+}
+
+/*
+ * Local Variables:
+ * compile-command: "make -C .. unit-tests"
+ * coding: utf-8-unix
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
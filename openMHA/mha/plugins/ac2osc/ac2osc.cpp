@@ -14,18 +14,199 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #if defined(_WIN32) && !defined(WIN32)
 #define WIN32 _WIN32 // help liblo to detect windows
 #endif
 #include <lo/lo.h>
-#include <pthread.h>
-#include <sched.h>
 
 #include "mha_plugin.hh"
 #include "mha_os.h"
 #include "mha_events.h"
 #include "mha_defs.h"
+#include "mha_fifo.h"
+
+/** Sends snapshots of AC variables from a network thread.  The
+ * processing thread writes the snapshots into a lock-free FIFO, so
+ * that it never waits for the network, and then wakes up the network
+ * thread without locking a mutex.  Because the wakeup does not lock
+ * the mutex, it can coincide with the network thread going to sleep,
+ * the network thread therefore also wakes up every poll_interval_ms
+ * milliseconds, like MHARecorder::recording_service_t. */
+class osc_sender_t {
+public:
+    /** Starts the network thread.
+     * @param lo_addr   Destination, owned by the caller, must outlive
+     *                  this object.
+     * @param paths     OSC address of each AC variable.
+     * @param sizes     Number of floats of each AC variable.
+     * @param fifolen   Number of snapshots the FIFO can hold.
+     * @param dedup     Do not send variables that did not change since
+     *                  they were sent last.
+     * @param bundle_size Maximum size of an OSC bundle in bytes.  A
+     *                  variable larger than this is sent alone. */
+    osc_sender_t(lo_address lo_addr,
+                 const std::vector<std::string>& paths,
+                 const std::vector<unsigned>& sizes,
+                 unsigned fifolen, bool dedup, unsigned bundle_size);
+    /** Sends the remaining snapshots and stops the network thread. */
+    ~osc_sender_t();
+    /** Writes a snapshot of all AC variables into the FIFO, or drops
+     * it if the FIFO is full.  Called by the processing thread.
+     * @param acspace The AC variables, in the order of paths and sizes. */
+    void push(const MHA_AC::acspace2matrix_t& acspace);
+    /** Number of snapshots dropped because the FIFO was full. */
+    unsigned long long get_dropped() const {return dropped.load();}
+    /** Number of OSC bundles sent. */
+    unsigned long long get_bundles() const {return bundles.load();}
+    /** Upper limit for the delay of a wakeup in milliseconds. */
+    static constexpr unsigned poll_interval_ms = 50U;
+private:
+    /** Network thread: sends all snapshots waiting in the FIFO,
+     * then sleeps until woken up, until close is requested. */
+    void send_thread();
+    /** Sends the snapshot in buffer, one bundle for up to bundle_size
+     * bytes of messages. */
+    void send_snapshot();
+    lo_address lo_addr;
+    std::vector<std::string> paths;
+    std::vector<unsigned> sizes;
+    /** Number of floats in one snapshot */
+    unsigned snapshot_size;
+    const bool dedup;
+    const unsigned bundle_size;
+    mha_fifo_lf_t<float> fifo;
+    /** Snapshot read by the network thread */
+    std::vector<float> buffer;
+    /** Last sent values, for deduplication */
+    std::vector<float> sent;
+    /** Whether each variable has been sent at least once */
+    std::vector<bool> ever_sent;
+    std::atomic<unsigned long long> dropped;
+    std::atomic<unsigned long long> bundles;
+    std::atomic<bool> close_session;
+    /** Owned by the network thread while it is not waiting */
+    std::mutex mutex;
+    /** Signals new snapshots or the close request to the network thread */
+    std::condition_variable wakeup;
+    /** Set by push(), cleared by the network thread */
+    std::atomic<bool> pending;
+    std::thread thread;
+};
+
+osc_sender_t::osc_sender_t(lo_address lo_addr_,
+                           const std::vector<std::string>& paths_,
+                           const std::vector<unsigned>& sizes_,
+                           unsigned fifolen, bool dedup_, unsigned bundle_size_)
+    : lo_addr(lo_addr_),
+      paths(paths_),
+      sizes(sizes_),
+      snapshot_size([&](){
+          unsigned n = 0U;
+          for(auto size : sizes_)
+              n += size;
+          return n;}()),
+      dedup(dedup_),
+      bundle_size(bundle_size_),
+      fifo(std::max(snapshot_size, 1U) * fifolen),
+      buffer(snapshot_size),
+      sent(snapshot_size),
+      ever_sent(sizes_.size(), false),
+      dropped(0U),
+      bundles(0U),
+      close_session(false),
+      pending(false)
+{
+    thread = std::thread(&osc_sender_t::send_thread, this);
+}
+
+osc_sender_t::~osc_sender_t()
+{
+    {
+        // Not real-time critical: lock, so that the wakeup is not lost
+        std::lock_guard<std::mutex> lock(mutex);
+        close_session = true;
+    }
+    wakeup.notify_one();
+    thread.join();
+}
+
+void osc_sender_t::push(const MHA_AC::acspace2matrix_t& acspace)
+{
+    if( fifo.get_available_space() < snapshot_size ){
+        ++dropped;
+        return;
+    }
+    for(unsigned int mat=0;mat < acspace.size(); mat++)
+        fifo.write(acspace[mat].get_rdata(), sizes[mat]);
+    pending = true;
+    wakeup.notify_one();
+}
+
+void osc_sender_t::send_thread()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;){
+        // Check before sending, so that all snapshots written before
+        // the close request are sent.
+        const bool closing = close_session.load();
+        while( snapshot_size && fifo.get_fill_count() >= snapshot_size ){
+            fifo.read(buffer.data(), snapshot_size);
+            send_snapshot();
+        }
+        if( closing )
+            return;
+        if( !pending.exchange(false) ){
+            wakeup.wait_for(lock, std::chrono::milliseconds(poll_interval_ms));
+            pending = false;
+        }
+    }
+}
+
+void osc_sender_t::send_snapshot()
+{
+    lo_bundle bundle = nullptr;
+    size_t bundle_length = 0U;
+    auto flush = [&](){
+        if( bundle ){
+            lo_send_bundle(lo_addr, bundle);
+            lo_bundle_free_recursive(bundle);
+            bundle = nullptr;
+            bundle_length = 0U;
+            ++bundles;
+        }
+    };
+    unsigned offset = 0U;
+    for(unsigned int mat=0;mat < sizes.size(); offset += sizes[mat++]){
+        const float* data(buffer.data() + offset);
+        const size_t bytes(sizes[mat] * sizeof(float));
+        if( dedup && ever_sent[mat] &&
+            !memcmp(data, sent.data() + offset, bytes) )
+            continue;
+        lo_message msg(lo_message_new());
+        for(unsigned int k=0;k<sizes[mat];k++)
+            lo_message_add_float(msg,data[k]);
+        // Bundle element: 4 bytes size field plus message
+        const size_t length(lo_message_length(msg, paths[mat].c_str()) + 4U);
+        if( bundle_length + length > bundle_size )
+            flush();
+        if( !bundle )
+            bundle = lo_bundle_new(LO_TT_IMMEDIATE);
+        lo_bundle_add_message(bundle, paths[mat].c_str(), msg);
+        bundle_length += length;
+        memcpy(sent.data() + offset, data, bytes);
+        ever_sent[mat] = true;
+    }
+    flush();
+}
+
 /** Plugin class of the ac2osc plugin. */
 class ac2osc_t : public MHAPlugin::plugin_t<int>
 {
@@ -37,16 +218,17 @@ public:
     mha_wave_t* process(mha_wave_t* s) {process();return s;};
     /** Processing fct for spectra. Calls process(void). */
     mha_spec_t* process(mha_spec_t* s) {process();return s;};
-    /** Process function. Checks once if the plugin is run in a
-     * real-time thread and throws if rt_strict is true,
-     * sends osc messages according to config. */
+    /** Process function.  Takes a snapshot of the AC variables
+     * according to config and passes it to the network thread. */
     void process();
-    /** Release frees osc related memory, does cleanup*/
+    /** Release stops the network thread, frees osc related memory,
+     * does cleanup*/
     void release();
 private:
-    void send_osc_float();
     /** Start/Stop sending of messages */
     void update_mode();
+    /** Copy the statistics of the network thread to the monitors */
+    void query_statistics();
     /** OSC server host name */
     MHAParser::string_t host;
     /** OSC server port */
@@ -59,16 +241,29 @@ private:
     MHAParser::kw_t mode;
     /** number of frames to skip after sending */
     MHAParser::int_t skip;
-    /** abort if used in real-time thread? */
+    /** maximum number of snapshots per second */
+    MHAParser::float_t rate;
+    /** send only changed variables? */
+    MHAParser::bool_t dedup;
+    /** maximum size of an OSC bundle */
+    MHAParser::int_t bundle_size;
+    /** number of snapshots waiting for the network thread */
+    MHAParser::int_t fifolen;
+    /** abort if used in real-time thread? Without effect. */
     MHAParser::bool_t rt_strict;
+    /** number of snapshots dropped */
+    MHAParser::int_mon_t dropped;
+    /** number of OSC bundles sent */
+    MHAParser::int_mon_t bundles;
     std::unique_ptr<MHA_AC::acspace2matrix_t> acspace;
+    std::unique_ptr<osc_sender_t> sender;
     MHAEvents::patchbay_t<ac2osc_t> patchbay;
-    bool b_record;
-    uint8_t* rtmem;
+    std::atomic<bool> b_record;
     float framerate;
     int skipcnt;
+    /** Time in seconds until the next snapshot is due when rate > 0 */
+    float rate_timer;
     lo_address lo_addr;
-    bool is_first_run;
 };
 
 ac2osc_t::ac2osc_t(MHA_AC::algo_comm_t & iac, const std::string &)
@@ -79,11 +274,23 @@ ac2osc_t::ac2osc_t(MHA_AC::algo_comm_t & iac, const std::string &)
     vars("List of AC variables to be saved, empty for all. A colon may be used to specify target address.","[]"),
     mode("record mode","pause","[rec pause]"),
     skip("number of frames to skip after sending","0","[0,]"),
-    rt_strict("abort if used in real-time thread?","yes"),
+    rate("maximum number of snapshots of the AC variables sent per second,\n"
+         "0 for no limit","0","[0,]"),
+    dedup("send only AC variables that changed since they were last sent?","no"),
+    bundle_size("maximum size in bytes of an OSC bundle.  Each snapshot is sent as\n"
+                "one or more OSC bundles; a larger AC variable is sent alone.",
+                "8192","[1,]"),
+    fifolen("number of snapshots that can wait for sending.\n"
+            "Snapshots taken while the buffer is full are dropped.","64","[1,]"),
+    rt_strict("abort if used in real-time thread?\n"
+              "Without effect, the OSC messages are always sent from a separate thread.",
+              "yes"),
+    dropped("number of snapshots dropped because the network thread did not keep up"),
+    bundles("number of OSC bundles sent"),
     b_record(false),
-    rtmem(new uint8_t[0x100000]),
     skipcnt(0),
-    is_first_run(true)
+    rate_timer(0),
+    lo_addr(nullptr)
 {
     insert_member(host);
     insert_member(port);
@@ -91,9 +298,17 @@ ac2osc_t::ac2osc_t(MHA_AC::algo_comm_t & iac, const std::string &)
     insert_member(vars);
     insert_member(mode);
     insert_member(skip);
+    insert_member(rate);
+    insert_member(dedup);
+    insert_member(bundle_size);
+    insert_member(fifolen);
     insert_member(rt_strict);
+    insert_member(dropped);
+    insert_member(bundles);
 
     patchbay.connect(&(mode.writeaccess),this,&ac2osc_t::update_mode);
+    patchbay.connect(&dropped.prereadaccess,this,&ac2osc_t::query_statistics);
+    patchbay.connect(&bundles.prereadaccess,this,&ac2osc_t::query_statistics);
 }
 
 void ac2osc_t::prepare(mhaconfig_t& cf)
@@ -102,14 +317,28 @@ void ac2osc_t::prepare(mhaconfig_t& cf)
         lo_addr = nullptr;
         acspace = std::make_unique<MHA_AC::acspace2matrix_t>(ac,vars.data);
     framerate = cf.srate / cf.fragsize;
+    skipcnt = 0;
+    rate_timer = 0;
     lo_addr = lo_address_new( host.data.c_str(), port.data.c_str() );
     lo_address_set_ttl(lo_addr, ttl.data );
     lo_send( lo_addr, "/mhastate","s","prepared");
+    std::vector<std::string> paths;
+    std::vector<unsigned> sizes;
+    for(unsigned int mat=0;mat < acspace->size(); mat++){
+        paths.push_back((*acspace)[mat].getusername());
+        sizes.push_back((*acspace)[mat].get_nelements());
+    }
+    sender = std::make_unique<osc_sender_t>(lo_addr, paths, sizes,
+                                            fifolen.data, dedup.data,
+                                            bundle_size.data);
     host.setlock(true);
     port.setlock(true);
     ttl.setlock(true);
     vars.setlock(true);
     mode.setlock(true);
+    dedup.setlock(true);
+    bundle_size.setlock(true);
+    fifolen.setlock(true);
     rt_strict.setlock(true);
     }
     catch(MHA_Error& e){
@@ -118,6 +347,9 @@ void ac2osc_t::prepare(mhaconfig_t& cf)
         ttl.setlock(false);
         vars.setlock(false);
         mode.setlock(false);
+        dedup.setlock(false);
+        bundle_size.setlock(false);
+        fifolen.setlock(false);
         rt_strict.setlock(false);
         if (lo_addr){
             lo_send( lo_addr, "/mhastate","s","unprepared");
@@ -129,7 +361,8 @@ void ac2osc_t::prepare(mhaconfig_t& cf)
 
 void ac2osc_t::release()
 {
-    is_first_run=true;
+    // Joins the network thread, which sends the remaining snapshots
+    sender.reset();
     lo_send( lo_addr, "/mhastate","s","released");
     lo_address_free( lo_addr );
     host.setlock(false);
@@ -137,31 +370,25 @@ void ac2osc_t::release()
     ttl.setlock(false);
     vars.setlock(false);
     mode.setlock(false);
+    dedup.setlock(false);
+    bundle_size.setlock(false);
+    fifolen.setlock(false);
     rt_strict.setlock(false);
 }
 
 void ac2osc_t::process()
 {
-    if(is_first_run){
-        if(rt_strict.data){
-            is_first_run=false;
-            pthread_t this_thread=pthread_self();
-            int policy=0;
-            struct sched_param params;
-            auto ret=pthread_getschedparam(this_thread,&policy,&params);
-            if(ret != 0)
-                throw MHA_Error(__FILE__,__LINE__,"could not retrieve"
-                                " thread scheduling parameters!");
-            if(policy == SCHED_FIFO or policy==SCHED_RR)
-                throw MHA_Error(__FILE__,__LINE__,"ac2osc used in"
-                                " real-time thread with"
-                                " rt-strict=true!");
-        }
-    }
     acspace->update();
     if( b_record ){
+        if( rate.data > 0 ){
+            // Decimate to the configured rate
+            rate_timer -= 1.0f / framerate;
+            if( rate_timer > 0 )
+                return;
+            rate_timer = std::max(rate_timer + 1.0f / rate.data, 0.0f);
+        }
         if( !skipcnt ){
-            send_osc_float();
+            sender->push(*acspace);
             skipcnt = skip.data;
         }else{
             skipcnt--;
@@ -169,19 +396,6 @@ void ac2osc_t::process()
     }
 }
 
-void ac2osc_t::send_osc_float()
-{
-    for(unsigned int mat=0;mat < acspace->size(); mat++){
-        lo_message msg(lo_message_new());
-        unsigned int N((*acspace)[mat].get_nelements());
-        const float* data((*acspace)[mat].get_rdata());
-        for(unsigned int k=0;k<N;k++)
-            lo_message_add_float(msg,data[k]);
-        lo_send_message(lo_addr,(*acspace)[mat].getusername().c_str(),msg);
-        lo_message_free(msg);
-    }
-}
-
 void ac2osc_t::update_mode()
 {
     switch( mode.data.get_index() ){
@@ -196,6 +410,14 @@ void ac2osc_t::update_mode()
     };
 }
 
+void ac2osc_t::query_statistics()
+{
+    if( sender ){
+        dropped.data = sender->get_dropped();
+        bundles.data = sender->get_bundles();
+    }
+}
+
 MHAPLUGIN_CALLBACKS(ac2osc,ac2osc_t,wave,wave)
 MHAPLUGIN_PROC_CALLBACK(ac2osc,ac2osc_t,spec,spec)
 MHAPLUGIN_DOCUMENTATION\
@@ -210,7 +432,25 @@ MHAPLUGIN_DOCUMENTATION\
  " variable, a target path can be specified using the"
  " colon delimiter, e.g.:"
  "\\begin{verbatim}vars = [level:/mhalevels]"
- " \\end{verbatim}")
+ " \\end{verbatim}"
+ "\n\n"
+ "The signal processing thread only copies the selected AC variables"
+ " into a preallocated lock-free buffer, which holds up to"
+ " \\texttt{fifolen} snapshots.  A separate network thread sends the"
+ " snapshots, therefore the plugin can be used in real-time signal"
+ " processing, and \\texttt{rt\\_strict} has no effect any more."
+ " If the network thread does not keep up, snapshots are dropped and"
+ " counted in \\texttt{dropped}."
+ " All variables of one snapshot are combined into OSC bundles of at"
+ " most \\texttt{bundle\\_size} bytes."
+ " The number of snapshots can be reduced with \\texttt{skip} (frames"
+ " to skip after each snapshot) and \\texttt{rate} (maximum number of"
+ " snapshots per second)."
+ " With \\texttt{dedup = yes}, an AC variable is only sent when its"
+ " value differs from the value sent last, which saves network"
+ " bandwidth for slowly changing variables, e.g. to update a GUI with"
+ " the state of a beamformer in every frame.  A receiver that starts"
+ " later will not receive a variable until it changes.")
 
 /*
  * Local variables:
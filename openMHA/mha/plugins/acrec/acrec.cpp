@@ -16,7 +16,7 @@
 
 #include "acrec.hh"
 #include <ctime>
-#include <atomic>
+#include <limits>
 #include <vector>
 
 using namespace plugins::hoertech::acrec;
@@ -40,6 +40,7 @@ acrec_t::acrec_t(MHA_AC::algo_comm_t & iac, const std::string & )
     insert_member(use_date);
     insert_member(varname);
     insert_member(record);
+    insert_member(dropped);
     patchbay.connect(&record.writeaccess,this,&acrec_t::start_new_session);
 }
 
@@ -48,6 +49,9 @@ template <class mha_signal_t> mha_signal_t* acrec_t::process(mha_signal_t* s)
     poll_config();
     cv = ac.get_var(cfg->get_varname());
     cfg->process(&cv);
+    dropped.data = static_cast<int>
+        (std::min<unsigned long long>(cfg->get_num_dropped(),
+                                      std::numeric_limits<int>::max()));
     return s;
 }
 
@@ -78,43 +82,48 @@ void acrec_t::start_new_session()
                                prefix.data, use_date.data, varname.data));
 }
 
-void acwriter_t::create_datafile(const std::string& prefix, bool use_date)
+std::string acwriter_t::datafile_name(const std::string& prefix, bool use_date)
+{
+    if( use_date )
+        return prefix+"-"+to_iso8601(std::time(nullptr))+".dat";
+    return prefix+".dat";
+}
+
+datafile_t::datafile_t(unsigned fifosize, unsigned minwrite,
+                       const std::string& fname)
+    : MHARecorder::fifo_sink_t<double>(fifosize, minwrite)
 {
-    std::string fname;
-    if( use_date ){
-        fname = prefix+"-"+to_iso8601(std::time(nullptr))+".dat";
-    }
-    else{
-        fname=prefix+".dat";
-    }
     outfile=std::fstream(fname, std::ios::out | std::ios::binary);
     if( !outfile.good() )
         throw MHA_Error(__FILE__,__LINE__,"Unable to create file %s.",fname.c_str());
+    start();
+}
+
+void datafile_t::close()
+{
+    stop();
+    if (outfile.is_open())
+        outfile.close();
+}
+
+void datafile_t::write_frames(const double * data, unsigned frames)
+{
+    if (outfile.good())
+        outfile.write(reinterpret_cast<const char *>(data),
+                      frames*get_frame_size()*sizeof(double));
 }
 
 acwriter_t::acwriter_t(bool active,unsigned fifosize,unsigned minwrite,
                        const std::string& prefix, bool use_date,
                        const std::string& varname)
-    : close_session(false),
-      active(active),
-      disk_write_threshold_min_num_samples(minwrite),
-      varname(varname)
+    : varname(varname)
 {
     if (active) {
-        if (disk_write_threshold_min_num_samples >= fifosize) {
-            throw MHA_Error(__FILE__,__LINE__,
-                            "minwrite must be less than fifosize "
-                            "(minwrite: %u, fifosize: %u)",
-                            disk_write_threshold_min_num_samples,
-                            fifosize);
-        }
-        create_datafile(prefix, use_date);
-        diskbuffer = std::make_unique<output_type[]>(fifosize);
-        fifo = std::make_unique<mha_fifo_lf_t<output_type> >(fifosize);
-        writethread=std::thread(&acwriter_t::write_thread, this);
+        datafile = std::make_unique<datafile_t>
+            (fifosize, minwrite, datafile_name(prefix, use_date));
     } else {
         // When inactive, sizes do not need to be checked, no output file,
-        // no fifo, no disk buffer, and no thread needs to be created.
+        // no fifo, and no disk buffer need to be created.
     }
     // std::string implementations may allocate memory on first invocation
     // of c_str() after a change.  Avoid allocation during processing:
@@ -123,11 +132,14 @@ acwriter_t::acwriter_t(bool active,unsigned fifosize,unsigned minwrite,
 
 void acwriter_t::process(MHA_AC::comm_var_t* s)
 {
-    if( active ) {
+    if( datafile ) {
         if (not is_num_channels_known) {
             num_channels = s->stride;
             is_complex = (s->data_type == MHA_AC_MHACOMPLEX);
             is_num_channels_known = true;
+            // Allow saving AC vars with stride zero, interpret as stride one.
+            datafile->set_frame_size(std::max(num_channels, 1U) *
+                                     (is_complex ? 2U : 1U));
         }
         if (num_channels != s->stride) {
             throw MHA_Error(__FILE__,__LINE__,"Number of channels of AC"
@@ -144,12 +156,9 @@ void acwriter_t::process(MHA_AC::comm_var_t* s)
         // We save complex values as alternating real and imaginary part, i.e.
         // each complex is stored as two values.
         const unsigned complex_factor = is_complex ? 2U : 1U;
-        // Allow saving AC vars with stride zero, interpret as stride one.
-        const unsigned num_ch_effective =
-            std::max(num_channels, 1U) * complex_factor;
+        // Available space is a multiple of the frame size of the data file
         const unsigned number_of_values_to_push_to_fifo =
-            std::min(fifo->get_available_space() / num_ch_effective
-                     * num_ch_effective, // only write multiples of num_channels
+            std::min(datafile->get_available_space(),
                      s->num_entries * complex_factor);
         constexpr unsigned PUSH_ARRAY_SIZE = 32U;
         static_assert(PUSH_ARRAY_SIZE % 2U == 0U,
@@ -186,49 +195,18 @@ void acwriter_t::process(MHA_AC::comm_var_t* s)
                                     "Data type not supported: %u",
                                     s->data_type);
                 }
-            fifo->write(value_to_push, num_values_to_copy);
+            datafile->write(value_to_push, num_values_to_copy);
         }
+        datafile->commit(s->num_entries * complex_factor
+                         - number_of_values_to_push_to_fifo);
     }
 }
 
 void acwriter_t::exit_request(){
-    if(!close_session.load()){
-        close_session.store(true);
-        if( active ){
-            writethread.join();
-            outfile.close();
-            // Deallocate disk buffer.
-            diskbuffer = nullptr;
-            // We cannot deallocate the fifo here because process() may still
-            // use it concurrently.  Will be deallocated by destructor.
-        }
-    }
-    return;
-}
-
-void acwriter_t::write_thread()
-{
-    auto flush = // Writes fifo content to disk.
-        [&]()
-        {
-            // Allow saving AC vars with stride zero, interpret as stride one.
-            unsigned num_ch_effective =
-                std::max(num_channels, 1U) * (is_complex ? 2U : 1U);
-            unsigned frames = fifo->get_fill_count() / num_ch_effective;
-            if (outfile.good() && frames > 0U) {
-                fifo->read(diskbuffer.get(),frames*num_ch_effective);
-                outfile.write(reinterpret_cast<const char *>(diskbuffer.get()),
-                              frames*num_ch_effective*sizeof(output_type));
-            }
-        };
-
-    while(!close_session.load()){
-        mha_msleep(1);
-        if (fifo->get_fill_count() > disk_write_threshold_min_num_samples) {
-            flush();
-        }
-    }
-    flush();
+    // We cannot deallocate the data file here because process() may still
+    // use its fifo concurrently.  Will be deallocated by destructor.
+    if( datafile )
+        datafile->close();
 }
 
 MHAPLUGIN_CALLBACKS(acrec,acrec_t,wave,wave)
@@ -261,7 +239,11 @@ MHAPLUGIN_DOCUMENTATION\
  " disk in the same time, then some of the incoming data will have to be"
  " discarded before writing to disk continues.\n"
  " This may e.g. happen with slow disks like network drives or SD cards, or"
- " with very high data rates.\n\n"
+ " with very high data rates.  The number of discarded values is shown in"
+ " the monitor variable \"dropped\".\n\n"
+ " The data is written to disk by a writer thread shared by all recorder"
+ " plugins, which is woken up by the signal processing when more than"
+ " \"minwrite\" values are waiting in the fifo.\n\n"
  "The \"fifolen\" and \"minwrite\" variables control the behaviour of the fifo buffer and should usually remain unchanged.")
 
 /*
@@ -16,24 +16,50 @@
 
 
 #include "mha_plugin.hh"
-#include "mha_fifo.h"
-#include <thread>
+#include "mha_recorder.hh"
 #include <fstream>
 
 namespace plugins { namespace hoertech { namespace acrec {
+/// Output file of acwriter_t.  Receives the data through the fifo of the
+/// base class and writes it to disk in the writer thread of the shared
+/// recording service.
+class datafile_t : public MHARecorder::fifo_sink_t<double> {
+public:
+    /// Create output file.
+    /// @param fifosize Capacity of the fifo pipeline and of the disk buffer.
+    /// @param minwrite Wait for a fifo fill count of more than minwrite
+    ///                 doubles before writing the contents of the fifo to disk.
+    /// @param fname    Name of the output file.
+    /// @throw MHA_Error if the file cannot be created or if minwrite is not
+    ///                  less than fifosize.
+    datafile_t(unsigned fifosize, unsigned minwrite, const std::string& fname);
+    /// Closes the file if not closed before.
+    ~datafile_t() {close();}
+    /// Unregister from the recording service, write the remaining data
+    /// to disk, and close the file.  Idempotent.
+    void close();
+protected:
+    /// Write frames of doubles to the output file.
+    void write_frames(const double * data, unsigned frames) override;
+private:
+    /// Ouput file.
+    std::fstream outfile;
+};
+
 /// acwriter_t decouples signal processing from writing to disk.
 /// Data arriving in numeric AC variables is converted to data type double,
 /// placed into a fifo pipeline to transport the data from the signal
-/// processing thread to the disk writing thread, and finally written to
-/// disk in chunks of at least minwrite numbers.  All numbers are written to
-/// disk as binary doubles (8 bytes) in host byte order.
+/// processing thread to the writer thread of the shared recording service,
+/// and finally written to disk in chunks of at least minwrite numbers.
+/// All numbers are written to disk as binary doubles (8 bytes) in host
+/// byte order.
 class acwriter_t {
 public:
     /// The numeric data type used for outputting the data to disk.
     typedef double output_type;
-    /// Constructor allocates fifo and disk output buffer.  It spawns a new
-    /// thread for writing data to disk when active==true.  In order to
-    /// terminate the thread, method exit_request <b>must</b> be called
+    /// Constructor creates the output file and registers it with the
+    /// shared recording service when active==true.  In order to
+    /// flush and close the file, method exit_request <b>must</b> be called
     /// before this object is destroyed.
     /// @param active Only write data to disk when this is true.
     /// @param fifosize Capacity of both the fifo pipeline and of the
@@ -52,44 +78,28 @@ public:
     acwriter_t(bool active, unsigned fifosize, unsigned minwrite,
                const std::string& prefix, bool use_date,
                const std::string& varname);
-    /// Deallocates memory but does not terminate the write_thread.
-    /// write_thread must be terminated before the destructor executes by
-    /// calling exit_request.
+    /// Deallocates memory.  exit_request must have been called before.
     ~acwriter_t() = default;
     /// Place the data present in the algorithm communication variable into the
     /// fifo for output to disk.
     void process(MHA_AC::comm_var_t*);
-    /// Terminate output thread.
+    /// Write remaining data to disk and close the output file.
     void exit_request();
     /// getter for ac variable name @return name as char* as needed by get_var
     const std::string & get_varname() const {return varname;}
+    /// Number of values that have been discarded because the fifo was full.
+    /// Only to be called by the signal processing thread.
+    unsigned long long get_num_dropped() const
+    {return datafile ? datafile->get_num_dropped() : 0U;}
 private:
-    /// Main method of the disk writer thread.  Periodically wakes up and checks
-    /// if data needs to be written to disk.
-    void write_thread();
-    /// Open data file for output. Combine prefix, date, and file name extension
+    /// Create file name from prefix, date, and file name extension
     /// @param prefix   Path and start of output file name.  Will be extended
     ///                 with file name extension ".dat".
     /// @param use_date When true, the current date and time will be appended
     ///                 to the output file name before the file name extension.
-    void create_datafile(const std::string& prefix, bool use_date);
-    /// cross-thread-synchronization.  write_thread() terminates after this is
-    /// set to true by exit_request().
-    std::atomic<bool> close_session;
-    /// The writer thread and the output file will only be created when active
-    /// is true.
-    const bool active;
-    /// Fifo for decoupling signal processing thread from disk writer thread.
-    std::unique_ptr<mha_fifo_lf_t<output_type> > fifo;
-    /// Minimum number of samples that need to be waiting in the fifo before
-    /// the disk writer thread writes them to disk.
-    const unsigned int disk_write_threshold_min_num_samples;
-    /// The thread that writes to disk.
-    std::thread writethread;
-    /// Intermediate buffer to receive data from fifo and store on disk.
-    std::unique_ptr<output_type[]> diskbuffer;
-    /// Ouput file.
-    std::fstream outfile;
+    static std::string datafile_name(const std::string& prefix, bool use_date);
+    /// The output file.  Only created when active is true.
+    std::unique_ptr<datafile_t> datafile;
     /// Number of channels of AC variable using stride.  If the number of
     /// channels changes during processing, an exception is thrown.
     unsigned num_channels = 0U;
@@ -136,6 +146,9 @@ private:
         {"Name of AC variable",""};
     MHAParser::bool_t use_date =
         {"Use date and time (yes), or only prefix (no)","yes"};
+    MHAParser::int_mon_t dropped =
+        {"Number of values discarded in the current recording session\n"
+         "because the fifo was full"};
     MHAEvents::patchbay_t<acrec_t> patchbay;
     MHA_AC::comm_var_t cv;
     MHA_AC::algo_comm_t & ac;
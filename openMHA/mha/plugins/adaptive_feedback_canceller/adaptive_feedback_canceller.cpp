@@ -26,7 +26,14 @@
  * 'Feedback control in hearing aids'. */
 
 #include "adaptive_feedback_canceller.h"
+#include "mha_simd.hh"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #define PATCH_VAR(var) patchbay.connect(&var.valuechanged, this, &adaptive_feedback_canceller::update_cfg)
 #define INSERT_PATCH(var) insert_member(var); PATCH_VAR(var)
@@ -38,10 +45,265 @@ std::vector<int> calcDelayValues(const std::vector<int>& raw_latency, const unsi
     return delay_values;
 }
 
+inline void make_friendly_number_by_limiting( double& x )
+{
+    if( x > 1.0e20 )
+        x = 1.0e20;
+    if( x < -1.0e20 )
+        x = -1.0e20;
+}
+
+inline void make_friendly_number_by_limiting( float& x )
+{
+    if( x > 1.0e20f )
+        x = 1.0e20f;
+    if( x < -1.0e20f )
+        x = -1.0e20f;
+}
+
+afc_frequency_domain_t::afc_frequency_domain_t(unsigned ntaps_,
+                                               unsigned frames_,
+                                               unsigned channels_,
+                                               bool update_thread)
+    : ntaps(ntaps_),
+      frames(frames_),
+      channels(channels_),
+      partitions((ntaps + frames - 1U) / frames),
+      slots(partitions),
+      fft_filter(mha_fft_new(2U * frames, channels)),
+      fft_update(mha_fft_new(2U * frames, channels)),
+      ls2(2U * frames, channels),
+      head(0U),
+      active(0U),
+      acc_filter(frames + 1U, channels),
+      acc_update(frames + 1U, channels),
+      wave_filter(2U * frames, channels),
+      wave_update(2U * frames, channels),
+      err2(2U * frames, channels),
+      E(frames + 1U, channels),
+      job_head(0U),
+      taps(ntaps, channels),
+      taps_out(ntaps, channels),
+      ls_sq(ntaps, channels),
+      ls_sq_pos(0U),
+      sliding_power(channels, 0.0),
+      current_power(frames, channels),
+      update_time_(0.0f),
+      update_time_job(0.0f),
+      skipped_updates_(0U),
+      update_ready(false),
+      job_pending(false),
+      exit_request(false),
+      processing_priority_known(false),
+      processing_priority_applied(false),
+      processing_policy(0),
+      processing_priority(0)
+{
+    X.reserve(slots);
+    for (unsigned k = 0; k < slots; ++k)
+        X.emplace_back(frames + 1U, channels);
+    if (update_thread) {
+        X_job.reserve(partitions);
+        for (unsigned p = 0; p < partitions; ++p)
+            X_job.emplace_back(frames + 1U, channels);
+    }
+    for (auto & w : W) {
+        w.reserve(partitions);
+        for (unsigned p = 0; p < partitions; ++p)
+            w.emplace_back(frames + 1U, channels);
+    }
+    if (update_thread)
+        thread = std::thread(&afc_frequency_domain_t::thread_main, this);
+}
+
+afc_frequency_domain_t::~afc_frequency_domain_t()
+{
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            exit_request = true;
+        }
+        wakeup.notify_all();
+        thread.join();
+    }
+    mha_fft_free(fft_filter);
+    mha_fft_free(fft_update);
+}
+
+void afc_frequency_domain_t::thread_main()
+{
+    for (;;) {
+        if (!job_pending.load(std::memory_order_acquire)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait_for(lock, poll_interval, [this]{
+                return job_pending.load() || exit_request.load();
+            });
+        }
+        if (exit_request.load())
+            return;
+        if (!job_pending.load(std::memory_order_acquire))
+            continue;
+        follow_processing_priority();
+        update();
+        update_ready = true;
+        job_pending.store(false, std::memory_order_release);
+    }
+}
+
+void afc_frequency_domain_t::follow_processing_priority()
+{
+    if (processing_priority_applied ||
+        !processing_priority_known.load(std::memory_order_acquire))
+        return;
+    processing_priority_applied = true;
+#ifndef _WIN32
+    if (processing_policy == SCHED_FIFO || processing_policy == SCHED_RR) {
+        struct sched_param param;
+        param.sched_priority =
+            std::max(processing_priority - 1,
+                     sched_get_priority_min(processing_policy));
+        // Without permission, the update keeps the default scheduling
+        pthread_setschedparam(pthread_self(), processing_policy, &param);
+    }
+#endif
+}
+
+void afc_frequency_domain_t::adapt(const mha_wave_t & ERRsig,
+                                   mha_real_t stepsize, mha_real_t min_const,
+                                   MHASignal::waveform_t * estim_err)
+{
+    /* With the update thread, this block is only used for adaptation
+     * if the update thread has finished the previous update */
+    bool post_job = true;
+    if (thread.joinable()) {
+        if (!processing_priority_known.load(std::memory_order_relaxed)) {
+#ifndef _WIN32
+            struct sched_param param;
+            if (pthread_getschedparam(pthread_self(), &processing_policy,
+                                      &param) == 0)
+                processing_priority = param.sched_priority;
+            else
+                processing_policy = SCHED_OTHER;
+#endif
+            processing_priority_known.store(true, std::memory_order_release);
+        }
+        if (job_pending.load(std::memory_order_acquire)) {
+            post_job = false;
+            ++skipped_updates_;
+        }
+    }
+    auto collect = [this]() {
+        if (update_ready) {
+            active.store(1U - active.load(std::memory_order_relaxed),
+                         std::memory_order_release);
+            taps_out.copy(taps);
+            update_time_ = update_time_job;
+            update_ready = false;
+        }
+    };
+    if (post_job)
+        collect();
+    /* Normalized error, the loudspeaker signal aligned with it went
+     * through filter() in the previous block.  The power is averaged
+     * over the block: a normalization varying within the block would
+     * leak through the rounding errors of the FFT into the gradient */
+    for (unsigned ch = 0; ch < channels; ++ch) {
+        double power = 0.0;
+        for (unsigned kf = 0; kf < frames; ++kf)
+            power += current_power.value(kf, ch);
+        const mha_real_t gain = stepsize / (power / frames + min_const);
+        for (unsigned kf = 0; kf < frames; ++kf) {
+            const mha_real_t err = gain * value(ERRsig, kf, ch);
+            if (post_job)
+                err2.value(frames + kf, ch) = err;
+            if (estim_err)
+                estim_err->value(kf, ch) = err;
+        }
+    }
+    if (!post_job)
+        return;
+    job_head = head;
+    if (thread.joinable()) {
+        for (unsigned p = 0; p < partitions; ++p)
+            X_job[p].copy(X[slot(job_head, p)]);
+        job_pending.store(true, std::memory_order_release);
+        wakeup.notify_one();
+    } else {
+        update();
+        update_ready = true;
+        collect();
+    }
+}
+
+void afc_frequency_domain_t::update()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const unsigned bins = (frames + 1U) * channels;
+    std::vector<MHASignal::spectrum_t> & W_next =
+        W[1U - active.load(std::memory_order_acquire)];
+    mha_fft_wave2spec_scale(fft_update, &err2, &E);
+    for (unsigned p = 0; p < partitions; ++p) {
+        /* Constrained gradient: only the first half of the circular
+         * correlation of the error with the loudspeaker signal is used */
+        clear(acc_update);
+        const mha_spec_t & X_p =
+            X_job.empty() ? X[slot(job_head, p)] : X_job[p];
+        MHASignal::conj_mac(acc_update.buf, X_p.buf, E.buf, bins);
+        mha_fft_spec2wave_scale(fft_update, &acc_update, &wave_update);
+        const unsigned partition_taps = std::min(frames, ntaps - p * frames);
+        mha_real_t * f = taps.buf + p * frames * channels;
+        for (unsigned k = 0; k < partition_taps * channels; ++k) {
+            f[k] += wave_update.buf[k];
+            make_friendly_number_by_limiting(f[k]);
+        }
+        clear(wave_update);
+        std::copy(f, f + partition_taps * channels, wave_update.buf);
+        mha_fft_wave2spec_scale(fft_update, &wave_update, &W_next[p]);
+        for (unsigned k = 0; k < bins; ++k)
+            W_next[p].buf[k].im = -W_next[p].buf[k].im;
+    }
+    update_time_job = std::chrono::duration<float>
+        (std::chrono::steady_clock::now() - start).count();
+}
+
+void afc_frequency_domain_t::filter(const mha_wave_t & LSsig,
+                                    mha_wave_t & FBsig_estim)
+{
+    const unsigned block = frames * channels;
+    const unsigned bins = (frames + 1U) * channels;
+    std::copy(ls2.buf + block, ls2.buf + 2U * block, ls2.buf);
+    std::copy(LSsig.buf, LSsig.buf + block, ls2.buf + block);
+    head = (head + 1U) % slots;
+    mha_fft_wave2spec_scale(fft_filter, &ls2, &X[head]);
+    for (unsigned kf = 0; kf < frames; ++kf) {
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            const mha_real_t ls = value(LSsig, kf, ch);
+            sliding_power[ch] += ls * ls - ls_sq.value(ls_sq_pos, ch);
+            if (sliding_power[ch] < 0.0)
+                sliding_power[ch] = 0.0;
+            ls_sq.value(ls_sq_pos, ch) = ls * ls;
+            current_power.value(kf, ch) = sliding_power[ch];
+        }
+        ls_sq_pos = (ls_sq_pos + 1U) % ntaps;
+    }
+    clear(acc_filter);
+    for (unsigned p = 0; p < partitions; ++p)
+        MHASignal::conj_mac(acc_filter.buf,
+                            W[active.load(std::memory_order_relaxed)][p].buf,
+                            X[slot(head, p)].buf, bins);
+    mha_fft_spec2wave_scale(fft_filter, &acc_filter, &wave_filter);
+    std::copy(wave_filter.buf + block, wave_filter.buf + 2U * block,
+              FBsig_estim.buf);
+}
+
 adaptive_feedback_canceller_config::adaptive_feedback_canceller_config(algo_comm_t &ac,
                                                                        const mhaconfig_t in_cfg,
                                                                        adaptive_feedback_canceller *afc)
-    : ntaps(afc->filter_length.data),
+    : process_time(0.0f),
+      update_time(0.0f),
+      skipped_updates(0U),
+      misalignment(afc->reference_filter.data.empty() ? 0U : in_cfg.channels, 0.0f),
+      ntaps(afc->filter_length.data),
       frames(in_cfg.fragsize),
       channels(in_cfg.channels),
       n_no_update_(afc->blocks_no_update.data),
@@ -73,8 +335,24 @@ adaptive_feedback_canceller_config::adaptive_feedback_canceller_config(algo_comm
       white_ERRsig(frames, channels),
       debug_mode(afc->debug_mode.data),
       current_power_ac(ac, "current_power", frames, channels, false),
-      estim_err_ac(ac, "estim_err", frames, channels, false)
+      estim_err_ac(ac, "estim_err", frames, channels, false),
+      reference_filter(afc->reference_filter.data)
 {
+    if (reference_filter.size() > 1U && reference_filter.size() != channels)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "reference_filter needs one row for all channels or"
+                        " one row per channel (%zu rows for %u channels)",
+                        reference_filter.size(), channels);
+    if (afc->engine.data.get_index() == ENGINE_FREQUENCY) {
+        if (use_lpc_decorr)
+            throw MHA_Error(__FILE__, __LINE__,
+                            "The frequency domain engine does not support"
+                            " LPC decorrelation, set use_lpc_decorr=no"
+                            " or engine=time");
+        frequency_domain.reset(new afc_frequency_domain_t
+                               (ntaps, frames, channels,
+                                afc->update_thread.data));
+    }
     /* MHAFilter::filter_t is initialized with 1.0 at the first B-coefficient, since the adaption works by
      * adding new values to the previous coefficients there will always be an offset of 1.0 at the first
      * B-coefficient. That is why it is set to 0.0 here */
@@ -86,15 +364,17 @@ adaptive_feedback_canceller_config::~adaptive_feedback_canceller_config() {
 
 }
 
-inline void make_friendly_number_by_limiting( double& x )
+template <class Coefficients>
+void adaptive_feedback_canceller_config::compute_misalignment(unsigned ch,
+                                                              Coefficients coeffs)
 {
-    if( x > 1.0e20 )
-        x = 1.0e20;
-    if( x < -1.0e20 )
-        x = -1.0e20;
+    misalignment[ch] =
+        afc_misalignment(reference_filter[reference_filter.size() > 1U ? ch : 0U],
+                         ntaps, coeffs);
 }
 
 mha_wave_t *adaptive_feedback_canceller_config::process(mha_wave_t *MICsig) {
+    const auto start = std::chrono::steady_clock::now();
     /* Compute the error signal */
     ERRsig.copy(*MICsig);
     ERRsig -= FBsig_estim;
@@ -108,11 +388,46 @@ mha_wave_t *adaptive_feedback_canceller_config::process(mha_wave_t *MICsig) {
     delay_forward_path.process(&forward_sig);
     /* Put the forward_sig into the plugloader which processes it with the selected plugins and puts the
      * result into LSsig */
+    const auto forward_start = std::chrono::steady_clock::now();
     forward_path_proc.process(&forward_sig,&LSsig);
+    const auto forward_end = std::chrono::steady_clock::now();
     /* Copy the forward path signal to the output signal. */
     LSsig_output.copy(*LSsig);
 
     /* --- BACKWARD PATH --- */
+    if (frequency_domain) {
+        /* Blockwise update and filtering in the frequency domain, the
+         * constructor rejects prewhitening for this engine */
+        if (no_update_count >= n_no_update_)
+            frequency_domain->adapt(ERRsig, stepsize, min_const,
+                                    debug_mode ? &estim_err_ac : nullptr);
+        /* The delayed loudspeaker signal of this block is aligned with
+         * the error signal of the next block */
+        delay_roundtrip.process(LSsig);
+        frequency_domain->filter(*LSsig, FBsig_estim);
+        const MHASignal::waveform_t & coeffs =
+            frequency_domain->coefficients();
+        if (debug_mode) {
+            FBfilter_estim_ac.copy(coeffs);
+            current_power_ac.copy(frequency_domain->power());
+        }
+        for (unsigned ch{0}; ch < misalignment.size(); ch++)
+            compute_misalignment(ch, [&](unsigned tap) {
+                return coeffs.value(tap, ch);
+            });
+        update_time = frequency_domain->update_time();
+        skipped_updates = frequency_domain->skipped_updates();
+        if (no_update_count < n_no_update_)
+            no_update_count++;
+        if (debug_mode)
+            insert();
+        process_time = std::chrono::duration<float>
+            ((std::chrono::steady_clock::now() - start)
+             - (forward_end - forward_start)).count();
+        return &LSsig_output;
+    }
+
+    const auto update_start = std::chrono::steady_clock::now();
     if (use_lpc_decorr) {
         for(unsigned ch{0}; ch < channels; ch++) {
             /* Prewhitening the delayed input and output signals using LPC */
@@ -161,6 +476,8 @@ mha_wave_t *adaptive_feedback_canceller_config::process(mha_wave_t *MICsig) {
         rb_white_LSsig.discard(1);
         rb_white_LSsig.write(white_LSsig_smpl);
     }
+    update_time = std::chrono::duration<float>
+        (std::chrono::steady_clock::now() - update_start).count();
 
     /* Add a delay before filtering the loudspeaker signal, compensating for the roundtrip delay - fragsize */
     delay_roundtrip.process(LSsig);
@@ -175,6 +492,10 @@ mha_wave_t *adaptive_feedback_canceller_config::process(mha_wave_t *MICsig) {
             }
         }
     }
+    for (unsigned ch{0}; ch < misalignment.size(); ch++)
+        compute_misalignment(ch, [&](unsigned tap) {
+            return FBfilter_estim[ch].B[tap];
+        });
 
     if (no_update_count < n_no_update_)
         no_update_count++;
@@ -183,6 +504,9 @@ mha_wave_t *adaptive_feedback_canceller_config::process(mha_wave_t *MICsig) {
     if (debug_mode)
         insert();
 
+    process_time = std::chrono::duration<float>
+        ((std::chrono::steady_clock::now() - start)
+         - (forward_end - forward_start)).count();
     /* Forward the output signal into the processing chain */
     return &LSsig_output;
 }
@@ -211,7 +535,20 @@ adaptive_feedback_canceller(MHA_AC::algo_comm_t & iac,
       lpc_order("Length of the lpc filter in taps", "20", "]0, 1024]"),
       delay_forward_path("Delay in the forward path processing in taps", "96", "]0,["),
       blocks_no_update("Number of iterations without updating the filter coefficients", "0", "[0,["),
-      debug_mode("Set to true to get variable states from within the processing", "no")
+      debug_mode("Set to true to get variable states from within the processing", "no"),
+      engine("Adaptation engine: time updates the filter for each sample in the time domain,"
+             " frequency updates it once per block in the frequency domain", "time", ENGINE_TYPES),
+      update_thread("Compute the filter update of the frequency domain engine on a separate thread,"
+                    " which delays the update by one more block.  Blocks arriving before"
+                    " the previous update has finished are not used for adaptation", "no"),
+      reference_filter("Known feedback path filter for computing the misalignment, one row for"
+                       " all channels or one row per channel, [] to disable", "[]"),
+      process_time("Processing time of the latest block without the forward path / s"),
+      update_time("Duration of the latest filter update / s"),
+      skipped_updates("Number of blocks not used for adaptation because the update"
+                      " thread had not finished the previous update"),
+      misalignment("Misalignment of the estimated filter with reference_filter"
+                   " in each channel / dB")
 {
     /* make the plug-in findable via "?listid" */
     set_node_id(configured_name);
@@ -225,6 +562,13 @@ adaptive_feedback_canceller(MHA_AC::algo_comm_t & iac,
     INSERT_PATCH(delay_forward_path);
     INSERT_PATCH(blocks_no_update);
     INSERT_PATCH(debug_mode);
+    INSERT_PATCH(engine);
+    INSERT_PATCH(update_thread);
+    INSERT_PATCH(reference_filter);
+    insert_member(process_time);
+    insert_member(update_time);
+    insert_member(skipped_updates);
+    insert_member(misalignment);
 }
 
 adaptive_feedback_canceller::~adaptive_feedback_canceller() {}
@@ -253,6 +597,8 @@ void adaptive_feedback_canceller::prepare(mhaconfig_t & signal_info)
                         "This plugin can only process waveform signals.");
 
     plugloader.prepare(signal_info);
+    /* process() copies the misalignment of each channel without allocation */
+    misalignment.data.reserve(signal_info.channels);
     /* make sure that a valid runtime configuration exists: */
     update_cfg();
     poll_config()->insert();
@@ -274,7 +620,14 @@ void adaptive_feedback_canceller::update_cfg()
 mha_wave_t * adaptive_feedback_canceller::process(mha_wave_t * signal)
 {
     /* this stub method defers processing to the configuration class */
-    return poll_config()->process( signal );
+    adaptive_feedback_canceller_config * config = poll_config();
+    mha_wave_t * s_out = config->process( signal );
+    process_time.data = config->process_time;
+    update_time.data = config->update_time;
+    skipped_updates.data = config->skipped_updates;
+    misalignment.data.assign(config->misalignment.begin(),
+                             config->misalignment.end());
+    return s_out;
 }
 
 void adaptive_feedback_canceller::release(){
@@ -350,14 +703,27 @@ MHAPLUGIN_DOCUMENTATION\
  "decorrelation because the filter estimation of the AFC is biased if \\emph{LSsig} and \\emph{target} are correlated. \n \\\\"
  "The backward path handles the update of the feedback filter estimation \\emph{FBfilter\\_estim} and the filtering of "
  "\\emph{LSsig} with \\emph{FBfilter\\_estim}. Both processing steps depend on the measured roundtrip latency, which "
- "is used to compute internal delays. The filter update step in this AFC algorithm is performed using the NLMS method in "
- "the time-domain (refer to [1]) for each sample in a \\texttt{process()} callback. "
+ "is used to compute internal delays. The filter update step in this AFC algorithm is performed using the NLMS method "
+ "(refer to [1]). With \\emph{engine} set to \\emph{time}, the default, the filter is updated in the time-domain "
+ "for each sample in a \\texttt{process()} callback. "
  "\\emph{stepsize} is the variable for the adaption speed. Changing the value of "
  "\\emph{stepsize} is a trade-off between convergence speed and estimation error, the higher the value the higher the "
  "convergence speed and estimation error. Different real-world settings demand different stepsize values, as a user you have "
  "to find out what works best, but it is recommended to keep the value below 0.2 (see [2]). "
  "\\emph{min\\_const} is a regularization parameter to avoid division by zero. It should be kept as low as possible to not "
  "interfere with the adaption at low output levels. \n \\\\"
+ "With \\emph{engine} set to \\emph{frequency}, the filter is updated once per \\texttt{process()} callback in the "
+ "frequency-domain, which allows much longer filters at the same CPU load. The filter is split into partitions of "
+ "one block length, the delayed \\emph{LSsig} is filtered by overlap-save with an FFT length of two blocks, and "
+ "the NLMS gradient of the whole block is computed from the spectra of the loudspeaker signal and of \\emph{ERRsig}. "
+ "The error is normalized by the power of the loudspeaker signal over the filter length, averaged over the block. "
+ "This engine cannot be combined with the LPC decorrelation. "
+ "If \\emph{update\\_thread} is set, the filter update is computed on a separate thread, ideally on a second CPU "
+ "core, while the next block is processed. The updated filter is then used one block later than without the thread. \n \\\\"
+ "The monitor variables \\emph{process\\_time} and \\emph{update\\_time} report the processing time of the latest "
+ "block without the forward path and the duration of the latest filter update. When the true feedback path is known, "
+ "e.g. in a simulation, it can be given in \\emph{reference\\_filter}, and \\emph{misalignment} reports the "
+ "normalized distance of the estimated filter to it in dB for monitoring the convergence. \n \\\\"
  "This plugin performs feedback cancellation for each channel seperately. A channel here is meant as a loudspeaker-microphone pair. "
  "Therefore, you must have the same number of input and output channels. Please refer to \\textit{openMHA/examples/31-adaptive-feedback-canceller} "
  "for usage examples of the plugin. \n"
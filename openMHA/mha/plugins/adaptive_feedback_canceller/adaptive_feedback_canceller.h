@@ -20,10 +20,179 @@
 #include "mha_filter.hh"
 #include "mha_plugin.hh"
 #include "mhapluginloader.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 
+#define ENGINE_TYPES "[time frequency]"
+#define ENGINE_TIME 0
+#define ENGINE_FREQUENCY 1
 
 class adaptive_feedback_canceller;
 
+/** Misalignment of an estimated filter with a reference filter,
+ *  10 log10(|f-h|^2 / |h|^2).
+ *  @param h Reference filter
+ *  @param ntaps Length of the estimated filter
+ *  @param coeffs Callable returning the estimated coefficient of a tap
+ *  @return Misalignment / dB */
+template <class Coefficients>
+mha_real_t afc_misalignment(const std::vector<mha_real_t> & h, unsigned ntaps,
+                            Coefficients coeffs)
+{
+    double err = 0.0, energy = 0.0;
+    for (unsigned tap{0}; tap < std::max<size_t>(ntaps, h.size()); tap++) {
+        const double target = tap < h.size() ? h[tap] : 0.0;
+        const double estimate = tap < ntaps ? coeffs(tap) : 0.0;
+        err += (estimate - target) * (estimate - target);
+        energy += target * target;
+    }
+    return 10.0 * std::log10((err + 1e-20) / (energy + 1e-20));
+}
+
+/** Block frequency domain adaptation of the estimated feedback filter.
+ *
+ *  The feedback filter of ntaps coefficients is split into partitions
+ *  of one block length B.  The delayed loudspeaker signal is filtered
+ *  by overlap-save with FFT length 2B using a frequency domain delay
+ *  line of loudspeaker spectra.  The filter is adapted once per block
+ *  with the constrained NLMS gradient: the normalized error of the
+ *  block is correlated with the loudspeaker signal in the frequency
+ *  domain, the result is added to the time domain coefficients, and
+ *  these are transformed back into the partition spectra.
+ *
+ *  The update can be computed on a separate thread.  It then runs
+ *  while the next block is processed, and its result is used from the
+ *  block after that on, i.e. with one block more delay than the
+ *  update computed in the processing thread.  The processing thread
+ *  never waits for the update thread: if the previous update has not
+ *  finished when the next block is adapted, the error of that block is
+ *  not used for adaptation and the current coefficients are kept.
+ *  The update thread runs with a real-time priority one below that of
+ *  the processing thread if the processing thread has one. */
+class afc_frequency_domain_t {
+public:
+    /** @param ntaps Length of the estimated filter
+     *  @param frames Block length B
+     *  @param channels Number of loudspeaker-microphone pairs
+     *  @param update_thread Compute the filter update on a separate thread */
+    afc_frequency_domain_t(unsigned ntaps, unsigned frames, unsigned channels,
+                           bool update_thread);
+    ~afc_frequency_domain_t();
+    afc_frequency_domain_t(const afc_frequency_domain_t &) = delete;
+    afc_frequency_domain_t & operator=(const afc_frequency_domain_t &) = delete;
+
+    /** Adapt the filter with the error signal of the current block.
+     *  The loudspeaker signal aligned with the error is the one that was
+     *  passed to filter() in the previous block.
+     *  @param ERRsig Error signal of the current block
+     *  @param stepsize Normalized NLMS stepsize
+     *  @param min_const Regularization of the normalization
+     *  @param estim_err Output: normalized error, for debugging, or nullptr */
+    void adapt(const mha_wave_t & ERRsig, mha_real_t stepsize,
+               mha_real_t min_const, MHASignal::waveform_t * estim_err);
+    /** Filter the next block of the loudspeaker signal, delayed by the
+     *  roundtrip latency minus one block, with the estimated filter.
+     *  @param LSsig Loudspeaker signal
+     *  @param FBsig_estim Output: estimated feedback signal for the next block */
+    void filter(const mha_wave_t & LSsig, mha_wave_t & FBsig_estim);
+    /** Time domain coefficients, ntaps x channels, of the latest
+     *  finished update.  Valid until the next call of adapt(). */
+    const MHASignal::waveform_t & coefficients() const {return taps_out;}
+    /** Power of the loudspeaker signal over the filter length, for
+     *  each sample of the block passed to the previous filter() call */
+    const MHASignal::waveform_t & power() const {return current_power;}
+    /** Duration of the latest finished update / s */
+    float update_time() const {return update_time_;}
+    /** Number of blocks not used for adaptation because the update
+     *  thread was still busy with the previous update */
+    unsigned long skipped_updates() const {return skipped_updates_;}
+    /** true while the update thread computes an update */
+    bool update_pending() const {return job_pending.load();}
+
+private:
+    /** Compute the update from the error in err2 with the delay line
+     *  state at index job_head, or with X_job on the update thread, into
+     *  W[1-active] and taps */
+    void update();
+    /** Loop of the update thread */
+    void thread_main();
+    /** Apply the scheduling parameters of the processing thread, with
+     *  a priority lowered by one, to the calling update thread */
+    void follow_processing_priority();
+    /** Index of the spectrum of the loudspeaker block delayed by p blocks
+     *  relative to the block in slot h */
+    unsigned slot(unsigned h, unsigned p) const {return (h + slots - p) % slots;}
+
+    const unsigned ntaps;
+    const unsigned frames;
+    const unsigned channels;
+    const unsigned partitions;
+    /** Number of delay line slots */
+    const unsigned slots;
+    /** FFT handles of the processing thread and of the update */
+    mha_fft_t fft_filter, fft_update;
+    /** Last two blocks of the loudspeaker signal */
+    MHASignal::waveform_t ls2;
+    /** Frequency domain delay line of the loudspeaker signal */
+    std::vector<MHASignal::spectrum_t> X;
+    unsigned head;
+    /** Copy of the delay line for the update thread, ordered by
+     *  partition, so that filter() may advance while an update runs */
+    std::vector<MHASignal::spectrum_t> X_job;
+    /** Two sets of conjugated partition spectra: W[active] is used for
+     *  filtering, W[1-active] is written by the update.  Only the
+     *  processing thread swaps them, when no update is pending */
+    std::vector<MHASignal::spectrum_t> W[2];
+    std::atomic<unsigned> active;
+    MHASignal::spectrum_t acc_filter, acc_update;
+    MHASignal::waveform_t wave_filter, wave_update;
+    /** Normalized error, zero padded to the front, input of the update */
+    MHASignal::waveform_t err2;
+    MHASignal::spectrum_t E;
+    unsigned job_head;
+    /** Time domain coefficients, owned by the update */
+    MHASignal::waveform_t taps;
+    /** Copy of taps after the latest finished update */
+    MHASignal::waveform_t taps_out;
+    /** Sliding power of the loudspeaker signal */
+    MHASignal::waveform_t ls_sq;
+    unsigned ls_sq_pos;
+    std::vector<double> sliding_power;
+    MHASignal::waveform_t current_power;
+    float update_time_;
+    float update_time_job;
+    unsigned long skipped_updates_;
+
+    /** true if an update was computed that is not yet used, only
+     *  accessed by the processing thread and by the update while
+     *  job_pending is set */
+    bool update_ready;
+    /** Set by the processing thread to hand err2, X_job, taps and
+     *  W[1-active] to the update thread, cleared by the update thread
+     *  when it has finished with them */
+    std::atomic<bool> job_pending;
+    std::atomic<bool> exit_request;
+    /** Wakes the update thread.  The processing thread notifies without
+     *  locking the mutex, the update thread therefore also polls
+     *  job_pending every poll_interval */
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    static constexpr std::chrono::milliseconds poll_interval{1};
+    /** Scheduling parameters of the processing thread, published by
+     *  its first adapt() call, applied by the update thread */
+    std::atomic<bool> processing_priority_known;
+    bool processing_priority_applied;
+    int processing_policy;
+    int processing_priority;
+    std::thread thread;
+};
+
 /** This is the runtime configuration, the main processing will be done in this class.
  *  During runtime AC variables are published by this class, mainly for debbugging purposes. */
 class adaptive_feedback_canceller_config {
@@ -42,8 +211,20 @@ public:
     mha_wave_t* process(mha_wave_t* MICsig);
     /** Insert all AC-variables into the AC-space. */
     void insert();
+    /** Processing time of the latest block without the forward path / s */
+    float process_time;
+    /** Duration of the latest finished filter update / s */
+    float update_time;
+    /** Number of blocks not used for adaptation by the update thread */
+    unsigned long skipped_updates;
+    /** Misalignment of the estimated filter with the reference filter
+     *  in each channel / dB, empty without reference filter */
+    std::vector<mha_real_t> misalignment;
 
 private:
+    /** Compute @ref misalignment of channel ch from coefficients coeffs(tap) */
+    template <class Coefficients>
+    void compute_misalignment(unsigned ch, Coefficients coeffs);
     /** Length of the estimated filter */
     const unsigned int ntaps;
     /** Length of a block in samples (fragsize) */
@@ -159,6 +340,11 @@ private:
      *  the NLMS equation, namely the @ref stepsize normalized by @ref current_power times @ref ERRsig.
      */
     MHA_AC::waveform_t estim_err_ac;
+    /** Reference filter for @ref misalignment, one row for all channels
+     *  or one row per channel */
+    std::vector<std::vector<mha_real_t>> reference_filter;
+    /** Frequency domain engine, nullptr for the time domain engine */
+    std::unique_ptr<afc_frequency_domain_t> frequency_domain;
 };
 
 class adaptive_feedback_canceller : public MHAPlugin::plugin_t<adaptive_feedback_canceller_config> {
@@ -212,6 +398,16 @@ public:
      *  including @ref FBfilter_estim_ac, @ref ERRsig_ac, @ref current_power_ac, @ref estim_err_ac
      */
     MHAParser::bool_t debug_mode;
+    /** Adaptation engine: sample by sample in the time domain, or blockwise in the frequency domain */
+    MHAParser::kw_t engine;
+    /** Compute the filter update of the frequency domain engine on a separate thread */
+    MHAParser::bool_t update_thread;
+    /** Known feedback path, e.g. of a simulation, to compute the misalignment of the estimated filter */
+    MHAParser::mfloat_t reference_filter;
+    MHAParser::float_mon_t process_time;
+    MHAParser::float_mon_t update_time;
+    MHAParser::int_mon_t skipped_updates;
+    MHAParser::vfloat_mon_t misalignment;
 
 private:
     void update_cfg();
@@ -0,0 +1,226 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "adaptive_feedback_canceller.h"
+#include "mha_algo_comm.hh"
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace {
+    constexpr unsigned block_frames = 16U;
+    constexpr unsigned num_channels = 2U;
+    constexpr unsigned num_taps = 64U;
+
+    /** Feedback path of each channel, shorter than the estimated filter */
+    std::vector<mha_real_t> feedback_path(unsigned ch)
+    {
+        std::vector<mha_real_t> h(num_taps - 14U);
+        for (unsigned k = 0; k < h.size(); ++k)
+            h[k] = 0.5f * std::exp(-0.08f * k) * std::cos(0.9f * k + ch);
+        return h;
+    }
+
+    /** Misalignment / dB of the coefficients of channel ch */
+    mha_real_t misalignment(const MHASignal::waveform_t & coeffs, unsigned ch)
+    {
+        return afc_misalignment(feedback_path(ch), num_taps,
+                                [&](unsigned tap) {
+                                    return coeffs.value(tap, ch);
+                                });
+    }
+
+    /** Wait until the update thread has finished the pending update,
+     *  as it does within one block period in real-time processing */
+    void wait_for_update(const afc_frequency_domain_t & afc)
+    {
+        while (afc.update_pending())
+            std::this_thread::yield();
+    }
+
+    /** Closed loop system identification with the frequency domain
+     *  engine: the loudspeaker signal is white noise, the microphone
+     *  signal of the next block is the loudspeaker signal filtered
+     *  with the feedback path, as with a roundtrip latency of one
+     *  block.  Returns the misalignment of channel 0 after each block. */
+    std::vector<mha_real_t> identify(bool update_thread, unsigned blocks)
+    {
+        afc_frequency_domain_t afc(num_taps, block_frames, num_channels,
+                                   update_thread);
+        std::vector<std::vector<mha_real_t>> h;
+        for (unsigned ch = 0; ch < num_channels; ++ch)
+            h.push_back(feedback_path(ch));
+        MHASignal::waveform_t history(h[0].size(), num_channels);
+        MHASignal::waveform_t ls(block_frames, num_channels);
+        MHASignal::waveform_t mic(block_frames, num_channels);
+        MHASignal::waveform_t estimate(block_frames, num_channels);
+        MHASignal::waveform_t err(block_frames, num_channels);
+        std::mt19937 rng(1);
+        std::normal_distribution<mha_real_t> noise;
+        std::vector<mha_real_t> result;
+        for (unsigned b = 0; b < blocks; ++b) {
+            for (unsigned k = 0; k < err.num_frames * num_channels; ++k)
+                err.buf[k] = mic.buf[k] - estimate.buf[k];
+            afc.adapt(err, 0.5f, 1e-10f, nullptr);
+            wait_for_update(afc);
+            result.push_back(misalignment(afc.coefficients(), 0));
+            for (unsigned kf = 0; kf < block_frames; ++kf)
+                for (unsigned ch = 0; ch < num_channels; ++ch) {
+                    for (unsigned k = history.num_frames - 1U; k > 0; --k)
+                        history.value(k, ch) = history.value(k - 1U, ch);
+                    history.value(0, ch) = ls.value(kf, ch) = noise(rng);
+                    mic.value(kf, ch) = 0;
+                    for (unsigned k = 0; k < history.num_frames; ++k)
+                        mic.value(kf, ch) += h[ch][k] * history.value(k, ch);
+                }
+            afc.filter(ls, estimate);
+        }
+        EXPECT_LT(misalignment(afc.coefficients(), 1), -40.0f);
+        EXPECT_EQ(0U, afc.skipped_updates());
+        return result;
+    }
+}
+
+TEST(adaptive_feedback_canceller, frequency_engine_converges)
+{
+    const std::vector<mha_real_t> m = identify(false, 600U);
+    EXPECT_NEAR(0.0f, m.front(), 1e-3f);
+    EXPECT_LT(m[50], -5.0f);
+    EXPECT_LT(m.back(), -40.0f);
+}
+
+TEST(adaptive_feedback_canceller, update_thread_converges)
+{
+    const std::vector<mha_real_t> m = identify(true, 600U);
+    EXPECT_LT(m.back(), -40.0f);
+}
+
+TEST(adaptive_feedback_canceller, update_thread_delivers_same_taps_one_block_later)
+{
+    afc_frequency_domain_t direct(num_taps, block_frames, num_channels, false);
+    afc_frequency_domain_t threaded(num_taps, block_frames, num_channels, true);
+    MHASignal::waveform_t ls(block_frames, num_channels);
+    MHASignal::waveform_t err(block_frames, num_channels);
+    MHASignal::waveform_t estimate(block_frames, num_channels);
+    MHASignal::waveform_t previous(num_taps, num_channels);
+    std::mt19937 rng(2);
+    std::normal_distribution<mha_real_t> noise;
+    for (unsigned b = 0; b < 50U; ++b) {
+        for (unsigned k = 0; k < err.num_frames * num_channels; ++k)
+            err.buf[k] = noise(rng);
+        direct.adapt(err, 0.1f, 1e-10f, nullptr);
+        threaded.adapt(err, 0.1f, 1e-10f, nullptr);
+        wait_for_update(threaded);
+        // The threaded engine publishes the update of the previous block
+        const MHASignal::waveform_t & taps = threaded.coefficients();
+        for (unsigned k = 0; k < num_taps * num_channels; ++k)
+            ASSERT_EQ(previous.buf[k], taps.buf[k])
+                << "block " << b << " index " << k;
+        previous.copy(direct.coefficients());
+        for (unsigned k = 0; k < ls.num_frames * num_channels; ++k)
+            ls.buf[k] = noise(rng);
+        direct.filter(ls, estimate);
+        threaded.filter(ls, estimate);
+    }
+    // The updates are not trivially zero
+    EXPECT_GT(std::fabs(previous.value(0, 0)), 0.0f);
+    EXPECT_EQ(0U, threaded.skipped_updates());
+}
+
+TEST(adaptive_feedback_canceller, busy_update_thread_keeps_coefficients)
+{
+    // Without waiting for the update thread, blocks may be skipped
+    afc_frequency_domain_t afc(16U * num_taps, block_frames, num_channels, true);
+    MHASignal::waveform_t ls(block_frames, num_channels);
+    MHASignal::waveform_t err(block_frames, num_channels);
+    MHASignal::waveform_t estimate(block_frames, num_channels);
+    MHASignal::waveform_t previous(16U * num_taps, num_channels);
+    std::mt19937 rng(3);
+    std::normal_distribution<mha_real_t> noise;
+    unsigned long skipped = 0U;
+    for (unsigned b = 0; b < 200U; ++b) {
+        for (unsigned k = 0; k < err.num_frames * num_channels; ++k)
+            err.buf[k] = noise(rng);
+        afc.adapt(err, 0.1f, 1e-10f, nullptr);
+        ASSERT_LE(afc.skipped_updates(), skipped + 1U);
+        if (afc.skipped_updates() > skipped) {
+            // A skipped block publishes nothing
+            const MHASignal::waveform_t & taps = afc.coefficients();
+            for (unsigned k = 0; k < previous.num_frames * num_channels; ++k)
+                ASSERT_EQ(previous.buf[k], taps.buf[k]) << "block " << b;
+            skipped = afc.skipped_updates();
+        }
+        previous.copy(afc.coefficients());
+        for (unsigned k = 0; k < ls.num_frames * num_channels; ++k)
+            ls.buf[k] = noise(rng);
+        afc.filter(ls, estimate);
+    }
+    wait_for_update(afc);
+    EXPECT_LT(afc.skipped_updates(), 200U);
+}
+
+TEST(adaptive_feedback_canceller, misalignment)
+{
+    const std::vector<mha_real_t> h = {1.0f, -1.0f};
+    // Exact estimate
+    EXPECT_LT(afc_misalignment(h, 2U, [&](unsigned tap) {return h[tap];}),
+              -150.0f);
+    // Zero estimate
+    EXPECT_FLOAT_EQ(0.0f, afc_misalignment(h, 4U, [](unsigned) {return 0.0;}));
+    // Error of 10% in each tap
+    EXPECT_FLOAT_EQ(-20.0f, afc_misalignment(h, 2U, [&](unsigned tap) {
+        return 1.1 * h[tap];
+    }));
+    // Taps beyond the reference count as error, taps beyond the
+    // estimate are missing
+    EXPECT_FLOAT_EQ(10.0f * std::log10(2.0f),
+                    afc_misalignment(h, 3U, [&](unsigned tap) {
+                        return tap < 2U ? h[tap] : 2.0;
+                    }));
+    EXPECT_FLOAT_EQ(10.0f * std::log10(0.5f),
+                    afc_misalignment(h, 1U, [&](unsigned tap) {
+                        return h[tap];
+                    }));
+}
+
+TEST(adaptive_feedback_canceller, frequency_engine_rejects_lpc_decorrelation)
+{
+    MHA_AC::algo_comm_class_t acspace;
+    adaptive_feedback_canceller afc(acspace, "afc");
+    mhaconfig_t cfg = {
+        .channels = num_channels, .domain = MHA_WAVEFORM,
+        .fragsize = block_frames, .wndlen = 0, .fftlen = 0, .srate = 16000
+    };
+    afc.parse("delay_forward_path = [96 96]");
+    afc.parse("measured_roundtrip_latency = [32 32]");
+    afc.parse("engine = frequency");
+    afc.use_lpc_decorr.data = true;
+    try {
+        adaptive_feedback_canceller_config(acspace, cfg, &afc);
+        FAIL() << "use_lpc_decorr was accepted with engine=frequency";
+    } catch (MHA_Error & e) {
+        EXPECT_NE(std::string::npos, std::string(e.get_msg()).find("LPC"));
+    }
+    afc.use_lpc_decorr.data = false;
+    EXPECT_NO_THROW(adaptive_feedback_canceller_config(acspace, cfg, &afc));
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -15,9 +15,7 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "mha_plugin.hh"
-#include "mha_filter.hh"
-#include "mhasndfile.h"
+#include "addsndfile.hh"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -31,61 +29,8 @@
 
 namespace addsndfile {
 
-    /** Specifies the resampling mode in resampled_soundfile_t */
-    enum addsndfile_resampling_mode_t {
-        /* Do not resample, just use the samples from the sound file
-         * at the current sample rate, even if the sample rate of
-         * the sound file differs. */
-        DONT_RESAMPLE_PERMISSIVE,
-        /** Do not resample, if the sample rate of the MHA differs
-         *  from the sample rate of the sound file, raise an error. */
-        DONT_RESAMPLE_STRICT,
-        /** Resample */
-        DO_RESAMPLE
-    };
-
-    /** Class helps to specify which instance of MHASignal_waveform_t parent
-     * instance is meant in resampled_soundfile_t. */
-    class waveform_proxy_t : public MHASignal::waveform_t {
-    public:
-        waveform_proxy_t(unsigned frames, unsigned channels) :
-            MHASignal::waveform_t(frames, channels)
-        {}
-    };
-
-    /** Reads sound from file and resamples it if necessary and wanted. Sound data
-     * can then be used by addsndfile. */
-    class resampled_soundfile_t : private MHASndFile::sf_wave_t,
-                                  public waveform_proxy_t {
-    public:
-        /** Reads sound from file and resamples if necessary and wanted.
-         * If the sound file does not specify a sampling rate, then
-         * the sound data is always used without resampling.
-         *
-         * @param name
-         *        Sound file name
-         * @param mha_sampling_rate
-         *        The sampling rate of the MHA signal processing
-         *        at the point of the addsndfile plugin
-         * @param resampling_mode
-         *        DONT_RESAMPLE_STRICT:
-         *               Do not resample, just use the samples from the sound file
-         *               at the current sample rate, even if the sample rate of
-         *               the sound file differs.
-         *        DONT_RESAMPLE_PERMISSIVE:
-         *               Do not resample, if the sample rate of the MHA differs
-         *               from the sample rate of the sound file, raise an error.
-         *        DO_RESAMPLE:
-         *               Resample.
-         * @throw MHA_Error
-         *        If the sampling rate of the file does not match the sampling
-         *        rate of the MHA and DONT_RESAMPLE_STRICT was requested.
-         *        If resampling failed (e.g. due to non-rational quotient of
-         *        MHA sampling rate and sound file sampling rate). */
-        resampled_soundfile_t(const std::string & name,
-                              float mha_sampling_rate,
-                              addsndfile_resampling_mode_t resampling_mode);
-    };
+    /** Level in dB of a sound file sample of full scale */
+    static constexpr mha_real_t sndfile_peaklevel_db = 93.9794f;
 
     static unsigned resampled_num_frames(unsigned num_source_frames,
                                          float source_rate,
@@ -113,7 +58,7 @@ namespace addsndfile {
                                                  float mha_sampling_rate,
                                                  addsndfile_resampling_mode_t
                                                  /**/            resampling_mode)
-        :  MHASndFile::sf_wave_t(name, 93.9794),
+        :  MHASndFile::sf_wave_t(name, sndfile_peaklevel_db),
         waveform_proxy_t(resampled_num_frames(MHASndFile::sf_wave_t
                                               ::num_frames,
                                               MHASndFile::sf_wave_t
@@ -159,20 +104,6 @@ namespace addsndfile {
         }
     }
 
-    class sndfile_t : public MHASignal::loop_wavefragment_t
-    {
-    public:
-        sndfile_t(const std::string& name,
-                  bool loop,
-                  unsigned int level_mode,
-                  std::vector<int> channels_,
-                  unsigned int nchannels,
-                  std::vector<int>& mapping,
-                  int& numchannels,unsigned int startpos,
-                  float mha_sampling_rate,
-                  addsndfile_resampling_mode_t resampling_mode);
-    };
-
     sndfile_t::sndfile_t(const std::string& name,
                          bool loop,
                          unsigned int level_mode,
@@ -193,6 +124,214 @@ namespace addsndfile {
         numchannels = loop_wavefragment_t::num_channels;
     }
 
+    /** Number of frames read from the sound file at once */
+    static constexpr unsigned streaming_source_chunk = 1024U;
+    /** Number of frames read from the resampler at once */
+    static constexpr unsigned streaming_resampled_chunk = 64U;
+    /** Upper limit for the delay of a wake up of the reader thread / ms */
+    static constexpr unsigned streaming_poll_interval_ms = 50U;
+
+    static bool needs_resampling(float source_rate, float target_rate,
+                                 addsndfile_resampling_mode_t resampling_mode)
+    {
+        if (resampling_mode == DONT_RESAMPLE_STRICT &&
+            source_rate != target_rate)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "Sampling rate %f of sound file does not match"
+                            " sampling rate %f of MHA and you have requested"
+                            " no resampling and strict checking",
+                            source_rate, target_rate);
+        return resampling_mode == DO_RESAMPLE && source_rate != target_rate;
+    }
+
+    static unsigned streaming_fifo_frames(float buffer_length,
+                                          float mha_sampling_rate,
+                                          unsigned fragsize)
+    {
+        return std::max(static_cast<unsigned>(buffer_length *
+                                              mha_sampling_rate),
+                        std::max(2U * fragsize,
+                                 2U * streaming_source_chunk));
+    }
+
+    streamed_sndfile_t::streamed_sndfile_t(const std::string& name,
+                                           bool loop,
+                                           unsigned int level_mode,
+                                           const std::vector<int>& channels_,
+                                           unsigned int nchannels,
+                                           std::vector<int>& mapping,
+                                           int& numchannels,
+                                           unsigned int startpos,
+                                           float mha_sampling_rate,
+                                           addsndfile_resampling_mode_t
+                                           /**/       resampling_mode,
+                                           unsigned int fragsize,
+                                           float buffer_length)
+        : file(name),
+          nch(std::max(file.channels, 1)),
+          playback_channels(channels_),
+          loop(loop),
+          scale(2.0e-5 * pow(10.0f,0.05*sndfile_peaklevel_db)),
+          total_frames(resampled_num_frames(static_cast<unsigned>(file.frames),
+                                            file.samplerate,
+                                            mha_sampling_rate,
+                                            resampling_mode)),
+          source_block(streaming_source_chunk, nch),
+          resampled_block(streaming_resampled_chunk, nch),
+          fifo(streaming_fifo_frames(buffer_length, mha_sampling_rate,
+                                     fragsize) * nch),
+          playback_block(fragsize, nch)
+    {
+        if (level_mode != MHASignal::loop_wavefragment_t::relative)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "Streaming sound files requires levelmode"
+                            " relative");
+        if (needs_resampling(file.samplerate, mha_sampling_rate,
+                             resampling_mode)) {
+            resampling = std::make_unique
+                <MHAFilter::blockprocessing_polyphase_resampling_t>
+                (file.samplerate, streaming_source_chunk,
+                 mha_sampling_rate, streaming_resampled_chunk,
+                 0.85f, 7e-4f, nch, false);
+            // Start position is given at the MHA sampling rate
+            sf_seek(file.sf, static_cast<sf_count_t>
+                    (startpos * double(file.samplerate) / mha_sampling_rate),
+                    SEEK_SET);
+        } else
+            sf_seek(file.sf, startpos, SEEK_SET);
+        produced = std::min(startpos, total_frames);
+        mapping = std::vector<int>(nchannels,-1);
+        for(unsigned int ch=0;ch<playback_channels.size();ch++){
+            if( (playback_channels[ch] < (int)nchannels) &&
+                (playback_channels[ch] >= 0) )
+                mapping[playback_channels[ch]] = ch % nch;
+        }
+        numchannels = nch;
+        if (total_frames == 0U || (produced == total_frames && !loop))
+            finished = true;
+        // Start playback with a full fifo.  Takes constant time.
+        fill();
+        reader = std::thread(&streamed_sndfile_t::read_thread, this);
+    }
+
+    streamed_sndfile_t::~streamed_sndfile_t()
+    {
+        stop = true;
+        wakeup.notify_one();
+        reader.join();
+    }
+
+    void streamed_sndfile_t::read_source(mha_real_t * buf, unsigned frames)
+    {
+        unsigned got = 0U;
+        bool rewound = false;
+        while (got < frames) {
+            sf_count_t n = sf_readf_float(file.sf, buf + got * nch,
+                                          frames - got);
+            if (n > 0) {
+                got += n;
+                rewound = false;
+                continue;
+            }
+            // End of file.  Give up if the file is empty.
+            if (!loop || rewound)
+                break;
+            sf_seek(file.sf, 0, SEEK_SET);
+            rewound = true;
+        }
+        std::fill(buf + got * nch, buf + frames * nch, 0.0f);
+        for (unsigned k = 0; k < got * nch; ++k)
+            buf[k] *= scale;
+    }
+
+    void streamed_sndfile_t::fill()
+    {
+        const unsigned max_chunk = resampling ? streaming_resampled_chunk
+            : streaming_source_chunk;
+        while (!finished.load() && !stop.load() &&
+               fifo.get_available_space() >= max_chunk * nch) {
+            unsigned frames = 0U;
+            const mha_real_t * data = nullptr;
+            if (resampling) {
+                if (!resampling->can_read()) {
+                    // Zero padding at the end of the file also flushes
+                    // the resampling filter.
+                    read_source(source_block.buf, streaming_source_chunk);
+                    resampling->write(source_block);
+                    continue;
+                }
+                resampling->read(resampled_block);
+                frames = streaming_resampled_chunk;
+                data = resampled_block.buf;
+            } else {
+                frames = streaming_source_chunk;
+                if (!loop)
+                    frames = std::min(frames, total_frames - produced);
+                read_source(source_block.buf, frames);
+                data = source_block.buf;
+            }
+            if (!loop) {
+                frames = std::min(frames, total_frames - produced);
+                produced += frames;
+            }
+            fifo.write(data, frames * nch);
+            if (!loop && produced >= total_frames)
+                finished = true;
+        }
+    }
+
+    void streamed_sndfile_t::read_thread()
+    {
+        try {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stop.load()) {
+                notified = false;
+                fill();
+                wakeup.wait_for(lock, std::chrono::milliseconds
+                                (streaming_poll_interval_ms),
+                                [this]{return stop.load() || notified.load();});
+            }
+        }
+        catch (MHA_Error&) {
+            // Stop playback, the signal processing thread plays the
+            // remaining sound from the fifo.
+            finished = true;
+        }
+    }
+
+    void streamed_sndfile_t::playback(mha_wave_t* s,
+                                      MHASignal::loop_wavefragment_t
+                                      ::playback_mode_t pmode,
+                                      mha_wave_t* level_pa)
+    {
+        if( pmode == MHASignal::loop_wavefragment_t::input )
+            return;
+        if( pmode == MHASignal::loop_wavefragment_t::replace )
+            clear(s);
+        if( pmode == MHASignal::loop_wavefragment_t::mute ){
+            clear(s);
+            return;
+        }
+        const unsigned frames =
+            std::min({s->num_frames, playback_block.num_frames,
+                      fifo.get_fill_count() / nch});
+        if (frames < s->num_frames && !finished.load())
+            ++underruns;
+        fifo.read(playback_block.buf, frames * nch);
+        for(unsigned k=0;k<frames;k++)
+            for(unsigned kch=0;kch<playback_channels.size();kch++)
+                if( (playback_channels[kch] < (int)(s->num_channels)) &&
+                    (playback_channels[kch] >= 0) )
+                    ::value(s,k,playback_channels[kch]) +=
+                        ::value(level_pa, k % level_pa->num_frames,
+                                kch % level_pa->num_channels) *
+                        playback_block.value(k, kch % nch);
+        if (!finished.load() &&
+            2U * fifo.get_fill_count() < fifo.get_max_fill_count() &&
+            !notified.exchange(true))
+            wakeup.notify_one();
+    }
+
     class level_adapt_t : public MHASignal::waveform_t
     {
     public:
@@ -234,7 +373,7 @@ namespace addsndfile {
     }
 
     typedef MHAPlugin::config_t<level_adapt_t> level_adaptor;
-    typedef MHAPlugin::plugin_t<sndfile_t> wave_reader;
+    typedef MHAPlugin::plugin_t<source_t> wave_reader;
 
     class addsndfile_if_t : public wave_reader, private level_adaptor
     {
@@ -259,10 +398,13 @@ namespace addsndfile {
         MHAParser::kw_t mode;
         MHAParser::float_t ramplen;
         MHAParser::int_t startpos;
+        MHAParser::bool_t streaming;
+        MHAParser::float_t buffer_length;
         MHAParser::vint_mon_t mapping;
         MHAParser::int_mon_t numchannels;
         MHAParser::int_mon_t mhachannels;
         MHAParser::int_mon_t active;
+        MHAParser::int_mon_t underruns;
         MHAParser::string_t search_pattern;
         MHAParser::vstring_mon_t search_result;
         unsigned int uint_mode;
@@ -271,7 +413,7 @@ namespace addsndfile {
 
     addsndfile_if_t::addsndfile_if_t(MHA_AC::algo_comm_t & iac,
                                      const std::string &)
-        : MHAPlugin::plugin_t<sndfile_t>
+        : MHAPlugin::plugin_t<source_t>
         (
          "Add sound data from a sound file to the MHA audio channels.\n\n"
          "The sound file is read into memory and scaled as determined by configuration\n"
@@ -279,7 +421,7 @@ namespace addsndfile {
          "Changing any parameter except \"mode\" will start playing the file from the\n"
          "beginning.  addsndfile stores the complete sound file in RAM memory before\n"
          "starting playback, this limits the total duration of sound files that can\n"
-         "be read by addsndfile.",
+         "be read by addsndfile, unless \"streaming\" is enabled.",
          iac),
         filename("File name of the sound file.  If empty, addsndfile does not modify the sound.",""),
         path("The directory containing the sound file to read.\n"
@@ -310,10 +452,16 @@ namespace addsndfile {
              "add","[add replace input mute]"),
         ramplen("Length of hanning ramp at level changes in seconds","0","[0,]"),
         startpos("Starting position in samples, loop will begin from zero","0","[0,]"),
+        streaming("Read the sound file in a background thread during playback\n"
+                  "instead of reading the complete file into memory during prepare.\n"
+                  "Requires levelmode=relative.","no"),
+        buffer_length("Length of the read-ahead buffer when streaming / s","1","]0,]"),
         mapping("Channel mapping"),
         numchannels("Number of channels in current file"),
         mhachannels("Number of MHA channels at plugin position"),
         active("indicates if sound currently plays back"),
+        underruns("Number of blocks that could not be filled completely because\n"
+                  "the sound file was not read in time (only when streaming)"),
         search_pattern("Search pattern for file list","*.wav"),
         search_result("Available files"),
         uint_mode(0)
@@ -329,10 +477,13 @@ namespace addsndfile {
         insert_item("mode",&mode);
         insert_item("ramplen",&ramplen);
         insert_member(startpos);
+        insert_member(streaming);
+        insert_member(buffer_length);
         insert_item("mapping",&mapping);
         insert_item("filechannels",&numchannels);
         insert_item("mhachannels",&mhachannels);
         insert_member(active);
+        insert_member(underruns);
         insert_item("search_pattern",&search_pattern);
         insert_item("files",&search_result);
         patchbay.connect(&filename.writeaccess,this,&addsndfile_if_t::update);
@@ -344,6 +495,8 @@ namespace addsndfile {
         patchbay.connect(&mode.writeaccess,this,&addsndfile_if_t::change_mode);
         patchbay.connect(&ramplen.writeaccess,this,&addsndfile_if_t::set_level);
         patchbay.connect(&startpos.writeaccess,this,&addsndfile_if_t::update);
+        patchbay.connect(&streaming.writeaccess,this,&addsndfile_if_t::update);
+        patchbay.connect(&buffer_length.writeaccess,this,&addsndfile_if_t::update);
         patchbay.connect(&search_result.prereadaccess,this,&addsndfile_if_t::scan_dir);
         active.data = 0;
     }
@@ -404,7 +557,19 @@ namespace addsndfile {
     void addsndfile_if_t::update()
     {
         if (!is_prepared()) return;
-        if( filename.data.size() )
+        if( filename.data.size() && streaming.data )
+            wave_reader::push_config(new streamed_sndfile_t(path.data+filename.data,
+                                                            loop.data,
+                                                            levelmode.data.get_index(),
+                                                            channels.data,
+                                                            tftype.channels,
+                                                            mapping.data,
+                                                            numchannels.data,startpos.data,
+                                                            tftype.srate,
+                                                            addsndfile_resampling_mode_t(resamplingmode.data.get_index()),
+                                                            tftype.fragsize,
+                                                            buffer_length.data));
+        else if( filename.data.size() )
             wave_reader::push_config(new sndfile_t(path.data+filename.data,
                                                    loop.data,
                                                    levelmode.data.get_index(),
@@ -442,6 +607,7 @@ namespace addsndfile {
     {
         wave_reader::poll_config();
         active.data = wave_reader::cfg->is_playback_active();
+        underruns.data = wave_reader::cfg->get_num_underruns();
         if( level_adaptor::cfg->can_update() )
             level_adaptor::poll_config();
         level_adaptor::cfg->update_frame();
@@ -509,6 +675,18 @@ MHAPLUGIN_DOCUMENTATION\
  "  The sound from the sound file is resampled to the \\mha{} sampling rate if"
  "  the sampling rates in sound file and \\mha{} differ."
  "\\end{description}\n"
+ "\n"
+ "By default, addsndfile reads and resamples the complete sound file during"
+ " prepare and keeps it in memory.  For long sound files, set"
+ " \\verb!streaming=yes!: A background thread then reads and resamples the"
+ " sound file during playback into a buffer of \\verb!buffer_length! seconds."
+ "  Memory usage and preparation time then do not depend on the length of the"
+ " sound file.  When looping, the resampling continues across the end of"
+ " the sound file without restarting the resampling filter.  Streaming"
+ " requires \\verb!levelmode=relative!.  The monitor"
+ " variable \\verb!underruns! counts the audio blocks that could not be filled"
+ " completely because the sound file was not read in time, e.g. from a slow"
+ " network drive.\n"
 )
 
 /*
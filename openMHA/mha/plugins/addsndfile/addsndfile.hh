@@ -0,0 +1,226 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2006 2007 2009 2010 2011 2012 2013 2014 2015 2018 HörTech gGmbH
+// Copyright © 2019 2021 HörTech gGmbH
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License, 
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_plugin.hh"
+#include "mha_filter.hh"
+#include "mha_fifo.h"
+#include "mhasndfile.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// forward declaration of test classes
+class streamed_sndfile_testing;
+
+namespace addsndfile {
+
+    /** Specifies the resampling mode in resampled_soundfile_t */
+    enum addsndfile_resampling_mode_t {
+        /* Do not resample, just use the samples from the sound file
+         * at the current sample rate, even if the sample rate of
+         * the sound file differs. */
+        DONT_RESAMPLE_PERMISSIVE,
+        /** Do not resample, if the sample rate of the MHA differs
+         *  from the sample rate of the sound file, raise an error. */
+        DONT_RESAMPLE_STRICT,
+        /** Resample */
+        DO_RESAMPLE
+    };
+
+    /** Class helps to specify which instance of MHASignal_waveform_t parent
+     * instance is meant in resampled_soundfile_t. */
+    class waveform_proxy_t : public MHASignal::waveform_t {
+    public:
+        waveform_proxy_t(unsigned frames, unsigned channels) :
+            MHASignal::waveform_t(frames, channels)
+        {}
+    };
+
+    /** Reads sound from file and resamples it if necessary and wanted. Sound data
+     * can then be used by addsndfile. */
+    class resampled_soundfile_t : private MHASndFile::sf_wave_t,
+                                  public waveform_proxy_t {
+    public:
+        /** Reads sound from file and resamples if necessary and wanted.
+         * If the sound file does not specify a sampling rate, then
+         * the sound data is always used without resampling.
+         *
+         * @param name
+         *        Sound file name
+         * @param mha_sampling_rate
+         *        The sampling rate of the MHA signal processing
+         *        at the point of the addsndfile plugin
+         * @param resampling_mode
+         *        DONT_RESAMPLE_STRICT:
+         *               Do not resample, just use the samples from the sound file
+         *               at the current sample rate, even if the sample rate of
+         *               the sound file differs.
+         *        DONT_RESAMPLE_PERMISSIVE:
+         *               Do not resample, if the sample rate of the MHA differs
+         *               from the sample rate of the sound file, raise an error.
+         *        DO_RESAMPLE:
+         *               Resample.
+         * @throw MHA_Error
+         *        If the sampling rate of the file does not match the sampling
+         *        rate of the MHA and DONT_RESAMPLE_STRICT was requested.
+         *        If resampling failed (e.g. due to non-rational quotient of
+         *        MHA sampling rate and sound file sampling rate). */
+        resampled_soundfile_t(const std::string & name,
+                              float mha_sampling_rate,
+                              addsndfile_resampling_mode_t resampling_mode);
+    };
+
+    /** Interface of the sound sources played back by addsndfile. */
+    class source_t {
+    public:
+        virtual ~source_t() = default;
+        /** Add or replace one block of the MHA signal with sound from the
+         * source.
+         * @param s        MHA signal, modified in place.
+         * @param pmode    Playback mode.
+         * @param level_pa Linear playback gain, one value per frame of s. */
+        virtual void playback(mha_wave_t* s,
+                              MHASignal::loop_wavefragment_t::playback_mode_t
+                              pmode,
+                              mha_wave_t* level_pa) = 0;
+        /** True while there is sound left to play. */
+        virtual bool is_playback_active() const = 0;
+        /** Number of blocks which could not be filled completely because
+         * the sound was not read from disk in time. */
+        virtual unsigned get_num_underruns() const {return 0U;}
+    };
+
+    /** Sound source which holds the complete sound file in memory. */
+    class sndfile_t : public MHASignal::loop_wavefragment_t,
+                      public source_t
+    {
+    public:
+        sndfile_t(const std::string& name,
+                  bool loop,
+                  unsigned int level_mode,
+                  std::vector<int> channels_,
+                  unsigned int nchannels,
+                  std::vector<int>& mapping,
+                  int& numchannels,unsigned int startpos,
+                  float mha_sampling_rate,
+                  addsndfile_resampling_mode_t resampling_mode);
+        void playback(mha_wave_t* s,
+                      MHASignal::loop_wavefragment_t::playback_mode_t pmode,
+                      mha_wave_t* level_pa) override
+        {loop_wavefragment_t::playback(s,pmode,level_pa);}
+        bool is_playback_active() const override
+        {return loop_wavefragment_t::is_playback_active();}
+    };
+
+    /** Sound source which reads the sound file while playing.
+     *
+     * A reader thread decodes and, if necessary, resamples the sound
+     * file ahead of the playback position into a lock-free fifo.  Memory
+     * usage and preparation time do not depend on the length of the
+     * sound file.  The signal processing thread wakes the reader thread
+     * when the fifo is less than half full.  Only level mode "relative"
+     * is supported, because the other level modes need the complete
+     * sound file to compute the scaling factor. */
+    class streamed_sndfile_t : public source_t {
+        friend class ::streamed_sndfile_testing;
+    public:
+        /** Opens the sound file, fills the fifo, and starts the reader
+         * thread.  Parameters as in sndfile_t, and
+         * @param fragsize Number of frames per block of the MHA signal.
+         * @param buffer_length Capacity of the fifo in seconds.
+         * @throw MHA_Error if the file cannot be opened, if the level
+         *        mode is not "relative", or if the sampling rates do not
+         *        match and resampling is not possible or not permitted. */
+        streamed_sndfile_t(const std::string& name,
+                           bool loop,
+                           unsigned int level_mode,
+                           const std::vector<int>& channels_,
+                           unsigned int nchannels,
+                           std::vector<int>& mapping,
+                           int& numchannels,
+                           unsigned int startpos,
+                           float mha_sampling_rate,
+                           addsndfile_resampling_mode_t resampling_mode,
+                           unsigned int fragsize,
+                           float buffer_length);
+        /** Terminates the reader thread. */
+        ~streamed_sndfile_t();
+        void playback(mha_wave_t* s,
+                      MHASignal::loop_wavefragment_t::playback_mode_t pmode,
+                      mha_wave_t* level_pa) override;
+        bool is_playback_active() const override
+        {return !finished.load() || fifo.get_fill_count() > 0U;}
+        unsigned get_num_underruns() const override {return underruns;}
+    private:
+        /** Main loop of the reader thread */
+        void read_thread();
+        /** Fill the fifo until it is full or the end of the sound is
+         * reached.  Called by the reader thread. */
+        void fill();
+        /** Read frames from the sound file.  Wraps around at the end of
+         * the file when looping, pads with zeros otherwise.
+         * @param buf    Receives frames * nch interleaved samples.
+         * @param frames Number of frames to read. */
+        void read_source(mha_real_t * buf, unsigned frames);
+        /** The sound file */
+        MHASndFile::sf_t file;
+        /** Number of channels in the sound file */
+        const unsigned int nch;
+        /** Indices of the MHA channels receiving the file channels */
+        const std::vector<int> playback_channels;
+        const bool loop;
+        /** Scaling of the sound samples as in MHASndFile::sf_wave_t */
+        const mha_real_t scale;
+        /** Number of frames of the complete (resampled) sound */
+        const unsigned int total_frames;
+        /** Number of frames placed into the fifo so far, not counting
+         * loop repetitions */
+        unsigned int produced = 0U;
+        /** Present when resampling, nullptr otherwise */
+        std::unique_ptr<MHAFilter::blockprocessing_polyphase_resampling_t>
+        resampling;
+        /** Block of frames read from the sound file */
+        MHASignal::waveform_t source_block;
+        /** Block of resampled frames */
+        MHASignal::waveform_t resampled_block;
+        /** Transports the sound to the signal processing thread */
+        mha_fifo_lf_t<mha_real_t> fifo;
+        /** Receives sound from the fifo in the signal processing thread */
+        MHASignal::waveform_t playback_block;
+        /** Set when all sound has been placed into the fifo */
+        std::atomic<bool> finished = {false};
+        /** Set by the destructor to terminate the reader thread */
+        std::atomic<bool> stop = {false};
+        /** Set when the reader thread has been woken up and has not yet
+         * refilled the fifo, avoids repeated notifications */
+        std::atomic<bool> notified = {false};
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        /** Number of blocks that could not be filled completely */
+        unsigned underruns = 0U;
+        std::thread reader;
+    };
+}
+
+/*
+ * Local Variables:
+ * compile-command: "make"
+ * c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,221 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "addsndfile.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace addsndfile;
+
+/** Plays a short sound file written by libsndfile through streamed_sndfile_t
+ *  and through the in-memory sndfile_t, and gives the tests access to the
+ *  fifo and the reader thread of the streamed source. */
+class streamed_sndfile_testing : public ::testing::Test {
+public:
+    static constexpr unsigned frames = 5000U;
+    static constexpr unsigned channels = 2U;
+    static constexpr unsigned fragsize = 64U;
+    static constexpr float srate = 16000.0f;
+
+    /** Name of the sound file, removed by the destructor */
+    std::string name;
+    /** Input and output signal of one block */
+    MHASignal::waveform_t signal{fragsize, channels};
+    /** Playback gain 1 */
+    MHASignal::waveform_t gain{1U, 1U};
+
+    streamed_sndfile_testing()
+    {
+#ifdef _WIN32
+        char templ[] = "addsndfile_test_XXXXXX";
+        if (_mktemp_s(templ, sizeof(templ)) == 0)
+            name = templ;
+#else
+        const char * tmp = std::getenv("TMPDIR");
+        std::string templ = std::string(tmp && *tmp ? tmp : "/tmp")
+            + "/addsndfile_test_XXXXXX";
+        std::vector<char> buf(templ.begin(), templ.end());
+        buf.push_back('\0');
+        const int fd = mkstemp(buf.data());
+        if (fd >= 0) {
+            close(fd);
+            name = buf.data();
+        }
+#endif
+        if (name.empty())
+            throw MHA_Error(__FILE__, __LINE__,
+                            "Cannot create a temporary file");
+        SF_INFO info = {};
+        info.samplerate = srate;
+        info.channels = channels;
+        info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+        SNDFILE * sf = sf_open(name.c_str(), SFM_WRITE, &info);
+        if (!sf)
+            throw MHA_Error(__FILE__, __LINE__, "Cannot write %s",
+                            name.c_str());
+        std::vector<float> samples(frames * channels);
+        for (unsigned k = 0; k < samples.size(); ++k)
+            samples[k] = (int((k * 7919U) % 2001U) - 1000) / 1024.0f;
+        sf_writef_float(sf, samples.data(), frames);
+        sf_close(sf);
+        gain.buf[0] = 1.0f;
+    }
+    ~streamed_sndfile_testing() {std::remove(name.c_str());}
+
+    std::unique_ptr<streamed_sndfile_t> streamed(bool loop,
+                                                 unsigned startpos = 0U)
+    {
+        std::vector<int> mapping;
+        int numchannels = 0;
+        // Shortest read-ahead buffer, the file is longer than the fifo
+        return std::make_unique<streamed_sndfile_t>
+            (name, loop, MHASignal::loop_wavefragment_t::relative,
+             std::vector<int>{0, 1}, channels, mapping, numchannels,
+             startpos, srate, DONT_RESAMPLE_STRICT, fragsize, 1e-3f);
+    }
+    std::unique_ptr<sndfile_t> loaded(bool loop, unsigned startpos = 0U)
+    {
+        std::vector<int> mapping;
+        int numchannels = 0;
+        return std::make_unique<sndfile_t>
+            (name, loop, MHASignal::loop_wavefragment_t::relative,
+             std::vector<int>{0, 1}, channels, mapping, numchannels,
+             startpos, srate, DONT_RESAMPLE_STRICT);
+    }
+    /** Output of the next block of source s, input signal discarded */
+    const MHASignal::waveform_t & play(source_t & s)
+    {
+        signal.assign(1.0f);
+        s.playback(&signal, MHASignal::loop_wavefragment_t::replace, &gain);
+        return signal;
+    }
+    /** Number of frames waiting in the fifo */
+    unsigned buffered(const streamed_sndfile_t & s) const
+    {return s.fifo.get_fill_count() / s.nch;}
+    /** Total capacity of the fifo in frames */
+    unsigned capacity(const streamed_sndfile_t & s) const
+    {return s.fifo.get_max_fill_count() / s.nch;}
+    /** Wait until the reader thread has buffered the next block, as it
+     *  does within one block period in real-time processing */
+    void wait_for_block(const streamed_sndfile_t & s) const
+    {
+        while (buffered(s) < fragsize && !s.finished.load())
+            std::this_thread::yield();
+    }
+    /** Keeps the reader thread from refilling the fifo while locked */
+    std::unique_lock<std::mutex> hold_reader(streamed_sndfile_t & s)
+    {return std::unique_lock<std::mutex>(s.mutex);}
+};
+
+TEST_F(streamed_sndfile_testing, looping_matches_loaded_sound_exactly)
+{
+    auto s = streamed(true, 100U);
+    auto l = loaded(true, 100U);
+    ASSERT_LT(capacity(*s), frames);
+    MHASignal::waveform_t expected(fragsize, channels);
+    // Several refills of the fifo and several loops through the file
+    for (unsigned block = 0; block < 4U * frames / fragsize; ++block) {
+        expected.copy(play(*l));
+        wait_for_block(*s);
+        const MHASignal::waveform_t & actual = play(*s);
+        for (unsigned k = 0; k < fragsize * channels; ++k)
+            ASSERT_EQ(expected.buf[k], actual.buf[k])
+                << "block " << block << " index " << k;
+        EXPECT_TRUE(s->is_playback_active());
+    }
+    EXPECT_EQ(0U, s->get_num_underruns());
+}
+
+TEST_F(streamed_sndfile_testing, stops_at_end_of_file_like_loaded_sound)
+{
+    auto s = streamed(false);
+    auto l = loaded(false);
+    MHASignal::waveform_t expected(fragsize, channels);
+    unsigned block = 0U;
+    for (; l->is_playback_active(); ++block) {
+        ASSERT_TRUE(s->is_playback_active()) << "block " << block;
+        expected.copy(play(*l));
+        wait_for_block(*s);
+        const MHASignal::waveform_t & actual = play(*s);
+        for (unsigned k = 0; k < fragsize * channels; ++k)
+            ASSERT_EQ(expected.buf[k], actual.buf[k])
+                << "block " << block << " index " << k;
+    }
+    EXPECT_EQ((frames + fragsize - 1U) / fragsize, block);
+    EXPECT_FALSE(s->is_playback_active());
+    // Silence after the end, which is not an underrun
+    const MHASignal::waveform_t & after = play(*s);
+    for (unsigned k = 0; k < fragsize * channels; ++k)
+        EXPECT_EQ(0.0f, after.buf[k]);
+    EXPECT_EQ(0U, s->get_num_underruns());
+}
+
+TEST_F(streamed_sndfile_testing, underrun_plays_silence_and_is_counted)
+{
+    auto s = streamed(true);
+    auto l = loaded(true);
+    MHASignal::waveform_t expected(fragsize, channels);
+    {
+        auto reader_held = hold_reader(*s);
+        // Play the buffered sound without refills
+        while (buffered(*s) >= fragsize) {
+            expected.copy(play(*l));
+            const MHASignal::waveform_t & actual = play(*s);
+            for (unsigned k = 0; k < fragsize * channels; ++k)
+                ASSERT_EQ(expected.buf[k], actual.buf[k]);
+        }
+        EXPECT_EQ(0U, s->get_num_underruns());
+        // The remainder of the fifo, then silence
+        const unsigned remainder = buffered(*s);
+        expected.copy(play(*l));
+        const MHASignal::waveform_t & partial = play(*s);
+        for (unsigned k = 0; k < fragsize * channels; ++k)
+            EXPECT_EQ(k < remainder * channels ? expected.buf[k] : 0.0f,
+                      partial.buf[k]);
+        EXPECT_EQ(1U, s->get_num_underruns());
+        const MHASignal::waveform_t & empty = play(*s);
+        for (unsigned k = 0; k < fragsize * channels; ++k)
+            EXPECT_EQ(0.0f, empty.buf[k]);
+        EXPECT_EQ(2U, s->get_num_underruns());
+        EXPECT_TRUE(s->is_playback_active());
+    }
+    // The reader thread continues where it stopped
+    wait_for_block(*s);
+    const unsigned position = (capacity(*s) / 1024U * 1024U) % frames;
+    auto after_underrun = loaded(true, position);
+    expected.copy(play(*after_underrun));
+    const MHASignal::waveform_t & actual = play(*s);
+    for (unsigned k = 0; k < fragsize * channels; ++k)
+        EXPECT_EQ(expected.buf[k], actual.buf[k]);
+    EXPECT_EQ(2U, s->get_num_underruns());
+}
+
+/*
+ * Local Variables:
+ * compile-command: "make -C .. unit-tests"
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * coding: utf-8-unix
+ * End:
+ */
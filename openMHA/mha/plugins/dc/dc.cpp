@@ -16,6 +16,8 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "dc.hh"
+#include "mha_simd.hh"
+#include <algorithm>
 
 using namespace dc;
 
@@ -45,6 +47,7 @@ void dc_if_t::update()
                                  tftype.channels,
                                  ac,
                                  tftype.domain,tftype.fftlen,
+                                 tftype.fragsize,
                                  broadband_audiochannels, algo,
                                  rmslevel_state, attack_state, decay_state));
         }
@@ -54,6 +57,7 @@ void dc_if_t::update()
                                  tftype.channels,
                                  ac,
                                  tftype.domain,tftype.fftlen,
+                                 tftype.fragsize,
                                  broadband_audiochannels, algo));
         }
     }
@@ -232,6 +236,7 @@ dc_t::dc_t(dc_vars_t vars,
            MHA_AC::algo_comm_t & ac,
            mha_domain_t domain,
            unsigned int fftlen_,
+           unsigned int fragsize,
            unsigned naudiochannels_,
            const std::string& algo,
            const std::vector<mha_real_t>& rmslevel_state,
@@ -264,7 +269,10 @@ dc_t::dc_t(dc_vars_t vars,
     nch(nch_),
     level_in_db(ac,algo+"_l_in",nbands,naudiochannels,false),
     level_in_db_adjusted(ac,algo+"_l_in_adj",nbands,naudiochannels,false),
-    fftlen(fftlen_)
+    fftlen(fftlen_),
+    block_processing(domain == MHA_WAVEFORM && vars.engine.data.get_value() == "block"),
+    block_level(block_processing ? fragsize : 0U, nch_),
+    block_gain(block_processing ? fragsize : 0U, nch_)
 {
     if( nbands * naudiochannels != nch )
         throw MHA_Error(__FILE__,__LINE__,
@@ -339,12 +347,19 @@ void dc_t::explicit_insert()
 mha_wave_t* dc_t::process(mha_wave_t* s)
 {
     explicit_insert();
-    mha_real_t level_in, gain;
-    unsigned int k, ch, kfb, idx, ch_idx = 0;
     if( s->num_channels != gt.size() )
         throw MHA_Error(__FILE__,__LINE__,
                         "The audio channel number changed from %zu to %u.",
                         gt.size(), s->num_channels);
+    if( block_processing )
+        return process_block(s);
+    return process_samples(s);
+}
+
+mha_wave_t* dc_t::process_samples(mha_wave_t* s)
+{
+    mha_real_t level_in, gain;
+    unsigned int k, ch, kfb, idx, ch_idx = 0;
     for(k=0;k<s->num_frames;k++){
         for(kfb=0;kfb<nbands;kfb++){
             for(ch=0;ch<naudiochannels;ch++){
@@ -366,6 +381,50 @@ mha_wave_t* dc_t::process(mha_wave_t* s)
     return s;
 }
 
+mha_wave_t* dc_t::process_block(mha_wave_t* s)
+{
+    if( s->num_frames > block_level.num_frames )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "The number of frames changed from %u to %u.",
+                        block_level.num_frames, s->num_frames);
+    if( s->num_frames == 0 )
+        return s;
+    const unsigned int n = s->num_frames * s->num_channels;
+    mha_wave_t level = block_level;
+    level.num_frames = s->num_frames;
+    mha_real_t * lev = level.buf;
+    unsigned int k, ch, kfb, idx, ch_idx;
+    // level estimation and conversion to dB for all samples
+    for(idx=0;idx<n;idx++)
+        lev[idx] = s->buf[idx]*s->buf[idx];
+    rmslevel(level, level);
+    MHASignal::pa22dbspl_fast(lev, lev, n);
+    const mha_real_t * last = lev + (s->num_frames-1) * s->num_channels;
+    for(kfb=0;kfb<nbands;kfb++)
+        for(ch=0;ch<naudiochannels;ch++)
+            level_in_db.value(kfb,ch) = last[kfb + nbands*ch];
+    attack(level, level);
+    decay(level, level);
+    for(kfb=0;kfb<nbands;kfb++)
+        for(ch=0;ch<naudiochannels;ch++)
+            level_in_db_adjusted.value(kfb,ch) = last[kfb + nbands*ch];
+    if (bypass) return s;
+    // gain table lookup, conversion and application
+    mha_real_t * gain = block_gain.buf;
+    if(offset.size())
+        for(k=0;k<s->num_frames;k++)
+            for(ch_idx=0;ch_idx<s->num_channels;ch_idx++)
+                lev[k*s->num_channels + ch_idx] += offset[ch_idx];
+    for(ch_idx=0;ch_idx<s->num_channels;ch_idx++)
+        gt[ch_idx].interp(lev + ch_idx, gain + ch_idx,
+                          s->num_frames, s->num_channels);
+    if(log_interp)
+        MHASignal::db2lin_fast(gain, gain, n);
+    for(idx=0;idx<n;idx++)
+        s->buf[idx] *= std::max(gain[idx], 0.0f);
+    return s;
+}
+
 mha_spec_t* dc_t::process(mha_spec_t* s)
 {
     explicit_insert();
@@ -434,6 +493,14 @@ dc_vars_t::dc_vars_t(MHAParser::parser_t& p)
       chname("name of audio channel number variable (empty: broadband)",""),
       bypass("bypass dynamic compression", "no"),
       log_interp("use logarithmic interpolation of gaintable entries","no"),
+      engine("Implementation of waveform processing.\n"
+             "block: Each processing stage for all samples of a block, using\n"
+             "  vectorized approximations of the dB conversions and a vectorized\n"
+             "  gain table interpolation.  The levels deviate by less than\n"
+             "  5e-5 dB, the gains from logarithmic interpolation by less than\n"
+             "  4e-6 (relative) from \"sample\".\n"
+             "sample: All processing stages sample by sample.",
+             "sample", "[sample block]"),
       clientid("Client ID of last fit",""),
       gainrule("Gain rule of last fit",""),
       preset("Preset name of last fit",""),
@@ -456,6 +523,7 @@ dc_vars_t::dc_vars_t(MHAParser::parser_t& p)
     p.insert_member(chname);
     p.insert_member(bypass);
     p.insert_member(log_interp);
+    p.insert_member(engine);
     p.insert_member(clientid);
     p.insert_member(gainrule);
     p.insert_member(preset);
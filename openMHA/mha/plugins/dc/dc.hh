@@ -76,6 +76,10 @@ namespace dc {
     MHAParser::bool_t bypass;
     /** Interpolate gain table in dBs (vs. interpolating linear factors). */
     MHAParser::bool_t log_interp;
+    /** Implementation of waveform processing: "block" processes each stage
+     * for all samples of a block with vectorized dB conversions, "sample"
+     * is the exact sample-by-sample implementation. */
+    MHAParser::kw_t engine;
     /** Metadata: Some ID of the hearing impaired subject. */
     MHAParser::string_t clientid;
     /** Metadata: Some name of the gain rule that was used to compute gtdata.*/
@@ -123,6 +127,8 @@ namespace dc {
          *           will not interact with it.
          * @param domain \c MHA_WAVEFORM or \c MHA_SPECTRUM.
          * @param fftlen FFT length used for STFT processing, in samples.
+         * @param fragsize Number of frames per block, needed to allocate
+         *                 the buffers of block processing.
          * @param naudiochannels_  Number of broadband audio channels
          *                         (before the upstream filterbank).
          * @param configured_name The configured name of this plugin in the MHA
@@ -137,6 +143,7 @@ namespace dc {
              MHA_AC::algo_comm_t & ac,
              mha_domain_t domain,
              unsigned int fftlen,
+             unsigned int fragsize,
              unsigned int naudiochannels_,
              const std::string& configured_name,
              const std::vector<mha_real_t>& rmslevel_state={},
@@ -186,6 +193,18 @@ namespace dc {
         }
 
     private:
+        /** Waveform processing sample by sample, all stages for one
+         * sample before the next sample.
+         * @param s Latest block of time-domain input signal.
+         * @return s after modifying the signal in place. */
+        mha_wave_t* process_samples(mha_wave_t* s);
+        /** Waveform processing block by block: Each stage (level filters,
+         * dB conversion, gain table lookup, gain conversion and application)
+         * is done for all samples and bands of the block before the next
+         * stage, using the vectorized fast dB conversions of libmha.
+         * @param s Latest block of time-domain input signal.
+         * @return s after modifying the signal in place. */
+        mha_wave_t* process_block(mha_wave_t* s);
         /** Dynamic compression gains. If \c log_interp is true, then they are
          * stored as dB gains, otherwise they are stored as linear gains. */
         std::vector<MHATableLookup::linear_table_t> gt;
@@ -214,6 +233,14 @@ namespace dc {
         MHA_AC::waveform_t level_in_db_adjusted;
         /** FFT length in samples, required for computing levels correctly. */
         unsigned int fftlen;
+        /** Use process_block for waveform processing. */
+        bool block_processing;
+        /** Levels of all samples and bands of the current block, used by
+         * process_block. */
+        MHASignal::waveform_t block_level;
+        /** Gains of all samples and bands of the current block, used by
+         * process_block. */
+        MHASignal::waveform_t block_gain;
     };
 
   /** Plugin interface class of the dynamic compression plugin \c dc. */
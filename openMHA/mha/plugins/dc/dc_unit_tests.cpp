@@ -18,6 +18,8 @@
 #include "mha_signal.hh"
 #include "mha_algo_comm.hh"
 #include <gtest/gtest.h>
+#include <cmath>
+#include <random>
 
 class dc_if_t_testing : public ::testing::Test {
 protected:
@@ -170,6 +172,73 @@ TEST_F(dc_if_t_testing,log_interp){
   acspace.set_prepared(false);
 }
 
+namespace {
+  /// Process the same signal with both waveform engines of dc and
+  /// compare outputs and monitored levels.
+  void compare_engines(const std::string & log_interp)
+  {
+    mhaconfig_t cfg = {.channels = 8U, .domain = MHA_WAVEFORM,
+                       .fragsize = 64U, .wndlen = 0U, .fftlen = 0U,
+                       .srate = 16000.0f};
+    // 2 broadband channels with 4 bands each
+    int broadband_channels = 2;
+    MHA_AC::algo_comm_class_t acspace_sample, acspace_block;
+    acspace_sample.insert_var_int("nch", &broadband_channels);
+    acspace_block.insert_var_int("nch", &broadband_channels);
+    dc::dc_if_t sample{acspace_sample, "dc"}, block{acspace_block, "dc"};
+    for (dc::dc_if_t * dc : {&sample, &block}) {
+      dc->parse("gtdata=[[0 10 20 25];[30 20 10 5];[40 40 40 40];"
+                "[5 0 -5 -10];[0 10 20 25];[30 20 10 5];[40 40 40 40];"
+                "[5 0 -5 -10]]");
+      dc->parse("gtmin=[0 20 40 60 0 20 40 60]");
+      dc->parse("gtstep=[30]");
+      dc->parse("tau_rmslev=[0.005]");
+      dc->parse("tau_attack=[0.002]");
+      dc->parse("tau_decay=[0.05]");
+      dc->parse("level_offset=[0 1 2 3 -3 -2 -1 0]");
+      dc->parse("chname=nch");
+      dc->parse("log_interp=" + log_interp);
+    }
+    sample.parse("engine=sample");
+    block.parse("engine=block");
+    mhaconfig_t cfg_sample = cfg, cfg_block = cfg;
+    sample.prepare_(cfg_sample);
+    block.prepare_(cfg_block);
+    std::mt19937 gen(1);
+    std::normal_distribution<mha_real_t> noise;
+    // Blocks of noise at different levels, including silence
+    for (mha_real_t level : {20.0f, 60.0f, 100.0f, 45.0f, -200.0f, 80.0f}) {
+      MHASignal::waveform_t in_sample{cfg.fragsize, cfg.channels};
+      for (unsigned k = 0; k < cfg.fragsize * cfg.channels; ++k)
+        in_sample.buf[k] = noise(gen) * MHASignal::dbspl2pa(level);
+      MHASignal::waveform_t in_block{in_sample};
+      mha_wave_t * out_sample = sample.process(&in_sample);
+      mha_wave_t * out_block = block.process(&in_block);
+      for (unsigned k = 0; k < cfg.fragsize * cfg.channels; ++k)
+        ASSERT_NEAR(out_sample->buf[k], out_block->buf[k],
+                    std::fabs(out_sample->buf[k]) * 2e-5f)
+          << "level=" << level << " k=" << k;
+      for (unsigned ch = 0; ch < cfg.channels; ++ch) {
+        EXPECT_NEAR(sample.input_level.data[ch],
+                    block.input_level.data[ch], 5e-5f);
+        EXPECT_NEAR(sample.filtered_level.data[ch],
+                    block.filtered_level.data[ch], 5e-5f);
+      }
+    }
+    sample.release_();
+    block.release_();
+  }
+}
+
+TEST(dc_t, block_engine_matches_sample_engine_with_linear_interpolation)
+{
+  compare_engines("no");
+}
+
+TEST(dc_t, block_engine_matches_sample_engine_with_logarithmic_interpolation)
+{
+  compare_engines("yes");
+}
 
 
 // Local Variables:
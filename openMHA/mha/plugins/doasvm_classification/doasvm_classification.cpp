@@ -21,6 +21,9 @@
  */
 
 #include "doasvm_classification.h"
+#include "mha_simd.hh"
+#include "mha_vecmath.hh"
+#include <algorithm>
 
 #define PATCH_VAR(var) patchbay.connect(&var.valuechanged, this, &doasvm_classification::update_cfg)
 #define INSERT_PATCH(var) insert_member(var); PATCH_VAR(var)
@@ -32,47 +35,79 @@ doasvm_classification_config(MHA_AC::algo_comm_t & ac,
     doasvm(_doasvm),
     p(ac, _doasvm->p_name.data.c_str(), _doasvm->angles.data.size(), 1, false),
     p_max(ac, _doasvm->max_p_ind_name.data.c_str(),
-          (_doasvm->angles.data.size() - 1) / 2, false)
+          (_doasvm->angles.data.size() - 1) / 2, false),
+    num_directions(_doasvm->angles.data.size()),
+    num_features(_doasvm->w.data.empty() ? 0 : _doasvm->w.data[0].size()),
+    stride((num_directions + 7U) / 8U * 8U),
+    weights(size_t(stride) * num_features, 0.0f),
+    bias(_doasvm->b.data.begin(), _doasvm->b.data.end()),
+    sigmoid_offset(num_directions),
+    sigmoid_slope(num_directions),
+    c(stride, 0.0f)
 {
     //initialize plugin state for a new configuration
-    c.num_frames = _doasvm->w.data.size(); // number of rows of w
-    if( (c.buf = new mha_real_t[c.num_frames]) == 0 )
+    const auto & w = _doasvm->w.data;
+    if (w.size() != num_directions || bias.size() != num_directions ||
+        _doasvm->x.data.size() != num_directions ||
+        _doasvm->y.data.size() != num_directions)
         throw MHA_Error(__FILE__, __LINE__,
-                        "Error initialising c.buf.");
- }
+                        "The SVM model needs one row of w and one entry of"
+                        " b, x, and y for each of the %u angles"
+                        " (w has %zu rows, b has %zu, x has %zu, y has %zu"
+                        " entries).", num_directions, w.size(), bias.size(),
+                        _doasvm->x.data.size(), _doasvm->y.data.size());
+
+    // Pack the separation planes column by column, so that all SVMs
+    // are evaluated together as one matrix-vector product
+    for (unsigned i = 0; i < num_directions; ++i) {
+        if (w[i].size() != num_features)
+            throw MHA_Error(__FILE__, __LINE__,
+                            "Row %u of w has %zu entries, row 0 has %u.",
+                            i, w[i].size(), num_features);
+        for (unsigned j = 0; j < num_features; ++j)
+            weights[size_t(j) * stride + i] = w[i][j];
+    }
+
+    // The sigmoid is 1/(1+exp(-(x+c*y)))
+    std::copy(_doasvm->x.data.begin(), _doasvm->x.data.end(),
+              sigmoid_offset.begin());
+    std::copy(_doasvm->y.data.begin(), _doasvm->y.data.end(),
+              sigmoid_slope.begin());
+}
 
-doasvm_classification_config::~doasvm_classification_config() {delete c.buf;}
+doasvm_classification_config::~doasvm_classification_config() {}
 
 //the actual processing implementation
 mha_wave_t *doasvm_classification_config::process(mha_wave_t *wave)
 {
     //do actual processing here using configuration state
     const mha_wave_t vGCC = MHA_AC::get_var_waveform(ac, doasvm->vGCC_name.data.c_str());
+    if (vGCC.num_frames * vGCC.num_channels != num_features)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "The SVM model expects %u features, but AC variable"
+                        " \"%s\" has %u values.", num_features,
+                        doasvm->vGCC_name.data.c_str(),
+                        vGCC.num_frames * vGCC.num_channels);
 
     // Apply linear SVM model (one for each direction) to feature vector
-    for( size_t i = 0; i < doasvm->w.data.size(); ++i ) {
-        c.buf[i] = doasvm->b.data[i];
-        for( size_t j = 0; j < doasvm->w.data[i].size(); ++j )
-            c.buf[i] += doasvm->w.data[i][j]*vGCC.buf[j];
-    }
-
-    for( unsigned int i = 0; i < p.num_frames; ++i )
-        p(i, 0) =  1/(1 + std::exp(-(doasvm->x.data[i] + c.buf[i]*doasvm->y.data[i])));
-
+    std::copy(bias.begin(), bias.end(), c.begin());
+    MHASignal::mac_columns(c.data(), weights.data(), stride, vGCC.buf,
+                           num_features, num_directions);
 
     // map to probability using a sigmoid transformation
+    for (unsigned int i = 0; i < num_directions; ++i)
+        p.buf[i] = sigmoid_offset[i] + c[i] * sigmoid_slope[i];
+    MHASignal::vec_sigmoid(p.buf, p.buf, num_directions,
+                           MHASignal::vecmath_accuracy_t::FAST);
+
     // find the max probability
     mha_real_t max = 0;
     int  max_ind = -1;
-    for( unsigned int i = 0; i < p.num_frames; ++i ) {
-        p(i, 0) =  1/(1 + std::exp(-(doasvm->x.data[i] + c.buf[i]*doasvm->y.data[i])));
-
-
+    for( unsigned int i = 0; i < num_directions; ++i ) {
         // Find the direction with the maximum probability
-        if (max < p.value(i, 0)) {
-            max = p.value(i, 0);
+        if (max < p.buf[i]) {
+            max = p.buf[i];
             max_ind = i;
-
         }
     }
 
@@ -131,11 +166,6 @@ void doasvm_classification::prepare(mhaconfig_t & signal_info)
         throw MHA_Error(__FILE__, __LINE__,
                         "This plug-in requires time-domain signals.");
 
-    if( signal_info.channels != 2 )
-        throw MHA_Error(__FILE__, __LINE__,
-                        "This input signal must have exactly 2 channels, not %u.",
-                        signal_info.channels);
-
     /* make sure that a valid runtime configuration exists: */
     update_cfg();
     poll_config()->insert_ac_variables();
@@ -185,7 +215,15 @@ MHAPLUGIN_DOCUMENTATION\
  " the probabilities for given range of directions of arrival (DOA).\n"
  "These probabilities take a value within the interval of $[0,1]$."
  " Higher probability for a certain DOA indicates higher possibility"
- " of a source coming from that particular DOA."
+ " of a source coming from that particular DOA.\n"
+ "At configuration time, the separation planes {\\bf w} of all"
+ " directions are packed into one contiguous matrix, so that the"
+ " decision values of all directions are computed together as one"
+ " vectorized matrix-vector product with the feature vector read from"
+ " the AC variable {\\bf vGCC\\_name}, followed by a vectorized"
+ " sigmoid transformation.  This is cheap enough to classify every"
+ " audio block.  The number of audio channels is not restricted, the"
+ " audio signal is passed through unaltered."
  )
 
 // Local Variables:
@@ -18,6 +18,7 @@
 #define DOASVM_CLASSIFICATION_H
 
 #include "mha_plugin.hh"
+#include <vector>
 
 class doasvm_classification;
 
@@ -37,8 +38,24 @@ public:
     doasvm_classification *doasvm;
     MHA_AC::waveform_t p;
     MHA_AC::int_t p_max;
-    mha_wave_t c;
 
+    /// Number of directions, i.e. of linear SVMs
+    unsigned num_directions;
+    /// Number of features, i.e. length of the GCC vector
+    unsigned num_features;
+    /// Distance between two columns of the packed weights, a multiple
+    /// of 8 values
+    unsigned stride;
+    /// Weights of all SVMs, column-major: the weights of all
+    /// directions for the first feature, then for the second, ...
+    std::vector<mha_real_t> weights;
+    /// Bias of the SVMs
+    std::vector<mha_real_t> bias;
+    /// Sigmoid parameters x and y
+    std::vector<mha_real_t> sigmoid_offset;
+    std::vector<mha_real_t> sigmoid_slope;
+    /// Decision values of the SVMs
+    std::vector<mha_real_t> c;
 };
 
 class doasvm_classification : public MHAPlugin::plugin_t<doasvm_classification_config> {
@@ -15,16 +15,24 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 /*
- * This plugin computes the GCC-PHAT given the stereo time domain
- * signal, which is forwarded to the next plugin in the chain
- * unaltered.
+ * This plugin computes the GCC-PHAT of all pairs of channels of the
+ * time domain signal, which is forwarded to the next plugin in the
+ * chain unaltered.
  */
 
 #include "doasvm_feature_extraction.h"
+#include <cstdlib>
 
 #define PATCH_VAR(var) patchbay.connect(&var.valuechanged, this, &doasvm_feature_extraction::update_cfg)
 #define INSERT_PATCH(var) insert_member(var); PATCH_VAR(var)
 
+namespace {
+    unsigned int num_pairs(unsigned int channels)
+    {
+        return channels * (channels - 1) / 2;
+    }
+}
+
 doasvm_feature_extraction_config::
 doasvm_feature_extraction_config(MHA_AC::algo_comm_t & ac,
                                  const mhaconfig_t in_cfg,
@@ -33,20 +41,31 @@ doasvm_feature_extraction_config(MHA_AC::algo_comm_t & ac,
     , wndlen(in_cfg.fragsize)
     , fftlen(_doagcc->fftlen.data)
     , G_length(fftlen / 2 + 1)
+    , GCC_length(2*_doagcc->max_lag.data * _doagcc->nupsample.data + 1)
     , vGCC_ac(ac,
               _doagcc->vGCC_name.data.c_str(),
-              2*_doagcc->max_lag.data * _doagcc->nupsample.data + 1,
+              GCC_length * num_pairs(in_cfg.channels),
               1,
               true)
     , hifftwin_sum(0)
-    , proc_wave(fftlen, 2)
+    , proc_wave(fftlen, in_cfg.channels)
     , hwin(fftlen, 1)
     , hifftwin(G_length, 1)
-    , vGCC(fftlen * _doagcc->nupsample.data, 1)
-    , in_spec(G_length, 2)
-    , G(fftlen * _doagcc->nupsample.data, 1)
+    , vGCC(fftlen * _doagcc->nupsample.data, num_pairs(in_cfg.channels))
+    , in_spec(G_length, in_cfg.channels)
+    , G(fftlen * _doagcc->nupsample.data / 2 + 1, num_pairs(in_cfg.channels))
 {
     //initialize plugin state for a new configuration
+    if( wndlen > fftlen )
+        throw MHA_Error(__FILE__, __LINE__,
+                        "The FFT length (%u) must not be shorter than the"
+                        " fragment size (%u).", fftlen, wndlen);
+
+    for( unsigned int a = 0; a < in_cfg.channels; ++a )
+        for( unsigned int b = a + 1; b < in_cfg.channels; ++b ) {
+            pair_first.push_back(a);
+            pair_second.push_back(b);
+        }
 
     // initialize the Hanning window for the FFT
     mha_wave_t _hwin;
@@ -57,7 +76,7 @@ doasvm_feature_extraction_config(MHA_AC::algo_comm_t & ac,
         throw MHA_Error(__FILE__, __LINE__, "Error initialising the window function.");
 
     hwin.copy(_hwin);
-    delete[] _hwin.buf;
+    free(_hwin.buf);
 
     // initialize the Hanning window for the IFFT
     mha_wave_t _hifftwin;
@@ -68,21 +87,22 @@ doasvm_feature_extraction_config(MHA_AC::algo_comm_t & ac,
 
     hifftwin.copy_from_at(0, G_length, _hifftwin, G_length);
     hifftwin.scale_channel(0, G_length / hifftwin.sum_channel(0) * _doagcc->nupsample.data);
-    delete[] _hifftwin.buf;
+    free(_hifftwin.buf);
 
     // initialize the input waveform for processing with zeros (including the zero padding)
     proc_wave.assign(0);
 
-    // initialize the GCC output matrix with zeros (including the upscaling)
-    for (unsigned int f=0; f < G.num_frames; ++f)
-        G(f,0) = mha_complex(0,0);
+    // initialize the GCC spectra with zeros (including the upscaling)
+    for (unsigned int f=0; f < G.num_frames * G.num_channels; ++f)
+        G.buf[f] = mha_complex(0,0);
 
-    // initialize the FFT function
-    if( (fft = mha_fft_new(fftlen)) == 0 )
+    // initialize the FFT function, which transforms all microphones
+    // in one call
+    if( (fft = mha_fft_new(fftlen, in_cfg.channels)) == 0 )
         throw MHA_Error(__FILE__, __LINE__, "Error initialising the FFT function.");
 
-    // intialize the IFFT function
-    if( (ifft = mha_fft_new(G.num_frames)) == 0 )
+    // intialize the IFFT function, which transforms all pairs in one call
+    if( (ifft = mha_fft_new(vGCC.num_frames, vGCC.num_channels)) == 0 )
         throw MHA_Error(__FILE__, __LINE__, "Error initialising the IFFT function.");
 
     // compute the portion of the full GCC matrix, which is within the max_lag interval
@@ -90,50 +110,57 @@ doasvm_feature_extraction_config(MHA_AC::algo_comm_t & ac,
     GCC_end = (vGCC.num_frames + 1)/2 + _doagcc->max_lag.data * _doagcc->nupsample.data;
 }
 
-doasvm_feature_extraction_config::~doasvm_feature_extraction_config() {}
+doasvm_feature_extraction_config::~doasvm_feature_extraction_config()
+{
+    mha_fft_free(fft);
+    mha_fft_free(ifft);
+}
 
 //the actual processing implementation
 mha_wave_t *doasvm_feature_extraction_config::process(mha_wave_t *wave)
 {
     //do actual processing here using configuration state
-    memcpy(proc_wave.buf, wave->buf, wave->num_frames * wave->num_channels*sizeof(float));
+    const unsigned int channels = wave->num_channels;
+    memcpy(proc_wave.buf, wave->buf, wave->num_frames * channels * sizeof(float));
 
-    for( unsigned int i = 0; i < wave->num_frames; ++i ) {
-        proc_wave.buf[i * 2] *= hwin[i];
-        proc_wave.buf[i * 2 + 1] *= hwin[i];
-    }
+    for( unsigned int i = 0; i < wave->num_frames; ++i )
+        for( unsigned int ch = 0; ch < channels; ++ch )
+            proc_wave.buf[i * channels + ch] *= hwin[i];
 
     mha_fft_wave2spec_scale(fft, &proc_wave, &in_spec);
 
-    for( unsigned int i = 0; i < G_length; ++i ) {
-        // compute the cross correlation
-        G(i, 0) = value(in_spec, i, 0) * _conjugate(value(in_spec, i, 1));
-
-        /* apply PHAT weighting
-         *
-         * Does the zero guard make sense, or is it better to explicitly deal
-         * with NaNs?
-         */
-        G[i] /= abs(G[i]) + 1e-15;
-
-        // apply ifft window
-        G(i, 0) = value(G, i, 0) * value(hifftwin, i, 0);
+    for( unsigned int pair = 0; pair < pair_first.size(); ++pair ) {
+        const mha_complex_t * X = in_spec.buf + pair_first[pair] * G_length;
+        const mha_complex_t * Y = in_spec.buf + pair_second[pair] * G_length;
+        mha_complex_t * Gp = G.buf + pair * G.num_frames;
+        for( unsigned int i = 0; i < G_length; ++i ) {
+            // compute the cross correlation
+            Gp[i] = X[i] * _conjugate(Y[i]);
+
+            /* apply PHAT weighting
+             *
+             * Does the zero guard make sense, or is it better to explicitly deal
+             * with NaNs?
+             */
+            Gp[i] /= abs(Gp[i]) + 1e-15;
+
+            // apply ifft window
+            Gp[i] *= hifftwin.buf[i];
+        }
     }
 
-    // reconstruct mirror frequencies
-    const unsigned int G_offset = fftlen % 2; // even = 0, odd = 1
-    for( unsigned int i = G_length - 2 + G_offset; i > 0; --i )
-        G(G.num_frames - i, 0) = _conjugate(value(G, i, 0));
-
-    // ifft and swap halves of csd to compensate for fftshift
+    // ifft of all pairs.  The inverse FFT uses only the non-negative
+    // frequencies, the mirror frequencies need not be reconstructed.
     mha_fft_spec2wave_scale(ifft, &G, &vGCC);
 
-    ifftshift(&vGCC);
-
     // compute bins according to physically expedient range of delay values and
-    // keep only that part of the GCC fucntion
-    for( unsigned int i = GCC_start; i <= GCC_end; ++i )
-        vGCC_ac[i-GCC_start] = vGCC.buf[i];
+    // keep only that part of the GCC function.  The halves of the GCC
+    // function are swapped to compensate for fftshift.
+    const unsigned int shift = vGCC.num_frames / 2;
+    for( unsigned int pair = 0; pair < vGCC.num_channels; ++pair )
+        for( unsigned int i = GCC_start; i <= GCC_end; ++i )
+            vGCC_ac[pair * GCC_length + i - GCC_start] =
+                vGCC((i + shift) % vGCC.num_frames, pair);
 
     //return current fragment
     return wave;
@@ -171,10 +198,10 @@ doasvm_feature_extraction::~doasvm_feature_extraction() {}
 void doasvm_feature_extraction::prepare(mhaconfig_t & signal_info)
 {
     //good idea: restrict input type and dimension
-    if (signal_info.channels != 2)
+    if (signal_info.channels < 2)
         throw MHA_Error(__FILE__, __LINE__,
-                        "This plugin must have 2 input channels: (%u found)\n"
-                        "[Left, Right].", signal_info.channels);
+                        "This plugin needs at least 2 input channels"
+                        " (%u found).", signal_info.channels);
 
     if (signal_info.domain != MHA_WAVEFORM)
         throw MHA_Error(__FILE__, __LINE__,
@@ -226,8 +253,18 @@ MHAPLUGIN_DOCUMENTATION\
  "spatial feature-extraction binaural",
  "This plugin computes the generalized cross correlation with phase"
  " transform (GCC-PHAT)."
- " The input to this plugin is a stereo time domain signal."
- " The GCC-PHAT matrix is saved into the AC space."
+ " The input to this plugin is a time domain signal with two or more"
+ " microphone channels, e.g. a stereo signal or the signal of a"
+ " 4-microphone array."
+ " The GCC-PHAT is computed for every pair of microphones, in the"
+ " order (1,2), (1,3), ..., (1,N), (2,3), ..., (N-1,N)."
+ " The spectra of all microphones are computed in one batched FFT, and"
+ " the GCC functions of all pairs in one batched inverse FFT."
+ " The GCC-PHAT vectors of all pairs, each with $2 \\cdot$ {\\bf max\\_lag}"
+ " $\\cdot$ {\\bf nupsample} $+ 1$ values, are saved one after another"
+ " into the AC variable {\\bf vGCC\\_name}."
+ " For two channels, this is the single GCC-PHAT vector of the stereo"
+ " signal."
  )
 
 // Local Variables:
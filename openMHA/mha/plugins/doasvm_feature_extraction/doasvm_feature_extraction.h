@@ -20,7 +20,7 @@
 #include "mha_plugin.hh"
 #include <mha_toolbox.h>
 #include "hann.h"
-#include "ifftshift.h"
+#include <vector>
 
 class doasvm_feature_extraction;
 
@@ -43,6 +43,13 @@ public:
     unsigned int G_length;
     unsigned int GCC_start;
     unsigned int GCC_end;
+    /// Number of GCC values per microphone pair
+    unsigned int GCC_length;
+
+    /// First and second microphone of each pair, in the order
+    /// (0,1), (0,2), ..., (0,N-1), (1,2), ...
+    std::vector<unsigned int> pair_first;
+    std::vector<unsigned int> pair_second;
 
     MHA_AC::waveform_t vGCC_ac;
 
@@ -43,7 +43,7 @@ gsc_adaptive_stage(MHA_AC::algo_comm_t & ac,
   lenNewSamps( in_cfg.fragsize ), //use the fragsize for lenNewSamps
   bufSize( lenOldSamps+lenNewSamps ),
   frac_old( (float) lenOldSamps / (float) (lenNewSamps + lenOldSamps) ),
-  mha_fft( mha_fft_new(bufSize) ),
+  mha_fft( mha_fft_new(bufSize, in_cfg.channels-1) ),
   nfreq( bufSize/2+1 ),
   //convention: last channel is desired signal; VAD comes in via AC
   nchan( in_cfg.channels-1 ), //extra input channels
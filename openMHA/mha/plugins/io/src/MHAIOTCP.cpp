@@ -18,10 +18,24 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
+#include <vector>
 #include "mha_io_ifc.h"
 #include "mha_toolbox.h"
 #include "mha_signal.hh"
 
+#ifdef __linux__
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 #define ERR_SUCCESS 0
 #define ERR_IHANDLE -1
 #define ERR_USER -1000
@@ -62,6 +76,12 @@ class io_tcp_parser_t : public MHAParser::parser_t
     /** Display the tcp port used by the current sound data client. */
     MHAParser::int_mon_t peer_port;
 
+    /** Maximum number of simultaneously connected clients. */
+    MHAParser::int_t max_sessions;
+
+    /** Number of connected clients waiting for their turn. */
+    MHAParser::int_mon_t sessions_waiting;
+
     /** filename to write debugging info to (if non-empty) */
     MHAParser::string_t debug_filename;
     
@@ -128,6 +148,16 @@ public:
      * @post @see get_connected returns true. */
     virtual void set_new_peer(unsigned short port,
                               const std::string & host);
+
+    /** Read parser variable max_sessions.
+     * @return The maximum number of simultaneously connected clients,
+     *         including the client currently served. */
+    virtual unsigned get_max_sessions() const
+    { return static_cast<unsigned>(max_sessions.data); }
+
+    /** Publish the number of clients waiting for their turn. */
+    virtual void set_sessions_waiting(unsigned waiting)
+    { sessions_waiting.data = static_cast<int>(waiting); }
 public:
     /** Constructor initializes parser variables. */
     io_tcp_parser_t();
@@ -135,6 +165,11 @@ public:
     /** Do-nothing destructor. */
     virtual ~io_tcp_parser_t() {}
 
+    /** Check if debug messages are written.  Callers should check
+     * this before formatting debug messages in the data path. */
+    virtual bool debugging() const
+    { return debug_file || debug_filename.data.length() > 0U; }
+
     virtual void debug(const std::string & message) {
         if ((debug_file == 0) && (debug_filename.data.length() > 0U))
                 debug_file = fopen(debug_filename.data.c_str(),"a");
@@ -231,6 +266,15 @@ io_tcp_parser_t::io_tcp_parser_t()
       connected("Status of tcp connection"),
       peer_address("IP address of remote computer"),
       peer_port("Remote tcp port of connection"),
+      max_sessions("Maximum number of simultaneously connected clients.\n"
+                   "  Clients are served one after the other in the order\n"
+                   "in which they connected, the audio header is sent to\n"
+                   "a client when its turn begins.  Clients connecting\n"
+                   "while this limit is reached are disconnected at once.\n"
+                   "  Only used on Linux, other platforms serve a single\n"
+                   "client and let further clients wait in the listen queue.",
+                   "16", "[1,]"),
+      sessions_waiting("Number of connected clients waiting for their turn"),
       debug_filename("debug messages of MHAIOTCP will be written to this file if non-empty",""),
       debug_file(NULL)
 {
@@ -242,6 +286,9 @@ io_tcp_parser_t::io_tcp_parser_t()
     insert_item("peer_address", &peer_address);
     peer_port.data = 0;
     insert_item("peer_port", &peer_port);
+    sessions_waiting.data = 0;
+    insert_item("sessions_waiting", &sessions_waiting);
+    insert_item("max_sessions", &max_sessions);
     insert_item("address", &local_address);
     insert_item("port", &local_port);
     insert_member(debug_filename);
@@ -264,8 +311,9 @@ private:
      * returned by signal processing callback. */
     int num_inchannels, num_outchannels;
 
-    /** Storage for input signal. */
-    MHASignal::waveform_t* s_in;
+    /** Input signal structure.  Its buffer points to the chunk of
+     * received sound data, which is converted in place. */
+    mha_wave_t s_in;
 
     /** This union helps in conversion of floats from host byte
      * order to network byte order and back again. */
@@ -292,13 +340,12 @@ public:
     /** Do-nothing destructor */
     virtual ~io_tcp_sound_t() {}
 
-    /** Called during prepare, sets number of audio channels and allocates
-     * sound data storage.
+    /** Called during prepare, sets number of audio channels.
      * @param num_inchannels  Number of input audio channels.
      * @param num_outchannels Number of output audio channels. */
     virtual void prepare(int num_inchannels, int num_outchannels);
 
-    /** Called during release.  Deletes sound data storage. */
+    /** Called during release. */
     virtual void release();
 
     /** Number of bytes that constitute one input sound chunk. 
@@ -306,20 +353,31 @@ public:
      *          signal processing. */
     virtual int chunkbytes_in() const;
 
+    /** Number of bytes that constitute one output sound chunk.
+     * @return Number of bytes sent to the TCP connection after each
+     *         invocation of the signal processing. */
+    virtual int chunkbytes_out() const;
+
     /** Create the tcp sound header lines. */
     virtual std::string header() const;
 
-    /** Copy data received from tcp into mha_wave_t structure.  
-     * Doing network-to-host byte order swapping in the process.
-     * @param data One chunk (@see chunkbytes_in) of sound data to process.
-     * @return Pointer to the sound data storage. */
-    virtual mha_wave_t * ntoh(const std::string & data);
-
-    /** Copy sound data from the output sound structure to a string.  
-     * Doing host-to-network byte order swapping while at it.
+    /** Convert one chunk of sound data received from tcp in place
+     * from network to host byte order.
+     * @param data One chunk (@see chunkbytes_in) of sound data to
+     *             process.  Must be aligned for mha_real_t.  The
+     *             data is overwritten with the converted samples.
+     * @return Pointer to the input signal structure, which refers
+     *         to data. */
+    virtual mha_wave_t * ntoh(char * data);
+
+    /** Copy sound data from the output sound structure to the
+     * output buffer.  Doing host-to-network byte order swapping
+     * while at it.
      * @param s_out Pointer to the storage of the sound to put out.
-     * @return The sound data in network byte order. */
-    virtual std::string hton(const mha_wave_t * s_out);
+     * @param data Destination of chunkbytes_out() bytes.
+     * @throw MHA_Error if the dimensions of s_out do not match the
+     *        number of output channels and fragsize. */
+    virtual void hton(const mha_wave_t * s_out, char * data) const;
 };
 
 io_tcp_sound_t::io_tcp_sound_t(int _fragsize, float _samplerate)
@@ -327,7 +385,7 @@ io_tcp_sound_t::io_tcp_sound_t(int _fragsize, float _samplerate)
       samplerate(_samplerate),
       num_inchannels(0),
       num_outchannels(0),
-      s_in(0)
+      s_in()
 {
     if (fragsize <= 0)
         throw MHA_Error(__FILE__, __LINE__,
@@ -353,9 +411,9 @@ void io_tcp_sound_t::check_sound_data_type()
 
 void io_tcp_sound_t::prepare(int num_inchannels, int num_outchannels)
 {
-    if (s_in != 0)
+    if (s_in.num_channels != 0)
         throw MHA_ErrorMsg("Prepare called although "\
-                         "waveform structure is already allocated");
+                         "sound data handling is already prepared");
     this->num_inchannels = num_inchannels;
     if (num_inchannels <= 0)
         throw MHA_ErrorMsg2("Number of input channels has to be positive, "\
@@ -364,13 +422,13 @@ void io_tcp_sound_t::prepare(int num_inchannels, int num_outchannels)
     if (num_outchannels < 0)
         throw MHA_ErrorMsg2("Number of output channels has to be positive, "\
                           "but was %d", num_outchannels);
-    s_in = new MHASignal::waveform_t(fragsize,num_inchannels);
+    s_in.num_channels = num_inchannels;
+    s_in.num_frames = fragsize;
 }
 
 void io_tcp_sound_t::release()
 {
-    delete s_in;
-    s_in = 0;
+    s_in = mha_wave_t();
     num_inchannels = num_outchannels = 0;
 }
 
@@ -379,6 +437,11 @@ int io_tcp_sound_t::chunkbytes_in() const
     return num_inchannels * fragsize * sizeof(mha_real_t);
 }
 
+int io_tcp_sound_t::chunkbytes_out() const
+{
+    return num_outchannels * fragsize * sizeof(mha_real_t);
+}
+
 std::string io_tcp_sound_t::header() const
 {
     // tcp sound metadata, followed by 1 blank line
@@ -392,34 +455,32 @@ std::string io_tcp_sound_t::header() const
     return o.str();
 }
 
-mha_wave_t * io_tcp_sound_t::ntoh(const std::string & data)
+mha_wave_t * io_tcp_sound_t::ntoh(char * data)
 {
-    assert(chunkbytes_in() >= 0 &&
-           data.length() == unsigned(chunkbytes_in()));
-    assert(fragsize >= 0 &&
-           s_in->num_frames == unsigned(fragsize));
-    assert(num_inchannels >= 0 &&
-           s_in->num_channels == unsigned(num_inchannels));
-    const float_union * src = 
-        reinterpret_cast<const float_union *>(data.data());
-    float_union * dst =  reinterpret_cast<float_union*>(s_in->buf);
-    // byteorder swap if needed
+    assert(s_in.num_channels == unsigned(num_inchannels));
+    float_union * samples = reinterpret_cast<float_union *>(data);
+    // byteorder swap in place if needed
     for (unsigned k = 0; k < size(s_in); ++k)
-        dst[k].i = ntohl(src[k].i);
-    return s_in;
+        samples[k].i = ntohl(samples[k].i);
+    s_in.buf = reinterpret_cast<mha_real_t *>(data);
+    return &s_in;
 }
-    
 
-std::string io_tcp_sound_t::hton(const mha_wave_t * s_out)
+void io_tcp_sound_t::hton(const mha_wave_t * s_out, char * data) const
 {
-    std::vector<char> output_data(s_out->num_frames * s_out->num_channels *
-                                  sizeof(mha_real_t));
-    float_union * dst = reinterpret_cast<float_union *>(&output_data[0]);
+    if (s_out == 0 || s_out->num_channels != unsigned(num_outchannels)
+        || s_out->num_frames != unsigned(fragsize))
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Processing returned a signal with %u channels and"
+                        " %u frames, expected %d channels and %d frames",
+                        s_out ? s_out->num_channels : 0U,
+                        s_out ? s_out->num_frames : 0U,
+                        num_outchannels, fragsize);
+    float_union * dst = reinterpret_cast<float_union *>(data);
     const float_union * src =
         reinterpret_cast<const float_union *>(s_out->buf);
     for (unsigned k = 0; k < size(s_out); ++k)
         dst[k].i = htonl(src[k].i);
-    return std::string(&output_data[0], size(s_out) * sizeof(mha_real_t));
 }
 
 /* ========================================================================= */
@@ -523,8 +584,557 @@ void io_tcp_fwcb_t::set_errnos(int proc_err, int io_err)
     this->io_err = io_err;
 }
 
+static int copy_error(MHA_Error& e) {
+    strncpy(user_err_msg, Getmsg(e), MAX_USER_ERR-1);
+    user_err_msg[MAX_USER_ERR-1] = '\0';
+    return ERR_USER;
+}
+
+#ifdef __linux__
+/* ========================================================================= */
+/** The tcp sound io library, Linux implementation.
+ *
+ * A single IO thread waits with epoll for incoming connections, for
+ * sound data from the client currently served, and for requests from
+ * the framework.  Further clients that connect while one is served
+ * wait in a queue and are served in the order of their connection.
+ * The data path does not allocate memory while the client reads its
+ * output: Received bytes are collected in an input ring buffer of
+ * whole chunks and converted to samples in place, the processed chunks
+ * are converted into an output ring buffer, and the buffered output is
+ * sent with a single system call.  A client that sends all of its
+ * input before reading the output must not be blocked, therefore the
+ * output ring buffer grows when it is full and the socket does not
+ * accept more data. */
+class io_tcp_t
+{
+public:
+    io_tcp_t(int fragsize, float samplerate,
+             IOProcessEvent_t proc_event, void* proc_handle,
+             IOStartedEvent_t start_event, void* start_handle,
+             IOStoppedEvent_t stop_event, void* stop_handle);
+
+    /** Allocate buffers and server socket and start the IO thread
+     * waiting for sound data exchange */
+    void prepare(int num_inchannels, int num_outchannels);
+
+    /** Call frameworks start callback if there is a sound data connection
+     * at the moment. */
+    void start();
+
+    /** Close the current connection if there is one.  The next waiting
+     * client is served afterwards. */
+    void stop();
+
+    /** Close all connections and the server socket. */
+    void release();
+
+    /** IO thread executes this method. */
+    virtual void io_loop();
+
+    /** Parser interface. */
+    virtual void parse(const char* cmd, char* retval, unsigned int len)
+    { parser.parse(cmd, retval, len); }
+
+    virtual ~io_tcp_t();
+private:
+    /** Requests from the framework to the IO thread. */
+    enum { REQUEST_START = 1U, REQUEST_STOP = 2U, REQUEST_RELEASE = 4U };
+
+    /** epoll user data of the notification descriptor and of the server
+     * socket.  The connection currently served is identified by its
+     * session number, which is larger. */
+    enum : uint64_t { ID_NOTIFY = 0U, ID_SERVER = 1U };
+
+    /** Number of chunks that fit into the input ring buffer and,
+     * initially, into the output ring buffer. */
+    static constexpr unsigned buffered_chunks = 16U;
+
+    /** Pass a request to the IO thread. */
+    void notify(unsigned request);
+
+    /** Accept all pending connections into the waiting queue. */
+    void accept_clients();
+
+    /** Start serving the next waiting client, if there is one. */
+    void begin_session();
+
+    /** Close the connection currently served and inform the framework.
+     * @param proc_err Error number from the processing callback.
+     * @param io_err   Error number from this io library. */
+    void end_session(int proc_err, int io_err);
+
+    /** Exchange sound data with the client currently served.
+     * @param readable Whether epoll reported the connection readable. */
+    void serve(bool readable);
+
+    /** Send as much of the header and of the buffered output as the
+     * socket accepts without blocking. */
+    void transmit();
+
+    /** Double the capacity of the output ring buffer, keeping its
+     * contents. */
+    void grow_output();
+
+    /** Adjust the events that epoll watches on the current connection. */
+    void watch_session();
+
+    /** Close server socket, epoll and notification descriptors. */
+    void close_descriptors();
+
+    size_t input_capacity() const
+    { return input.size() * sizeof(mha_real_t); }
+    size_t output_capacity() const
+    { return output.size() * sizeof(mha_real_t); }
+
+    io_tcp_parser_t parser;
+    io_tcp_sound_t sound;
+    io_tcp_fwcb_t fwcb;
+    MHA_TCP::Server * server;
+    int epoll_fd;
+    /** eventfd that wakes up the IO thread when requests are pending. */
+    int notify_fd;
+    std::atomic<unsigned> requests;
+    std::thread thread;
+    /** Connected clients waiting for their turn. */
+    std::deque<std::unique_ptr<MHA_TCP::Connection> > waiting;
+    /** The client currently served, or empty. */
+    std::unique_ptr<MHA_TCP::Connection> session;
+    /** Number of the current session, its epoll user data. */
+    uint64_t session_id;
+    /** Events currently watched on the session's socket. */
+    uint32_t session_events;
+    /** Whether the client has finished sending. */
+    bool peer_finished;
+    std::string header;
+    size_t header_sent;
+    /** Ring buffer of received sound data, holds whole chunks. */
+    std::vector<mha_real_t> input;
+    /** Ring buffer of processed sound data, holds whole chunks. */
+    std::vector<mha_real_t> output;
+    /** Start and amount of buffered data in bytes. */
+    size_t input_begin, input_fill, output_begin, output_fill;
+};
+
+io_tcp_t::io_tcp_t(int _fragsize, float _samplerate,
+                   IOProcessEvent_t proc_event, void* proc_handle,
+                   IOStartedEvent_t start_event, void* start_handle,
+                   IOStoppedEvent_t stop_event, void* stop_handle)
+    : sound(_fragsize, _samplerate),
+      fwcb(proc_event, proc_handle, start_event, start_handle,
+           stop_event, stop_handle),
+      server(0), epoll_fd(-1), notify_fd(-1), requests(0U),
+      session_id(ID_SERVER), session_events(0U), peer_finished(false),
+      header_sent(0U), input_begin(0U), input_fill(0U),
+      output_begin(0U), output_fill(0U)
+{}
+
+io_tcp_t::~io_tcp_t()
+{
+    if (thread.joinable()) {
+        try {
+            release();
+        }
+        catch (MHA_Error &) {
+        }
+    }
+}
+
+void io_tcp_t::close_descriptors()
+{
+    if (notify_fd >= 0)
+        close(notify_fd);
+    notify_fd = -1;
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    epoll_fd = -1;
+    delete server;
+    server = 0;
+}
+
+/** prepare opens the tcp server socket and starts the io thread that
+ *  listens for audio data on the tcp socket after doing some sanity
+ *  checks */
+void io_tcp_t::prepare(int num_inchannels, int num_outchannels)
+{
+    if (parser.get_server_port_open())
+        throw MHA_ErrorMsg("Prepare called although "\
+                           "server port is already open");
+    if (parser.get_connected())
+        throw MHA_ErrorMsg("Prepare called although "\
+                           "status of TCP io connection is \"connected\"");
+    if (server != 0)
+        throw MHA_ErrorMsg("Prepare called although "\
+                           "TCP Server is already allocated");
+    if (thread.joinable())
+        throw MHA_ErrorMsg("Prepare called although "\
+                           "IO thread is already running");
+    sound.prepare(num_inchannels, num_outchannels);
+    try {
+        input.assign(buffered_chunks * sound.chunkbytes_in()
+                     / sizeof(mha_real_t), 0.0f);
+        output.assign(buffered_chunks * sound.chunkbytes_out()
+                      / sizeof(mha_real_t), 0.0f);
+        header = sound.header();
+        parser.debug("opening server");
+        server = new MHA_TCP::Server(parser.get_local_port(),
+                                     parser.get_local_address());
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            throw MHA_Error(__FILE__, __LINE__, "epoll_create1 failed: %s",
+                            MHA_TCP::STRERROR(errno).c_str());
+        notify_fd = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (notify_fd < 0)
+            throw MHA_Error(__FILE__, __LINE__, "eventfd failed: %s",
+                            MHA_TCP::STRERROR(errno).c_str());
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = ID_NOTIFY;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, notify_fd, &ev) < 0)
+            throw MHA_Error(__FILE__, __LINE__, "epoll_ctl failed: %s",
+                            MHA_TCP::STRERROR(errno).c_str());
+        const int server_fd = server->get_accept_event()->get_os_event().fd;
+        // MHA_TCP::Server allows only one pending connection.  Raise
+        // the backlog so that clients connecting at the same time are
+        // not delayed by retransmissions of their connection requests.
+        if (listen(server_fd, parser.get_max_sessions()) < 0)
+            throw MHA_Error(__FILE__, __LINE__, "listen failed: %s",
+                            MHA_TCP::STRERROR(errno).c_str());
+        ev.data.u64 = ID_SERVER;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) < 0)
+            throw MHA_Error(__FILE__, __LINE__, "epoll_ctl failed: %s",
+                            MHA_TCP::STRERROR(errno).c_str());
+    }
+    catch (MHA_Error &) {
+        close_descriptors();
+        sound.release();
+        throw;
+    }
+    parser.set_server_port_open(true);
+    if (parser.get_local_port() != server->get_port())
+        parser.set_local_port(server->get_port());
+    parser.debug("starting thread");
+    requests = 0U;
+    thread = std::thread(&io_tcp_t::io_loop, this);
+}
+
+void io_tcp_t::notify(unsigned request)
+{
+    requests.fetch_or(request);
+    const uint64_t one = 1U;
+    if (write(notify_fd, &one, sizeof(one)) != sizeof(one))
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Cannot notify the TCP IO thread: %s",
+                        MHA_TCP::STRERROR(errno).c_str());
+}
+
+void io_tcp_t::io_loop()
+{
+    parser.debug("io_loop()");
+    int io_err = 0;
+    try {
+        epoll_event events[8];
+        for (;;) {
+            const int n = epoll_wait(epoll_fd, events, 8, -1);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw MHA_Error(__FILE__, __LINE__, "epoll_wait failed: %s",
+                                MHA_TCP::STRERROR(errno).c_str());
+            }
+            for (int k = 0; k < n; ++k) {
+                const uint64_t id = events[k].data.u64;
+                if (id == ID_NOTIFY) {
+                    uint64_t count;
+                    if (read(notify_fd, &count, sizeof(count)) < 0
+                        && errno != EAGAIN)
+                        throw MHA_Error(__FILE__, __LINE__,
+                                        "Reading eventfd failed: %s",
+                                        MHA_TCP::STRERROR(errno).c_str());
+                    const unsigned r = requests.exchange(0U);
+                    if (r & REQUEST_RELEASE) {
+                        parser.debug("io_loop received release");
+                        goto disconnect;
+                    }
+                    if ((r & REQUEST_STOP) && session) {
+                        parser.debug("io_loop received stop");
+                        end_session(0, 0);
+                    }
+                    if ((r & REQUEST_START) && session)
+                        fwcb.start();
+                }
+                else if (id == ID_SERVER)
+                    accept_clients();
+                else if (session && id == session_id) {
+                    try {
+                        serve(events[k].events
+                              & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR));
+                    }
+                    catch (MHA_Error & e) {
+                        parser.debug(Getmsg(e));
+                        if (session)
+                            end_session(0, copy_error(e));
+                    }
+                }
+            }
+            if (!session)
+                begin_session();
+            if (session)
+                watch_session();
+        }
+    }
+    catch (MHA_Error & e) {
+        parser.debug(Getmsg(e));
+        io_err = copy_error(e);
+    }
+ disconnect:
+    if (session)
+        end_session(0, io_err);
+    waiting.clear();
+    parser.set_sessions_waiting(0U);
+    parser.debug("io_loop returns");
+}
+
+void io_tcp_t::accept_clients()
+{
+    for (;;) {
+        std::unique_ptr<MHA_TCP::Connection> client;
+        try {
+            client.reset(server->try_accept());
+        }
+        catch (MHA_Error & e) {
+            // e.g. the client has already disconnected again
+            parser.debug(Getmsg(e));
+            return;
+        }
+        if (!client)
+            return;
+        if (waiting.size() + (session ? 1U : 0U)
+            >= parser.get_max_sessions()) {
+            parser.debug("rejecting client, too many sessions");
+            continue;
+        }
+        waiting.push_back(std::move(client));
+        parser.set_sessions_waiting(waiting.size());
+    }
+}
+
+void io_tcp_t::begin_session()
+{
+    while (!session && !waiting.empty()) {
+        session = std::move(waiting.front());
+        waiting.pop_front();
+        parser.set_sessions_waiting(waiting.size());
+        const int fd = session->get_fd();
+        const int flags = fcntl(fd, F_GETFL);
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u64 = ++session_id;
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0
+            || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            parser.debug("cannot serve client: "
+                         + MHA_TCP::STRERROR(errno));
+            session.reset();
+            continue;
+        }
+        session_events = ev.events;
+        peer_finished = false;
+        header_sent = 0U;
+        input_begin = input_fill = output_begin = output_fill = 0U;
+        // Return memory of an output buffer grown by a previous client
+        const size_t initial_output =
+            buffered_chunks * sound.chunkbytes_out() / sizeof(mha_real_t);
+        if (output.size() != initial_output)
+            std::vector<mha_real_t>(initial_output, 0.0f).swap(output);
+        parser.set_new_peer(session->get_peer_port(),
+                            session->get_peer_address());
+        fwcb.start();
+    }
+}
+
+void io_tcp_t::end_session(int proc_err, int io_err)
+{
+    parser.debug("closing connection");
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, session->get_fd(), 0);
+    session.reset();
+    parser.set_connected(false);
+    fwcb.set_errnos(proc_err, io_err);
+    fwcb.stop();
+}
+
+void io_tcp_t::serve(bool readable)
+{
+    transmit();
+    char * in = reinterpret_cast<char *>(input.data());
+    const size_t chunk_in = sound.chunkbytes_in();
+    const size_t chunk_out = sound.chunkbytes_out();
+    if (readable && !peer_finished && input_fill < input_capacity()) {
+        // Read into the free space up to the end of the ring buffer.
+        // The buffer holds whole chunks, so that chunks never wrap.
+        const size_t end = (input_begin + input_fill) % input_capacity();
+        const ssize_t n =
+            recv(session->get_fd(), in + end,
+                 std::min(input_capacity() - end,
+                          input_capacity() - input_fill), 0);
+        if (n > 0)
+            input_fill += n;
+        else if (n == 0)
+            peer_finished = true;
+        else if (errno != EAGAIN && errno != EINTR)
+            throw MHA_Error(__FILE__, __LINE__,
+                            "Reading from TCP connection failed: %s",
+                            MHA_TCP::STRERROR(errno).c_str());
+    }
+    while (input_fill >= chunk_in) {
+        if (output_fill + chunk_out > output_capacity()) {
+            // The client does not read its output, e.g. because it
+            // sends all of its input first.  Stopping to read its input
+            // here could deadlock both sides, keep the output instead.
+            transmit();
+            if (output_fill + chunk_out > output_capacity())
+                grow_output();
+        }
+        mha_wave_t * s_out = 0;
+        const int status = fwcb.process(sound.ntoh(in + input_begin), s_out);
+        input_begin = (input_begin + chunk_in) % input_capacity();
+        input_fill -= chunk_in;
+        if (status != 0) {
+            end_session(status, 0);
+            return;
+        }
+        if (chunk_out) {
+            char * out = reinterpret_cast<char *>(output.data());
+            sound.hton(s_out, out + (output_begin + output_fill)
+                       % output_capacity());
+            output_fill += chunk_out;
+        }
+    }
+    if (input_fill == 0U)
+        input_begin = 0U;
+    transmit();
+    // A trailing incomplete chunk is discarded
+    if (peer_finished && input_fill < chunk_in && output_fill == 0U
+        && header_sent == header.size())
+        end_session(0, 0);
+}
+
+void io_tcp_t::transmit()
+{
+    iovec iov[3];
+    int count = 0;
+    if (header_sent < header.size()) {
+        iov[count].iov_base = &header[header_sent];
+        iov[count++].iov_len = header.size() - header_sent;
+    }
+    if (output_fill > 0U) {
+        char * out = reinterpret_cast<char *>(output.data());
+        const size_t first =
+            std::min(output_fill, output_capacity() - output_begin);
+        iov[count].iov_base = out + output_begin;
+        iov[count++].iov_len = first;
+        if (first < output_fill) {
+            iov[count].iov_base = out;
+            iov[count++].iov_len = output_fill - first;
+        }
+    }
+    if (count == 0)
+        return;
+    msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    ssize_t n;
+    do {
+        n = sendmsg(session->get_fd(), &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        if (errno == EAGAIN)
+            return;
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Writing to TCP connection failed: %s",
+                        MHA_TCP::STRERROR(errno).c_str());
+    }
+    size_t sent = n;
+    const size_t from_header = std::min(sent, header.size() - header_sent);
+    header_sent += from_header;
+    sent -= from_header;
+    output_fill -= sent;
+    output_begin = output_fill ? (output_begin + sent) % output_capacity()
+                               : 0U;
+}
+
+void io_tcp_t::grow_output()
+{
+    std::vector<mha_real_t> grown(2U * output.size(), 0.0f);
+    const char * out = reinterpret_cast<const char *>(output.data());
+    char * dest = reinterpret_cast<char *>(grown.data());
+    // Partial sends leave output_begin anywhere, but the end of the
+    // buffered data is at a chunk boundary.  Keep it there, so that
+    // chunks never wrap around the end of the grown buffer.
+    const size_t chunk_out = sound.chunkbytes_out();
+    const size_t begin = (chunk_out - output_fill % chunk_out) % chunk_out;
+    const size_t first =
+        std::min(output_fill, output_capacity() - output_begin);
+    memcpy(dest + begin, out + output_begin, first);
+    memcpy(dest + begin + first, out, output_fill - first);
+    output.swap(grown);
+    output_begin = begin;
+}
+
+void io_tcp_t::watch_session()
+{
+    uint32_t events = 0U;
+    if (!peer_finished && input_fill < input_capacity())
+        events |= EPOLLIN;
+    if (output_fill > 0U || header_sent < header.size())
+        events |= EPOLLOUT;
+    if (events == session_events)
+        return;
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = session_id;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session->get_fd(), &ev) < 0)
+        throw MHA_Error(__FILE__, __LINE__, "epoll_ctl failed: %s",
+                        MHA_TCP::STRERROR(errno).c_str());
+    session_events = events;
+}
+
+void io_tcp_t::start()
+{
+    if (parser.get_server_port_open() == false)
+        throw MHA_ErrorMsg("Start called although "\
+                           "server port is closed");
+    notify(REQUEST_START);
+}
+
+/** stop IO thread */
+void io_tcp_t::stop()
+{
+    if (thread.joinable())
+        notify(REQUEST_STOP);
+}
+
+/** Stop IO thread and close server socket */
+void io_tcp_t::release()
+{
+    parser.debug("release()");
+    if (thread.joinable()) {
+        notify(REQUEST_RELEASE);
+        parser.debug("release waits for thread termination");
+        thread.join();
+    }
+    close_descriptors();
+    if (parser.get_server_port_open())
+        parser.set_server_port_open(false);
+    input.clear();
+    output.clear();
+    sound.release();
+    parser.debug("release returns");
+}
+
+#else
 /* ========================================================================= */
-/** The tcp sound io library. */
+/** The tcp sound io library, portable implementation serving one
+ * client at a time. */
 class io_tcp_t
 {
 public:
@@ -567,14 +1177,11 @@ private:
     MHA_TCP::Server * server;
     MHA_TCP::Thread * thread;
     MHA_TCP::Async_Notify notify_start, notify_stop, notify_release;
+    /** Storage for one chunk of input and output sound data. */
+    std::vector<mha_real_t> chunk_in;
+    std::string chunk_out;
 };
 
-static int copy_error(MHA_Error& e) {
-    strncpy(user_err_msg, Getmsg(e), MAX_USER_ERR-1);
-    user_err_msg[MAX_USER_ERR-1] = '\0';
-    return ERR_USER;
-}
-
 static void * thread_startup_function(void * parameter) {
     io_tcp_t * io_tcp = static_cast<io_tcp_t *>(parameter);
     io_tcp->accept_loop();
@@ -609,6 +1216,8 @@ void io_tcp_t::prepare(int num_inchannels, int num_outchannels)
         throw MHA_ErrorMsg("Prepare called although "\
                            "IO thread is already allocated");
     sound.prepare(num_inchannels, num_outchannels);
+    chunk_in.resize(sound.chunkbytes_in() / sizeof(mha_real_t));
+    chunk_out.resize(sound.chunkbytes_out());
     parser.debug("opening server");
     server = new MHA_TCP::Server(parser.get_local_port(), parser.get_local_address());
     parser.set_server_port_open(true);
@@ -677,7 +1286,8 @@ void io_tcp_t::connection_loop(MHA_TCP::Connection * c) {
         else {
             parser.debug("connection_loop: currently no further writes necessary");
         }
-        parser.debug("connection_loop waits with buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
+        if (parser.debugging())
+            parser.debug("connection_loop waits with buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
         std::set<Wakeup_Event *> s = w.wait();
         if (s.find(&notify_release) != s.end()
             || s.find(&notify_stop) != s.end()) {
@@ -712,20 +1322,32 @@ void io_tcp_t::connection_loop(MHA_TCP::Connection * c) {
                     parser.debug("connection_loop can read another chunk");
                     mha_wave_t * s_out = 0;
                     parser.debug("connection_loop processes chunk");
-                    int status = fwcb.process(sound.ntoh(c->read_bytes(sound.chunkbytes_in())), s_out);
+                    const std::string data =
+                        c->read_bytes(sound.chunkbytes_in());
+                    memcpy(chunk_in.data(), data.data(), data.size());
+                    char * samples = reinterpret_cast<char *>(chunk_in.data());
+                    int status = fwcb.process(sound.ntoh(samples), s_out);
                     if (status != 0) {
                         fwcb.set_errnos(status, 0);
                         goto terminate_connection;
                     }
                     parser.debug("connection_loop tries to write chunk result");
-                    c->try_write(sound.hton(s_out));
+                    try {
+                        sound.hton(s_out, &chunk_out[0]);
+                    }
+                    catch (MHA_Error & e) {
+                        fwcb.set_errnos(0, copy_error(e));
+                        goto terminate_connection;
+                    }
+                    c->try_write(chunk_out);
                 }
                 parser.debug("connection_loop checks for eof");
                 if (c->eof()) {
                     parser.debug("connection_loop got eof");
                     goto terminate_connection_cleanly;
                 }
-                                parser.debug("After EOF check, buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
+                if (parser.debugging())
+                    parser.debug("After EOF check, buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
             }
         }
         if (s.find(c->get_write_event()) != s.end()) {
@@ -771,9 +1393,13 @@ void io_tcp_t::release()
     delete thread; 
     thread=0;
     sound.release();
+    chunk_in.clear();
+    chunk_out.clear();
     parser.debug("release returns");
 }
 
+#endif
+
 /* ========================================================================= */
 /* IOLIB interface */
 #ifdef MHA_STATIC_PLUGINS
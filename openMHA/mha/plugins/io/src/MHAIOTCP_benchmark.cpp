@@ -0,0 +1,215 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file MHAIOTCP_benchmark.cpp
+ * Measures the throughput of the TCP sound io library in chunks per
+ * second.  The io library is loaded like the framework does, with
+ * a processing callback that returns its input unchanged.  Several
+ * clients connect at the same time and stream their chunks as fast
+ * as the io library accepts them, keeping a few chunks in flight.
+ * To compare against another build of the io library, point
+ * MHA_LIBRARY_PATH to the directory containing it.
+ *
+ * Usage: MHAIOTCP_benchmark [sessions [chunks [fragsize [channels]]]]
+ */
+
+#include "mha_io_ifc.h"
+#include "mha_os.h"
+#include "mha_error.hh"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    /** Number of chunks a client sends ahead of the processed ones. */
+    constexpr unsigned chunks_in_flight = 4U;
+
+    int identity(void *, mha_wave_t * s_in, mha_wave_t ** s_out)
+    {
+        *s_out = s_in;
+        return 0;
+    }
+
+    void started(void *) {}
+
+    void stopped(void *, int proc_err, int io_err)
+    {
+        if (proc_err || io_err)
+            fprintf(stderr, "session stopped with errors %d %d\n",
+                    proc_err, io_err);
+    }
+
+    void send_all(int fd, const char * data, size_t len)
+    {
+        while (len) {
+            const ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+            if (n <= 0)
+                throw MHA_Error(__FILE__, __LINE__, "send failed");
+            data += n;
+            len -= n;
+        }
+    }
+
+    void recv_all(int fd, char * data, size_t len)
+    {
+        while (len) {
+            const ssize_t n = recv(fd, data, len, 0);
+            if (n <= 0)
+                throw MHA_Error(__FILE__, __LINE__, "recv failed");
+            data += n;
+            len -= n;
+        }
+    }
+
+    /** One client session: read the header, stream the chunks, and
+     * check that the last chunk comes back unchanged. */
+    void session(unsigned short port, unsigned chunks, size_t chunkbytes,
+                 bool * ok)
+    {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)))
+            throw MHA_Error(__FILE__, __LINE__, "connect failed");
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::string header;
+        char c;
+        while (header.size() < 2U
+               || header.compare(header.size() - 2U, 2U, "\n\n")) {
+            recv_all(fd, &c, 1U);
+            header += c;
+        }
+        std::vector<char> in(chunkbytes), out(chunkbytes);
+        for (size_t k = 0; k < chunkbytes; ++k)
+            in[k] = static_cast<char>(k * 7U);
+        unsigned sent = 0U;
+        for (; sent < chunks && sent < chunks_in_flight; ++sent)
+            send_all(fd, in.data(), chunkbytes);
+        for (unsigned received = 0U; received < chunks; ++received) {
+            recv_all(fd, out.data(), chunkbytes);
+            if (sent < chunks) {
+                send_all(fd, in.data(), chunkbytes);
+                ++sent;
+            }
+        }
+        *ok = out == in;
+        close(fd);
+    }
+
+    void client(unsigned short port, unsigned chunks, size_t chunkbytes,
+                bool * ok)
+    {
+        try {
+            session(port, chunks, chunkbytes, ok);
+        }
+        catch (MHA_Error & e) {
+            fprintf(stderr, "Client error: %s\n", Getmsg(e));
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const unsigned sessions = argc > 1 ? atoi(argv[1]) : 4U;
+    const unsigned chunks = argc > 2 ? atoi(argv[2]) : 100000U;
+    const int fragsize = argc > 3 ? atoi(argv[3]) : 64;
+    const int channels = argc > 4 ? atoi(argv[4]) : 2;
+    try {
+        dynamiclib_t lib("MHAIOTCP");
+        auto io_init = reinterpret_cast<IOInit_t>
+            (lib.resolve_checked("MHA_DYNAMIC_IOInit"));
+        auto io_prepare = reinterpret_cast<IOPrepare_t>
+            (lib.resolve_checked("MHA_DYNAMIC_IOPrepare"));
+        auto io_start = reinterpret_cast<IOStart_t>
+            (lib.resolve_checked("MHA_DYNAMIC_IOStart"));
+        auto io_release = reinterpret_cast<IORelease_t>
+            (lib.resolve_checked("MHA_DYNAMIC_IORelease"));
+        auto io_setvar = reinterpret_cast<IOSetVar_t>
+            (lib.resolve_checked("MHA_DYNAMIC_IOSetVar"));
+        auto io_strerror = reinterpret_cast<IOStrError_t>
+            (lib.resolve_checked("MHA_DYNAMIC_IOStrError"));
+        auto io_destroy = reinterpret_cast<IODestroy_t>
+            (lib.resolve_checked("MHA_DYNAMIC_IODestroy"));
+        void * handle = 0;
+        int dummy = 0;
+        char retval[256];
+        auto check = [&](int err) {
+            if (err)
+                throw MHA_Error(__FILE__, __LINE__, "%s",
+                                io_strerror(handle, err));
+        };
+        check(io_init(fragsize, 48000.0f, identity, &dummy, started, &dummy,
+                      stopped, &dummy, &handle));
+        check(io_setvar(handle, "port = 0", retval, sizeof(retval)));
+        check(io_setvar(handle, "address = 127.0.0.1", retval,
+                        sizeof(retval)));
+        // Builds serving only one client at a time do not know
+        // max_sessions, ignore the error.
+        snprintf(retval, sizeof(retval), "max_sessions = %u", sessions);
+        io_setvar(handle, retval, retval, sizeof(retval));
+        check(io_prepare(handle, channels, channels));
+        check(io_setvar(handle, "port?val", retval, sizeof(retval)));
+        const unsigned short port = atoi(retval);
+        check(io_start(handle));
+
+        const size_t chunkbytes = fragsize * channels * sizeof(float);
+        std::vector<std::thread> clients;
+        std::unique_ptr<bool[]> ok(new bool[sessions]());
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned k = 0U; k < sessions; ++k)
+            clients.emplace_back(client, port, chunks, chunkbytes,
+                                 &ok[k]);
+        for (auto & t : clients)
+            t.join();
+        const double seconds = std::chrono::duration<double>
+            (std::chrono::steady_clock::now() - start).count();
+        check(io_release(handle));
+        io_destroy(handle);
+
+        unsigned failed = 0U;
+        for (unsigned k = 0U; k < sessions; ++k)
+            failed += !ok[k];
+        printf("%u sessions x %u chunks of %d frames x %d channels:"
+               " %.3f s, %.0f chunks/s%s\n",
+               sessions, chunks, fragsize, channels, seconds,
+               sessions * double(chunks) / seconds,
+               failed ? ", OUTPUT MISMATCH" : "");
+        return failed ? 1 : 0;
+    }
+    catch (MHA_Error & e) {
+        fprintf(stderr, "Error: %s\n", Getmsg(e));
+        return 1;
+    }
+}
+
+// Local Variables:
+// mode: c++
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,143 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "mha_io_ifc.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <string>
+#include <vector>
+
+extern "C" {
+  int MHA_DYNAMIC_IOInit(int fragsize, float samplerate,
+                         IOProcessEvent_t proc_event, void* proc_handle,
+                         IOStartedEvent_t start_event, void* start_handle,
+                         IOStoppedEvent_t stop_event, void* stop_handle,
+                         void** handle);
+  int MHA_DYNAMIC_IOPrepare(void* handle, int num_inchannels,
+                            int num_outchannels);
+  int MHA_DYNAMIC_IOStart(void* handle);
+  int MHA_DYNAMIC_IORelease(void* handle);
+  int MHA_DYNAMIC_IOSetVar(void* handle, const char* cmd,
+                           char* retval, unsigned int len);
+  void MHA_DYNAMIC_IODestroy(void* handle);
+}
+
+namespace {
+  // Processing callback that doubles every sample
+  int twice(void *, mha_wave_t * s_in, mha_wave_t ** s_out)
+  {
+    for (unsigned k = 0; k < s_in->num_frames * s_in->num_channels; ++k)
+      s_in->buf[k] *= 2.0f;
+    *s_out = s_in;
+    return 0;
+  }
+  void started(void *) {}
+  void stopped(void *, int, int) {}
+
+  // Network byte order float
+  uint32_t to_net(float f)
+  {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return htonl(u);
+  }
+  float from_net(uint32_t u)
+  {
+    u = ntohl(u);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+  }
+}
+
+#ifdef __linux__
+TEST(MHAIOTCP, client_may_send_all_input_before_reading_output)
+{
+  const int fragsize = 256, channels = 2;
+  void * handle = nullptr;
+  int cb_handle = 0;
+  char retval[256];
+  ASSERT_EQ(0, MHA_DYNAMIC_IOInit(fragsize, 16000.0f, twice, &cb_handle,
+                                  started, &cb_handle, stopped, &cb_handle,
+                                  &handle));
+  ASSERT_EQ(0, MHA_DYNAMIC_IOSetVar(handle, "port = 0",
+                                    retval, sizeof(retval)));
+  ASSERT_EQ(0, MHA_DYNAMIC_IOSetVar(handle, "address = 127.0.0.1",
+                                    retval, sizeof(retval)));
+  ASSERT_EQ(0, MHA_DYNAMIC_IOPrepare(handle, channels, channels));
+  ASSERT_EQ(0, MHA_DYNAMIC_IOSetVar(handle, "port?val",
+                                    retval, sizeof(retval)));
+  const unsigned short port = atoi(retval);
+  ASSERT_EQ(0, MHA_DYNAMIC_IOStart(handle));
+
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(0, connect(fd, reinterpret_cast<sockaddr *>(&addr),
+                       sizeof(addr)));
+  // Much more data than the initial output ring buffer of 16 chunks
+  // and the socket buffers can hold
+  const unsigned chunks = 20000U;
+  std::vector<uint32_t> input(chunks * fragsize * channels);
+  for (size_t k = 0; k < input.size(); ++k)
+    input[k] = to_net(float(k % 1000U));
+  auto sender = std::async(std::launch::async, [&]() {
+    const char * data = reinterpret_cast<const char *>(input.data());
+    size_t len = input.size() * sizeof(input[0]);
+    while (len) {
+      const ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+      if (n <= 0)
+        return false;
+      data += n;
+      len -= n;
+    }
+    return true;
+  });
+  // Before any output is read, the complete input has to be accepted
+  const bool sent_all =
+    sender.wait_for(std::chrono::seconds(20)) == std::future_status::ready;
+  if (!sent_all)
+    shutdown(fd, SHUT_RDWR);
+  ASSERT_TRUE(sent_all) << "io library stopped reading the input";
+  ASSERT_TRUE(sender.get());
+  shutdown(fd, SHUT_WR);
+
+  std::string received;
+  char buf[65536];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+    received.append(buf, n);
+  close(fd);
+  const size_t header_end = received.find("\n\n");
+  ASSERT_NE(std::string::npos, header_end);
+  const size_t bytes = received.size() - header_end - 2U;
+  ASSERT_EQ(input.size() * sizeof(uint32_t), bytes);
+  std::vector<uint32_t> output(input.size());
+  memcpy(output.data(), received.data() + header_end + 2U, bytes);
+  for (size_t k = 0; k < output.size(); ++k)
+    ASSERT_EQ(2.0f * float(k % 1000U), from_net(output[k])) << k;
+
+  EXPECT_EQ(0, MHA_DYNAMIC_IORelease(handle));
+  MHA_DYNAMIC_IODestroy(handle);
+}
+#endif
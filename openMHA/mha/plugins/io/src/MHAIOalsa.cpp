@@ -20,9 +20,11 @@
 #include "mha_events.h"
 #include "mha_io_utils.hh"
 #include <math.h>
+#include <poll.h>
 #include <unistd.h>
 #include <alsa/asoundlib.h>
 #include <limits>
+#include <vector>
 
 #define DBG(x) fprintf(stderr,"%s:%d\n",__FILE__,__LINE__)
 
@@ -53,11 +55,27 @@ public:
      * converts the floating point values coming from the MHA to the integer
      * samples required by the sound card.*/
     virtual bool write(mha_wave_t*)=0;
+    /** drop discards pending samples before a restart.  Errors are
+     * ignored because the device may be in any state here. */
+    void drop() {snd_pcm_drop(pcm);}
+    /** prepare brings the device into the prepared state after drop */
+    void prepare();
+    /** true if the device is prepared but not yet running */
+    bool is_prepared() const
+    {return snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED;}
     /** The underlying alsa handle to this sound card. */
     snd_pcm_t* pcm;
 
 };
 
+void alsa_base_t::prepare()
+{
+    int err;
+    if( (err = snd_pcm_prepare(pcm) ) < 0 )
+        throw MHA_Error(__FILE__,__LINE__,"Unable to prepare device: %s",
+                        snd_strerror(err));
+}
+
 /** Parser variables corresponding to one alsa device.  ALSA separates
  * audio capture and audio playback into two different devices that have
  * to be opened separately. This class encapsulates the parser
@@ -76,6 +94,10 @@ public:
     /** Number of buffers of fragsize to hold in the alsa buffer.
      * Usually 2, the minimum possible. */
     MHAParser::int_t nperiods;
+    /** Number of frames that have to be available before poll()
+     * wakes up the processing thread in mmap access mode, 0 for
+     * fragsize. */
+    MHAParser::int_t avail_min;
     /** Remember the direction (capture/playback) of this device */
     snd_pcm_stream_t stream_dir;
 };
@@ -96,11 +118,15 @@ public:
      * @param rate     sampling rate in Hz
      * @param fragsize samples per block per channel
      * @param channels number of audio channels to open
+     * @param mmap     true: access the sound samples directly in the
+     *                 buffer shared with the driver and wait for them
+     *                 with poll(), false: use snd_pcm_readi/writei
      */
     alsa_t(const alsa_dev_par_parser_t& par,
            unsigned int rate,
            unsigned int fragsize,
-           unsigned int channels);
+           unsigned int channels,
+           bool mmap);
     /** Destructor closes the sound device. */
     ~alsa_t();
     /** start puts alsa device in usable state */
@@ -120,8 +146,21 @@ public:
     bool write(mha_wave_t*) override;
 
 private:
+    /** read() in mmap access mode: converts the samples directly from
+     * the driver's buffer into the internal mha_wave_t buffer. */
+    bool read_mmap(mha_wave_t**);
+    /** write() in mmap access mode: converts the samples directly into
+     * the driver's buffer. */
+    bool write_mmap(mha_wave_t*);
+    /** Wait with poll() until at least fragsize frames can be
+     * transferred.
+     * @return false on xrun. */
+    bool wait_for_fragment();
     unsigned int channels;
     unsigned int fragsize;
+    bool mmap;
+    /** Poll descriptors of the PCM, fetched once after opening. */
+    std::vector<struct pollfd> pollfds;
     T * buffer;
     std::vector<mha_real_t> frame_data;
     /** internal buffer to store sound samples coming from the sound card. */
@@ -134,6 +173,8 @@ private:
 template <typename T>
 bool alsa_t<T>::read(mha_wave_t** s)
 {
+    if (mmap)
+        return read_mmap(s);
     unsigned k, ch;
     snd_pcm_sframes_t cnt;
     *s = &wave;
@@ -154,6 +195,8 @@ bool alsa_t<T>::read(mha_wave_t** s)
 template <typename T>
 bool alsa_t<T>::write(mha_wave_t* s)
 {
+    if (mmap)
+        return write_mmap(s);
     unsigned int k, ch;
     snd_pcm_sframes_t cnt;
     if (s)
@@ -174,6 +217,94 @@ bool alsa_t<T>::write(mha_wave_t* s)
                         "Write failed: %s",snd_strerror(cnt));
     return true;
 }
+template <typename T>
+bool alsa_t<T>::wait_for_fragment()
+{
+    auto avail = [this](){return long(snd_pcm_avail_update(pcm));};
+    auto wait = [this](){
+        // Wait at most one second, a device that does not make progress
+        // is an error
+        const int err = poll(pollfds.data(), pollfds.size(), 1000);
+        if (err < 0)
+            return errno == EINTR ? 1 : -errno;
+        unsigned short revents = 0;
+        if (err > 0)
+            snd_pcm_poll_descriptors_revents(pcm, pollfds.data(),
+                                             pollfds.size(), &revents);
+        return (revents & POLLERR) ? -EPIPE : err;
+    };
+    const int err = mhaioutils::wait_for_frames(fragsize, avail, wait);
+    if (err == -EPIPE or err == -ESTRPIPE)
+        return false;
+    if (err == -ETIMEDOUT)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Timeout while waiting for the sound device");
+    if (err < 0)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Unable to wait for the sound device: %s",
+                        snd_strerror(err));
+    return true;
+}
+
+template <typename T>
+bool alsa_t<T>::read_mmap(mha_wave_t** s)
+{
+    *s = &wave;
+    if (!wait_for_fragment())
+        return false;
+    const snd_pcm_channel_area_t * areas = nullptr;
+    auto begin = [&](snd_pcm_uframes_t & offset, snd_pcm_uframes_t & frames)
+        {return snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);};
+    auto copy = [&](snd_pcm_uframes_t offset, snd_pcm_uframes_t frames,
+                    snd_pcm_uframes_t done){
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            const char * src = static_cast<const char *>(areas[ch].addr)
+                + (areas[ch].first + offset * areas[ch].step) / 8;
+            mhaioutils::from_int_strided<T>(src, areas[ch].step / 8, frames,
+                                            wave.buf + done * channels + ch,
+                                            channels);
+        }
+    };
+    auto commit = [this](snd_pcm_uframes_t offset, snd_pcm_uframes_t frames)
+        {return long(snd_pcm_mmap_commit(pcm, offset, frames));};
+    const int err = mhaioutils::transfer_mmap(fragsize, begin, copy, commit);
+    if (err == -EPIPE or err == -ESTRPIPE)
+        return false;
+    if (err < 0)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Read failed: %s",snd_strerror(err));
+    return true;
+}
+
+template <typename T>
+bool alsa_t<T>::write_mmap(mha_wave_t* s)
+{
+    if (!wait_for_fragment())
+        return false;
+    const snd_pcm_channel_area_t * areas = nullptr;
+    auto begin = [&](snd_pcm_uframes_t & offset, snd_pcm_uframes_t & frames)
+        {return snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);};
+    auto copy = [&](snd_pcm_uframes_t offset, snd_pcm_uframes_t frames,
+                    snd_pcm_uframes_t done){
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            char * dst = static_cast<char *>(areas[ch].addr)
+                + (areas[ch].first + offset * areas[ch].step) / 8;
+            mhaioutils::to_int_clamped_strided<T>
+                (s ? s->buf + done * channels + ch : nullptr, channels,
+                 frames, dst, areas[ch].step / 8);
+        }
+    };
+    auto commit = [this](snd_pcm_uframes_t offset, snd_pcm_uframes_t frames)
+        {return long(snd_pcm_mmap_commit(pcm, offset, frames));};
+    const int err = mhaioutils::transfer_mmap(fragsize, begin, copy, commit);
+    if (err == -EPIPE or err == -ESTRPIPE)
+        return false;
+    if (err < 0)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Write failed: %s",snd_strerror(err));
+    return true;
+}
+
 template <typename T>
 void alsa_t<T>::start()
 {
@@ -194,10 +325,12 @@ template <typename T>
 alsa_t<T>::alsa_t(const alsa_dev_par_parser_t& par,
                unsigned int rate,
                unsigned int fragsize_,
-               unsigned int channels_)
+               unsigned int channels_,
+               bool mmap_)
     : alsa_base_t(),
       channels(channels_),
       fragsize(fragsize_),
+      mmap(mmap_),
       buffer(nullptr),
       frame_data(channels,0),
       wave(fragsize,channels),
@@ -248,7 +381,9 @@ alsa_t<T>::alsa_t(const alsa_dev_par_parser_t& par,
                                 par.device.data.c_str(),
                                 pcm_format==SND_PCM_FORMAT_S16_LE ? 16 : 32,
                                 snd_strerror(err));
-            if( (err = snd_pcm_hw_params_set_access(pcm,params,SND_PCM_ACCESS_RW_INTERLEAVED))<0)
+            if( (err = snd_pcm_hw_params_set_access(pcm,params,
+                                                    mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED
+                                                    : SND_PCM_ACCESS_RW_INTERLEAVED))<0)
                 throw MHA_Error(__FILE__,__LINE__,
                                 "Unable to set access mode (%s): %s",
                                 par.device.data.c_str(),snd_strerror(err));
@@ -277,6 +412,45 @@ alsa_t<T>::alsa_t(const alsa_dev_par_parser_t& par,
             snd_pcm_hw_params_free( params );
             throw;
         }
+        if (mmap) {
+            const unsigned int avail_min =
+                par.avail_min.data ? par.avail_min.data : fragsize;
+            if (avail_min > fragsize)
+                throw MHA_Error(__FILE__,__LINE__,
+                                "avail_min of %s (%u) must not exceed fragsize (%u)",
+                                par.device.data.c_str(), avail_min, fragsize);
+            snd_pcm_sw_params_t* swparams;
+            snd_pcm_sw_params_malloc(&swparams);
+            try{
+                if( (err = snd_pcm_sw_params_current(pcm,swparams)) < 0 )
+                    throw MHA_Error(__FILE__,__LINE__,
+                                    "Unable to get sw params for %s: %s",
+                                    par.device.data.c_str(), snd_strerror(err));
+                if( (err = snd_pcm_sw_params_set_avail_min(pcm,swparams,avail_min)) < 0 )
+                    throw MHA_Error(__FILE__,__LINE__,
+                                    "Unable to set avail_min of %s to %u: %s",
+                                    par.device.data.c_str(), avail_min, snd_strerror(err));
+                if( (err = snd_pcm_sw_params(pcm,swparams)) < 0 )
+                    throw MHA_Error(__FILE__,__LINE__,
+                                    "Unable to set sw params for %s: %s",
+                                    par.device.data.c_str(), snd_strerror(err));
+                snd_pcm_sw_params_free( swparams );
+            }
+            catch(...){
+                snd_pcm_sw_params_free( swparams );
+                throw;
+            }
+            const int count = snd_pcm_poll_descriptors_count(pcm);
+            if (count <= 0)
+                throw MHA_Error(__FILE__,__LINE__,
+                                "Unable to get poll descriptors of %s",
+                                par.device.data.c_str());
+            pollfds.resize(count);
+            if( (err = snd_pcm_poll_descriptors(pcm,pollfds.data(),count)) < 0 )
+                throw MHA_Error(__FILE__,__LINE__,
+                                "Unable to get poll descriptors of %s: %s",
+                                par.device.data.c_str(), snd_strerror(err));
+        }
         buffer = new T[channels*fragsize];
     }
     catch( ... ){
@@ -346,6 +520,7 @@ private:
     MHAParser::bool_t pcmlink;
     MHAParser::int_t priority;
     MHAParser::kw_t format;
+    MHAParser::kw_t access;
     MHAParser::int_mon_t alsa_start_counter;
     MHAEvents::patchbay_t<io_alsa_t> patchbay;
 };
@@ -365,13 +540,12 @@ void io_alsa_t::process()
             start_event(start_handle);
         while( b_process ){
             if (devices_running == false) {
-                snd_pcm_drop(dev_in->pcm);
-                snd_pcm_drop(dev_out->pcm);
-                snd_pcm_prepare(dev_in->pcm);
-                snd_pcm_prepare(dev_out->pcm);
-                for (int i = 0; i < p_out.nperiods.data; ++i)
-                    dev_out->write(0);
                 alsa_start_counter.data++;
+                // Transfers through mmap do not start the devices
+                if (!mhaioutils::restart_duplex(*dev_in, *dev_out,
+                                                p_out.nperiods.data,
+                                                access.data.get_index() == 1))
+                    continue;
                 devices_running = true;
             }
             if (!dev_in->read(&s)) {
@@ -421,9 +595,10 @@ template<typename T>
 void io_alsa_t::prepare(int nch_in,int nch_out)
 {
     int err;
-        dev_in = new alsa_t<T>(p_in,fw_samplerate,fw_fragsize,nch_in);
+        const bool mmap = access.data.get_index() == 1;
+        dev_in = new alsa_t<T>(p_in,fw_samplerate,fw_fragsize,nch_in,mmap);
         try{
-            dev_out = new alsa_t<T>(p_out,fw_samplerate,fw_fragsize,nch_out);
+            dev_out = new alsa_t<T>(p_out,fw_samplerate,fw_fragsize,nch_out,mmap);
             try{
                 if( pcmlink.data ){
                     if( (err = snd_pcm_link( dev_in->pcm, dev_out->pcm ) ) < 0 )
@@ -489,12 +664,20 @@ io_alsa_t::io_alsa_t(unsigned int ifragsize,
     priority("Set SCHED_FIFO priority of processing thread\n"
              "or -1 for no realtime scheduling","-1","[-1,99]"),
     format("PCM sample format","S32_LE","[S32_LE S16_LE]"),
+    access("Access to the sound samples.\n"
+           "  rw: Copy the samples with snd_pcm_readi and snd_pcm_writei.\n"
+           "  mmap: Convert the samples directly in the buffer shared with\n"
+           "the driver, wait for them with poll(), see avail_min.\n"
+           "Test mmap access without sound card with the ALSA PCM plugins\n"
+           "null (in.device=null, out.device=null) and file.",
+           "rw","[rw mmap]"),
     alsa_start_counter("alsa is started on startup and for every dropout.")
 {
     insert_item("in",&p_in);
     insert_item("out",&p_out);
     insert_item("priority",&priority);
     insert_item("format",&format);
+    insert_item("access",&access);
     insert_item("link",&pcmlink);
     insert_member(alsa_start_counter);
     alsa_start_counter.data = 0;
@@ -505,10 +688,14 @@ alsa_dev_par_parser_t::alsa_dev_par_parser_t(snd_pcm_stream_t _stream_dir)
              (_stream_dir == SND_PCM_STREAM_PLAYBACK ? "playback" : "capture"),
              ""),
       nperiods("number of periods in alsa buffer","2","[2,]"),
+      avail_min("mmap access: number of available frames that wake up\n"
+                "the processing thread, 0 for fragsize.  Smaller values\n"
+                "wake up more often within one fragment.","0","[0,]"),
       stream_dir(_stream_dir)
 {
     insert_member(device);
     insert_member(nperiods);
+    insert_member(avail_min);
 }
 
 
@@ -17,6 +17,9 @@
 
 #include <limits>
 #include <cmath>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
 
 namespace mhaioutils {
   template<typename T>
@@ -32,5 +35,154 @@ namespace mhaioutils {
     else
       return static_cast<T>(invgain * val);
   }
+
+  /** Convert integer samples of one channel to floating point values
+   * in the range [-1,1).  Source and destination samples may be
+   * interleaved with other channels, e.g. in an ALSA mmap area and
+   * in an mha_wave_t buffer.
+   * @param src        Address of the first integer sample.
+   * @param src_stride Distance of consecutive source samples in bytes.
+   * @param frames     Number of samples to convert.
+   * @param dst        Address of the first destination value.
+   * @param dst_stride Distance of consecutive destination values in
+   *                   floats. */
+  template<typename T>
+  void from_int_strided(const char * src, std::ptrdiff_t src_stride,
+                        unsigned frames, float * dst, unsigned dst_stride){
+    constexpr float gain = -1.0f / std::numeric_limits<T>::min();
+    for (unsigned k = 0; k < frames; ++k) {
+      T sample;
+      std::memcpy(&sample, src + k * src_stride, sizeof(T));
+      dst[k * dst_stride] = gain * sample;
+    }
+  }
+
+  /** Convert floating point values of one channel to clamped integer
+   * samples, see to_int_clamped.  Source and destination samples may be
+   * interleaved with other channels.
+   * @param src        Address of the first floating point value, or
+   *                   nullptr to write silence.
+   * @param src_stride Distance of consecutive source values in floats.
+   * @param frames     Number of samples to convert.
+   * @param dst        Address of the first integer sample.
+   * @param dst_stride Distance of consecutive destination samples in
+   *                   bytes. */
+  template<typename T>
+  void to_int_clamped_strided(const float * src, unsigned src_stride,
+                              unsigned frames, char * dst,
+                              std::ptrdiff_t dst_stride){
+    for (unsigned k = 0; k < frames; ++k) {
+      const T sample = src ? to_int_clamped<T>(src[k * src_stride]) : T(0);
+      std::memcpy(dst + k * dst_stride, &sample, sizeof(T));
+    }
+  }
+  /** Transfer one block of frames through a memory-mapped ring buffer
+   * shared with the sound driver.  The ring buffer hands out
+   * contiguous chunks only, a block that wraps around the end of the
+   * ring buffer is transferred in several chunks.  The device
+   * operations are passed as callables so that this logic does not
+   * depend on ALSA.
+   * @param frames Number of frames to transfer.
+   * @param begin  Callable int(unsigned long & offset,
+   *               unsigned long & chunk) that receives the number of
+   *               frames still wanted in chunk, and sets offset and
+   *               chunk to the contiguous part of the ring buffer
+   *               that is available, like snd_pcm_mmap_begin.
+   * @param copy   Callable void(unsigned long offset,
+   *               unsigned long chunk, unsigned long done) that
+   *               converts chunk frames at ring buffer position offset,
+   *               after done frames of this block.
+   * @param commit Callable long(unsigned long offset,
+   *               unsigned long chunk) that hands the chunk back to
+   *               the driver and returns the number of frames
+   *               committed, like snd_pcm_mmap_commit.
+   * @return 0 when the block was transferred, -EPIPE when the driver
+   *         committed less than a chunk or has no frames available,
+   *         which only happens after an xrun, or the negative error
+   *         code returned by begin. */
+  template<class Begin, class Copy, class Commit>
+  int transfer_mmap(unsigned long frames, Begin begin, Copy copy,
+                    Commit commit){
+    for (unsigned long done = 0; done < frames;) {
+      unsigned long offset = 0;
+      unsigned long chunk = frames - done;
+      const int err = begin(offset, chunk);
+      if (err < 0)
+        return err;
+      // An empty chunk would never complete the block
+      if (chunk == 0 || chunk > frames - done)
+        return -EPIPE;
+      copy(offset, chunk, done);
+      const long committed = commit(offset, chunk);
+      if (committed < 0 || static_cast<unsigned long>(committed) != chunk)
+        return -EPIPE;
+      done += chunk;
+    }
+    return 0;
+  }
+
+  /** Wait until the device can transfer at least the given number of
+   * frames.
+   * @param frames Number of frames needed.
+   * @param avail  Callable long() returning the number of frames that
+   *               can be transferred now, or a negative error code,
+   *               like snd_pcm_avail_update.
+   * @param wait   Callable int() that blocks until the device makes
+   *               progress and returns a positive value, 0 on
+   *               timeout, or a negative error code, -EPIPE when the
+   *               device reported an error condition.
+   * @return 0 when the frames are available, -ETIMEDOUT when wait
+   *         timed out, or the negative error code of avail or wait,
+   *         -EPIPE for an xrun. */
+  template<class Avail, class Wait>
+  int wait_for_frames(unsigned long frames, Avail avail, Wait wait){
+    for (;;) {
+      const long available = avail();
+      if (available < 0)
+        return static_cast<int>(available);
+      if (static_cast<unsigned long>(available) >= frames)
+        return 0;
+      const int err = wait();
+      if (err == 0)
+        return -ETIMEDOUT;
+      if (err < 0)
+        return err;
+    }
+  }
+
+  /** Bring a capture and a playback device into running state, before
+   * the first block and again after each xrun: Discard frames still
+   * pending in both devices, prepare them, fill the playback buffer
+   * with silence, and start the devices when writing the silence does
+   * not start them.
+   * Both device types need the methods void drop(), void prepare(),
+   * void start(), and bool is_prepared(), the playback device
+   * additionally bool write(std::nullptr_t) for one block of silence.
+   * @param in             Capture device.
+   * @param out            Playback device.
+   * @param nperiods       Number of silent blocks to write.
+   * @param explicit_start True if writing does not start the devices,
+   *                       as with mmap access.
+   * @return false if the devices ran into another xrun while filling
+   *         the playback buffer. */
+  template<class In, class Out>
+  bool restart_duplex(In & in, Out & out, unsigned nperiods,
+                      bool explicit_start){
+    in.drop();
+    out.drop();
+    in.prepare();
+    out.prepare();
+    for (unsigned k = 0; k < nperiods; ++k)
+      if (!out.write(nullptr))
+        return false;
+    if (explicit_start) {
+      out.start();
+      // A linked capture device has been started together with the
+      // playback device
+      if (in.is_prepared())
+        in.start();
+    }
+    return true;
+  }
 }
 #endif
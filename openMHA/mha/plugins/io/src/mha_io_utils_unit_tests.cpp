@@ -14,8 +14,11 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 #include <gtest/gtest.h>
 #include "mha_io_utils.hh"
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <string>
+#include <vector>
 
 const float notanumber = std::numeric_limits<float>::quiet_NaN();
 const float one = 1;
@@ -81,3 +84,198 @@ TEST(to_int_clamped_int32_t,monotony){
   EXPECT_GE(to_int_clamped<int32_t>(almost_almost_minusone),to_int_clamped<int32_t>(almost_minusone));
   EXPECT_GE(to_int_clamped<int32_t>(almost_minusone),to_int_clamped<int32_t>(minusone));
 }
+
+TEST(from_int_strided,converts_one_channel_of_interleaved_samples){
+  // 3 frames of 2 channels in the layout of an interleaved mmap area
+  const int16_t area[] = {0, 100, 16384, 200, -32768, 300};
+  std::vector<float> wave(6, 42.0f);
+  from_int_strided<int16_t>(reinterpret_cast<const char*>(area),
+                            2 * sizeof(int16_t), 3, wave.data(), 2);
+  EXPECT_EQ(0.0f, wave[0]);
+  EXPECT_EQ(0.5f, wave[2]);
+  EXPECT_EQ(-1.0f, wave[4]);
+  // Other channel untouched
+  EXPECT_EQ(42.0f, wave[1]);
+  EXPECT_EQ(42.0f, wave[3]);
+  EXPECT_EQ(42.0f, wave[5]);
+}
+
+TEST(to_int_clamped_strided,round_trip_of_interleaved_samples){
+  const float wave[] = {0.0f, 0.25f, -0.5f, 0.75f, one, minusone};
+  std::vector<int32_t> area(6, 7);
+  for (unsigned ch = 0; ch < 2; ++ch)
+    to_int_clamped_strided<int32_t>(wave + ch, 2, 3,
+                                    reinterpret_cast<char*>(area.data() + ch),
+                                    2 * sizeof(int32_t));
+  EXPECT_EQ(0, area[0]);
+  EXPECT_EQ(std::numeric_limits<int32_t>::max(), area[4]);
+  EXPECT_EQ(std::numeric_limits<int32_t>::min(), area[5]);
+  std::vector<float> back(6);
+  for (unsigned ch = 0; ch < 2; ++ch)
+    from_int_strided<int32_t>(reinterpret_cast<const char*>(area.data() + ch),
+                              2 * sizeof(int32_t), 3, back.data() + ch, 2);
+  for (unsigned k = 0; k < 5; ++k)
+    EXPECT_FLOAT_EQ(wave[k], back[k]);
+}
+
+TEST(to_int_clamped_strided,writes_silence_without_source){
+  std::vector<int16_t> area(4, 7);
+  to_int_clamped_strided<int16_t>(nullptr, 1, 2,
+                                  reinterpret_cast<char*>(area.data()),
+                                  2 * sizeof(int16_t));
+  EXPECT_EQ(0, area[0]);
+  EXPECT_EQ(7, area[1]);
+  EXPECT_EQ(0, area[2]);
+  EXPECT_EQ(7, area[3]);
+}
+
+namespace {
+  /** Ring buffer of one channel, handing out contiguous chunks like an
+   * ALSA mmap area. */
+  struct fake_ring_t {
+    std::vector<int> area = std::vector<int>(8, 0);
+    unsigned long hw_ptr = 0;
+    unsigned long available = 8;
+    /** Commit fewer frames than requested, as after an xrun */
+    bool short_commit = false;
+    int begin_error = 0;
+    int begin(unsigned long & offset, unsigned long & chunk) {
+      if (begin_error)
+        return begin_error;
+      offset = hw_ptr;
+      chunk = std::min({chunk, available, area.size() - hw_ptr});
+      return 0;
+    }
+    long commit(unsigned long offset, unsigned long chunk) {
+      EXPECT_EQ(hw_ptr, offset);
+      if (short_commit)
+        --chunk;
+      hw_ptr = (hw_ptr + chunk) % area.size();
+      available -= chunk;
+      return chunk;
+    }
+  };
+
+  /** Writes block to the ring, returns the result of transfer_mmap */
+  int write_block(fake_ring_t & ring, const std::vector<int> & block,
+                  std::vector<unsigned long> & chunks) {
+    return transfer_mmap(block.size(),
+                         [&](unsigned long & offset, unsigned long & chunk)
+                         {return ring.begin(offset, chunk);},
+                         [&](unsigned long offset, unsigned long chunk,
+                             unsigned long done){
+                           chunks.push_back(chunk);
+                           for (unsigned long k = 0; k < chunk; ++k)
+                             ring.area[offset + k] = block[done + k];
+                         },
+                         [&](unsigned long offset, unsigned long chunk)
+                         {return ring.commit(offset, chunk);});
+  }
+
+  /** Records the calls restart_duplex makes to a sound device */
+  struct fake_device_t {
+    fake_device_t(std::string & log_, char name_) : log(log_), name(name_) {}
+    std::string & log;
+    char name;
+    bool prepared = false;
+    unsigned writes_until_xrun = 100;
+    void drop() {log += name; log += "drop "; prepared = false;}
+    void prepare() {log += name; log += "prepare "; prepared = true;}
+    void start() {log += name; log += "start "; prepared = false;}
+    bool is_prepared() const {return prepared;}
+    bool write(std::nullptr_t) {
+      log += name; log += "write ";
+      return writes_until_xrun-- > 0;
+    }
+  };
+}
+
+TEST(transfer_mmap,transfers_block_wrapping_around_ring_end){
+  fake_ring_t ring;
+  ring.hw_ptr = 6;
+  std::vector<unsigned long> chunks;
+  EXPECT_EQ(0, write_block(ring, {1, 2, 3, 4}, chunks));
+  EXPECT_EQ(std::vector<unsigned long>({2, 2}), chunks);
+  EXPECT_EQ(std::vector<int>({3, 4, 0, 0, 0, 0, 1, 2}), ring.area);
+  EXPECT_EQ(2U, ring.hw_ptr);
+  EXPECT_EQ(4U, ring.available);
+}
+
+TEST(transfer_mmap,reports_xrun_on_short_commit){
+  fake_ring_t ring;
+  ring.short_commit = true;
+  std::vector<unsigned long> chunks;
+  EXPECT_EQ(-EPIPE, write_block(ring, {1, 2, 3, 4}, chunks));
+  EXPECT_EQ(1U, chunks.size());
+}
+
+TEST(transfer_mmap,reports_xrun_instead_of_looping_when_ring_is_empty){
+  fake_ring_t ring;
+  ring.available = 2;
+  std::vector<unsigned long> chunks;
+  EXPECT_EQ(-EPIPE, write_block(ring, {1, 2, 3, 4}, chunks));
+  EXPECT_EQ(std::vector<unsigned long>({2}), chunks);
+}
+
+TEST(transfer_mmap,returns_error_of_begin_without_copying){
+  fake_ring_t ring;
+  ring.begin_error = -EIO;
+  std::vector<unsigned long> chunks;
+  EXPECT_EQ(-EIO, write_block(ring, {1, 2}, chunks));
+  EXPECT_TRUE(chunks.empty());
+  EXPECT_EQ(std::vector<int>(8, 0), ring.area);
+}
+
+TEST(wait_for_frames,returns_when_enough_frames_are_available){
+  std::vector<long> avail = {1, 3, 4};
+  unsigned queries = 0, waits = 0;
+  EXPECT_EQ(0, wait_for_frames(4, [&](){return avail[queries++];},
+                               [&](){return ++waits, 1;}));
+  EXPECT_EQ(3U, queries);
+  EXPECT_EQ(2U, waits);
+  // No wait when the frames are there already
+  queries = 2;
+  EXPECT_EQ(0, wait_for_frames(4, [&](){return avail[queries];},
+                               [&](){return ++waits, 1;}));
+  EXPECT_EQ(2U, waits);
+}
+
+TEST(wait_for_frames,reports_errors_of_device_and_of_waiting){
+  auto never = [](){return 0L;};
+  EXPECT_EQ(-ETIMEDOUT, wait_for_frames(4, never, [](){return 0;}));
+  EXPECT_EQ(-EPIPE, wait_for_frames(4, never, [](){return -EPIPE;}));
+  EXPECT_EQ(-EPIPE, wait_for_frames(4, [](){return long(-EPIPE);},
+                                    [](){return 1;}));
+}
+
+TEST(restart_duplex,prefills_playback_before_devices_run){
+  std::string log;
+  fake_device_t in(log, 'i'), out(log, 'o');
+  EXPECT_TRUE(restart_duplex(in, out, 2, false));
+  EXPECT_EQ("idrop odrop iprepare oprepare owrite owrite ", log);
+}
+
+TEST(restart_duplex,starts_devices_for_mmap_access){
+  std::string log;
+  fake_device_t in(log, 'i'), out(log, 'o');
+  EXPECT_TRUE(restart_duplex(in, out, 1, true));
+  EXPECT_EQ("idrop odrop iprepare oprepare owrite ostart istart ", log);
+  // A linked capture device is started with the playback device
+  log.clear();
+  struct linked_device_t : fake_device_t {
+    using fake_device_t::fake_device_t;
+    fake_device_t * capture = nullptr;
+    void start() {fake_device_t::start(); capture->prepared = false;}
+  } linked_out(log, 'o');
+  linked_out.capture = &in;
+  EXPECT_TRUE(restart_duplex(in, linked_out, 1, true));
+  EXPECT_EQ("idrop odrop iprepare oprepare owrite ostart ", log);
+}
+
+TEST(restart_duplex,reports_xrun_during_prefill){
+  std::string log;
+  fake_device_t in(log, 'i'), out(log, 'o');
+  out.writes_until_xrun = 1;
+  EXPECT_FALSE(restart_duplex(in, out, 3, true));
+  EXPECT_EQ("idrop odrop iprepare oprepare owrite owrite ", log);
+}
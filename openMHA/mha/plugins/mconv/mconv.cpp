@@ -19,6 +19,7 @@
 #include "mha_events.h"
 #include "mha_defs.h"
 #include "mha_filter.hh"
+#include <limits>
 
 
 namespace mconv {
@@ -27,7 +28,7 @@ namespace mconv {
      * A matrix of impulse responses, filtering n input channels to m output
      * channels, is supported.
      */
-    class MConv :  public MHAPlugin::plugin_t<MHAFilter::partitioned_convolution_t>
+    class MConv :  public MHAPlugin::plugin_t<MHAFilter::nonuniform_partitioned_convolution_t>
     {
     public:
         /** Plugin constructor.
@@ -48,6 +49,9 @@ namespace mconv {
         /**  This function updates the irs without allowing a change
          * of its size after prepare(). */
         void update_irs();
+        /** Processing scheme of the uniform partitions selected by
+         * the engine configuration variable. */
+        MHAFilter::partitioned_convolution_engine_t engine_type() const;
         /** Number of output channels to produce */
         MHAParser::int_t nchannels_out;
         /** Vector of input channel indices.
@@ -64,6 +68,14 @@ namespace mconv {
          * and the corresponding element of outch identifies the target
          * channel. */
         MHAParser::mfloat_t irs;
+        /** Upper limit for the partition size of the tail of the
+         * impulse responses, 0 for uniform partitions. */
+        MHAParser::int_t max_partition_size;
+        /** Processing scheme of the uniform partitions. */
+        MHAParser::kw_t engine;
+        /** Number of times the signal processing had to wait for the
+         * tail convolution. */
+        MHAParser::int_mon_t waits;
 
         /** Number of input channels, set during prepare. */
         unsigned int nchannels_in;
@@ -76,7 +88,7 @@ namespace mconv {
     };
 
     MConv::MConv(MHA_AC::algo_comm_t & iac, const std::string & )
-        : MHAPlugin::plugin_t<MHAFilter::partitioned_convolution_t>
+        : MHAPlugin::plugin_t<MHAFilter::nonuniform_partitioned_convolution_t>
         ("FFT based FIR filter using partitioned convolution\n"
          "  This plugin filters its input channels using partitioned fast\n"
          "convolution. The variables in this plugin define a sparse matrix of\n"
@@ -95,6 +107,23 @@ namespace mconv {
             "element of inch identifies the source channel, and the\n"
             "corresponding element of outch identifies the target channel.",
             "[[1]]"),
+        max_partition_size("Upper limit for the partition size in samples used\n"
+                           "for the tails of long impulse responses.  Tail\n"
+                           "partitions are convolved by background threads.\n"
+                           "Values below 4*fragsize select uniform partitions\n"
+                           "of fragsize for the whole impulse responses.",
+                           "0", "[0,]"),
+        engine("Processing scheme of the uniform partitions.\n"
+               "  output_delay_line: Accumulate the filtered partitions in\n"
+               "one delay line of output spectra per partition.\n"
+               "  frequency_domain_delay_line: Keep a delay line of input\n"
+               "spectra and sum all partitions of an output channel in one\n"
+               "pass.  Faster for many partitions or channels.",
+               "output_delay_line",
+               "[output_delay_line frequency_domain_delay_line]"),
+        waits("Number of times the signal processing had to wait for\n"
+              "the background threads convolving the tails of the\n"
+              "impulse responses"),
         nchannels_in(0),
         fragsize(0)
     {
@@ -102,8 +131,14 @@ namespace mconv {
         insert_item("inch", &inch);
         insert_item("outch", &outch);
         insert_item("irs", &irs);
+        insert_item("max_partition_size", &max_partition_size);
+        insert_item("engine", &engine);
+        insert_item("waits", &waits);
 
         patchbay.connect(&irs.writeaccess, this, &MConv::update_irs);
+        patchbay.connect(&max_partition_size.writeaccess, this,
+                         &MConv::update_irs);
+        patchbay.connect(&engine.writeaccess, this, &MConv::update_irs);
     }
 
     void MConv::prepare(mhaconfig_t & mhaconfig)
@@ -152,10 +187,9 @@ namespace mconv {
         }
 
         if (is_prepared())
-            push_config(new MHAFilter::partitioned_convolution_t(fragsize,
-                                                             nchannels_in,
-                                                             nchannels_out.data,
-                                                             tm));
+            push_config(new MHAFilter::nonuniform_partitioned_convolution_t
+                        (fragsize, nchannels_in, nchannels_out.data, tm,
+                         max_partition_size.data, engine_type()));
     }
 
     void MConv::update_irs()
@@ -177,16 +211,26 @@ namespace mconv {
             tm.push_back(tf);
         }
 
-        push_config(new MHAFilter::partitioned_convolution_t(fragsize,
-                                                             nchannels_in,
-                                                             nchannels_out.data,
-                                                             tm));
+        push_config(new MHAFilter::nonuniform_partitioned_convolution_t
+                    (fragsize, nchannels_in, nchannels_out.data, tm,
+                     max_partition_size.data, engine_type()));
+    }
+
+    MHAFilter::partitioned_convolution_engine_t MConv::engine_type() const
+    {
+        return engine.data.get_index() == 0
+            ? MHAFilter::partitioned_convolution_engine_t::OUTPUT_DELAY_LINE
+            : MHAFilter::partitioned_convolution_engine_t::
+            FREQUENCY_DOMAIN_DELAY_LINE;
     }
 
     mha_wave_t* MConv::process(mha_wave_t * s_in)
     {
         poll_config();
         mha_wave_t * s_out = cfg->process(s_in);
+        waits.data = static_cast<int>
+            (std::min<unsigned long long>(cfg->get_num_waits(),
+                                          std::numeric_limits<int>::max()));
         return s_out;
     }
 }
@@ -202,7 +246,29 @@ MHAPLUGIN_DOCUMENTATION(mconv,
                         " is applied with the appropriate delay. Each partition is applied using the"
                         "overlap-save method. The FFT length used is 2*fragsize."
                         "For efficiency reasons, fragsize should be a power of two.\n\n"
-                        " This implementation discards impulse response partitions where the coefficients are all zero."
+                        " This implementation discards impulse response partitions where the coefficients are all zero.\n\n"
+                        " Long impulse responses, e.g. of rooms, can be convolved with non-uniform"
+                        " partitions by setting {\\em max\\_partition\\_size} to at least 4*fragsize."
+                        " The first 8*fragsize samples of the impulse responses are then convolved"
+                        " with partitions of fragsize as described above.  The remaining samples"
+                        " are divided into segments with partition sizes growing by a factor of 4"
+                        " from 4*fragsize up to max\\_partition\\_size.  Each segment is convolved"
+                        " by a background thread, which has the duration of one of its partitions"
+                        " to compute the result before it is needed, so that no latency is added."
+                        " The computational cost in the signal processing thread then no longer"
+                        " grows with the length of the impulse responses.  The background threads"
+                        " use the default scheduling policy and therefore run with lower priority"
+                        " than a real-time signal processing thread.  If a background thread"
+                        " is late, the signal processing waits for it, which is counted in the"
+                        " monitor variable {\\em waits}.\n\n"
+                        " The variable {\\em engine} selects how the uniform partitions are"
+                        " processed.  With {\\em output\\_delay\\_line}, each filtered partition"
+                        " is added to a delay line of output spectra.  With"
+                        " {\\em frequency\\_domain\\_delay\\_line}, the spectra of past input blocks"
+                        " are kept in a frequency-domain delay line, and each output spectrum is"
+                        " computed as the sum over all partitions in one pass, which uses the"
+                        " vector instructions of the processor more efficiently.  Both schemes"
+                        " produce the same output within rounding errors."
                         )
 
 
@@ -16,6 +16,12 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mha_generic_chain.h"
+#include <limits>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 mhachain::chain_base_t::chain_base_t(MHA_AC::algo_comm_t & iac,
                                      const std::string &)
@@ -26,13 +32,63 @@ mhachain::chain_base_t::chain_base_t(MHA_AC::algo_comm_t & iac,
             "are separated by spaces and given in the order of the signal processing.\n"
             "Please refer to the detailed description of this plugin in the plugin manual\n"
             "for more details.", "[]"),
+      pipeline_stages("Indices of the plugins in algos that start a new pipeline stage,\n"
+                      "in ascending order.  Every stage after the first is processed\n"
+                      "in a thread of its own, concurrently with the previous stages\n"
+                      "working on later blocks.  Empty: All plugins are processed in\n"
+                      "the signal processing thread.  Takes effect at the next prepare.",
+                      "[]", "[1,["),
+      pipeline_latency("Delay of the chain output in pipeline mode / blocks.  At least\n"
+                       "the number of stages minus one, -1 selects this minimum.\n"
+                       "Takes effect at the next prepare.",
+                       "-1", "[-1,["),
+      pipeline_cpus("CPU cores for pinning the pipeline stage threads.  The thread of\n"
+                    "stage s >= 1 is pinned to pipeline_cpus[(s-1) modulo the number\n"
+                    "of entries].  Empty: No pinning.  Only supported on Linux.\n"
+                    "Takes effect at the next prepare.",
+                    "[]", "[0,["),
+      pipeline_spin_time("Time in microseconds that a waiting pipeline thread spins\n"
+                         "before it sleeps.  Takes effect at the next prepare.",
+                         "500", "[0,]"),
+      pipeline_occupancy("Percentage of the time since the first processed block that\n"
+                         "each pipeline stage was busy"),
+      pipeline_waits("Number of blocks for which the signal processing thread had to\n"
+                     "wait for the output of the last pipeline stage"),
       b_prepared(false)
 {
     set_node_id( "mhachain" );
     patchbay.connect(&algos.writeaccess,this,&chain_base_t::update);
+    patchbay.connect(&pipeline_occupancy.prereadaccess,this,
+                     &chain_base_t::update_pipeline_monitors);
+    patchbay.connect(&pipeline_waits.prereadaccess,this,
+                     &chain_base_t::update_pipeline_monitors);
     update();
 }
 
+mhachain::pipeline_cfg_t mhachain::chain_base_t::get_pipeline_cfg() const
+{
+    pipeline_cfg_t pcfg;
+    pcfg.stages = pipeline_stages.data;
+    pcfg.latency = pipeline_latency.data;
+    pcfg.cpus = pipeline_cpus.data;
+    pcfg.spin_us = pipeline_spin_time.data;
+    return pcfg;
+}
+
+void mhachain::chain_base_t::update_pipeline_monitors()
+{
+    const plugs_t * plugs = peek_config();
+    if( plugs ){
+        pipeline_occupancy.data = plugs->get_pipeline_occupancy();
+        pipeline_waits.data =
+            std::min<uint64_t>(plugs->get_pipeline_waits(),
+                               std::numeric_limits<int>::max());
+    }else{
+        pipeline_occupancy.data.clear();
+        pipeline_waits.data = 0;
+    }
+}
+
 void mhachain::chain_base_t::update()
 {
     for(unsigned int k=0;k<old_algos.size();k++){
@@ -48,7 +104,8 @@ void mhachain::chain_base_t::update()
                             b_prepared,
                             *this,
                             ac,
-                            bprofiling.data));
+                            bprofiling.data,
+                            get_pipeline_cfg()));
     if( !b_prepared )
         poll_config();
 }
@@ -59,6 +116,7 @@ void mhachain::chain_base_t::prepare(mhaconfig_t& cf)
     if( cfg->prepared() )
         throw MHA_ErrorMsg("mhachain: plugins are allready prepared.");
     cfin = cf;
+    cfg->set_pipeline_cfg(get_pipeline_cfg());
     cfg->prepare(cf);
     cfout = cf;
     b_prepared = true;
@@ -99,13 +157,287 @@ void mhaconfig_compare(mhaconfig_t req, mhaconfig_t avail,const char* cpref)
                         pref.c_str(), req.srate, avail.srate);
 }
 
+namespace {
+    /// Hint to the processor that we are spinning in a wait loop
+    inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    /// Seconds elapsed since the time stamp t_start from MHAProfiling::now_ns
+    inline float seconds_since(uint64_t t_start)
+    {
+        return 1e-9f * float(MHAProfiling::now_ns() - t_start);
+    }
+}
+
+mhachain::pipeline_t::slot_t::slot_t(const mhaconfig_t & cf)
+{
+    if( cf.domain == MHA_WAVEFORM )
+        wave.reset(new MHASignal::waveform_t(cf.fragsize,cf.channels));
+    else
+        spec.reset(new MHASignal::spectrum_t(cf.fftlen/2+1,cf.channels));
+}
+
+void mhachain::pipeline_t::slot_t::copy_from(const mha_wave_t * wv,
+                                             const mha_spec_t * sp)
+{
+    if( wave ){
+        if( !wv )
+            throw MHA_ErrorMsg("mhachain: pipeline stage produced no waveform signal.");
+        wave->copy(*wv);
+    }else{
+        if( !sp )
+            throw MHA_ErrorMsg("mhachain: pipeline stage produced no spectrum signal.");
+        spec->copy(*sp);
+    }
+}
+
+mhachain::pipeline_t::boundary_t::boundary_t(const mhaconfig_t & cf,
+                                             unsigned num_slots)
+    : filled(num_slots),
+      free(num_slots)
+{
+    for(unsigned k=0;k<num_slots;k++){
+        slots.emplace_back(cf);
+        free.write(&k,1U);
+    }
+}
+
+mhachain::pipeline_t::pipeline_t(const std::vector<stage_t> & stages_,
+                                 const std::vector<mhaconfig_t> & cf_out,
+                                 unsigned latency,
+                                 const std::vector<int> & cpus,
+                                 unsigned spin_us)
+    : stages(stages_),
+      output(cf_out.back()),
+      // Spinning only helps when other cores can do the work meanwhile
+      spin_time(std::thread::hardware_concurrency() > 1U ? spin_us : 0U),
+      termination_request(false),
+      t_start(0U),
+      waits(0U)
+{
+    const unsigned num_stages = stages.size();
+    if( (num_stages < 2U) || (cf_out.size() != num_stages) )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "mhachain: A pipeline needs at least 2 stages"
+                        " and one output configuration per stage"
+                        " (got %u stages, %zu configurations).",
+                        num_stages, cf_out.size());
+    if( latency < num_stages-1U )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "mhachain: The latency of a pipeline with %u stages"
+                        " must be at least %u blocks, not %u.",
+                        num_stages, num_stages-1U, latency);
+    // Every block in flight between a stage and the processing thread
+    // occupies one slot at each boundary it has passed.  At most latency
+    // blocks are in flight, plus the one being written.
+    for(unsigned s=0;s<num_stages;s++)
+        boundaries.emplace_back(new boundary_t(cf_out[s],latency+1U));
+    // The first latency output blocks are the zeros of the initial slots
+    boundary_t & last = *boundaries.back();
+    for(unsigned k=0;k<latency;k++){
+        unsigned slot;
+        last.free.read(&slot,1U);
+        last.filled.write(&slot,1U);
+    }
+    for(unsigned s=0;s<num_stages;s++)
+        states.emplace_back(new stage_state_t);
+    try{
+        for(unsigned s=1;s<num_stages;s++){
+            states[s]->thread = std::thread(&pipeline_t::worker_main,this,s);
+#if defined(__linux__)
+            if( cpus.size() ){
+                const int cpu = cpus[(s-1U) % cpus.size()];
+                cpu_set_t cpuset;
+                CPU_ZERO(&cpuset);
+                CPU_SET(cpu, &cpuset);
+                if( pthread_setaffinity_np(states[s]->thread.native_handle(),
+                                           sizeof(cpuset), &cpuset) )
+                    throw MHA_Error(__FILE__,__LINE__,
+                                    "mhachain: Cannot pin pipeline stage %u"
+                                    " to CPU %d",s,cpu);
+            }
+#endif
+        }
+    }
+    catch(...){
+        stop();
+        throw;
+    }
+#if !defined(__linux__)
+    (void)cpus;
+#endif
+}
+
+mhachain::pipeline_t::~pipeline_t()
+{
+    stop();
+}
+
+void mhachain::pipeline_t::stop()
+{
+    termination_request.store(true);
+    for(auto & state : states){
+        // Notify under the mutex: A worker that is about to sleep has
+        // either seen the termination request or receives the notification
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->wakeup.notify_all();
+        }
+        if( state->thread.joinable() )
+            state->thread.join();
+    }
+}
+
+void mhachain::pipeline_t::wake(unsigned s)
+{
+    // The first stage runs in the processing thread, which never sleeps.
+    // A worker sets sleeping before checking its fifos a last time,
+    // therefore either it sees the new data or we see the sleeping worker.
+    if( (s == 0U) || (s >= states.size()) )
+        return;
+    stage_state_t & state = *states[s];
+    if( state.sleeping.load() ){
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.wakeup.notify_one();
+    }
+}
+
+template <class F>
+bool mhachain::pipeline_t::worker_wait(stage_state_t & state, F ready)
+{
+    const auto spin_end = std::chrono::steady_clock::now() + spin_time;
+    while( !ready() ){
+        if( termination_request.load() )
+            return false;
+        if( std::chrono::steady_clock::now() < spin_end ){
+            cpu_relax();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.sleeping.store(true);
+        state.wakeup.wait(lock,[&]{return termination_request.load() || ready();});
+        state.sleeping.store(false);
+    }
+    return !termination_request.load();
+}
+
+template <class F>
+void mhachain::pipeline_t::processing_wait(F ready)
+{
+    const auto spin_end = std::chrono::steady_clock::now() + spin_time;
+    while( !ready() ){
+        rethrow_worker_error();
+        if( std::chrono::steady_clock::now() < spin_end )
+            cpu_relax();
+        else
+            std::this_thread::yield();
+    }
+}
+
+void mhachain::pipeline_t::rethrow_worker_error() const
+{
+    for(const auto & state : states)
+        if( state->failed.load() )
+            throw MHA_Error(*state->error);
+}
+
+void mhachain::pipeline_t::worker_main(unsigned s)
+{
+    stage_state_t & state = *states[s];
+    boundary_t & in = *boundaries[s-1U];
+    boundary_t & out = *boundaries[s];
+    unsigned in_slot, out_slot;
+    try{
+        while( worker_wait(state,[&]{return in.filled.get_fill_count() > 0U;}) ){
+            in.filled.read(&in_slot,1U);
+            const uint64_t t0 = MHAProfiling::now_ns();
+            mha_wave_t* wv = in.slots[in_slot].wave.get();
+            mha_spec_t* sp = in.slots[in_slot].spec.get();
+            stages[s](wv,sp,&wv,&sp);
+            const uint64_t t1 = MHAProfiling::now_ns();
+            if( !worker_wait(state,[&]{return out.free.get_fill_count() > 0U;}) )
+                return;
+            out.free.read(&out_slot,1U);
+            const uint64_t t2 = MHAProfiling::now_ns();
+            out.slots[out_slot].copy_from(wv,sp);
+            state.busy_ns.fetch_add((t1 - t0) + (MHAProfiling::now_ns() - t2));
+            in.free.write(&in_slot,1U);
+            wake(s-1U);
+            out.filled.write(&out_slot,1U);
+            wake(s+1U);
+        }
+    }
+    catch(MHA_Error & e){
+        state.error.reset(new MHA_Error(e));
+        state.failed.store(true);
+    }
+    catch(std::exception & e){
+        state.error.reset(new MHA_Error(__FILE__,__LINE__,"%s",e.what()));
+        state.failed.store(true);
+    }
+}
+
+void mhachain::pipeline_t::process(mha_wave_t* win,mha_spec_t* sin,
+                                   mha_wave_t** wout,mha_spec_t** sout)
+{
+    rethrow_worker_error();
+    const uint64_t t0 = MHAProfiling::now_ns();
+    if( t_start.load() == 0U )
+        t_start.store(t0);
+    mha_wave_t* wv = win;
+    mha_spec_t* sp = sin;
+    stages[0](wv,sp,&wv,&sp);
+    const uint64_t t1 = MHAProfiling::now_ns();
+    boundary_t & first = *boundaries.front();
+    unsigned slot;
+    processing_wait([&]{return first.free.get_fill_count() > 0U;});
+    first.free.read(&slot,1U);
+    const uint64_t t2 = MHAProfiling::now_ns();
+    first.slots[slot].copy_from(wv,sp);
+    states[0]->busy_ns.fetch_add((t1 - t0) + (MHAProfiling::now_ns() - t2));
+    first.filled.write(&slot,1U);
+    wake(1U);
+    boundary_t & last = *boundaries.back();
+    if( last.filled.get_fill_count() == 0U ){
+        waits.fetch_add(1U);
+        processing_wait([&]{return last.filled.get_fill_count() > 0U;});
+    }
+    last.filled.read(&slot,1U);
+    output.copy_from(last.slots[slot].wave.get(),last.slots[slot].spec.get());
+    last.free.write(&slot,1U);
+    wake(states.size()-1U);
+    if( wout )
+        *wout = output.wave.get();
+    if( sout )
+        *sout = output.spec.get();
+}
+
+std::vector<float> mhachain::pipeline_t::get_occupancy() const
+{
+    std::vector<float> occupancy(states.size(),0.0f);
+    const uint64_t start = t_start.load();
+    if( start == 0U )
+        return occupancy;
+    const uint64_t elapsed = MHAProfiling::now_ns() - start;
+    if( elapsed == 0U )
+        return occupancy;
+    for(unsigned s=0;s<states.size();s++)
+        occupancy[s] = 100.0f * float(states[s]->busy_ns.load()) / float(elapsed);
+    return occupancy;
+}
+
 mhachain::plugs_t::plugs_t(std::vector<std::string> algos,
                            mhaconfig_t cfin,
                            mhaconfig_t cfout,
                            bool do_prepare,
                            MHAParser::parser_t& p,
                            MHA_AC::algo_comm_t & iac,
-                           bool use_profiling)
+                           bool use_profiling,
+                           const pipeline_cfg_t & pipeline_cfg_)
     : b_prepared(false),
       parser(p),
       ac(iac),
@@ -117,9 +449,22 @@ mhachain::plugs_t::plugs_t(std::vector<std::string> algos,
       prof_process("cumulative time of process callback / seconds"),
       prof_process_tt("total processed signal time / seconds"),
       prof_process_load("load of process callback / percent"),
+      prof_process_min("shortest duration of process callback / seconds"),
+      prof_process_p50("median duration of process callback / seconds"),
+      prof_process_p99("99th percentile of duration of process callback / seconds"),
+      prof_process_p999("99.9th percentile of duration of process callback / seconds"),
+      prof_process_max("longest duration of process callback / seconds"),
+      prof_process_overruns("number of process callbacks that took longer than\n"
+                            "the duration of one block (fragsize/srate)"),
+      prof_chain_latency("duration of processing one block by the whole chain / seconds:\n"
+                         "[min median p99 p99.9 max]"),
+      prof_chain_overruns("number of blocks that took longer than their duration\n"
+                          "(fragsize/srate) to process by the whole chain"),
+      prof_hist(use_profiling ? algos.size() : 0U),
       prof_load_con(&prof_process_load.prereadaccess,this,&mhachain::plugs_t::update_proc_load),
       prof_tt_con(&prof_process_tt.prereadaccess,this,&mhachain::plugs_t::update_proc_load),
-      b_use_profiling(use_profiling)
+      b_use_profiling(use_profiling),
+      pipeline_cfg(pipeline_cfg_)
 {
     profiling.insert_item("algos",&prof_algos);
     profiling.insert_item("init",&prof_init);
@@ -128,6 +473,24 @@ mhachain::plugs_t::plugs_t(std::vector<std::string> algos,
     profiling.insert_item("process",&prof_process);
     profiling.insert_item("process_tt",&prof_process_tt);
     profiling.insert_item("process_load",&prof_process_load);
+    profiling.insert_item("process_min",&prof_process_min);
+    profiling.insert_item("process_p50",&prof_process_p50);
+    profiling.insert_item("process_p99",&prof_process_p99);
+    profiling.insert_item("process_p999",&prof_process_p999);
+    profiling.insert_item("process_max",&prof_process_max);
+    profiling.insert_item("process_overruns",&prof_process_overruns);
+    profiling.insert_item("chain_latency",&prof_chain_latency);
+    profiling.insert_item("chain_overruns",&prof_chain_overruns);
+    for(auto mon : std::vector<MHAParser::base_t*>{&prof_process_min,
+                                                   &prof_process_p50,
+                                                   &prof_process_p99,
+                                                   &prof_process_p999,
+                                                   &prof_process_max,
+                                                   &prof_process_overruns,
+                                                   &prof_chain_latency,
+                                                   &prof_chain_overruns})
+        prof_patchbay.connect(&mon->prereadaccess,this,
+                              &mhachain::plugs_t::update_latency);
     profiling.set_node_id("chain_profiler");
     if( b_use_profiling ){
         prof_algos.data = algos;
@@ -162,18 +525,50 @@ void mhachain::plugs_t::update_proc_load()
         prof_process_load.data[k] *= 100.0f/prof_process_tt.data;
 }
 
+void mhachain::plugs_t::update_latency()
+{
+    // Percentiles are computed here in the configuration thread, the
+    // signal processing only fills the histograms.
+    const auto seconds = [](uint64_t ns){return 1e-9f * ns;};
+    const unsigned n = prof_hist.size();
+    prof_process_min.data.resize(n);
+    prof_process_p50.data.resize(n);
+    prof_process_p99.data.resize(n);
+    prof_process_p999.data.resize(n);
+    prof_process_max.data.resize(n);
+    prof_process_overruns.data.resize(n);
+    for(unsigned int k=0;k<n;k++){
+        const auto & h = prof_hist[k];
+        prof_process_min.data[k] = seconds(h.get_min());
+        prof_process_p50.data[k] = seconds(h.get_percentile(50));
+        prof_process_p99.data[k] = seconds(h.get_percentile(99));
+        prof_process_p999.data[k] = seconds(h.get_percentile(99.9));
+        prof_process_max.data[k] = seconds(h.get_max());
+        prof_process_overruns.data[k] =
+            std::min<uint64_t>(h.get_overruns(),std::numeric_limits<int>::max());
+    }
+    if( b_use_profiling )
+        prof_chain_latency.data = {seconds(prof_chain_hist.get_min()),
+                                   seconds(prof_chain_hist.get_percentile(50)),
+                                   seconds(prof_chain_hist.get_percentile(99)),
+                                   seconds(prof_chain_hist.get_percentile(99.9)),
+                                   seconds(prof_chain_hist.get_max())};
+    prof_chain_overruns.data =
+        std::min<uint64_t>(prof_chain_hist.get_overruns(),
+                           std::numeric_limits<int>::max());
+}
+
 void mhachain::plugs_t::alloc_plugs(std::vector<std::string> algonames)
 {
     if( algos.size() )
         throw MHA_ErrorMsg("mhachain: The algos are not empty. This is a fatal bug.");
     for( unsigned int k=0;k<algonames.size();k++){
-        if( b_use_profiling )
-            mha_platform_tic(&tictoc);
+        const uint64_t t_start = b_use_profiling ? MHAProfiling::now_ns() : 0U;
         algos.push_back(new PluginLoader::mhapluginloader_t(ac,algonames[k]));
         if( algos.back()->has_parser() )
             parser.insert_item(algos.back()->get_configname(),algos.back());
         if( b_use_profiling )
-            prof_init.data[k] = mha_platform_toc(&tictoc);
+            prof_init.data[k] = seconds_since(t_start);
     }
 }
 
@@ -190,18 +585,35 @@ void mhachain::plugs_t::prepare(mhaconfig_t& tf)
 {
     proc_cnt = 0;
     prof_cfg = tf;
+    if( b_use_profiling ){
+        // Deadline is the duration of one block
+        const uint64_t deadline = tf.srate > 0 ?
+            uint64_t(1e9 * tf.fragsize / tf.srate) : 0U;
+        for(auto & h : prof_hist){
+            h.reset();
+            h.set_deadline(deadline);
+        }
+        prof_chain_hist.reset();
+        prof_chain_hist.set_deadline(deadline);
+    }
+    // Output signal configuration of each plugin, needed for the
+    // frame buffers between pipeline stages
+    std::vector<mhaconfig_t> cf_out(algos.size());
     unsigned int k, kmax = 0;
     try{
         for(k=0;k<algos.size();k++){
             kmax = k;
-            if( b_use_profiling )
-                mha_platform_tic(&tictoc);
+            const uint64_t t_start = b_use_profiling ? MHAProfiling::now_ns() : 0U;
             algos[k]->prepare(tf);
+            cf_out[k] = tf;
             if( b_use_profiling ){
-                prof_prepare.data[k] = mha_platform_toc(&tictoc);
+                prof_prepare.data[k] = seconds_since(t_start);
                 prof_process.data[k] = 0;
             }
         }
+        kmax = algos.size();
+        if( pipeline_cfg.stages.size() )
+            start_pipeline(cf_out);
         b_prepared = true;
     }
     catch(MHA_Error& e){
@@ -212,26 +624,80 @@ void mhachain::plugs_t::prepare(mhaconfig_t& tf)
     }
 }
 
+void mhachain::plugs_t::start_pipeline(const std::vector<mhaconfig_t> & cf_out)
+{
+    const std::vector<int> & starts = pipeline_cfg.stages;
+    for(unsigned int k=0;k<starts.size();k++)
+        if( (starts[k] < 1) || (starts[k] >= int(algos.size())) ||
+            (k && (starts[k] <= starts[k-1])) )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "mhachain: pipeline_stages must be ascending plugin"
+                            " indices between 1 and %d (entry %u is %d).",
+                            int(algos.size())-1, k, starts[k]);
+    const unsigned int num_stages = starts.size()+1U;
+    const int latency = pipeline_cfg.latency < 0 ?
+        int(num_stages)-1 : pipeline_cfg.latency;
+    if( latency < int(num_stages)-1 )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "mhachain: pipeline_latency of %d blocks is too small"
+                        " for %u pipeline stages (minimum %u).",
+                        latency, num_stages, num_stages-1U);
+    std::vector<pipeline_t::stage_t> stage_fns;
+    std::vector<mhaconfig_t> stage_cf;
+    for(unsigned int s=0;s<num_stages;s++){
+        const unsigned int first = s ? starts[s-1] : 0U;
+        const unsigned int last = (s < starts.size()) ? starts[s] : algos.size();
+        stage_fns.push_back([this,first,last](mha_wave_t* wv,mha_spec_t* sp,
+                                              mha_wave_t** wout,mha_spec_t** sout)
+                            {process_plugins(first,last,wv,sp,wout,sout);});
+        stage_cf.push_back(cf_out[last-1]);
+    }
+    pipeline.reset(new pipeline_t(stage_fns,stage_cf,latency,pipeline_cfg.cpus,
+                                  std::max(pipeline_cfg.spin_us,0)));
+}
+
+std::vector<float> mhachain::plugs_t::get_pipeline_occupancy() const
+{
+    return pipeline ? pipeline->get_occupancy() : std::vector<float>();
+}
+
+uint64_t mhachain::plugs_t::get_pipeline_waits() const
+{
+    return pipeline ? pipeline->get_waits() : 0U;
+}
+
 void mhachain::plugs_t::release()
 {
     b_prepared = false;
+    // Stop the stage threads before their plugins are released
+    pipeline.reset();
     for(unsigned int k=0;k<algos.size();k++){
-        if( b_use_profiling )
-            mha_platform_tic(&tictoc);
+        const uint64_t t_start = b_use_profiling ? MHAProfiling::now_ns() : 0U;
         algos[k]->release();
         if( b_use_profiling )
-            prof_release.data[k] = mha_platform_toc(&tictoc);
+            prof_release.data[k] = seconds_since(t_start);
     }
 }
 
 void mhachain::plugs_t::process(mha_wave_t* win,mha_spec_t* sin,mha_wave_t** wout,mha_spec_t** sout)
 {
     proc_cnt++;
-    mha_wave_t* wv = win;
-    mha_spec_t* sp = sin;
-    for(unsigned int k=0;k<algos.size();k++){
-        if( b_use_profiling )
-            mha_platform_tic(&tictoc);
+    const uint64_t t_start = b_use_profiling ? MHAProfiling::now_ns() : 0U;
+    if( pipeline )
+        pipeline->process(win,sin,wout,sout);
+    else
+        process_plugins(0,algos.size(),win,sin,wout,sout);
+    if( b_use_profiling )
+        prof_chain_hist.add(MHAProfiling::now_ns() - t_start);
+}
+
+void mhachain::plugs_t::process_plugins(unsigned int first,unsigned int last,
+                                        mha_wave_t* wv,mha_spec_t* sp,
+                                        mha_wave_t** wout,mha_spec_t** sout)
+{
+    // The end of one plugin's process callback is the start of the next
+    uint64_t t_prev = b_use_profiling ? MHAProfiling::now_ns() : 0U;
+    for(unsigned int k=first;k<last;k++){
         switch( algos[k]->input_domain() ){
         case MHA_WAVEFORM :
             switch( algos[k]->output_domain() ){
@@ -254,8 +720,12 @@ void mhachain::plugs_t::process(mha_wave_t* win,mha_spec_t* sin,mha_wave_t** wou
             }
             break;
         }
-        if( b_use_profiling )
-            prof_process.data[k] += mha_platform_toc(&tictoc);
+        if( b_use_profiling ){
+            const uint64_t t = MHAProfiling::now_ns();
+            prof_process.data[k] += 1e-9f * (t - t_prev);
+            prof_hist[k].add(t - t_prev);
+            t_prev = t;
+        }
     }
     if( wout )
         *wout = wv;
@@ -19,11 +19,139 @@
 #include "mha_defs.h"
 #include "mha_plugin.hh"
 #include "mha_events.h"
-#include "mha_profiling.h"
+#include "mha_latency_histogram.hh"
 #include "mhapluginloader.h"
+#include "mha_fifo.h"
+#include "mha_signal.hh"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace mhachain {
 
+    /// Settings of the pipeline-parallel execution of a chain
+    struct pipeline_cfg_t {
+        /// Indices of the plugins that start a new stage, ascending.
+        /// Empty: serial processing of all plugins.
+        std::vector<int> stages;
+        /// Delay of the chain output in blocks, -1: number of stages - 1
+        int latency = -1;
+        /// CPU cores for pinning the worker threads, empty: no pinning
+        std::vector<int> cpus;
+        /// Time in microseconds that waiting threads spin
+        int spin_us = 500;
+    };
+
+    /** Pipeline-parallel processing of consecutive blocks.
+     *
+     * The processing is divided into consecutive stages.  The first
+     * stage runs in the signal processing thread, every further stage
+     * in a worker thread of its own.  While the first stage processes
+     * block n, the worker of stage s processes an older block, so that
+     * the stages of one chain can use separate CPU cores.
+     *
+     * The output signal of each stage is copied into one of a pool of
+     * frame buffers (slots).  The indices of filled slots are passed to
+     * the next stage, the indices of consumed slots back to the
+     * producing stage, through lock-free fifos.  The processing thread
+     * receives the output of the last stage with a constant delay of
+     * latency blocks; the first latency output blocks are zero.  If
+     * the last stage has not finished a block in time, the processing
+     * thread waits for it, so that the output does not depend on the
+     * timing of the threads.
+     *
+     * Waiting workers spin for the configured time, then sleep until
+     * the neighbouring stage wakes them.  The processing thread does
+     * not sleep, after spinning it yields the CPU while it waits.
+     */
+    class pipeline_t {
+    public:
+        /// Processing of one stage, with the signature of plugs_t::process
+        typedef std::function<void(mha_wave_t*,mha_spec_t*,
+                                   mha_wave_t**,mha_spec_t**)> stage_t;
+        /** Start the worker threads.
+         * @param stages Processing of each stage, at least two stages.
+         * @param cf_out Output signal configuration of each stage.
+         * @param latency Delay of the output in blocks, at least the
+         *                number of stages - 1.
+         * @param cpus CPU cores for pinning.  The worker of stage s is
+         *             pinned to cpus[(s-1) modulo cpus.size()].
+         *             Empty: No pinning.  Only supported on Linux.
+         * @param spin_us Time in microseconds that waiting threads spin. */
+        pipeline_t(const std::vector<stage_t> & stages,
+                   const std::vector<mhaconfig_t> & cf_out,
+                   unsigned latency,
+                   const std::vector<int> & cpus,
+                   unsigned spin_us);
+        /// Stops and joins the worker threads.
+        ~pipeline_t();
+        pipeline_t(const pipeline_t &) = delete;
+        pipeline_t & operator=(const pipeline_t &) = delete;
+        /** Process one block in the first stage and return the output
+         * of the last stage for the block from latency calls ago.
+         * Only called by the signal processing thread.
+         * @throw MHA_Error if the processing of any stage failed. */
+        void process(mha_wave_t*,mha_spec_t*,mha_wave_t**,mha_spec_t**);
+        /** Percentage of the time since the first call to process that
+         * each stage was busy processing and copying blocks. */
+        std::vector<float> get_occupancy() const;
+        /// Number of blocks for which the processing thread had to wait
+        /// for the last stage.
+        uint64_t get_waits() const {return waits.load();}
+    private:
+        /// Frame buffer for the output signal of one stage
+        struct slot_t {
+            explicit slot_t(const mhaconfig_t & cf);
+            /// Copy the signal of the domain of this slot
+            void copy_from(const mha_wave_t * wv, const mha_spec_t * sp);
+            std::unique_ptr<MHASignal::waveform_t> wave;
+            std::unique_ptr<MHASignal::spectrum_t> spec;
+        };
+        /// Slots between one stage and the next
+        struct boundary_t {
+            boundary_t(const mhaconfig_t & cf, unsigned num_slots);
+            std::vector<slot_t> slots;
+            /// Indices of filled slots, written by the producing stage
+            mha_fifo_lf_t<unsigned> filled;
+            /// Indices of free slots, written by the consuming stage
+            mha_fifo_lf_t<unsigned> free;
+        };
+        /// State of one stage
+        struct stage_state_t {
+            /// Worker thread, not used by the first stage
+            std::thread thread;
+            /// Set by a worker before it sleeps on wakeup
+            std::atomic<bool> sleeping{false};
+            std::mutex mutex;
+            std::condition_variable wakeup;
+            /// Accumulated processing time in ns
+            std::atomic<uint64_t> busy_ns{0U};
+            /// Set after error has been stored by a failed worker
+            std::atomic<bool> failed{false};
+            std::unique_ptr<MHA_Error> error;
+        };
+        void worker_main(unsigned s);
+        template <class F> bool worker_wait(stage_state_t & state, F ready);
+        template <class F> void processing_wait(F ready);
+        void wake(unsigned s);
+        void rethrow_worker_error() const;
+        void stop();
+        std::vector<stage_t> stages;
+        std::vector<std::unique_ptr<boundary_t>> boundaries;
+        std::vector<std::unique_ptr<stage_state_t>> states;
+        /// Output signal returned by process
+        slot_t output;
+        std::chrono::microseconds spin_time;
+        std::atomic<bool> termination_request;
+        /// Time of the first call to process in ns, 0 before
+        std::atomic<uint64_t> t_start;
+        std::atomic<uint64_t> waits;
+    };
+
     class plugs_t {
     public:
         plugs_t( std::vector<std::string> algos,
@@ -32,16 +160,27 @@ namespace mhachain {
                  bool do_prepare,
                  MHAParser::parser_t& p,
                  MHA_AC::algo_comm_t & iac,
-                 bool use_profiling);
+                 bool use_profiling,
+                 const pipeline_cfg_t & pipeline_cfg);
         ~plugs_t();
         void prepare(mhaconfig_t&);
         void release();
         void process(mha_wave_t*,mha_spec_t*,mha_wave_t**,mha_spec_t**);
         bool prepared() const {return b_prepared;};
+        /// Pipeline settings applied by the next prepare
+        void set_pipeline_cfg(const pipeline_cfg_t & cfg) {pipeline_cfg = cfg;}
+        /// Occupancy of the pipeline stages in percent, empty if serial
+        std::vector<float> get_pipeline_occupancy() const;
+        /// Blocks for which processing waited for the last stage
+        uint64_t get_pipeline_waits() const;
     private:
+        void process_plugins(unsigned int first,unsigned int last,
+                             mha_wave_t*,mha_spec_t*,mha_wave_t**,mha_spec_t**);
+        void start_pipeline(const std::vector<mhaconfig_t> & cf_out);
         void alloc_plugs(std::vector<std::string> algos);
         void cleanup_plugs();
         void update_proc_load();
+        void update_latency();
         bool b_prepared;
         std::vector< PluginLoader::mhapluginloader_t* > algos;
         MHAParser::parser_t& parser;
@@ -54,12 +193,27 @@ namespace mhachain {
         MHAParser::vfloat_mon_t prof_process;
         MHAParser::float_mon_t prof_process_tt;
         MHAParser::vfloat_mon_t prof_process_load;
+        MHAParser::vfloat_mon_t prof_process_min;
+        MHAParser::vfloat_mon_t prof_process_p50;
+        MHAParser::vfloat_mon_t prof_process_p99;
+        MHAParser::vfloat_mon_t prof_process_p999;
+        MHAParser::vfloat_mon_t prof_process_max;
+        MHAParser::vint_mon_t prof_process_overruns;
+        MHAParser::vfloat_mon_t prof_chain_latency;
+        MHAParser::int_mon_t prof_chain_overruns;
+        /// Processing time histograms of the plugins, filled by process()
+        std::vector<MHAProfiling::latency_histogram_t> prof_hist;
+        /// Processing time histogram of the whole chain
+        MHAProfiling::latency_histogram_t prof_chain_hist;
         unsigned int proc_cnt;
         mhaconfig_t prof_cfg;
         MHAEvents::connector_t<mhachain::plugs_t> prof_load_con;
         MHAEvents::connector_t<mhachain::plugs_t> prof_tt_con;
+        MHAEvents::patchbay_t<mhachain::plugs_t> prof_patchbay;
         bool b_use_profiling;
-        mha_platform_tictoc_t tictoc;
+        pipeline_cfg_t pipeline_cfg;
+        /// Stage threads while prepared in pipeline mode
+        std::unique_ptr<pipeline_t> pipeline;
     };
 
     class chain_base_t : public MHAPlugin::plugin_t<mhachain::plugs_t> {
@@ -74,9 +228,17 @@ namespace mhachain {
         void release();
     private:
         void update();
+        pipeline_cfg_t get_pipeline_cfg() const;
+        void update_pipeline_monitors();
     protected:
         MHAParser::bool_t bprofiling;
         MHAParser::vstring_t algos;
+        MHAParser::vint_t pipeline_stages;
+        MHAParser::int_t pipeline_latency;
+        MHAParser::vint_t pipeline_cpus;
+        MHAParser::int_t pipeline_spin_time;
+        MHAParser::vfloat_mon_t pipeline_occupancy;
+        MHAParser::int_mon_t pipeline_waits;
     private:
         std::vector<std::string> old_algos;
         MHAEvents::patchbay_t < mhachain::chain_base_t > patchbay;
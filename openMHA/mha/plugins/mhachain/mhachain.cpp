@@ -34,6 +34,12 @@ mhachain::mhachain_t::mhachain_t(MHA_AC::algo_comm_t & iac,
 {
     insert_item("use_profiling",&bprofiling);
     insert_item("algos",&algos);
+    insert_item("pipeline_stages",&pipeline_stages);
+    insert_item("pipeline_latency",&pipeline_latency);
+    insert_item("pipeline_cpus",&pipeline_cpus);
+    insert_item("pipeline_spin_time",&pipeline_spin_time);
+    insert_item("pipeline_occupancy",&pipeline_occupancy);
+    insert_item("pipeline_waits",&pipeline_waits);
 }
 
 
@@ -48,7 +54,17 @@ MHAPLUGIN_DOCUMENTATION\
  " During processing, the signal is passed from plugin to plugin,"
  " and may change its domain or dimension.\n\n"
  "If profiling is switched on, the cumulative time spent in the processing"
- " callback of each plugin is stored in a monitor variable.\n\n"
+ " callback of each plugin is stored in a monitor variable."
+ " In addition, the duration of every process callback is recorded in a"
+ " histogram per plugin, from which the monitor variables in the"
+ " {\\em profiling} sub-parser report the minimum, median, 99th and"
+ " 99.9th percentile, and maximum duration in seconds with a resolution"
+ " of about 3\\%.  Callbacks that took longer than the"
+ " duration of one block of audio (fragsize/srate) are counted as"
+ " deadline overruns, for each plugin and for the whole chain."
+ " Time is measured with a monotonic clock.  The histograms are reset"
+ " when the chain is prepared.  The overhead is small enough to leave"
+ " profiling switched on during normal operation.\n\n"
  "Plugins are loaded by assigning a vector of strings to the configuration"
  " variable {\\em algos}.  Each entry in this vector has the form"
  " \\textit{plugin}\\textcolor{orange}{\\textit{:configured\\_name}}"
@@ -70,7 +86,33 @@ MHAPLUGIN_DOCUMENTATION\
  "The plugins loaded by assigning to configuration variable {\\em algos}"
  " cause creation of sub-parsers named like the"
  " \\textcolor{orange}{\\textit{configured\\_name}} in the mhachain plugin"
- " configuration and can be configured through these sub-parsers."
+ " configuration and can be configured through these sub-parsers.\n\n"
+ "By default, all plugins process each block one after the other in the"
+ " signal processing thread, so that the chain can use only one processor"
+ " core.  For offline processing and other applications that can tolerate"
+ " additional latency, the chain can be split into pipeline stages by"
+ " assigning the indices of the plugins that start a new stage to"
+ " {\\em pipeline\\_stages}, e.g. {\\tt pipeline\\_stages = [2 5]}"
+ " divides a chain of 7 plugins into the stages 0--1, 2--4 and 5--6."
+ " The first stage runs in the signal processing thread, every further"
+ " stage in a thread of its own, which can be pinned to a processor core"
+ " with {\\em pipeline\\_cpus}.  While the first stage processes the"
+ " current block, the following stages work on previous blocks.  The"
+ " stages exchange the blocks through lock-free fifos, the throughput"
+ " therefore scales with the number of stages as long as the stages take"
+ " similar processing time.  The output of the chain is delayed by"
+ " {\\em pipeline\\_latency} blocks, at least the number of stages minus"
+ " one, and starts with this number of blocks of zeros.  A larger latency"
+ " lets the stages absorb variations of their processing time.  If the last"
+ " stage has not finished a block in time, the signal processing thread"
+ " waits for it, which is counted in {\\em pipeline\\_waits}.  The monitor"
+ " {\\em pipeline\\_occupancy} reports the percentage of time each stage"
+ " was busy.  The pipeline settings take effect when the chain is prepared"
+ " or {\\em algos} is assigned.  Plugins in different stages process"
+ " different blocks at the same time, therefore they must not exchange"
+ " data through AC variables.  In pipeline mode, the profiling monitors"
+ " {\\em chain\\_latency} and {\\em chain\\_overruns} measure only the"
+ " time spent in the signal processing thread."
  )
 
 /*
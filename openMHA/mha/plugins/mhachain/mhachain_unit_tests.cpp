@@ -0,0 +1,133 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "mha_generic_chain.h"
+
+namespace {
+  const mhaconfig_t wave_cfg = {
+    .channels = 2, .domain = MHA_WAVEFORM, .fragsize = 8,
+    .wndlen = 0, .fftlen = 0, .srate = 16000
+  };
+  const mhaconfig_t spec_cfg = {
+    .channels = 2, .domain = MHA_SPECTRUM, .fragsize = 8,
+    .wndlen = 16, .fftlen = 16, .srate = 16000
+  };
+
+  /// Stage that adds a constant to the waveform in place
+  mhachain::pipeline_t::stage_t add(mha_real_t value)
+  {
+    return [value](mha_wave_t* wv, mha_spec_t* sp,
+                   mha_wave_t** wout, mha_spec_t** sout) {
+      for (unsigned k = 0; k < size(wv); ++k)
+        wv->buf[k] += value;
+      *wout = wv;
+      *sout = sp;
+    };
+  }
+}
+
+TEST(mhachain_pipeline, delays_output_by_latency)
+{
+  const unsigned latency = 4;
+  mhachain::pipeline_t pipeline({add(1), add(10), add(100)},
+                                {wave_cfg, wave_cfg, wave_cfg},
+                                latency, {}, 50);
+  MHASignal::waveform_t in(wave_cfg.fragsize, wave_cfg.channels);
+  for (unsigned block = 0; block < 50; ++block) {
+    in.assign(mha_real_t(block));
+    mha_wave_t* out = nullptr;
+    mha_spec_t* sout = nullptr;
+    pipeline.process(&in, nullptr, &out, &sout);
+    ASSERT_NE(nullptr, out);
+    EXPECT_EQ(nullptr, sout);
+    const mha_real_t expected =
+      block < latency ? 0.0f : mha_real_t(block - latency) + 111.0f;
+    for (unsigned k = 0; k < size(out); ++k)
+      ASSERT_EQ(expected, out->buf[k]) << "block " << block;
+  }
+  EXPECT_EQ(3U, pipeline.get_occupancy().size());
+}
+
+TEST(mhachain_pipeline, transfers_spectrum_between_stages)
+{
+  // The second stage transforms the waveform into a spectrum
+  MHASignal::spectrum_t spec(spec_cfg.fftlen / 2 + 1, spec_cfg.channels);
+  auto to_spec = [&spec](mha_wave_t* wv, mha_spec_t*,
+                         mha_wave_t**, mha_spec_t** sout) {
+    for (unsigned ch = 0; ch < spec.num_channels; ++ch)
+      for (unsigned k = 0; k < spec.num_frames; ++k)
+        spec(k, ch) = mha_complex(value(wv, 0, ch), k);
+    *sout = &spec;
+  };
+  auto conjugate = [](mha_wave_t*, mha_spec_t* sp,
+                      mha_wave_t**, mha_spec_t** sout) {
+    for (unsigned k = 0; k < size(sp); ++k)
+      sp->buf[k].im = -sp->buf[k].im;
+    *sout = sp;
+  };
+  mhachain::pipeline_t pipeline({add(0.5f), to_spec, conjugate},
+                                {wave_cfg, spec_cfg, spec_cfg}, 2, {}, 0);
+  MHASignal::waveform_t in(wave_cfg.fragsize, wave_cfg.channels);
+  for (unsigned block = 0; block < 20; ++block) {
+    in.assign(mha_real_t(block));
+    mha_spec_t* out = nullptr;
+    pipeline.process(&in, nullptr, nullptr, &out);
+    ASSERT_NE(nullptr, out);
+    ASSERT_EQ(spec_cfg.fftlen / 2 + 1, out->num_frames);
+    for (unsigned k = 0; k < out->num_frames; ++k) {
+      EXPECT_EQ(block < 2 ? 0.0f : block - 2 + 0.5f, out->buf[k].re);
+      EXPECT_EQ(block < 2 ? 0.0f : -mha_real_t(k), out->buf[k].im);
+    }
+  }
+}
+
+TEST(mhachain_pipeline, rethrows_error_of_worker)
+{
+  unsigned calls = 0;
+  auto fail = [&calls](mha_wave_t* wv, mha_spec_t* sp,
+                       mha_wave_t** wout, mha_spec_t** sout) {
+    if (++calls == 3)
+      throw MHA_Error(__FILE__, __LINE__, "stage failed");
+    *wout = wv;
+    *sout = sp;
+  };
+  mhachain::pipeline_t pipeline({add(1), fail}, {wave_cfg, wave_cfg},
+                                1, {}, 50);
+  MHASignal::waveform_t in(wave_cfg.fragsize, wave_cfg.channels);
+  mha_wave_t* out = nullptr;
+  bool thrown = false;
+  // The error is noticed when the processing thread waits for the stage
+  // or at the start of a later block
+  for (unsigned block = 0; block < 10 && !thrown; ++block) {
+    try {
+      pipeline.process(&in, nullptr, &out, nullptr);
+    } catch (MHA_Error & e) {
+      thrown = true;
+      EXPECT_NE(std::string::npos, std::string(e.get_msg()).find("stage failed"));
+    }
+  }
+  EXPECT_TRUE(thrown);
+  EXPECT_THROW(pipeline.process(&in, nullptr, &out, nullptr), MHA_Error);
+}
+
+TEST(mhachain_pipeline, rejects_too_small_latency)
+{
+  EXPECT_THROW(mhachain::pipeline_t({add(1), add(2), add(3)},
+                                    {wave_cfg, wave_cfg, wave_cfg}, 1, {}, 0),
+               MHA_Error);
+  EXPECT_THROW(mhachain::pipeline_t({add(1)}, {wave_cfg}, 1, {}, 0),
+               MHA_Error);
+}
@@ -15,94 +15,9 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "mha_plugin.hh"
-#include "mha_events.h"
-
-// add normalization types in string list and in the definitions:
-#define NORMALIZATION_TYPES "[none default sum]"
-#define NORM_NONE 0
-#define NORM_DEFAULT 1
-#define NORM_SUM 2
-
-// Estimation types define whether the current value of the input signal
-// u[k] will be used for estimation of the filter coefficnets or not.
-#define ESTIMATION_TYPES "[previous current]"
-#define ESTIM_PREV 0
-#define ESTIM_CUR 1
-
-class rt_nlms_t 
-{
-public:
-    rt_nlms_t(MHA_AC::algo_comm_t & iac,
-              const std::string& name,
-              const mhaconfig_t& cfg,
-              unsigned int ntaps_,
-              const std::string& name_u,
-              const std::string& name_d,
-              const std::string& name_e,
-              const std::string& name_f,
-              const int n_no_update);
-    ~rt_nlms_t() {}
-
-    mha_wave_t* process(mha_wave_t* sUD, mha_real_t rho, mha_real_t c, unsigned int norm_type, unsigned int estim_type, mha_real_t lambda_smooth);
-    void insert();
-private:
-    MHA_AC::algo_comm_t & ac;
-    unsigned int ntaps;
-    unsigned int frames;
-    unsigned int channels;
-    MHA_AC::waveform_t F;
-    MHASignal::waveform_t U; ///< \brief Input signal cache
-    MHASignal::waveform_t Uflt; ///< \brief Input signal cache (second filter)
-    MHASignal::waveform_t Pu; ///< \brief Power of input signal delayline
-    MHASignal::waveform_t fu; ///< \brief Filtered input signal
-    MHASignal::waveform_t fuflt; ///< \brief Filtered input signal
-    MHASignal::waveform_t fu_previous;
-    MHASignal::waveform_t y_previous;
-    MHASignal::waveform_t P_Sum; //recursively est. power for NORM_SUM
-
-    std::string name_u_;
-    std::string name_d_;
-    std::string name_e_;
-
-    int n_no_update_;
-    int no_iter;
-
-    mha_wave_t s_E;
-};
-
-/*
- * adaptive filter (LMS algorithm)
- *
- * The input signal u[k] and the output signal y[k] are taken from AC
- * variable. The estimated filter f'[k] and the filtered input signal
- * f'[k]*u[k] are stored into an AC variable. The input signal is not
- * touched and can be either waveform or spectrum.
- */
-class nlms_t : public MHAPlugin::plugin_t<rt_nlms_t>
-{
-public:
-    nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
-    void prepare(mhaconfig_t&);
-    void release();
-    mha_wave_t* process(mha_wave_t*);
-private:
-    void update();
-    //bool prepared;
-    MHAParser::float_t rho;
-    MHAParser::float_t c;
-    MHAParser::int_t ntaps;
-    MHAParser::string_t name_u;
-    MHAParser::string_t name_d;
-    MHAParser::kw_t normtype;
-    MHAParser::kw_t estimtype;
-    MHAParser::float_t lambda_smoothing_power; //recursive smoothing coefficient for sum normalization rule
-    MHAParser::string_t name_e;
-    MHAParser::string_t name_f;
-    MHAParser::int_t n_no_update;
-    std::string algo;
-    MHAEvents::patchbay_t<nlms_t> patchbay;
-};
+#include "nlms_wave.hh"
+#include "mha_simd.hh"
+#include <algorithm>
 
 nlms_t::nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name)
     : MHAPlugin::plugin_t<rt_nlms_t>(
@@ -120,6 +35,10 @@ nlms_t::nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name)
       name_e("Name of error signal E", ""),
       name_f("Name of the AC variable for saving the adapive filter", ""),
       n_no_update("Number of iterations without updating the filter coefficients", "0"),
+      engine("Adaptation engine: time adapts the filter sample by sample"
+             " in the time domain, frequency adapts it once per block with"
+             " a partitioned block frequency domain adaptive filter"
+             " (estimtype is ignored)", "time", ENGINE_TYPES),
       algo(configured_name)
 {
     insert_member(rho);
@@ -133,16 +52,19 @@ nlms_t::nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name)
     insert_member(name_e);
     insert_member(name_f);
     insert_member(n_no_update);
+    insert_member(engine);
     patchbay.connect(&ntaps.writeaccess,this,&nlms_t::update);
     patchbay.connect(&name_u.writeaccess,this,&nlms_t::update);
     patchbay.connect(&name_d.writeaccess,this,&nlms_t::update);
     patchbay.connect(&name_e.writeaccess,this,&nlms_t::update);
+    patchbay.connect(&engine.writeaccess,this,&nlms_t::update);
 }
 
 void nlms_t::update()
 {
     if( is_prepared() )
-        push_config(new rt_nlms_t(ac,algo,tftype,ntaps.data,name_u.data,name_d.data, name_e.data,name_f.data,n_no_update.data));
+        push_config(new rt_nlms_t(ac,algo,tftype,ntaps.data,name_u.data,name_d.data, name_e.data,name_f.data,n_no_update.data,
+                                  engine.data.get_index()));
 }
 
 void nlms_t::prepare(mhaconfig_t& cf)
@@ -180,6 +102,140 @@ inline void make_friendly_number_by_limiting( mha_real_t& x )
         x = -1.0e20;
 }
 
+pbfdaf_t::pbfdaf_t(MHASignal::waveform_t & F_, unsigned frames_,
+                   unsigned channels_)
+    : F(F_),
+      ntaps(F_.num_frames),
+      frames(frames_),
+      channels(channels_),
+      partitions((ntaps + frames - 1U) / frames),
+      fft(mha_fft_new(2U * frames, channels)),
+      u2(2U * frames, channels),
+      x2(2U * frames, channels),
+      head(0U),
+      acc(frames + 1U, channels),
+      E(frames + 1U, channels),
+      wave2(2U * frames, channels),
+      fu(frames, channels),
+      u_sq(ntaps, channels),
+      u_sq_pos(0U),
+      Pu(channels, 0.0),
+      P_Sum(channels, 0.0f)
+{
+    U.reserve(partitions);
+    X.reserve(partitions);
+    W.reserve(partitions);
+    for (unsigned p = 0; p < partitions; ++p) {
+        U.emplace_back(frames + 1U, channels);
+        X.emplace_back(frames + 1U, channels);
+        W.emplace_back(frames + 1U, channels);
+        transform_partition(p);
+    }
+}
+
+pbfdaf_t::~pbfdaf_t()
+{
+    mha_fft_free(fft);
+}
+
+void pbfdaf_t::transform_partition(unsigned p)
+{
+    clear(wave2);
+    const unsigned taps = std::min(frames, ntaps - p * frames);
+    std::copy(F.buf + p * frames * channels,
+              F.buf + (p * frames + taps) * channels, wave2.buf);
+    mha_fft_wave2spec_scale(fft, &wave2, &W[p]);
+    for (unsigned k = 0; k < W[p].num_frames * channels; ++k)
+        W[p].buf[k].im = -W[p].buf[k].im;
+}
+
+void pbfdaf_t::process(const mha_wave_t & s_U, const mha_wave_t & s_D,
+                       const mha_wave_t * s_E, const mha_wave_t & s_X,
+                       mha_wave_t & fuflt,
+                       mha_real_t rho, mha_real_t c, unsigned norm_type,
+                       mha_real_t lambda_smooth, bool adapt)
+{
+    if (s_U.num_frames != frames || s_D.num_frames != frames ||
+        (s_E && (s_E->num_frames != frames || s_E->num_channels != channels)))
+        throw MHA_Error(__FILE__,__LINE__,
+                        "The frequency domain engine needs blocks of %u frames"
+                        " in all adaptation signals", frames);
+    const unsigned block = frames * channels;
+    const unsigned bins = (frames + 1U) * channels;
+
+    // overlap-save input buffers and frequency domain delay lines:
+    std::copy(u2.buf + block, u2.buf + 2U * block, u2.buf);
+    std::copy(s_U.buf, s_U.buf + block, u2.buf + block);
+    std::copy(x2.buf + block, x2.buf + 2U * block, x2.buf);
+    std::copy(s_X.buf, s_X.buf + block, x2.buf + block);
+    head = (head + 1U) % partitions;
+    mha_fft_wave2spec_scale(fft, &u2, &U[head]);
+    mha_fft_wave2spec_scale(fft, &x2, &X[head]);
+
+    // apply the filter to the plugin input, and to u if the error
+    // signal is computed here:
+    clear(acc);
+    for (unsigned p = 0; p < partitions; ++p)
+        MHASignal::conj_mac(acc.buf, W[p].buf, X[delayed(p)].buf, bins);
+    mha_fft_spec2wave_scale(fft, &acc, &wave2);
+    std::copy(wave2.buf + block, wave2.buf + 2U * block, fuflt.buf);
+    if (!s_E) {
+        clear(acc);
+        for (unsigned p = 0; p < partitions; ++p)
+            MHASignal::conj_mac(acc.buf, W[p].buf, U[delayed(p)].buf, bins);
+        mha_fft_spec2wave_scale(fft, &acc, &wave2);
+        std::copy(wave2.buf + block, wave2.buf + 2U * block, fu.buf);
+    }
+
+    // normalized error, zero padded to the front:
+    std::fill(wave2.buf, wave2.buf + block, 0.0f);
+    for (unsigned kf = 0; kf < frames; ++kf) {
+        for (unsigned ch = 0; ch < channels; ++ch) {
+            const mha_real_t u_input = value(s_U, kf, ch);
+            // energy of the last ntaps samples of u:
+            Pu[ch] += u_input * u_input - value(u_sq, u_sq_pos, ch);
+            if (Pu[ch] < 0.0)
+                Pu[ch] = 0.0;
+            value(u_sq, u_sq_pos, ch) = u_input * u_input;
+            mha_real_t err;
+            if (s_E)
+                err = rho * value(*s_E, kf, ch);
+            else
+                err = rho * (value(s_D, kf, ch) - value(fu, kf, ch));
+            switch (norm_type) {
+            case NORM_DEFAULT :
+                err /= (Pu[ch] + c);
+                break;
+            case NORM_SUM :
+                P_Sum[ch] = lambda_smooth * P_Sum[ch]
+                    + (1 - lambda_smooth) * (err * err + u_input * u_input);
+                err /= (P_Sum[ch] * ntaps + c);
+                break;
+            }
+            value(wave2, frames + kf, ch) = err;
+        }
+        u_sq_pos = (u_sq_pos + 1U) % ntaps;
+    }
+    if (!adapt)
+        return;
+
+    // constrained gradient: correlation of the error with u, of which
+    // only the first half of the circular correlation is used
+    mha_fft_wave2spec_scale(fft, &wave2, &E);
+    for (unsigned p = 0; p < partitions; ++p) {
+        clear(acc);
+        MHASignal::conj_mac(acc.buf, U[delayed(p)].buf, E.buf, bins);
+        mha_fft_spec2wave_scale(fft, &acc, &wave2);
+        const unsigned taps = std::min(frames, ntaps - p * frames);
+        mha_real_t * f = F.buf + p * frames * channels;
+        for (unsigned k = 0; k < taps * channels; ++k) {
+            f[k] += wave2.buf[k];
+            make_friendly_number_by_limiting(f[k]);
+        }
+        transform_partition(p);
+    }
+}
+
 mha_wave_t* rt_nlms_t::process(mha_wave_t* sUflt, mha_real_t rho, mha_real_t c, unsigned int norm_type, unsigned int estim_type, mha_real_t lambda_smooth)
 {
     if (no_iter < n_no_update_) {
@@ -206,6 +262,13 @@ mha_wave_t* rt_nlms_t::process(mha_wave_t* sUflt, mha_real_t rho, mha_real_t c,
                         channels, s_U.num_channels, name_d_.c_str());
     }
 
+    if (pbfdaf) {
+        pbfdaf->process(s_U, s_D, name_e_.empty() ? nullptr : &s_E, *sUflt,
+                        fuflt, rho, c, norm_type, lambda_smooth,
+                        no_iter >= n_no_update_);
+        return &fuflt;
+    }
+
     unsigned int ch, kf, kh, idx, fidx;
     mha_real_t err, u_input, d_desired;
     for(ch=0;ch<channels;ch++)
@@ -374,7 +437,8 @@ rt_nlms_t::rt_nlms_t(MHA_AC::algo_comm_t & iac,
                      const std::string& name_d,
                      const std::string& name_e,
                      const std::string& name_f,
-                     const int n_no_update)
+                     const int n_no_update,
+                     unsigned int engine)
     : ac(iac),
       ntaps(ntaps_),
       frames(cfg.fragsize),
@@ -394,6 +458,8 @@ rt_nlms_t::rt_nlms_t(MHA_AC::algo_comm_t & iac,
       n_no_update_(n_no_update),
       no_iter(0)
 {
+    if (engine == ENGINE_FREQUENCY)
+        pbfdaf.reset(new pbfdaf_t(F, frames, channels));
 }
 
 MHAPLUGIN_CALLBACKS(nlms_wave,nlms_t,wave,wave)
@@ -428,6 +494,26 @@ MHAPLUGIN_DOCUMENTATION\
  " \\textbf{estimtype} to the value \\textit{current}. "
  "However in the default case (\\textit{previous}), the previous values"
  " as long as the filter (\\textbf{ntaps}) but the current one are used."
+ "\n\n"
+ "With \\textbf{engine} set to \\textit{frequency}, the filter is adapted"
+ " once per block by a partitioned block frequency domain adaptive filter"
+ " instead of sample by sample. "
+ "The filter is split into partitions of the fragment size $B$, which are"
+ " applied by overlap-save with FFT length $2B$ to the spectra of the last"
+ " blocks of the input signals. "
+ "The error of each sample is normalized as selected by"
+ " \\textbf{normtype}, where $|u|^2$ is the energy of the last"
+ " \\textbf{ntaps} samples of $u$, and the gradient of the whole block"
+ " is computed in the frequency domain and added to the time domain filter"
+ " coefficients, which are then transformed back into the partition"
+ " spectra. "
+ "The cost per sample grows with the number of partitions and the"
+ " logarithm of $B$ instead of with \\textbf{ntaps}, which makes filters"
+ " with several hundreds or thousands of taps affordable. "
+ "The filter is adapted with one block delay, i.e. the output of a block"
+ " is computed with the filter estimated in the previous block. "
+ "\\textbf{estimtype} is not used by this engine, and all adaptation"
+ " signals in the AC space need to have one block of samples."
  )
 
 /*
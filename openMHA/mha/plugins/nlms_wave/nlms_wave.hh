@@ -0,0 +1,197 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2008 2010 2012 2013 2014 2015 2016 2017 2018 2020 HörTech gGmbH
+// Copyright © 2021 HörTech gGmbH
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef NLMS_WAVE_HH
+#define NLMS_WAVE_HH
+
+#include "mha_plugin.hh"
+#include "mha_events.h"
+#include <memory>
+#include <vector>
+
+// add normalization types in string list and in the definitions:
+#define NORMALIZATION_TYPES "[none default sum]"
+#define NORM_NONE 0
+#define NORM_DEFAULT 1
+#define NORM_SUM 2
+
+// Estimation types define whether the current value of the input signal
+// u[k] will be used for estimation of the filter coefficnets or not.
+#define ESTIMATION_TYPES "[previous current]"
+#define ESTIM_PREV 0
+#define ESTIM_CUR 1
+
+// Adaptation engines: sample by sample in the time domain, or
+// partitioned block frequency domain adaptive filter.
+#define ENGINE_TYPES "[time frequency]"
+#define ENGINE_TIME 0
+#define ENGINE_FREQUENCY 1
+
+/** Partitioned block frequency domain adaptive filter (PBFDAF).
+
+    The filter of ntaps coefficients is split into partitions of one
+    block length B (the fragment size).  Filtering uses overlap-save
+    with FFT length 2B and a frequency domain delay line holding the
+    spectra of the last partitions of the input signals.  The filter
+    is adapted once per block with the constrained gradient: the
+    correlation of the normalized block error with the input signal is
+    computed in the frequency domain and transformed back to the
+    time domain, where it is added to the filter coefficients. */
+class pbfdaf_t {
+public:
+    /** \param F Time domain filter coefficients, ntaps x channels,
+                 read at construction and updated by process.
+        \param frames Block length B.
+        \param channels Number of audio channels. */
+    pbfdaf_t(MHASignal::waveform_t & F, unsigned frames, unsigned channels);
+    ~pbfdaf_t();
+    pbfdaf_t(const pbfdaf_t &) = delete;
+    pbfdaf_t & operator=(const pbfdaf_t &) = delete;
+
+    /** Filter one block and adapt the filter.
+        \param s_U Filter input u, block of B frames.
+        \param s_D Desired signal d, used when s_E is nullptr.
+        \param s_E Error signal from AC space, or nullptr to use d-f*u.
+        \param s_X Plugin input, filtered into fuflt.
+        \param fuflt Output: plugin input filtered with the filter.
+        \param rho Convergence coefficient.
+        \param c Stabilization parameter.
+        \param norm_type NORM_NONE, NORM_DEFAULT or NORM_SUM.
+        \param lambda_smooth Smoothing coefficient for NORM_SUM.
+        \param adapt false during the first n_no_update blocks. */
+    void process(const mha_wave_t & s_U, const mha_wave_t & s_D,
+                 const mha_wave_t * s_E, const mha_wave_t & s_X,
+                 mha_wave_t & fuflt,
+                 mha_real_t rho, mha_real_t c, unsigned norm_type,
+                 mha_real_t lambda_smooth, bool adapt);
+private:
+    /** Transform partition p of F into W[p], conjugated for conj_mac */
+    void transform_partition(unsigned p);
+    /** Index of the spectrum of the partition delayed by p blocks */
+    unsigned delayed(unsigned p) const {return (head + partitions - p) % partitions;}
+    MHASignal::waveform_t & F;
+    const unsigned ntaps;
+    const unsigned frames;
+    const unsigned channels;
+    const unsigned partitions;
+    mha_fft_t fft;
+    /** Last two blocks of u and of the plugin input, 2B frames */
+    MHASignal::waveform_t u2, x2;
+    /** Frequency domain delay lines of u and of the plugin input */
+    std::vector<MHASignal::spectrum_t> U, X;
+    /** Conjugated spectra of the zero padded filter partitions */
+    std::vector<MHASignal::spectrum_t> W;
+    unsigned head;
+    MHASignal::spectrum_t acc;
+    MHASignal::spectrum_t E;
+    MHASignal::waveform_t wave2;
+    MHASignal::waveform_t fu;
+    /** Last ntaps squared input samples for NORM_DEFAULT */
+    MHASignal::waveform_t u_sq;
+    unsigned u_sq_pos;
+    std::vector<double> Pu;
+    std::vector<mha_real_t> P_Sum;
+};
+
+class rt_nlms_t
+{
+public:
+    rt_nlms_t(MHA_AC::algo_comm_t & iac,
+              const std::string& name,
+              const mhaconfig_t& cfg,
+              unsigned int ntaps_,
+              const std::string& name_u,
+              const std::string& name_d,
+              const std::string& name_e,
+              const std::string& name_f,
+              const int n_no_update,
+              unsigned int engine = ENGINE_TIME);
+    ~rt_nlms_t() {}
+
+    mha_wave_t* process(mha_wave_t* sUD, mha_real_t rho, mha_real_t c, unsigned int norm_type, unsigned int estim_type, mha_real_t lambda_smooth);
+    void insert();
+private:
+    MHA_AC::algo_comm_t & ac;
+    unsigned int ntaps;
+    unsigned int frames;
+    unsigned int channels;
+    MHA_AC::waveform_t F;
+    MHASignal::waveform_t U; ///< \brief Input signal cache
+    MHASignal::waveform_t Uflt; ///< \brief Input signal cache (second filter)
+    MHASignal::waveform_t Pu; ///< \brief Power of input signal delayline
+    MHASignal::waveform_t fu; ///< \brief Filtered input signal
+    MHASignal::waveform_t fuflt; ///< \brief Filtered input signal
+    MHASignal::waveform_t fu_previous;
+    MHASignal::waveform_t y_previous;
+    MHASignal::waveform_t P_Sum; //recursively est. power for NORM_SUM
+
+    std::string name_u_;
+    std::string name_d_;
+    std::string name_e_;
+
+    int n_no_update_;
+    int no_iter;
+
+    mha_wave_t s_E;
+
+    /// \brief Frequency domain engine, nullptr for the time domain engine
+    std::unique_ptr<pbfdaf_t> pbfdaf;
+};
+
+/*
+ * adaptive filter (LMS algorithm)
+ *
+ * The input signal u[k] and the output signal y[k] are taken from AC
+ * variable. The estimated filter f'[k] and the filtered input signal
+ * f'[k]*u[k] are stored into an AC variable. The input signal is not
+ * touched and can be either waveform or spectrum.
+ */
+class nlms_t : public MHAPlugin::plugin_t<rt_nlms_t>
+{
+public:
+    nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
+    void prepare(mhaconfig_t&);
+    void release();
+    mha_wave_t* process(mha_wave_t*);
+private:
+    void update();
+    //bool prepared;
+    MHAParser::float_t rho;
+    MHAParser::float_t c;
+    MHAParser::int_t ntaps;
+    MHAParser::string_t name_u;
+    MHAParser::string_t name_d;
+    MHAParser::kw_t normtype;
+    MHAParser::kw_t estimtype;
+    MHAParser::float_t lambda_smoothing_power; //recursive smoothing coefficient for sum normalization rule
+    MHAParser::string_t name_e;
+    MHAParser::string_t name_f;
+    MHAParser::int_t n_no_update;
+    MHAParser::kw_t engine;
+    std::string algo;
+    MHAEvents::patchbay_t<nlms_t> patchbay;
+};
+
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "make"
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
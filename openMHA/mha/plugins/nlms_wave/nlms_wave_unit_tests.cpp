@@ -0,0 +1,163 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "nlms_wave.hh"
+#include "mha_algo_comm.hh"
+#include <cmath>
+#include <random>
+
+namespace {
+    constexpr unsigned block_frames = 32U;
+    constexpr unsigned num_channels = 2U;
+    constexpr unsigned num_taps = 80U;
+
+    /** System identification: u is white noise, d is u filtered with
+        the unknown system h (different in each channel), and the
+        plugin input is u.  Returns the misalignment of the estimated
+        filter, |f-h|^2/|h|^2, after the given number of blocks. */
+    double identify(const std::string & engine, const std::string & norm,
+                    unsigned blocks, MHASignal::waveform_t * f_out = nullptr,
+                    MHASignal::waveform_t * out = nullptr,
+                    MHASignal::waveform_t * d_out = nullptr)
+    {
+        MHA_AC::algo_comm_class_t acspace;
+        MHA_AC::waveform_t u(acspace, "u", block_frames, num_channels, true);
+        MHA_AC::waveform_t d(acspace, "d", block_frames, num_channels, true);
+        nlms_t nlms(acspace, "nlms");
+        nlms.parse("name_u = u");
+        nlms.parse("name_d = d");
+        nlms.parse("ntaps = " + std::to_string(num_taps));
+        nlms.parse("rho = 0.1");
+        nlms.parse("normtype = " + norm);
+        nlms.parse("engine = " + engine);
+        mhaconfig_t cfg = {
+            .channels = num_channels, .domain = MHA_WAVEFORM,
+            .fragsize = block_frames, .wndlen = 0, .fftlen = 0, .srate = 16000
+        };
+        nlms.prepare_(cfg);
+        acspace.set_prepared(true);
+
+        MHASignal::waveform_t h(num_taps - 10U, num_channels);
+        for (unsigned k = 0; k < h.num_frames; ++k)
+            for (unsigned ch = 0; ch < num_channels; ++ch)
+                h.value(k, ch) = std::exp(-0.05f * k)
+                    * std::cos(0.7f * k + ch);
+        MHASignal::waveform_t history(h.num_frames, num_channels);
+        std::mt19937 rng(1);
+        std::normal_distribution<mha_real_t> noise;
+        mha_wave_t * s = nullptr;
+        for (unsigned b = 0; b < blocks; ++b) {
+            for (unsigned kf = 0; kf < block_frames; ++kf)
+                for (unsigned ch = 0; ch < num_channels; ++ch) {
+                    for (unsigned k = h.num_frames - 1U; k > 0; --k)
+                        history.value(k, ch) = history.value(k - 1U, ch);
+                    history.value(0, ch) = u.value(kf, ch) = noise(rng);
+                    d.value(kf, ch) = 0;
+                    for (unsigned k = 0; k < h.num_frames; ++k)
+                        d.value(kf, ch) += h.value(k, ch)
+                            * history.value(k, ch);
+                }
+            s = nlms.process(&u);
+        }
+        mha_wave_t f = MHA_AC::get_var_waveform(acspace, "nlms");
+        EXPECT_EQ(num_taps, f.num_frames);
+        double err = 0, energy = 0;
+        for (unsigned k = 0; k < num_taps; ++k)
+            for (unsigned ch = 0; ch < num_channels; ++ch) {
+                const double target = k < h.num_frames ? h.value(k, ch) : 0;
+                err += (value(f, k, ch) - target) * (value(f, k, ch) - target);
+                energy += target * target;
+            }
+        if (f_out)
+            f_out->copy(f);
+        if (out)
+            out->copy(s);
+        if (d_out)
+            d_out->copy(d);
+        acspace.set_prepared(false);
+        nlms.release_();
+        return err / energy;
+    }
+}
+
+TEST(nlms_wave, has_engine_parameter)
+{
+    MHA_AC::algo_comm_class_t acspace;
+    nlms_t nlms(acspace, "nlms");
+    EXPECT_EQ("time", nlms.parse("engine?val"));
+    EXPECT_EQ("[time frequency]", nlms.parse("engine?range"));
+}
+
+TEST(nlms_wave, time_and_frequency_domain_converge_to_same_filter)
+{
+    MHASignal::waveform_t f_time(num_taps, num_channels);
+    MHASignal::waveform_t f_freq(num_taps, num_channels);
+    const double misalignment_time =
+        identify("time", "default", 1500U, &f_time);
+    const double misalignment_freq =
+        identify("frequency", "default", 1500U, &f_freq);
+    // both engines identify the system within -60 dB
+    EXPECT_LT(misalignment_time, 1e-6);
+    EXPECT_LT(misalignment_freq, 1e-6);
+    for (unsigned k = 0; k < num_taps; ++k)
+        for (unsigned ch = 0; ch < num_channels; ++ch)
+            EXPECT_NEAR(f_time.value(k, ch), f_freq.value(k, ch), 1e-3)
+                << "tap " << k << " channel " << ch;
+}
+
+TEST(nlms_wave, frequency_domain_converges_with_sum_normalization)
+{
+    EXPECT_LT(identify("frequency", "sum", 1500U), 1e-6);
+}
+
+TEST(nlms_wave, frequency_domain_output_is_filtered_input)
+{
+    MHASignal::waveform_t out(block_frames, num_channels);
+    MHASignal::waveform_t d(block_frames, num_channels);
+    identify("frequency", "default", 1500U, nullptr, &out, &d);
+    // the plugin input is u, so the output approximates d
+    double err = 0, energy = 0;
+    for (unsigned k = 0; k < block_frames * num_channels; ++k) {
+        err += (out.buf[k] - d.buf[k]) * (out.buf[k] - d.buf[k]);
+        energy += d.buf[k] * d.buf[k];
+    }
+    EXPECT_LT(err, 1e-3 * energy);
+}
+
+TEST(nlms_wave, frequency_domain_partitions_need_full_blocks)
+{
+    MHA_AC::algo_comm_class_t acspace;
+    MHA_AC::waveform_t u(acspace, "u", block_frames / 2U, num_channels, true);
+    nlms_t nlms(acspace, "nlms");
+    nlms.parse("name_u = u");
+    nlms.parse("name_d = u");
+    nlms.parse("engine = frequency");
+    mhaconfig_t cfg = {
+        .channels = num_channels, .domain = MHA_WAVEFORM,
+        .fragsize = block_frames, .wndlen = 0, .fftlen = 0, .srate = 16000
+    };
+    nlms.prepare_(cfg);
+    MHASignal::waveform_t s(block_frames, num_channels);
+    EXPECT_THROW(nlms.process(&s), MHA_Error);
+    nlms.release_();
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
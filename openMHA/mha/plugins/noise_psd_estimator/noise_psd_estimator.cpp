@@ -15,6 +15,7 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 // Also observe the algorithm copyright statement below.
 #include "mha_plugin.hh"
+#include "mha_vecmath.hh"
 /*
 
   Copyright (c) 2011
@@ -75,6 +76,7 @@ namespace noise_psd_estimator {
         float alphaPSD_;
         // a priori probability of speech presence:
         float priorFact;
+        float logPriorFact;
         float xiOpt;
         // optimal fixed a priori SNR for SPP estimation:
         float logGLRFact;
@@ -102,6 +104,7 @@ namespace noise_psd_estimator {
           alphaPH1mean_(alphaPH1mean),
           alphaPSD_(alphaPSD),
           priorFact(q/(1.0f-q)),
+          logPriorFact(log(priorFact)),
           xiOpt(powf(10.0f,(xiOptDb / 10.0f))),
           logGLRFact(log(1.0f/(1.0f+xiOpt))),
           GLRexp(xiOpt/(1.0f+xiOpt)),
@@ -135,14 +138,20 @@ namespace noise_psd_estimator {
             }
         }
 
+        // a posteriori SNR based on old noise power estimate, and the
+        // generalized likelihood ratio, exponentiated for all bins at once:
+        const unsigned int n = size(noisyPer);
+        for( unsigned int k=0;k<n;k++){
+            snrPost1Debug[k] = noisyPer[k] / noisePow[k];
+            GLRDebug[k] = logPriorFact + logGLRFact + GLRexp*snrPost1Debug[k];
+        }
+        MHASignal::vec_exp(GLRDebug.buf, GLRDebug.buf, n);
+
         // noise power estimation
-        for( unsigned int k=0;k<size(noisyPer);k++){
+        for( unsigned int k=0;k<n;k++){
 
-            // a posteriori SNR based on old noise power estimate:
-            double snrPost1 = noisyPer[k] / noisePow[k];
-            double GLR = priorFact * exp(std::min(logGLRFact + GLRexp*snrPost1,200.0));
-            // a posteriori speech presence probability:
-            double PH1 = GLR/(1.0f+GLR);
+            // a posteriori speech presence probability, GLR may be +Inf:
+            double PH1 = 1.0/(1.0+1.0/GLRDebug[k]);
             PH1mean[k]  = alphaPH1mean_ * PH1mean[k] + (1.0f-alphaPH1mean_) * PH1;
             if( PH1mean[k] > 0.99 )
                 PH1 = std::min(PH1,0.99);
@@ -151,8 +160,6 @@ namespace noise_psd_estimator {
 
             //gkc: just saving the spectrum to compare inputs
             inputPow[k] = noisyPer[k];
-            snrPost1Debug[k] = snrPost1;
-            GLRDebug[k] = GLR;
             PH1Debug[k] = PH1;
             estimateDebug[k] = estimate;
         }
@@ -14,81 +14,13 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <memory>
-#if defined(_WIN32) && !defined(WIN32)
-#define WIN32 _WIN32 // help liblo to detect windows
-#endif
-#include <lo/lo.h>
-#include "mha_parser.hh"
-#include "mha_plugin.hh"
-
-/** Class for converting messages received at a single osc address to a single
-    AC variable. OSC variables are received asynchronously in a network thread
-    and must not modify their AC variables directly, because MHA plugins may
-    only access their AC variables while executing their prepare, release, or
-    process callbacks.
-
-    One osc2ac plugin uses multiple instances of osc_variable_t, one for each
-    mapping of an OSC address to an AC variable.
- **/
-class osc_variable_t {
-public:
-    /** An instance of this class cannot safely be copied. */
-    osc_variable_t(const osc_variable_t &) = delete;
-    /** Constructor. Allocates memory.
-        @param name The name of the AC variable that stores the latest value.
-        @param size Number of elements to copy from OSC message to AC variable.
-        @param hAC Handle of Algorithm Communication Variable space.
-        @param lost libLO Server Thread. */
-    osc_variable_t(const std::string& name, unsigned int size,
-                   MHA_AC::algo_comm_t & hAC, lo_server_thread lost);
-    /** Copies the latest OSC data from the OSC storage to the AC storage.
-     * To be executed during process callback of osc2ac plugin.
-     * @todo Data is copied from array osc_data while osc_data may be changed
-     *       simultaneously in another thread in method handler. */
-    void sync_osc2ac() {ac_data.copy(osc_data);};
-    /** Insert/Re-insert the AC variable into AC space. Should be done in each
-     * process callback. */
-    void ac_insert() {ac_data.insert();}
-    /** Callback function called by network thread managed by liblo when a new
-     * OSC message has been received. This static method forwards to the
-     * instance method by casting user_data to osc_variable_t*.
-     * @param path  Unused.
-     * @param types The OSC data type indicator of the received message.
-     * @param argv  Array of received OSC data.
-     * @param argc  Number of elements in array of received OSC data.
-     * @param msg   Unused.
-     * @param user_data Pointer to osc_variable_t instance.
-     * @return 1 if the message was accepted, 0 if not. */
-    static int handler(const char *path, const char *types, lo_arg **argv,int argc, lo_message msg, void *user_data);
-    /** Callback function called by network thread managed by liblo when a new
-     * OSC message has been received. This instance method checks if the
-     * received data is of expected length and contains only floats, and if yes,
-     * copies the data into the buffer osc_data where the latest received data
-     * for this osc address is stored until it is either overwritten by the
-     * next data for the same osc address or copied to an AC variable.
-     * @todo The data is copied to osc_data without thread synchronization.
-     * @param types The OSC data type indicator of the received message.
-     * @param argv  Array of received OSC data.
-     * @param argc  Number of elements in array of received OSC data.
-     * @return 1 if the message had correct length and contained only floats,
-     *         0 if not. */
-    int handler(const char *types, lo_arg **argv,int argc);
-private:
-    /** Name of the ac variable */
-    std::string acname;
-    /** OSC address */
-    std::string oscaddr;
-    /** AC variable storage */
-    MHA_AC::waveform_t ac_data;
-    /** OSC variable storage */
-    MHASignal::waveform_t osc_data;
-    /** Name of AC variable and OSC address without the initial slash */
-    std::string name_;
-};
+#include "osc2ac.hh"
+#include <algorithm>
 
 osc_variable_t::osc_variable_t(const std::string& name, unsigned int size,
-                               MHA_AC::algo_comm_t & hAC, lo_server_thread lost)
+                               MHA_AC::algo_comm_t & hAC, lo_server_thread lost,
+                               unsigned int queue_len, bool queued_,
+                               double frame_duration_)
     : ac_data(hAC,
               [&](){
                   // Split the given name by ':' the left side
@@ -100,6 +32,18 @@ osc_variable_t::osc_variable_t(const std::string& name, unsigned int size,
               }(),
               size,1,false),
       osc_data(size,1),
+      mailbox(queued_ ? size * queue_len : 1U),
+      slots(queued_ ? 0U : 3U * size, 0.0f),
+      shared_slot(1U),
+      write_slot(0U),
+      read_slot(2U),
+      queued(queued_),
+      frame_duration(frame_duration_),
+      received(0U),
+      dropped(0U),
+      rate(0.0f),
+      age(0U),
+      received_before(0U),
       name_([&](){
           // Split the given name by ':'; the right side
           // is the AC name, if there's none take the left side
@@ -133,31 +77,53 @@ int osc_variable_t::handler(const char *types, lo_arg **argv,int argc)
         for(int k=0;k<argc;k++)
             if( types[k] != 'f' )
                 valid_fmt = false;
-        if( valid_fmt )
-            for(int k=0;k<argc;k++)
-                osc_data.buf[k] = argv[k]->f;
+        if( valid_fmt ) {
+            ++received;
+            if( !queued ) {
+                mha_real_t * slot = slots.data() + write_slot * argc;
+                for(int k=0;k<argc;k++)
+                    slot[k] = argv[k]->f;
+                // Publish the message, continue with the previous shared slot
+                write_slot = shared_slot.exchange(write_slot | fresh,
+                                                  std::memory_order_acq_rel)
+                    & ~fresh;
+            } else if( mailbox.get_available_space() < osc_data.num_frames ) {
+                ++dropped;
+            } else {
+                for(int k=0;k<argc;k++)
+                    osc_data.buf[k] = argv[k]->f;
+                mailbox.write(osc_data.buf, osc_data.num_frames);
+            }
+        }
     }
     return valid_fmt;
 }
 
-/** OSC receiver implemented using liblo. */
-class osc_server_t {
-public:
-    osc_server_t(const std::string& multicast_addr, const std::string& port);
-    ~osc_server_t();
-    void server_stop();
-    void server_start();
-    void insert_variable(const std::string& name,
-                         unsigned int size,
-                         MHA_AC::algo_comm_t & hAC);
-    void sync_osc2ac();
-    void ac_insert();
-    static void error_h(int num, const char *msg, const char *path);
-private:
-    std::vector<std::unique_ptr<osc_variable_t>> pVars;
-    lo_server_thread lost;
-    bool is_running;
-};
+void osc_variable_t::sync_osc2ac()
+{
+    unsigned int messages = 0U;
+    if( queued ) {
+        messages = std::min(1U, mailbox.get_fill_count() / ac_data.num_frames);
+        if( messages )
+            mailbox.read(ac_data.buf, ac_data.num_frames);
+    } else if( shared_slot.load(std::memory_order_acquire) & fresh ) {
+        // Take the newest message, leave our previous slot to the network
+        // thread
+        read_slot = shared_slot.exchange(read_slot, std::memory_order_acq_rel)
+            & ~fresh;
+        std::copy_n(slots.data() + read_slot * ac_data.num_frames,
+                    ac_data.num_frames, ac_data.buf);
+        messages = 1U;
+    }
+    age.store(messages ? 0U : age.load() + 1U);
+
+    const unsigned long long now = received.load();
+    const double alpha = std::min(1.0, frame_duration);
+    const double new_messages = now - received_before;
+    received_before = now;
+    rate.store(rate.load()
+               + alpha * (new_messages / frame_duration - rate.load()));
+}
 
 void osc_server_t::sync_osc2ac()
 {
@@ -208,9 +174,13 @@ osc_server_t::osc_server_t(const std::string& multicastgroup, const std::string&
 
 void osc_server_t::insert_variable(const std::string& name,
                                    unsigned int size,
-                                   MHA_AC::algo_comm_t & hAC)
+                                   MHA_AC::algo_comm_t & hAC,
+                                   unsigned int queue_len, bool queued,
+                                   double frame_duration)
 {
-    pVars.push_back(std::make_unique<osc_variable_t>(name, size, hAC, lost));
+    pVars.push_back(std::make_unique<osc_variable_t>(name, size, hAC, lost,
+                                                     queue_len, queued,
+                                                     frame_duration));
 }
 
 osc_server_t::~osc_server_t()
@@ -230,10 +200,17 @@ public:
     void process();
 private:
     void setlock(bool b);
+    void query_statistics();
     MHAParser::string_t host;
     MHAParser::string_t port;
     MHAParser::vstring_t vars;
     MHAParser::vint_t size;
+    MHAParser::kw_t mode;
+    MHAParser::int_t queue_len;
+    MHAParser::vint_mon_t received;
+    MHAParser::vint_mon_t dropped;
+    MHAParser::vfloat_mon_t rate;
+    MHAParser::vint_mon_t age;
     MHAEvents::patchbay_t<osc2ac_t> patchbay;
     std::unique_ptr<osc_server_t> srv;
 };
@@ -244,6 +221,8 @@ void osc2ac_t::setlock(bool b)
     port.setlock(b);
     vars.setlock(b);
     size.setlock(b);
+    mode.setlock(b);
+    queue_len.setlock(b);
 }
 
 osc2ac_t::osc2ac_t(MHA_AC::algo_comm_t & iac, const std::string &)
@@ -262,15 +241,42 @@ osc2ac_t::osc2ac_t(MHA_AC::algo_comm_t & iac, const std::string &)
            "Each entry here corresponds to the entry in vars with the same index\n"
            "and determines the length of the float vector that will be allocated\n"
            "to receive the OSC messages with the corresponding address.","[1]","[1,]"),
+      mode("Delivery of received messages to the AC variables:\n"
+           "latest: Each process callback delivers the latest received message,\n"
+           "        older messages are discarded.\n"
+           "queued: Each process callback delivers the oldest message that\n"
+           "        has not been delivered yet.",
+           "latest","[latest queued]"),
+      queue_len("Number of messages per AC variable that can wait for delivery\n"
+                "in queued mode.  Messages received while the queue is full are\n"
+                "dropped.",
+                "16","[1,]"),
+      received("Number of messages received for each AC variable,"
+               " including dropped messages"),
+      dropped("Number of messages dropped for each AC variable, because"
+              " the queue was full.  Always 0 with mode = latest"),
+      rate("Receive rate for each AC variable in messages per second,"
+           " averaged over about 1 s of processed audio"),
+      age("Number of process callbacks since each AC variable was last updated"),
       srv(nullptr)
 {
     insert_member(host);
     insert_member(port);
     insert_member(vars);
     insert_member(size);
+    insert_member(mode);
+    insert_member(queue_len);
+    insert_member(received);
+    insert_member(dropped);
+    insert_member(rate);
+    insert_member(age);
+    patchbay.connect(&received.prereadaccess,this,&osc2ac_t::query_statistics);
+    patchbay.connect(&dropped.prereadaccess,this,&osc2ac_t::query_statistics);
+    patchbay.connect(&rate.prereadaccess,this,&osc2ac_t::query_statistics);
+    patchbay.connect(&age.prereadaccess,this,&osc2ac_t::query_statistics);
 }
 
-void osc2ac_t::prepare(mhaconfig_t&)
+void osc2ac_t::prepare(mhaconfig_t& tf)
 {
     setlock(true);
     try{
@@ -278,7 +284,10 @@ void osc2ac_t::prepare(mhaconfig_t&)
         while( vars.data.size() > size.data.size() )
             size.data.push_back(1);
         for(unsigned int k=0;k<vars.data.size();k++)
-            srv->insert_variable(vars.data[k],size.data[k],ac);
+            srv->insert_variable(vars.data[k],size.data[k],ac,
+                                 queue_len.data,
+                                 mode.data.get_index() == 1,
+                                 tf.fragsize / tf.srate);
         srv->server_start();
         srv->ac_insert();
     }
@@ -300,6 +309,22 @@ void osc2ac_t::process()
     srv->sync_osc2ac();
 }
 
+void osc2ac_t::query_statistics()
+{
+    received.data.clear();
+    dropped.data.clear();
+    rate.data.clear();
+    age.data.clear();
+    if( !srv )
+        return;
+    for(auto& pVar : srv->variables()){
+        received.data.push_back(pVar->get_received());
+        dropped.data.push_back(pVar->get_dropped());
+        rate.data.push_back(pVar->get_rate());
+        age.data.push_back(pVar->get_age());
+    }
+}
+
 MHAPLUGIN_CALLBACKS(osc2ac,osc2ac_t,wave,wave)
 MHAPLUGIN_PROC_CALLBACK(osc2ac,osc2ac_t,spec,spec)
 MHAPLUGIN_DOCUMENTATION\
@@ -344,6 +369,24 @@ MHAPLUGIN_DOCUMENTATION\
  " \\texttt{/mhalevels} is mirrored in the AC variable  \\texttt{level}. "
  " When \\texttt{size} is not set in this example, the default value 1 "
  " for scalars is used for all AC variables and OSC messages.\n"
+ "\n\n"
+ "The network thread that receives the OSC messages never writes to the "
+ " AC variables directly.  It writes complete messages into preallocated "
+ " lock-free buffers, from which they are moved to the AC variables at the "
+ " start of each process callback, so that an AC variable never contains a "
+ " mixture of two messages. "
+ " With \\texttt{mode = latest}, the latest received message is delivered "
+ " and older ones that have not been delivered yet are discarded. "
+ " With \\texttt{mode = queued}, each OSC address has a queue with room for "
+ " \\texttt{queue\\_len} messages, and one message "
+ " is delivered per process callback in the order of reception, e.g. for "
+ " event-like messages that must not be lost.  Messages that arrive while "
+ " the queue is full are dropped. "
+ " The monitor variables \\texttt{received}, \\texttt{dropped}, "
+ " \\texttt{rate}, and \\texttt{age} report, for each AC variable, the "
+ " number of received and dropped messages, the receive rate in messages "
+ " per second, and the number of process callbacks since the AC variable "
+ " was last updated.\n"
  )
 
 
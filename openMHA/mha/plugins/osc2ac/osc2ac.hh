@@ -0,0 +1,182 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2012 2013 2014 2015 2018 2019 2020 2021 HörTech gGmbH
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License, 
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#if defined(_WIN32) && !defined(WIN32)
+#define WIN32 _WIN32 // help liblo to detect windows
+#endif
+#include <lo/lo.h>
+#include "mha_parser.hh"
+#include "mha_plugin.hh"
+#include "mha_fifo.h"
+
+/** Class for converting messages received at a single osc address to a single
+    AC variable. OSC variables are received asynchronously in a network thread
+    and must not modify their AC variables directly, because MHA plugins may
+    only access their AC variables while executing their prepare, release, or
+    process callbacks.
+
+    In queued mode, the network thread writes each received message into a
+    preallocated lock-free single-producer/single-consumer FIFO (the
+    mailbox), and the processing thread moves the messages from the mailbox
+    to the AC variable at the start of each process callback.
+
+    In latest-value mode, the threads exchange messages through three
+    message slots instead: The network thread writes into its own slot and
+    then swaps it with the shared slot, the processing thread swaps its own
+    slot with the shared slot when the shared slot holds a message it has
+    not seen yet.  Newer messages replace older ones that have not been
+    delivered, so the newest message is never dropped and neither thread
+    ever waits for the other.
+
+    No data is ever accessed by both threads at the same time, so the AC
+    variable always contains one complete message.
+
+    One osc2ac plugin uses multiple instances of osc_variable_t, one for each
+    mapping of an OSC address to an AC variable.
+ **/
+class osc_variable_t {
+public:
+    /** An instance of this class cannot safely be copied. */
+    osc_variable_t(const osc_variable_t &) = delete;
+    /** Constructor. Allocates memory.
+        @param name The name of the AC variable that stores the latest value.
+        @param size Number of elements to copy from OSC message to AC variable.
+        @param hAC Handle of Algorithm Communication Variable space.
+        @param lost libLO Server Thread.
+        @param queue_len Number of messages the mailbox can hold in
+                         queued mode.
+        @param queued If true, deliver one message per process callback in
+                      the order of reception.  If false, deliver only the
+                      latest message and discard older ones.
+        @param frame_duration Duration of one audio block in seconds. */
+    osc_variable_t(const std::string& name, unsigned int size,
+                   MHA_AC::algo_comm_t & hAC, lo_server_thread lost,
+                   unsigned int queue_len, bool queued,
+                   double frame_duration);
+    /** Moves the latest OSC data (or, in queued mode, the oldest not yet
+     * delivered OSC data) from the mailbox to the AC storage, and updates
+     * the receive rate and the age.
+     * To be executed during process callback of osc2ac plugin. */
+    void sync_osc2ac();
+    /** Insert/Re-insert the AC variable into AC space. Should be done in each
+     * process callback. */
+    void ac_insert() {ac_data.insert();}
+    /** Callback function called by network thread managed by liblo when a new
+     * OSC message has been received. This static method forwards to the
+     * instance method by casting user_data to osc_variable_t*.
+     * @param path  Unused.
+     * @param types The OSC data type indicator of the received message.
+     * @param argv  Array of received OSC data.
+     * @param argc  Number of elements in array of received OSC data.
+     * @param msg   Unused.
+     * @param user_data Pointer to osc_variable_t instance.
+     * @return 1 if the message was accepted, 0 if not. */
+    static int handler(const char *path, const char *types, lo_arg **argv,int argc, lo_message msg, void *user_data);
+    /** Callback function called by network thread managed by liblo when a new
+     * OSC message has been received. This instance method checks if the
+     * received data is of expected length and contains only floats, and if yes,
+     * writes the data into the mailbox or the latest-value slots where it
+     * waits until the processing thread delivers it to the AC variable.  If
+     * the mailbox of a queued variable is full, the message is dropped.
+     * @param types The OSC data type indicator of the received message.
+     * @param argv  Array of received OSC data.
+     * @param argc  Number of elements in array of received OSC data.
+     * @return 1 if the message had correct length and contained only floats,
+     *         0 if not. */
+    int handler(const char *types, lo_arg **argv,int argc);
+    /** Number of messages received so far, including dropped messages. */
+    unsigned long long get_received() const {return received.load();}
+    /** Number of messages dropped because the mailbox was full.  Always 0
+     * in latest-value mode. */
+    unsigned long long get_dropped() const {return dropped.load();}
+    /** Receive rate in messages per second, smoothed with a time constant
+     * of one second of processed audio. */
+    float get_rate() const {return rate.load();}
+    /** Number of process callbacks since the AC variable was last updated. */
+    unsigned long long get_age() const {return age.load();}
+private:
+    /** Name of the ac variable */
+    std::string acname;
+    /** OSC address */
+    std::string oscaddr;
+    /** AC variable storage */
+    MHA_AC::waveform_t ac_data;
+    /** Storage for the message currently received by the network thread */
+    MHASignal::waveform_t osc_data;
+    /** Transfers messages from the network thread to the processing thread
+     * in queued mode */
+    mha_fifo_lf_t<mha_real_t> mailbox;
+    /** Three message slots of the latest-value mode */
+    std::vector<mha_real_t> slots;
+    /** Flag in shared_slot: The shared slot holds a new message */
+    static constexpr unsigned int fresh = 4U;
+    /** Index of the shared slot, possibly combined with the fresh flag */
+    std::atomic<unsigned int> shared_slot;
+    /** Slot written by the network thread */
+    unsigned int write_slot;
+    /** Slot read by the processing thread */
+    unsigned int read_slot;
+    /** Deliver messages one by one instead of only the latest */
+    const bool queued;
+    /** Duration of one audio block in seconds */
+    const double frame_duration;
+    /** Counters written by the network thread */
+    std::atomic<unsigned long long> received;
+    std::atomic<unsigned long long> dropped;
+    /** Statistics written by the processing thread */
+    std::atomic<float> rate;
+    std::atomic<unsigned long long> age;
+    /** Value of received at the previous process callback, only accessed
+     * by the processing thread */
+    unsigned long long received_before;
+    /** Name of AC variable and OSC address without the initial slash */
+    std::string name_;
+};
+
+/** OSC receiver implemented using liblo. */
+class osc_server_t {
+public:
+    osc_server_t(const std::string& multicast_addr, const std::string& port);
+    ~osc_server_t();
+    void server_stop();
+    void server_start();
+    void insert_variable(const std::string& name,
+                         unsigned int size,
+                         MHA_AC::algo_comm_t & hAC,
+                         unsigned int queue_len, bool queued,
+                         double frame_duration);
+    void sync_osc2ac();
+    void ac_insert();
+    /** Read-only access to the OSC variables, e.g. for their statistics */
+    const std::vector<std::unique_ptr<osc_variable_t>>& variables() const
+    {return pVars;}
+    static void error_h(int num, const char *msg, const char *path);
+private:
+    std::vector<std::unique_ptr<osc_variable_t>> pVars;
+    lo_server_thread lost;
+    bool is_running;
+};
+
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * compile-command: "make"
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,120 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "osc2ac.hh"
+#include "mha_algo_comm.hh"
+#include <thread>
+
+namespace {
+    /** Feeds OSC messages with two floats directly to the handler of an
+     *  osc_variable_t, without network traffic. */
+    class osc2ac_testing : public ::testing::Test {
+    public:
+        MHA_AC::algo_comm_class_t acspace;
+        MHA_AC::algo_comm_t & ac = acspace;
+        lo_server_thread lost = lo_server_thread_new(nullptr, nullptr);
+        ~osc2ac_testing() {lo_server_thread_free(lost);}
+        /** Send message {value, -value} to var */
+        int send(osc_variable_t & var, float value) {
+            lo_arg args[2];
+            args[0].f = value;
+            args[1].f = -value;
+            lo_arg * argv[2] = {&args[0], &args[1]};
+            return var.handler("ff", argv, 2);
+        }
+        /** First element of the AC variable after the next process callback */
+        float process(osc_variable_t & var) {
+            var.sync_osc2ac();
+            var.ac_insert();
+            mha_wave_t w = MHA_AC::get_var_waveform(ac, "value");
+            EXPECT_EQ(-w.buf[0], w.buf[1]);
+            return w.buf[0];
+        }
+    };
+}
+
+TEST_F(osc2ac_testing, latest_mode_delivers_newest_message_when_flooded)
+{
+    osc_variable_t var("value", 2U, ac, lost, 4U, false, 0.01);
+    EXPECT_EQ(0.0f, process(var));
+    for (unsigned k = 1; k <= 100U; ++k)
+        EXPECT_EQ(1, send(var, k));
+    EXPECT_EQ(100.0f, process(var));
+    EXPECT_EQ(0U, var.get_age());
+    EXPECT_EQ(100U, var.get_received());
+    EXPECT_EQ(0U, var.get_dropped());
+    // Without new messages the value is kept
+    EXPECT_EQ(100.0f, process(var));
+    EXPECT_EQ(1U, var.get_age());
+    // The slots keep working after the processing thread has taken one
+    for (unsigned k = 101; k <= 103U; ++k) {
+        send(var, k);
+        EXPECT_EQ(float(k), process(var));
+    }
+    send(var, 200.0f);
+    send(var, 201.0f);
+    EXPECT_EQ(201.0f, process(var));
+}
+
+TEST_F(osc2ac_testing, queued_mode_delivers_in_order_and_drops_when_full)
+{
+    osc_variable_t var("value", 2U, ac, lost, 2U, true, 0.01);
+    for (unsigned k = 1; k <= 3U; ++k)
+        send(var, k);
+    EXPECT_EQ(1U, var.get_dropped());
+    EXPECT_EQ(1.0f, process(var));
+    EXPECT_EQ(2.0f, process(var));
+    EXPECT_EQ(2.0f, process(var));
+    EXPECT_EQ(1U, var.get_age());
+}
+
+TEST_F(osc2ac_testing, rejects_messages_of_wrong_format)
+{
+    osc_variable_t var("value", 2U, ac, lost, 4U, false, 0.01);
+    lo_arg arg;
+    arg.f = 1.0f;
+    lo_arg * argv[2] = {&arg, &arg};
+    EXPECT_EQ(0, var.handler("f", argv, 1));
+    EXPECT_EQ(0, var.handler("fi", argv, 2));
+    EXPECT_EQ(0U, var.get_received());
+    EXPECT_EQ(0.0f, process(var));
+}
+
+TEST_F(osc2ac_testing, latest_mode_delivers_complete_increasing_messages)
+{
+    osc_variable_t var("value", 2U, ac, lost, 4U, false, 0.01);
+    constexpr unsigned messages = 100000U;
+    std::thread network([&](){
+        for (unsigned k = 1; k <= messages; ++k)
+            send(var, k);
+    });
+    float previous = 0.0f;
+    while (previous < messages) {
+        // process() checks that both elements belong to the same message
+        const float value = process(var);
+        ASSERT_LE(previous, value);
+        previous = value;
+    }
+    network.join();
+    EXPECT_EQ(float(messages), process(var));
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -25,7 +25,7 @@ overlapadd_t::overlapadd_t(mhaconfig_t spar_in,
                            const MHAParser::window_t& window,
                            const MHAParser::window_t& zerowindow,
                            float& prescale_fac,float& postscale_fac)
-    : fft(mha_fft_new(spar_in.fftlen)),
+    : fft(mha_fft_new(spar_in.fftlen,spar_in.channels)),
       prewnd((spar_in.wndlen)),
       postwnd((spar_in.fftlen)),
       wave_in1(spar_in.wndlen,spar_in.channels),
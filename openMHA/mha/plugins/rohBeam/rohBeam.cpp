@@ -16,6 +16,16 @@
 
 #include "rohBeam.hh"
 #include "mha_utils.hh"
+#include "mha_simd.hh"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace Eigen;
 
 using MHAUtils::is_denormal;
@@ -119,6 +129,10 @@ namespace rohBeam {
     this->blockSpec = new MHASignal::spectrum_t(nfreq, nchan_block);
     this->outSpec = new MHASignal::spectrum_t(nfreq, out_cfg.channels);
     this->beamA = new MHASignal::spectrum_t(nfreq, 1);
+    reset_dynamic();
+  }
+
+  void rohConfig::reset_dynamic() {
 
     for (int f=0; f<nfreq; f++) {
       beam1->value(f,0).re = 0;
@@ -145,17 +159,51 @@ namespace rohBeam {
     }
   }
 
+  bool rohConfig::reconfigure(rohConfig *lastConfig,
+                              const mhaconfig_t in_cfg,const mhaconfig_t out_cfg,
+                              std::unique_ptr<MatrixXcf> && headModel_,
+                              std::unique_ptr<MHASignal::matrix_t> && beamW_,
+                              std::unique_ptr<MHASignal::matrix_t> && delayComp_,
+                              const configOptions& options) {
+
+    if ( int(in_cfg.fftlen/2+1) != nfreq ||
+         int(in_cfg.channels-1) != nchan_block ||
+         out_cfg.channels != this->out_cfg.channels )
+      return false;
+    this->in_cfg = in_cfg;
+    this->out_cfg = out_cfg;
+    enable_adaptive_beam = options.enable_adaptive_beam;
+    binaural_type_index = options.binaural_type_index;
+    headModel = std::move(headModel_);
+    beamW = std::move(beamW_);
+    delayComp = std::move(delayComp_);
+    alpha_postfilter = options.alpha_postfilter;
+    alpha_blocking_XkXi = options.alpha_blocking_XkXi;
+    alpha_blocking_XkY = options.alpha_blocking_XkY;
+    //same dimensions: the assignments copy into the existing buffers
+    corrXpXp = lastConfig->corrXpXp;
+    corrXpYf = lastConfig->corrXpYf;
+    corrZZ = lastConfig->corrZZ;
+    corrLL = lastConfig->corrLL;
+    corrRR = lastConfig->corrRR;
+    minLim = lastConfig->minLim;
+    maxLim = lastConfig->maxLim;
+    reset_dynamic();
+    return true;
+  }
+
   mha_spec_t * rohConfig::process(mha_spec_t *inSpec) {
 
     for (int f=0; f<nfreq; f++) {
-
       beam1->value(f,0).re = 0;
       beam1->value(f,0).im = 0;
+    }
 
-      /* the output of this stage goes to mono beam1 */
-      for (unsigned int ci=0; ci<in_cfg.channels; ci++) {
-        beam1->value(f,0) += _conjugate((*beamW)(f,ci)) * value(inSpec,f,ci);
-      }
+    /* the output of this stage goes to mono beam1. The columns of
+       beamW hold the weights of one channel each, nfreq bins. */
+    for (unsigned int ci=0; ci<in_cfg.channels; ci++) {
+      MHASignal::conj_mac(beam1->buf, &(*beamW)(0,ci),
+                          &value(inSpec,0,ci), nfreq);
     }
 
     //perform blocking here
@@ -343,8 +391,23 @@ namespace rohBeam {
                            "30", "[1,5000]"),
       tau_blocking_XkY_ms("Time constant for estimation of filtered with blocked noise cross-PSD.",
                           "30", "[1,5000]"),
+      steering_grid_degrees("Resolution of the steering angle grid in degrees,"
+                            " has to divide 360 degrees.  When nonzero, the source"
+                            " azimuth is rounded to the grid, and head model and"
+                            " beamformer weights of the hm1 propagation model are"
+                            " looked up in a table for all grid angles.  The table"
+                            " is computed in a background thread after prepare."
+                            " 0 computes the beamformer for each source azimuth.",
+                            "0", "[0,180]"),
+      weight_cache_dir("Directory for cache files of steering grid weight tables."
+                       " Tables are loaded from and saved to this directory, so"
+                       " that they are only computed once for each design."
+                       " Empty: do not use cache files.", ""),
+      weight_table_state("State of the steering grid weight table."),
       prepared(false),
-      beamExport(nullptr), noiseModelExport(nullptr)
+      beamExport(nullptr), noiseModelExport(nullptr),
+      cancel_table_builder(false),
+      table_state(TABLE_OFF)
   {
     //register variables
     insert_item("prop_type", &prop_type);
@@ -363,6 +426,9 @@ namespace rohBeam {
     insert_item("tau_postfilter_ms", &tau_postfilter_ms);
     insert_item("tau_blocking_XkXi_ms", &tau_blocking_XkXi_ms);
     insert_item("tau_blocking_XkY_ms", &tau_blocking_XkY_ms);
+    insert_item("steering_grid_degrees", &steering_grid_degrees);
+    insert_item("weight_cache_dir", &weight_cache_dir);
+    insert_member(weight_table_state);
 
     patchbay.connect(&prop_type.valuechanged, this,
                      &rohBeam::on_model_param_valuechanged);
@@ -395,10 +461,20 @@ namespace rohBeam {
                      &rohBeam::on_model_param_valuechanged);
     patchbay.connect(&tau_blocking_XkY_ms.valuechanged, this,
                      &rohBeam::on_model_param_valuechanged);
+    patchbay.connect(&steering_grid_degrees.valuechanged, this,
+                     &rohBeam::on_model_param_valuechanged);
+    patchbay.connect(&weight_table_state.prereadaccess, this,
+                     &rohBeam::update_table_state);
+
+    //steering changes replace the configuration, keep retired
+    //configurations for reuse
+    set_cfg_pool_size(2);
   }
 
   rohBeam::~rohBeam()
   {
+    stop_table_builder();
+
     //delete initialized AC variables for export
     if ( beamExport != nullptr ) {
       delete beamExport;
@@ -448,11 +524,29 @@ namespace rohBeam {
 
   void rohBeam::update_cfg() {
 
+    const beam_design_t design = get_design();
+    std::shared_ptr<weight_table_t> weights;
+    float source_azimuth = source_azimuth_degrees.data;
+    unsigned int grid_index = 0;
+    if ( prop_type.isval("hm1") && steering_grid_degrees.data > 0 ) {
+      weights = get_weight_table( design );
+      //steer to the nearest grid angle also while the table is built
+      grid_index = weight_table_t::index_of( source_azimuth,
+                                             steering_grid_degrees.data );
+      source_azimuth = weight_table_t::grid_angle( grid_index,
+                                                   steering_grid_degrees.data );
+    } else {
+      stop_table_builder();
+      table_state = TABLE_OFF;
+    }
+
     std::unique_ptr<MatrixXcf> headModel =[&](){
                                             MatrixXcf* headModel=nullptr;
 
-                                            if ( prop_type.isval("hm1") ) {
-                                              headModel = compute_head_model_mat( source_azimuth_degrees.data );
+                                            if ( weights ) {
+                                              return weights->head_model( grid_index );
+                                            } else if ( prop_type.isval("hm1") ) {
+                                              headModel = design.compute_head_model_mat( source_azimuth );
                                             } else if ( prop_type.isval("sampled") ) {
 
                                               int nfreq = input_cfg().fftlen/2+1;
@@ -511,17 +605,24 @@ namespace rohBeam {
                                             return std::unique_ptr<MatrixXcf>(headModel);
                                           }();
 
-    auto delayC=std::unique_ptr<MHASignal::matrix_t>(compute_delaycomp_vec( headModel.get() ));
-    //whether to do wng optimization is built into compute_beamW
-    auto beamW=std::unique_ptr<MHASignal::matrix_t>(compute_beamW( headModel.get() ));
+    std::unique_ptr<MHASignal::matrix_t> delayC, beamW;
+    if ( weights ) {
+      delayC = weights->delaycomp( grid_index );
+      beamW = weights->beamW( grid_index );
+    } else {
+      delayC.reset( design.compute_delaycomp_vec( headModel.get() ) );
+      //whether to do wng optimization is built into compute_beamW
+      beamW.reset( design.compute_beamW( headModel.get() ) );
+    }
 
     if ( enable_export.data ) {
       //copy and export the beamformer
-      export_beam_design( *beamW.get(), *headModel.get() );
+      export_beam_design( *beamW.get(), *headModel.get(), design );
     }
 
     rohConfig *lastConfig = peek_config();
-    rohConfig *config;
+    //reuse the buffers of a retired configuration if possible
+    std::unique_ptr<rohConfig> config( recycle_config() );
 
     //adjusted the time constants to work by hopsize (despite ref not doing this)
     //as the exp. filters are updated each frame, this should be correct
@@ -543,29 +644,126 @@ namespace rohBeam {
     if ( lastConfig == nullptr ) {
 
       //create a new configuration with an initial state
-      config = new rohConfig( input_cfg(), output_cfg(),
-                              std::move(headModel),
-                              std::move(beamW),
-                              std::move(delayC),
-                              options );
-    } else {
+      config.reset( new rohConfig( input_cfg(), output_cfg(),
+                                   std::move(headModel),
+                                   std::move(beamW),
+                                   std::move(delayC),
+                                   options ) );
+    } else if ( !config ||
+                !config->reconfigure( lastConfig,
+                                      input_cfg(), output_cfg(),
+                                      std::move(headModel),
+                                      std::move(beamW),
+                                      std::move(delayC),
+                                      options ) ) {
 
       //copy temporal state (noise estimations) while changing the filter setup
-      config = new rohConfig( lastConfig,
-                              input_cfg(), output_cfg(),
-                              std::move(headModel),
-                              std::move(beamW),
-                              std::move(delayC),
-                              options );
+      config.reset( new rohConfig( lastConfig,
+                                   input_cfg(), output_cfg(),
+                                   std::move(headModel),
+                                   std::move(beamW),
+                                   std::move(delayC),
+                                   options ) );
+    }
+    push_config( config.release() );
+  }
+
+  beam_design_t rohBeam::get_design() const
+  {
+    beam_design_t design;
+    design.nchan = input_cfg().channels;
+    design.nfreq = input_cfg().fftlen/2+1;
+    design.fftlen = input_cfg().fftlen;
+    design.srate = input_cfg().srate;
+    design.mic_azimuth_degrees_vec = mic_azimuth_degrees_vec.data;
+    design.head_model_sphere_radius_cm = head_model_sphere_radius_cm.data;
+    design.intermic_distance_cm = intermic_distance_cm.data;
+    design.noise_option = noise_field_model.data.get_index();
+    design.diag_loading_mu = diag_loading_mu.data;
+    design.enable_wng_optimization = enable_wng_optimization.data;
+    return design;
+  }
+
+  /* Returns the weight table of the design if it is available.
+     Otherwise, the table is loaded from the cache directory, or its
+     computation is started in the background and nullptr returned. */
+  std::shared_ptr<weight_table_t> rohBeam::get_weight_table(const beam_design_t & design)
+  {
+    const float grid = steering_grid_degrees.data;
+    const std::string key = weight_table_t::table_key(design, grid);
+    {
+      std::lock_guard<std::mutex> lock(table_mutex);
+      if ( table && table->key == key )
+        return table;
+    }
+    if ( table_builder.joinable() && building_key == key )
+      return nullptr; //still computing, or failed for this design
+    stop_table_builder();
+    std::string filename;
+    if ( !weight_cache_dir.data.empty() ) {
+      filename = weight_table_t::cache_filename(weight_cache_dir.data, key);
+      std::shared_ptr<weight_table_t> loaded =
+        weight_table_t::load(filename, design, grid);
+      if ( loaded ) {
+        std::lock_guard<std::mutex> lock(table_mutex);
+        table = loaded;
+        table_state = TABLE_LOADED;
+        return table;
+      }
     }
-    push_config( config );
+    weight_table_t::num_grid_angles(grid); //validate before starting
+    building_key = key;
+    table_state = TABLE_BUILDING;
+    cancel_table_builder = false;
+    table_builder = std::thread([this, design, grid, filename]() {
+        try {
+          auto computed =
+            std::make_shared<weight_table_t>(design, grid, cancel_table_builder);
+          int state = TABLE_COMPUTED;
+          if ( !filename.empty() ) {
+            try {
+              computed->save(filename);
+            }
+            catch (MHA_Error &) {
+              state = TABLE_NOT_SAVED;
+            }
+          }
+          std::lock_guard<std::mutex> lock(table_mutex);
+          table = computed;
+          table_state = state;
+        }
+        catch (std::exception &) {
+          if ( !cancel_table_builder )
+            table_state = TABLE_FAILED;
+        }
+      });
+    return nullptr;
+  }
+
+  void rohBeam::stop_table_builder()
+  {
+    if ( table_builder.joinable() ) {
+      cancel_table_builder = true;
+      table_builder.join();
+    }
+    building_key.clear();
+    if ( table_state == TABLE_BUILDING )
+      table_state = TABLE_OFF;
+  }
+
+  void rohBeam::update_table_state()
+  {
+    static const char * names[] = { "off", "building", "computed",
+                                    "loaded", "computed, not saved",
+                                    "failed" };
+    weight_table_state.data = names[table_state];
   }
 
   /* this is the delay compensation vector that adjusts delays before blocking */
-  MHASignal::matrix_t * rohBeam::compute_delaycomp_vec(MatrixXcf *headModel)
+  MHASignal::matrix_t * beam_design_t::compute_delaycomp_vec(MatrixXcf *headModel) const
   {
-    int nchan = input_cfg().channels;
-    int nfreq = input_cfg().fftlen/2+1;
+    int nchan = this->nchan;
+    int nfreq = this->nfreq;
 
     //allocate the matrix
     MHASignal::matrix_t * delayCompMat =
@@ -585,10 +783,10 @@ namespace rohBeam {
   }
 
   //integrate the hrtf over all source angles and use it as noise model
-  std::vector<MatrixXcf> *rohBeam::noise_integrate_hrtf()
+  std::vector<MatrixXcf> *beam_design_t::noise_integrate_hrtf() const
   {
-    int nchan = input_cfg().channels;
-    int nfreq = input_cfg().fftlen/2+1;
+    int nchan = this->nchan;
+    int nfreq = this->nfreq;
 
     std::vector<MatrixXcf> *ret = new std::vector<MatrixXcf>( nfreq, MatrixXcf::Constant(nchan,nchan,0) );
 
@@ -629,11 +827,9 @@ namespace rohBeam {
    * or we iteratively optimize the White Noise Gain measure,
    * (adding different amounts of identity for different frequencies.)
    * */
-  VectorXcf rohBeam::solve_MVDR(VectorXcf propVec, MatrixXcf noiseM)
+  VectorXcf beam_design_t::solve_MVDR(VectorXcf propVec, MatrixXcf noiseM) const
   {
-    unsigned int nchan = input_cfg().channels;
-
-    if ( enable_wng_optimization.data ) {
+    if ( enable_wng_optimization ) {
 
       MatrixXcf Id = MatrixXcf::Identity(nchan,nchan);
       MatrixXcf nId = MatrixXcf::Constant(nchan,nchan,1) - Id;
@@ -666,7 +862,7 @@ namespace rohBeam {
     }
     else {
       //diagonal loading: to improve the condition/white noise gain
-      noiseM += diag_loading_mu.data * MatrixXcf::Identity(nchan,nchan);
+      noiseM += diag_loading_mu * MatrixXcf::Identity(nchan,nchan);
 
       //solution1: without matrix inversion
       VectorXcf freqRes = noiseM.fullPivLu().solve(propVec);
@@ -691,15 +887,10 @@ namespace rohBeam {
     }
   }
 
-  MHASignal::matrix_t * rohBeam::compute_beamW(MatrixXcf *headModel)
+  MHASignal::matrix_t * beam_design_t::compute_beamW(MatrixXcf *headModel,
+                                                     const std::vector<MatrixXcf> * noise) const
   {
-    unsigned int nfreq = input_cfg().fftlen/2+1;
-    unsigned int nchan = input_cfg().channels;
-    unsigned int fftlen = input_cfg().fftlen;
-    unsigned int srate = input_cfg().srate;
-
-    //poll the latest noise_field_model from current configuration
-    int noise_option = noise_field_model.data.get_index();
+    unsigned int srate = this->srate;
 
     std::unique_ptr<MHASignal::matrix_t> beamW(new MHASignal::matrix_t(nfreq, nchan));
 
@@ -739,7 +930,11 @@ namespace rohBeam {
     case 3: //integrated hrtf option
 
       {
-        std::vector <MatrixXcf> *noise = noise_integrate_hrtf();
+        std::unique_ptr<std::vector<MatrixXcf> > integrated;
+        if ( noise == nullptr ) {
+          integrated.reset( noise_integrate_hrtf() );
+          noise = integrated.get();
+        }
 
         for (unsigned int f=0; f<nfreq; f++) {
 
@@ -752,8 +947,6 @@ namespace rohBeam {
             ::set( (*beamW)(f,c), freqRes[c] );
           }
         }
-
-        delete noise;
       }
 
       break;
@@ -773,24 +966,23 @@ namespace rohBeam {
 
 
   //to make a one-line routine for computing wng
-  float rohBeam::compute_wng(VectorXcf freqRes, VectorXcf propVec) {
+  float beam_design_t::compute_wng(VectorXcf freqRes, VectorXcf propVec) const {
     float wngNom = pow( abs(std::complex<float>(scalarify(freqRes.adjoint()*propVec))), 2 );
     float wngDen = real( std::complex<float>(scalarify(freqRes.adjoint()*freqRes)));
     return 10*log10( wngNom / wngDen );
   }
 
   //for integrating hrtfs, we need to compute the hrtf at all angles
-  MatrixXcf * rohBeam::compute_head_model_mat(float src_az_degrees) {
+  MatrixXcf * beam_design_t::compute_head_model_mat(float src_az_degrees) const {
 
     mha_complex_t numer, denom, result1, result2;
-    int nchan = input_cfg().channels;
-    int nfreq = input_cfg().fftlen/2+1;
-    int fftlen = input_cfg().fftlen;
-    mha_real_t srate = input_cfg().srate;
+    int nchan = this->nchan;
+    int nfreq = this->nfreq;
+    int fftlen = this->fftlen;
 
     MatrixXcf * headModelMat = new MatrixXcf(nfreq, nchan);
 
-    float w0 = CONST_C / (head_model_sphere_radius_cm.data / 100.0f);
+    float w0 = CONST_C / (head_model_sphere_radius_cm / 100.0f);
 
     numer.re = 1;
     denom.re = 1;
@@ -801,7 +993,7 @@ namespace rohBeam {
       //compute T and a, which are based on angle difference
       //float s1 = source_azimuth_degrees.data;
       //float s2 = mic_azimuth_degrees_vec.data[m];
-      float angle_diff = src_az_degrees - mic_azimuth_degrees_vec.data[m];
+      float angle_diff = src_az_degrees - mic_azimuth_degrees_vec[m];
 
       if ( angle_diff > 180 ) {
         //if angle_diff > 180, go the other way around
@@ -841,15 +1033,16 @@ namespace rohBeam {
   }
 
   //accepts the angle difference in radians
-  float rohBeam::compute_head_model_T(float angle_rads) {
+  float beam_design_t::compute_head_model_T(float angle_rads) const {
     float angle_abs = fabs(angle_rads);
-    float rdivc = (head_model_sphere_radius_cm.data / 100.0f) / CONST_C;
+    float rdivc = (head_model_sphere_radius_cm / 100.0f) / CONST_C;
 
     //cases need to be in radians
     if ( (0 <= angle_abs) && (angle_abs < M_PI/2.0) ) {
       return rdivc * cos( angle_rads );
     }
-    else if ( M_PI/2.0 <= angle_abs && angle_abs < M_PI ) {
+    //opposite direction: the angle is pi rounded to float
+    else if ( M_PI/2.0 <= angle_abs && angle_abs <= float(M_PI) ) {
       return rdivc * ( angle_abs - M_PI/2 );
     }
     else  {
@@ -859,7 +1052,7 @@ namespace rohBeam {
   }
 
   //accepts the angle difference in radians
-  float rohBeam::compute_head_model_alpha(float angle_rads) {
+  float beam_design_t::compute_head_model_alpha(float angle_rads) const {
     float a_min = 0.1f;
     float theta_min_rads = 150.0 / 180.0 * M_PI;
     float a_ret = (1 + a_min/2.0f) +
@@ -867,11 +1060,11 @@ namespace rohBeam {
     return a_ret;
   }
 
-  const MatrixXf rohBeam::compute_uncorr(float) {
+  const MatrixXf beam_design_t::compute_uncorr(float) const {
 
     //this function just returns identity
     //allocate an eigen matrix
-    int ch_in = input_cfg().channels;
+    int ch_in = nchan;
     MatrixXf m( ch_in, ch_in );
 
     for (int i=0; i<ch_in; i++) {
@@ -884,16 +1077,16 @@ namespace rohBeam {
 
   }
 
-  const MatrixXf rohBeam::compute_diff2D(float w) {
+  const MatrixXf beam_design_t::compute_diff2D(float w) const {
     //allocate an eigen matrix
-    int ch_in = input_cfg().channels;
+    int ch_in = nchan;
     MatrixXf m( ch_in, ch_in );
 
     for (int i=0; i<ch_in; i++) {
       for (int k=0; k<ch_in; k++) {
 
         //implementation with Bessel functions of first kind
-        float arg = w * (intermic_distance_cm.data[i][k]/100.0f) / CONST_C;
+        float arg = w * (intermic_distance_cm[i][k]/100.0f) / CONST_C;
         m(i,k) = /*rohBeam::*/j0(arg);
         if( is_denormal(m(i,k) ) )
           throw MHA_Error(__FILE__,__LINE__,
@@ -905,16 +1098,16 @@ namespace rohBeam {
     return m;
   }
 
-  const MatrixXf rohBeam::compute_diff3D(float w) {
+  const MatrixXf beam_design_t::compute_diff3D(float w) const {
 
     //allocate an eigen matrix
-    MatrixXf m( input_cfg().channels, input_cfg().channels );
+    MatrixXf m( nchan, nchan );
 
-    for (unsigned int i=0; i<input_cfg().channels; i++) {
-      for (unsigned int k=0; k<input_cfg().channels; k++) {
+    for (unsigned int i=0; i<nchan; i++) {
+      for (unsigned int k=0; k<nchan; k++) {
 
         //implementation with sinc functions
-        float arg = w * (intermic_distance_cm.data[i][k]/100.0f) / CONST_C;
+        float arg = w * (intermic_distance_cm[i][k]/100.0f) / CONST_C;
         if ( fabs(arg) < 0.000001 ) { //arg zero
           m(i,k) = 1.0f;
         } else {
@@ -928,6 +1121,305 @@ namespace rohBeam {
 
 
 
+  namespace {
+    /// Version of the design computation and of the cache file layout,
+    /// increment when either changes
+    constexpr uint32_t design_version = 1U;
+
+    template <class T> void append(std::string & key, const T & value)
+    {
+      key.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /// Header of weight table cache files, followed by the table key
+    /// and the table data starting at data_offset
+    struct cache_header_t {
+      char magic[8];
+      uint32_t key_length;
+      uint32_t num_angles;
+      uint32_t nfreq;
+      uint32_t nchan;
+      uint64_t data_offset;
+    };
+    constexpr char cache_magic[8] = {'r','o','h','B','e','a','m','W'};
+
+    uint64_t data_offset(size_t key_length)
+    {
+      return (sizeof(cache_header_t) + key_length + 63U) / 64U * 64U;
+    }
+  }
+
+  std::string beam_design_t::key() const
+  {
+    std::string key;
+    append(key, design_version);
+    append(key, CONST_C);
+    append(key, nchan);
+    append(key, nfreq);
+    append(key, fftlen);
+    append(key, srate);
+    append(key, head_model_sphere_radius_cm);
+    for (auto az : mic_azimuth_degrees_vec)
+      append(key, az);
+    for (auto & row : intermic_distance_cm) {
+      append(key, unsigned(row.size()));
+      for (auto d : row)
+        append(key, d);
+    }
+    append(key, noise_option);
+    append(key, diag_loading_mu);
+    append(key, enable_wng_optimization);
+    return key;
+  }
+
+  /** Read-only contents of a file, memory-mapped where available. */
+  class mapped_file_t {
+  public:
+    /// Throws MHA_Error if the file can not be read.
+    explicit mapped_file_t(const std::string & filename);
+    ~mapped_file_t();
+    mapped_file_t(const mapped_file_t&)=delete;
+    mapped_file_t& operator=(const mapped_file_t&)=delete;
+    const char * data;
+    size_t length;
+#ifdef _WIN32
+  private:
+    std::string contents;
+#endif
+  };
+
+#ifndef _WIN32
+  mapped_file_t::mapped_file_t(const std::string & filename)
+    : data(nullptr), length(0U)
+  {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if ( fd < 0 )
+      throw MHA_Error(__FILE__,__LINE__,"Cannot open \"%s\": %s",
+                      filename.c_str(), strerror(errno));
+    struct stat st;
+    if ( fstat(fd, &st) || st.st_size <= 0 ) {
+      close(fd);
+      throw MHA_Error(__FILE__,__LINE__,"\"%s\" is empty.", filename.c_str());
+    }
+    length = st.st_size;
+    void * map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( map == MAP_FAILED )
+      throw MHA_Error(__FILE__,__LINE__,"Cannot map \"%s\": %s",
+                      filename.c_str(), strerror(errno));
+    data = static_cast<const char *>(map);
+  }
+
+  mapped_file_t::~mapped_file_t()
+  {
+    munmap(const_cast<char *>(data), length);
+  }
+#else
+  mapped_file_t::mapped_file_t(const std::string & filename)
+  {
+    std::ifstream file(filename, std::ios::binary);
+    if ( !file )
+      throw MHA_Error(__FILE__,__LINE__,"Cannot open \"%s\".", filename.c_str());
+    contents.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+    data = contents.data();
+    length = contents.size();
+  }
+
+  mapped_file_t::~mapped_file_t() {}
+#endif
+
+  weight_table_t::weight_table_t(const std::string & key_,
+                                 unsigned int num_angles_,
+                                 unsigned int nfreq_, unsigned int nchan_)
+    : key(key_), num_angles(num_angles_), nfreq(nfreq_), nchan(nchan_),
+      data(nullptr)
+  {}
+
+  weight_table_t::weight_table_t(const beam_design_t & design,
+                                 float grid_degrees,
+                                 const std::atomic<bool> & cancel)
+    : weight_table_t(table_key(design, grid_degrees),
+                     num_grid_angles(grid_degrees),
+                     design.nfreq, design.nchan)
+  {
+    storage.resize(size_t(num_angles) * 3U * nfreq * nchan);
+    data = storage.data();
+    //the integrated noise model does not depend on the steering angle
+    std::unique_ptr<std::vector<MatrixXcf> > noise;
+    if ( design.noise_option == 3 )
+      noise.reset( design.noise_integrate_hrtf() );
+    for (unsigned int a=0; a<num_angles; a++) {
+      if ( cancel )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Computation of the weight table was cancelled.");
+      std::unique_ptr<MatrixXcf>
+        headModel( design.compute_head_model_mat( grid_angle(a, grid_degrees) ) );
+      std::unique_ptr<MHASignal::matrix_t>
+        delayComp( design.compute_delaycomp_vec( headModel.get() ) );
+      std::unique_ptr<MHASignal::matrix_t>
+        beamW( design.compute_beamW( headModel.get(), noise.get() ) );
+      mha_complex_t * h = storage.data() + size_t(a) * 3U * nfreq * nchan;
+      mha_complex_t * w = h + nfreq * nchan;
+      mha_complex_t * d = w + nfreq * nchan;
+      for (unsigned int c=0; c<nchan; c++) {
+        for (unsigned int f=0; f<nfreq; f++) {
+          ::set( h[c*nfreq+f], (*headModel)(f,c) );
+          w[c*nfreq+f] = (*beamW)(f,c);
+          d[c*nfreq+f] = (*delayComp)(f,c);
+        }
+      }
+    }
+  }
+
+  weight_table_t::~weight_table_t() {}
+
+  std::unique_ptr<weight_table_t>
+  weight_table_t::load(const std::string & filename,
+                       const beam_design_t & design, float grid_degrees)
+  {
+    std::unique_ptr<mapped_file_t> file;
+    try {
+      file.reset( new mapped_file_t(filename) );
+    }
+    catch (MHA_Error &) {
+      return nullptr;
+    }
+    const std::string key = table_key(design, grid_degrees);
+    const unsigned int num_angles = num_grid_angles(grid_degrees);
+    cache_header_t header;
+    if ( file->length < sizeof(header) )
+      return nullptr;
+    memcpy(&header, file->data, sizeof(header));
+    const uint64_t offset = data_offset(key.size());
+    if ( memcmp(header.magic, cache_magic, sizeof(cache_magic)) ||
+         header.key_length != key.size() ||
+         header.num_angles != num_angles ||
+         header.nfreq != design.nfreq ||
+         header.nchan != design.nchan ||
+         header.data_offset != offset ||
+         file->length != offset + sizeof(mha_complex_t) * 3U *
+         num_angles * design.nfreq * design.nchan ||
+         key.compare(0, key.size(), file->data + sizeof(header),
+                     key.size()) )
+      return nullptr;
+    std::unique_ptr<weight_table_t>
+      table( new weight_table_t(key, num_angles, design.nfreq, design.nchan) );
+    table->data = reinterpret_cast<const mha_complex_t *>(file->data + offset);
+    table->file = std::move(file);
+    return table;
+  }
+
+  void weight_table_t::save(const std::string & filename) const
+  {
+    cache_header_t header = {};
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.key_length = key.size();
+    header.num_angles = num_angles;
+    header.nfreq = nfreq;
+    header.nchan = nchan;
+    header.data_offset = data_offset(key.size());
+    const std::string padding(header.data_offset - sizeof(header) -
+                              key.size(), '\0');
+    //write to a temporary file first, other instances may load the
+    //cache file at the same time
+    const std::string tmpname = filename + ".tmp";
+    {
+      std::ofstream file(tmpname, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      file << key << padding;
+      file.write(reinterpret_cast<const char *>(data),
+                 sizeof(mha_complex_t) * 3U * num_angles * nfreq * nchan);
+      file.close();
+      if ( !file ) {
+        std::remove(tmpname.c_str());
+        throw MHA_Error(__FILE__,__LINE__,"Cannot write \"%s\".",
+                        tmpname.c_str());
+      }
+    }
+    if ( std::rename(tmpname.c_str(), filename.c_str()) ) {
+      std::remove(tmpname.c_str());
+      throw MHA_Error(__FILE__,__LINE__,"Cannot rename \"%s\" to \"%s\".",
+                      tmpname.c_str(), filename.c_str());
+    }
+  }
+
+  std::unique_ptr<MatrixXcf> weight_table_t::head_model(unsigned int index) const
+  {
+    const mha_complex_t * h = matrix(index, 0U);
+    std::unique_ptr<MatrixXcf> headModel(new MatrixXcf(nfreq, nchan));
+    for (unsigned int c=0; c<nchan; c++)
+      for (unsigned int f=0; f<nfreq; f++)
+        (*headModel)(f,c) = stdcomplex( h[c*nfreq+f] );
+    return headModel;
+  }
+
+  std::unique_ptr<MHASignal::matrix_t> weight_table_t::beamW(unsigned int index) const
+  {
+    const mha_complex_t * w = matrix(index, 1U);
+    std::unique_ptr<MHASignal::matrix_t> beamW(new MHASignal::matrix_t(nfreq, nchan));
+    for (unsigned int c=0; c<nchan; c++)
+      for (unsigned int f=0; f<nfreq; f++)
+        (*beamW)(f,c) = w[c*nfreq+f];
+    return beamW;
+  }
+
+  std::unique_ptr<MHASignal::matrix_t> weight_table_t::delaycomp(unsigned int index) const
+  {
+    const mha_complex_t * d = matrix(index, 2U);
+    std::unique_ptr<MHASignal::matrix_t> delayComp(new MHASignal::matrix_t(nfreq, nchan));
+    for (unsigned int c=0; c<nchan; c++)
+      for (unsigned int f=0; f<nfreq; f++)
+        (*delayComp)(f,c) = d[c*nfreq+f];
+    return delayComp;
+  }
+
+  unsigned int weight_table_t::num_grid_angles(float grid_degrees)
+  {
+    const long num_angles = std::lround(360.0f / grid_degrees);
+    if ( !(grid_degrees > 0) || num_angles < 1 ||
+         std::fabs(num_angles * grid_degrees - 360.0f) > 1e-3f * grid_degrees )
+      throw MHA_Error(__FILE__,__LINE__,
+                      "The steering grid resolution (%g degrees) does not"
+                      " divide 360 degrees.", grid_degrees);
+    return num_angles;
+  }
+
+  unsigned int weight_table_t::index_of(float azimuth_degrees, float grid_degrees)
+  {
+    const long num_angles = num_grid_angles(grid_degrees);
+    long index = std::lround((azimuth_degrees + 180.0f) / grid_degrees) % num_angles;
+    if ( index < 0 )
+      index += num_angles;
+    return index;
+  }
+
+  float weight_table_t::grid_angle(unsigned int index, float grid_degrees)
+  {
+    return -180.0f + index * grid_degrees;
+  }
+
+  std::string weight_table_t::table_key(const beam_design_t & design,
+                                        float grid_degrees)
+  {
+    std::string key = design.key();
+    append(key, grid_degrees);
+    return key;
+  }
+
+  std::string weight_table_t::cache_filename(const std::string & dir,
+                                             const std::string & key)
+  {
+    //64 bit FNV-1a hash of the key, the file contains the full key
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key)
+      hash = (hash ^ c) * 1099511628211ULL;
+    char name[32];
+    snprintf(name, sizeof(name), "rohBeam_%016llx.bin",
+             (unsigned long long)hash);
+    return dir + "/" + name;
+  }
+
   /** This plugin implements noise reduction using spectral
    * subtraction: by nonnegative subtraction from the output magnitude
    * of the estimated noise magnitude spectrum.
@@ -944,7 +1436,8 @@ namespace rohBeam {
   }
 
   void rohBeam::export_beam_design( const MHASignal::matrix_t & beamW,
-                                    const MatrixXcf &headModel )
+                                    const MatrixXcf &headModel,
+                                    const beam_design_t & design )
   {
     unsigned int nfreq = beamW.size(0);
     unsigned int nchan = beamW.size(1);
@@ -981,11 +1474,11 @@ namespace rohBeam {
     }
 
     //copy the noise model, blockwise across mic channels into export spectrum
-    int noise_option = noise_field_model.data.get_index();
+    int noise_option = design.noise_option;
 
     if ( noise_option == 3 ) {
 
-      std::vector <MatrixXcf> *noise = noise_integrate_hrtf();
+      std::vector <MatrixXcf> *noise = design.noise_integrate_hrtf();
 
       for (unsigned int f=0; f<nfreq; f++) {
 
@@ -1003,11 +1496,11 @@ namespace rohBeam {
 
     } else {
 
-      noiseFuncPtr nModel = get_noise_model_func();
+      beam_design_t::noiseFuncPtr nModel = design.get_noise_model_func();
       for (unsigned int f=0; f<nfreq; f++) {
 
         float w = f * srate / fftlen * 2 * M_PI;
-        MatrixXf noiseM = (*this.*nModel)( w );
+        MatrixXf noiseM = (design.*nModel)( w );
 
         for (unsigned int i=0; i<nchan; i++) {
           for (unsigned int k=0; k<nchan; k++) {
@@ -1030,20 +1523,18 @@ namespace rohBeam {
     propExport->insert();
   }
 
-  rohBeam::noiseFuncPtr rohBeam::get_noise_model_func()
+  beam_design_t::noiseFuncPtr beam_design_t::get_noise_model_func() const
   {
-    //poll the latest noise_field_model from current configuration
-    int noise_option = noise_field_model.data.get_index();
     //function pointer for noise model
     noiseFuncPtr nModel = nullptr;
 
     //compute the beamformer with diff2D/diff3D noise model
     if ( noise_option == 0 )
-      nModel = &rohBeam::compute_uncorr;
+      nModel = &beam_design_t::compute_uncorr;
     else if ( noise_option == 1 )
-      nModel = &rohBeam::compute_diff2D;
+      nModel = &beam_design_t::compute_diff2D;
     else
-      nModel = &rohBeam::compute_diff3D;
+      nModel = &beam_design_t::compute_diff3D;
 
     return nModel;
   }
@@ -1101,6 +1592,16 @@ MHAPLUGIN_DOCUMENTATION(rohBeam,
                         "d. The third strategy, bilateral beamforming is not supported, but can be easily "
                         "implemented by configuring two rohBeams.\n\n"
 
+                        "When the source azimuth changes often, e.g. following a head tracker, "
+                        "the fixed beamformer of the hm1 propagation vector can be looked up in a table "
+                        "instead of being designed for each new angle: "
+                        "\"steering_grid_degrees\" rounds the source azimuth to a grid, "
+                        "and the designs of all grid angles are computed once in a background thread after prepare. "
+                        "Until the table is complete, designs are computed for each angle as before. "
+                        "With \"weight_cache_dir\", tables are saved to files identified by the array geometry, "
+                        "noise model, FFT length, and sampling rate, and later starts with the same design "
+                        "map the file into memory instead of computing the table.\n\n"
+
                         "Plausible features not implemented (but could be added) are:\n\n"
                         "a. Free Field for propogation vector. However you could do this by rendering your own "
                         "arbitrary HRTF and loading it via the \"sampled\" option for the propogation vector.\n\n"
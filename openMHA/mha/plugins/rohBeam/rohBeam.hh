@@ -31,9 +31,12 @@
 
 #include <eigen3/Eigen/Dense>
 
+#include <atomic>
 #include <cmath>
 #include <memory>
+#include <mutex>
 #include <fstream>
+#include <thread>
 
 namespace rohBeam {
 
@@ -77,9 +80,20 @@ namespace rohBeam {
     rohConfig& operator=(const rohConfig&)=delete;
     mha_spec_t* process(mha_spec_t*);
     void init_dynamic();
+    /** Update a retired configuration in place, copying state from the
+     * previous configuration like the corresponding constructor.
+     * @return false, leaving the pointers untouched, if the signal
+     *         dimensions differ. */
+    bool reconfigure(rohConfig *lastConfig,
+                     const mhaconfig_t in_cfg,const mhaconfig_t out_cfg,
+                     std::unique_ptr<Eigen::MatrixXcf> && headModel_,
+                     std::unique_ptr<MHASignal::matrix_t> && beamW_,
+                     std::unique_ptr<MHASignal::matrix_t> && delayComp_,
+                     const configOptions& options);
 
   private:
 
+    void reset_dynamic();
     void phasereconstruction(MHASignal::spectrum_t*);
     void postfilter(mha_spec_t *,MHASignal::spectrum_t*);
     void copyfixedbfoutput(MHASignal::spectrum_t*);
@@ -138,6 +152,115 @@ namespace rohBeam {
 
 
 
+  /** Parameters of the fixed beamformer design.  The design
+   * computations only depend on this copy of the configuration
+   * variables, so that designs can also be computed in a worker
+   * thread while the configuration changes. */
+  class beam_design_t {
+  public:
+    unsigned int nchan;
+    unsigned int nfreq;
+    unsigned int fftlen;
+    mha_real_t srate;
+    std::vector<mha_real_t> mic_azimuth_degrees_vec;
+    mha_real_t head_model_sphere_radius_cm;
+    std::vector<std::vector<mha_real_t>> intermic_distance_cm;
+    int noise_option;
+    mha_real_t diag_loading_mu;
+    bool enable_wng_optimization;
+
+    /// Byte string of all parameters that influence the design
+    std::string key() const;
+
+    Eigen::MatrixXcf * compute_head_model_mat(float src_az_degrees) const;
+    MHASignal::matrix_t * compute_delaycomp_vec(Eigen::MatrixXcf *headModel) const;
+    std::vector<Eigen::MatrixXcf> * noise_integrate_hrtf() const;
+    /// @param noise Noise model integrated over all directions for
+    ///   noise_option intHRTF, computed when nullptr.
+    MHASignal::matrix_t * compute_beamW(Eigen::MatrixXcf*,
+                                        const std::vector<Eigen::MatrixXcf> * noise = nullptr) const;
+
+    typedef const Eigen::MatrixXf (beam_design_t::*noiseFuncPtr) (float) const;
+    noiseFuncPtr get_noise_model_func(void) const;
+
+  private:
+    float compute_head_model_T(float) const;
+    float compute_head_model_alpha(float) const;
+    Eigen::VectorXcf solve_MVDR(Eigen::VectorXcf propVec, Eigen::MatrixXcf noiseM) const;
+    float compute_wng(Eigen::VectorXcf freqRes, Eigen::VectorXcf propVec) const;
+
+    const Eigen::MatrixXf compute_uncorr(float) const;
+    const Eigen::MatrixXf compute_diff2D(float) const;
+    const Eigen::MatrixXf compute_diff3D(float) const;
+  };
+
+  class mapped_file_t;
+
+  /** Head model, fixed beamformer weights, and delay compensation of
+   * the hm1 propagation model for a grid of steering angles.  The
+   * table is either computed or memory-mapped from a cache file
+   * written by an earlier computation for the same design.  The three
+   * matrices of each angle are stored bin by bin for each channel as
+   * complex floats, in files the data starts at a multiple of 64
+   * bytes. */
+  class weight_table_t {
+  public:
+    /** Compute the table.
+     * @param design   Beamformer design
+     * @param grid_degrees Grid resolution, has to divide 360 degrees
+     * @param cancel   Computation is aborted with an exception when
+     *                 this flag is set by another thread. */
+    weight_table_t(const beam_design_t & design, float grid_degrees,
+                   const std::atomic<bool> & cancel);
+    /** Map a cache file into memory.
+     * @return nullptr if the file does not exist or was written for
+     *         a different design. */
+    static std::unique_ptr<weight_table_t> load(const std::string & filename,
+                                                const beam_design_t & design,
+                                                float grid_degrees);
+    /// Write the table to a cache file, throws MHA_Error on failure.
+    void save(const std::string & filename) const;
+    ~weight_table_t();
+    weight_table_t(const weight_table_t&)=delete;
+    weight_table_t& operator=(const weight_table_t&)=delete;
+
+    std::unique_ptr<Eigen::MatrixXcf> head_model(unsigned int index) const;
+    std::unique_ptr<MHASignal::matrix_t> beamW(unsigned int index) const;
+    std::unique_ptr<MHASignal::matrix_t> delaycomp(unsigned int index) const;
+
+    /// Key of the design and grid resolution of this table
+    const std::string key;
+
+    /// Number of grid angles for a resolution in degrees, throws
+    /// MHA_Error if the resolution does not divide 360 degrees.
+    static unsigned int num_grid_angles(float grid_degrees);
+    /// Index of the grid angle nearest to an azimuth
+    static unsigned int index_of(float azimuth_degrees, float grid_degrees);
+    /// Azimuth of a grid angle in degrees
+    static float grid_angle(unsigned int index, float grid_degrees);
+    /// Design key with grid resolution
+    static std::string table_key(const beam_design_t & design,
+                                 float grid_degrees);
+    /// Name of the cache file for a table key in a directory
+    static std::string cache_filename(const std::string & dir,
+                                      const std::string & key);
+
+  private:
+    weight_table_t(const std::string & key, unsigned int num_angles,
+                   unsigned int nfreq, unsigned int nchan);
+    const mha_complex_t * matrix(unsigned int index, unsigned int m) const {
+      return data + (size_t(index) * 3U + m) * nfreq * nchan;
+    }
+    unsigned int num_angles;
+    unsigned int nfreq;
+    unsigned int nchan;
+    /// Storage of computed tables
+    std::vector<mha_complex_t> storage;
+    /// Cache file of loaded tables
+    std::unique_ptr<mapped_file_t> file;
+    const mha_complex_t * data;
+  };
+
   class rohBeam : public MHAPlugin::plugin_t<rohConfig> {
 
   public:
@@ -150,23 +273,12 @@ namespace rohBeam {
   private:
     void update_cfg();
 
-    float compute_head_model_T(float);
-    float compute_head_model_alpha(float);
-    Eigen::MatrixXcf * compute_head_model_mat(float src_az_degrees);
-    MHASignal::matrix_t * compute_delaycomp_vec(Eigen::MatrixXcf *headModel);
-    std::vector<Eigen::MatrixXcf> * noise_integrate_hrtf();
-    Eigen::VectorXcf solve_MVDR(Eigen::VectorXcf propVec, Eigen::MatrixXcf noiseM);
-
-    const Eigen::MatrixXf compute_uncorr(float w);
-    const Eigen::MatrixXf compute_diff2D(float);
-    const Eigen::MatrixXf compute_diff3D(float);
-
-    MHASignal::matrix_t * compute_beamW(Eigen::MatrixXcf*);
-    float compute_wng(Eigen::VectorXcf freqRes, Eigen::VectorXcf propVec);
-    void export_beam_design( const MHASignal::matrix_t & beamW,const Eigen::MatrixXcf &headModel );
-
-    typedef const Eigen::MatrixXf (rohBeam::*noiseFuncPtr) (float);
-    noiseFuncPtr get_noise_model_func(void);
+    beam_design_t get_design() const;
+    std::shared_ptr<weight_table_t> get_weight_table(const beam_design_t &);
+    void stop_table_builder();
+    void update_table_state();
+    void export_beam_design( const MHASignal::matrix_t & beamW,const Eigen::MatrixXcf &headModel,
+                             const beam_design_t & design );
 
     MHAParser::kw_t prop_type;
     MHAParser::string_t sampled_hrir_path;
@@ -186,6 +298,10 @@ namespace rohBeam {
     MHAParser::float_t tau_blocking_XkXi_ms;
     MHAParser::float_t tau_blocking_XkY_ms;
 
+    MHAParser::float_t steering_grid_degrees;
+    MHAParser::string_t weight_cache_dir;
+    MHAParser::string_mon_t weight_table_state;
+
     /* patch bay for connecting configuration parser
        events with local member functions: */
     MHAEvents::patchbay_t<rohBeam> patchbay;
@@ -197,6 +313,18 @@ namespace rohBeam {
     MHA_AC::waveform_t * noiseModelExport; //change to spectrum if we need complex PSD
     MHA_AC::spectrum_t * propExport;
 
+    /* weight table for the steering grid, replaced by the builder
+       thread when it finishes, protected by table_mutex */
+    std::shared_ptr<weight_table_t> table;
+    std::mutex table_mutex;
+    std::thread table_builder;
+    std::atomic<bool> cancel_table_builder;
+    /// key of the table computed by table_builder
+    std::string building_key;
+    enum table_state_t { TABLE_OFF, TABLE_BUILDING, TABLE_COMPUTED,
+                         TABLE_LOADED, TABLE_NOT_SAVED, TABLE_FAILED };
+    std::atomic<int> table_state;
+
     void on_model_param_valuechanged();
 
   };
@@ -15,7 +15,16 @@
 
 #include <gtest/gtest.h>
 #include "rohBeam.hh"
-
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 TEST(j0,compare_to_reference){
   //j0(x), x=0,0.1,...,10, bionic default implementation
@@ -36,6 +45,136 @@ TEST(j0,compare_to_reference){
   }
 }
 
+namespace {
+  /// Temporary directory of one test, removed with the files written
+  /// into it when the test ends, also when an assertion fails
+  class temp_dir_t {
+  public:
+    temp_dir_t()
+    {
+#ifdef _WIN32
+      char name[] = "rohBeam_test_XXXXXX";
+      if (_mktemp_s(name, sizeof(name)) == 0 && _mkdir(name) == 0)
+        path = name;
+#else
+      const char * tmp = std::getenv("TMPDIR");
+      std::string templ = std::string(tmp && *tmp ? tmp : "/tmp")
+        + "/rohBeam_test_XXXXXX";
+      std::vector<char> name(templ.begin(), templ.end());
+      name.push_back('\0');
+      if (mkdtemp(name.data()))
+        path = name.data();
+#endif
+      if (path.empty())
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Cannot create a temporary directory");
+    }
+    ~temp_dir_t()
+    {
+      for (const std::string & file : files)
+        std::remove(file.c_str());
+#ifdef _WIN32
+      _rmdir(path.c_str());
+#else
+      rmdir(path.c_str());
+#endif
+    }
+    temp_dir_t(const temp_dir_t &) = delete;
+    temp_dir_t & operator=(const temp_dir_t &) = delete;
+    /// Registers a file in this directory for removal
+    const std::string & track(const std::string & file)
+    {
+      files.push_back(file);
+      return files.back();
+    }
+    std::string path;
+  private:
+    std::vector<std::string> files;
+  };
+
+  rohBeam::beam_design_t design(int noise_option)
+  {
+    rohBeam::beam_design_t d;
+    d.nchan = 4;
+    d.fftlen = 64;
+    d.nfreq = d.fftlen/2+1;
+    d.srate = 16000;
+    d.mic_azimuth_degrees_vec = {90, 80, -80, -90};
+    d.head_model_sphere_radius_cm = 8.2f;
+    d.intermic_distance_cm = {{0, 1, 15, 16}, {1, 0, 14, 15},
+                              {15, 14, 0, 1}, {16, 15, 1, 0}};
+    d.noise_option = noise_option;
+    d.diag_loading_mu = 0.1f;
+    d.enable_wng_optimization = false;
+    return d;
+  }
+}
+
+TEST(weight_table_t, grid)
+{
+  using rohBeam::weight_table_t;
+  EXPECT_EQ(72U, weight_table_t::num_grid_angles(5));
+  EXPECT_EQ(1U, weight_table_t::num_grid_angles(360));
+  EXPECT_THROW(weight_table_t::num_grid_angles(7), MHA_Error);
+  EXPECT_THROW(weight_table_t::num_grid_angles(0), MHA_Error);
+  EXPECT_EQ(0U, weight_table_t::index_of(-180, 5));
+  EXPECT_EQ(0U, weight_table_t::index_of(180, 5));
+  EXPECT_EQ(0U, weight_table_t::index_of(178, 5));
+  EXPECT_EQ(71U, weight_table_t::index_of(177, 5));
+  EXPECT_EQ(36U, weight_table_t::index_of(2, 5));
+  EXPECT_EQ(37U, weight_table_t::index_of(3, 5));
+  EXPECT_EQ(5.0f, weight_table_t::grid_angle(37, 5));
+}
+
+TEST(weight_table_t, equals_design_and_cache_file)
+{
+  std::atomic<bool> cancel(false);
+  temp_dir_t dir;
+  for (int noise_option : {1, 3}) {
+    const auto d = design(noise_option);
+    rohBeam::weight_table_t table(d, 30, cancel);
+    for (unsigned index : {0U, 5U, 11U}) {
+      std::unique_ptr<Eigen::MatrixXcf>
+        headModel(d.compute_head_model_mat(-180.0f + 30.0f * index));
+      std::unique_ptr<MHASignal::matrix_t>
+        beamW(d.compute_beamW(headModel.get())),
+        delayComp(d.compute_delaycomp_vec(headModel.get()));
+      EXPECT_EQ(*headModel, *table.head_model(index));
+      auto tableW = table.beamW(index), tableD = table.delaycomp(index);
+      for (unsigned f = 0; f < d.nfreq; ++f)
+        for (unsigned c = 0; c < d.nchan; ++c) {
+          EXPECT_EQ((*beamW)(f,c).re, (*tableW)(f,c).re);
+          EXPECT_EQ((*beamW)(f,c).im, (*tableW)(f,c).im);
+          EXPECT_EQ((*delayComp)(f,c).re, (*tableD)(f,c).re);
+          EXPECT_EQ((*delayComp)(f,c).im, (*tableD)(f,c).im);
+        }
+    }
+
+    const std::string filename = dir.track
+      (rohBeam::weight_table_t::cache_filename(dir.path, table.key));
+    EXPECT_EQ(nullptr, rohBeam::weight_table_t::load(filename, d, 30));
+    table.save(filename);
+    auto loaded = rohBeam::weight_table_t::load(filename, d, 30);
+    ASSERT_NE(nullptr, loaded);
+    EXPECT_EQ(table.key, loaded->key);
+    for (unsigned index = 0; index < 12U; ++index) {
+      EXPECT_EQ(*table.head_model(index), *loaded->head_model(index));
+      auto tableW = table.beamW(index), loadedW = loaded->beamW(index);
+      for (unsigned f = 0; f < d.nfreq; ++f)
+        for (unsigned c = 0; c < d.nchan; ++c)
+          EXPECT_EQ((*tableW)(f,c).re, (*loadedW)(f,c).re);
+    }
+    // other designs and grids do not use this file
+    auto other = d;
+    other.diag_loading_mu = 0.2f;
+    EXPECT_EQ(nullptr, rohBeam::weight_table_t::load(filename, other, 30));
+    EXPECT_EQ(nullptr, rohBeam::weight_table_t::load(filename, d, 45));
+    EXPECT_EQ(0, std::remove(filename.c_str()));
+  }
+  cancel = true;
+  EXPECT_THROW(rohBeam::weight_table_t(design(1), 30, cancel), MHA_Error);
+}
+
 // Local Variables:
 // compile-command: "make unit-tests"
 // coding: utf-8-unix
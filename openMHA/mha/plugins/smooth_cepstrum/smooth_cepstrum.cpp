@@ -16,6 +16,7 @@
 
 #include "smooth_cepstrum.hh"
 #include "mha_filter.hh"
+#include "mha_vecmath.hh"
 #include <algorithm>
 #include <vector>
 
@@ -87,6 +88,10 @@ void smooth_cepstrum::smooth_cepstrum_if_t::prepare(mhaconfig_t & signal_info)
     if (signal_info.domain != MHA_SPECTRUM)
         throw MHA_Error(__FILE__, __LINE__,
                         "This plugin can only process spectrum signals.");
+    if (signal_info.fftlen % 2U)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "This plugin requires an even FFT length (got %u).",
+                        signal_info.fftlen);
 
     //tell the plugin that it's ok to prepare configurations
     prepared = true;
@@ -130,17 +135,14 @@ mha_spec_t * smooth_cepstrum::smooth_cepstrum_if_t::process(mha_spec_t * signal)
     return poll_config()->process(signal);
 }
 
-//TODO: "full" variables probably not needed,
-//ie we just use the symmetric ffts provided by MHA
-
 smooth_cepstrum::smooth_cepstrum_t::smooth_cepstrum_t(MHA_AC::algo_comm_t & ac,
                                                       smooth_params & params_) :
 
     ac( ac ), params( params_ ),
     fftlen( params.in_cfg.fftlen ),
-    mha_fft( mha_fft_new( fftlen ) ),
     nfreq( fftlen/2+1 ),
     nchan( params.in_cfg.channels ),
+    dct( nfreq, MHASignal::dct_t::DCT_I ),
     ola_powspec_scale( fftlen * fftlen / POWSPEC_FACTOR / OVERLAP_FACTOR ),
     q_low( floor(params.in_cfg.srate / params.f0_high) ),
     q_high( floor(params.in_cfg.srate / params.f0_low) ),
@@ -153,14 +155,14 @@ smooth_cepstrum::smooth_cepstrum_t::smooth_cepstrum_t(MHA_AC::algo_comm_t & ac,
     powSpec( nfreq, nchan ),
     gamma_post( nfreq, nchan ),
     xi_ml( nfreq, nchan ),
-    lambda_ml_full( fftlen, nchan ),
-    lambda_ml_ceps( fftlen, nchan ),
+    lambda_ml_log( nfreq, nchan ),
+    lambda_ml_ceps( nfreq, nchan ),
     lambda_ml_smooth( nfreq, nchan ),
     alpha_hat( nfreq, nchan ),
     alpha_frame( nfreq, nchan ),
-    lambda_ceps( fftlen, nchan ),
+    lambda_ceps( nfreq, nchan ),
     lambda_ceps_prev( nfreq, nchan ),
-    log_lambda_spec( fftlen, nchan ),
+    log_lambda_spec( nfreq, nchan ),
     lambda_spec( nfreq, nchan ),
     xi_est( nfreq, nchan ),
     gain_wiener( nfreq, nchan ),
@@ -225,39 +227,20 @@ mha_spec_t *smooth_cepstrum::smooth_cepstrum_t::process(mha_spec_t *noisyFrame)
             gamma_post.value(f,c) = powSpec.value(f,c) / denom;
 
             xi_ml.value(f,c) = gamma_post.value(f,c) - 1;
-            lambda_ml_full.value(f,c).re = noisePow.value(f,c) * std::max( xi_ml.value(f,c), xi_min );
-
-        }
-    }
+            lambda_ml_log.value(f,c) = noisePow.value(f,c) * std::max( xi_ml.value(f,c), xi_min );
 
-    for (unsigned int f=0; f<nfreq; ++f)
-    {
-        for(unsigned c=0U; c<nchan; ++c)
-        {
-            //take the log in anticipation of cepstrum
-            lambda_ml_full.value(f,c).re = log( lambda_ml_full.value(f,c).re );
-            MHAFilter::make_friendly_number( lambda_ml_full.value(f,c).re );
         }
     }
 
-    //complete the right half of the spectrum
-    for (unsigned int f=1; f<nfreq; ++f)
-    {
-        for(unsigned c=0U; c<nchan; ++c)
-        {
-            lambda_ml_full.value( fftlen-f, c ).re = lambda_ml_full.value(f,c).re;
-        }
-    }
+    //take the log in anticipation of cepstrum
+    MHASignal::vec_log(lambda_ml_log.buf, lambda_ml_log.buf,
+                       size(lambda_ml_log));
+    for (unsigned int k=0; k<size(lambda_ml_log); ++k)
+        MHAFilter::make_friendly_number( lambda_ml_log.buf[k] );
 
-    //TODO: we might be able to use spec2wav for this
-    mha_fft_backward_scale(mha_fft, &lambda_ml_full, &lambda_ml_ceps);
-    for (unsigned int f=0; f<fftlen; ++f)
-    {
-        for(unsigned c=0U; c<nchan; ++c)
-        {
-            lambda_ml_ceps.value(f,c).im = 0; //kill the imaginary
-        }
-    }
+    //the spectrum is real and even: its inverse DFT is the inverse
+    //DCT-I of the bins 0..fftlen/2
+    dct.inverse(lambda_ml_log, lambda_ml_ceps);
 
     lambda_ml_smooth.assign(0); //init smooth
 
@@ -272,7 +255,7 @@ mha_spec_t *smooth_cepstrum::smooth_cepstrum_t::process(mha_spec_t *noisyFrame)
                 if (int(f+w)-halfWin < 0) continue;
                 if (f+w-halfWin >= nfreq) continue;
 
-                lambda_ml_smooth.value(f,c) += lambda_ml_ceps.value(f+w-halfWin,c).re * winF0[w];
+                lambda_ml_smooth.value(f,c) += lambda_ml_ceps.value(f+w-halfWin,c) * winF0[w];
             }
         }
     }
@@ -301,7 +284,7 @@ mha_spec_t *smooth_cepstrum::smooth_cepstrum_t::process(mha_spec_t *noisyFrame)
     for(unsigned c=0U; c<nchan; ++c)
     {
 
-        if ( (max_val[c] > params.lambda_thresh) && (lambda_ml_ceps.value(1,c).re > 0) )
+        if ( (max_val[c] > params.lambda_thresh) && (lambda_ml_ceps.value(1,c) > 0) )
         {
             pitch_set_first[c] = max_q[c] - params.delta_pitch;
             pitch_set_last[c] = max_q[c] + params.delta_pitch;
@@ -350,39 +333,27 @@ mha_spec_t *smooth_cepstrum::smooth_cepstrum_t::process(mha_spec_t *noisyFrame)
             //also watch out for denormals here
             mha_real_t f;
             f = alpha_frame.value(q,c) * lambda_ceps_prev.value(q,c) +
-                    (1-alpha_frame.value(q,c)) * lambda_ml_ceps.value(q,c).re;
+                    (1-alpha_frame.value(q,c)) * lambda_ml_ceps.value(q,c);
             MHAFilter::make_friendly_number( f );
-            lambda_ceps.value(q,c).re = f;
+            lambda_ceps.value(q,c) = f;
 
             lambda_ceps_prev.value(q,c) = f;
         }
     }
 
-    //complete the spectrum
-    for (unsigned int q=1; q<nfreq; ++q)
-    {
-        for(unsigned c=0U; c<nchan; ++c)
-        {
-            lambda_ceps.value( fftlen-q, c ).re = lambda_ceps.value(q,c).re;
-        }
-    }
-
-    mha_fft_forward_scale(mha_fft, &lambda_ceps, &log_lambda_spec);
-    for (unsigned int f=0; f<fftlen; ++f)
-    {
-        for(unsigned c=0U; c<nchan; ++c)
-        {
-            log_lambda_spec.value(f,c).im = 0; //kill the imaginary
-        }
-    }
+    //back to the log spectrum with the forward DCT-I
+    dct.forward(lambda_ceps, log_lambda_spec);
 
     spec_out.copy( *noisyFrame ); //copy input
 
+    for (unsigned int k=0; k<size(lambda_spec); ++k)
+        lambda_spec.buf[k] = params.kappa_const + log_lambda_spec.buf[k];
+    MHASignal::vec_exp(lambda_spec.buf, lambda_spec.buf, size(lambda_spec));
+
     for (unsigned int f=0; f<nfreq; ++f)
     {
         for(unsigned c=0U; c<nchan; ++c)
         {
-            lambda_spec.value(f,c) = exp( params.kappa_const + log_lambda_spec.value(f,c).re );
             MHAFilter::make_friendly_number( lambda_spec.value(f,c) );
 
             float denom = std::max( noisePow.value(f,c), (mha_real_t) EPSILON );
@@ -397,13 +368,12 @@ mha_spec_t *smooth_cepstrum::smooth_cepstrum_t::process(mha_spec_t *noisyFrame)
     }
 
     //compute SPP HERE
-    for (unsigned int f=0; f<nfreq; ++f)
-    {
-        for(unsigned c=0U; c<nchan; ++c)
-        {
-            GLR(f,c) = priorFact * exp(std::min(logGLRFact + GLRexp * xi_est(f,c),(float)50.0));
-            MHAFilter::make_friendly_number( GLR(f,c) );
-        }
+    for (unsigned int k=0; k<size(GLR); ++k)
+        GLR.buf[k] = std::min(logGLRFact + GLRexp * xi_est.buf[k],(float)50.0);
+    MHASignal::vec_exp(GLR.buf, GLR.buf, size(GLR));
+    for (unsigned int k=0; k<size(GLR); ++k) {
+        GLR.buf[k] *= priorFact;
+        MHAFilter::make_friendly_number( GLR.buf[k] );
     }
 
     return &spec_out;
@@ -82,11 +82,13 @@ namespace smooth_cepstrum {
         smooth_params params;
 
         unsigned int fftlen;
-        mha_fft_t mha_fft;
 
         unsigned int nfreq;
         unsigned int nchan;
 
+        //cepstrum of the real and even log spectra from their nfreq bins
+        MHASignal::dct_t dct;
+
         //constant to override scale of powspec within overlapadd
         float ola_powspec_scale;
 
@@ -107,17 +109,17 @@ namespace smooth_cepstrum {
 
         MHASignal::waveform_t gamma_post;
         MHASignal::waveform_t xi_ml;
-        MHASignal::spectrum_t lambda_ml_full;
-        MHASignal::spectrum_t lambda_ml_ceps;
+        MHASignal::waveform_t lambda_ml_log;
+        MHASignal::waveform_t lambda_ml_ceps;
         MHASignal::waveform_t lambda_ml_smooth;
 
         MHASignal::waveform_t alpha_hat;
         MHASignal::waveform_t alpha_frame;
 
-        MHASignal::spectrum_t lambda_ceps;
+        MHASignal::waveform_t lambda_ceps;
         MHASignal::waveform_t lambda_ceps_prev;
 
-        MHASignal::spectrum_t log_lambda_spec;
+        MHASignal::waveform_t log_lambda_spec;
         MHASignal::waveform_t lambda_spec;
 
         MHASignal::waveform_t xi_est;
@@ -131,7 +131,7 @@ spec2wave_t::spec2wave_t(unsigned int nfft_,unsigned int nwnd_,unsigned int nwnd
       postwindow(postwin)
 {
     postwindow *= sc;
-    ft = mha_fft_new( nfft );
+    ft = mha_fft_new( nfft, nch );
 }
 
 spec2wave_t::~spec2wave_t()
@@ -25,389 +25,121 @@
  * method, enabling all four domain transformations in a single plugin. */
 #define MHAPLUGIN_OVERLOAD_OUTDOMAIN
 
-#include <typeinfo>
-#include "mha_algo_comm.hh"
-#include "mha_multisrc.h"
-#include "mhapluginloader.h"
+#include "split.hh"
 
-#ifdef _WIN32
-#define win32threads 1
-#define native_thread_platform_type win32_threads_t
-#else
-#define posixthreads 1
-#include <pthread.h>
-#include <sched.h>
-#define native_thread_platform_type posix_threads_t
-#endif
-
-// forward declaration of test classes
-class Test_splitted_part_t;
-
-/** \internal
- * A namespace for the split plugin.  Helps testability and documentation. */
 namespace MHAPlugin_Split {
 
-    /// Invalid thread priority
-    enum {INVALID_THREAD_PRIORITY = 999999999};
-
-    /** An interface to a class that sports a process method with no
-     * parameters and no return value.  No signal transfer occurs
-     * through this interface, because the signal transfer is
-     * performed in another thread than the processing. */
-    class uni_processor_t {
-    public:
-        /** This method uses some input signal, performs processing
-         * and stores the output signal somewhere.  This method also
-         * has to dispatch the process call based on the configured
-         * domains.
-         *
-         * Signal transfer and domain configuration have to be done in
-         * derived class in different methods. */
-        virtual void process() = 0;
-        /// Classes containing virtual methods need virtual destructors.
-        virtual ~uni_processor_t() {}
-    };
-
-    /** Basic interface for encapsulating thread creation, thread
-     * priority setting, and synchronization on any threading platform
-     * (i.e., pthreads or win32threads).
-     * Derived classes specialize in the actual thread platform.
-     */
-    class thread_platform_t {
-    private:
-        /// Disallow copy constructor
-        thread_platform_t(const thread_platform_t &);
-        /// Disallow assignment operator
-        thread_platform_t & operator=(const thread_platform_t &);
-    protected:
-        /// A pointer to the plugin loader that processes the sound
-        /// data in the channels for which this thread was created.
-        /// Using the MHAPlugin_Split::uni_processor_t interface
-        /// instead of the mhapluginloader class directly for
-        /// testability (no need to load real plugins for testing the
-        /// thread platform).
-        uni_processor_t * processor;
-    public:
-        /// Constructor. Derived classes create the thread in the constructor.
-        /// @param proc  Pointer to the associated plugin loader.
-        ///   This plugin loader has to live at least as long as this
-        ///   instance.  This instance does not take possession of the
-        ///   plugin loader.  In production code, this thread platform
-        ///   and the plugin loader are both created and destroyed by
-        ///   the MHAPlugin_Split::splitted_part_t instance.
-        thread_platform_t(uni_processor_t * proc)
-            : processor(proc)
-        {}
-
-        /// Make derived classes destructable via pointer to this base
-        /// class.  Derived classes' destructors notify the thread
-        /// that it should terminate itself, and wait for the
-        /// termination to occur.
-        virtual ~thread_platform_t(){}
-        
-        /// Derived classes notify their processing thread that it should call
-        /// processor->process().
-        virtual void kick_thread() = 0;
-
-        /// Derived classes wait for their signal processing thread to
-        /// return from the call to part->process().
-        virtual void catch_thread() = 0;
-    };
-
-    /** Dummy specification of a thread platform: This class
-     * implements everything in a single thread. */
-    class dummy_threads_t : public thread_platform_t {
-    public:
-        /// perform signal processing immediately (no multiple threads
-        /// in this dummy class)
-        void kick_thread() {processor->process();}
-        /// No implementation needed: Processing has been completed
-        /// during ummy_threads_t::kick_thread.
-        void catch_thread() {}
-        /// Constructor.
-        /// @param proc  Pointer to the associated plugin loader
-        /// @param thread_scheduler
-        ///   Unused in dummy thread platform
-        /// @param thread_priority
-        ///   Unused in dummy thread platform
-        dummy_threads_t(uni_processor_t * proc,
-                        const std::string & thread_scheduler,
-                        int thread_priority)
-            : thread_platform_t(proc)
-        {
-            (void) thread_scheduler;
-            (void) thread_priority;
-        }
-    };
-
+    worker_pool_t::worker_pool_t(unsigned num_threads,
+                                 const std::vector<int> & cpus,
+                                 unsigned spin_us,
+                                 const std::string & thread_scheduler,
+                                 int thread_priority)
+        // Spinning only helps when other cores can do the work meanwhile
+        : spin_time(std::thread::hardware_concurrency() > 1U ? spin_us : 0U),
+          queue(256U),
+          pending(0U),
+          sleepers(0U),
+          termination_request(false)
+    {
+        if (num_threads == 0U)
+            num_threads = std::max(std::thread::hardware_concurrency(), 2U) - 1U;
+        try {
+            for (unsigned k = 0; k < num_threads; ++k) {
+                workers.emplace_back(&worker_pool_t::worker_main, this);
 #ifdef posixthreads
-    /** Posix threads specification of thread platform */
-    class posix_threads_t : public thread_platform_t {
-        /// The mutex.
-        pthread_mutex_t mutex;
-        /// The condition for signalling the kicking and termination.
-        pthread_cond_t kick_condition;
-        /// The condition for signalling the processing is finished.
-        pthread_cond_t catch_condition;
-        /// Thread attributes
-        pthread_attr_t attr;
-        /// Thread scheduling priority
-        struct sched_param priority;
-        int scheduler;
-        /// The thread object
-        pthread_t thread;
-        /** A flag that is set to true by kick_thread and to false by
-         * the thread after it has woken up from the kicking. */
-        bool kicked;
-        /** A flag that is set to true by the thread when it returns
-         * from processing and to false by catch_thread after it has
-         * waited for that return. */
-        bool processing_done;
-        /** Set to true by the destructor. */
-        bool termination_request;
-    public:
-        /// Start signal processing in separate thread.
-        void kick_thread() {
-            if (kicked != false) throw MHA_ErrorMsg("synchronization error");
-            pthread_mutex_lock(&mutex);
-            kicked = true;
-            pthread_cond_signal(&kick_condition);
-            pthread_mutex_unlock(&mutex);
-        }
-        /// Wait for signal processing to finish.
-        void catch_thread() {
-            pthread_mutex_lock(&mutex);
-            while ( ! processing_done )
-                pthread_cond_wait(&catch_condition, &mutex);
-            processing_done = false;
-            pthread_mutex_unlock(&mutex);
-        }
-        /** Constructor.
-         * @param proc
-         *   Pointer to the associated signal processor instance
-         * @param thread_scheduler
-         *   A string describing the posix thread scheduler. Possible values:
-         *   "SCHED_OTHER", "SCHED_RR", "SCHED_FIFO".
-         * @param thread_priority
-         *   The scheduling priority of the new thread.
-         */
-        posix_threads_t(uni_processor_t * proc,
-                        const std::string & thread_scheduler,
-                        int thread_priority)
-            : thread_platform_t(proc)
-        {
-            pthread_mutex_init(&mutex, 0);
-            pthread_cond_init(&kick_condition, 0);
-            pthread_cond_init(&catch_condition, 0);
-            kicked = processing_done = termination_request = false;
-            bool setting_attributes =
-                thread_priority != INVALID_THREAD_PRIORITY;
-            if (setting_attributes) {
-                pthread_attr_init(&attr);
-                if (thread_scheduler == "SCHED_OTHER")
-                    pthread_attr_setschedpolicy(&attr, scheduler = SCHED_OTHER);
-                else if (thread_scheduler == "SCHED_RR")
-                    pthread_attr_setschedpolicy(&attr, scheduler = SCHED_RR);
-                else if (thread_scheduler == "SCHED_FIFO")
-                    pthread_attr_setschedpolicy(&attr, scheduler = SCHED_FIFO);
-                else
-                    setting_attributes = false;
-            }
-            if (setting_attributes) {
-                priority.sched_priority = thread_priority;
-                pthread_attr_setschedparam(&attr, &priority);
-            }
-            pthread_create(&thread,
-                           (setting_attributes ? &attr : NULL),
-                           &posix_threads_t::thread_start,
-                           this);
-            if (setting_attributes) {
-                pthread_setschedparam(thread, scheduler, &priority);
-            }
-            catch_thread(); // wait for thread to become ready.
-        }
-        /// Terminate thread
-        ~posix_threads_t() {
-            pthread_mutex_lock(&mutex);
-            termination_request = true;
-            pthread_cond_signal(&kick_condition);
-            pthread_mutex_unlock(&mutex);
-            pthread_join(thread, 0);
-        }
-        /// Thread start function
-        static void * thread_start(void * thr) {
-            static_cast<posix_threads_t *>(thr)->main();
-            return 0;
-        };
-        /// Thread main loop.  Wait for process/termination trigger, then act.
-        void main() {
-            for(;;) {
-                pthread_mutex_lock(&mutex);
-                processing_done = true;
-                pthread_cond_signal(&catch_condition);
-                while (!kicked && !termination_request)
-                    pthread_cond_wait(&kick_condition, &mutex);
-                kicked = false;
-                pthread_mutex_unlock(&mutex);
-                if (termination_request) return;
-                processor->process();
+                pthread_t thread = workers.back().native_handle();
+                if (thread_priority != INVALID_THREAD_PRIORITY) {
+                    struct sched_param priority;
+                    priority.sched_priority = thread_priority;
+                    if (thread_scheduler == "SCHED_RR")
+                        pthread_setschedparam(thread, SCHED_RR, &priority);
+                    else if (thread_scheduler == "SCHED_FIFO")
+                        pthread_setschedparam(thread, SCHED_FIFO, &priority);
+                    else if (thread_scheduler == "SCHED_OTHER")
+                        pthread_setschedparam(thread, SCHED_OTHER, &priority);
+                }
+#ifdef __linux__
+                if (cpus.size()) {
+                    cpu_set_t cpuset;
+                    CPU_ZERO(&cpuset);
+                    CPU_SET(cpus[k % cpus.size()], &cpuset);
+                    if (pthread_setaffinity_np(thread, sizeof(cpuset), &cpuset))
+                        throw MHA_Error(__FILE__,__LINE__,
+                                        "Cannot pin worker thread to CPU %d",
+                                        cpus[k % cpus.size()]);
+                }
+#endif
+#else
+                (void)thread_scheduler;
+                (void)thread_priority;
+#endif
             }
+        } catch (...) {
+            stop();
+            throw;
         }
-        static std::string current_thread_scheduler()
-        {
-            struct sched_param priority;
-            int policy;
-            pthread_getschedparam(pthread_self(), &policy, &priority);
-            if (policy == SCHED_RR)
-                return "SCHED_RR";
-            if (policy == SCHED_FIFO)
-                return "SCHED_FIFO";
-            return "SCHED_OTHER";
-        }
-            
-        static int current_thread_priority()
-        {
-            struct sched_param priority;
-            int policy;
-            pthread_getschedparam(pthread_self(), &policy, &priority);
-            return priority.sched_priority;
-        }
-    };
+#if !(defined(posixthreads) && defined(__linux__))
+        (void)cpus;
 #endif
+    }
 
-#ifdef win32threads
-    /** Windows threads implementation of thread platform */
-    class win32_threads_t : public thread_platform_t {
-        /// The Event for signalling the kicking
-        HANDLE kick_event;
-        /// The condition for signalling the processing is finished.
-        HANDLE catch_event;
-        /// The Event for signalling termination.
-        HANDLE termination_event;
-        /// win32 thread priority
-        long priority;
-        /// The thread object
-        HANDLE thread;
-    public:
-        /// Start signal processing in separate thread.
-        void kick_thread() {
-            SetEvent(kick_event);
-        }
-        /// Wait for signal processing to finish.
-        void catch_thread() {
-            WaitForSingleObject(catch_event, INFINITE);
-        }
-        /// Constructor.
-        /// @param proc  Pointer to the associated signal processor
-        /// @param thread_scheduler not used for win32 threads
-        /// @param thread_priority Thread priority for worker thread as
-        ///                        specified by MHA configuration.
-        win32_threads_t(uni_processor_t * proc,
-                        const std::string & thread_scheduler,
-                        int thread_priority)
-            : thread_platform_t(proc)
-        {
-            (void)thread_scheduler;
-            kick_event = CreateEvent(0, false, false, 0);
-            if (kick_event == 0)
-                throw MHA_ErrorMsg("Cannot create win32 Event (kick_event)");
-            catch_event = CreateEvent(0, false, false, 0);
-            if (catch_event == 0) {
-                CloseHandle(kick_event);
-                kick_event = 0;
-                throw MHA_ErrorMsg("Cannot create win32 Event (catch_event)");
-            }
-            termination_event = CreateEvent(0, false, false, 0);
-            if (termination_event == 0) {
-                CloseHandle(kick_event);
-                kick_event = 0;
-                CloseHandle(catch_event);
-                catch_event = 0;
-                throw MHA_ErrorMsg("Cannot create win32 Event"
-                                   " (termination_event)");
-            }
-            bool setting_priority =
-                thread_priority != INVALID_THREAD_PRIORITY;
-            thread = CreateThread(0,0,
-                                  win32_threads_t::thread_start, this,
-                                  0,0);
-            if (thread == 0) {
-                CloseHandle(kick_event);
-                kick_event = 0;
-                CloseHandle(catch_event);
-                catch_event = 0;
-                CloseHandle(termination_event);
-                termination_event = 0;
-                throw MHA_ErrorMsg("Cannot create win32 thread");
-            }
-            if (setting_priority) {
-                if (SetThreadPriority(thread, thread_priority)
-                    == ((BOOL)0)) {
-                    SetEvent(termination_event);
-                    WaitForSingleObject(thread,100);
-                    CloseHandle(kick_event);
-                    kick_event = 0;
-                    CloseHandle(catch_event);
-                    catch_event = 0;
-                    CloseHandle(termination_event);
-                    termination_event = 0;
-                    CloseHandle(thread);
-                    thread = 0;
-                    throw MHA_ErrorMsg("Cannot set priority of win32 thread");
-                }
-            }
-            catch_thread(); // wait for thread to become ready.
-        }
-        /// Terminate thread
-        ~win32_threads_t() {
-            if (termination_event)
-                SetEvent(termination_event);
-            if (thread)
-                WaitForSingleObject(thread,100);
-            if (kick_event)
-                CloseHandle(kick_event);
-            kick_event = 0;
-            if (catch_event)
-                CloseHandle(catch_event);
-            catch_event = 0;
-            if (termination_event)
-                CloseHandle(termination_event);
-            termination_event = 0;
-            if (thread)
-                CloseHandle(thread);
-            thread = 0;
-         }
-        /// Thread start function
-        static DWORD WINAPI thread_start(void * thr) {
-            static_cast<win32_threads_t *>(thr)->main();
-            return 0;
-        };
-        /// Thread main loop.  Wait for process/termination trigger, then act.
-        void main() {
-            HANDLE events[2];
-            events[0] = kick_event;
-            events[1] = termination_event;
-            for(;;) {
-                SetEvent(catch_event);
-                DWORD wait_result = 
-                    WaitForMultipleObjects(2,events,false,INFINITE);
-                if (wait_result == WAIT_OBJECT_0)
-                    processor->process();
-                else
-                    return;
-            }
+    bool worker_pool_t::submit(pool_threads_t * task)
+    {
+        if (!queue.push(task))
+            return false;
+        pending.fetch_add(1U);
+        // A worker increments sleepers before checking pending, therefore
+        // either it sees the new task or we see the sleeping worker.
+        if (sleepers.load() > 0U) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeup.notify_one();
         }
-        static std::string current_thread_scheduler()
+        return true;
+    }
+
+    bool worker_pool_t::run_one()
+    {
+        pool_threads_t * task = queue.pop();
+        if (task == nullptr)
+            return false;
+        pending.fetch_sub(1U);
+        task->try_run();
+        return true;
+    }
+
+    void worker_pool_t::stop()
+    {
         {
-            return "SCHED_OTHER";
+            std::lock_guard<std::mutex> lock(mutex);
+            termination_request = true;
         }
-        
-        static int current_thread_priority()
-        {
-            return GetThreadPriority(GetCurrentThread());
+        wakeup.notify_all();
+        for (auto & worker : workers)
+            if (worker.joinable())
+                worker.join();
+        workers.clear();
+        while (queue.pop())
+            pending.fetch_sub(1U);
+    }
+
+    void worker_pool_t::worker_main()
+    {
+        while (!termination_request.load()) {
+            if (run_one())
+                continue;
+            const auto spin_end = std::chrono::steady_clock::now() + spin_time;
+            while (pending.load() == 0U && !termination_request.load() &&
+                   std::chrono::steady_clock::now() < spin_end)
+                cpu_relax();
+            if (pending.load() > 0U)
+                continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            sleepers.fetch_add(1U);
+            wakeup.wait(lock, [this]{return termination_request.load() ||
+                                        pending.load() > 0U;});
+            sleepers.fetch_sub(1U);
         }
-    };
-#endif
+    }
 
     /// Handles domain-specific partial input and output signal.
     class domain_handler_t : public uni_processor_t {
@@ -427,6 +159,9 @@ namespace MHAPlugin_Split {
         mha_spec_t ** spec_out;
         /// The domain-specific signal processing methods are implemented here.
         PluginLoader::fourway_processor_t * processor;
+        /// Duration of the most recent process() call in seconds.  Written
+        /// by the processing thread, read after thread_platform_t::catch_thread.
+        float process_time;
 
         /// Set parameters of input signal
         /// @param settings_in domain and dimensions of partial input signal
@@ -472,7 +207,8 @@ namespace MHAPlugin_Split {
         domain_handler_t(const mhaconfig_t & settings_in,
                          const mhaconfig_t & settings_out,
                          PluginLoader::fourway_processor_t * processor)
-            : wave_in(0), wave_out(0), spec_in(0), spec_out(0)
+            : wave_in(0), wave_out(0), spec_in(0), spec_out(0),
+              process_time(0.0f)
         {
             set_input_domain(settings_in);
             set_output_domain(settings_out);
@@ -617,8 +353,17 @@ namespace MHAPlugin_Split {
         /** Call the processing method of the processor with
          * configured input/output signal domains.  The input signal
          * has to be stored using #put_signal before this method may
-         * be called. */
+         * be called.  Measures the processing time. */
         void process()
+        {
+            const auto start = std::chrono::steady_clock::now();
+            process_domains();
+            process_time = std::chrono::duration<float>
+                (std::chrono::steady_clock::now() - start).count();
+        }
+
+        /// Dispatch to the processing method matching the configured domains.
+        void process_domains()
         {
             if (wave_in && !spec_in && wave_out && !spec_out)
                 processor->process(wave_in, wave_out);
@@ -667,7 +412,8 @@ namespace MHAPlugin_Split {
         void prepare(mhaconfig_t & signal_parameters,
                      const std::string & thread_platform,
                      const std::string & thread_scheduler,
-                     int thread_priority);
+                     int thread_priority,
+                     worker_pool_t * pool = nullptr);
 
         /** Delegates the release method to the plugin and deletes the
          * MHAPlugin_Split::domain_handler_t instance. */
@@ -676,6 +422,11 @@ namespace MHAPlugin_Split {
         /** Delegates parser incovation to plugin */
         std::string parse(const std::string & str) {return plug->parse(str);}
 
+        /** Duration of the latest processing of this branch in seconds.
+         * Valid after collect_result. */
+        float get_process_time() const
+        {return domain ? domain->process_time : 0.0f;}
+
         /** The domain handler copies the input signal channels.  Then,
          * processing is initiated.
          * @param s_in
@@ -759,7 +510,7 @@ namespace MHAPlugin_Split {
      *   The signal description parameters for this path. 
      * @param thread_platform 
      *   The name of the thread platform to use. Possible values:
-     *   "posix", "win32", "dummy". 
+     *   "posix", "win32", "dummy", "pool". 
      * @param thread_scheduler
      *   The name of the scheduler to use. Posix threads support 
      *   "SCHED_OTHER", "SCHED_RR", "SCHED_FIFO".  The other thread
@@ -767,17 +518,23 @@ namespace MHAPlugin_Split {
      *   This value is not used for platforms other than "posix".
      * @param thread_priority
      *   The new thread priority. Interpretation and permitted range
-     *   depend on the thread platform and possibly on the scheduler. */
+     *   depend on the thread platform and possibly on the scheduler.
+     * @param pool
+     *   The worker pool executing the processing when thread_platform
+     *   is "pool". */
     void splitted_part_t::prepare(mhaconfig_t& signal_parameters,
                                   const std::string & thread_platform,
                                   const std::string & thread_scheduler,
-                                  int thread_priority)
+                                  int thread_priority,
+                                  worker_pool_t * pool)
     {
         mhaconfig_t settings_in = signal_parameters;
         plug->prepare(signal_parameters);
         mhaconfig_t settings_out = signal_parameters;
         domain = new domain_handler_t(settings_in, settings_out, plug);
         if (false) {}
+        else if (thread_platform == "pool" && pool)
+            thread = new pool_threads_t(domain, pool);
 #if posixthreads
         else if (thread_platform == "posix")
             thread =
@@ -849,9 +606,21 @@ namespace MHAPlugin_Split {
         MHAParser::string_mon_t framework_thread_scheduler;
         /// Priority of signal processing thread
         MHAParser::int_mon_t framework_thread_priority;
+        /// Number of worker threads of the thread pool
+        MHAParser::int_t pool_threads;
+        /// CPU cores for pinning the worker threads of the thread pool
+        MHAParser::vint_t pool_cpus;
+        /// Spinning time of idle workers of the thread pool
+        MHAParser::int_t pool_spin_time;
         /// Switch to activate parallel processing of plugins at the cost
         /// of one block of additional delay
         MHAParser::bool_t delay;
+        /// Processing time of each branch in the latest block
+        MHAParser::vfloat_mon_t process_time;
+        /// Maximum processing time of each branch since prepare
+        MHAParser::vfloat_mon_t process_time_max;
+        /// Shared worker threads when thread_platform is "pool"
+        std::unique_ptr<worker_pool_t> pool;
         /// Interfaces to parallel plugins
         std::vector<splitted_part_t*> chains;
         /// Combined output waveforms structure
@@ -893,9 +662,11 @@ namespace MHAPlugin_Split {
                           "\"posix\" is the native Linux and macOS thread platform,\n"
                           "\"win32\" is the native thread platform on windows,\n"
                           "\"dummy\" means that all processing is performed in a"
-                          " single thread.",
+                          " single thread,\n"
+                          "\"pool\" processes the channel groups as tasks of a pool of"
+                          " worker threads.",
                           "dummy",
-                          "[posix win32 dummy]"),
+                          "[posix win32 dummy pool]"),
           worker_thread_scheduler("Scheduler used for worker threads."
                                   " Only used for posix threads.\n"
                                   "Suggested setting is: The same as present"
@@ -922,10 +693,31 @@ namespace MHAPlugin_Split {
                                     " thread.\n"
                                     "Only valid after first signal processing"
                                     " callback."),
+          pool_threads("Number of worker threads for thread_platform=pool.\n"
+                       "0 starts one thread less than the number of CPU cores.\n"
+                       "The processing thread executes tasks as well while it"
+                       " waits for the workers.",
+                       "0","[0,]"),
+          pool_cpus("CPU cores for pinning the worker threads for"
+                    " thread_platform=pool.\n"
+                    "Worker k is pinned to pool_cpus[k modulo the number of"
+                    " entries].\n"
+                    "Empty: No pinning.  Only supported on Linux.",
+                    "[]","[0,["),
+          pool_spin_time("Time in microseconds that idle worker threads of"
+                         " the pool spin before\n"
+                         "they sleep, and that the processing thread spins"
+                         " before sleeping\n"
+                         "while it waits for the workers.",
+                         "500","[0,]"),
           delay("activates processing of contained"
                 " plugins outside of the calling processing\n"
                 "thread at the cost of one block\n"
                 "additional delay","no"),
+          process_time("Processing time of each channel group in the latest"
+                       " block / s"),
+          process_time_max("Maximum processing time of each channel group"
+                           " since prepare / s"),
           wave_out(NULL),
           spec_out(NULL)
     {
@@ -937,7 +729,12 @@ namespace MHAPlugin_Split {
         insert_item("worker_thread_priority", &worker_thread_priority);
         insert_item("framework_thread_scheduler", &framework_thread_scheduler);
         insert_item("framework_thread_priority", &framework_thread_priority);
+        insert_member(pool_threads);
+        insert_member(pool_cpus);
+        insert_member(pool_spin_time);
         insert_member(delay);
+        insert_member(process_time);
+        insert_member(process_time_max);
         framework_thread_scheduler.data =
             worker_thread_scheduler.data.get_value();
         framework_thread_priority.data = worker_thread_priority.data;
@@ -985,6 +782,14 @@ namespace MHAPlugin_Split {
                             signal_parameters.channels);
         // End check parameters
         
+        if (thread_platform.data.get_value() == "pool")
+            pool = std::make_unique<worker_pool_t>
+                (pool_threads.data, pool_cpus.data, pool_spin_time.data,
+                 worker_thread_scheduler.data.get_value(),
+                 worker_thread_priority.data);
+        process_time.data.assign(chains.size(), 0.0f);
+        process_time_max.data.assign(chains.size(), 0.0f);
+
         // Begin prepare plugins
         mhaconfig_t chain_signal_parameters;
         mhaconfig_t signal_parameters_in = signal_parameters;
@@ -998,7 +803,8 @@ namespace MHAPlugin_Split {
                 chains[i]->prepare(chain_signal_parameters,
                                    thread_platform.data.get_value(),
                                    worker_thread_scheduler.data.get_value(),
-                                   worker_thread_priority.data);
+                                   worker_thread_priority.data,
+                                   pool.get());
                 prepared_plugins =  i + 1;
                 unsigned channels_out = chain_signal_parameters.channels;
                 total_channels_out += channels_out;
@@ -1018,6 +824,8 @@ namespace MHAPlugin_Split {
             }
         }
         catch(...) {
+            if (pool)
+                pool->stop();
             for(unsigned int k=0; k < prepared_plugins;k++){
                 try{
                     chains[k]->release();
@@ -1025,6 +833,7 @@ namespace MHAPlugin_Split {
                 catch(...){
                 }
             }
+            pool.reset();
             throw;
         }
         // End prepare plugins
@@ -1078,6 +887,10 @@ namespace MHAPlugin_Split {
         channels.setlock(false);
         algos.setlock(false);
 
+        // Workers must not access the tasks of the released chains
+        if (pool)
+            pool->stop();
+
         // Begin release plugins and delete signal holders/pointers
         MHA_Error * lasterr = 0;
         for (unsigned i=0; i < chains.size(); i++) {
@@ -1103,6 +916,7 @@ namespace MHAPlugin_Split {
         wave_out = 0;
         delete spec_out;
         spec_out = 0;
+        pool.reset();
         // End release plugins and delete signal holders/pointers
 
         if (lasterr) {
@@ -1134,6 +948,10 @@ namespace MHAPlugin_Split {
         unsigned ch_global, chain;
         for (ch_global = chain = 0; chain < chains.size(); ++chain) {
             ch_global += chains[chain]->collect_result(s_out, ch_global);
+            process_time.data[chain] = chains[chain]->get_process_time();
+            process_time_max.data[chain] =
+                std::max(process_time_max.data[chain],
+                         process_time.data[chain]);
         }
         if (ch_global != s_out->num_channels)
             throw MHA_ErrorMsg("Too few output channels from plugins");
@@ -1205,6 +1023,21 @@ MHAPLUGIN_DOCUMENTATION\
  "Set \\texttt{thread\\_platform} to \\texttt{win32} on \\Windows{}\n"
  "systems, or to \\texttt{posix} on \\Linux{} and \\macOS.\n"
  "\n"
+ "The \\texttt{posix} and \\texttt{win32} thread platforms start one thread\n"
+ "per chain and wake it up for every audio block.  With more chains than\n"
+ "CPU cores, the context switches can take a significant part of the\n"
+ "processing time.  The thread platform \\texttt{pool} instead executes\n"
+ "the chains as tasks of a pool of \\texttt{pool\\_threads} worker threads,\n"
+ "which receive the tasks through a lock-free queue.  Idle workers spin\n"
+ "for \\texttt{pool\\_spin\\_time} microseconds before they sleep.  The\n"
+ "processing thread of the framework executes queued tasks itself while\n"
+ "it waits for the results.  On \\Linux{}, the workers can be pinned to\n"
+ "CPU cores with \\texttt{pool\\_cpus}.\n"
+ "\n"
+ "The processing time of each chain is shown in the monitor variables\n"
+ "\\texttt{process\\_time} (latest block) and \\texttt{process\\_time\\_max}\n"
+ "(maximum since prepare).\n"
+ "\n"
  "For real-time processing scenarios, it is important to set up the worker\n"
  "threads' schedulers and priorities to a reasonable value so that they\n"
  "neither starve upstream production or downstream consumption of the\n"
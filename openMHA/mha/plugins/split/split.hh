@@ -0,0 +1,668 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2007 2008 2009 2010 2013 2012 2014 2015 2016 2018 HörTech gGmbH
+// Copyright © 2019 2021 HörTech gGmbH
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License, 
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+/** @internal @file split.hh Thread platforms and worker pool of the
+ * split plugin.
+ */
+
+#include <typeinfo>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "mha_algo_comm.hh"
+#include "mha_multisrc.h"
+#include "mhapluginloader.h"
+
+#ifdef _WIN32
+#define win32threads 1
+#define native_thread_platform_type win32_threads_t
+#else
+#define posixthreads 1
+#include <pthread.h>
+#include <sched.h>
+#define native_thread_platform_type posix_threads_t
+#endif
+
+// forward declaration of test classes
+class Test_splitted_part_t;
+
+/** \internal
+ * A namespace for the split plugin.  Helps testability and documentation. */
+namespace MHAPlugin_Split {
+
+    /// Invalid thread priority
+    enum {INVALID_THREAD_PRIORITY = 999999999};
+
+    /** An interface to a class that sports a process method with no
+     * parameters and no return value.  No signal transfer occurs
+     * through this interface, because the signal transfer is
+     * performed in another thread than the processing. */
+    class uni_processor_t {
+    public:
+        /** This method uses some input signal, performs processing
+         * and stores the output signal somewhere.  This method also
+         * has to dispatch the process call based on the configured
+         * domains.
+         *
+         * Signal transfer and domain configuration have to be done in
+         * derived class in different methods. */
+        virtual void process() = 0;
+        /// Classes containing virtual methods need virtual destructors.
+        virtual ~uni_processor_t() {}
+    };
+
+    /** Basic interface for encapsulating thread creation, thread
+     * priority setting, and synchronization on any threading platform
+     * (i.e., pthreads or win32threads).
+     * Derived classes specialize in the actual thread platform.
+     */
+    class thread_platform_t {
+    private:
+        /// Disallow copy constructor
+        thread_platform_t(const thread_platform_t &);
+        /// Disallow assignment operator
+        thread_platform_t & operator=(const thread_platform_t &);
+    protected:
+        /// A pointer to the plugin loader that processes the sound
+        /// data in the channels for which this thread was created.
+        /// Using the MHAPlugin_Split::uni_processor_t interface
+        /// instead of the mhapluginloader class directly for
+        /// testability (no need to load real plugins for testing the
+        /// thread platform).
+        uni_processor_t * processor;
+    public:
+        /// Constructor. Derived classes create the thread in the constructor.
+        /// @param proc  Pointer to the associated plugin loader.
+        ///   This plugin loader has to live at least as long as this
+        ///   instance.  This instance does not take possession of the
+        ///   plugin loader.  In production code, this thread platform
+        ///   and the plugin loader are both created and destroyed by
+        ///   the MHAPlugin_Split::splitted_part_t instance.
+        thread_platform_t(uni_processor_t * proc)
+            : processor(proc)
+        {}
+
+        /// Make derived classes destructable via pointer to this base
+        /// class.  Derived classes' destructors notify the thread
+        /// that it should terminate itself, and wait for the
+        /// termination to occur.
+        virtual ~thread_platform_t(){}
+        
+        /// Derived classes notify their processing thread that it should call
+        /// processor->process().
+        virtual void kick_thread() = 0;
+
+        /// Derived classes wait for their signal processing thread to
+        /// return from the call to part->process().
+        virtual void catch_thread() = 0;
+    };
+
+    /** Dummy specification of a thread platform: This class
+     * implements everything in a single thread. */
+    class dummy_threads_t : public thread_platform_t {
+    public:
+        /// perform signal processing immediately (no multiple threads
+        /// in this dummy class)
+        void kick_thread() {processor->process();}
+        /// No implementation needed: Processing has been completed
+        /// during ummy_threads_t::kick_thread.
+        void catch_thread() {}
+        /// Constructor.
+        /// @param proc  Pointer to the associated plugin loader
+        /// @param thread_scheduler
+        ///   Unused in dummy thread platform
+        /// @param thread_priority
+        ///   Unused in dummy thread platform
+        dummy_threads_t(uni_processor_t * proc,
+                        const std::string & thread_scheduler,
+                        int thread_priority)
+            : thread_platform_t(proc)
+        {
+            (void) thread_scheduler;
+            (void) thread_priority;
+        }
+    };
+
+#ifdef posixthreads
+    /** Posix threads specification of thread platform */
+    class posix_threads_t : public thread_platform_t {
+        /// The mutex.
+        pthread_mutex_t mutex;
+        /// The condition for signalling the kicking and termination.
+        pthread_cond_t kick_condition;
+        /// The condition for signalling the processing is finished.
+        pthread_cond_t catch_condition;
+        /// Thread attributes
+        pthread_attr_t attr;
+        /// Thread scheduling priority
+        struct sched_param priority;
+        int scheduler;
+        /// The thread object
+        pthread_t thread;
+        /** A flag that is set to true by kick_thread and to false by
+         * the thread after it has woken up from the kicking. */
+        bool kicked;
+        /** A flag that is set to true by the thread when it returns
+         * from processing and to false by catch_thread after it has
+         * waited for that return. */
+        bool processing_done;
+        /** Set to true by the destructor. */
+        bool termination_request;
+    public:
+        /// Start signal processing in separate thread.
+        void kick_thread() {
+            if (kicked != false) throw MHA_ErrorMsg("synchronization error");
+            pthread_mutex_lock(&mutex);
+            kicked = true;
+            pthread_cond_signal(&kick_condition);
+            pthread_mutex_unlock(&mutex);
+        }
+        /// Wait for signal processing to finish.
+        void catch_thread() {
+            pthread_mutex_lock(&mutex);
+            while ( ! processing_done )
+                pthread_cond_wait(&catch_condition, &mutex);
+            processing_done = false;
+            pthread_mutex_unlock(&mutex);
+        }
+        /** Constructor.
+         * @param proc
+         *   Pointer to the associated signal processor instance
+         * @param thread_scheduler
+         *   A string describing the posix thread scheduler. Possible values:
+         *   "SCHED_OTHER", "SCHED_RR", "SCHED_FIFO".
+         * @param thread_priority
+         *   The scheduling priority of the new thread.
+         */
+        posix_threads_t(uni_processor_t * proc,
+                        const std::string & thread_scheduler,
+                        int thread_priority)
+            : thread_platform_t(proc)
+        {
+            pthread_mutex_init(&mutex, 0);
+            pthread_cond_init(&kick_condition, 0);
+            pthread_cond_init(&catch_condition, 0);
+            kicked = processing_done = termination_request = false;
+            bool setting_attributes =
+                thread_priority != INVALID_THREAD_PRIORITY;
+            if (setting_attributes) {
+                pthread_attr_init(&attr);
+                if (thread_scheduler == "SCHED_OTHER")
+                    pthread_attr_setschedpolicy(&attr, scheduler = SCHED_OTHER);
+                else if (thread_scheduler == "SCHED_RR")
+                    pthread_attr_setschedpolicy(&attr, scheduler = SCHED_RR);
+                else if (thread_scheduler == "SCHED_FIFO")
+                    pthread_attr_setschedpolicy(&attr, scheduler = SCHED_FIFO);
+                else
+                    setting_attributes = false;
+            }
+            if (setting_attributes) {
+                priority.sched_priority = thread_priority;
+                pthread_attr_setschedparam(&attr, &priority);
+            }
+            pthread_create(&thread,
+                           (setting_attributes ? &attr : NULL),
+                           &posix_threads_t::thread_start,
+                           this);
+            if (setting_attributes) {
+                pthread_setschedparam(thread, scheduler, &priority);
+            }
+            catch_thread(); // wait for thread to become ready.
+        }
+        /// Terminate thread
+        ~posix_threads_t() {
+            pthread_mutex_lock(&mutex);
+            termination_request = true;
+            pthread_cond_signal(&kick_condition);
+            pthread_mutex_unlock(&mutex);
+            pthread_join(thread, 0);
+        }
+        /// Thread start function
+        static void * thread_start(void * thr) {
+            static_cast<posix_threads_t *>(thr)->main();
+            return 0;
+        };
+        /// Thread main loop.  Wait for process/termination trigger, then act.
+        void main() {
+            for(;;) {
+                pthread_mutex_lock(&mutex);
+                processing_done = true;
+                pthread_cond_signal(&catch_condition);
+                while (!kicked && !termination_request)
+                    pthread_cond_wait(&kick_condition, &mutex);
+                kicked = false;
+                pthread_mutex_unlock(&mutex);
+                if (termination_request) return;
+                processor->process();
+            }
+        }
+        static std::string current_thread_scheduler()
+        {
+            struct sched_param priority;
+            int policy;
+            pthread_getschedparam(pthread_self(), &policy, &priority);
+            if (policy == SCHED_RR)
+                return "SCHED_RR";
+            if (policy == SCHED_FIFO)
+                return "SCHED_FIFO";
+            return "SCHED_OTHER";
+        }
+            
+        static int current_thread_priority()
+        {
+            struct sched_param priority;
+            int policy;
+            pthread_getschedparam(pthread_self(), &policy, &priority);
+            return priority.sched_priority;
+        }
+    };
+#endif
+
+#ifdef win32threads
+    /** Windows threads implementation of thread platform */
+    class win32_threads_t : public thread_platform_t {
+        /// The Event for signalling the kicking
+        HANDLE kick_event;
+        /// The condition for signalling the processing is finished.
+        HANDLE catch_event;
+        /// The Event for signalling termination.
+        HANDLE termination_event;
+        /// win32 thread priority
+        long priority;
+        /// The thread object
+        HANDLE thread;
+    public:
+        /// Start signal processing in separate thread.
+        void kick_thread() {
+            SetEvent(kick_event);
+        }
+        /// Wait for signal processing to finish.
+        void catch_thread() {
+            WaitForSingleObject(catch_event, INFINITE);
+        }
+        /// Constructor.
+        /// @param proc  Pointer to the associated signal processor
+        /// @param thread_scheduler not used for win32 threads
+        /// @param thread_priority Thread priority for worker thread as
+        ///                        specified by MHA configuration.
+        win32_threads_t(uni_processor_t * proc,
+                        const std::string & thread_scheduler,
+                        int thread_priority)
+            : thread_platform_t(proc)
+        {
+            (void)thread_scheduler;
+            kick_event = CreateEvent(0, false, false, 0);
+            if (kick_event == 0)
+                throw MHA_ErrorMsg("Cannot create win32 Event (kick_event)");
+            catch_event = CreateEvent(0, false, false, 0);
+            if (catch_event == 0) {
+                CloseHandle(kick_event);
+                kick_event = 0;
+                throw MHA_ErrorMsg("Cannot create win32 Event (catch_event)");
+            }
+            termination_event = CreateEvent(0, false, false, 0);
+            if (termination_event == 0) {
+                CloseHandle(kick_event);
+                kick_event = 0;
+                CloseHandle(catch_event);
+                catch_event = 0;
+                throw MHA_ErrorMsg("Cannot create win32 Event"
+                                   " (termination_event)");
+            }
+            bool setting_priority =
+                thread_priority != INVALID_THREAD_PRIORITY;
+            thread = CreateThread(0,0,
+                                  win32_threads_t::thread_start, this,
+                                  0,0);
+            if (thread == 0) {
+                CloseHandle(kick_event);
+                kick_event = 0;
+                CloseHandle(catch_event);
+                catch_event = 0;
+                CloseHandle(termination_event);
+                termination_event = 0;
+                throw MHA_ErrorMsg("Cannot create win32 thread");
+            }
+            if (setting_priority) {
+                if (SetThreadPriority(thread, thread_priority)
+                    == ((BOOL)0)) {
+                    SetEvent(termination_event);
+                    WaitForSingleObject(thread,100);
+                    CloseHandle(kick_event);
+                    kick_event = 0;
+                    CloseHandle(catch_event);
+                    catch_event = 0;
+                    CloseHandle(termination_event);
+                    termination_event = 0;
+                    CloseHandle(thread);
+                    thread = 0;
+                    throw MHA_ErrorMsg("Cannot set priority of win32 thread");
+                }
+            }
+            catch_thread(); // wait for thread to become ready.
+        }
+        /// Terminate thread
+        ~win32_threads_t() {
+            if (termination_event)
+                SetEvent(termination_event);
+            if (thread)
+                WaitForSingleObject(thread,100);
+            if (kick_event)
+                CloseHandle(kick_event);
+            kick_event = 0;
+            if (catch_event)
+                CloseHandle(catch_event);
+            catch_event = 0;
+            if (termination_event)
+                CloseHandle(termination_event);
+            termination_event = 0;
+            if (thread)
+                CloseHandle(thread);
+            thread = 0;
+         }
+        /// Thread start function
+        static DWORD WINAPI thread_start(void * thr) {
+            static_cast<win32_threads_t *>(thr)->main();
+            return 0;
+        };
+        /// Thread main loop.  Wait for process/termination trigger, then act.
+        void main() {
+            HANDLE events[2];
+            events[0] = kick_event;
+            events[1] = termination_event;
+            for(;;) {
+                SetEvent(catch_event);
+                DWORD wait_result = 
+                    WaitForMultipleObjects(2,events,false,INFINITE);
+                if (wait_result == WAIT_OBJECT_0)
+                    processor->process();
+                else
+                    return;
+            }
+        }
+        static std::string current_thread_scheduler()
+        {
+            return "SCHED_OTHER";
+        }
+        
+        static int current_thread_priority()
+        {
+            return GetThreadPriority(GetCurrentThread());
+        }
+    };
+#endif
+
+    /// Busy-waiting hint to the CPU, used while spinning.
+    static inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    /** Bounded lock-free queue for multiple producers and multiple
+     * consumers (D. Vyukov's algorithm).  Each slot carries a sequence
+     * number which tells producers and consumers whether the slot is
+     * free or filled for their current turn.
+     * @tparam T The queue stores pointers to T. */
+    template <class T>
+    class mpmc_queue_t {
+        /// One queue entry
+        struct slot_t {
+            std::atomic<size_t> sequence;
+            T * data;
+        };
+        /// Storage, capacity is a power of two
+        std::unique_ptr<slot_t[]> slots;
+        /// capacity - 1
+        const size_t mask;
+        /// Position of the next push
+        alignas(64) std::atomic<size_t> head;
+        /// Position of the next pop
+        alignas(64) std::atomic<size_t> tail;
+    public:
+        /// Constructor.
+        /// @param capacity Maximum number of entries, must be a power of two.
+        explicit mpmc_queue_t(size_t capacity)
+            : slots(new slot_t[capacity]), mask(capacity - 1U),
+              head(0U), tail(0U)
+        {
+            if (capacity == 0U || (capacity & mask) != 0U)
+                throw MHA_Error(__FILE__,__LINE__,
+                                "Queue capacity %zu is not a power of two",
+                                capacity);
+            for (size_t i = 0; i < capacity; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        /// Append an entry.  Lock-free.
+        /// @return false if the queue is full.
+        bool push(T * data)
+        {
+            size_t pos = head.load(std::memory_order_relaxed);
+            for (;;) {
+                slot_t & slot = slots[pos & mask];
+                const size_t seq = slot.sequence.load(std::memory_order_acquire);
+                const intptr_t dif = intptr_t(seq) - intptr_t(pos);
+                if (dif == 0) {
+                    if (head.compare_exchange_weak(pos, pos + 1U,
+                                                   std::memory_order_relaxed)) {
+                        slot.data = data;
+                        slot.sequence.store(pos + 1U,
+                                            std::memory_order_release);
+                        return true;
+                    }
+                } else if (dif < 0)
+                    return false;
+                else
+                    pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        /// Remove the oldest entry.  Lock-free.
+        /// @return The entry, or nullptr if the queue is empty.
+        T * pop()
+        {
+            size_t pos = tail.load(std::memory_order_relaxed);
+            for (;;) {
+                slot_t & slot = slots[pos & mask];
+                const size_t seq = slot.sequence.load(std::memory_order_acquire);
+                const intptr_t dif = intptr_t(seq) - intptr_t(pos + 1U);
+                if (dif == 0) {
+                    if (tail.compare_exchange_weak(pos, pos + 1U,
+                                                   std::memory_order_relaxed)) {
+                        T * data = slot.data;
+                        slot.sequence.store(pos + mask + 1U,
+                                            std::memory_order_release);
+                        return data;
+                    }
+                } else if (dif < 0)
+                    return nullptr;
+                else
+                    pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    class pool_threads_t;
+
+    /** A pool of worker threads shared by all parallel branches of one
+     * split plugin.  Branches submit their processing as tasks through a
+     * lock-free queue.  Idle workers spin for a configurable time before
+     * they go to sleep, so that the next block of audio usually finds a
+     * worker awake.  The thread that waits for the results helps with
+     * the queued tasks before it sleeps, see pool_threads_t. */
+    class worker_pool_t {
+    public:
+        /** Start the worker threads.
+         * @param num_threads Number of worker threads.  0 starts one
+         *   worker less than the number of CPU cores, at least one.
+         * @param cpus CPU cores for pinning the workers.  Worker k is
+         *   pinned to cpus[k % cpus.size()].  Empty: no pinning.
+         *   Pinning is only implemented for Linux.
+         * @param spin_us Time in microseconds that idle workers spin
+         *   before going to sleep.
+         * @param thread_scheduler Scheduler of the workers, only used
+         *   for posix threads, see posix_threads_t.
+         * @param thread_priority Priority of the workers, only used for
+         *   posix threads. */
+        worker_pool_t(unsigned num_threads,
+                      const std::vector<int> & cpus,
+                      unsigned spin_us,
+                      const std::string & thread_scheduler,
+                      int thread_priority);
+        /// Stop the worker threads, see stop().
+        ~worker_pool_t() {stop();}
+        /** Queue a task for execution by a worker.  Lock-free, wakes a
+         * sleeping worker if there is one.
+         * @return false if the queue is full. */
+        bool submit(pool_threads_t * task);
+        /** Remove one task from the queue and execute it in the calling
+         * thread, unless it has already been executed.
+         * @return true if a task was removed from the queue. */
+        bool run_one();
+        /** Terminate and join the workers and discard queued tasks.
+         * Must be called before the tasks are destroyed. */
+        void stop();
+        /// Time that waiting threads spin before giving up the CPU.
+        const std::chrono::microseconds spin_time;
+    private:
+        /// Main loop of worker thread
+        void worker_main();
+        /// Queue of tasks to execute.  May contain outdated entries of
+        /// tasks that a waiting thread has already executed, these are
+        /// skipped by pool_threads_t::try_run.
+        mpmc_queue_t<pool_threads_t> queue;
+        /// Number of tasks in the queue.  Checked by workers before
+        /// going to sleep.
+        std::atomic<unsigned> pending;
+        /// Number of sleeping workers
+        std::atomic<unsigned> sleepers;
+        /// Set to terminate the workers
+        std::atomic<bool> termination_request;
+        /// Protects sleeping of workers
+        std::mutex mutex;
+        /// Wakes sleeping workers
+        std::condition_variable wakeup;
+        /// The worker threads
+        std::vector<std::thread> workers;
+    };
+
+    /** Thread platform executing the processing of one branch as a
+     * task of the shared worker_pool_t.  If no worker has started the
+     * task yet when catch_thread() is called, the calling thread executes
+     * it.  Otherwise it helps executing other queued tasks, spins for the
+     * spin time of the pool, and then sleeps until the thread executing
+     * the task signals that it has finished. */
+    class pool_threads_t : public thread_platform_t {
+    public:
+        /// Constructor.
+        /// @param proc The signal processor executed by this task.
+        /// @param pool The worker pool, must outlive this instance.
+        pool_threads_t(uni_processor_t * proc, worker_pool_t * pool)
+            : thread_platform_t(proc), pool(pool), state(IDLE),
+              sleeping(false)
+        {}
+        /// Queue the task.  Executes it immediately if the queue is full.
+        /// If the result of the previous block was not collected, e.g.
+        /// because another branch raised an error, waits for the
+        /// previous task to finish and discards its result.
+        void kick_thread() {
+            if (state.load(std::memory_order_acquire) != IDLE) {
+                wait_for_completion();
+                error.reset();
+            }
+            state.store(QUEUED, std::memory_order_release);
+            if (!pool->submit(this))
+                try_run();
+        }
+        /// Wait until the task is finished.
+        /// Rethrows exceptions from the processing.
+        void catch_thread() {
+            wait_for_completion();
+            if (error) {
+                MHA_Error e(*error);
+                error.reset();
+                throw e;
+            }
+        }
+        /** Execute the task if it is queued and no other thread has
+         * started it.  Called by workers and by waiting threads.
+         * @return true if the task was executed by the calling thread. */
+        bool try_run() {
+            int expected = QUEUED;
+            if (!state.compare_exchange_strong(expected, RUNNING,
+                                               std::memory_order_acq_rel))
+                return false;
+            try {
+                processor->process();
+            } catch (MHA_Error & e) {
+                error.reset(new MHA_Error(e));
+            }
+            // Sequentially consistent with the sleeping flag: either the
+            // waiting thread sees DONE, or we see that it sleeps
+            state.store(DONE);
+            if (sleeping.load()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                completion.notify_one();
+            }
+            return true;
+        }
+    private:
+        /// Execute the task or help with other tasks until it is finished,
+        /// then mark it idle.  Sleeps if the task is still running after
+        /// the spin time.
+        void wait_for_completion() {
+            try_run();
+            auto spin_end = std::chrono::steady_clock::now() + pool->spin_time;
+            while (state.load(std::memory_order_acquire) != DONE) {
+                if (pool->run_one())
+                    continue;
+                if (std::chrono::steady_clock::now() < spin_end) {
+                    cpu_relax();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                sleeping.store(true);
+                completion.wait(lock, [this]{return state.load() == DONE;});
+                sleeping.store(false);
+            }
+            state.store(IDLE, std::memory_order_relaxed);
+        }
+        /// Task states
+        enum {IDLE, QUEUED, RUNNING, DONE};
+        /// The pool executing this task
+        worker_pool_t * pool;
+        /// Current task state
+        std::atomic<int> state;
+        /// Exception thrown by the processing, rethrown by catch_thread
+        std::unique_ptr<MHA_Error> error;
+        /// Set while the thread waiting for the task sleeps
+        std::atomic<bool> sleeping;
+        /// Protects sleeping of the waiting thread
+        std::mutex mutex;
+        /// Wakes the waiting thread when the task is finished
+        std::condition_variable completion;
+    };
+} // namespace MHAPlugin_Split
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
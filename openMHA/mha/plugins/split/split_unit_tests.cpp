@@ -0,0 +1,116 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "split.hh"
+#include <memory>
+#include <vector>
+
+using namespace MHAPlugin_Split;
+
+namespace {
+    /** Counts its process calls, optionally blocks until released or
+     *  throws an MHA_Error. */
+    class counting_processor_t : public uni_processor_t {
+    public:
+        void process() override {
+            started.store(true);
+            while (!released.load())
+                std::this_thread::yield();
+            ++count;
+            if (fail)
+                throw MHA_Error(__FILE__, __LINE__, "processing failed");
+        }
+        std::atomic<unsigned> count{0U};
+        std::atomic<bool> fail{false};
+        std::atomic<bool> started{false};
+        std::atomic<bool> released{true};
+    };
+}
+
+TEST(split_pool, dispatches_every_task_once_per_block)
+{
+    worker_pool_t pool(3U, {}, 50U, "SCHED_OTHER", INVALID_THREAD_PRIORITY);
+    std::vector<counting_processor_t> processors(8U);
+    std::vector<std::unique_ptr<pool_threads_t>> tasks;
+    for (auto & processor : processors)
+        tasks.emplace_back(new pool_threads_t(&processor, &pool));
+    for (unsigned block = 1; block <= 200U; ++block) {
+        for (auto & task : tasks)
+            task->kick_thread();
+        for (auto & task : tasks)
+            task->catch_thread();
+        for (auto & processor : processors)
+            ASSERT_EQ(block, processor.count);
+    }
+    pool.stop();
+}
+
+TEST(split_pool, waiting_thread_sleeps_until_worker_finishes)
+{
+    // No spinning: the waiting thread sleeps at once
+    worker_pool_t pool(1U, {}, 0U, "SCHED_OTHER", INVALID_THREAD_PRIORITY);
+    counting_processor_t processor;
+    pool_threads_t task(&processor, &pool);
+    for (unsigned block = 1; block <= 5U; ++block) {
+        processor.started = false;
+        processor.released = false;
+        task.kick_thread();
+        // Make sure that the worker, not the waiting thread, executes it
+        while (!processor.started)
+            std::this_thread::yield();
+        std::thread releaser([&](){
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            processor.released = true;
+        });
+        task.catch_thread();
+        EXPECT_EQ(block, processor.count);
+        releaser.join();
+    }
+    pool.stop();
+}
+
+TEST(split_pool, rethrows_exception_of_worker)
+{
+    worker_pool_t pool(2U, {}, 50U, "SCHED_OTHER", INVALID_THREAD_PRIORITY);
+    counting_processor_t good, bad;
+    pool_threads_t good_task(&good, &pool), bad_task(&bad, &pool);
+    bad.fail = true;
+    good_task.kick_thread();
+    bad_task.kick_thread();
+    EXPECT_NO_THROW(good_task.catch_thread());
+    EXPECT_THROW(bad_task.catch_thread(), MHA_Error);
+    // The error is reported once, the task stays usable
+    bad.fail = false;
+    bad_task.kick_thread();
+    EXPECT_NO_THROW(bad_task.catch_thread());
+    EXPECT_EQ(2U, bad.count);
+    // An uncollected error is discarded by the next block
+    bad.fail = true;
+    bad_task.kick_thread();
+    while (bad.count < 3U)
+        std::this_thread::yield();
+    bad.fail = false;
+    bad_task.kick_thread();
+    EXPECT_NO_THROW(bad_task.catch_thread());
+    pool.stop();
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -15,6 +15,10 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "steerbf.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
 
 #define PATCH_VAR(var) patchbay.connect(&var.valuechanged, this, &steerbf::update_cfg)
 #define INSERT_PATCH(var) insert_member(var); PATCH_VAR(var)
@@ -29,14 +33,122 @@ steerbf_config::steerbf_config(MHA_AC::algo_comm_t & ac,
     //set nangle by counting/inferring number of blocks
     nangle( bf_vec.num_channels / nchan ),
     _steerbf( steerbf ), ac(ac),
-  bf_src_copy( steerbf->bf_src.data )
+  bf_src_copy( steerbf->bf_src.data ),
+  vars_resolved( false ),
+  has_steering( false ),
+  xfade_pos( 0 ),
+  xfade_len( 0 )
 {
+    name_vars( steerbf );
     //set the correct upper limit given data
     steerbf->angle_ind.set_max_angle_ind( nangle-1 );
 }
 
 steerbf_config::~steerbf_config() {}
 
+bool steerbf_config::reconfigure(const mhaconfig_t in_cfg, steerbf *steerbf)
+{
+    if ( in_cfg.channels != nchan || in_cfg.fftlen/2 + 1 != nfreq )
+        return false;
+    _steerbf = steerbf;
+    bf_src_copy = steerbf->bf_src.data;
+    name_vars( steerbf );
+    has_steering = false;
+    xfade_pos = 0;
+    xfade_len = 0;
+    clear( outSpec );
+    steerbf->angle_ind.set_max_angle_ind( nangle-1 );
+    return true;
+}
+
+void steerbf_config::name_vars(const steerbf *steerbf)
+{
+    bf_src_var = MHA_AC::var_handle_t{ bf_src_copy };
+    angle_src_var = MHA_AC::var_handle_t{ steerbf->angle_src.data };
+    angle_degree_var = MHA_AC::var_handle_t{ steerbf->angle_degree.data };
+    calibrate_north_var = MHA_AC::var_handle_t{ steerbf->calibrate_north.data };
+    head_angle_var = MHA_AC::var_handle_t{ steerbf->head_angle.data };
+    fix_beam_var = MHA_AC::var_handle_t{ steerbf->fix_beam.data };
+    vars_resolved = false;
+}
+
+void steerbf_config::resolve_vars()
+{
+    // AC variables may be published by plugins which are prepared
+    // after this one, the AC space is complete when processing starts
+    bf_src_var = ac.get_handle( bf_src_var.name );
+    for ( MHA_AC::var_handle_t * var : { &angle_src_var, &angle_degree_var,
+                                         &calibrate_north_var, &head_angle_var,
+                                         &fix_beam_var } )
+        if ( !var->name.empty() )
+            *var = ac.get_handle( var->name );
+    vars_resolved = true;
+}
+
+steering_t::steering_t(float ind, unsigned int nangle)
+    : lo( static_cast<unsigned int>(std::floor(ind)) ),
+      hi( std::min(lo + 1U, nangle - 1U) ),
+      frac( ind - lo )
+{
+    if ( hi == lo )
+        frac = 0.0f;
+}
+
+void steerbf_config::update_steering(const steering_t & target,
+                                     unsigned int xfade_frames)
+{
+    if ( !has_steering ) {
+        //nothing to crossfade from in the first block
+        previous = current = target;
+        has_steering = true;
+        return;
+    }
+    //a change during a crossfade takes effect when the running
+    //crossfade has finished, starting from the filters that are
+    //actually playing, so that the filters never jump
+    if ( xfade_pos < xfade_len || target == current )
+        return;
+    previous = current;
+    current = target;
+    xfade_pos = 0;
+    xfade_len = xfade_frames;
+}
+
+void steerbf_config::filter_and_sum(const mha_spec_t & inSpec)
+{
+    //gain of the current direction rises linearly during the crossfade
+    mha_real_t gain = 1.0f;
+    if ( xfade_pos < xfade_len ) {
+        ++xfade_pos;
+        gain = mha_real_t(xfade_pos) / (xfade_len + 1U);
+    }
+    //collect the filter blocks with non-zero gains
+    unsigned int blocks[MHASignal::conj_mac_mix_max_terms];
+    mha_real_t gains[MHASignal::conj_mac_mix_max_terms];
+    unsigned int nw = 0;
+    auto add = [&](unsigned int ind, mha_real_t g) {
+        if ( g == 0.0f )
+            return;
+        for (unsigned int i=0; i<nw; ++i)
+            if ( blocks[i] == ind*nchan ) {
+                gains[i] += g;
+                return;
+            }
+        blocks[nw] = ind*nchan;
+        gains[nw++] = g;
+    };
+    add( previous.lo, (1.0f - gain) * (1.0f - previous.frac) );
+    add( previous.hi, (1.0f - gain) * previous.frac );
+    add( current.lo, gain * (1.0f - current.frac) );
+    add( current.hi, gain * current.frac );
+
+    if ( nw == 1 && gains[0] == 1.0f )
+        MHASignal::conj_mac_channels(outSpec, 0, bf_vec, blocks[0], inSpec);
+    else
+        MHASignal::conj_mac_channels_mix(outSpec, 0, bf_vec, blocks, gains,
+                                         nw, inSpec);
+}
+
 //initialise global variables for the fixed beam and calibrate north value.
 int fixed_beam_value = 0;
 int calibrate_north_value = 0;
@@ -57,39 +169,48 @@ int set_calibrate_north(int value, int max_degree){
 mha_spec_t *steerbf_config::process(mha_spec_t *inSpec)
 {
     float head_angle_float = 0.0;
-    bf_vec = MHA_AC::get_var_spectrum(ac, bf_src_copy );
+    if ( !vars_resolved )
+        resolve_vars();
+    bf_vec = MHA_AC::get_var_spectrum(ac, bf_src_var );
     //if angle_src is set, then retrieve steering from AC variable
     //otherwise use the configuration variable
     int angle_ind;
-    if ( _steerbf->angle_src.data.compare("") != 0 ) {
+    //fractional steering index, only set when interpolating
+    float frac_ind = -1.0f;
+    if ( angle_src_var.is_resolved() ) {
         // angle_ind = MHA_AC::get_var_int(ac, _steerbf->angle_src.data );
-        const mha_wave_t angle_ind_wave = MHA_AC::get_var_waveform(ac, _steerbf->angle_src.data);
+        const mha_wave_t angle_ind_wave = MHA_AC::get_var_waveform(ac, angle_src_var);
         angle_ind = (int)value(angle_ind_wave, 0, 0);
     }
     //IF ANGLE_DEGREE IS SET CONVERT OSC DEGREE ANGLE TO REQUIRED INDEX
-    else if ( _steerbf->angle_degree.data.compare("") != 0 ) {
+    else if ( angle_degree_var.is_resolved() ) {
 
         const float max_degree = 360.0;
         //Convert ac variable to accessible value
-        const mha_wave_t beam_input_data = MHA_AC::get_var_waveform(ac, _steerbf->angle_degree.data);
+        const mha_wave_t beam_input_data = MHA_AC::get_var_waveform(ac, angle_degree_var);
 
 
 
         //CHECK IF HEAD TRACKER IS INITIALISED. SET BEAM TO FIXED DIRECTION TO WORLD COORDINATES
-        if(_steerbf->head_angle.data.compare("") != 0 ) {
-            // const mha_wave_t head_input_data = MHA_AC::get_var_waveform(ac, _steerbf->head_angle.data);
-            // head_angle_float = value(head_input_data, 0, 0);
-            const std::vector head_input_data = MHA_AC::get_var_vfloat(ac, _steerbf->head_angle.data);
+        if( head_angle_var.is_resolved() ) {
+            const std::vector head_input_vector =
+                MHA_AC::get_var_vfloat(ac, head_angle_var);
+            if ( head_input_vector.empty() )
+                throw MHA_Error(__FILE__, __LINE__,
+                                "AC variable %s is empty.",
+                                head_angle_var.name.c_str());
+            // head angle is the first element of the float vector
+            const float head_input_data = head_input_vector[0];
 
             
             //Set calibrated north value
-            if(_steerbf->calibrate_north.data.compare("") != 0){
-                if((int)value(MHA_AC::get_var_waveform(ac, _steerbf->calibrate_north.data), 0, 0) ){
-                    calibrate_north_value = head_input_data[0];
+            if( calibrate_north_var.is_resolved() ){
+                if((int)value(MHA_AC::get_var_waveform(ac, calibrate_north_var), 0, 0) ){
+                    calibrate_north_value = head_input_data;
                 }
             } 
 
-            head_angle_float = set_calibrate_north(head_input_data[0], max_degree);
+            head_angle_float = set_calibrate_north(head_input_data, max_degree);
 
             //CHECK IF FLIP HEAD ORIENTATION IS TRIGGERED. FLIP THE HEAD ORIENTATION
             if(_steerbf->flip_head.data == 1 ){
@@ -100,8 +221,8 @@ mha_spec_t *steerbf_config::process(mha_spec_t *inSpec)
 
         //CHECK IF FIX BEAM IS INITIALISED. SET BEAM TO FIXED DIRECTION TO HEAD TRACKER
         int degree_value_int = 0;
-        if(_steerbf->fix_beam.data.compare("") != 0 ) {
-            bool set_fix_beam = (int)value(MHA_AC::get_var_waveform(ac, _steerbf->fix_beam.data), 0, 0);
+        if( fix_beam_var.is_resolved() ) {
+            bool set_fix_beam = (int)value(MHA_AC::get_var_waveform(ac, fix_beam_var), 0, 0);
             if( set_fix_beam){
                 //fixed_beam_value is already in MHA standard
                 degree_value_int = fixed_beam_value;
@@ -126,29 +247,22 @@ mha_spec_t *steerbf_config::process(mha_spec_t *inSpec)
         float index_val = index_per_deg * degree_value_int;
         //Round value to suitable integer
         angle_ind = round(index_val);
+        if ( _steerbf->interpolate.data )
+            frac_ind = index_val;
 
     }
     else {
         angle_ind = _steerbf->angle_ind.data;
     }
-    int block_ind = angle_ind*nchan;
+    const steering_t target = frac_ind >= 0.0f
+        ? steering_t( frac_ind, nangle )
+        : steering_t( static_cast<unsigned int>(angle_ind) );
+    update_steering( target, _steerbf->xfade_frames.data );
 
     // std::cout << _steerbf->bf_src.data << std::endl;
 
     //do the filtering and summing
-    for (unsigned int f=0; f<nfreq; f++) {
-
-        // std::cout << "freq: " << f << std::endl;
-        //init output to zero
-        outSpec(f,0).re = 0;
-        outSpec(f,0).im = 0;
-
-        for (unsigned int m=0; m<nchan; ++m) {
-            //outSpec(f,0) += _conjugate((*beamW)(f,m)) * value(inSpec,f,m);
-            outSpec(f,0) += _conjugate(value(bf_vec,f,m+block_ind)) * value(inSpec,f,m);
-            // std::cout << "c: " << m << ": " << value(bf_vec,f,m+block_ind).re << " " << value(bf_vec,f,m+block_ind).im << std::endl;
-        }
-    }
+    filter_and_sum( *inSpec );
 
     
     _steerbf->head_angle_float = head_angle_float;
@@ -170,20 +284,34 @@ steerbf::steerbf(MHA_AC::algo_comm_t & iac, const std::string & configured_name)
       head_angle("If initialized, provides an int-AC variable of head tracking angle.",""),
       fix_beam("If initialized, provides an int-AC variable fixing the beam respective of head direction.",""),
       flip_head("If true, flips the orientation for the received head angle.","0", "[0, 1]"),
+      xfade_frames("Number of frames for crossfading from the filters of the"
+                   " previous to the filters of the new steering direction"
+                   " when the steering direction changes. 0 switches"
+                   " immediately.", "0", "[0,]"),
+      interpolate("If yes, interpolate between the filters of the two"
+                  " neighbouring steering indices for steering angles between"
+                  " them. Only used with angle_degree.", "no"),
       algo(configured_name)
 {
+    //configurations are replaced for each change of the AC variable
+    //names, keep retired ones for reuse
+    set_cfg_pool_size(2);
+
     //only make a new configuration when bf_src changes
     INSERT_PATCH(bf_src);
 
     //otherwise, the processing plugins query for the current angles
     insert_member(angle_ind);
-    insert_member(angle_src);
+    //AC variable names are resolved when a configuration is created
+    INSERT_PATCH(angle_src);
     //Insert custom member variables
-    insert_member(angle_degree);
-    insert_member(calibrate_north);
-    insert_member(head_angle);
-    insert_member(fix_beam);
+    INSERT_PATCH(angle_degree);
+    INSERT_PATCH(calibrate_north);
+    INSERT_PATCH(head_angle);
+    INSERT_PATCH(fix_beam);
     insert_member(flip_head);
+    insert_member(xfade_frames);
+    insert_member(interpolate);
 
     insert();
 }
@@ -227,10 +355,12 @@ void steerbf::update_cfg()
     if ( is_prepared() ) {
 
         //when necessary, make a new configuration instance
-        //possibly based on changes in parser variables
-        steerbf_config *config;
-        config = new steerbf_config( ac, input_cfg(), this );
-        push_config( config );
+        //possibly based on changes in parser variables, reusing
+        //the buffers of a retired one if possible
+        std::unique_ptr<steerbf_config> config( recycle_config() );
+        if ( !config || !config->reconfigure( input_cfg(), this ) )
+            config.reset( new steerbf_config( ac, input_cfg(), this ) );
+        push_config( config.release() );
     }
 }
 
@@ -277,6 +407,16 @@ MHAPLUGIN_DOCUMENTATION\
  " AC variable for the estimated steering direction. "
  "The steering angle can also be fixed in the configuration time using the"
  " configuration variable \\textbf{angle\\_ind}."
+ " Changes of the steering direction cause audible switching. They can be"
+ " smoothed by crossfading the filters of the previous and the new"
+ " direction over \\textbf{xfade\\_frames} frames. A change of"
+ " direction during a crossfade, e.g. from a head tracker, is applied"
+ " when the running crossfade has finished. With"
+ " \\textbf{interpolate} set, steering angles between two filters"
+ " given in \\textbf{angle\\_degree} use a linear interpolation of"
+ " the neighbouring filters. The combined filters are computed in the"
+ " same pass as the filter and sum operation, so that crossfading costs"
+ " considerably less than two beamformer evaluations."
  )
 
 
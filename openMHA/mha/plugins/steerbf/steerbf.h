@@ -18,6 +18,7 @@
 #define STEERBF_H
 
 #include "mha_plugin.hh"
+#include "mha_simd.hh"
 
 class steerbf;
 
@@ -32,6 +33,23 @@ public:
     }
 };
 
+/** Steering direction given by one or two neighbouring filter blocks:
+    The filters are (1-frac) * block lo + frac * block hi. */
+struct steering_t {
+    /** Steering exactly to the block with index ind */
+    explicit steering_t(unsigned int ind = 0U)
+        : lo(ind), hi(ind), frac(0.0f) {}
+    /** Steering to the fractional block index ind, interpolating
+        between the neighbouring blocks out of nangle blocks */
+    steering_t(float ind, unsigned int nangle);
+    bool operator==(const steering_t & other) const {
+        return lo == other.lo && hi == other.hi && frac == other.frac;
+    }
+    unsigned int lo;
+    unsigned int hi;
+    float frac;
+};
+
 class steerbf_config {
 
 public:
@@ -40,8 +58,18 @@ public:
                    steerbf *steerbf);
     ~steerbf_config();
     mha_spec_t* process(mha_spec_t*);
+    /** Update a retired configuration in place for new parser values.
+        @return false if the signal dimensions differ. */
+    bool reconfigure(const mhaconfig_t in_cfg, steerbf *steerbf);
 
 private:
+    /** Start a crossfade if the steering direction has changed and
+        no crossfade is running.  During a crossfade, the target is
+        evaluated again in each block until the crossfade has finished. */
+    void update_steering(const steering_t & target, unsigned int xfade_frames);
+    /** Filter and sum with the current, possibly crossfaded and
+        interpolated, filters in one pass over the input. */
+    void filter_and_sum(const mha_spec_t & inSpec);
     unsigned int nchan;
     unsigned int nfreq;
     MHASignal::spectrum_t outSpec;
@@ -50,6 +78,27 @@ private:
     steerbf *_steerbf;
     MHA_AC::algo_comm_t & ac;
     std::string bf_src_copy;
+    /** Store the AC variable names of the plugin in unresolved handles. */
+    void name_vars(const steerbf *steerbf);
+    /** Resolve the handles of all AC variables with non-empty names.
+        Called by the first process() of this configuration. */
+    void resolve_vars();
+    /* AC variables used in process(), resolved once in the first
+       process() call of this configuration */
+    bool vars_resolved;
+    MHA_AC::var_handle_t bf_src_var;
+    MHA_AC::var_handle_t angle_src_var;
+    MHA_AC::var_handle_t angle_degree_var;
+    MHA_AC::var_handle_t calibrate_north_var;
+    MHA_AC::var_handle_t head_angle_var;
+    MHA_AC::var_handle_t fix_beam_var;
+    /* Steering state, the filters are crossfaded from previous to
+       current during xfade_len frames after a change of direction */
+    bool has_steering;
+    steering_t previous;
+    steering_t current;
+    unsigned int xfade_pos;
+    unsigned int xfade_len;
 };
 
 //this plugin does its own real-time processing
@@ -73,6 +122,8 @@ public:
     MHAParser::string_t head_angle;
     MHAParser::string_t fix_beam;
     parser_int_dyn flip_head;
+    MHAParser::int_t xfade_frames;
+    MHAParser::bool_t interpolate;
 
     void insert();
     float head_angle_float;
@@ -0,0 +1,117 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "steerbf.h"
+#include "mha_algo_comm.hh"
+#include <cmath>
+#include <vector>
+
+class steerbf_testing : public ::testing::Test {
+  public:
+  // AC variable space
+  MHA_AC::algo_comm_class_t acspace{};
+
+  // C handle to AC variable space
+  MHA_AC::algo_comm_t & ac {acspace};
+
+  // One input channel, 5 frequency bins
+  mhaconfig_t signal_properties = {
+    .channels = 1, .domain = MHA_SPECTRUM, .fragsize = 4,
+    .wndlen = 8, .fftlen = 8, .srate = 16000
+  };
+  const unsigned nfreq = 5, nangle = 3;
+
+  // Filters of steering index k are the constant k+1
+  MHA_AC::spectrum_t filters{ac, "filters", nfreq, nangle, true};
+
+  // Input signal with all bins 1
+  MHASignal::spectrum_t input{nfreq, 1};
+
+  // Plugin instance
+  steerbf plugin{ac, "steerbf"};
+
+  steerbf_testing() {
+    for (unsigned k = 0; k < nangle; ++k)
+      for (unsigned f = 0; f < nfreq; ++f)
+        filters(f, k) = mha_complex(k + 1.0f);
+    for (unsigned f = 0; f < nfreq; ++f)
+      input(f, 0) = mha_complex(1.0f);
+    plugin.parse("bf_src = filters");
+  }
+
+  // Output value of the next block, equal in all bins
+  mha_real_t process() {
+    mha_spec_t * out = plugin.process(&input);
+    for (unsigned f = 1; f < nfreq; ++f)
+      EXPECT_EQ(out->buf[0].re, out->buf[f].re);
+    return out->buf[0].re;
+  }
+};
+
+TEST_F(steerbf_testing, direction_change_during_crossfade_is_continuous)
+{
+  const unsigned xfade = 10;
+  plugin.parse("xfade_frames = " + std::to_string(xfade));
+  plugin.prepare_(signal_properties);
+  std::vector<mha_real_t> out;
+  for (unsigned block = 0; block < 3; ++block)
+    out.push_back(process());
+  EXPECT_EQ(1.0f, out.back());
+  // Start a crossfade to index 2, change to index 1 in its middle
+  plugin.parse("angle_ind = 2");
+  for (unsigned block = 0; block < 4; ++block)
+    out.push_back(process());
+  plugin.parse("angle_ind = 1");
+  for (unsigned block = 0; block < 3 * xfade; ++block)
+    out.push_back(process());
+  EXPECT_FLOAT_EQ(2.0f, out.back());
+  // Between blocks, the filters change by at most one crossfade step
+  // between neighbouring indices
+  const mha_real_t max_step = 2.0f / (xfade + 1) + 1e-5f;
+  for (unsigned k = 1; k < out.size(); ++k)
+    EXPECT_LE(std::fabs(out[k] - out[k - 1]), max_step) << "block " << k;
+  plugin.release_();
+}
+
+TEST_F(steerbf_testing, switches_immediately_without_crossfade)
+{
+  plugin.prepare_(signal_properties);
+  EXPECT_EQ(1.0f, process());
+  plugin.parse("angle_ind = 2");
+  EXPECT_EQ(3.0f, process());
+  plugin.release_();
+}
+
+TEST_F(steerbf_testing, resolves_ac_variables_of_later_plugins)
+{
+  plugin.parse("angle_src = index");
+  // The steering index is published by a plugin prepared after steerbf
+  EXPECT_NO_THROW(plugin.prepare_(signal_properties));
+  MHA_AC::waveform_t index{ac, "index", 1, 1, true};
+  index.buf[0] = 2.0f;
+  EXPECT_EQ(3.0f, process());
+  index.buf[0] = 1.0f;
+  EXPECT_EQ(2.0f, process());
+  plugin.release_();
+}
+
+TEST_F(steerbf_testing, missing_ac_variable_throws_in_process)
+{
+  plugin.parse("angle_src = index");
+  plugin.prepare_(signal_properties);
+  EXPECT_THROW(plugin.process(&input), MHA_Error);
+  plugin.release_();
+}
@@ -58,7 +58,7 @@ wave2spec_t::wave2spec_t(unsigned int nfft,
     const float zeropadding_compensation = sqrtf(float(nfft) / nwnd);
     const float normalization_factor = zeropadding_compensation / rms_of_window;
     window *= normalization_factor;
-    ft = mha_fft_new( nfft );
+    ft = mha_fft_new( nfft, nch );
     if (window.num_channels != 1U)
         throw MHA_Error(__FILE__,__LINE__,
                         "The wave2spec:%s analysis window storage should have"
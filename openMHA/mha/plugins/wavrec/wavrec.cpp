@@ -16,24 +16,46 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <time.h>
-#include <pthread.h>
 #include "mha_plugin.hh"
-#include "mha_fifo.h"
+#include "mha_recorder.hh"
 #include <sndfile.h>
 #include <sys/time.h>
-#include <atomic>
+#include <limits>
+#include <memory>
+
+/** Output sound file of wavwriter_t.  Receives the audio samples through
+ * the fifo of the base class and writes them to disk in the writer thread
+ * of the shared recording service. */
+class soundfile_t : public MHARecorder::fifo_sink_t<mha_real_t> {
+public:
+    /** Register the opened sound file with the recording service.
+     * @param fifosize Capacity of the fifo in samples.
+     * @param minwrite Minimum fill count of the fifo for writing to disk.
+     * @param channels Number of audio channels.
+     * @param sf       Opened sound file, closed by this object. */
+    soundfile_t(unsigned int fifosize,unsigned int minwrite,
+                unsigned int channels,SNDFILE* sf);
+    ~soundfile_t(){close();}
+    /** Unregister from the recording service, write the remaining samples,
+     * and close the sound file.  Idempotent. */
+    void close();
+protected:
+    void write_frames(const mha_real_t* data,unsigned frames) override;
+private:
+    SNDFILE* sf;
+};
 
 class wavwriter_t {
 public:
     wavwriter_t(bool active,const mhaconfig_t& cf,unsigned int fifosize,unsigned int minwrite,
                 const std::string& prefix,bool use_date, const std::string& format_name_);
-    ~wavwriter_t();
     void process(mha_wave_t*);
     void exit_request();
+    /** Number of samples discarded because the fifo was full */
+    unsigned long long get_num_dropped() const
+    {return soundfile ? soundfile->get_num_dropped() : 0U;}
 private:
-    static void* write_thread(void* this_){((wavwriter_t*)this_)->write_thread();return NULL;};
-    void write_thread();
-    void create_soundfile(const std::string& prefix, bool use_date);
+    SNDFILE* create_soundfile(const std::string& prefix, bool use_date);
     /** Converts the format_name string to the corresponding int according to libsndfile and
      *  writes it into the format field of sf_info
      *  throws if no format of this name is available
@@ -41,15 +63,11 @@ private:
      * @throw MHA_Error If no sample format of name format_name is offered by libsndfile
      */
     void set_format(SF_INFO& sf_info);
-    std::atomic<bool> close_session;
-    bool act_;
     mhaconfig_t cf_;
-    SNDFILE* sf;
-    mha_fifo_lf_t<mha_real_t> fifo;
-    unsigned int minw_;
-    pthread_t writethread;
-    float* data;
     std::string format_name;
+    /** Only created when recording is active. Not deallocated before
+     * destruction because process() may access it concurrently. */
+    std::unique_ptr<soundfile_t> soundfile;
 };
 
 class wavrec_t : public MHAPlugin::plugin_t<wavwriter_t> {
@@ -66,6 +84,7 @@ private:
     MHAParser::string_t prefix;
     MHAParser::bool_t use_date;
     MHAParser::kw_t output_sample_format;
+    MHAParser::int_mon_t dropped;
     MHAEvents::patchbay_t<wavrec_t> patchbay;
 };
 
@@ -82,7 +101,9 @@ wavrec_t::wavrec_t(MHA_AC::algo_comm_t & iac,
       prefix("Path (including path delimiter) and file prefix", ""),
       use_date("Use date and time (yes), or only prefix (no)", "yes"),
       output_sample_format("Output sample format", "32_bit_float",
-                           "[32_bit_float]")
+                           "[32_bit_float]"),
+      dropped("Number of samples discarded in the current recording session\n"
+              "because the fifo was full")
 {
   // make the plug-in findable via "?listid"
   set_node_id(configured_name);
@@ -93,6 +114,7 @@ wavrec_t::wavrec_t(MHA_AC::algo_comm_t & iac,
   insert_member(use_date);
   insert_member(record);
   insert_member(output_sample_format);
+  insert_member(dropped);
   patchbay.connect(&record.writeaccess, this, &wavrec_t::start_new_session);
   int count(0);
   sf_command(NULL, SFC_GET_FORMAT_SUBTYPE_COUNT, &count, sizeof(int));
@@ -109,6 +131,9 @@ wavrec_t::wavrec_t(MHA_AC::algo_comm_t & iac,
 mha_wave_t* wavrec_t::process(mha_wave_t* s)
 {
     poll_config()->process(s);
+    dropped.data = static_cast<int>
+        (std::min<unsigned long long>(cfg->get_num_dropped(),
+                                      std::numeric_limits<int>::max()));
     return s;
 }
 
@@ -132,7 +157,7 @@ void wavrec_t::start_new_session()
     push_config(new wavwriter_t(record.data,input_cfg(),fifolen.data,minwrite.data,prefix.data,use_date.data,output_sample_format.data.get_value()));
 }
 
-void wavwriter_t::create_soundfile(const std::string& prefix, bool use_date)
+SNDFILE* wavwriter_t::create_soundfile(const std::string& prefix, bool use_date)
 {
     std::string fname;
     if( use_date ){
@@ -162,75 +187,66 @@ void wavwriter_t::create_soundfile(const std::string& prefix, bool use_date)
 
     sfinfo.format = SF_FORMAT_WAV;
     set_format(sfinfo);
-    sf = sf_open(fname.c_str(),SFM_WRITE,&sfinfo);
-    sf_command(sf, SFC_SET_CLIPPING, NULL, SF_TRUE);
+    SNDFILE* sf = sf_open(fname.c_str(),SFM_WRITE,&sfinfo);
     if( !sf )
         throw MHA_Error(__FILE__,__LINE__,"Unable to create sound file %s: %s",fname.c_str(),sf_strerror(sf));
+    sf_command(sf, SFC_SET_CLIPPING, NULL, SF_TRUE);
+    return sf;
 }
 
-wavwriter_t::wavwriter_t(bool active,const mhaconfig_t& cf,unsigned int fifosize,unsigned int minwrite,
-                         const std::string& prefix, bool use_date, const std::string& format_name_)
-    : close_session(false),
-      act_(active),
-      cf_(cf),
-      sf(NULL),
-      fifo(fifosize),
-      minw_(minwrite),
-      data(new float[fifosize]),
-      format_name(format_name_)
+soundfile_t::soundfile_t(unsigned int fifosize,unsigned int minwrite,
+                         unsigned int channels,SNDFILE* sf)
+    : MHARecorder::fifo_sink_t<mha_real_t>(fifosize,minwrite,channels),
+      sf(sf)
 {
-    if(minw_ >= fifosize )
-        throw MHA_Error(__FILE__,__LINE__,"minwrite must be less then fifosize (minwrite: %u, fifosize: %u)",minw_,fifosize);
-    if( (cf_.channels == 0) || (cf_.srate==0) )
-        act_ = false;
-    if( act_ ){
-        create_soundfile(prefix, use_date);
-        pthread_create(&writethread,NULL,&wavwriter_t::write_thread,this);
-    }
+    start();
 }
 
-wavwriter_t::~wavwriter_t()
+void soundfile_t::close()
 {
-    delete [] data;
+    stop();
+    if( sf ){
+        sf_close(sf);
+        sf=nullptr;
+    }
 }
 
-void wavwriter_t::process(mha_wave_t* s)
+void soundfile_t::write_frames(const mha_real_t* data,unsigned frames)
 {
-    if( act_ ){
-        auto nSamps=(fifo.get_available_space()/cf_.channels)*cf_.channels; // only write multiples of channels
-        fifo.write(s->buf,std::min(nSamps,size(s)));
-    }
+    if( sf )
+        sf_writef_float(sf,data,frames);
 }
 
-void wavwriter_t::exit_request(){
-    if(!close_session.load()){
-        close_session.store(true);
-        if( act_ ){
-            pthread_join(writethread,NULL);
+wavwriter_t::wavwriter_t(bool active,const mhaconfig_t& cf,unsigned int fifosize,unsigned int minwrite,
+                         const std::string& prefix, bool use_date, const std::string& format_name_)
+    : cf_(cf),
+      format_name(format_name_)
+{
+    if(minwrite >= fifosize )
+        throw MHA_Error(__FILE__,__LINE__,"minwrite must be less then fifosize (minwrite: %u, fifosize: %u)",minwrite,fifosize);
+    if( (cf_.channels == 0) || (cf_.srate==0) )
+        active = false;
+    if( active ){
+        SNDFILE* sf = create_soundfile(prefix, use_date);
+        try{
+            soundfile = std::make_unique<soundfile_t>(fifosize,minwrite,cf_.channels,sf);
         }
-        if( sf ){
+        catch(...){
             sf_close(sf);
-            sf=nullptr;
+            throw;
         }
     }
-    return;
 }
 
-void wavwriter_t::write_thread()
+void wavwriter_t::process(mha_wave_t* s)
 {
-    while(!close_session.load()){
-        mha_msleep(1);
-        if( sf && (fifo.get_fill_count() > minw_) ){
-            unsigned int frames = fifo.get_fill_count()/cf_.channels;
-            fifo.read(data,frames*cf_.channels);
-            sf_writef_float(sf,data,frames);
-        }
-    }
-    if( sf && fifo.get_fill_count() ){
-        unsigned int frames = fifo.get_fill_count()/cf_.channels;
-        fifo.read(data,frames*cf_.channels);
-        sf_writef_float(sf,data,frames);
-    }
+    if( soundfile )
+        soundfile->push(s->buf,size(s));
+}
+
+void wavwriter_t::exit_request(){
+    if( soundfile )
+        soundfile->close();
 }
 
 void wavwriter_t::set_format(SF_INFO& sfinfo) {
@@ -265,6 +281,8 @@ MHAPLUGIN_DOCUMENTATION\
  " amount of time until the file is actually closed and ready for further processing. \n"
  " The name (and path) of the output file is chosen by the prefix configuration variable. By default the current"
  " date and time are appended to the file name, this behaviour can be controlled by the \"use\\_date\" variable.\n"
+ " The samples are written to disk by a writer thread shared by all recorder plugins."
+ " If the disk is too slow, samples are discarded and counted in the monitor variable \"dropped\".\n"
  "The \"fifolen\" and \"minwrite\" variables control the behaviour of the fifo buffer and should usually remain unchanged.")
 
 /*